@@ -402,9 +402,16 @@ int reservation_object_get_fences_rcu(struct reservation_object *obj,
 		if (fence_excl && !dma_fence_get_rcu(fence_excl))
 			goto unlock;
 
+		/*
+		 * Objects with only an exclusive fence keep an empty shared
+		 * list around once they have been read from, don't allocate
+		 * a snapshot for them.
+		 */
 		fobj = rcu_dereference(obj->fence);
-		if (fobj)
+		if (fobj && READ_ONCE(fobj->shared_count))
 			sz += sizeof(*shared) * fobj->shared_max;
+		else
+			fobj = NULL;
 
 		if (!pfence_excl && fence_excl)
 			sz += sizeof(*shared);
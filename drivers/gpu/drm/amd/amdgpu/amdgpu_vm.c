@@ -297,9 +297,9 @@ int amdgpu_vm_validate_pt_bos(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 				break;
 
 			spin_lock(&glob->lru_lock);
-			ttm_bo_move_to_lru_tail(&bo->tbo);
+			ttm_bo_move_to_lru_tail(&bo->tbo, NULL);
 			if (bo->shadow)
-				ttm_bo_move_to_lru_tail(&bo->shadow->tbo);
+				ttm_bo_move_to_lru_tail(&bo->shadow->tbo, NULL);
 			spin_unlock(&glob->lru_lock);
 		}
 
@@ -313,21 +313,62 @@ int amdgpu_vm_validate_pt_bos(struct amdgpu_device *adev, struct amdgpu_vm *vm,
 	}
 
 	spin_lock(&glob->lru_lock);
+	if (vm->bulk_moveable) {
+		/* Same PTs at the same spots, one splice per LRU will do */
+		ttm_bo_bulk_move_lru_tail(&vm->lru_bulk_move);
+		spin_unlock(&glob->lru_lock);
+		return r;
+	}
+
+	memset(&vm->lru_bulk_move, 0, sizeof(vm->lru_bulk_move));
 	list_for_each_entry(bo_base, &vm->idle, vm_status) {
 		struct amdgpu_bo *bo = bo_base->bo;
 
 		if (!bo->parent)
 			continue;
 
-		ttm_bo_move_to_lru_tail(&bo->tbo);
+		ttm_bo_move_to_lru_tail(&bo->tbo, &vm->lru_bulk_move);
 		if (bo->shadow)
-			ttm_bo_move_to_lru_tail(&bo->shadow->tbo);
+			ttm_bo_move_to_lru_tail(&bo->shadow->tbo,
+						&vm->lru_bulk_move);
 	}
+	/* Cleared again by amdgpu_vm_del_from_lru_notify() */
+	vm->bulk_moveable = true;
 	spin_unlock(&glob->lru_lock);
 
 	return r;
 }
 
+/**
+ * amdgpu_vm_del_from_lru_notify - a BO was removed from the LRU
+ *
+ * @bo: the BO
+ *
+ * Once one of the idle PTs leaves the LRU (evicted, swapped out, pinned
+ * or freed), the recorded bulk move ranges of its VM no longer hold and
+ * have to be rebuilt by the next amdgpu_vm_validate_pt_bos().
+ */
+void amdgpu_vm_del_from_lru_notify(struct ttm_buffer_object *bo)
+{
+	struct amdgpu_vm_bo_base *bo_base;
+	struct amdgpu_bo *abo;
+
+	if (!amdgpu_bo_is_amdgpu_bo(bo))
+		return;
+
+	abo = ttm_to_amdgpu_bo(bo);
+
+	/* shadow bo doesn't have bo base, it moves along with its parent */
+	if (abo->parent && abo->parent->shadow == abo)
+		abo = abo->parent;
+
+	if (!abo->parent)
+		return;
+
+	list_for_each_entry(bo_base, &abo->va, bo_list)
+		bo_base->vm->bulk_moveable = false;
+}
+
 /**
  * amdgpu_vm_ready - check VM is ready for updates
  *
@@ -1085,7 +1126,9 @@ int amdgpu_vm_update_directories(struct amdgpu_device *adev,
 					   struct amdgpu_vm_bo_base,
 					   vm_status);
 		bo_base->moved = false;
-		list_del_init(&bo_base->vm_status);
+		/* Up to date, and to be moved along the LRU with the others */
+		list_move(&bo_base->vm_status, &vm->idle);
+		vm->bulk_moveable = false;
 
 		bo = bo_base->bo->parent;
 		if (!bo)
@@ -36,12 +36,44 @@
 #include "drm_crtc_internal.h"
 #include "drm_internal.h"
 
+static struct kmem_cache *drm_crtc_commit_slab;
+
+int drm_atomic_slab_init(void)
+{
+	drm_crtc_commit_slab = KMEM_CACHE(drm_crtc_commit, 0);
+	if (!drm_crtc_commit_slab)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void drm_atomic_slab_fini(void)
+{
+	kmem_cache_destroy(drm_crtc_commit_slab);
+}
+
+/**
+ * drm_crtc_commit_alloc - allocate a CRTC commit
+ *
+ * CRTC commits are allocated, and released again, for every CRTC touched by
+ * every commit, so they come from a dedicated slab. Release them through
+ * drm_crtc_commit_put().
+ *
+ * Returns:
+ * A zeroed &drm_crtc_commit, or NULL on allocation failure.
+ */
+struct drm_crtc_commit *drm_crtc_commit_alloc(void)
+{
+	return kmem_cache_zalloc(drm_crtc_commit_slab, GFP_KERNEL);
+}
+EXPORT_SYMBOL(drm_crtc_commit_alloc);
+
 void __drm_crtc_commit_free(struct kref *kref)
 {
 	struct drm_crtc_commit *commit =
 		container_of(kref, struct drm_crtc_commit, ref);
 
-	kfree(commit);
+	kmem_cache_free(drm_crtc_commit_slab, commit);
 }
 EXPORT_SYMBOL(__drm_crtc_commit_free);
 
@@ -1828,7 +1828,7 @@ crtc_or_fake_commit(struct drm_atomic_state *state, struct drm_crtc *crtc)
 	}
 
 	if (!state->fake_commit) {
-		state->fake_commit = kzalloc(sizeof(*state->fake_commit), GFP_KERNEL);
+		state->fake_commit = drm_crtc_commit_alloc();
 		if (!state->fake_commit)
 			return NULL;
 
@@ -1894,7 +1894,7 @@ int drm_atomic_helper_setup_commit(struct drm_atomic_state *state,
 	int i, ret;
 
 	for_each_oldnew_crtc_in_state(state, crtc, old_crtc_state, new_crtc_state, i) {
-		commit = kzalloc(sizeof(*commit), GFP_KERNEL);
+		commit = drm_crtc_commit_alloc();
 		if (!commit)
 			return -ENOMEM;
 
@@ -1544,6 +1544,7 @@ int drm_connector_update_edid_property(struct drm_connector *connector,
 	                                       edid,
 	                                       &connector->base,
 	                                       dev->mode_config.edid_property);
+	connector->edid_reusable = edid && !ret;
 	return ret;
 }
 EXPORT_SYMBOL(drm_connector_update_edid_property);
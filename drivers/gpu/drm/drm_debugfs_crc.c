@@ -29,6 +29,8 @@
 #include <linux/circ_buf.h>
 #include <linux/ctype.h>
 #include <linux/debugfs.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <drm/drmP.h>
 #include "drm_internal.h"
 
@@ -50,6 +52,14 @@
  * containing the CRC data. Fields are separated by a single space and the number
  * of CRC fields is source-specific.
  *
+ * For capture at high frame rates, the dri/0/crtc-N/crc/ring file can be
+ * opened instead of the data file. It can't be read, but mapped with mmap(),
+ * and exposes a &struct drm_crtc_crc_ring into which the kernel writes the
+ * CRC entries directly. Userspace consumes entries by advancing the tail
+ * counter, polls the file to wait for new entries, and finds the number of
+ * entries lost to a full ring in the overflow counter. Only one of the data
+ * and ring files can be open at a time.
+ *
  * Note that though in some cases the CRC is computed in a specified way and on
  * the frame contents as supplied by userspace (eDP 1.3), in general the CRC
  * computation is performed in an unspecified way and on frame contents that have
@@ -130,28 +140,69 @@ static const struct file_operations drm_crtc_crc_control_fops = {
 	.write = crc_control_write
 };
 
+static int crtc_crc_ring_count(struct drm_crtc_crc *crc)
+{
+	u32 count;
+
+	/*
+	 * The shared ring is writable by userspace, so only the tail is
+	 * taken from it, and bounded before use: a tail that is not within
+	 * the last DRM_CRC_RING_ENTRIES_NR entries produced leaves the ring
+	 * full.
+	 */
+	count = crc->ring_head - READ_ONCE(crc->ring->tail);
+	return min_t(u32, count, DRM_CRC_RING_ENTRIES_NR);
+}
+
 static int crtc_crc_data_count(struct drm_crtc_crc *crc)
 {
 	assert_spin_locked(&crc->lock);
+	if (crc->ring)
+		return crtc_crc_ring_count(crc);
 	return CIRC_CNT(crc->head, crc->tail, DRM_CRC_ENTRIES_NR);
 }
 
-static void crtc_crc_cleanup(struct drm_crtc_crc *crc)
+/* Returns the ring, for the caller to vfree() after dropping the lock */
+static struct drm_crtc_crc_ring *crtc_crc_cleanup(struct drm_crtc_crc *crc)
 {
+	struct drm_crtc_crc_ring *ring = crc->ring;
+
 	kfree(crc->entries);
 	crc->overflow = false;
 	crc->entries = NULL;
+	crc->ring = NULL;
 	crc->head = 0;
 	crc->tail = 0;
+	crc->ring_head = 0;
+	crc->ring_overflows = 0;
 	crc->values_cnt = 0;
 	crc->opened = false;
+
+	return ring;
 }
 
-static int crtc_crc_open(struct inode *inode, struct file *filep)
+static struct drm_crtc_crc_ring *crtc_crc_ring_alloc(size_t values_cnt)
+{
+	struct drm_crtc_crc_ring *ring;
+
+	BUILD_BUG_ON_NOT_POWER_OF_2(DRM_CRC_RING_ENTRIES_NR);
+
+	ring = vmalloc_user(struct_size(ring, entries,
+					DRM_CRC_RING_ENTRIES_NR));
+	if (!ring)
+		return NULL;
+
+	ring->entries_nr = DRM_CRC_RING_ENTRIES_NR;
+	ring->values_cnt = values_cnt;
+
+	return ring;
+}
+
+static int __crtc_crc_open(struct drm_crtc *crtc, bool mmap)
 {
-	struct drm_crtc *crtc = inode->i_private;
 	struct drm_crtc_crc *crc = &crtc->crc;
 	struct drm_crtc_crc_entry *entries = NULL;
+	struct drm_crtc_crc_ring *ring = NULL;
 	size_t values_cnt;
 	int ret = 0;
 
@@ -192,14 +243,19 @@ static int crtc_crc_open(struct inode *inode, struct file *filep)
 		goto err_disable;
 	}
 
-	entries = kcalloc(DRM_CRC_ENTRIES_NR, sizeof(*entries), GFP_KERNEL);
-	if (!entries) {
+	if (mmap)
+		ring = crtc_crc_ring_alloc(values_cnt);
+	else
+		entries = kcalloc(DRM_CRC_ENTRIES_NR, sizeof(*entries),
+				  GFP_KERNEL);
+	if (!entries && !ring) {
 		ret = -ENOMEM;
 		goto err_disable;
 	}
 
 	spin_lock_irq(&crc->lock);
 	crc->entries = entries;
+	crc->ring = ring;
 	crc->values_cnt = values_cnt;
 
 	/*
@@ -221,22 +277,30 @@ static int crtc_crc_open(struct inode *inode, struct file *filep)
 	crtc->funcs->set_crc_source(crtc, NULL, &values_cnt);
 err:
 	spin_lock_irq(&crc->lock);
-	crtc_crc_cleanup(crc);
+	ring = crtc_crc_cleanup(crc);
 	spin_unlock_irq(&crc->lock);
+	vfree(ring);
 	return ret;
 }
 
+static int crtc_crc_open(struct inode *inode, struct file *filep)
+{
+	return __crtc_crc_open(inode->i_private, false);
+}
+
 static int crtc_crc_release(struct inode *inode, struct file *filep)
 {
 	struct drm_crtc *crtc = filep->f_inode->i_private;
 	struct drm_crtc_crc *crc = &crtc->crc;
+	struct drm_crtc_crc_ring *ring;
 	size_t values_cnt;
 
 	crtc->funcs->set_crc_source(crtc, NULL, &values_cnt);
 
 	spin_lock_irq(&crc->lock);
-	crtc_crc_cleanup(crc);
+	ring = crtc_crc_cleanup(crc);
 	spin_unlock_irq(&crc->lock);
+	vfree(ring);
 
 	return 0;
 }
@@ -334,6 +398,28 @@ static const struct file_operations drm_crtc_crc_data_fops = {
 	.release = crtc_crc_release,
 };
 
+static int crtc_crc_ring_open(struct inode *inode, struct file *filep)
+{
+	return __crtc_crc_open(inode->i_private, true);
+}
+
+static int crtc_crc_ring_mmap(struct file *filep, struct vm_area_struct *vma)
+{
+	struct drm_crtc *crtc = filep->f_inode->i_private;
+	struct drm_crtc_crc *crc = &crtc->crc;
+
+	/* The ring lives as long as the file, which the mapping pins */
+	return remap_vmalloc_range(vma, crc->ring, vma->vm_pgoff);
+}
+
+static const struct file_operations drm_crtc_crc_ring_fops = {
+	.owner = THIS_MODULE,
+	.open = crtc_crc_ring_open,
+	.mmap = crtc_crc_ring_mmap,
+	.poll = crtc_crc_poll,
+	.release = crtc_crc_release,
+};
+
 int drm_debugfs_crtc_crc_add(struct drm_crtc *crtc)
 {
 	struct dentry *crc_ent, *ent;
@@ -355,6 +441,11 @@ int drm_debugfs_crtc_crc_add(struct drm_crtc *crtc)
 	if (!ent)
 		goto error;
 
+	ent = debugfs_create_file("ring", S_IRUGO | S_IWUSR, crc_ent, crtc,
+				  &drm_crtc_crc_ring_fops);
+	if (!ent)
+		goto error;
+
 	return 0;
 
 error:
@@ -382,6 +473,40 @@ int drm_crtc_add_crc_entry(struct drm_crtc *crtc, bool has_frame,
 
 	spin_lock(&crc->lock);
 
+	if (crc->ring) {
+		struct drm_crtc_crc_ring *ring = crc->ring;
+		struct drm_crtc_crc_ring_entry *rentry;
+
+		/*
+		 * Only our private copies of the ring state are used to index
+		 * the ring, the shared header is merely refreshed for the
+		 * benefit of userspace.
+		 */
+		ring->entries_nr = DRM_CRC_RING_ENTRIES_NR;
+		ring->values_cnt = crc->values_cnt;
+
+		if (crtc_crc_ring_count(crc) >= DRM_CRC_RING_ENTRIES_NR) {
+			WRITE_ONCE(ring->overflows, ++crc->ring_overflows);
+			spin_unlock(&crc->lock);
+			return -ENOBUFS;
+		}
+
+		rentry = &ring->entries[crc->ring_head &
+					(DRM_CRC_RING_ENTRIES_NR - 1)];
+		rentry->flags = has_frame ? DRM_CRC_RING_HAS_FRAME : 0;
+		rentry->frame = frame;
+		memcpy(rentry->crcs, crcs, sizeof(*crcs) * crc->values_cnt);
+
+		/* Publish the entry only once it's complete */
+		smp_store_release(&ring->head, ++crc->ring_head);
+
+		spin_unlock(&crc->lock);
+
+		wake_up_interruptible(&crc->wq);
+
+		return 0;
+	}
+
 	/* Caller may not have noticed yet that userspace has stopped reading */
 	if (!crc->entries) {
 		spin_unlock(&crc->lock);
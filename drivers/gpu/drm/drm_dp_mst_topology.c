@@ -24,6 +24,7 @@
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/errno.h>
+#include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/seq_file.h>
 #include <linux/i2c.h>
@@ -60,6 +61,8 @@ static void drm_dp_send_link_address(struct drm_dp_mst_topology_mgr *mgr,
 static int drm_dp_send_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
 					   struct drm_dp_mst_branch *mstb,
 					   struct drm_dp_mst_port *port);
+static void drm_dp_send_enum_path_resources_all(struct drm_dp_mst_topology_mgr *mgr,
+						struct drm_dp_mst_branch *mstb);
 static bool drm_dp_validate_guid(struct drm_dp_mst_topology_mgr *mgr,
 				 u8 *guid);
 
@@ -67,6 +70,17 @@ static int drm_dp_mst_register_i2c_bus(struct drm_dp_aux *aux);
 static void drm_dp_mst_unregister_i2c_bus(struct drm_dp_aux *aux);
 static void drm_dp_mst_kick_tx(struct drm_dp_mst_topology_mgr *mgr);
 /* sideband msg handling */
+/*
+ * Send the next queued sideband request as soon as the previous one is out,
+ * rather than on the interrupt for the previous reply. The protocol allows
+ * two requests in flight per branch device, but some branch devices drop
+ * requests that arrive before they consumed the previous one.
+ */
+static bool dp_mst_pipeline __read_mostly;
+module_param_unsafe(dp_mst_pipeline, bool, 0644);
+MODULE_PARM_DESC(dp_mst_pipeline,
+		 "Send MST sideband requests back to back, without waiting for the previous reply (default false)");
+
 static u8 drm_dp_msg_header_crc4(const uint8_t *data, size_t num_nibbles)
 {
 	u8 bitmask = 0x80;
@@ -810,10 +824,17 @@ static int drm_dp_mst_wait_tx_reply(struct drm_dp_mst_branch *mstb,
 	mutex_lock(&mstb->mgr->qlock);
 	if (ret > 0) {
 		if (txmsg->state == DRM_DP_SIDEBAND_TX_TIMEOUT) {
+			mgr->stats.timeouts++;
 			ret = -EIO;
 			goto out;
 		}
+
+		mgr->stats.max_reply_us =
+			max_t(u64, mgr->stats.max_reply_us,
+			      ktime_us_delta(ktime_get(), txmsg->queued));
 	} else {
+		mgr->stats.timeouts++;
+
 		DRM_DEBUG_KMS("timedout msg send %p %d %d\n", txmsg, txmsg->state, txmsg->seqno);
 
 		/* dump some state */
@@ -1346,6 +1367,8 @@ static void drm_dp_check_and_send_link_address(struct drm_dp_mst_topology_mgr *m
 	if (!mstb->link_address_sent)
 		drm_dp_send_link_address(mgr, mstb);
 
+	drm_dp_send_enum_path_resources_all(mgr, mstb);
+
 	list_for_each_entry(port, &mstb->ports, next) {
 		if (port->input)
 			continue;
@@ -1353,9 +1376,6 @@ static void drm_dp_check_and_send_link_address(struct drm_dp_mst_topology_mgr *m
 		if (!port->ddps)
 			continue;
 
-		if (!port->available_pbn)
-			drm_dp_send_enum_path_resources(mgr, mstb, port);
-
 		if (port->mstb) {
 			mstb_child = drm_dp_get_validated_mstb_ref(mgr, port->mstb);
 			if (mstb_child) {
@@ -1378,8 +1398,15 @@ static void drm_dp_mst_link_probe_work(struct work_struct *work)
 	}
 	mutex_unlock(&mgr->lock);
 	if (mstb) {
+		ktime_t start = ktime_get();
+
 		drm_dp_check_and_send_link_address(mgr, mstb);
 		drm_dp_put_mst_branch_device(mstb);
+
+		mgr->stats.probes++;
+		mgr->stats.last_probe_us = ktime_us_delta(ktime_get(), start);
+		mgr->stats.max_probe_us = max(mgr->stats.max_probe_us,
+					      mgr->stats.last_probe_us);
 	}
 }
 
@@ -1541,6 +1568,31 @@ static int process_single_tx_qlock(struct drm_dp_mst_topology_mgr *mgr,
 	return 0;
 }
 
+/*
+ * Pick the next message to send: one that was partially sent must be finished
+ * first, as chunks of different messages can't be interleaved. Otherwise take
+ * the first message whose destination has a free slot, so that a branch with
+ * two requests outstanding doesn't hold up the requests to other branches.
+ * Messages to the same branch are still sent in order.
+ */
+static struct drm_dp_sideband_msg_tx *
+next_down_tx_qlock(struct drm_dp_mst_topology_mgr *mgr)
+{
+	struct drm_dp_sideband_msg_tx *txmsg;
+
+	list_for_each_entry(txmsg, &mgr->tx_msg_downq, next) {
+		if (txmsg->cur_offset)
+			return txmsg;
+	}
+
+	list_for_each_entry(txmsg, &mgr->tx_msg_downq, next) {
+		if (!txmsg->dst->tx_slots[0] || !txmsg->dst->tx_slots[1])
+			return txmsg;
+	}
+
+	return NULL;
+}
+
 static void process_single_down_tx_qlock(struct drm_dp_mst_topology_mgr *mgr)
 {
 	struct drm_dp_sideband_msg_tx *txmsg;
@@ -1548,22 +1600,32 @@ static void process_single_down_tx_qlock(struct drm_dp_mst_topology_mgr *mgr)
 
 	WARN_ON(!mutex_is_locked(&mgr->qlock));
 
-	/* construct a chunk from the first msg in the tx_msg queue */
-	if (list_empty(&mgr->tx_msg_downq))
-		return;
-
-	txmsg = list_first_entry(&mgr->tx_msg_downq, struct drm_dp_sideband_msg_tx, next);
-	ret = process_single_tx_qlock(mgr, txmsg, false);
-	if (ret == 1) {
-		/* txmsg is sent it should be in the slots now */
-		list_del(&txmsg->next);
-	} else if (ret) {
-		DRM_DEBUG_KMS("failed to send msg in q %d\n", ret);
-		list_del(&txmsg->next);
-		if (txmsg->seqno != -1)
-			txmsg->dst->tx_slots[txmsg->seqno] = NULL;
-		txmsg->state = DRM_DP_SIDEBAND_TX_TIMEOUT;
-		wake_up_all(&mgr->tx_waitq);
+	/* construct a chunk from the next sendable msg in the tx_msg queue */
+	while ((txmsg = next_down_tx_qlock(mgr))) {
+		ret = process_single_tx_qlock(mgr, txmsg, false);
+		if (ret == 1) {
+			/* txmsg is sent it should be in the slots now */
+			list_del(&txmsg->next);
+			mgr->stats.requests++;
+
+			/*
+			 * By default the next message waits for the kick
+			 * from the next sideband interrupt.
+			 */
+			if (dp_mst_pipeline)
+				continue;
+		} else if (ret == -EAGAIN) {
+			/* No free slot after all, retry on the next kick */
+			txmsg->state = DRM_DP_SIDEBAND_TX_QUEUED;
+		} else if (ret) {
+			DRM_DEBUG_KMS("failed to send msg in q %d\n", ret);
+			list_del(&txmsg->next);
+			if (txmsg->seqno != -1)
+				txmsg->dst->tx_slots[txmsg->seqno] = NULL;
+			txmsg->state = DRM_DP_SIDEBAND_TX_TIMEOUT;
+			wake_up_all(&mgr->tx_waitq);
+		}
+		break;
 	}
 }
 
@@ -1586,8 +1648,9 @@ static void drm_dp_queue_down_tx(struct drm_dp_mst_topology_mgr *mgr,
 				 struct drm_dp_sideband_msg_tx *txmsg)
 {
 	mutex_lock(&mgr->qlock);
+	txmsg->queued = ktime_get();
 	list_add_tail(&txmsg->next, &mgr->tx_msg_downq);
-	if (list_is_singular(&mgr->tx_msg_downq))
+	if (dp_mst_pipeline || list_is_singular(&mgr->tx_msg_downq))
 		process_single_down_tx_qlock(mgr);
 	mutex_unlock(&mgr->qlock);
 }
@@ -1645,23 +1708,33 @@ static void drm_dp_send_link_address(struct drm_dp_mst_topology_mgr *mgr,
 	kfree(txmsg);
 }
 
-static int drm_dp_send_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
-					   struct drm_dp_mst_branch *mstb,
-					   struct drm_dp_mst_port *port)
+static struct drm_dp_sideband_msg_tx *
+drm_dp_queue_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
+				 struct drm_dp_mst_branch *mstb,
+				 struct drm_dp_mst_port *port)
 {
-	int len;
 	struct drm_dp_sideband_msg_tx *txmsg;
-	int ret;
 
 	txmsg = kzalloc(sizeof(*txmsg), GFP_KERNEL);
 	if (!txmsg)
-		return -ENOMEM;
+		return NULL;
 
 	txmsg->dst = mstb;
-	len = build_enum_path_resources(txmsg, port->port_num);
+	build_enum_path_resources(txmsg, port->port_num);
 
 	drm_dp_queue_down_tx(mgr, txmsg);
 
+	return txmsg;
+}
+
+static void
+drm_dp_finish_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
+				  struct drm_dp_mst_branch *mstb,
+				  struct drm_dp_mst_port *port,
+				  struct drm_dp_sideband_msg_tx *txmsg)
+{
+	int ret;
+
 	ret = drm_dp_mst_wait_tx_reply(mstb, txmsg);
 	if (ret > 0) {
 		if (txmsg->reply.reply_type == 1)
@@ -1676,9 +1749,77 @@ static int drm_dp_send_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
 	}
 
 	kfree(txmsg);
+}
+
+static int drm_dp_send_enum_path_resources(struct drm_dp_mst_topology_mgr *mgr,
+					   struct drm_dp_mst_branch *mstb,
+					   struct drm_dp_mst_port *port)
+{
+	struct drm_dp_sideband_msg_tx *txmsg;
+
+	txmsg = drm_dp_queue_enum_path_resources(mgr, mstb, port);
+	if (!txmsg)
+		return -ENOMEM;
+
+	drm_dp_finish_enum_path_resources(mgr, mstb, port, txmsg);
 	return 0;
 }
 
+/*
+ * Queue the path resource requests for all of a branch's connected output
+ * ports before waiting for any reply, so that each request is sent as soon
+ * as the previous reply frees the sideband, instead of a round trip through
+ * the waiter for every port.
+ */
+static void drm_dp_send_enum_path_resources_all(struct drm_dp_mst_topology_mgr *mgr,
+						struct drm_dp_mst_branch *mstb)
+{
+	struct {
+		struct drm_dp_mst_port *port;
+		struct drm_dp_sideband_msg_tx *txmsg;
+	} *reqs;
+	struct drm_dp_mst_port *port;
+	int i, count = 0, n = 0;
+
+	mutex_lock(&mgr->lock);
+	list_for_each_entry(port, &mstb->ports, next)
+		count++;
+	mutex_unlock(&mgr->lock);
+	if (!count)
+		return;
+
+	reqs = kcalloc(count, sizeof(*reqs), GFP_KERNEL);
+	if (!reqs)
+		return;
+
+	mutex_lock(&mgr->lock);
+	list_for_each_entry(port, &mstb->ports, next) {
+		if (n == count)
+			break;
+
+		if (port->input || !port->ddps || port->available_pbn)
+			continue;
+
+		kref_get(&port->kref);
+		reqs[n++].port = port;
+	}
+	mutex_unlock(&mgr->lock);
+
+	for (i = 0; i < n; i++)
+		reqs[i].txmsg = drm_dp_queue_enum_path_resources(mgr, mstb,
+								 reqs[i].port);
+
+	for (i = 0; i < n; i++) {
+		if (reqs[i].txmsg)
+			drm_dp_finish_enum_path_resources(mgr, mstb,
+							  reqs[i].port,
+							  reqs[i].txmsg);
+		drm_dp_put_port(reqs[i].port);
+	}
+
+	kfree(reqs);
+}
+
 static struct drm_dp_mst_port *drm_dp_get_last_connected_port_to_mstb(struct drm_dp_mst_branch *mstb)
 {
 	if (!mstb->port_parent)
@@ -2987,6 +3128,15 @@ void drm_dp_mst_dump_topology(struct seq_file *m,
 	/* dump VCPIs */
 	mutex_unlock(&mgr->lock);
 
+	mutex_lock(&mgr->qlock);
+	seq_printf(m, "probe: %u walks, last %llu us, max %llu us\n",
+		   mgr->stats.probes, mgr->stats.last_probe_us,
+		   mgr->stats.max_probe_us);
+	seq_printf(m, "sideband: %u requests, %u timeouts, max reply %llu us\n",
+		   mgr->stats.requests, mgr->stats.timeouts,
+		   mgr->stats.max_reply_us);
+	mutex_unlock(&mgr->qlock);
+
 	mutex_lock(&mgr->payload_lock);
 	seq_printf(m, "vcpi: %lx %lx %d\n", mgr->payload_mask, mgr->vcpi_mask,
 		mgr->max_payloads);
@@ -1546,6 +1546,34 @@ static void connector_bad_edid(struct drm_connector *connector,
 	}
 }
 
+/*
+ * Compare a freshly read base block against the EDID the connector already
+ * exposes. Block 0 carries the extension count and a checksum over itself,
+ * so an identical block 0 on an unchanged sink lets us hand out the
+ * extensions we already have instead of reading them all again. The base
+ * block says nothing about the extensions themselves, so the cache is only
+ * trusted until the next hotplug interrupt (see &drm_connector.edid_reusable).
+ */
+static struct edid *drm_edid_reuse_cached(struct drm_connector *connector,
+					  const u8 *block0)
+{
+	const struct drm_property_blob *blob = connector->edid_blob_ptr;
+
+	if (!connector->edid_reusable)
+		return NULL;
+
+	if (!blob || blob->length != (block0[0x7e] + 1) * EDID_LENGTH)
+		return NULL;
+
+	if (memcmp(blob->data, block0, EDID_LENGTH))
+		return NULL;
+
+	DRM_DEBUG_KMS("%s: EDID base block unchanged, reusing %u extension(s)\n",
+		      connector->name, block0[0x7e]);
+
+	return drm_edid_duplicate(blob->data);
+}
+
 /**
  * drm_do_get_edid - get EDID data using a custom EDID block read function
  * @connector: connector we're probing
@@ -1564,6 +1592,11 @@ static void connector_bad_edid(struct drm_connector *connector,
  * (drm_load_edid_firmware() and drm.edid_firmware parameter), in this priority
  * order. Having either of them bypasses actual EDID reads.
  *
+ * If the base block matches the EDID currently attached to the connector
+ * through drm_connector_update_edid_property(), and there has been no
+ * hotplug interrupt on the connector since, the extension blocks are taken
+ * from that copy instead of being read from the sink again.
+ *
  * Return: Pointer to valid EDID or NULL if we couldn't find any.
  */
 struct edid *drm_do_get_edid(struct drm_connector *connector,
@@ -1607,6 +1640,12 @@ struct edid *drm_do_get_edid(struct drm_connector *connector,
 	if (valid_extensions == 0)
 		return (struct edid *)edid;
 
+	new = (u8 *)drm_edid_reuse_cached(connector, edid);
+	if (new) {
+		kfree(edid);
+		return (struct edid *)new;
+	}
+
 	new = krealloc(edid, (valid_extensions + 1) * EDID_LENGTH, GFP_KERNEL);
 	if (!new)
 		goto out;
@@ -186,6 +186,8 @@ drm_gem_remove_prime_handles(struct drm_gem_object *obj, struct drm_file *filp)
 		drm_prime_remove_buf_handle_locked(&filp->prime,
 						   obj->dma_buf);
 	}
+	if (obj->import_attach)
+		drm_prime_cache_import_locked(&filp->prime, obj);
 	mutex_unlock(&filp->prime.lock);
 }
 
@@ -638,6 +640,16 @@ drm_gem_object_lookup(struct drm_file *filp, u32 handle)
 {
 	struct drm_gem_object *obj;
 
+	if (drm_core_check_feature(filp->minor->dev, DRIVER_GEM_RCU)) {
+		rcu_read_lock();
+		obj = idr_find(&filp->object_idr, handle);
+		if (obj && !kref_get_unless_zero(&obj->refcount))
+			obj = NULL;
+		rcu_read_unlock();
+
+		return obj;
+	}
+
 	spin_lock(&filp->table_lock);
 
 	/* Check if we currently have a reference on the object */
@@ -651,6 +663,88 @@ drm_gem_object_lookup(struct drm_file *filp, u32 handle)
 }
 EXPORT_SYMBOL(drm_gem_object_lookup);
 
+static int objects_lookup_rcu(struct drm_file *filp, const u32 *handles,
+			      int count, struct drm_gem_object **objs)
+{
+	int i;
+
+	rcu_read_lock();
+	for (i = 0; i < count; i++) {
+		struct drm_gem_object *obj;
+
+		obj = idr_find(&filp->object_idr, handles[i]);
+		if (!obj || !kref_get_unless_zero(&obj->refcount))
+			break;
+
+		objs[i] = obj;
+	}
+	rcu_read_unlock();
+
+	return i;
+}
+
+static int objects_lookup_locked(struct drm_file *filp, const u32 *handles,
+				 int count, struct drm_gem_object **objs)
+{
+	int i;
+
+	spin_lock(&filp->table_lock);
+	for (i = 0; i < count; i++) {
+		struct drm_gem_object *obj;
+
+		obj = idr_find(&filp->object_idr, handles[i]);
+		if (!obj)
+			break;
+
+		drm_gem_object_get(obj);
+		objs[i] = obj;
+	}
+	spin_unlock(&filp->table_lock);
+
+	return i;
+}
+
+/**
+ * drm_gem_objects_lookup - look up GEM objects from an array of handles
+ * @filp: DRM file private data
+ * @handles: array of userspace handles
+ * @count: number of handles
+ * @objs: array to fill with a reference to each object
+ *
+ * Looks up all @handles at once, taking the RCU read lock or
+ * &drm_file.table_lock a single time for the whole array instead of once
+ * per handle. Intended for ioctls that take handle arrays, like command
+ * submission.
+ *
+ * Returns:
+ *
+ * 0 on success, with a reference in @objs for every handle which must be
+ * released with drm_gem_object_put_unlocked(). -ENOENT if any handle does
+ * not name an object, in which case no references are held.
+ */
+int drm_gem_objects_lookup(struct drm_file *filp, const u32 *handles,
+			   int count, struct drm_gem_object **objs)
+{
+	int n;
+
+	if (drm_core_check_feature(filp->minor->dev, DRIVER_GEM_RCU))
+		n = objects_lookup_rcu(filp, handles, count, objs);
+	else
+		n = objects_lookup_locked(filp, handles, count, objs);
+
+	if (n < count) {
+		DRM_DEBUG("Failed to look up GEM BO %d: %d\n", n, handles[n]);
+		while (n--) {
+			drm_gem_object_put_unlocked(objs[n]);
+			objs[n] = NULL;
+		}
+		return -ENOENT;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(drm_gem_objects_lookup);
+
 /**
  * drm_gem_close_ioctl - implementation of the GEM_CLOSE ioctl
  * @dev: drm_device
@@ -798,6 +892,10 @@ drm_gem_release(struct drm_device *dev, struct drm_file *file_private)
 	idr_for_each(&file_private->object_idr,
 		     &drm_gem_object_release_handle, file_private);
 	idr_destroy(&file_private->object_idr);
+
+	/* closing the handles above refilled it, nothing can import now */
+	if (drm_core_check_feature(dev, DRIVER_PRIME))
+		drm_prime_release_import_cache(&file_private->prime);
 }
 
 /**
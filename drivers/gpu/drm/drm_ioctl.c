@@ -244,6 +244,9 @@ static int drm_getcap(struct drm_device *dev, void *data, struct drm_file *file_
 	case DRM_CAP_SYNCOBJ:
 		req->value = drm_core_check_feature(dev, DRIVER_SYNCOBJ);
 		return 0;
+	case DRM_CAP_SYNCOBJ_TIMELINE:
+		req->value = drm_core_check_feature(dev, DRIVER_SYNCOBJ);
+		return 0;
 	}
 
 	/* Other caps only work with KMS drivers */
@@ -669,10 +672,18 @@ static const struct drm_ioctl_desc drm_ioctls[] = {
 		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_WAIT, drm_syncobj_wait_ioctl,
 		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_TIMELINE_WAIT, drm_syncobj_timeline_wait_ioctl,
+		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_RESET, drm_syncobj_reset_ioctl,
 		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_SIGNAL, drm_syncobj_signal_ioctl,
 		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_TRANSFER, drm_syncobj_transfer_ioctl,
+		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_TIMELINE_SIGNAL, drm_syncobj_timeline_signal_ioctl,
+		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF(DRM_IOCTL_SYNCOBJ_QUERY, drm_syncobj_query_ioctl,
+		      DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF(DRM_IOCTL_CRTC_GET_SEQUENCE, drm_crtc_get_sequence_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF(DRM_IOCTL_CRTC_QUEUE_SEQUENCE, drm_crtc_queue_sequence_ioctl, DRM_UNLOCKED),
 	DRM_IOCTL_DEF(DRM_IOCTL_MODE_CREATE_LEASE, drm_mode_create_lease_ioctl, DRM_MASTER|DRM_UNLOCKED),
@@ -731,6 +742,23 @@ static const struct drm_ioctl_desc drm_ioctls[] = {
  * the driver-specific IOCTLs are wired up.
  */
 
+static long drm_ioctl_call(struct drm_device *dev, drm_ioctl_t *func,
+			   void *kdata, struct drm_file *file_priv, u32 flags)
+{
+	long retcode;
+
+	/* Enforce sane locking for modern driver ioctls. */
+	if (!drm_core_check_feature(dev, DRIVER_LEGACY) ||
+	    (flags & DRM_UNLOCKED))
+		retcode = func(dev, kdata, file_priv);
+	else {
+		mutex_lock(&drm_global_mutex);
+		retcode = func(dev, kdata, file_priv);
+		mutex_unlock(&drm_global_mutex);
+	}
+	return retcode;
+}
+
 long drm_ioctl_kernel(struct file *file, drm_ioctl_t *func, void *kdata,
 		      u32 flags)
 {
@@ -745,19 +773,34 @@ long drm_ioctl_kernel(struct file *file, drm_ioctl_t *func, void *kdata,
 	if (unlikely(retcode))
 		return retcode;
 
-	/* Enforce sane locking for modern driver ioctls. */
-	if (!drm_core_check_feature(dev, DRIVER_LEGACY) ||
-	    (flags & DRM_UNLOCKED))
-		retcode = func(dev, kdata, file_priv);
-	else {
-		mutex_lock(&drm_global_mutex);
-		retcode = func(dev, kdata, file_priv);
-		mutex_unlock(&drm_global_mutex);
-	}
-	return retcode;
+	return drm_ioctl_call(dev, func, kdata, file_priv, flags);
 }
 EXPORT_SYMBOL(drm_ioctl_kernel);
 
+/*
+ * Whether an ioctl is permitted never changes for a given file unless it
+ * depends on master status or capabilities: render nodes stay render nodes
+ * and authentication is never revoked. Remember the positive results so
+ * that a client's hot ioctls only go through drm_ioctl_permit() once.
+ */
+static int drm_ioctl_permit_cached(unsigned int nr, u32 flags,
+				   struct drm_file *file_priv)
+{
+	int ret;
+
+	if (test_bit(nr, file_priv->ioctl_permitted))
+		return 0;
+
+	ret = drm_ioctl_permit(flags, file_priv);
+	if (ret)
+		return ret;
+
+	if (!(flags & (DRM_MASTER | DRM_ROOT_ONLY)))
+		set_bit(nr, file_priv->ioctl_permitted);
+
+	return 0;
+}
+
 /**
  * drm_ioctl - ioctl callback implementation for DRM drivers
  * @filp: file this ioctl is called on
@@ -766,7 +809,9 @@ EXPORT_SYMBOL(drm_ioctl_kernel);
  *
  * Looks up the ioctl function in the DRM core and the driver dispatch table,
  * stored in &drm_driver.ioctls. It checks for necessary permission by calling
- * drm_ioctl_permit(), and dispatches to the respective function.
+ * drm_ioctl_permit(), and dispatches to the respective function. Permissions
+ * that cannot be revoked are only checked on the first call of each ioctl
+ * on a file, see &drm_file.ioctl_permitted.
  *
  * Returns:
  * Zero on success, negative error code on failure.
@@ -826,6 +871,10 @@ long drm_ioctl(struct file *filp,
 		goto err_i1;
 	}
 
+	retcode = drm_ioctl_permit_cached(nr, ioctl->flags, file_priv);
+	if (unlikely(retcode))
+		goto err_i1;
+
 	if (ksize <= sizeof(stack_kdata)) {
 		kdata = stack_kdata;
 	} else {
@@ -844,7 +893,8 @@ long drm_ioctl(struct file *filp,
 	if (ksize > in_size)
 		memset(kdata + in_size, 0, ksize - in_size);
 
-	retcode = drm_ioctl_kernel(filp, func, kdata, ioctl->flags);
+	/* Unplug and permissions were already checked above */
+	retcode = drm_ioctl_call(dev, func, kdata, file_priv, ioctl->flags);
 	if (copy_to_user((void __user *)arg, kdata, out_size) != 0)
 		retcode = -EFAULT;
 
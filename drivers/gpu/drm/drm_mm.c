@@ -48,6 +48,7 @@
 #include <linux/seq_file.h>
 #include <linux/export.h>
 #include <linux/interval_tree_generic.h>
+#include <linux/rbtree_augmented.h>
 
 /**
  * DOC: Overview
@@ -222,23 +223,53 @@ static void drm_mm_interval_tree_add_node(struct drm_mm_node *hole_node,
 				   &drm_mm_interval_tree_augment);
 }
 
-#define RB_INSERT(root, member, expr) do { \
-	struct rb_node **link = &root.rb_node, *rb = NULL; \
-	u64 x = expr(node); \
-	while (*link) { \
-		rb = *link; \
-		if (x < expr(rb_entry(rb, struct drm_mm_node, member))) \
-			link = &rb->rb_left; \
-		else \
-			link = &rb->rb_right; \
-	} \
-	rb_link_node(&node->member, rb, link); \
-	rb_insert_color(&node->member, &root); \
-} while (0)
-
 #define HOLE_SIZE(NODE) ((NODE)->hole_size)
 #define HOLE_ADDR(NODE) (__drm_mm_hole_node_start(NODE))
 
+static inline u64 rb_hole_addr_max(struct rb_node *rb)
+{
+	return rb ?
+		rb_entry(rb, struct drm_mm_node, rb_hole_addr)->subtree_max_hole :
+		0;
+}
+
+/*
+ * The address ordered hole tree is augmented with the size of the largest
+ * hole in each subtree, letting the bottom-up and top-down searches skip
+ * whole subtrees of holes too small for the request.
+ */
+static inline u64 compute_subtree_max_hole(struct drm_mm_node *node)
+{
+	return max3(node->hole_size,
+		    rb_hole_addr_max(node->rb_hole_addr.rb_left),
+		    rb_hole_addr_max(node->rb_hole_addr.rb_right));
+}
+
+RB_DECLARE_CALLBACKS(static, augment_callbacks,
+		     struct drm_mm_node, rb_hole_addr,
+		     u64, subtree_max_hole, compute_subtree_max_hole)
+
+static void insert_hole_addr(struct rb_root *root, struct drm_mm_node *node)
+{
+	struct rb_node **link = &root->rb_node, *rb_parent = NULL;
+	u64 start = HOLE_ADDR(node), subtree_max_hole = node->subtree_max_hole;
+	struct drm_mm_node *parent;
+
+	while (*link) {
+		rb_parent = *link;
+		parent = rb_entry(rb_parent, struct drm_mm_node, rb_hole_addr);
+		if (parent->subtree_max_hole < subtree_max_hole)
+			parent->subtree_max_hole = subtree_max_hole;
+		if (start < HOLE_ADDR(parent))
+			link = &parent->rb_hole_addr.rb_left;
+		else
+			link = &parent->rb_hole_addr.rb_right;
+	}
+
+	rb_link_node(&node->rb_hole_addr, rb_parent, link);
+	rb_insert_augmented(&node->rb_hole_addr, root, &augment_callbacks);
+}
+
 static u64 rb_to_hole_size(struct rb_node *rb)
 {
 	return rb_entry(rb, struct drm_mm_node, rb_hole_size)->hole_size;
@@ -273,8 +304,10 @@ static void add_hole(struct drm_mm_node *node)
 		__drm_mm_hole_node_end(node) - __drm_mm_hole_node_start(node);
 	DRM_MM_BUG_ON(!drm_mm_hole_follows(node));
 
+	node->subtree_max_hole = node->hole_size;
+
 	insert_hole_size(&mm->holes_size, node);
-	RB_INSERT(mm->holes_addr, rb_hole_addr, HOLE_ADDR);
+	insert_hole_addr(&mm->holes_addr, node);
 
 	list_add(&node->hole_stack, &mm->hole_stack);
 }
@@ -285,8 +318,10 @@ static void rm_hole(struct drm_mm_node *node)
 
 	list_del(&node->hole_stack);
 	rb_erase_cached(&node->rb_hole_size, &node->mm->holes_size);
-	rb_erase(&node->rb_hole_addr, &node->mm->holes_addr);
+	rb_erase_augmented(&node->rb_hole_addr, &node->mm->holes_addr,
+			   &augment_callbacks);
 	node->hole_size = 0;
+	node->subtree_max_hole = 0;
 
 	DRM_MM_BUG_ON(drm_mm_hole_follows(node));
 }
@@ -348,6 +383,68 @@ static struct drm_mm_node *find_hole(struct drm_mm *mm, u64 addr)
 	return node;
 }
 
+static inline bool usable_hole_addr(struct rb_node *rb, u64 size)
+{
+	return rb && rb_hole_addr_max(rb) >= size;
+}
+
+/*
+ * As find_hole(), but without descending into subtrees with no hole of at
+ * least @size. The hole returned may itself be too small, the caller's
+ * checks and next_hole() take care of that.
+ */
+static struct drm_mm_node *find_hole_addr(struct drm_mm *mm, u64 addr, u64 size)
+{
+	struct rb_node *rb = mm->holes_addr.rb_node;
+	struct drm_mm_node *node = NULL;
+
+	while (rb) {
+		u64 hole_start;
+
+		if (!usable_hole_addr(rb, size))
+			break;
+
+		node = rb_hole_addr_to_node(rb);
+		hole_start = __drm_mm_hole_node_start(node);
+
+		if (addr < hole_start)
+			rb = node->rb_hole_addr.rb_left;
+		else if (addr > hole_start + node->hole_size)
+			rb = node->rb_hole_addr.rb_right;
+		else
+			break;
+	}
+
+	return node;
+}
+
+/*
+ * Step to the neighbouring hole in address order, skipping subtrees that
+ * cannot hold @size. Either the subtree on the @first side has a candidate,
+ * in which case we return its @last most usable hole, or we climb to the
+ * first ancestor on that side.
+ */
+#define DECLARE_NEXT_HOLE_ADDR(name, first, last)			\
+static struct drm_mm_node *name(struct drm_mm_node *entry, u64 size)	\
+{									\
+	struct rb_node *parent, *node = &entry->rb_hole_addr;		\
+									\
+	if (usable_hole_addr(node->first, size)) {			\
+		node = node->first;					\
+		while (usable_hole_addr(node->last, size))		\
+			node = node->last;				\
+		return rb_hole_addr_to_node(node);			\
+	}								\
+									\
+	while ((parent = rb_parent(node)) && node == parent->first)	\
+		node = parent;						\
+									\
+	return rb_hole_addr_to_node(parent);				\
+}
+
+DECLARE_NEXT_HOLE_ADDR(next_hole_high_addr, rb_left, rb_right)
+DECLARE_NEXT_HOLE_ADDR(next_hole_low_addr, rb_right, rb_left)
+
 static struct drm_mm_node *
 first_hole(struct drm_mm *mm,
 	   u64 start, u64 end, u64 size,
@@ -359,10 +456,10 @@ first_hole(struct drm_mm *mm,
 		return best_hole(mm, size);
 
 	case DRM_MM_INSERT_LOW:
-		return find_hole(mm, start);
+		return find_hole_addr(mm, start, size);
 
 	case DRM_MM_INSERT_HIGH:
-		return find_hole(mm, end);
+		return find_hole_addr(mm, end, size);
 
 	case DRM_MM_INSERT_EVICT:
 		return list_first_entry_or_null(&mm->hole_stack,
@@ -374,6 +471,7 @@ first_hole(struct drm_mm *mm,
 static struct drm_mm_node *
 next_hole(struct drm_mm *mm,
 	  struct drm_mm_node *node,
+	  u64 size,
 	  enum drm_mm_insert_mode mode)
 {
 	switch (mode) {
@@ -382,10 +480,10 @@ next_hole(struct drm_mm *mm,
 		return rb_hole_size_to_node(rb_prev(&node->rb_hole_size));
 
 	case DRM_MM_INSERT_LOW:
-		return rb_hole_addr_to_node(rb_next(&node->rb_hole_addr));
+		return next_hole_low_addr(node, size);
 
 	case DRM_MM_INSERT_HIGH:
-		return rb_hole_addr_to_node(rb_prev(&node->rb_hole_addr));
+		return next_hole_high_addr(node, size);
 
 	case DRM_MM_INSERT_EVICT:
 		node = list_next_entry(node, hole_stack);
@@ -499,7 +597,7 @@ int drm_mm_insert_node_in_range(struct drm_mm * const mm,
 	remainder_mask = is_power_of_2(alignment) ? alignment - 1 : 0;
 	for (hole = first_hole(mm, range_start, range_end, size, mode);
 	     hole;
-	     hole = once ? NULL : next_hole(mm, hole, mode)) {
+	     hole = once ? NULL : next_hole(mm, hole, size, mode)) {
 		u64 hole_start = __drm_mm_hole_node_start(hole);
 		u64 hole_end = hole_start + hole->hole_size;
 		u64 adj_start, adj_end;
@@ -667,6 +765,12 @@ EXPORT_SYMBOL(drm_mm_replace_node);
  * O(scanned_objects). So like the free stack which needs to be walked before a
  * scan operation even begins this is linear in the number of objects. It
  * doesn't seem to hurt too badly.
+ *
+ * By default the scan stops at the first suitable hole, whatever the nodes in
+ * it cost to evict. Drivers with a notion of eviction cost can supply it with
+ * drm_mm_scan_set_cost(). The scan then keeps adding a bounded number of
+ * blocks after the first hit, and settles on the hole whose blocks are the
+ * cheapest to evict.
  */
 
 /**
@@ -717,44 +821,64 @@ void drm_mm_scan_init_with_range(struct drm_mm_scan *scan,
 
 	scan->hit_start = U64_MAX;
 	scan->hit_end = 0;
+	scan->hit_cost = U64_MAX;
+
+	scan->cost = NULL;
+	scan->budget = 0;
 }
 EXPORT_SYMBOL(drm_mm_scan_init_with_range);
 
 /**
- * drm_mm_scan_add_block - add a node to the scan list
- * @scan: the active drm_mm scanner
- * @node: drm_mm_node to add
- *
- * Add a node to the scan list that might be freed to make space for the desired
- * hole.
+ * drm_mm_scan_set_cost - make the scan prefer cheaply evicted holes
+ * @scan: scan state, just initialized
+ * @cost: returns the cost of evicting a node
+ * @budget: number of blocks to add after the first hit
  *
- * Returns:
- * True if a hole has been found, false otherwise.
+ * After the first suitable hole has been found, drm_mm_scan_add_block() keeps
+ * returning false for up to @budget more blocks, and whenever one of them
+ * completes a hole whose overlapping nodes have a lower total @cost it
+ * becomes the target instead. A hole that costs nothing ends the search
+ * early. Once the caller runs out of blocks, it should check
+ * drm_mm_scan_found().
  */
-bool drm_mm_scan_add_block(struct drm_mm_scan *scan,
-			   struct drm_mm_node *node)
+void drm_mm_scan_set_cost(struct drm_mm_scan *scan,
+			  u64 (*cost)(const struct drm_mm_node *node),
+			  unsigned int budget)
+{
+	DRM_MM_BUG_ON(scan->mm->scan_active);
+
+	scan->cost = cost;
+	scan->budget = budget;
+}
+EXPORT_SYMBOL(drm_mm_scan_set_cost);
+
+static u64 scan_hit_cost(struct drm_mm_scan *scan, u64 start)
+{
+	u64 last = start + scan->size - 1;
+	struct drm_mm_node *node;
+	u64 cost = 0;
+
+	/* Only scanned blocks can overlap a hole found by the scan */
+	for (node = drm_mm_interval_tree_iter_first(&scan->mm->interval_tree,
+						    start, last);
+	     node;
+	     node = drm_mm_interval_tree_iter_next(node, start, last)) {
+		DRM_MM_BUG_ON(!node->scanned_block);
+		cost += scan->cost(node);
+	}
+
+	return cost;
+}
+
+static bool scan_find_hit(struct drm_mm_scan *scan,
+			  struct drm_mm_node *hole,
+			  u64 *hit_start)
 {
 	struct drm_mm *mm = scan->mm;
-	struct drm_mm_node *hole;
 	u64 hole_start, hole_end;
 	u64 col_start, col_end;
 	u64 adj_start, adj_end;
 
-	DRM_MM_BUG_ON(node->mm != mm);
-	DRM_MM_BUG_ON(!node->allocated);
-	DRM_MM_BUG_ON(node->scanned_block);
-	node->scanned_block = true;
-	mm->scan_active++;
-
-	/* Remove this block from the node_list so that we enlarge the hole
-	 * (distance between the end of our previous node and the start of
-	 * or next), without poisoning the link so that we can restore it
-	 * later in drm_mm_scan_remove_block().
-	 */
-	hole = list_prev_entry(node, node_list);
-	DRM_MM_BUG_ON(list_next_entry(hole, node_list) != node);
-	__list_del_entry(&node->node_list);
-
 	hole_start = __drm_mm_hole_node_start(hole);
 	hole_end = __drm_mm_hole_node_end(hole);
 
@@ -792,15 +916,76 @@ bool drm_mm_scan_add_block(struct drm_mm_scan *scan,
 		}
 	}
 
-	scan->hit_start = adj_start;
-	scan->hit_end = adj_start + scan->size;
-
-	DRM_MM_BUG_ON(scan->hit_start >= scan->hit_end);
-	DRM_MM_BUG_ON(scan->hit_start < hole_start);
-	DRM_MM_BUG_ON(scan->hit_end > hole_end);
+	DRM_MM_BUG_ON(adj_start < hole_start);
+	DRM_MM_BUG_ON(adj_start + scan->size > hole_end);
 
+	*hit_start = adj_start;
 	return true;
 }
+
+/**
+ * drm_mm_scan_add_block - add a node to the scan list
+ * @scan: the active drm_mm scanner
+ * @node: drm_mm_node to add
+ *
+ * Add a node to the scan list that might be freed to make space for the desired
+ * hole.
+ *
+ * Returns:
+ * True if a hole has been found, false otherwise. With a cost function set,
+ * true once the search is over, see drm_mm_scan_set_cost().
+ */
+bool drm_mm_scan_add_block(struct drm_mm_scan *scan,
+			   struct drm_mm_node *node)
+{
+	struct drm_mm *mm = scan->mm;
+	struct drm_mm_node *hole;
+	u64 hit_start, cost;
+
+	DRM_MM_BUG_ON(node->mm != mm);
+	DRM_MM_BUG_ON(!node->allocated);
+	DRM_MM_BUG_ON(node->scanned_block);
+	node->scanned_block = true;
+	mm->scan_active++;
+
+	/* Remove this block from the node_list so that we enlarge the hole
+	 * (distance between the end of our previous node and the start of
+	 * or next), without poisoning the link so that we can restore it
+	 * later in drm_mm_scan_remove_block().
+	 */
+	hole = list_prev_entry(node, node_list);
+	DRM_MM_BUG_ON(list_next_entry(hole, node_list) != node);
+	__list_del_entry(&node->node_list);
+
+	if (!scan->cost) {
+		if (!scan_find_hit(scan, hole, &hit_start))
+			return false;
+
+		scan->hit_start = hit_start;
+		scan->hit_end = hit_start + scan->size;
+		DRM_MM_BUG_ON(scan->hit_start >= scan->hit_end);
+		return true;
+	}
+
+	/*
+	 * Earlier hits remain valid as the scan only ever grows holes, so
+	 * just keep whichever one is cheapest to evict.
+	 */
+	if (scan_find_hit(scan, hole, &hit_start)) {
+		cost = scan_hit_cost(scan, hit_start);
+		if (cost < scan->hit_cost) {
+			scan->hit_start = hit_start;
+			scan->hit_end = hit_start + scan->size;
+			scan->hit_cost = cost;
+			DRM_MM_BUG_ON(scan->hit_start >= scan->hit_end);
+		}
+	}
+
+	if (!drm_mm_scan_found(scan))
+		return false;
+
+	return !scan->hit_cost || !scan->budget--;
+}
 EXPORT_SYMBOL(drm_mm_scan_add_block);
 
 /**
@@ -29,6 +29,7 @@
 #include <linux/export.h>
 #include <linux/dma-buf.h>
 #include <linux/rbtree.h>
+#include <linux/seq_file.h>
 #include <drm/drm_prime.h>
 #include <drm/drm_gem.h>
 #include <drm/drmP.h>
@@ -135,6 +136,7 @@ static int drm_prime_add_buf_handle(struct drm_prime_file_private *prime_fpriv,
 	rb_link_node(&member->handle_rb, rb, p);
 	rb_insert_color(&member->handle_rb, &prime_fpriv->handles);
 
+	prime_fpriv->count++;
 	return 0;
 }
 
@@ -265,6 +267,7 @@ void drm_prime_remove_buf_handle_locked(struct drm_prime_file_private *prime_fpr
 		if (member->dma_buf == dma_buf) {
 			rb_erase(&member->handle_rb, &prime_fpriv->handles);
 			rb_erase(&member->dmabuf_rb, &prime_fpriv->dmabufs);
+			prime_fpriv->count--;
 
 			dma_buf_put(dma_buf);
 			kfree(member);
@@ -277,6 +280,70 @@ void drm_prime_remove_buf_handle_locked(struct drm_prime_file_private *prime_fpr
 	}
 }
 
+/*
+ * Remember an imported object whose last handle in this file is going away.
+ * The cache holds a reference on the object, which keeps it attached to the
+ * dma-buf, and the oldest entry is dropped once the cache is full.
+ */
+void drm_prime_cache_import_locked(struct drm_prime_file_private *prime_fpriv,
+				   struct drm_gem_object *obj)
+{
+	struct drm_gem_object **slot;
+	int i;
+
+	for (i = 0; i < DRM_PRIME_IMPORT_CACHE_SIZE; i++)
+		if (prime_fpriv->import_cache[i] == obj)
+			return;
+
+	slot = &prime_fpriv->import_cache[prime_fpriv->import_cache_next];
+	prime_fpriv->import_cache_next =
+		(prime_fpriv->import_cache_next + 1) % DRM_PRIME_IMPORT_CACHE_SIZE;
+
+	if (*slot)
+		drm_gem_object_put_unlocked(*slot);
+	drm_gem_object_get(obj);
+	*slot = obj;
+}
+
+/*
+ * Drop every cached import, and with it the reference on the exporter's
+ * dma-buf. Called once the file's handles are all closed so that the
+ * exported buffers are not kept alive until the file itself is freed.
+ */
+void drm_prime_release_import_cache(struct drm_prime_file_private *prime_fpriv)
+{
+	int i;
+
+	mutex_lock(&prime_fpriv->lock);
+	for (i = 0; i < DRM_PRIME_IMPORT_CACHE_SIZE; i++) {
+		if (prime_fpriv->import_cache[i]) {
+			drm_gem_object_put_unlocked(prime_fpriv->import_cache[i]);
+			prime_fpriv->import_cache[i] = NULL;
+		}
+	}
+	prime_fpriv->import_cache_next = 0;
+	mutex_unlock(&prime_fpriv->lock);
+}
+
+static struct drm_gem_object *
+drm_prime_lookup_import_cache(struct drm_prime_file_private *prime_fpriv,
+			      struct dma_buf *dma_buf)
+{
+	int i;
+
+	for (i = 0; i < DRM_PRIME_IMPORT_CACHE_SIZE; i++) {
+		struct drm_gem_object *obj = prime_fpriv->import_cache[i];
+
+		if (obj && obj->import_attach->dmabuf == dma_buf) {
+			/* hand our reference over to the caller */
+			prime_fpriv->import_cache[i] = NULL;
+			return obj;
+		}
+	}
+
+	return NULL;
+}
+
 /**
  * drm_gem_map_dma_buf - map_dma_buf implementation for GEM
  * @attach: attachment whose scatterlist is to be returned
@@ -664,6 +731,7 @@ int drm_gem_prime_handle_to_fd(struct drm_device *dev,
 		*prime_fd = ret;
 		ret = 0;
 	}
+	file_priv->prime.exports++;
 
 	goto out;
 
@@ -787,15 +855,24 @@ int drm_gem_prime_fd_to_handle(struct drm_device *dev,
 
 	ret = drm_prime_lookup_buf_handle(&file_priv->prime,
 			dma_buf, handle);
-	if (ret == 0)
+	if (ret == 0) {
+		file_priv->prime.import_hits++;
 		goto out_put;
+	}
 
-	/* never seen this one, need to import */
 	mutex_lock(&dev->object_name_lock);
-	obj = dev->driver->gem_prime_import(dev, dma_buf);
-	if (IS_ERR(obj)) {
-		ret = PTR_ERR(obj);
-		goto out_unlock;
+	/* imported before and closed since, reuse the existing attachment */
+	obj = drm_prime_lookup_import_cache(&file_priv->prime, dma_buf);
+	if (obj) {
+		file_priv->prime.import_cache_hits++;
+	} else {
+		/* never seen this one, need to import */
+		obj = dev->driver->gem_prime_import(dev, dma_buf);
+		if (IS_ERR(obj)) {
+			ret = PTR_ERR(obj);
+			goto out_unlock;
+		}
+		file_priv->prime.imports++;
 	}
 
 	if (obj->dma_buf) {
@@ -980,4 +1057,40 @@ void drm_prime_destroy_file_private(struct drm_prime_file_private *prime_fpriv)
 {
 	/* by now drm_gem_release should've made sure the list is empty */
 	WARN_ON(!RB_EMPTY_ROOT(&prime_fpriv->dmabufs));
+	WARN_ON(memchr_inv(prime_fpriv->import_cache, 0,
+			   sizeof(prime_fpriv->import_cache)));
+}
+
+int drm_prime_info(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct drm_file *file;
+
+	seq_printf(m, "%20s %5s %8s %10s %10s %10s %10s\n",
+		   "command", "pid", "handles",
+		   "imports", "hits", "cached", "exports");
+
+	mutex_lock(&dev->filelist_mutex);
+	list_for_each_entry_reverse(file, &dev->filelist, lhead) {
+		struct drm_prime_file_private *prime = &file->prime;
+		struct task_struct *task;
+
+		mutex_lock(&prime->lock);
+		rcu_read_lock(); /* locks pid_task()->comm */
+		task = pid_task(file->pid, PIDTYPE_PID);
+		seq_printf(m, "%20s %5d %8u %10llu %10llu %10llu %10llu\n",
+			   task ? task->comm : "<unknown>",
+			   pid_vnr(file->pid),
+			   prime->count,
+			   prime->imports,
+			   prime->import_hits,
+			   prime->import_cache_hits,
+			   prime->exports);
+		rcu_read_unlock();
+		mutex_unlock(&prime->lock);
+	}
+	mutex_unlock(&dev->filelist_mutex);
+
+	return 0;
 }
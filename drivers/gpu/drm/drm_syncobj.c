@@ -36,6 +36,13 @@
  * syncobj's can be waited upon, where it will wait for the underlying
  * fence.
  *
+ * A syncobj can also be used as a timeline: every new point is added through
+ * drm_syncobj_add_point() as a &dma_fence_chain node wrapping the fence for
+ * that point. Waiting on a point then waits on the first node of the chain
+ * at or beyond it, and the latest signaled point can be queried without
+ * creating a syncobj per submission. Point 0 addresses the whole syncobj,
+ * so binary waits and signals keep working on timeline syncobjs.
+ *
  * syncobj's can be export to fd's and back, these fd's are opaque and
  * have no other use case, except passing the syncobj between processes.
  *
@@ -48,6 +55,7 @@
 
 #include <drm/drmP.h>
 #include <linux/file.h>
+#include <linux/dma-fence-chain.h>
 #include <linux/fs.h>
 #include <linux/anon_inodes.h>
 #include <linux/sync_file.h>
@@ -82,6 +90,46 @@ struct drm_syncobj *drm_syncobj_find(struct drm_file *file_private,
 }
 EXPORT_SYMBOL(drm_syncobj_find);
 
+/**
+ * drm_syncobj_find_array - lookup and reference several sync objects
+ * @file_private: drm file private pointer
+ * @handles: sync object handles to lookup
+ * @count: number of handles
+ * @syncobjs: returns a reference to the syncobj of each handle
+ *
+ * Like drm_syncobj_find(), but takes the file's table lock only once for all
+ * of @handles. The lock is held throughout, so @count should be kept small.
+ *
+ * Returns 0 on success, or -ENOENT if any of the handles is invalid, in which
+ * case no reference is returned. The references must be released by calling
+ * drm_syncobj_put().
+ */
+int drm_syncobj_find_array(struct drm_file *file_private,
+			   const u32 *handles, unsigned int count,
+			   struct drm_syncobj **syncobjs)
+{
+	unsigned int i;
+
+	spin_lock(&file_private->syncobj_table_lock);
+	for (i = 0; i < count; i++) {
+		syncobjs[i] = idr_find(&file_private->syncobj_idr, handles[i]);
+		if (!syncobjs[i])
+			break;
+
+		drm_syncobj_get(syncobjs[i]);
+	}
+	spin_unlock(&file_private->syncobj_table_lock);
+
+	if (i < count) {
+		while (i--)
+			drm_syncobj_put(syncobjs[i]);
+		return -ENOENT;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(drm_syncobj_find_array);
+
 static void drm_syncobj_add_callback_locked(struct drm_syncobj *syncobj,
 					    struct drm_syncobj_cb *cb,
 					    drm_syncobj_func_t func)
@@ -90,15 +138,54 @@ static void drm_syncobj_add_callback_locked(struct drm_syncobj *syncobj,
 	list_add_tail(&cb->node, &syncobj->cb_list);
 }
 
+static void drm_syncobj_signal_callbacks_locked(struct drm_syncobj *syncobj)
+{
+	struct drm_syncobj_cb *cur, *tmp;
+	LIST_HEAD(list);
+
+	/* Callbacks may re-arm themselves onto cb_list, e.g. when waiting for
+	 * a timeline point that has not been submitted yet, so walk a private
+	 * copy of the list.
+	 */
+	list_splice_init(&syncobj->cb_list, &list);
+	list_for_each_entry_safe(cur, tmp, &list, node) {
+		list_del_init(&cur->node);
+		cur->func(syncobj, cur);
+	}
+}
+
+/*
+ * Look up the fence for @point, with the caller owning the reference in
+ * *@fence. On success *@fence is non-NULL; a point that has already been
+ * garbage collected from the timeline is represented by the stub fence.
+ */
+static int drm_syncobj_find_point(struct dma_fence **fence, u64 point)
+{
+	if (!*fence)
+		return -EINVAL;
+
+	if (dma_fence_chain_find_seqno(fence, point)) {
+		dma_fence_put(*fence);
+		*fence = NULL;
+		return -EINVAL;
+	}
+
+	if (!*fence)
+		*fence = dma_fence_get_stub();
+
+	return 0;
+}
+
 static int drm_syncobj_fence_get_or_add_callback(struct drm_syncobj *syncobj,
 						 struct dma_fence **fence,
+						 u64 point,
 						 struct drm_syncobj_cb *cb,
 						 drm_syncobj_func_t func)
 {
 	int ret;
 
 	*fence = drm_syncobj_fence_get(syncobj);
-	if (*fence)
+	if (!drm_syncobj_find_point(fence, point))
 		return 1;
 
 	spin_lock(&syncobj->lock);
@@ -106,12 +193,11 @@ static int drm_syncobj_fence_get_or_add_callback(struct drm_syncobj *syncobj,
 	 * have the lock, try one more time just to be sure we don't add a
 	 * callback when a fence has already been set.
 	 */
-	if (syncobj->fence) {
-		*fence = dma_fence_get(rcu_dereference_protected(syncobj->fence,
-								 lockdep_is_held(&syncobj->lock)));
+	*fence = dma_fence_get(rcu_dereference_protected(syncobj->fence,
+							 lockdep_is_held(&syncobj->lock)));
+	if (!drm_syncobj_find_point(fence, point)) {
 		ret = 1;
 	} else {
-		*fence = NULL;
 		drm_syncobj_add_callback_locked(syncobj, cb, func);
 		ret = 0;
 	}
@@ -152,6 +238,48 @@ void drm_syncobj_remove_callback(struct drm_syncobj *syncobj,
 }
 EXPORT_SYMBOL(drm_syncobj_remove_callback);
 
+/**
+ * drm_syncobj_add_point - add new timeline point to the syncobj
+ * @syncobj: sync object to add timeline point do
+ * @chain: chain node to use to add the point
+ * @fence: fence to encapsulate in the chain node
+ * @point: sequence number to use for the point
+ *
+ * Add the chain node as new timeline point to the syncobj. The syncobj takes
+ * ownership of @chain, which must have been allocated with kmalloc() or
+ * kzalloc() and is freed once the point is no longer referenced.
+ */
+void drm_syncobj_add_point(struct drm_syncobj *syncobj,
+			   struct dma_fence_chain *chain,
+			   struct dma_fence *fence,
+			   uint64_t point)
+{
+	struct dma_fence *prev;
+
+	dma_fence_get(fence);
+
+	spin_lock(&syncobj->lock);
+
+	prev = dma_fence_get(rcu_dereference_protected(syncobj->fence,
+						       lockdep_is_held(&syncobj->lock)));
+
+	/* Points must be added in order, otherwise the query can go backwards */
+	if (prev && dma_fence_chain_seqno(prev) >= point)
+		DRM_DEBUG("You are adding an unordered point to timeline!\n");
+
+	dma_fence_chain_init(chain, prev, fence, point);
+	rcu_assign_pointer(syncobj->fence, &chain->base);
+
+	drm_syncobj_signal_callbacks_locked(syncobj);
+
+	spin_unlock(&syncobj->lock);
+
+	/* Walk the chain once to trigger garbage collection */
+	dma_fence_chain_for_each(fence, prev);
+	dma_fence_put(prev);
+}
+EXPORT_SYMBOL(drm_syncobj_add_point);
+
 /**
  * drm_syncobj_replace_fence - replace fence in a sync object.
  * @syncobj: Sync object to replace fence in
@@ -163,7 +291,6 @@ void drm_syncobj_replace_fence(struct drm_syncobj *syncobj,
 			       struct dma_fence *fence)
 {
 	struct dma_fence *old_fence;
-	struct drm_syncobj_cb *cur, *tmp;
 
 	if (fence)
 		dma_fence_get(fence);
@@ -174,12 +301,8 @@ void drm_syncobj_replace_fence(struct drm_syncobj *syncobj,
 					      lockdep_is_held(&syncobj->lock));
 	rcu_assign_pointer(syncobj->fence, fence);
 
-	if (fence != old_fence) {
-		list_for_each_entry_safe(cur, tmp, &syncobj->cb_list, node) {
-			list_del_init(&cur->node);
-			cur->func(syncobj, cur);
-		}
-	}
+	if (fence != old_fence)
+		drm_syncobj_signal_callbacks_locked(syncobj);
 
 	spin_unlock(&syncobj->lock);
 
@@ -261,6 +384,27 @@ int drm_syncobj_find_fence(struct drm_file *file_private,
 }
 EXPORT_SYMBOL(drm_syncobj_find_fence);
 
+/*
+ * As drm_syncobj_find_fence(), but for the fence of timeline @point, which
+ * must already have been submitted. Point 0 is the syncobj's current fence.
+ */
+static int drm_syncobj_find_fence_point(struct drm_file *file_private,
+					u32 handle, u64 point,
+					struct dma_fence **fence)
+{
+	struct drm_syncobj *syncobj = drm_syncobj_find(file_private, handle);
+	int ret;
+
+	if (!syncobj)
+		return -ENOENT;
+
+	*fence = drm_syncobj_fence_get(syncobj);
+	ret = drm_syncobj_find_point(fence, point);
+	drm_syncobj_put(syncobj);
+
+	return ret;
+}
+
 /**
  * drm_syncobj_free - free a sync object.
  * @kref: kref to free.
@@ -660,6 +804,7 @@ struct syncobj_wait_entry {
 	struct dma_fence *fence;
 	struct dma_fence_cb fence_cb;
 	struct drm_syncobj_cb syncobj_cb;
+	u64 point;
 };
 
 static void syncobj_wait_fence_func(struct dma_fence *fence,
@@ -676,14 +821,24 @@ static void syncobj_wait_syncobj_func(struct drm_syncobj *syncobj,
 {
 	struct syncobj_wait_entry *wait =
 		container_of(cb, struct syncobj_wait_entry, syncobj_cb);
+	struct dma_fence *fence;
 
 	/* This happens inside the syncobj lock */
-	wait->fence = dma_fence_get(rcu_dereference_protected(syncobj->fence,
-							      lockdep_is_held(&syncobj->lock)));
+	fence = dma_fence_get(rcu_dereference_protected(syncobj->fence,
+							lockdep_is_held(&syncobj->lock)));
+	if (drm_syncobj_find_point(&fence, wait->point)) {
+		/* The point has not been submitted yet, keep waiting for it */
+		drm_syncobj_add_callback_locked(syncobj, cb,
+						syncobj_wait_syncobj_func);
+		return;
+	}
+
+	wait->fence = fence;
 	wake_up_process(wait->task);
 }
 
 static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
+						  const u64 *points,
 						  uint32_t count,
 						  uint32_t flags,
 						  signed long timeout,
@@ -706,8 +861,10 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 	signaled_count = 0;
 	for (i = 0; i < count; ++i) {
 		entries[i].task = current;
+		entries[i].point = points ? points[i] : 0;
 		entries[i].fence = drm_syncobj_fence_get(syncobjs[i]);
-		if (!entries[i].fence) {
+		if (drm_syncobj_find_point(&entries[i].fence,
+					   entries[i].point)) {
 			if (flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT) {
 				continue;
 			} else {
@@ -743,8 +900,12 @@ static signed long drm_syncobj_array_wait_timeout(struct drm_syncobj **syncobjs,
 
 	if (flags & DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT) {
 		for (i = 0; i < count; ++i) {
+			if (entries[i].fence)
+				continue;
+
 			drm_syncobj_fence_get_or_add_callback(syncobjs[i],
 							      &entries[i].fence,
+							      entries[i].point,
 							      &entries[i].syncobj_cb,
 							      syncobj_wait_syncobj_func);
 		}
@@ -845,25 +1006,61 @@ static signed long drm_timeout_abs_to_jiffies(int64_t timeout_nsec)
 static int drm_syncobj_array_wait(struct drm_device *dev,
 				  struct drm_file *file_private,
 				  struct drm_syncobj_wait *wait,
-				  struct drm_syncobj **syncobjs)
+				  struct drm_syncobj_timeline_wait *timeline_wait,
+				  struct drm_syncobj **syncobjs,
+				  const u64 *points)
 {
-	signed long timeout = drm_timeout_abs_to_jiffies(wait->timeout_nsec);
+	signed long timeout = 0;
 	signed long ret = 0;
 	uint32_t first = ~0;
 
-	ret = drm_syncobj_array_wait_timeout(syncobjs,
-					     wait->count_handles,
-					     wait->flags,
-					     timeout, &first);
-	if (ret < 0)
-		return ret;
+	if (!timeline_wait) {
+		timeout = drm_timeout_abs_to_jiffies(wait->timeout_nsec);
+		ret = drm_syncobj_array_wait_timeout(syncobjs,
+						     NULL,
+						     wait->count_handles,
+						     wait->flags,
+						     timeout, &first);
+		if (ret < 0)
+			return ret;
+		wait->first_signaled = first;
+	} else {
+		timeout = drm_timeout_abs_to_jiffies(timeline_wait->timeout_nsec);
+		ret = drm_syncobj_array_wait_timeout(syncobjs,
+						     points,
+						     timeline_wait->count_handles,
+						     timeline_wait->flags,
+						     timeout, &first);
+		if (ret < 0)
+			return ret;
+		timeline_wait->first_signaled = first;
+	}
 
-	wait->first_signaled = first;
 	if (ret == 0)
 		return -ETIME;
 	return 0;
 }
 
+static int drm_syncobj_array_points(void __user *user_points,
+				    uint32_t count_handles,
+				    u64 **points_out)
+{
+	u64 *points;
+
+	points = kmalloc_array(count_handles, sizeof(*points), GFP_KERNEL);
+	if (!points)
+		return -ENOMEM;
+
+	if (copy_from_user(points, user_points,
+			   sizeof(u64) * count_handles)) {
+		kfree(points);
+		return -EFAULT;
+	}
+
+	*points_out = points;
+	return 0;
+}
+
 static int drm_syncobj_array_find(struct drm_file *file_private,
 				  void __user *user_handles,
 				  uint32_t count_handles,
@@ -946,13 +1143,58 @@ drm_syncobj_wait_ioctl(struct drm_device *dev, void *data,
 		return ret;
 
 	ret = drm_syncobj_array_wait(dev, file_private,
-				     args, syncobjs);
+				     args, NULL, syncobjs, NULL);
 
 	drm_syncobj_array_free(syncobjs, args->count_handles);
 
 	return ret;
 }
 
+int
+drm_syncobj_timeline_wait_ioctl(struct drm_device *dev, void *data,
+				struct drm_file *file_private)
+{
+	struct drm_syncobj_timeline_wait *args = data;
+	struct drm_syncobj **syncobjs;
+	u64 *points;
+	int ret = 0;
+
+	if (!drm_core_check_feature(dev, DRIVER_SYNCOBJ))
+		return -ENODEV;
+
+	if (args->flags & ~(DRM_SYNCOBJ_WAIT_FLAGS_WAIT_ALL |
+			    DRM_SYNCOBJ_WAIT_FLAGS_WAIT_FOR_SUBMIT))
+		return -EINVAL;
+
+	if (args->pad != 0)
+		return -EINVAL;
+
+	if (args->count_handles == 0)
+		return -EINVAL;
+
+	ret = drm_syncobj_array_points(u64_to_user_ptr(args->points),
+				       args->count_handles,
+				       &points);
+	if (ret < 0)
+		return ret;
+
+	ret = drm_syncobj_array_find(file_private,
+				     u64_to_user_ptr(args->handles),
+				     args->count_handles,
+				     &syncobjs);
+	if (ret < 0)
+		goto err_free_points;
+
+	ret = drm_syncobj_array_wait(dev, file_private,
+				     NULL, args, syncobjs, points);
+
+	drm_syncobj_array_free(syncobjs, args->count_handles);
+err_free_points:
+	kfree(points);
+
+	return ret;
+}
+
 int
 drm_syncobj_reset_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_private)
@@ -1021,3 +1263,233 @@ drm_syncobj_signal_ioctl(struct drm_device *dev, void *data,
 
 	return ret;
 }
+
+static int drm_syncobj_transfer_to_timeline(struct drm_file *file_private,
+					    struct drm_syncobj_transfer *args)
+{
+	struct drm_syncobj *timeline_syncobj;
+	struct dma_fence_chain *chain;
+	struct dma_fence *fence;
+	int ret;
+
+	timeline_syncobj = drm_syncobj_find(file_private, args->dst_handle);
+	if (!timeline_syncobj)
+		return -ENOENT;
+
+	ret = drm_syncobj_find_fence_point(file_private, args->src_handle,
+					   args->src_point, &fence);
+	if (ret)
+		goto err;
+
+	chain = kzalloc(sizeof(*chain), GFP_KERNEL);
+	if (!chain) {
+		ret = -ENOMEM;
+		goto err_fence;
+	}
+
+	drm_syncobj_add_point(timeline_syncobj, chain, fence, args->dst_point);
+err_fence:
+	dma_fence_put(fence);
+err:
+	drm_syncobj_put(timeline_syncobj);
+
+	return ret;
+}
+
+static int drm_syncobj_transfer_to_binary(struct drm_file *file_private,
+					  struct drm_syncobj_transfer *args)
+{
+	struct drm_syncobj *binary_syncobj;
+	struct dma_fence *fence;
+	int ret;
+
+	binary_syncobj = drm_syncobj_find(file_private, args->dst_handle);
+	if (!binary_syncobj)
+		return -ENOENT;
+
+	ret = drm_syncobj_find_fence_point(file_private, args->src_handle,
+					   args->src_point, &fence);
+	if (ret)
+		goto err;
+
+	drm_syncobj_replace_fence(binary_syncobj, fence);
+	dma_fence_put(fence);
+err:
+	drm_syncobj_put(binary_syncobj);
+
+	return ret;
+}
+
+int
+drm_syncobj_transfer_ioctl(struct drm_device *dev, void *data,
+			   struct drm_file *file_private)
+{
+	struct drm_syncobj_transfer *args = data;
+
+	if (!drm_core_check_feature(dev, DRIVER_SYNCOBJ))
+		return -ENODEV;
+
+	/* Waiting for the source point to be submitted is not supported */
+	if (args->flags != 0 || args->pad != 0)
+		return -EINVAL;
+
+	if (args->dst_point)
+		return drm_syncobj_transfer_to_timeline(file_private, args);
+
+	return drm_syncobj_transfer_to_binary(file_private, args);
+}
+
+int
+drm_syncobj_timeline_signal_ioctl(struct drm_device *dev, void *data,
+				  struct drm_file *file_private)
+{
+	struct drm_syncobj_timeline_array *args = data;
+	struct drm_syncobj **syncobjs;
+	struct dma_fence_chain **chains;
+	u64 *points;
+	uint32_t i, j;
+	int ret;
+
+	if (!drm_core_check_feature(dev, DRIVER_SYNCOBJ))
+		return -ENODEV;
+
+	if (args->flags != 0)
+		return -EINVAL;
+
+	if (args->count_handles == 0)
+		return -EINVAL;
+
+	ret = drm_syncobj_array_points(u64_to_user_ptr(args->points),
+				       args->count_handles,
+				       &points);
+	if (ret < 0)
+		return ret;
+
+	ret = drm_syncobj_array_find(file_private,
+				     u64_to_user_ptr(args->handles),
+				     args->count_handles,
+				     &syncobjs);
+	if (ret < 0)
+		goto err_free_points;
+
+	/* Allocate every node up front so that we either signal all points
+	 * or none of them.
+	 */
+	chains = kmalloc_array(args->count_handles, sizeof(*chains),
+			       GFP_KERNEL);
+	if (!chains) {
+		ret = -ENOMEM;
+		goto err_free_syncobjs;
+	}
+
+	for (i = 0; i < args->count_handles; i++) {
+		chains[i] = kzalloc(sizeof(*chains[i]), GFP_KERNEL);
+		if (!chains[i]) {
+			for (j = 0; j < i; j++)
+				kfree(chains[j]);
+			ret = -ENOMEM;
+			goto err_free_chains;
+		}
+	}
+
+	for (i = 0; i < args->count_handles; i++) {
+		struct dma_fence *fence = dma_fence_get_stub();
+
+		if (points[i]) {
+			drm_syncobj_add_point(syncobjs[i], chains[i],
+					      fence, points[i]);
+		} else {
+			/* Point 0 signals the syncobj as a binary one */
+			drm_syncobj_replace_fence(syncobjs[i], fence);
+			kfree(chains[i]);
+		}
+
+		dma_fence_put(fence);
+	}
+
+err_free_chains:
+	kfree(chains);
+err_free_syncobjs:
+	drm_syncobj_array_free(syncobjs, args->count_handles);
+err_free_points:
+	kfree(points);
+
+	return ret;
+}
+
+/*
+ * The latest signaled point of a timeline: garbage collection has already
+ * dropped every signaled node behind the first unsignaled one, so walking
+ * the chain ends on the oldest pending node (or a signaled tail).
+ */
+static u64 drm_syncobj_query_point(struct dma_fence *fence)
+{
+	struct dma_fence *iter, *last = NULL;
+	u64 point;
+
+	if (!to_dma_fence_chain(fence))
+		return 0;
+
+	dma_fence_chain_for_each(iter, fence) {
+		if (iter->context != fence->context ||
+		    !to_dma_fence_chain(iter)) {
+			/* Most likely the timeline has unordered points */
+			dma_fence_put(iter);
+			break;
+		}
+		dma_fence_put(last);
+		last = dma_fence_get(iter);
+	}
+
+	point = dma_fence_is_signaled(last) ?
+		to_dma_fence_chain(last)->seqno :
+		to_dma_fence_chain(last)->prev_seqno;
+	dma_fence_put(last);
+
+	return point;
+}
+
+int
+drm_syncobj_query_ioctl(struct drm_device *dev, void *data,
+			struct drm_file *file_private)
+{
+	struct drm_syncobj_timeline_array *args = data;
+	struct drm_syncobj **syncobjs;
+	u64 __user *points = u64_to_user_ptr(args->points);
+	uint32_t i;
+	int ret;
+
+	if (!drm_core_check_feature(dev, DRIVER_SYNCOBJ))
+		return -ENODEV;
+
+	if (args->flags != 0)
+		return -EINVAL;
+
+	if (args->count_handles == 0)
+		return -EINVAL;
+
+	ret = drm_syncobj_array_find(file_private,
+				     u64_to_user_ptr(args->handles),
+				     args->count_handles,
+				     &syncobjs);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < args->count_handles; i++) {
+		struct dma_fence *fence;
+		u64 point;
+
+		fence = drm_syncobj_fence_get(syncobjs[i]);
+		point = fence ? drm_syncobj_query_point(fence) : 0;
+		dma_fence_put(fence);
+
+		ret = copy_to_user(&points[i], &point, sizeof(u64));
+		ret = ret ? -EFAULT : 0;
+		if (ret)
+			break;
+	}
+
+	drm_syncobj_array_free(syncobjs, args->count_handles);
+
+	return ret;
+}
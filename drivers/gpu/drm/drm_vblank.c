@@ -95,7 +95,7 @@ static void store_vblank(struct drm_device *dev, unsigned int pipe,
 {
 	struct drm_vblank_crtc *vblank = &dev->vblank[pipe];
 
-	assert_spin_locked(&dev->vblank_time_lock);
+	assert_spin_locked(&vblank->time_lock);
 
 	vblank->last = last;
 
@@ -144,12 +144,13 @@ static u32 __get_vblank_counter(struct drm_device *dev, unsigned int pipe)
  */
 static void drm_reset_vblank_timestamp(struct drm_device *dev, unsigned int pipe)
 {
+	struct drm_vblank_crtc *vblank = &dev->vblank[pipe];
 	u32 cur_vblank;
 	bool rc;
 	ktime_t t_vblank;
 	int count = DRM_TIMESTAMP_MAXRETRIES;
 
-	spin_lock(&dev->vblank_time_lock);
+	spin_lock(&vblank->time_lock);
 
 	/*
 	 * sample the current counter to avoid random jumps
@@ -174,7 +175,7 @@ static void drm_reset_vblank_timestamp(struct drm_device *dev, unsigned int pipe
 	 */
 	store_vblank(dev, pipe, 1, t_vblank, cur_vblank);
 
-	spin_unlock(&dev->vblank_time_lock);
+	spin_unlock(&vblank->time_lock);
 }
 
 /*
@@ -299,18 +300,19 @@ u64 drm_crtc_accurate_vblank_count(struct drm_crtc *crtc)
 {
 	struct drm_device *dev = crtc->dev;
 	unsigned int pipe = drm_crtc_index(crtc);
+	spinlock_t *time_lock = &dev->vblank[pipe].time_lock;
 	u64 vblank;
 	unsigned long flags;
 
 	WARN_ONCE(drm_debug & DRM_UT_VBL && !dev->driver->get_vblank_timestamp,
 		  "This function requires support for accurate vblank timestamps.");
 
-	spin_lock_irqsave(&dev->vblank_time_lock, flags);
+	spin_lock_irqsave(time_lock, flags);
 
 	drm_update_vblank_count(dev, pipe, false);
 	vblank = drm_vblank_count(dev, pipe);
 
-	spin_unlock_irqrestore(&dev->vblank_time_lock, flags);
+	spin_unlock_irqrestore(time_lock, flags);
 
 	return vblank;
 }
@@ -350,7 +352,7 @@ void drm_vblank_disable_and_save(struct drm_device *dev, unsigned int pipe)
 	 * so no updates of timestamps or count can happen after we've
 	 * disabled. Needed to prevent races in case of delayed irq's.
 	 */
-	spin_lock_irqsave(&dev->vblank_time_lock, irqflags);
+	spin_lock_irqsave(&vblank->time_lock, irqflags);
 
 	/*
 	 * Update vblank count and disable vblank interrupts only if the
@@ -372,7 +374,7 @@ void drm_vblank_disable_and_save(struct drm_device *dev, unsigned int pipe)
 	vblank->enabled = false;
 
 out:
-	spin_unlock_irqrestore(&dev->vblank_time_lock, irqflags);
+	spin_unlock_irqrestore(&vblank->time_lock, irqflags);
 }
 
 static void vblank_disable_fn(struct timer_list *t)
@@ -430,7 +432,6 @@ int drm_vblank_init(struct drm_device *dev, unsigned int num_crtcs)
 	unsigned int i;
 
 	spin_lock_init(&dev->vbl_lock);
-	spin_lock_init(&dev->vblank_time_lock);
 
 	dev->num_crtcs = num_crtcs;
 
@@ -446,6 +447,8 @@ int drm_vblank_init(struct drm_device *dev, unsigned int num_crtcs)
 		init_waitqueue_head(&vblank->queue);
 		timer_setup(&vblank->disable_timer, vblank_disable_fn, 0);
 		seqlock_init(&vblank->seqlock);
+		spin_lock_init(&vblank->time_lock);
+		INIT_LIST_HEAD(&vblank->event_list);
 	}
 
 	DRM_INFO("Supports vblank timestamp caching Rev 2 (21.10.2013).\n");
@@ -886,7 +889,7 @@ void drm_crtc_arm_vblank_event(struct drm_crtc *crtc,
 
 	e->pipe = pipe;
 	e->sequence = drm_crtc_accurate_vblank_count(crtc) + 1;
-	list_add_tail(&e->base.link, &dev->vblank_event_list);
+	list_add_tail(&e->base.link, &dev->vblank[pipe].event_list);
 }
 EXPORT_SYMBOL(drm_crtc_arm_vblank_event);
 
@@ -943,11 +946,11 @@ static int drm_vblank_enable(struct drm_device *dev, unsigned int pipe)
 
 	assert_spin_locked(&dev->vbl_lock);
 
-	spin_lock(&dev->vblank_time_lock);
+	spin_lock(&vblank->time_lock);
 
 	if (!vblank->enabled) {
 		/*
-		 * Enable vblank irqs under vblank_time_lock protection.
+		 * Enable vblank irqs under time_lock protection.
 		 * All vblank count & timestamp updates are held off
 		 * until we are done reinitializing master counter and
 		 * timestamps. Filtercode in drm_handle_vblank() will
@@ -968,7 +971,7 @@ static int drm_vblank_enable(struct drm_device *dev, unsigned int pipe)
 		}
 	}
 
-	spin_unlock(&dev->vblank_time_lock);
+	spin_unlock(&vblank->time_lock);
 
 	return ret;
 }
@@ -1152,9 +1155,7 @@ void drm_crtc_vblank_off(struct drm_crtc *crtc)
 	/* Send any queued vblank events, lest the natives grow disquiet */
 	seq = drm_vblank_count_and_time(dev, pipe, &now);
 
-	list_for_each_entry_safe(e, t, &dev->vblank_event_list, base.link) {
-		if (e->pipe != pipe)
-			continue;
+	list_for_each_entry_safe(e, t, &vblank->event_list, base.link) {
 		DRM_DEBUG("Sending premature vblank event on disable: "
 			  "wanted %llu, current %llu\n",
 			  e->sequence, seq);
@@ -1200,7 +1201,7 @@ void drm_crtc_vblank_reset(struct drm_crtc *crtc)
 	}
 	spin_unlock_irqrestore(&dev->vbl_lock, irqflags);
 
-	WARN_ON(!list_empty(&dev->vblank_event_list));
+	WARN_ON(!list_empty(&vblank->event_list));
 }
 EXPORT_SYMBOL(drm_crtc_vblank_reset);
 
@@ -1271,10 +1272,10 @@ void drm_vblank_restore(struct drm_device *dev, unsigned int pipe)
 	if (WARN_ON(pipe >= dev->num_crtcs))
 		return;
 
+	vblank = &dev->vblank[pipe];
 	assert_spin_locked(&dev->vbl_lock);
-	assert_spin_locked(&dev->vblank_time_lock);
+	assert_spin_locked(&vblank->time_lock);
 
-	vblank = &dev->vblank[pipe];
 	WARN_ONCE((drm_debug & DRM_UT_VBL) && !vblank->framedur_ns,
 		  "Cannot compute missed vblanks without frame duration\n");
 	framedur_ns = vblank->framedur_ns;
@@ -1461,7 +1462,7 @@ static int drm_queue_vblank_event(struct drm_device *dev, unsigned int pipe,
 		vblwait->reply.sequence = seq;
 	} else {
 		/* drm_handle_vblank_events will call drm_vblank_put */
-		list_add_tail(&e->base.link, &dev->vblank_event_list);
+		list_add_tail(&e->base.link, &vblank->event_list);
 		vblwait->reply.sequence = req_seq;
 	}
 
@@ -1653,9 +1654,7 @@ static void drm_handle_vblank_events(struct drm_device *dev, unsigned int pipe)
 
 	seq = drm_vblank_count_and_time(dev, pipe, &now);
 
-	list_for_each_entry_safe(e, t, &dev->vblank_event_list, base.link) {
-		if (e->pipe != pipe)
-			continue;
+	list_for_each_entry_safe(e, t, &dev->vblank[pipe].event_list, base.link) {
 		if (!vblank_passed(seq, e->sequence))
 			continue;
 
@@ -1692,24 +1691,27 @@ bool drm_handle_vblank(struct drm_device *dev, unsigned int pipe)
 	if (WARN_ON(pipe >= dev->num_crtcs))
 		return false;
 
-	spin_lock_irqsave(&dev->event_lock, irqflags);
-
 	/* Need timestamp lock to prevent concurrent execution with
 	 * vblank enable/disable, as this would cause inconsistent
 	 * or corrupted timestamps and vblank counts.
+	 *
+	 * The count is updated before taking the event_lock: anyone
+	 * queueing an event under the event_lock either sees the new
+	 * count or has its event on the list by the time we walk it
+	 * below, so no event is missed and other pipes are not stalled
+	 * behind our counter update.
 	 */
-	spin_lock(&dev->vblank_time_lock);
+	spin_lock_irqsave(&vblank->time_lock, irqflags);
 
 	/* Vblank irq handling disabled. Nothing to do. */
 	if (!vblank->enabled) {
-		spin_unlock(&dev->vblank_time_lock);
-		spin_unlock_irqrestore(&dev->event_lock, irqflags);
+		spin_unlock_irqrestore(&vblank->time_lock, irqflags);
 		return false;
 	}
 
 	drm_update_vblank_count(dev, pipe, true);
 
-	spin_unlock(&dev->vblank_time_lock);
+	spin_unlock(&vblank->time_lock);
 
 	wake_up(&vblank->queue);
 
@@ -1722,8 +1724,8 @@ bool drm_handle_vblank(struct drm_device *dev, unsigned int pipe)
 		       drm_vblank_offdelay > 0 &&
 		       !atomic_read(&vblank->refcount));
 
+	spin_lock(&dev->event_lock);
 	drm_handle_vblank_events(dev, pipe);
-
 	spin_unlock_irqrestore(&dev->event_lock, irqflags);
 
 	if (disable_irq)
@@ -1899,7 +1901,7 @@ int drm_crtc_queue_sequence_ioctl(struct drm_device *dev, void *data,
 		queue_seq->sequence = seq;
 	} else {
 		/* drm_handle_vblank_events will call drm_vblank_put */
-		list_add_tail(&e->base.link, &dev->vblank_event_list);
+		list_add_tail(&e->base.link, &vblank->event_list);
 		queue_seq->sequence = req_seq;
 	}
 
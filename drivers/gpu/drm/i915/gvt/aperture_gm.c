@@ -37,24 +37,20 @@
 #include "i915_drv.h"
 #include "gvt.h"
 
-static int alloc_gm(struct intel_vgpu *vgpu, bool high_gm)
+static int __alloc_gm(struct intel_vgpu *vgpu, struct drm_mm_node *node,
+		u64 size, bool high_gm)
 {
 	struct intel_gvt *gvt = vgpu->gvt;
 	struct drm_i915_private *dev_priv = gvt->dev_priv;
 	unsigned int flags;
-	u64 start, end, size;
-	struct drm_mm_node *node;
+	u64 start, end;
 	int ret;
 
 	if (high_gm) {
-		node = &vgpu->gm.high_gm_node;
-		size = vgpu_hidden_sz(vgpu);
 		start = ALIGN(gvt_hidden_gmadr_base(gvt), I915_GTT_PAGE_SIZE);
 		end = ALIGN(gvt_hidden_gmadr_end(gvt), I915_GTT_PAGE_SIZE);
 		flags = PIN_HIGH;
 	} else {
-		node = &vgpu->gm.low_gm_node;
-		size = vgpu_aperture_sz(vgpu);
 		start = ALIGN(gvt_aperture_gmadr_base(gvt), I915_GTT_PAGE_SIZE);
 		end = ALIGN(gvt_aperture_gmadr_end(gvt), I915_GTT_PAGE_SIZE);
 		flags = PIN_MAPPABLE;
@@ -73,6 +69,16 @@ static int alloc_gm(struct intel_vgpu *vgpu, bool high_gm)
 	return ret;
 }
 
+static int alloc_gm(struct intel_vgpu *vgpu, bool high_gm)
+{
+	if (high_gm)
+		return __alloc_gm(vgpu, &vgpu->gm.high_gm_node,
+				  vgpu_hidden_sz(vgpu), true);
+	else
+		return __alloc_gm(vgpu, &vgpu->gm.low_gm_node,
+				  vgpu_aperture_sz(vgpu), false);
+}
+
 static int alloc_vgpu_gm(struct intel_vgpu *vgpu)
 {
 	struct intel_gvt *gvt = vgpu->gvt;
@@ -355,3 +361,87 @@ int intel_vgpu_alloc_resource(struct intel_vgpu *vgpu,
 	free_resource(vgpu);
 	return ret;
 }
+
+/**
+ * intel_vgpu_resize_resource - change the high GM size and fences of a vGPU
+ * @vgpu: an inactive vGPU
+ * @high_gm_sz: new high GM size, in MB
+ * @fence_sz: new number of fence registers
+ *
+ * The low GM (aperture) partition is left alone, the guest may have it
+ * mapped through the vGPU BAR. The caller holds gvt->lock and vgpu_lock,
+ * and refreshes PVINFO afterwards so the guest balloons the new ranges
+ * when its driver next loads.
+ *
+ * Returns:
+ * zero on success, negative error code if failed.
+ *
+ */
+int intel_vgpu_resize_resource(struct intel_vgpu *vgpu, u64 high_gm_sz,
+		u64 fence_sz)
+{
+	struct intel_gvt *gvt = vgpu->gvt;
+	struct drm_i915_private *dev_priv = gvt->dev_priv;
+	u64 old_high_gm = vgpu_hidden_sz(vgpu);
+	u64 old_fence = vgpu_fence_sz(vgpu);
+	struct drm_mm_node node = {};
+	u64 request;
+	int ret;
+
+	if (!high_gm_sz || !fence_sz || fence_sz > INTEL_GVT_MAX_NUM_FENCES)
+		return -EINVAL;
+
+	request = ALIGN(MB_TO_BYTES(high_gm_sz), I915_GTT_PAGE_SIZE);
+
+	if (gvt->gm.vgpu_allocated_high_gm_size - old_high_gm + request >
+	    gvt_hidden_sz(gvt) - HOST_HIGH_GM_SIZE ||
+	    gvt->fence.vgpu_allocated_fence_num - old_fence + fence_sz >
+	    gvt_fence_sz(gvt) - HOST_FENCE)
+		return -ENOSPC;
+
+	/* Take the new range first, so failing leaves the vGPU untouched. */
+	if (request != old_high_gm) {
+		ret = __alloc_gm(vgpu, &node, request, true);
+		if (ret)
+			return ret;
+	}
+
+	/* Point the old ranges back at scratch before handing them back. */
+	intel_vgpu_reset_ggtt(vgpu, true);
+
+	if (fence_sz != old_fence) {
+		free_vgpu_fence(vgpu);
+		vgpu_fence_sz(vgpu) = fence_sz;
+		ret = alloc_vgpu_fence(vgpu);
+		if (ret) {
+			vgpu_fence_sz(vgpu) = old_fence;
+			if (alloc_vgpu_fence(vgpu))
+				gvt_vgpu_err("fail to restore fences\n");
+			goto out_free_node;
+		}
+		gvt->fence.vgpu_allocated_fence_num += fence_sz - old_fence;
+	}
+
+	if (request != old_high_gm) {
+		mutex_lock(&dev_priv->drm.struct_mutex);
+		drm_mm_remove_node(&vgpu->gm.high_gm_node);
+		drm_mm_replace_node(&node, &vgpu->gm.high_gm_node);
+		mutex_unlock(&dev_priv->drm.struct_mutex);
+
+		vgpu_hidden_sz(vgpu) = request;
+		gvt->gm.vgpu_allocated_high_gm_size += request - old_high_gm;
+	}
+
+	gvt_dbg_core("vgpu%d: resized high GM start %llx size %llx, %llu fences\n",
+		     vgpu->id, vgpu_hidden_offset(vgpu), vgpu_hidden_sz(vgpu),
+		     vgpu_fence_sz(vgpu));
+	return 0;
+
+out_free_node:
+	if (drm_mm_node_allocated(&node)) {
+		mutex_lock(&dev_priv->drm.struct_mutex);
+		drm_mm_remove_node(&node);
+		mutex_unlock(&dev_priv->drm.struct_mutex);
+	}
+	return ret;
+}
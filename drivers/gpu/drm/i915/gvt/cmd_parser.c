@@ -365,8 +365,6 @@ struct parser_exec_state;
 
 typedef int (*parser_cmd_handler)(struct parser_exec_state *s);
 
-#define GVT_CMD_HASH_BITS   7
-
 /* which DWords need address fix */
 #define ADDR_FIX_1(x1)			(1 << (x1))
 #define ADDR_FIX_2(x1, x2)		(ADDR_FIX_1(x1) | ADDR_FIX_1(x2))
@@ -423,11 +421,6 @@ struct cmd_info {
 	parser_cmd_handler handler;
 };
 
-struct cmd_entry {
-	struct hlist_node hlist;
-	struct cmd_info *info;
-};
-
 enum {
 	RING_BUFFER_INSTRUCTION,
 	BATCH_BUFFER_INSTRUCTION,
@@ -625,17 +618,27 @@ static inline u32 get_opcode(u32 cmd, int ring_id)
 	return cmd >> (32 - d_info->op_len);
 }
 
+/*
+ * Opcodes are at most 16 bits wide (see OP_LEN_*), so each ring gets a
+ * two level table indexed directly by the opcode. Only the second level
+ * pages holding known commands are allocated.
+ */
+#define CMD_TABLE_L1(opcode)	((opcode) >> GVT_CMD_TABLE_BITS)
+#define CMD_TABLE_L2(opcode)	((opcode) & (GVT_CMD_TABLE_SIZE - 1))
+
 static inline struct cmd_info *find_cmd_entry(struct intel_gvt *gvt,
 		unsigned int opcode, int ring_id)
 {
-	struct cmd_entry *e;
+	struct cmd_info **page;
 
-	hash_for_each_possible(gvt->cmd_table, e, hlist, opcode) {
-		if ((opcode == e->info->opcode) &&
-				(e->info->rings & (1 << ring_id)))
-			return e->info;
-	}
-	return NULL;
+	if (unlikely(CMD_TABLE_L1(opcode) >= GVT_CMD_TABLE_SIZE))
+		return NULL;
+
+	page = gvt->cmd_table[ring_id][CMD_TABLE_L1(opcode)];
+	if (!page)
+		return NULL;
+
+	return page[CMD_TABLE_L2(opcode)];
 }
 
 static inline struct cmd_info *get_cmd_info(struct intel_gvt *gvt,
@@ -1124,11 +1127,6 @@ static int cmd_handler_mi_user_interrupt(struct parser_exec_state *s)
 	return 0;
 }
 
-static int cmd_advance_default(struct parser_exec_state *s)
-{
-	return ip_gma_advance(s, cmd_length(s));
-}
-
 static int cmd_handler_mi_batch_buffer_end(struct parser_exec_state *s)
 {
 	int ret;
@@ -2510,9 +2508,28 @@ static struct cmd_info cmd_info[] = {
 		0, 20, NULL},
 };
 
-static void add_cmd_entry(struct intel_gvt *gvt, struct cmd_entry *e)
+static int add_cmd_entry(struct intel_gvt *gvt, struct cmd_info *info)
 {
-	hash_add(gvt->cmd_table, &e->hlist, e->info->opcode);
+	unsigned long rings = info->rings;
+	unsigned int l1 = CMD_TABLE_L1(info->opcode);
+	struct cmd_info **page;
+	unsigned int ring;
+
+	if (WARN_ON(l1 >= GVT_CMD_TABLE_SIZE))
+		return -EINVAL;
+
+	for_each_set_bit(ring, &rings, I915_NUM_ENGINES) {
+		page = gvt->cmd_table[ring][l1];
+		if (!page) {
+			page = kcalloc(GVT_CMD_TABLE_SIZE, sizeof(*page),
+				       GFP_KERNEL);
+			if (!page)
+				return -ENOMEM;
+			gvt->cmd_table[ring][l1] = page;
+		}
+		page[CMD_TABLE_L2(info->opcode)] = info;
+	}
+	return 0;
 }
 
 /* call the cmd handler, and advance ip */
@@ -2521,6 +2538,7 @@ static int cmd_parser_exec(struct parser_exec_state *s)
 	struct intel_vgpu *vgpu = s->vgpu;
 	struct cmd_info *info;
 	u32 cmd;
+	int len;
 	int ret = 0;
 
 	cmd = cmd_val(s, 0);
@@ -2535,9 +2553,10 @@ static int cmd_parser_exec(struct parser_exec_state *s)
 	}
 
 	s->info = info;
+	len = get_cmd_length(info, cmd);
 
 	trace_gvt_command(vgpu->id, s->ring_id, s->ip_gma, s->ip_va,
-			  cmd_length(s), s->buf_type, s->buf_addr_type,
+			  len, s->buf_type, s->buf_addr_type,
 			  s->workload, info->name);
 
 	if (info->handler) {
@@ -2548,8 +2567,9 @@ static int cmd_parser_exec(struct parser_exec_state *s)
 		}
 	}
 
+	/* The length decoded above is reused to step over the payload */
 	if (!(info->flag & F_IP_ADVANCE_CUSTOM)) {
-		ret = cmd_advance_default(s);
+		ret = ip_gma_advance(s, len);
 		if (ret) {
 			gvt_vgpu_err("%s IP advance error\n", info->name);
 			return ret;
@@ -2905,9 +2925,10 @@ static struct cmd_info *find_cmd_entry_any_ring(struct intel_gvt *gvt,
 static int init_cmd_table(struct intel_gvt *gvt)
 {
 	int i;
-	struct cmd_entry *e;
+	struct cmd_info	*e;
 	struct cmd_info	*info;
 	unsigned int gen_type;
+	int ret;
 
 	gen_type = intel_gvt_get_device_type(gvt);
 
@@ -2915,39 +2936,33 @@ static int init_cmd_table(struct intel_gvt *gvt)
 		if (!(cmd_info[i].devices & gen_type))
 			continue;
 
-		e = kzalloc(sizeof(*e), GFP_KERNEL);
-		if (!e)
-			return -ENOMEM;
-
-		e->info = &cmd_info[i];
-		info = find_cmd_entry_any_ring(gvt,
-				e->info->opcode, e->info->rings);
+		e = &cmd_info[i];
+		info = find_cmd_entry_any_ring(gvt, e->opcode, e->rings);
 		if (info) {
-			gvt_err("%s %s duplicated\n", e->info->name,
-					info->name);
-			kfree(e);
+			gvt_err("%s %s duplicated\n", e->name, info->name);
 			return -EEXIST;
 		}
 
-		INIT_HLIST_NODE(&e->hlist);
-		add_cmd_entry(gvt, e);
+		ret = add_cmd_entry(gvt, e);
+		if (ret)
+			return ret;
 		gvt_dbg_cmd("add %-30s op %04x flag %x devs %02x rings %02x\n",
-				e->info->name, e->info->opcode, e->info->flag,
-				e->info->devices, e->info->rings);
+				e->name, e->opcode, e->flag,
+				e->devices, e->rings);
 	}
 	return 0;
 }
 
 static void clean_cmd_table(struct intel_gvt *gvt)
 {
-	struct hlist_node *tmp;
-	struct cmd_entry *e;
-	int i;
-
-	hash_for_each_safe(gvt->cmd_table, i, tmp, e, hlist)
-		kfree(e);
+	int ring, i;
 
-	hash_init(gvt->cmd_table);
+	for (ring = 0; ring < I915_NUM_ENGINES; ring++) {
+		for (i = 0; i < GVT_CMD_TABLE_SIZE; i++) {
+			kfree(gvt->cmd_table[ring][i]);
+			gvt->cmd_table[ring][i] = NULL;
+		}
+	}
 }
 
 void intel_gvt_clean_cmd_parser(struct intel_gvt *gvt)
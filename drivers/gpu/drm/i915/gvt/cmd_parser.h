@@ -36,7 +36,8 @@
 #ifndef _GVT_CMD_PARSER_H_
 #define _GVT_CMD_PARSER_H_
 
-#define GVT_CMD_HASH_BITS 7
+#define GVT_CMD_TABLE_BITS 8
+#define GVT_CMD_TABLE_SIZE (1 << GVT_CMD_TABLE_BITS)
 
 void intel_gvt_clean_cmd_parser(struct intel_gvt *gvt);
 
@@ -186,6 +186,67 @@ DEFINE_SIMPLE_ATTRIBUTE(vgpu_scan_nonprivbb_fops,
 			vgpu_scan_nonprivbb_get, vgpu_scan_nonprivbb_set,
 			"0x%llx\n");
 
+static int vgpu_gtt_stats_show(struct seq_file *s, void *unused)
+{
+	struct intel_vgpu *vgpu = s->private;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	seq_printf(s, "page table write traps: %lu\n",
+		   vgpu->gtt.stats.write_traps);
+	seq_printf(s, "out of sync: %lu, synced: %lu, evicted: %lu\n",
+		   vgpu->gtt.stats.oos_enters, vgpu->gtt.stats.oos_syncs,
+		   vgpu->gtt.stats.oos_evictions);
+	seq_printf(s, "oos page pool: %d\n", vgpu->gvt->gtt.oos_page_count);
+	seq_printf(s, "shadow page tables: %lu, shared references: %lu\n",
+		   vgpu->gtt.stats.spt_count, vgpu->gtt.stats.spt_shared);
+	seq_printf(s, "2M entries: %lu kept huge, %lu split; 64K entries: %lu split\n",
+		   vgpu->gtt.stats.pte_2m_huge, vgpu->gtt.stats.pte_2m_split,
+		   vgpu->gtt.stats.pte_64k_split);
+	mutex_unlock(&vgpu->vgpu_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_gtt_stats);
+
+static int vgpu_sched_stats_show(struct seq_file *s, void *unused)
+{
+	struct intel_vgpu *vgpu = s->private;
+	struct intel_vgpu_sched_stats stats;
+
+	intel_vgpu_get_sched_stats(vgpu, &stats);
+
+	seq_printf(s, "class: %s\n",
+		   stats.sched_class == INTEL_VGPU_SCHED_THROUGHPUT ?
+		   "throughput" : "interactive");
+	seq_printf(s, "busy: %llu us\n", div_u64(stats.busy_ns, NSEC_PER_USEC));
+	seq_printf(s, "scheduled in: %llu\n", stats.sched_in);
+	seq_printf(s, "delay: count %llu, avg %llu us, max %llu us\n",
+		   stats.delay_count,
+		   stats.delay_count ?
+		   div64_u64(stats.delay_total_ns,
+			     stats.delay_count * NSEC_PER_USEC) : 0,
+		   div_u64(stats.delay_max_ns, NSEC_PER_USEC));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_sched_stats);
+
+static int vgpu_irq_stats_show(struct seq_file *s, void *unused)
+{
+	struct intel_vgpu *vgpu = s->private;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	seq_printf(s, "msi injected: %llu, coalesced: %llu\n",
+		   vgpu->irq.stats.injected, vgpu->irq.stats.coalesced);
+	seq_printf(s, "msi per second: %u\n",
+		   ktime_ms_delta(ktime_get(), vgpu->irq.stats.rate_start) <
+		   2 * MSEC_PER_SEC ? vgpu->irq.stats.per_sec : 0);
+	mutex_unlock(&vgpu->vgpu_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vgpu_irq_stats);
+
 /**
  * intel_gvt_debugfs_add_vgpu - register debugfs entries for a vGPU
  * @vgpu: a vGPU
@@ -218,6 +279,21 @@ int intel_gvt_debugfs_add_vgpu(struct intel_vgpu *vgpu)
 	if (!ent)
 		return -ENOMEM;
 
+	ent = debugfs_create_file("gtt_stats", 0444, vgpu->debugfs,
+				  vgpu, &vgpu_gtt_stats_fops);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_file("sched_stats", 0444, vgpu->debugfs,
+				  vgpu, &vgpu_sched_stats_fops);
+	if (!ent)
+		return -ENOMEM;
+
+	ent = debugfs_create_file("irq_stats", 0444, vgpu->debugfs,
+				  vgpu, &vgpu_irq_stats_fops);
+	if (!ent)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -393,6 +393,7 @@ static void emulate_vblank_on_pipe(struct intel_vgpu *vgpu, int pipe)
 		[PIPE_B] = PIPE_B_VBLANK,
 		[PIPE_C] = PIPE_C_VBLANK,
 	};
+	bool flipped = false;
 	int event;
 
 	if (pipe < PIPE_A || pipe > PIPE_C)
@@ -406,8 +407,13 @@ static void emulate_vblank_on_pipe(struct intel_vgpu *vgpu, int pipe)
 
 		vgpu_vreg_t(vgpu, PIPE_FLIPCOUNT_G4X(pipe))++;
 		intel_vgpu_trigger_virtual_event(vgpu, event);
+		flipped = true;
 	}
 
+	/* Let display consumers re-query the planes instead of polling. */
+	if (flipped)
+		intel_gvt_hypervisor_notify_display_change(vgpu);
+
 	if (pipe_is_enabled(vgpu, pipe)) {
 		vgpu_vreg_t(vgpu, PIPE_FRMCOUNT_G4X(pipe))++;
 		intel_vgpu_trigger_virtual_event(vgpu, vblank_event[pipe]);
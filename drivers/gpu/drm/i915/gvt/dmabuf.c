@@ -141,11 +141,30 @@ static void vgpu_gem_release(struct drm_i915_gem_object *gem_obj)
 	}
 }
 
+static void vgpu_gem_dmabuf_release(struct drm_i915_gem_object *gem_obj,
+				    struct dma_buf *dmabuf)
+{
+	struct intel_vgpu_fb_info *fb_info = gem_obj->gvt_info;
+	struct intel_vgpu_dmabuf_obj *obj = fb_info->obj;
+	struct intel_vgpu *vgpu = obj->vgpu;
+
+	if (vgpu) {
+		mutex_lock(&vgpu->dmabuf_lock);
+		if (obj->dmabuf == dmabuf)
+			obj->dmabuf = NULL;
+		mutex_unlock(&vgpu->dmabuf_lock);
+	} else {
+		if (obj->dmabuf == dmabuf)
+			obj->dmabuf = NULL;
+	}
+}
+
 static const struct drm_i915_gem_object_ops intel_vgpu_gem_ops = {
 	.flags = I915_GEM_OBJECT_IS_PROXY,
 	.get_pages = vgpu_gem_get_pages,
 	.put_pages = vgpu_gem_put_pages,
 	.release = vgpu_gem_release,
+	.dmabuf_release = vgpu_gem_dmabuf_release,
 };
 
 static struct drm_i915_gem_object *vgpu_create_gem(struct drm_device *dev,
@@ -419,6 +438,7 @@ int intel_vgpu_query_plane(struct intel_vgpu *vgpu, void *args)
 	dmabuf_obj->dmabuf_id = ret;
 
 	dmabuf_obj->initref = true;
+	dmabuf_obj->dmabuf = NULL;
 
 	kref_init(&dmabuf_obj->kref);
 
@@ -470,23 +490,41 @@ int intel_vgpu_get_dmabuf(struct intel_vgpu *vgpu, unsigned int dmabuf_id)
 		goto out;
 	}
 
-	obj = vgpu_create_gem(dev, dmabuf_obj->info);
-	if (obj == NULL) {
-		gvt_vgpu_err("create gvt gem obj failed\n");
-		ret = -ENOMEM;
-		goto out;
-	}
+	/*
+	 * While an earlier export of this plane configuration is alive,
+	 * hand out another fd for the same dma-buf rather than building a
+	 * new GEM object, and its pages, on every request. The final fput
+	 * may already be under way (it clears the cached pointer under our
+	 * lock), so only take a reference if it is not already zero.
+	 */
+	dmabuf = dmabuf_obj->dmabuf;
+	if (dmabuf && get_file_rcu(dmabuf->file)) {
+		gvt_dbg_dpy("vgpu%d: re-export dmabuf %d\n",
+			    vgpu->id, dmabuf_obj->dmabuf_id);
+	} else {
+		obj = vgpu_create_gem(dev, dmabuf_obj->info);
+		if (obj == NULL) {
+			gvt_vgpu_err("create gvt gem obj failed\n");
+			ret = -ENOMEM;
+			goto out;
+		}
 
-	obj->gvt_info = dmabuf_obj->info;
+		/* Dropped by vgpu_gem_release() */
+		dmabuf_obj_get(dmabuf_obj);
+		obj->gvt_info = dmabuf_obj->info;
 
-	dmabuf = i915_gem_prime_export(dev, &obj->base, DRM_CLOEXEC | DRM_RDWR);
-	if (IS_ERR(dmabuf)) {
-		gvt_vgpu_err("export dma-buf failed\n");
-		ret = PTR_ERR(dmabuf);
-		goto out_free_gem;
-	}
+		dmabuf = i915_gem_prime_export(dev, &obj->base,
+					       DRM_CLOEXEC | DRM_RDWR);
+		if (IS_ERR(dmabuf)) {
+			gvt_vgpu_err("export dma-buf failed\n");
+			ret = PTR_ERR(dmabuf);
+			goto out_free_gem;
+		}
 
-	i915_gem_object_put(obj);
+		i915_gem_object_put(obj);
+		dmabuf_obj->dmabuf = dmabuf;
+	}
+	obj = to_intel_bo(dmabuf->priv);
 
 	ret = dma_buf_fd(dmabuf, DRM_CLOEXEC | DRM_RDWR);
 	if (ret < 0) {
@@ -495,8 +533,6 @@ int intel_vgpu_get_dmabuf(struct intel_vgpu *vgpu, unsigned int dmabuf_id)
 	}
 	dmabuf_fd = ret;
 
-	dmabuf_obj_get(dmabuf_obj);
-
 	if (dmabuf_obj->initref) {
 		dmabuf_obj->initref = false;
 		dmabuf_obj_put(dmabuf_obj);
@@ -516,6 +552,7 @@ int intel_vgpu_get_dmabuf(struct intel_vgpu *vgpu, unsigned int dmabuf_id)
 
 out_free_dmabuf:
 	dma_buf_put(dmabuf);
+	goto out;
 out_free_gem:
 	i915_gem_object_put(obj);
 out:
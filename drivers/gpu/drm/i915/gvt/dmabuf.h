@@ -58,6 +58,8 @@ struct intel_vgpu_dmabuf_obj {
 	struct kref kref;
 	bool initref;
 	struct list_head list;
+	/* Last exported dma-buf, cleared when it is released */
+	struct dma_buf *dmabuf;
 };
 
 int intel_vgpu_query_plane(struct intel_vgpu *vgpu, void *args);
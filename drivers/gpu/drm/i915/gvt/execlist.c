@@ -505,6 +505,141 @@ int intel_vgpu_submit_execlist(struct intel_vgpu *vgpu, int ring_id)
 	return -EINVAL;
 }
 
+#define pv_sq_offset(ring_id, field) \
+	(offsetof(struct vgt_pv_submission, sq[ring_id]) + \
+	 offsetof(struct vgt_pv_sq, field))
+
+static int complete_pv_workload(struct intel_vgpu_workload *workload)
+{
+	struct intel_vgpu *vgpu = workload->vgpu;
+	int ring_id = workload->ring_id;
+	u64 gpa = vgpu_vreg64_t(vgpu, vgtif_reg(pv_sq_gpa.lo));
+	u32 completed;
+	int ret = 0;
+
+	gvt_dbg_el("complete pv workload %p status %d\n", workload,
+			workload->status);
+
+	if (workload->status || (vgpu->resetting_eng & ENGINE_MASK(ring_id)))
+		goto out;
+
+	ret = intel_gvt_hypervisor_read_gpa(vgpu,
+			gpa + pv_sq_offset(ring_id, completed),
+			&completed, 4);
+	if (ret)
+		goto out;
+
+	completed++;
+	ret = intel_gvt_hypervisor_write_gpa(vgpu,
+			gpa + pv_sq_offset(ring_id, completed),
+			&completed, 4);
+	if (ret)
+		goto out;
+
+	intel_vgpu_trigger_virtual_event(vgpu,
+			ring_id_to_context_switch_event(ring_id));
+out:
+	intel_vgpu_unpin_mm(workload->shadow_mm);
+	intel_vgpu_destroy_workload(workload);
+	return ret;
+}
+
+static int pv_submit_ring(struct intel_vgpu *vgpu, int ring_id, u64 gpa)
+{
+	struct execlist_ctx_descriptor_format desc;
+	struct intel_vgpu_workload *workload;
+	u32 idx[2]; /* head, tail */
+	int ret;
+
+	ret = intel_gvt_hypervisor_read_gpa(vgpu,
+			gpa + pv_sq_offset(ring_id, head), idx, sizeof(idx));
+	if (ret)
+		return ret;
+
+	if (idx[1] - idx[0] > VGT_PV_SQ_SIZE) {
+		gvt_vgpu_err("invalid pv submission queue %d head %u tail %u\n",
+			     ring_id, idx[0], idx[1]);
+		return -EINVAL;
+	}
+
+	for (; idx[0] != idx[1]; idx[0]++) {
+		ret = intel_gvt_hypervisor_read_gpa(vgpu,
+				gpa + pv_sq_offset(ring_id,
+					desc[idx[0] % VGT_PV_SQ_SIZE]),
+				&desc, sizeof(desc));
+		if (ret)
+			break;
+
+		if (!desc.valid || !desc.privilege_access) {
+			gvt_vgpu_err("invalid pv submission desc %08x %08x\n",
+				     desc.udw, desc.ldw);
+			ret = -EINVAL;
+			break;
+		}
+
+		workload = intel_vgpu_create_workload(vgpu, ring_id, &desc);
+		if (IS_ERR(workload)) {
+			ret = PTR_ERR(workload);
+			break;
+		}
+
+		/* Completion is reported through the queue, not the CSB */
+		workload->prepare = NULL;
+		workload->complete = complete_pv_workload;
+		workload->emulate_schedule_in = false;
+
+		intel_vgpu_queue_workload(workload);
+	}
+
+	/* Let the guest reuse the slots we have taken, even on failure */
+	intel_gvt_hypervisor_write_gpa(vgpu,
+			gpa + pv_sq_offset(ring_id, head), &idx[0], 4);
+	return ret;
+}
+
+/**
+ * intel_vgpu_pv_submit - take descriptors from the PV submission queues
+ * @vgpu: a vGPU
+ *
+ * This function is called when the guest sends
+ * VGT_G2V_PV_SUBMISSION_NOTIFY. Every descriptor queued since the last
+ * notification, on any engine, becomes a workload on the vGPU's regular
+ * workload queue, so a single trap can submit a queue deeper than the two
+ * ELSP ports.
+ *
+ * Returns:
+ * Zero on success, negative error code if failed.
+ */
+int intel_vgpu_pv_submit(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_submission *s = &vgpu->submission;
+	u64 gpa = vgpu_vreg64_t(vgpu, vgtif_reg(pv_sq_gpa.lo));
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	int ret;
+
+	BUILD_BUG_ON(I915_NUM_ENGINES > VGT_PV_SQ_ENGINES);
+
+	if (!s->active ||
+	    s->virtual_submission_interface != INTEL_VGPU_EXECLIST_SUBMISSION) {
+		gvt_vgpu_err("pv submission without execlist enabled\n");
+		return -EINVAL;
+	}
+
+	if (!gpa) {
+		gvt_vgpu_err("pv submission without a queue\n");
+		return -EINVAL;
+	}
+
+	for_each_engine(engine, vgpu->gvt->dev_priv, id) {
+		ret = pv_submit_ring(vgpu, id, gpa);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 static void init_vgpu_execlist(struct intel_vgpu *vgpu, int ring_id)
 {
 	struct intel_vgpu_submission *s = &vgpu->submission;
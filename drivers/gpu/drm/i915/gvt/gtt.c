@@ -46,6 +46,11 @@
 
 static bool enable_out_of_sync = false;
 static int preallocated_oos_pages = 8192;
+/*
+ * The oos page pool grows on demand up to this size before pages in use get
+ * evicted, and shrinks back to the preallocated size as they are released.
+ */
+static int max_oos_pages = 32768;
 
 /*
  * validate a gm address and related range size,
@@ -725,6 +730,7 @@ static void free_spt(struct intel_vgpu_ppgtt_spt *spt)
 
 static int detach_oos_page(struct intel_vgpu *vgpu,
 		struct intel_vgpu_oos_page *oos_page);
+static void shrink_oos_pages(struct intel_gvt *gvt);
 
 static void ppgtt_free_spt(struct intel_vgpu_ppgtt_spt *spt)
 {
@@ -738,13 +744,16 @@ static void ppgtt_free_spt(struct intel_vgpu_ppgtt_spt *spt)
 	radix_tree_delete(&spt->vgpu->gtt.spt_tree, spt->shadow_page.mfn);
 
 	if (spt->guest_page.gfn) {
-		if (spt->guest_page.oos_page)
+		if (spt->guest_page.oos_page) {
 			detach_oos_page(spt->vgpu, spt->guest_page.oos_page);
+			shrink_oos_pages(spt->vgpu->gvt);
+		}
 
 		intel_vgpu_unregister_page_track(spt->vgpu, spt->guest_page.gfn);
 	}
 
 	list_del_init(&spt->post_shadow_list);
+	spt->vgpu->gtt.stats.spt_count--;
 	free_spt(spt);
 }
 
@@ -775,6 +784,8 @@ static int ppgtt_write_protection_handler(
 	if (bytes != 4 && bytes != 8)
 		return -EINVAL;
 
+	spt->vgpu->gtt.stats.write_traps++;
+
 	ret = ppgtt_handle_guest_write_page_table_bytes(spt, gpa, data, bytes);
 	if (ret)
 		return ret;
@@ -844,6 +855,8 @@ static struct intel_vgpu_ppgtt_spt *ppgtt_alloc_spt(
 	if (ret)
 		goto err_unmap_dma;
 
+	vgpu->gtt.stats.spt_count++;
+
 	return spt;
 
 err_unmap_dma:
@@ -1052,9 +1065,15 @@ static struct intel_vgpu_ppgtt_spt *ppgtt_populate_spt_by_guest_entry(
 	if (we->type == GTT_TYPE_PPGTT_PDE_ENTRY)
 		ips = vgpu_ips_enabled(vgpu) && ops->test_ips(we);
 
+	/*
+	 * Guest page tables are shadowed once per vGPU: the mms and the page
+	 * table levels referencing the same guest page share its shadow page,
+	 * which is refcounted, along with its write protection.
+	 */
 	spt = intel_vgpu_find_spt_by_gfn(vgpu, ops->get_pfn(we));
 	if (spt) {
 		ppgtt_get_spt(spt);
+		vgpu->gtt.stats.spt_shared++;
 
 		if (ips != spt->guest_page.pde_ips) {
 			spt->guest_page.pde_ips = ips;
@@ -1120,6 +1139,7 @@ static int is_2MB_gtt_possible(struct intel_vgpu *vgpu,
 	struct intel_gvt_gtt_entry *entry)
 {
 	struct intel_gvt_gtt_pte_ops *ops = vgpu->gvt->gtt.pte_ops;
+	struct page *page;
 	unsigned long pfn;
 
 	if (!HAS_PAGE_SIZES(vgpu->gvt->dev_priv, I915_GTT_PAGE_SIZE_2M))
@@ -1129,7 +1149,19 @@ static int is_2MB_gtt_possible(struct intel_vgpu *vgpu,
 	if (pfn == INTEL_GVT_INVALID_ADDR)
 		return -EINVAL;
 
-	return PageTransHuge(pfn_to_page(pfn));
+	if (!IS_ALIGNED(pfn, I915_GTT_PAGE_SIZE_2M >> PAGE_SHIFT))
+		return 0;
+
+	/*
+	 * The host backing is contiguous if it is a transparent huge page,
+	 * or a part of a hugetlbfs page at least as large.
+	 */
+	page = pfn_to_page(pfn);
+	if (PageHuge(page))
+		return compound_order(compound_head(page)) >=
+		       get_order(I915_GTT_PAGE_SIZE_2M);
+
+	return !PageTail(page) && PageTransHuge(page);
 }
 
 static int split_2MB_gtt_entry(struct intel_vgpu *vgpu,
@@ -1236,13 +1268,15 @@ static int ppgtt_populate_shadow_entry(struct intel_vgpu *vgpu,
 		 * controlled by uper PDE. To be simple, we always split
 		 * 64K page to smaller 4K pages in shadow PT.
 		 */
+		vgpu->gtt.stats.pte_64k_split++;
 		return split_64KB_gtt_entry(vgpu, spt, index, &se);
 	case GTT_TYPE_PPGTT_PTE_2M_ENTRY:
 		gvt_vdbg_mm("shadow 2M gtt entry\n");
 		ret = is_2MB_gtt_possible(vgpu, ge);
-		if (ret == 0)
+		if (ret == 0) {
+			vgpu->gtt.stats.pte_2m_split++;
 			return split_2MB_gtt_entry(vgpu, spt, index, &se);
-		else if (ret < 0)
+		} else if (ret < 0)
 			return ret;
 		page_size = I915_GTT_PAGE_SIZE_2M;
 		break;
@@ -1256,9 +1290,17 @@ static int ppgtt_populate_shadow_entry(struct intel_vgpu *vgpu,
 	/* direct shadow */
 	ret = intel_gvt_hypervisor_dma_map_guest_page(vgpu, gfn, page_size,
 						      &dma_addr);
+	if (ret && page_size == I915_GTT_PAGE_SIZE_2M) {
+		/* the pinned host pages turned out not to be contiguous */
+		vgpu->gtt.stats.pte_2m_split++;
+		return split_2MB_gtt_entry(vgpu, spt, index, &se);
+	}
 	if (ret)
 		return -ENXIO;
 
+	if (page_size == I915_GTT_PAGE_SIZE_2M)
+		vgpu->gtt.stats.pte_2m_huge++;
+
 	pte_ops->set_pfn(&se, dma_addr >> PAGE_SHIFT);
 	ppgtt_set_shadow_entry(spt, &se, index);
 	return 0;
@@ -1387,8 +1429,12 @@ static int ppgtt_handle_guest_entry_add(struct intel_vgpu_ppgtt_spt *spt,
 	return ret;
 }
 
+/*
+ * If @guest is given, the guest page table is read into it in one go,
+ * instead of one guest entry at a time.
+ */
 static int sync_oos_page(struct intel_vgpu *vgpu,
-		struct intel_vgpu_oos_page *oos_page)
+		struct intel_vgpu_oos_page *oos_page, void *guest)
 {
 	const struct intel_gvt_device_info *info = &vgpu->gvt->device_info;
 	struct intel_gvt *gvt = vgpu->gvt;
@@ -1401,14 +1447,27 @@ static int sync_oos_page(struct intel_vgpu *vgpu,
 	trace_oos_change(vgpu->id, "sync", oos_page->id,
 			 spt, spt->guest_page.type);
 
+	vgpu->gtt.stats.oos_syncs++;
+
+	if (guest) {
+		ret = intel_gvt_hypervisor_read_gpa(vgpu,
+				spt->guest_page.gfn << I915_GTT_PAGE_SHIFT,
+				guest, I915_GTT_PAGE_SIZE);
+		if (ret)
+			return ret;
+	}
+
 	old.type = new.type = get_entry_type(spt->guest_page.type);
 	old.val64 = new.val64 = 0;
 
 	for (index = 0; index < (I915_GTT_PAGE_SIZE >>
 				info->gtt_entry_size_shift); index++) {
 		ops->get_entry(oos_page->mem, &old, index, false, 0, vgpu);
-		ops->get_entry(NULL, &new, index, true,
-			       spt->guest_page.gfn << PAGE_SHIFT, vgpu);
+		if (guest)
+			ops->get_entry(guest, &new, index, false, 0, vgpu);
+		else
+			ops->get_entry(NULL, &new, index, true,
+				       spt->guest_page.gfn << PAGE_SHIFT, vgpu);
 
 		if (old.val64 == new.val64
 			&& !test_and_clear_bit(index, spt->post_shadow_bitmap))
@@ -1471,7 +1530,8 @@ static int attach_oos_page(struct intel_vgpu_oos_page *oos_page,
 	return 0;
 }
 
-static int ppgtt_set_guest_page_sync(struct intel_vgpu_ppgtt_spt *spt)
+static int ppgtt_set_guest_page_sync(struct intel_vgpu_ppgtt_spt *spt,
+				     void *guest)
 {
 	struct intel_vgpu_oos_page *oos_page = spt->guest_page.oos_page;
 	int ret;
@@ -1484,7 +1544,40 @@ static int ppgtt_set_guest_page_sync(struct intel_vgpu_ppgtt_spt *spt)
 			 spt, spt->guest_page.type);
 
 	list_del_init(&oos_page->vm_list);
-	return sync_oos_page(spt->vgpu, oos_page);
+	return sync_oos_page(spt->vgpu, oos_page, guest);
+}
+
+static struct intel_vgpu_oos_page *alloc_oos_page(struct intel_gvt_gtt *gtt,
+						  gfp_t gfp)
+{
+	struct intel_vgpu_oos_page *oos_page;
+
+	oos_page = kzalloc(sizeof(*oos_page), gfp);
+	if (!oos_page)
+		return NULL;
+
+	INIT_LIST_HEAD(&oos_page->list);
+	INIT_LIST_HEAD(&oos_page->vm_list);
+	oos_page->id = gtt->oos_page_next_id++;
+	gtt->oos_page_count++;
+
+	return oos_page;
+}
+
+/* Release the free oos pages allocated on demand beyond the preallocation */
+static void shrink_oos_pages(struct intel_gvt *gvt)
+{
+	struct intel_gvt_gtt *gtt = &gvt->gtt;
+	struct intel_vgpu_oos_page *oos_page;
+
+	while (gtt->oos_page_count > preallocated_oos_pages &&
+	       !list_empty(&gtt->oos_page_free_list_head)) {
+		oos_page = list_last_entry(&gtt->oos_page_free_list_head,
+					   struct intel_vgpu_oos_page, list);
+		list_del(&oos_page->list);
+		gtt->oos_page_count--;
+		kfree(oos_page);
+	}
 }
 
 static int ppgtt_allocate_oos_page(struct intel_vgpu_ppgtt_spt *spt)
@@ -1496,10 +1589,23 @@ static int ppgtt_allocate_oos_page(struct intel_vgpu_ppgtt_spt *spt)
 
 	WARN(oos_page, "shadow PPGTT page has already has a oos page\n");
 
+	/*
+	 * Grow the pool rather than evicting a page in use, which would
+	 * bring the write traps back for that page.
+	 */
+	if (list_empty(&gtt->oos_page_free_list_head) &&
+	    gtt->oos_page_count < max_oos_pages) {
+		oos_page = alloc_oos_page(gtt, GFP_KERNEL | __GFP_NOWARN);
+		if (oos_page)
+			list_add_tail(&oos_page->list,
+				      &gtt->oos_page_free_list_head);
+	}
+
 	if (list_empty(&gtt->oos_page_free_list_head)) {
+		spt->vgpu->gtt.stats.oos_evictions++;
 		oos_page = container_of(gtt->oos_page_use_list_head.next,
 			struct intel_vgpu_oos_page, list);
-		ret = ppgtt_set_guest_page_sync(oos_page->spt);
+		ret = ppgtt_set_guest_page_sync(oos_page->spt, NULL);
 		if (ret)
 			return ret;
 		ret = detach_oos_page(spt->vgpu, oos_page);
@@ -1521,6 +1627,8 @@ static int ppgtt_set_guest_page_oos(struct intel_vgpu_ppgtt_spt *spt)
 	trace_oos_change(spt->vgpu->id, "set page out of sync", oos_page->id,
 			 spt, spt->guest_page.type);
 
+	spt->vgpu->gtt.stats.oos_enters++;
+
 	list_add_tail(&oos_page->vm_list, &spt->vgpu->gtt.oos_page_list_head);
 	return intel_vgpu_disable_page_track(spt->vgpu, spt->guest_page.gfn);
 }
@@ -1530,7 +1638,8 @@ static int ppgtt_set_guest_page_oos(struct intel_vgpu_ppgtt_spt *spt)
  * @vgpu: a vGPU
  *
  * This function is called before submitting a guest workload to host,
- * to sync all the out-of-synced shadow for vGPU
+ * to sync all the out-of-synced shadow for vGPU. The pages are synced in one
+ * pass, each guest page table being read at once.
  *
  * Returns:
  * Zero on success, negative error code if failed.
@@ -1539,19 +1648,28 @@ int intel_vgpu_sync_oos_pages(struct intel_vgpu *vgpu)
 {
 	struct list_head *pos, *n;
 	struct intel_vgpu_oos_page *oos_page;
-	int ret;
+	void *guest;
+	int ret = 0;
 
 	if (!enable_out_of_sync)
 		return 0;
 
+	if (list_empty(&vgpu->gtt.oos_page_list_head))
+		return 0;
+
+	/* Fall back to reading one guest entry at a time */
+	guest = kmalloc(I915_GTT_PAGE_SIZE, GFP_KERNEL | __GFP_NOWARN);
+
 	list_for_each_safe(pos, n, &vgpu->gtt.oos_page_list_head) {
 		oos_page = container_of(pos,
 				struct intel_vgpu_oos_page, vm_list);
-		ret = ppgtt_set_guest_page_sync(oos_page->spt);
+		ret = ppgtt_set_guest_page_sync(oos_page->spt, guest);
 		if (ret)
-			return ret;
+			break;
 	}
-	return 0;
+
+	kfree(guest);
+	return ret;
 }
 
 /*
@@ -2485,6 +2603,7 @@ static void clean_spt_oos(struct intel_gvt *gvt)
 		list_del(&oos_page->list);
 		kfree(oos_page);
 	}
+	gtt->oos_page_count = 0;
 }
 
 static int setup_spt_oos(struct intel_gvt *gvt)
@@ -2498,15 +2617,12 @@ static int setup_spt_oos(struct intel_gvt *gvt)
 	INIT_LIST_HEAD(&gtt->oos_page_use_list_head);
 
 	for (i = 0; i < preallocated_oos_pages; i++) {
-		oos_page = kzalloc(sizeof(*oos_page), GFP_KERNEL);
+		oos_page = alloc_oos_page(gtt, GFP_KERNEL);
 		if (!oos_page) {
 			ret = -ENOMEM;
 			goto fail;
 		}
 
-		INIT_LIST_HEAD(&oos_page->list);
-		INIT_LIST_HEAD(&oos_page->vm_list);
-		oos_page->id = i;
 		list_add_tail(&oos_page->list, &gtt->oos_page_free_list_head);
 	}
 
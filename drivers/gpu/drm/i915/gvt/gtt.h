@@ -89,6 +89,8 @@ struct intel_gvt_gtt {
 	void (*mm_free_page_table)(struct intel_vgpu_mm *mm);
 	struct list_head oos_page_use_list_head;
 	struct list_head oos_page_free_list_head;
+	int oos_page_count;
+	int oos_page_next_id;
 	struct list_head ppgtt_mm_lru_list_head;
 
 	struct page *scratch_page;
@@ -198,6 +200,18 @@ struct intel_vgpu_gtt {
 	struct list_head oos_page_list_head;
 	struct list_head post_shadow_list_head;
 	struct intel_vgpu_scratch_pt scratch_pt[GTT_TYPE_MAX];
+
+	struct {
+		unsigned long write_traps;
+		unsigned long oos_enters;
+		unsigned long oos_syncs;
+		unsigned long oos_evictions;
+		unsigned long spt_count;
+		unsigned long spt_shared;
+		unsigned long pte_2m_huge;
+		unsigned long pte_2m_split;
+		unsigned long pte_64k_split;
+	} stats;
 };
 
 extern int intel_vgpu_init_gtt(struct intel_vgpu *vgpu);
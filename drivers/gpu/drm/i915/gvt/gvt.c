@@ -184,6 +184,8 @@ static const struct intel_gvt_ops intel_gvt_ops = {
 	.vgpu_query_plane = intel_vgpu_query_plane,
 	.vgpu_get_dmabuf = intel_vgpu_get_dmabuf,
 	.write_protect_handler = intel_vgpu_page_track_handler,
+	.vgpu_set_sched_class = intel_vgpu_set_sched_class,
+	.vgpu_resize = intel_gvt_resize_vgpu,
 };
 
 /**
@@ -271,6 +273,10 @@ static int gvt_service_thread(void *data)
 					(void *)&gvt->service_request))
 			intel_gvt_emulate_vblank(gvt);
 
+		if (test_and_clear_bit(INTEL_GVT_REQUEST_DEFERRED_IRQ,
+					(void *)&gvt->service_request))
+			intel_gvt_flush_deferred_irqs(gvt);
+
 		if (test_bit(INTEL_GVT_REQUEST_SCHED,
 				(void *)&gvt->service_request) ||
 			test_bit(INTEL_GVT_REQUEST_EVENT_SCHED,
@@ -337,6 +343,53 @@ void intel_gvt_clean_device(struct drm_i915_private *dev_priv)
 	dev_priv->gvt = NULL;
 }
 
+/**
+ * intel_gvt_read_vgpu_counter - read a GVT-g PMU counter
+ * @dev_priv: drm i915 private data
+ * @id: vGPU id
+ * @sample: one of enum drm_i915_pmu_vgpu_sample
+ * @val: returns the counter value
+ *
+ * This function may be called from atomic context, it takes no locks.
+ *
+ * Returns:
+ * Zero on success, negative error code if there is no such counter.
+ */
+int intel_gvt_read_vgpu_counter(struct drm_i915_private *dev_priv,
+				unsigned int id, unsigned int sample, u64 *val)
+{
+	struct intel_gvt *gvt = to_gvt(dev_priv);
+	struct intel_vgpu_pmu_counters *c;
+
+	if (!gvt)
+		return -ENODEV;
+
+	/* id 0 is the idle vGPU */
+	if (!id || id >= GVT_MAX_VGPU)
+		return -ENOENT;
+
+	c = &gvt->pmu_counters[id];
+
+	switch (sample) {
+	case I915_VGPU_SAMPLE_BUSY:
+		*val = READ_ONCE(c->busy_ns);
+		break;
+	case I915_VGPU_SAMPLE_WORKLOADS:
+		*val = READ_ONCE(c->workloads);
+		break;
+	case I915_VGPU_SAMPLE_SHADOW:
+		*val = READ_ONCE(c->shadow_ns);
+		break;
+	case I915_VGPU_SAMPLE_SCHED_DELAY:
+		*val = READ_ONCE(c->sched_delay_ns);
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
 /**
  * intel_gvt_init_device - initialize a GVT device
  * @dev_priv: drm i915 private data
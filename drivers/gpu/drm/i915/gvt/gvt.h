@@ -50,7 +50,7 @@
 #include "dmabuf.h"
 #include "page_track.h"
 
-#define GVT_MAX_VGPU 8
+#define GVT_MAX_VGPU INTEL_GVT_MAX_VGPU
 
 enum {
 	INTEL_GVT_HYPERVISOR_XEN = 0,
@@ -121,6 +121,19 @@ struct intel_vgpu_irq {
 	bool irq_warn_once[INTEL_GVT_EVENT_MAX];
 	DECLARE_BITMAP(flip_done_event[INTEL_GVT_MAX_PIPE],
 		       INTEL_GVT_EVENT_MAX);
+
+	/* MSI coalescing, see inject_virtual_interrupt() */
+	struct hrtimer coalesce_timer;
+	ktime_t last_inject;
+	bool deferred;
+
+	struct {
+		u64 injected;
+		u64 coalesced;
+		ktime_t rate_start;
+		unsigned int rate_count;
+		unsigned int per_sec;
+	} stats;
 };
 
 struct intel_vgpu_opregion {
@@ -137,8 +150,19 @@ struct intel_vgpu_display {
 	struct intel_vgpu_sbi sbi;
 };
 
+/*
+ * Interactive vGPUs are picked ahead of throughput vGPUs and rotate at every
+ * scheduling tick, while a throughput vGPU keeps the GPU for a longer quantum
+ * to amortize the cost of switching.
+ */
+enum intel_vgpu_sched_class {
+	INTEL_VGPU_SCHED_INTERACTIVE = 0,
+	INTEL_VGPU_SCHED_THROUGHPUT,
+};
+
 struct vgpu_sched_ctl {
 	int weight;
+	enum intel_vgpu_sched_class sched_class;
 };
 
 enum {
@@ -156,18 +180,22 @@ struct intel_vgpu_submission_ops {
 struct intel_vgpu_submission {
 	struct intel_vgpu_execlist execlist[I915_NUM_ENGINES];
 	struct list_head workload_q_head[I915_NUM_ENGINES];
-	struct kmem_cache *workloads;
 	atomic_t running_workload_num;
+	/* created when the guest first selects a submission interface */
 	struct i915_gem_context *shadow_ctx;
 	DECLARE_BITMAP(shadow_ctx_desc_updated, I915_NUM_ENGINES);
 	DECLARE_BITMAP(tlb_handle_pending, I915_NUM_ENGINES);
 	void *ring_scan_buffer[I915_NUM_ENGINES];
 	int ring_scan_buffer_size[I915_NUM_ENGINES];
+	/* scans and shadows queued workloads ahead of their dispatch */
+	struct work_struct shadow_work;
 	const struct intel_vgpu_submission_ops *ops;
 	int virtual_submission_interface;
 	bool active;
 };
 
+#define GVT_DMA_CACHE_HASH_BITS 10
+
 struct intel_vgpu {
 	struct intel_gvt *gvt;
 	struct mutex vgpu_lock;
@@ -206,14 +234,24 @@ struct intel_vgpu {
 		int num_regions;
 		struct eventfd_ctx *intx_trigger;
 		struct eventfd_ctx *msi_trigger;
+		struct eventfd_ctx *display_trigger;
 
 		/*
 		 * Two caches are used to avoid mapping duplicated pages (eg.
 		 * scratch pages). This help to reduce dma setup overhead.
+		 * Entries nobody references any more stay pinned on dma_lru,
+		 * so a guest remapping the same page skips the pin entirely;
+		 * the LRU is bounded and trimmed by dma_shrinker under memory
+		 * pressure.
 		 */
-		struct rb_root gfn_cache;
-		struct rb_root dma_addr_cache;
+		DECLARE_HASHTABLE(gfn_cache, GVT_DMA_CACHE_HASH_BITS);
+		DECLARE_HASHTABLE(dma_addr_cache, GVT_DMA_CACHE_HASH_BITS);
 		unsigned long nr_cache_entries;
+		struct list_head dma_lru;
+		unsigned long nr_unused_entries;
+		struct list_head dma_reclaim;
+		struct work_struct dma_reclaim_work;
+		struct shrinker dma_shrinker;
 		struct mutex cache_lock;
 
 		struct notifier_block iommu_notifier;
@@ -321,11 +359,24 @@ struct intel_gvt {
 	struct intel_gvt_gtt gtt;
 	struct intel_gvt_workload_scheduler scheduler;
 	struct notifier_block shadow_ctx_notifier_block[I915_NUM_ENGINES];
-	DECLARE_HASHTABLE(cmd_table, GVT_CMD_HASH_BITS);
+	struct cmd_info **cmd_table[I915_NUM_ENGINES][GVT_CMD_TABLE_SIZE];
 	struct intel_vgpu_type *types;
 	unsigned int num_types;
 	struct intel_vgpu *idle_vgpu;
 
+	/*
+	 * Counters exported through the i915 PMU, indexed by vGPU id. They
+	 * outlive the vGPUs so perf can read them locklessly at any time, and
+	 * are never reset, not even when an id is reused, as perf expects
+	 * them to only ever increase.
+	 */
+	struct intel_vgpu_pmu_counters {
+		u64 busy_ns;
+		u64 workloads;
+		u64 shadow_ns;
+		u64 sched_delay_ns;
+	} pmu_counters[GVT_MAX_VGPU];
+
 	struct task_struct *service_thread;
 	wait_queue_head_t service_thread_wq;
 
@@ -355,6 +406,9 @@ enum {
 
 	/* Scheduling trigger by event */
 	INTEL_GVT_REQUEST_EVENT_SCHED = 2,
+
+	/* Coalesced virtual interrupts are due */
+	INTEL_GVT_REQUEST_DEFERRED_IRQ = 3,
 };
 
 static inline void intel_gvt_request_service(struct intel_gvt *gvt,
@@ -436,6 +490,8 @@ int intel_vgpu_alloc_resource(struct intel_vgpu *vgpu,
 			      struct intel_vgpu_creation_params *param);
 void intel_vgpu_reset_resource(struct intel_vgpu *vgpu);
 void intel_vgpu_free_resource(struct intel_vgpu *vgpu);
+int intel_vgpu_resize_resource(struct intel_vgpu *vgpu, u64 high_gm_sz,
+		u64 fence_sz);
 void intel_vgpu_write_fence(struct intel_vgpu *vgpu,
 	u32 fence, u64 value);
 
@@ -454,6 +510,18 @@ void intel_vgpu_write_fence(struct intel_vgpu *vgpu,
 #define vgpu_sreg(vgpu, offset) \
 	(*(u32 *)(vgpu->mmio.sreg + (offset)))
 
+static inline struct intel_vgpu_pmu_counters *
+vgpu_pmu_counters(struct intel_vgpu *vgpu)
+{
+	return &vgpu->gvt->pmu_counters[vgpu->id];
+}
+
+/* Counters have a single writer at a time, perf reads them locklessly. */
+#define vgpu_pmu_add(vgpu, field, val) do { \
+	struct intel_vgpu_pmu_counters *__c = vgpu_pmu_counters(vgpu); \
+	WRITE_ONCE(__c->field, __c->field + (val)); \
+} while (0)
+
 #define for_each_active_vgpu(gvt, vgpu, id) \
 	idr_for_each_entry((&(gvt)->vgpu_idr), (vgpu), (id)) \
 		for_each_if(vgpu->active)
@@ -491,6 +559,8 @@ void intel_gvt_reset_vgpu_locked(struct intel_vgpu *vgpu, bool dmlr,
 void intel_gvt_reset_vgpu(struct intel_vgpu *vgpu);
 void intel_gvt_activate_vgpu(struct intel_vgpu *vgpu);
 void intel_gvt_deactivate_vgpu(struct intel_vgpu *vgpu);
+int intel_gvt_resize_vgpu(struct intel_vgpu *vgpu, u64 high_gm_sz,
+			  u64 fence_sz);
 
 /* validating GM functions */
 #define vgpu_gmadr_is_aperture(vgpu, gmadr) \
@@ -575,6 +645,10 @@ struct intel_gvt_ops {
 	int (*vgpu_get_dmabuf)(struct intel_vgpu *vgpu, unsigned int);
 	int (*write_protect_handler)(struct intel_vgpu *, u64, void *,
 				     unsigned int);
+	int (*vgpu_set_sched_class)(struct intel_vgpu *vgpu,
+				    enum intel_vgpu_sched_class);
+	int (*vgpu_resize)(struct intel_vgpu *vgpu, u64 high_gm_sz,
+			   u64 fence_sz);
 };
 
 
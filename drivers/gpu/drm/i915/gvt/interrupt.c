@@ -392,11 +392,57 @@ static void init_irq_map(struct intel_gvt_irq *irq)
 }
 
 /* =======================vEvent injection===================== */
-static int inject_virtual_interrupt(struct intel_vgpu *vgpu)
+static int __inject_virtual_interrupt(struct intel_vgpu *vgpu, ktime_t now)
 {
+	struct intel_vgpu_irq *virq = &vgpu->irq;
+
+	virq->deferred = false;
+	virq->last_inject = now;
+
+	virq->stats.injected++;
+	if (ktime_ms_delta(now, virq->stats.rate_start) >= MSEC_PER_SEC) {
+		virq->stats.per_sec = virq->stats.rate_count;
+		virq->stats.rate_start = now;
+		virq->stats.rate_count = 0;
+	}
+	virq->stats.rate_count++;
+
 	return intel_gvt_hypervisor_inject_msi(vgpu);
 }
 
+/*
+ * With gvt_irq_coalesce_us set, at most one MSI per window is injected.
+ * An event inside the window only latches its IIR bit, as usual, and a
+ * timer sends a single MSI at the end of the window, after re-checking
+ * that something is still pending. The guest thus sees every event, in
+ * order, just with fewer interrupts.
+ */
+static int inject_virtual_interrupt(struct intel_vgpu *vgpu)
+{
+	struct intel_vgpu_irq *virq = &vgpu->irq;
+	unsigned int window = READ_ONCE(i915_modparams.gvt_irq_coalesce_us);
+	ktime_t now = ktime_get();
+	ktime_t due;
+
+	if (!window)
+		return __inject_virtual_interrupt(vgpu, now);
+
+	/* The pending MSI of this window will cover the event. */
+	if (virq->deferred && hrtimer_active(&virq->coalesce_timer)) {
+		virq->stats.coalesced++;
+		return 0;
+	}
+
+	due = ktime_add_us(virq->last_inject, window);
+	if (!ktime_before(now, due))
+		return __inject_virtual_interrupt(vgpu, now);
+
+	virq->deferred = true;
+	virq->stats.coalesced++;
+	hrtimer_start(&virq->coalesce_timer, due, HRTIMER_MODE_ABS);
+	return 0;
+}
+
 static void propagate_event(struct intel_gvt_irq *irq,
 	enum intel_gvt_event_type event, struct intel_vgpu *vgpu)
 {
@@ -633,6 +679,65 @@ void intel_vgpu_trigger_virtual_event(struct intel_vgpu *vgpu,
 	ops->check_pending_irq(vgpu);
 }
 
+static enum hrtimer_restart coalesce_timer_fn(struct hrtimer *timer)
+{
+	struct intel_vgpu *vgpu = container_of(timer, struct intel_vgpu,
+					       irq.coalesce_timer);
+
+	/* Injecting reads vGPU registers, leave it to the service thread. */
+	intel_gvt_request_service(vgpu->gvt, INTEL_GVT_REQUEST_DEFERRED_IRQ);
+	return HRTIMER_NORESTART;
+}
+
+/**
+ * intel_gvt_flush_deferred_irqs - inject coalesced interrupts which are due
+ * @gvt: a GVT device
+ *
+ * This function is called by the GVT service thread when the coalescing
+ * window of some vGPU has expired.
+ *
+ */
+void intel_gvt_flush_deferred_irqs(struct intel_gvt *gvt)
+{
+	struct intel_vgpu *vgpu;
+	int id;
+
+	mutex_lock(&gvt->lock);
+	for_each_active_vgpu(gvt, vgpu, id) {
+		mutex_lock(&vgpu->vgpu_lock);
+		if (vgpu->irq.deferred &&
+		    !hrtimer_active(&vgpu->irq.coalesce_timer)) {
+			vgpu->irq.deferred = false;
+			gvt->irq.ops->check_pending_irq(vgpu);
+		}
+		mutex_unlock(&vgpu->vgpu_lock);
+	}
+	mutex_unlock(&gvt->lock);
+}
+
+/**
+ * intel_vgpu_init_irq - initialize the virtual interrupt state of a vGPU
+ * @vgpu: a vGPU
+ *
+ */
+void intel_vgpu_init_irq(struct intel_vgpu *vgpu)
+{
+	hrtimer_init(&vgpu->irq.coalesce_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_ABS);
+	vgpu->irq.coalesce_timer.function = coalesce_timer_fn;
+}
+
+/**
+ * intel_vgpu_clean_irq - clean up the virtual interrupt state of a vGPU
+ * @vgpu: a vGPU
+ *
+ */
+void intel_vgpu_clean_irq(struct intel_vgpu *vgpu)
+{
+	hrtimer_cancel(&vgpu->irq.coalesce_timer);
+	vgpu->irq.deferred = false;
+}
+
 static void init_events(
 	struct intel_gvt_irq *irq)
 {
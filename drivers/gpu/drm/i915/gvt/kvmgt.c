@@ -34,7 +34,7 @@
 #include <linux/mmu_context.h>
 #include <linux/types.h>
 #include <linux/list.h>
-#include <linux/rbtree.h>
+#include <linux/hashtable.h>
 #include <linux/spinlock.h>
 #include <linux/eventfd.h>
 #include <linux/uuid.h>
@@ -90,8 +90,9 @@ struct kvmgt_guest_info {
 
 struct gvt_dma {
 	struct intel_vgpu *vgpu;
-	struct rb_node gfn_node;
-	struct rb_node dma_addr_node;
+	struct hlist_node gfn_node;
+	struct hlist_node dma_addr_node;
+	struct list_head lru;
 	gfn_t gfn;
 	dma_addr_t dma_addr;
 	unsigned long size;
@@ -107,20 +108,55 @@ static int kvmgt_guest_init(struct mdev_device *mdev);
 static void intel_vgpu_release_work(struct work_struct *work);
 static bool kvmgt_guest_exit(struct kvmgt_guest_info *info);
 
+/*
+ * Unused cache entries are kept pinned and mapped on an LRU so a guest
+ * rewriting the same GTT entries does not pay for a pin/unpin cycle each
+ * time. This bounds how many of them are kept around.
+ */
+#define GVT_DMA_CACHE_UNUSED_MAX 4096
+
+static void __gvt_unpin_guest_pages(struct intel_vgpu *vgpu,
+		unsigned long *gfns, int npage)
+{
+	int ret;
+
+	while (npage) {
+		int n = min_t(int, npage, VFIO_PIN_PAGES_MAX_ENTRIES);
+
+		ret = vfio_unpin_pages(mdev_dev(vgpu->vdev.mdev), gfns, n);
+		WARN_ON(ret != n);
+
+		gfns += n;
+		npage -= n;
+	}
+}
+
 static void gvt_unpin_guest_page(struct intel_vgpu *vgpu, unsigned long gfn,
 		unsigned long size)
 {
 	int total_pages;
+	unsigned long *gfns;
 	int npage;
-	int ret;
 
 	total_pages = roundup(size, PAGE_SIZE) / PAGE_SIZE;
 
+	if (total_pages > 1) {
+		gfns = kmalloc_array(total_pages, sizeof(*gfns), GFP_KERNEL);
+		if (gfns) {
+			for (npage = 0; npage < total_pages; npage++)
+				gfns[npage] = gfn + npage;
+
+			__gvt_unpin_guest_pages(vgpu, gfns, total_pages);
+			kfree(gfns);
+			return;
+		}
+	}
+
+	/* Single page, or no memory for the batch: go one by one. */
 	for (npage = 0; npage < total_pages; npage++) {
 		unsigned long cur_gfn = gfn + npage;
 
-		ret = vfio_unpin_pages(mdev_dev(vgpu->vdev.mdev), &cur_gfn, 1);
-		WARN_ON(ret != 1);
+		__gvt_unpin_guest_pages(vgpu, &cur_gfn, 1);
 	}
 }
 
@@ -128,49 +164,78 @@ static void gvt_unpin_guest_page(struct intel_vgpu *vgpu, unsigned long gfn,
 static int gvt_pin_guest_page(struct intel_vgpu *vgpu, unsigned long gfn,
 		unsigned long size, struct page **page)
 {
-	unsigned long base_pfn = 0;
+	unsigned long single_gfn, single_pfn;
+	unsigned long *gfns, *pfns;
 	int total_pages;
+	int pinned = 0;
 	int npage;
 	int ret;
 
 	total_pages = roundup(size, PAGE_SIZE) / PAGE_SIZE;
+
 	/*
-	 * We pin the pages one-by-one to avoid allocating a big arrary
-	 * on stack to hold pfns.
+	 * The whole range is pinned with as few vfio calls as possible,
+	 * each taking the vfio iommu lock only once instead of per page.
 	 */
-	for (npage = 0; npage < total_pages; npage++) {
-		unsigned long cur_gfn = gfn + npage;
-		unsigned long pfn;
+	if (total_pages == 1) {
+		gfns = &single_gfn;
+		pfns = &single_pfn;
+	} else {
+		gfns = kmalloc_array(2 * total_pages, sizeof(*gfns),
+				     GFP_KERNEL);
+		if (!gfns)
+			return -ENOMEM;
+		pfns = gfns + total_pages;
+	}
 
-		ret = vfio_pin_pages(mdev_dev(vgpu->vdev.mdev), &cur_gfn, 1,
-				     IOMMU_READ | IOMMU_WRITE, &pfn);
-		if (ret != 1) {
+	for (npage = 0; npage < total_pages; npage++)
+		gfns[npage] = gfn + npage;
+
+	while (pinned < total_pages) {
+		int n = min_t(int, total_pages - pinned,
+			      VFIO_PIN_PAGES_MAX_ENTRIES);
+
+		ret = vfio_pin_pages(mdev_dev(vgpu->vdev.mdev), gfns + pinned,
+				     n, IOMMU_READ | IOMMU_WRITE,
+				     pfns + pinned);
+		if (ret != n) {
 			gvt_vgpu_err("vfio_pin_pages failed for gfn 0x%lx, ret %d\n",
-				     cur_gfn, ret);
+				     gfns[pinned], ret);
+			/* A short count still pinned the first ret pages */
+			if (ret >= 0) {
+				pinned += ret;
+				ret = -EFAULT;
+			}
 			goto err;
 		}
+		pinned += n;
+	}
 
-		if (!pfn_valid(pfn)) {
-			gvt_vgpu_err("pfn 0x%lx is not mem backed\n", pfn);
-			npage++;
+	for (npage = 0; npage < total_pages; npage++) {
+		if (!pfn_valid(pfns[npage])) {
+			gvt_vgpu_err("pfn 0x%lx is not mem backed\n",
+				     pfns[npage]);
 			ret = -EFAULT;
 			goto err;
 		}
 
-		if (npage == 0)
-			base_pfn = pfn;
-		else if (base_pfn + npage != pfn) {
-			gvt_vgpu_err("The pages are not continuous\n");
+		if (pfns[0] + npage != pfns[npage]) {
+			/* the caller may fall back to smaller pages */
+			gvt_dbg_mm("The pages are not continuous\n");
 			ret = -EINVAL;
-			npage++;
 			goto err;
 		}
 	}
 
-	*page = pfn_to_page(base_pfn);
-	return 0;
+	*page = pfn_to_page(pfns[0]);
+	ret = 0;
+	goto out;
+
 err:
-	gvt_unpin_guest_page(vgpu, gfn, npage * PAGE_SIZE);
+	__gvt_unpin_guest_pages(vgpu, gfns, pinned);
+out:
+	if (gfns != &single_gfn)
+		kfree(gfns);
 	return ret;
 }
 
@@ -209,17 +274,11 @@ static void gvt_dma_unmap_page(struct intel_vgpu *vgpu, unsigned long gfn,
 static struct gvt_dma *__gvt_cache_find_dma_addr(struct intel_vgpu *vgpu,
 		dma_addr_t dma_addr)
 {
-	struct rb_node *node = vgpu->vdev.dma_addr_cache.rb_node;
 	struct gvt_dma *itr;
 
-	while (node) {
-		itr = rb_entry(node, struct gvt_dma, dma_addr_node);
-
-		if (dma_addr < itr->dma_addr)
-			node = node->rb_left;
-		else if (dma_addr > itr->dma_addr)
-			node = node->rb_right;
-		else
+	hash_for_each_possible(vgpu->vdev.dma_addr_cache, itr, dma_addr_node,
+			       dma_addr >> PAGE_SHIFT) {
+		if (itr->dma_addr == dma_addr)
 			return itr;
 	}
 	return NULL;
@@ -227,17 +286,10 @@ static struct gvt_dma *__gvt_cache_find_dma_addr(struct intel_vgpu *vgpu,
 
 static struct gvt_dma *__gvt_cache_find_gfn(struct intel_vgpu *vgpu, gfn_t gfn)
 {
-	struct rb_node *node = vgpu->vdev.gfn_cache.rb_node;
 	struct gvt_dma *itr;
 
-	while (node) {
-		itr = rb_entry(node, struct gvt_dma, gfn_node);
-
-		if (gfn < itr->gfn)
-			node = node->rb_left;
-		else if (gfn > itr->gfn)
-			node = node->rb_right;
-		else
+	hash_for_each_possible(vgpu->vdev.gfn_cache, itr, gfn_node, gfn) {
+		if (itr->gfn == gfn)
 			return itr;
 	}
 	return NULL;
@@ -246,8 +298,7 @@ static struct gvt_dma *__gvt_cache_find_gfn(struct intel_vgpu *vgpu, gfn_t gfn)
 static int __gvt_cache_add(struct intel_vgpu *vgpu, gfn_t gfn,
 		dma_addr_t dma_addr, unsigned long size)
 {
-	struct gvt_dma *new, *itr;
-	struct rb_node **link, *parent = NULL;
+	struct gvt_dma *new;
 
 	new = kzalloc(sizeof(struct gvt_dma), GFP_KERNEL);
 	if (!new)
@@ -257,75 +308,153 @@ static int __gvt_cache_add(struct intel_vgpu *vgpu, gfn_t gfn,
 	new->gfn = gfn;
 	new->dma_addr = dma_addr;
 	new->size = size;
+	INIT_LIST_HEAD(&new->lru);
 	kref_init(&new->ref);
 
 	/* gfn_cache maps gfn to struct gvt_dma. */
-	link = &vgpu->vdev.gfn_cache.rb_node;
-	while (*link) {
-		parent = *link;
-		itr = rb_entry(parent, struct gvt_dma, gfn_node);
-
-		if (gfn < itr->gfn)
-			link = &parent->rb_left;
-		else
-			link = &parent->rb_right;
-	}
-	rb_link_node(&new->gfn_node, parent, link);
-	rb_insert_color(&new->gfn_node, &vgpu->vdev.gfn_cache);
-
+	hash_add(vgpu->vdev.gfn_cache, &new->gfn_node, gfn);
 	/* dma_addr_cache maps dma addr to struct gvt_dma. */
-	parent = NULL;
-	link = &vgpu->vdev.dma_addr_cache.rb_node;
-	while (*link) {
-		parent = *link;
-		itr = rb_entry(parent, struct gvt_dma, dma_addr_node);
-
-		if (dma_addr < itr->dma_addr)
-			link = &parent->rb_left;
-		else
-			link = &parent->rb_right;
-	}
-	rb_link_node(&new->dma_addr_node, parent, link);
-	rb_insert_color(&new->dma_addr_node, &vgpu->vdev.dma_addr_cache);
+	hash_add(vgpu->vdev.dma_addr_cache, &new->dma_addr_node,
+		 dma_addr >> PAGE_SHIFT);
 
 	vgpu->vdev.nr_cache_entries++;
 	return 0;
 }
 
+/* Unlink an entry from the lookups and the LRU, leaving it pinned. */
+static void __gvt_cache_unlink_entry(struct intel_vgpu *vgpu,
+				struct gvt_dma *entry)
+{
+	hash_del(&entry->gfn_node);
+	hash_del(&entry->dma_addr_node);
+	if (!list_empty(&entry->lru)) {
+		list_del_init(&entry->lru);
+		vgpu->vdev.nr_unused_entries--;
+	}
+	vgpu->vdev.nr_cache_entries--;
+}
+
 static void __gvt_cache_remove_entry(struct intel_vgpu *vgpu,
 				struct gvt_dma *entry)
 {
-	rb_erase(&entry->gfn_node, &vgpu->vdev.gfn_cache);
-	rb_erase(&entry->dma_addr_node, &vgpu->vdev.dma_addr_cache);
+	__gvt_cache_unlink_entry(vgpu, entry);
 	kfree(entry);
-	vgpu->vdev.nr_cache_entries--;
+}
+
+static void gvt_cache_evict_entry(struct intel_vgpu *vgpu,
+				struct gvt_dma *entry)
+{
+	gvt_dma_unmap_page(vgpu, entry->gfn, entry->dma_addr, entry->size);
+	__gvt_cache_remove_entry(vgpu, entry);
+}
+
+/* Called with cache_lock held, when the last user of an entry is gone. */
+static void __gvt_dma_release(struct kref *ref)
+{
+	struct gvt_dma *entry = container_of(ref, typeof(*entry), ref);
+	struct intel_vgpu *vgpu = entry->vgpu;
+
+	list_add_tail(&entry->lru, &vgpu->vdev.dma_lru);
+	vgpu->vdev.nr_unused_entries++;
+
+	if (vgpu->vdev.nr_unused_entries > GVT_DMA_CACHE_UNUSED_MAX)
+		gvt_cache_evict_entry(vgpu,
+				      list_first_entry(&vgpu->vdev.dma_lru,
+						       struct gvt_dma, lru));
+}
+
+static void gvt_dma_reclaim_work(struct work_struct *work)
+{
+	struct intel_vgpu *vgpu = container_of(work, struct intel_vgpu,
+					       vdev.dma_reclaim_work);
+	struct gvt_dma *entry, *next;
+	LIST_HEAD(reclaim);
+
+	mutex_lock(&vgpu->vdev.cache_lock);
+	list_splice_init(&vgpu->vdev.dma_reclaim, &reclaim);
+	mutex_unlock(&vgpu->vdev.cache_lock);
+
+	list_for_each_entry_safe(entry, next, &reclaim, lru) {
+		gvt_dma_unmap_page(vgpu, entry->gfn, entry->dma_addr,
+				   entry->size);
+		kfree(entry);
+	}
+}
+
+static unsigned long gvt_dma_shrinker_count(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	struct intel_vgpu *vgpu = container_of(shrinker, struct intel_vgpu,
+					       vdev.dma_shrinker);
+
+	return READ_ONCE(vgpu->vdev.nr_unused_entries);
+}
+
+static unsigned long gvt_dma_shrinker_scan(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	struct intel_vgpu *vgpu = container_of(shrinker, struct intel_vgpu,
+					       vdev.dma_shrinker);
+	struct gvt_dma *entry;
+	unsigned long freed = 0;
+
+	/* We may be reclaiming on behalf of an allocation under cache_lock. */
+	if (!mutex_trylock(&vgpu->vdev.cache_lock))
+		return SHRINK_STOP;
+
+	/*
+	 * Unpinning takes the vfio iommu lock, which may be held by someone
+	 * allocating memory, so hand the pages to a worker instead.
+	 */
+	while (freed < sc->nr_to_scan && !list_empty(&vgpu->vdev.dma_lru)) {
+		entry = list_first_entry(&vgpu->vdev.dma_lru,
+					 struct gvt_dma, lru);
+		__gvt_cache_unlink_entry(vgpu, entry);
+		list_add_tail(&entry->lru, &vgpu->vdev.dma_reclaim);
+		freed++;
+	}
+
+	mutex_unlock(&vgpu->vdev.cache_lock);
+
+	if (freed)
+		schedule_work(&vgpu->vdev.dma_reclaim_work);
+
+	return freed;
 }
 
 static void gvt_cache_destroy(struct intel_vgpu *vgpu)
 {
 	struct gvt_dma *dma;
-	struct rb_node *node = NULL;
+	struct hlist_node *tmp;
+	int i;
 
-	for (;;) {
-		mutex_lock(&vgpu->vdev.cache_lock);
-		node = rb_first(&vgpu->vdev.gfn_cache);
-		if (!node) {
-			mutex_unlock(&vgpu->vdev.cache_lock);
-			break;
-		}
-		dma = rb_entry(node, struct gvt_dma, gfn_node);
-		gvt_dma_unmap_page(vgpu, dma->gfn, dma->dma_addr, dma->size);
-		__gvt_cache_remove_entry(vgpu, dma);
-		mutex_unlock(&vgpu->vdev.cache_lock);
+	unregister_shrinker(&vgpu->vdev.dma_shrinker);
+	flush_work(&vgpu->vdev.dma_reclaim_work);
+
+	mutex_lock(&vgpu->vdev.cache_lock);
+	hash_for_each_safe(vgpu->vdev.gfn_cache, i, tmp, dma, gfn_node) {
+		gvt_cache_evict_entry(vgpu, dma);
+		cond_resched();
 	}
+	mutex_unlock(&vgpu->vdev.cache_lock);
 }
 
 static void gvt_cache_init(struct intel_vgpu *vgpu)
 {
-	vgpu->vdev.gfn_cache = RB_ROOT;
-	vgpu->vdev.dma_addr_cache = RB_ROOT;
+	hash_init(vgpu->vdev.gfn_cache);
+	hash_init(vgpu->vdev.dma_addr_cache);
 	vgpu->vdev.nr_cache_entries = 0;
+	INIT_LIST_HEAD(&vgpu->vdev.dma_lru);
+	vgpu->vdev.nr_unused_entries = 0;
+	INIT_LIST_HEAD(&vgpu->vdev.dma_reclaim);
+	INIT_WORK(&vgpu->vdev.dma_reclaim_work, gvt_dma_reclaim_work);
 	mutex_init(&vgpu->vdev.cache_lock);
+
+	vgpu->vdev.dma_shrinker.count_objects = gvt_dma_shrinker_count;
+	vgpu->vdev.dma_shrinker.scan_objects = gvt_dma_shrinker_scan;
+	vgpu->vdev.dma_shrinker.seeks = DEFAULT_SEEKS;
+	if (register_shrinker(&vgpu->vdev.dma_shrinker))
+		gvt_vgpu_err("Cannot register the dma cache shrinker\n");
 }
 
 static void kvmgt_protect_table_init(struct kvmgt_guest_info *info)
@@ -490,6 +619,15 @@ static int kvmgt_set_opregion(void *p_vgpu)
 	return ret;
 }
 
+/* Called with vgpu_lock held, from the vblank emulation. */
+static void kvmgt_notify_display_change(void *p_vgpu)
+{
+	struct intel_vgpu *vgpu = (struct intel_vgpu *)p_vgpu;
+
+	if (vgpu->vdev.display_trigger)
+		eventfd_signal(vgpu->vdev.display_trigger, 1);
+}
+
 static void kvmgt_put_vfio_device(void *vgpu)
 {
 	if (WARN_ON(!((struct intel_vgpu *)vgpu)->vdev.vfio_device))
@@ -569,11 +707,12 @@ static int intel_vgpu_iommu_notifier(struct notifier_block *nb,
 			if (!entry)
 				continue;
 
-			gvt_dma_unmap_page(vgpu, entry->gfn, entry->dma_addr,
-					   entry->size);
-			__gvt_cache_remove_entry(vgpu, entry);
+			gvt_cache_evict_entry(vgpu, entry);
 		}
 		mutex_unlock(&vgpu->vdev.cache_lock);
+
+		/* vfio expects every page in the range unpinned on return */
+		flush_work(&vgpu->vdev.dma_reclaim_work);
 	}
 
 	return NOTIFY_OK;
@@ -655,6 +794,19 @@ static void intel_vgpu_release_msi_eventfd_ctx(struct intel_vgpu *vgpu)
 	}
 }
 
+static void intel_vgpu_release_display_eventfd_ctx(struct intel_vgpu *vgpu)
+{
+	struct eventfd_ctx *trigger;
+
+	mutex_lock(&vgpu->vgpu_lock);
+	trigger = vgpu->vdev.display_trigger;
+	vgpu->vdev.display_trigger = NULL;
+	mutex_unlock(&vgpu->vgpu_lock);
+
+	if (trigger)
+		eventfd_ctx_put(trigger);
+}
+
 static void __intel_vgpu_release(struct intel_vgpu *vgpu)
 {
 	struct kvmgt_guest_info *info;
@@ -680,6 +832,7 @@ static void __intel_vgpu_release(struct intel_vgpu *vgpu)
 	kvmgt_guest_exit(info);
 
 	intel_vgpu_release_msi_eventfd_ctx(vgpu);
+	intel_vgpu_release_display_eventfd_ctx(vgpu);
 
 	vgpu->vdev.kvm = NULL;
 	vgpu->handle = 0;
@@ -1016,9 +1169,18 @@ static int intel_vgpu_mmap(struct mdev_device *mdev, struct vm_area_struct *vma)
 	return remap_pfn_range(vma, virtaddr, pgoff, req_size, pg_prot);
 }
 
+/*
+ * Device specific interrupt, right after the PCI ones: signalled when the
+ * guest flips a plane, so display consumers can re-query the planes and
+ * their dmabufs instead of polling them.
+ */
+#define INTEL_VGPU_DISPLAY_IRQ_INDEX	VFIO_PCI_NUM_IRQS
+#define INTEL_VGPU_NUM_IRQS		(INTEL_VGPU_DISPLAY_IRQ_INDEX + 1)
+
 static int intel_vgpu_get_irq_count(struct intel_vgpu *vgpu, int type)
 {
-	if (type == VFIO_PCI_INTX_IRQ_INDEX || type == VFIO_PCI_MSI_IRQ_INDEX)
+	if (type == VFIO_PCI_INTX_IRQ_INDEX || type == VFIO_PCI_MSI_IRQ_INDEX ||
+	    type == INTEL_VGPU_DISPLAY_IRQ_INDEX)
 		return 1;
 
 	return 0;
@@ -1067,6 +1229,34 @@ static int intel_vgpu_set_msi_trigger(struct intel_vgpu *vgpu,
 	return 0;
 }
 
+static int intel_vgpu_set_display_trigger(struct intel_vgpu *vgpu,
+		unsigned int index, unsigned int start, unsigned int count,
+		uint32_t flags, void *data)
+{
+	struct eventfd_ctx *trigger, *old;
+
+	if (flags & VFIO_IRQ_SET_DATA_EVENTFD) {
+		int fd = *(int *)data;
+
+		trigger = eventfd_ctx_fdget(fd);
+		if (IS_ERR(trigger)) {
+			gvt_vgpu_err("eventfd_ctx_fdget failed\n");
+			return PTR_ERR(trigger);
+		}
+
+		mutex_lock(&vgpu->vgpu_lock);
+		old = vgpu->vdev.display_trigger;
+		vgpu->vdev.display_trigger = trigger;
+		mutex_unlock(&vgpu->vgpu_lock);
+
+		if (old)
+			eventfd_ctx_put(old);
+	} else if ((flags & VFIO_IRQ_SET_DATA_NONE) && !count)
+		intel_vgpu_release_display_eventfd_ctx(vgpu);
+
+	return 0;
+}
+
 static int intel_vgpu_set_irqs(struct intel_vgpu *vgpu, uint32_t flags,
 		unsigned int index, unsigned int start, unsigned int count,
 		void *data)
@@ -1100,6 +1290,11 @@ static int intel_vgpu_set_irqs(struct intel_vgpu *vgpu, uint32_t flags,
 			break;
 		}
 		break;
+	case INTEL_VGPU_DISPLAY_IRQ_INDEX:
+		if ((flags & VFIO_IRQ_SET_ACTION_TYPE_MASK) ==
+		    VFIO_IRQ_SET_ACTION_TRIGGER)
+			func = intel_vgpu_set_display_trigger;
+		break;
 	}
 
 	if (!func)
@@ -1131,7 +1326,7 @@ static long intel_vgpu_ioctl(struct mdev_device *mdev, unsigned int cmd,
 		info.flags |= VFIO_DEVICE_FLAGS_RESET;
 		info.num_regions = VFIO_PCI_NUM_REGIONS +
 				vgpu->vdev.num_regions;
-		info.num_irqs = VFIO_PCI_NUM_IRQS;
+		info.num_irqs = INTEL_VGPU_NUM_IRQS;
 
 		return copy_to_user((void __user *)arg, &info, minsz) ?
 			-EFAULT : 0;
@@ -1288,12 +1483,13 @@ static long intel_vgpu_ioctl(struct mdev_device *mdev, unsigned int cmd,
 		if (copy_from_user(&info, (void __user *)arg, minsz))
 			return -EFAULT;
 
-		if (info.argsz < minsz || info.index >= VFIO_PCI_NUM_IRQS)
+		if (info.argsz < minsz || info.index >= INTEL_VGPU_NUM_IRQS)
 			return -EINVAL;
 
 		switch (info.index) {
 		case VFIO_PCI_INTX_IRQ_INDEX:
 		case VFIO_PCI_MSI_IRQ_INDEX:
+		case INTEL_VGPU_DISPLAY_IRQ_INDEX:
 			break;
 		default:
 			return -EINVAL;
@@ -1326,7 +1522,7 @@ static long intel_vgpu_ioctl(struct mdev_device *mdev, unsigned int cmd,
 			int max = intel_vgpu_get_irq_count(vgpu, hdr.index);
 
 			ret = vfio_set_irqs_validate_and_prepare(&hdr, max,
-						VFIO_PCI_NUM_IRQS, &data_size);
+						INTEL_VGPU_NUM_IRQS, &data_size);
 			if (ret) {
 				gvt_vgpu_err("intel:vfio_set_irqs_validate_and_prepare failed\n");
 				return -EINVAL;
@@ -1402,18 +1598,149 @@ hw_id_show(struct device *dev, struct device_attribute *attr,
 	if (mdev) {
 		struct intel_vgpu *vgpu = (struct intel_vgpu *)
 			mdev_get_drvdata(mdev);
-		return sprintf(buf, "%u\n",
-			       vgpu->submission.shadow_ctx->hw_id);
+		struct i915_gem_context *ctx = vgpu->submission.shadow_ctx;
+
+		if (!ctx)
+			return sprintf(buf, "\n");
+		return sprintf(buf, "%u\n", ctx->hw_id);
+	}
+	return sprintf(buf, "\n");
+}
+
+static const char * const sched_class_names[] = {
+	[INTEL_VGPU_SCHED_INTERACTIVE] = "interactive",
+	[INTEL_VGPU_SCHED_THROUGHPUT] = "throughput",
+};
+
+static ssize_t
+sched_class_show(struct device *dev, struct device_attribute *attr,
+		 char *buf)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+
+	if (mdev) {
+		struct intel_vgpu *vgpu = (struct intel_vgpu *)
+			mdev_get_drvdata(mdev);
+		return sprintf(buf, "%s\n",
+			       sched_class_names[vgpu->sched_ctl.sched_class]);
+	}
+	return sprintf(buf, "\n");
+}
+
+static ssize_t
+sched_class_store(struct device *dev, struct device_attribute *attr,
+		  const char *buf, size_t count)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+	struct intel_vgpu *vgpu;
+	int ret;
+
+	if (!mdev)
+		return -ENODEV;
+
+	vgpu = (struct intel_vgpu *)mdev_get_drvdata(mdev);
+
+	ret = sysfs_match_string(sched_class_names, buf);
+	if (ret < 0)
+		return ret;
+
+	ret = intel_gvt_ops->vgpu_set_sched_class(vgpu, ret);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+static ssize_t
+high_gm_size_show(struct device *dev, struct device_attribute *attr,
+		  char *buf)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+
+	if (mdev) {
+		struct intel_vgpu *vgpu = (struct intel_vgpu *)
+			mdev_get_drvdata(mdev);
+		return sprintf(buf, "%llu\n", BYTES_TO_MB(vgpu_hidden_sz(vgpu)));
+	}
+	return sprintf(buf, "\n");
+}
+
+static ssize_t
+high_gm_size_store(struct device *dev, struct device_attribute *attr,
+		   const char *buf, size_t count)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+	struct intel_vgpu *vgpu;
+	u64 size;
+	int ret;
+
+	if (!mdev)
+		return -ENODEV;
+
+	vgpu = (struct intel_vgpu *)mdev_get_drvdata(mdev);
+
+	ret = kstrtou64(buf, 0, &size);
+	if (ret)
+		return ret;
+
+	ret = intel_gvt_ops->vgpu_resize(vgpu, size, vgpu_fence_sz(vgpu));
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+static ssize_t
+fence_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+
+	if (mdev) {
+		struct intel_vgpu *vgpu = (struct intel_vgpu *)
+			mdev_get_drvdata(mdev);
+		return sprintf(buf, "%u\n", vgpu_fence_sz(vgpu));
 	}
 	return sprintf(buf, "\n");
 }
 
+static ssize_t
+fence_store(struct device *dev, struct device_attribute *attr,
+	    const char *buf, size_t count)
+{
+	struct mdev_device *mdev = mdev_from_dev(dev);
+	struct intel_vgpu *vgpu;
+	u64 fence;
+	int ret;
+
+	if (!mdev)
+		return -ENODEV;
+
+	vgpu = (struct intel_vgpu *)mdev_get_drvdata(mdev);
+
+	ret = kstrtou64(buf, 0, &fence);
+	if (ret)
+		return ret;
+
+	ret = intel_gvt_ops->vgpu_resize(vgpu,
+			BYTES_TO_MB(vgpu_hidden_sz(vgpu)), fence);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
 static DEVICE_ATTR_RO(vgpu_id);
 static DEVICE_ATTR_RO(hw_id);
+static DEVICE_ATTR_RW(sched_class);
+static DEVICE_ATTR_RW(high_gm_size);
+static DEVICE_ATTR_RW(fence);
 
 static struct attribute *intel_vgpu_attrs[] = {
 	&dev_attr_vgpu_id.attr,
 	&dev_attr_hw_id.attr,
+	&dev_attr_sched_class.attr,
+	&dev_attr_high_gm_size.attr,
+	&dev_attr_fence.attr,
 	NULL
 };
 
@@ -1719,6 +2046,12 @@ int kvmgt_dma_map_guest_page(unsigned long handle, unsigned long gfn,
 	mutex_lock(&info->vgpu->vdev.cache_lock);
 
 	entry = __gvt_cache_find_gfn(info->vgpu, gfn);
+	if (entry && entry->size != size && !list_empty(&entry->lru)) {
+		/* An idle mapping of the wrong size, just replace it. */
+		gvt_cache_evict_entry(vgpu, entry);
+		entry = NULL;
+	}
+
 	if (!entry) {
 		ret = gvt_dma_map_page(vgpu, gfn, dma_addr, size);
 		if (ret)
@@ -1727,6 +2060,12 @@ int kvmgt_dma_map_guest_page(unsigned long handle, unsigned long gfn,
 		ret = __gvt_cache_add(info->vgpu, gfn, *dma_addr, size);
 		if (ret)
 			goto err_unmap;
+	} else if (!list_empty(&entry->lru)) {
+		/* Revive an unused entry, it is still pinned and mapped. */
+		list_del_init(&entry->lru);
+		vgpu->vdev.nr_unused_entries--;
+		kref_init(&entry->ref);
+		*dma_addr = entry->dma_addr;
 	} else {
 		kref_get(&entry->ref);
 		*dma_addr = entry->dma_addr;
@@ -1742,15 +2081,6 @@ int kvmgt_dma_map_guest_page(unsigned long handle, unsigned long gfn,
 	return ret;
 }
 
-static void __gvt_dma_release(struct kref *ref)
-{
-	struct gvt_dma *entry = container_of(ref, typeof(*entry), ref);
-
-	gvt_dma_unmap_page(entry->vgpu, entry->gfn, entry->dma_addr,
-			   entry->size);
-	__gvt_cache_remove_entry(entry->vgpu, entry);
-}
-
 void kvmgt_dma_unmap_guest_page(unsigned long handle, dma_addr_t dma_addr)
 {
 	struct kvmgt_guest_info *info;
@@ -1763,7 +2093,7 @@ void kvmgt_dma_unmap_guest_page(unsigned long handle, dma_addr_t dma_addr)
 
 	mutex_lock(&info->vgpu->vdev.cache_lock);
 	entry = __gvt_cache_find_dma_addr(info->vgpu, dma_addr);
-	if (entry)
+	if (entry && list_empty(&entry->lru))
 		kref_put(&entry->ref, __gvt_dma_release);
 	mutex_unlock(&info->vgpu->vdev.cache_lock);
 }
@@ -1846,6 +2176,7 @@ struct intel_gvt_mpt kvmgt_mpt = {
 	.get_vfio_device = kvmgt_get_vfio_device,
 	.put_vfio_device = kvmgt_put_vfio_device,
 	.is_valid_gfn = kvmgt_is_valid_gfn,
+	.notify_display_change = kvmgt_notify_display_change,
 };
 EXPORT_SYMBOL_GPL(kvmgt_mpt);
 
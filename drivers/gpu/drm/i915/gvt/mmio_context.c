@@ -504,7 +504,7 @@ static void switch_mmio(struct intel_vgpu *pre,
 			 * image if it's not inhibit context, it will restore
 			 * itself.
 			 */
-			if (mmio->in_context &&
+			if (mmio->in_context && s->shadow_ctx &&
 			    !is_inhibit_context(&s->shadow_ctx->__engine[ring_id]))
 				continue;
 
@@ -522,6 +522,16 @@ static void switch_mmio(struct intel_vgpu *pre,
 				new_v = mmio->value;
 		}
 
+		/*
+		 * old_v is what the hardware holds right now, so skip the
+		 * write if it already has the value of the incoming owner.
+		 * Most of these registers are the same for all the vGPUs and
+		 * the host. For masked registers only the masked bits count.
+		 */
+		if (mmio->mask ? !((old_v ^ new_v) & mmio->mask) :
+				 old_v == new_v)
+			continue;
+
 		I915_WRITE_FW(mmio->reg, new_v);
 
 		trace_render_mmio(pre ? pre->id : 0,
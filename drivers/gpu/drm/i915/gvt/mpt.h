@@ -345,6 +345,20 @@ static inline void intel_gvt_hypervisor_put_vfio_device(struct intel_vgpu *vgpu)
 	intel_gvt_host.mpt->put_vfio_device(vgpu);
 }
 
+/**
+ * intel_gvt_hypervisor_notify_display_change - tell display consumers that
+ * the guest has flipped
+ * @vgpu: a vGPU
+ */
+static inline void intel_gvt_hypervisor_notify_display_change(
+		struct intel_vgpu *vgpu)
+{
+	if (!intel_gvt_host.mpt->notify_display_change)
+		return;
+
+	intel_gvt_host.mpt->notify_display_change(vgpu);
+}
+
 /**
  * intel_gvt_hypervisor_is_valid_gfn - check if a visible gfn
  * @vgpu: a vGPU
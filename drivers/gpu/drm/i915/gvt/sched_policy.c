@@ -56,8 +56,19 @@ struct vgpu_sched_data {
 	ktime_t sched_time;
 	ktime_t left_ts;
 	ktime_t allocated_ts;
+	/* start of the current stay on the GPU */
+	ktime_t quantum_start;
+	/* oldest pending workload while not scheduled in, or 0 */
+	ktime_t pending_since;
 
 	struct vgpu_sched_ctl sched_ctl;
+
+	struct {
+		u64 sched_in;
+		u64 delay_count;
+		ktime_t delay_total;
+		ktime_t delay_max;
+	} stats;
 };
 
 struct gvt_sched_data {
@@ -79,13 +90,23 @@ static void vgpu_update_timeslice(struct intel_vgpu *vgpu, ktime_t cur_time)
 	vgpu_data = vgpu->sched_data;
 	delta_ts = ktime_sub(cur_time, vgpu_data->sched_in_time);
 	vgpu_data->sched_time = ktime_add(vgpu_data->sched_time, delta_ts);
+	vgpu_pmu_add(vgpu, busy_ns, ktime_to_ns(delta_ts));
 	vgpu_data->left_ts = ktime_sub(vgpu_data->left_ts, delta_ts);
 	vgpu_data->sched_in_time = cur_time;
 }
 
-#define GVT_TS_BALANCE_PERIOD_MS 100
 #define GVT_TS_BALANCE_STAGE_NUM 10
 
+static unsigned int gvt_balance_period_ms(void)
+{
+	return max(i915_modparams.gvt_balance_period_ms, 1u);
+}
+
+static u64 gvt_timeslice_ns(void)
+{
+	return (u64)max(i915_modparams.gvt_timeslice_us, 1u) * NSEC_PER_USEC;
+}
+
 static void gvt_balance_timeslice(struct gvt_sched_data *sched_data)
 {
 	struct vgpu_sched_data *vgpu_data;
@@ -107,7 +128,7 @@ static void gvt_balance_timeslice(struct gvt_sched_data *sched_data)
 
 		list_for_each(pos, &sched_data->lru_runq_head) {
 			vgpu_data = container_of(pos, struct vgpu_sched_data, lru_list);
-			fair_timeslice = ktime_divns(ms_to_ktime(GVT_TS_BALANCE_PERIOD_MS),
+			fair_timeslice = ktime_divns(ms_to_ktime(gvt_balance_period_ms()),
 						     total_weight) * vgpu_data->sched_ctl.weight;
 
 			vgpu_data->allocated_ts = fair_timeslice;
@@ -117,8 +138,8 @@ static void gvt_balance_timeslice(struct gvt_sched_data *sched_data)
 		list_for_each(pos, &sched_data->lru_runq_head) {
 			vgpu_data = container_of(pos, struct vgpu_sched_data, lru_list);
 
-			/* timeslice for next 100ms should add the left/debt
-			 * slice of previous stages.
+			/* timeslice for next balance period should add the
+			 * left/debt slice of previous stages.
 			 */
 			vgpu_data->left_ts += vgpu_data->allocated_ts;
 		}
@@ -157,6 +178,21 @@ static void try_to_schedule_next_vgpu(struct intel_gvt *gvt)
 	vgpu_update_timeslice(scheduler->current_vgpu, cur_time);
 	vgpu_data = scheduler->next_vgpu->sched_data;
 	vgpu_data->sched_in_time = cur_time;
+	vgpu_data->quantum_start = cur_time;
+
+	vgpu_data->stats.sched_in++;
+	if (vgpu_data->pending_since) {
+		ktime_t delay = ktime_sub(cur_time, vgpu_data->pending_since);
+
+		vgpu_data->stats.delay_count++;
+		vgpu_data->stats.delay_total =
+			ktime_add(vgpu_data->stats.delay_total, delay);
+		if (delay > vgpu_data->stats.delay_max)
+			vgpu_data->stats.delay_max = delay;
+		vgpu_pmu_add(scheduler->next_vgpu, sched_delay_ns,
+			     ktime_to_ns(delay));
+		vgpu_data->pending_since = 0;
+	}
 
 	/* switch current vgpu */
 	scheduler->current_vgpu = scheduler->next_vgpu;
@@ -169,7 +205,9 @@ static void try_to_schedule_next_vgpu(struct intel_gvt *gvt)
 		wake_up(&scheduler->waitq[i]);
 }
 
-static struct intel_vgpu *find_busy_vgpu(struct gvt_sched_data *sched_data)
+static struct intel_vgpu *
+find_busy_vgpu(struct gvt_sched_data *sched_data,
+	       enum intel_vgpu_sched_class sched_class)
 {
 	struct vgpu_sched_data *vgpu_data;
 	struct intel_vgpu *vgpu = NULL;
@@ -180,6 +218,9 @@ static struct intel_vgpu *find_busy_vgpu(struct gvt_sched_data *sched_data)
 	list_for_each(pos, head) {
 
 		vgpu_data = container_of(pos, struct vgpu_sched_data, lru_list);
+		if (vgpu_data->sched_ctl.sched_class != sched_class)
+			continue;
+
 		if (!vgpu_has_pending_workload(vgpu_data->vgpu))
 			continue;
 
@@ -193,8 +234,43 @@ static struct intel_vgpu *find_busy_vgpu(struct gvt_sched_data *sched_data)
 	return vgpu;
 }
 
-/* in nanosecond */
-#define GVT_DEFAULT_TIME_SLICE 1000000
+/* Note when workloads become pending for the scheduling delay statistics */
+static void update_pending_since(struct gvt_sched_data *sched_data,
+				 ktime_t cur_time)
+{
+	struct intel_vgpu *current_vgpu = sched_data->gvt->scheduler.current_vgpu;
+	struct vgpu_sched_data *vgpu_data;
+
+	list_for_each_entry(vgpu_data, &sched_data->lru_runq_head, lru_list) {
+		if (vgpu_data->vgpu == current_vgpu ||
+		    !vgpu_has_pending_workload(vgpu_data->vgpu))
+			vgpu_data->pending_since = 0;
+		else if (!vgpu_data->pending_since)
+			vgpu_data->pending_since = cur_time;
+	}
+}
+
+/*
+ * A throughput vGPU which is still busy and has timeslice left keeps the GPU
+ * until its quantum expires, unless an interactive vGPU needs it.
+ */
+static bool throughput_quantum_left(struct intel_vgpu *vgpu, ktime_t cur_time)
+{
+	struct vgpu_sched_data *vgpu_data;
+
+	if (!vgpu || vgpu == vgpu->gvt->idle_vgpu)
+		return false;
+
+	vgpu_data = vgpu->sched_data;
+	if (vgpu_data->sched_ctl.sched_class != INTEL_VGPU_SCHED_THROUGHPUT)
+		return false;
+
+	if (vgpu_data->left_ts <= 0 || !vgpu_has_pending_workload(vgpu))
+		return false;
+
+	return ktime_us_delta(cur_time, vgpu_data->quantum_start) <
+	       i915_modparams.gvt_batch_timeslice_us;
+}
 
 static void tbs_sched_func(struct gvt_sched_data *sched_data)
 {
@@ -202,11 +278,21 @@ static void tbs_sched_func(struct gvt_sched_data *sched_data)
 	struct intel_gvt_workload_scheduler *scheduler = &gvt->scheduler;
 	struct vgpu_sched_data *vgpu_data;
 	struct intel_vgpu *vgpu = NULL;
+	ktime_t cur_time = ktime_get();
+
+	update_pending_since(sched_data, cur_time);
+
 	/* no active vgpu or has already had a target */
 	if (list_empty(&sched_data->lru_runq_head) || scheduler->next_vgpu)
 		goto out;
 
-	vgpu = find_busy_vgpu(sched_data);
+	vgpu = find_busy_vgpu(sched_data, INTEL_VGPU_SCHED_INTERACTIVE);
+	if (!vgpu) {
+		if (throughput_quantum_left(scheduler->current_vgpu, cur_time))
+			goto out;
+
+		vgpu = find_busy_vgpu(sched_data, INTEL_VGPU_SCHED_THROUGHPUT);
+	}
 	if (vgpu) {
 		scheduler->next_vgpu = vgpu;
 
@@ -236,7 +322,7 @@ void intel_gvt_schedule(struct intel_gvt *gvt)
 		if (cur_time >= sched_data->expire_time) {
 			gvt_balance_timeslice(sched_data);
 			sched_data->expire_time = ktime_add_ms(
-				cur_time, GVT_TS_BALANCE_PERIOD_MS);
+				cur_time, gvt_balance_period_ms());
 		}
 	}
 	clear_bit(INTEL_GVT_REQUEST_EVENT_SCHED, (void *)&gvt->service_request);
@@ -255,6 +341,7 @@ static enum hrtimer_restart tbs_timer_fn(struct hrtimer *timer_data)
 
 	intel_gvt_request_service(data->gvt, INTEL_GVT_REQUEST_SCHED);
 
+	data->period = gvt_timeslice_ns();
 	hrtimer_add_expires_ns(&data->timer, data->period);
 
 	return HRTIMER_RESTART;
@@ -274,7 +361,7 @@ static int tbs_sched_init(struct intel_gvt *gvt)
 	INIT_LIST_HEAD(&data->lru_runq_head);
 	hrtimer_init(&data->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
 	data->timer.function = tbs_timer_fn;
-	data->period = GVT_DEFAULT_TIME_SLICE;
+	data->period = gvt_timeslice_ns();
 	data->gvt = gvt;
 
 	scheduler->sched_data = data;
@@ -303,6 +390,7 @@ static int tbs_sched_init_vgpu(struct intel_vgpu *vgpu)
 		return -ENOMEM;
 
 	data->sched_ctl.weight = vgpu->sched_ctl.weight;
+	data->sched_ctl.sched_class = vgpu->sched_ctl.sched_class;
 	data->vgpu = vgpu;
 	INIT_LIST_HEAD(&data->lru_list);
 
@@ -413,6 +501,51 @@ void intel_vgpu_start_schedule(struct intel_vgpu *vgpu)
 	mutex_unlock(&vgpu->gvt->sched_lock);
 }
 
+/**
+ * intel_vgpu_set_sched_class - set the latency class of a vGPU
+ * @vgpu: a vGPU
+ * @sched_class: the new latency class
+ *
+ * Returns:
+ * Zero on success, negative error code if failed.
+ */
+int intel_vgpu_set_sched_class(struct intel_vgpu *vgpu,
+			       enum intel_vgpu_sched_class sched_class)
+{
+	struct vgpu_sched_data *vgpu_data = vgpu->sched_data;
+
+	if (sched_class != INTEL_VGPU_SCHED_INTERACTIVE &&
+	    sched_class != INTEL_VGPU_SCHED_THROUGHPUT)
+		return -EINVAL;
+
+	mutex_lock(&vgpu->gvt->sched_lock);
+	vgpu->sched_ctl.sched_class = sched_class;
+	vgpu_data->sched_ctl.sched_class = sched_class;
+	mutex_unlock(&vgpu->gvt->sched_lock);
+
+	return 0;
+}
+
+/**
+ * intel_vgpu_get_sched_stats - read the scheduling statistics of a vGPU
+ * @vgpu: a vGPU
+ * @stats: returns the statistics
+ */
+void intel_vgpu_get_sched_stats(struct intel_vgpu *vgpu,
+				struct intel_vgpu_sched_stats *stats)
+{
+	struct vgpu_sched_data *vgpu_data = vgpu->sched_data;
+
+	mutex_lock(&vgpu->gvt->sched_lock);
+	stats->sched_class = vgpu_data->sched_ctl.sched_class;
+	stats->busy_ns = ktime_to_ns(vgpu_data->sched_time);
+	stats->sched_in = vgpu_data->stats.sched_in;
+	stats->delay_count = vgpu_data->stats.delay_count;
+	stats->delay_total_ns = ktime_to_ns(vgpu_data->stats.delay_total);
+	stats->delay_max_ns = ktime_to_ns(vgpu_data->stats.delay_max);
+	mutex_unlock(&vgpu->gvt->sched_lock);
+}
+
 void intel_gvt_kick_schedule(struct intel_gvt *gvt)
 {
 	mutex_lock(&gvt->sched_lock);
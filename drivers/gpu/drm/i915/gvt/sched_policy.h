@@ -59,4 +59,20 @@ void intel_vgpu_stop_schedule(struct intel_vgpu *vgpu);
 
 void intel_gvt_kick_schedule(struct intel_gvt *gvt);
 
+struct intel_vgpu_sched_stats {
+	enum intel_vgpu_sched_class sched_class;
+	u64 busy_ns;
+	u64 sched_in;
+	/* time from a workload being pending to the vGPU being scheduled in */
+	u64 delay_count;
+	u64 delay_total_ns;
+	u64 delay_max_ns;
+};
+
+int intel_vgpu_set_sched_class(struct intel_vgpu *vgpu,
+			       enum intel_vgpu_sched_class sched_class);
+
+void intel_vgpu_get_sched_stats(struct intel_vgpu *vgpu,
+				struct intel_vgpu_sched_stats *stats);
+
 #endif
@@ -349,6 +349,7 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	struct intel_engine_cs *engine = dev_priv->engine[workload->ring_id];
 	struct intel_context *ce;
 	struct i915_request *rq;
+	ktime_t start;
 	int ret;
 
 	lockdep_assert_held(&dev_priv->drm.struct_mutex);
@@ -356,6 +357,8 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	if (workload->req)
 		return 0;
 
+	start = ktime_get();
+
 	/* pin shadow context by gvt even the shadow context will be pinned
 	 * when i915 alloc request. That is because gvt will update the guest
 	 * context from shadow context when workload is completed, and at that
@@ -399,6 +402,8 @@ int intel_gvt_scan_and_shadow_workload(struct intel_vgpu_workload *workload)
 	if (ret)
 		goto err_req;
 
+	/* struct_mutex serialises the shadow time updates */
+	vgpu_pmu_add(vgpu, shadow_ns, ktime_to_ns(ktime_sub(ktime_get(), start)));
 	return 0;
 err_req:
 	rq = fetch_and_zero(&workload->req);
@@ -663,6 +668,73 @@ static int dispatch_workload(struct intel_vgpu_workload *workload)
 	return ret;
 }
 
+/*
+ * The guest ring buffer is scanned into a single per-ring buffer, which is
+ * only released once its contents are copied into the request at dispatch.
+ * So the workload that may be shadowed ahead of time is the first one not
+ * yet dispatched, if that hasn't been shadowed already.
+ */
+static struct intel_vgpu_workload *next_workload_to_shadow(struct list_head *q)
+{
+	struct intel_vgpu_workload *workload;
+
+	list_for_each_entry(workload, q, list) {
+		if (!workload->dispatched)
+			return workload->req ? NULL : workload;
+	}
+
+	return NULL;
+}
+
+/*
+ * Scan and shadow the queued workloads ahead of their dispatch, so that
+ * command scanning overlaps with the execution of the previous workload, or
+ * with the timeslices of other vGPUs, and the engine doesn't sit idle waiting
+ * for it when the workload is picked. Failures are not fatal here, as the
+ * dispatch will retry and report the error.
+ */
+static void shadow_workloads_work(struct work_struct *work)
+{
+	struct intel_vgpu_submission *s =
+		container_of(work, typeof(*s), shadow_work);
+	struct intel_vgpu *vgpu = container_of(s, typeof(*vgpu), submission);
+	struct drm_i915_private *dev_priv = vgpu->gvt->dev_priv;
+	struct intel_vgpu_workload *workload;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	int ret;
+
+	mutex_lock(&vgpu->vgpu_lock);
+
+	if (!vgpu->active || !s->active)
+		goto out;
+
+	intel_runtime_pm_get(dev_priv);
+
+	for_each_engine(engine, dev_priv, id) {
+		workload = next_workload_to_shadow(workload_q_head(vgpu, id));
+		if (!workload)
+			continue;
+
+		mutex_lock(&dev_priv->drm.struct_mutex);
+		ret = intel_gvt_scan_and_shadow_workload(workload);
+		mutex_unlock(&dev_priv->drm.struct_mutex);
+
+		if (ret)
+			gvt_dbg_sched("ring id %d fail to shadow workload %p ahead: %d\n",
+				      id, workload, ret);
+	}
+
+	intel_runtime_pm_put(dev_priv);
+out:
+	mutex_unlock(&vgpu->vgpu_lock);
+}
+
+static void kick_shadow_workloads(struct intel_vgpu *vgpu)
+{
+	queue_work(system_unbound_wq, &vgpu->submission.shadow_work);
+}
+
 static struct intel_vgpu_workload *pick_next_workload(
 		struct intel_gvt *gvt, int ring_id)
 {
@@ -856,6 +928,7 @@ static void complete_current_workload(struct intel_gvt *gvt, int ring_id)
 	gvt_dbg_sched("ring id %d complete workload %p status %d\n",
 			ring_id, workload, workload->status);
 
+	vgpu_pmu_add(vgpu, workloads, 1);
 	scheduler->current_workload[ring_id] = NULL;
 
 	list_del_init(&workload->list);
@@ -952,6 +1025,8 @@ static int workload_thread(void *priv)
 			goto complete;
 		}
 
+		kick_shadow_workloads(workload->vgpu);
+
 		gvt_dbg_sched("ring id %d wait workload %p\n",
 				workload->ring_id, workload);
 		i915_request_wait(workload->req, 0, MAX_SCHEDULE_TIMEOUT);
@@ -1001,6 +1076,8 @@ void intel_gvt_clean_workload_scheduler(struct intel_gvt *gvt)
 					&gvt->shadow_ctx_notifier_block[i]);
 		kthread_stop(scheduler->thread[i]);
 	}
+
+	kmem_cache_destroy(scheduler->workloads);
 }
 
 int intel_gvt_init_workload_scheduler(struct intel_gvt *gvt)
@@ -1015,6 +1092,16 @@ int intel_gvt_init_workload_scheduler(struct intel_gvt *gvt)
 
 	init_waitqueue_head(&scheduler->workload_complete_wq);
 
+	scheduler->workloads =
+		kmem_cache_create_usercopy("gvt-g_vgpu_workload",
+					   sizeof(struct intel_vgpu_workload), 0,
+					   SLAB_HWCACHE_ALIGN,
+					   offsetof(struct intel_vgpu_workload, rb_tail),
+					   sizeof_field(struct intel_vgpu_workload, rb_tail),
+					   NULL);
+	if (!scheduler->workloads)
+		return -ENOMEM;
+
 	for_each_engine(engine, gvt->dev_priv, i) {
 		init_waitqueue_head(&scheduler->waitq[i]);
 
@@ -1060,8 +1147,8 @@ void intel_vgpu_clean_submission(struct intel_vgpu *vgpu)
 	struct intel_vgpu_submission *s = &vgpu->submission;
 
 	intel_vgpu_select_submission_ops(vgpu, ALL_ENGINES, 0);
-	i915_gem_context_put(s->shadow_ctx);
-	kmem_cache_destroy(s->workloads);
+	if (s->shadow_ctx)
+		i915_gem_context_put(s->shadow_ctx);
 }
 
 
@@ -1100,38 +1187,24 @@ int intel_vgpu_setup_submission(struct intel_vgpu *vgpu)
 	struct intel_vgpu_submission *s = &vgpu->submission;
 	enum intel_engine_id i;
 	struct intel_engine_cs *engine;
-	int ret;
-
-	s->shadow_ctx = i915_gem_context_create_gvt(
-			&vgpu->gvt->dev_priv->drm);
-	if (IS_ERR(s->shadow_ctx))
-		return PTR_ERR(s->shadow_ctx);
 
+	/*
+	 * The shadow context is created on first use, see
+	 * intel_vgpu_select_submission_ops(), which keeps it out of
+	 * the vGPU creation path.
+	 */
+	s->shadow_ctx = NULL;
 	bitmap_zero(s->shadow_ctx_desc_updated, I915_NUM_ENGINES);
 
-	s->workloads = kmem_cache_create_usercopy("gvt-g_vgpu_workload",
-						  sizeof(struct intel_vgpu_workload), 0,
-						  SLAB_HWCACHE_ALIGN,
-						  offsetof(struct intel_vgpu_workload, rb_tail),
-						  sizeof_field(struct intel_vgpu_workload, rb_tail),
-						  NULL);
-
-	if (!s->workloads) {
-		ret = -ENOMEM;
-		goto out_shadow_ctx;
-	}
-
 	for_each_engine(engine, vgpu->gvt->dev_priv, i)
 		INIT_LIST_HEAD(&s->workload_q_head[i]);
 
+	INIT_WORK(&s->shadow_work, shadow_workloads_work);
+
 	atomic_set(&s->running_workload_num, 0);
 	bitmap_zero(s->tlb_handle_pending, I915_NUM_ENGINES);
 
 	return 0;
-
-out_shadow_ctx:
-	i915_gem_context_put(s->shadow_ctx);
-	return ret;
 }
 
 /**
@@ -1173,6 +1246,16 @@ int intel_vgpu_select_submission_ops(struct intel_vgpu *vgpu,
 		return 0;
 	}
 
+	if (!s->shadow_ctx) {
+		struct i915_gem_context *ctx;
+
+		ctx = i915_gem_context_create_gvt(&vgpu->gvt->dev_priv->drm);
+		if (IS_ERR(ctx))
+			return PTR_ERR(ctx);
+
+		s->shadow_ctx = ctx;
+	}
+
 	ret = ops[interface]->init(vgpu, engine_mask);
 	if (ret)
 		return ret;
@@ -1196,21 +1279,21 @@ int intel_vgpu_select_submission_ops(struct intel_vgpu *vgpu,
  */
 void intel_vgpu_destroy_workload(struct intel_vgpu_workload *workload)
 {
-	struct intel_vgpu_submission *s = &workload->vgpu->submission;
+	struct intel_gvt *gvt = workload->vgpu->gvt;
 
 	if (workload->shadow_mm)
 		intel_vgpu_mm_put(workload->shadow_mm);
 
-	kmem_cache_free(s->workloads, workload);
+	kmem_cache_free(gvt->scheduler.workloads, workload);
 }
 
 static struct intel_vgpu_workload *
 alloc_workload(struct intel_vgpu *vgpu)
 {
-	struct intel_vgpu_submission *s = &vgpu->submission;
 	struct intel_vgpu_workload *workload;
 
-	workload = kmem_cache_zalloc(s->workloads, GFP_KERNEL);
+	workload = kmem_cache_zalloc(vgpu->gvt->scheduler.workloads,
+				     GFP_KERNEL);
 	if (!workload)
 		return ERR_PTR(-ENOMEM);
 
@@ -1294,11 +1377,9 @@ struct intel_vgpu_workload *
 intel_vgpu_create_workload(struct intel_vgpu *vgpu, int ring_id,
 			   struct execlist_ctx_descriptor_format *desc)
 {
-	struct intel_vgpu_submission *s = &vgpu->submission;
 	struct list_head *q = workload_q_head(vgpu, ring_id);
 	struct intel_vgpu_workload *last_workload = get_last_workload(q);
 	struct intel_vgpu_workload *workload = NULL;
-	struct drm_i915_private *dev_priv = vgpu->gvt->dev_priv;
 	u64 ring_context_gpa;
 	u32 head, tail, start, ctl, ctx_ctl, per_ctx, indirect_ctx;
 	int ret;
@@ -1373,24 +1454,7 @@ intel_vgpu_create_workload(struct intel_vgpu *vgpu, int ring_id,
 
 	ret = prepare_mm(workload);
 	if (ret) {
-		kmem_cache_free(s->workloads, workload);
-		return ERR_PTR(ret);
-	}
-
-	/* Only scan and shadow the first workload in the queue
-	 * as there is only one pre-allocated buf-obj for shadow.
-	 */
-	if (list_empty(workload_q_head(vgpu, ring_id))) {
-		intel_runtime_pm_get(dev_priv);
-		mutex_lock(&dev_priv->drm.struct_mutex);
-		ret = intel_gvt_scan_and_shadow_workload(workload);
-		mutex_unlock(&dev_priv->drm.struct_mutex);
-		intel_runtime_pm_put(dev_priv);
-	}
-
-	if (ret && (vgpu_is_vm_unhealthy(ret))) {
-		enter_failsafe_mode(vgpu, GVT_FAILSAFE_GUEST_ERR);
-		intel_vgpu_destroy_workload(workload);
+		kmem_cache_free(vgpu->gvt->scheduler.workloads, workload);
 		return ERR_PTR(ret);
 	}
 
@@ -1405,6 +1469,7 @@ void intel_vgpu_queue_workload(struct intel_vgpu_workload *workload)
 {
 	list_add_tail(&workload->list,
 		workload_q_head(workload->vgpu, workload->ring_id));
+	kick_shadow_workloads(workload->vgpu);
 	intel_gvt_kick_schedule(workload->vgpu->gvt);
 	wake_up(&workload->vgpu->gvt->scheduler.waitq[workload->ring_id]);
 }
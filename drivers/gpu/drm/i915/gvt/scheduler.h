@@ -52,6 +52,9 @@ struct intel_gvt_workload_scheduler {
 
 	void *sched_data;
 	struct intel_gvt_sched_policy_ops *sched_ops;
+
+	/* shared by all vGPUs, so creating a vGPU doesn't create a cache */
+	struct kmem_cache *workloads;
 };
 
 #define INDIRECT_CTX_ADDR_MASK 0xffffffc0
@@ -47,6 +47,7 @@ void populate_pvinfo_page(struct intel_vgpu *vgpu)
 	vgpu_vreg_t(vgpu, vgtif_reg(vgt_caps)) = VGT_CAPS_FULL_48BIT_PPGTT;
 	vgpu_vreg_t(vgpu, vgtif_reg(vgt_caps)) |= VGT_CAPS_HWSP_EMULATION;
 	vgpu_vreg_t(vgpu, vgtif_reg(vgt_caps)) |= VGT_CAPS_HUGE_GTT;
+	vgpu_vreg_t(vgpu, vgtif_reg(vgt_caps)) |= VGT_CAPS_PV_SUBMISSION;
 
 	vgpu_vreg_t(vgpu, vgtif_reg(avail_rs.mappable_gmadr.base)) =
 		vgpu_aperture_gmadr_base(vgpu);
@@ -203,6 +204,45 @@ static void intel_gvt_update_vgpu_types(struct intel_gvt *gvt)
 	}
 }
 
+/**
+ * intel_gvt_resize_vgpu - change the high GM size and fences of a vGPU
+ * @vgpu: virtual GPU
+ * @high_gm_sz: new high GM size, in MB
+ * @fence_sz: new number of fence registers
+ *
+ * This function lets the user rebalance vGPU resources without destroying
+ * the vGPU. The guest learns its ranges from PVINFO when its driver loads
+ * and cannot re-balloon later, so the vGPU must not be in use by a VM.
+ *
+ * Returns:
+ * Zero on success, negative error code if failed.
+ */
+int intel_gvt_resize_vgpu(struct intel_vgpu *vgpu, u64 high_gm_sz,
+			  u64 fence_sz)
+{
+	struct intel_gvt *gvt = vgpu->gvt;
+	int ret;
+
+	mutex_lock(&gvt->lock);
+	mutex_lock(&vgpu->vgpu_lock);
+
+	if (vgpu->active) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = intel_vgpu_resize_resource(vgpu, high_gm_sz, fence_sz);
+	if (ret)
+		goto out;
+
+	populate_pvinfo_page(vgpu);
+	intel_gvt_update_vgpu_types(gvt);
+out:
+	mutex_unlock(&vgpu->vgpu_lock);
+	mutex_unlock(&gvt->lock);
+	return ret;
+}
+
 /**
  * intel_gvt_active_vgpu - activate a virtual GPU
  * @vgpu: virtual GPU
@@ -241,6 +281,9 @@ void intel_gvt_deactivate_vgpu(struct intel_vgpu *vgpu)
 	intel_vgpu_dmabuf_cleanup(vgpu);
 
 	mutex_unlock(&vgpu->vgpu_lock);
+
+	/* The worker takes vgpu_lock, and bails out on an inactive vGPU */
+	cancel_work_sync(&vgpu->submission.shadow_work);
 }
 
 /**
@@ -259,6 +302,7 @@ void intel_gvt_destroy_vgpu(struct intel_vgpu *vgpu)
 	WARN(vgpu->active, "vGPU is still active!\n");
 
 	intel_gvt_debugfs_remove_vgpu(vgpu);
+	intel_vgpu_clean_irq(vgpu);
 	intel_vgpu_clean_sched_policy(vgpu);
 	intel_vgpu_clean_submission(vgpu);
 	intel_vgpu_clean_display(vgpu);
@@ -364,6 +408,7 @@ static struct intel_vgpu *__intel_gvt_create_vgpu(struct intel_gvt *gvt,
 	INIT_LIST_HEAD(&vgpu->dmabuf_obj_list_head);
 	INIT_RADIX_TREE(&vgpu->page_track_tree, GFP_KERNEL);
 	idr_init(&vgpu->object_idr);
+	intel_vgpu_init_irq(vgpu);
 	intel_vgpu_init_cfg_space(vgpu, param->primary);
 
 	ret = intel_vgpu_init_mmio(vgpu);
@@ -101,18 +101,14 @@ int record_pdp(struct drm_i915_error_pagemap_lvl *e_pdp,
 int record_pd(struct drm_i915_error_pagemap_lvl *e_pd,
 	      struct i915_page_directory *pd)
 {
+	/*
+	 * The page tables themselves are not copied, the PTE of every
+	 * captured page is recorded alongside it by i915_error_page_walk().
+	 */
 	e_pd->paddr = px_dma(pd);
 	e_pd->storage = (u64 *)__get_free_page(GFP_ATOMIC | __GFP_NOWARN);
 	COPY_PX_ENTRIES(pd, e_pd->storage);
 
-	e_pd->nxt_lvl_count = pd->used_pdes;
-	e_pd->nxt_lvl = kcalloc(e_pd->nxt_lvl_count,
-				sizeof(*e_pd->nxt_lvl), GFP_ATOMIC);
-	if (!e_pd->nxt_lvl) {
-		e_pd->nxt_lvl_count = 0;
-		return -ENOMEM;
-	}
-
 	return 0;
 }
 
@@ -197,20 +193,26 @@ void i915_error_free_ppgtt(struct i915_gpu_state *error, int idx)
 		struct drm_i915_error_pagemap_lvl *e_pdp =
 			&e_pml4->nxt_lvl[i];
 
-		for (j = e_pdp->nxt_lvl_count - 1; j >= 0; j--) {
-			struct drm_i915_error_pagemap_lvl *e_pd =
-				&e_pdp->nxt_lvl[j];
-
-			free_page((unsigned long)e_pd->storage);
-			kfree(e_pd);
-		}
+		for (j = e_pdp->nxt_lvl_count - 1; j >= 0; j--)
+			free_page((unsigned long)e_pdp->nxt_lvl[j].storage);
+		kfree(e_pdp->nxt_lvl);
 		free_page((unsigned long)e_pdp->storage);
-		kfree(e_pdp);
 	}
+	kfree(e_pml4->nxt_lvl);
 	free_page((unsigned long)e_pml4->storage);
 }
 
+void i915_error_walk_fini(struct i915_error_walk *walk)
+{
+	if (walk->vaddr)
+		kunmap_atomic(walk->vaddr);
+
+	walk->vm = NULL;
+	walk->vaddr = NULL;
+}
+
 void i915_error_page_walk(struct drm_i915_private *i915,
+			  struct i915_error_walk *walk,
 			  struct i915_address_space *vm,
 			  u64 offset,
 			  gen8_pte_t *entry,
@@ -227,6 +229,7 @@ void i915_error_page_walk(struct drm_i915_private *i915,
 		*paddr = ggtt->gsm_paddr + index * sizeof(u64);
 	} else {
 		struct i915_hw_ppgtt *ppgtt = i915_vm_to_ppgtt(vm);
+		u64 base = round_down(offset, BIT_ULL(GEN8_PDE_SHIFT));
 		struct i915_pml4 *pml4;
 		struct i915_page_directory_pointer *pdp;
 		struct i915_page_directory *pd;
@@ -234,6 +237,13 @@ void i915_error_page_walk(struct drm_i915_private *i915,
 		u32 pml4e, pdpe, pde, pte;
 		u64 *vaddr;
 
+		pte = gen8_pte_index(offset);
+		if (walk && walk->vaddr && walk->vm == vm && walk->base == base) {
+			*entry = walk->vaddr[pte];
+			*paddr = walk->paddr + pte * sizeof(u64);
+			return;
+		}
+
 		pml4e = gen8_pml4e_index(offset);
 		if (i915_vm_is_48bit(&ppgtt->vm)) {
 			pml4 = &ppgtt->pml4;
@@ -249,11 +259,23 @@ void i915_error_page_walk(struct drm_i915_private *i915,
 		pde = gen8_pde_index(offset);
 		pt = pd->page_table[pde];
 
-		pte = gen8_pte_index(offset);
+		/* Release the old mapping first, kmap_atomic() nests */
+		if (walk)
+			i915_error_walk_fini(walk);
+
 		vaddr = kmap_atomic(px_base(pt)->page);
 		*entry = vaddr[pte];
-		kunmap_atomic(vaddr);
 		*paddr = px_dma(pt) + pte * sizeof(u64);
+
+		if (!walk) {
+			kunmap_atomic(vaddr);
+			return;
+		}
+
+		walk->vm = vm;
+		walk->base = base;
+		walk->vaddr = vaddr;
+		walk->paddr = px_dma(pt);
 	}
 }
 
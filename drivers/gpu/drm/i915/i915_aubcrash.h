@@ -24,6 +24,17 @@
 #ifndef _INTEL_AUBCRASH_H_
 #define _INTEL_AUBCRASH_H_
 
+/*
+ * Consecutive pages of an object usually share the same page table, so
+ * the walk keeps the last one mapped until the walk moves beyond it.
+ */
+struct i915_error_walk {
+	struct i915_address_space *vm;
+	u64 base;
+	u64 *vaddr;
+	phys_addr_t paddr;
+};
+
 #if IS_ENABLED(CONFIG_DRM_I915_AUB_CRASH_DUMP)
 
 void i915_error_record_ppgtt(struct i915_gpu_state *error,
@@ -31,10 +42,12 @@ void i915_error_record_ppgtt(struct i915_gpu_state *error,
 			     int idx);
 void i915_error_free_ppgtt(struct i915_gpu_state *error, int idx);
 void i915_error_page_walk(struct drm_i915_private *i915,
+			  struct i915_error_walk *walk,
 			  struct i915_address_space *vm,
 			  u64 offset,
 			  gen8_pte_t *entry,
 			  phys_addr_t *paddr);
+void i915_error_walk_fini(struct i915_error_walk *walk);
 int i915_error_state_to_aub(struct drm_i915_error_state_buf *m,
                             const struct i915_gpu_state *error);
 
@@ -57,6 +70,7 @@ static inline void i915_error_free_ppgtt(struct i915_gpu_state *error, int idx)
 }
 
 static inline void i915_error_page_walk(struct drm_i915_private *i915,
+					struct i915_error_walk *walk,
 					struct i915_address_space *vm,
 					u64 offset,
 					gen8_pte_t *entry,
@@ -64,6 +78,10 @@ static inline void i915_error_page_walk(struct drm_i915_private *i915,
 {
 }
 
+static inline void i915_error_walk_fini(struct i915_error_walk *walk)
+{
+}
+
 static inline int i915_error_state_to_aub(struct drm_i915_error_state_buf *m,
 					  const struct i915_gpu_state *error)
 {
@@ -635,6 +635,17 @@ void i915_aub_buffer(struct intel_aub *aub, bool global_gtt, int tiling_mode,
 			       ADDRESS_SPACE_PHYSICAL, pages, count);
 }
 
+void i915_aub_memory(struct intel_aub *aub, bool batch, phys_addr_t paddr,
+		     const void *data, u32 bytes)
+{
+	enum data_type_values type = batch ? TYPE_BATCH_BUFFER : TYPE_NOTYPE;
+
+	GEM_BUG_ON(offset_in_page(paddr) + bytes > PAGE_SIZE);
+
+	aub_write_mem_packet(aub, TILING_NONE, type, ADDRESS_SPACE_PHYSICAL,
+			     paddr, data, bytes);
+}
+
 void i915_aub_elsp_submit(struct intel_aub *aub, struct intel_engine_cs *engine,
 			  u64 desc)
 {
@@ -69,6 +69,8 @@ void i915_aub_batchbuffer(struct intel_aub *aub, bool global_gtt,
 			  const struct drm_i915_error_page *pages, uint count);
 void i915_aub_buffer(struct intel_aub *aub, bool global_gtt, int tiling_mode,
 		     const struct drm_i915_error_page *pages, uint count);
+void i915_aub_memory(struct intel_aub *aub, bool batch, phys_addr_t paddr,
+		     const void *data, u32 bytes);
 void i915_aub_elsp_submit(struct intel_aub *aub, struct intel_engine_cs *engine,
 			  u64 desc);
 void i915_aub_stop(struct intel_aub *aub);
@@ -0,0 +1,559 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/highmem.h>
+#include <linux/relay.h>
+
+#include "intel_drv.h"
+#include "i915_aubcrash.h"
+#include "i915_aubmemtrace.h"
+#include "i915_aubstream.h"
+
+/**
+ * DOC: AubStream
+ *
+ * Where AubCrash dumps the state of the whole GPU once a hang has been
+ * detected, AubStream records a live AUB trace of the submissions made by one
+ * chosen context, so that a real workload can later be replayed inside a
+ * simulator. The trace is started by writing the hw_id of the context to the
+ * i915_aub_stream debugfs file (and stopped by writing -1), and is read back
+ * from the i915_aub0 relay file, which may be either read() or mmap()ed.
+ *
+ * To keep the overhead low, the stream is incremental. Each GTT entry (of
+ * every page table level) is remembered once written, and only the entries
+ * that have changed since are emitted again. The contents of an object are
+ * only emitted alongside a new or changed PTE, with the exception of the batch
+ * buffer that is sent with every submission. The ring is streamed from the
+ * request's head to its tail, and the logical ring context image is written
+ * out in full only the first time the context runs on each engine. Each
+ * submission then patches in the ring head and tail, and is followed by a
+ * synchronous ELSP write, as for AubCrash.
+ *
+ * The objects are recorded before the request is submitted, so that the
+ * trace holds their contents as the GPU will first see them, and only the
+ * ring and the ELSP write are emitted once the request has been added. At
+ * most AUB_STREAM_MAX_ENTRIES entries are remembered; past that, the others
+ * are simply emitted again on every submission.
+ *
+ * Note that writes made by the CPU into an object that has already been
+ * streamed are not captured unless the object is also the batch buffer.
+ */
+
+#define AUB_STREAM_SUBBUF_SIZE	SZ_1M
+#define AUB_STREAM_N_SUBBUFS	16
+#define AUB_STREAM_HASH_BITS	12
+#define AUB_STREAM_BATCH	16
+#define AUB_STREAM_MAX_ENTRIES	SZ_64K
+
+enum aub_stream_type {
+	AUB_STREAM_PTES,
+	AUB_STREAM_BUFFER,
+	AUB_STREAM_BATCH_BUFFER,
+	AUB_STREAM_CONTEXT,
+};
+
+struct aub_stream_entry {
+	struct hlist_node node;
+	phys_addr_t paddr;
+	u64 value;
+};
+
+struct i915_aub_stream {
+	struct drm_i915_private *i915;
+	struct i915_gem_context *ctx;
+
+	struct rchan *chan;
+	struct intel_aub *aub;
+	unsigned long dropped;
+
+	unsigned int engines;
+
+	DECLARE_HASHTABLE(entries, AUB_STREAM_HASH_BITS);
+	unsigned int nentries;
+
+	struct drm_i915_error_page pages[AUB_STREAM_BATCH];
+	struct page *src[AUB_STREAM_BATCH];
+	unsigned int count;
+};
+
+static int subbuf_start_callback(struct rchan_buf *buf,
+				 void *subbuf,
+				 void *prev_subbuf,
+				 size_t prev_padding)
+{
+	struct i915_aub_stream *s = buf->chan->private_data;
+
+	/*
+	 * As the AUB file is a stream of packets that depend upon each other,
+	 * never overwrite unread data; instead drop (and count) the new data,
+	 * leaving the reader to detect the truncated stream.
+	 */
+	if (relay_buf_full(buf)) {
+		s->dropped++;
+		return 0;
+	}
+
+	return 1;
+}
+
+static struct dentry *create_buf_file_callback(const char *filename,
+					       struct dentry *parent,
+					       umode_t mode,
+					       struct rchan_buf *buf,
+					       int *is_global)
+{
+	/* A single buffer keeps the packets in submission order */
+	*is_global = 1;
+
+	if (!parent)
+		return NULL;
+
+	return debugfs_create_file(filename, mode,
+				   parent, buf, &relay_file_operations);
+}
+
+static int remove_buf_file_callback(struct dentry *dentry)
+{
+	debugfs_remove(dentry);
+	return 0;
+}
+
+static struct rchan_callbacks relay_callbacks = {
+	.subbuf_start = subbuf_start_callback,
+	.create_buf_file = create_buf_file_callback,
+	.remove_buf_file = remove_buf_file_callback,
+};
+
+static void aub_stream_write(void *priv, const void *data, size_t len)
+{
+	struct i915_aub_stream *s = priv;
+
+	relay_write(s->chan, data, len);
+}
+
+/* Returns true if the entry is new or has changed since it was last sent */
+static bool aub_stream_update(struct i915_aub_stream *s,
+			      phys_addr_t paddr, u64 value)
+{
+	struct aub_stream_entry *e;
+
+	hash_for_each_possible(s->entries, e, node, paddr) {
+		if (e->paddr != paddr)
+			continue;
+
+		if (e->value == value)
+			return false;
+
+		e->value = value;
+		return true;
+	}
+
+	/* Without a record, we will just have to send it again next time */
+	if (s->nentries >= AUB_STREAM_MAX_ENTRIES)
+		return true;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL | __GFP_NOWARN);
+	if (e) {
+		e->paddr = paddr;
+		e->value = value;
+		hash_add(s->entries, &e->node, paddr);
+		s->nentries++;
+	}
+
+	return true;
+}
+
+static void aub_stream_px(struct i915_aub_stream *s,
+			  enum pagemap_level lvl,
+			  struct i915_page_dma *p,
+			  unsigned int idx)
+{
+	phys_addr_t paddr = p->daddr + idx * sizeof(u64);
+	u64 *vaddr;
+	u64 entry;
+
+	vaddr = kmap_atomic(p->page);
+	entry = vaddr[idx];
+	kunmap_atomic(vaddr);
+
+	if (aub_stream_update(s, paddr, entry))
+		i915_aub_gtt(s->aub, lvl, paddr, &entry, 1);
+}
+
+static void aub_stream_walk(struct i915_aub_stream *s,
+			    struct i915_address_space *vm,
+			    u64 offset,
+			    gen8_pte_t *pte,
+			    phys_addr_t *pte_paddr)
+{
+	if (!i915_is_ggtt(vm)) {
+		struct i915_hw_ppgtt *ppgtt = i915_vm_to_ppgtt(vm);
+		struct i915_page_directory_pointer *pdp;
+		struct i915_page_directory *pd;
+		u32 pml4e = gen8_pml4e_index(offset);
+		u32 pdpe = gen8_pdpe_index(offset);
+		u32 pde = gen8_pde_index(offset);
+
+		/* The 3-level PDP lives inside the context image */
+		if (i915_vm_is_48bit(vm)) {
+			aub_stream_px(s, PPGTT_LEVEL4,
+				      px_base(&ppgtt->pml4), pml4e);
+			pdp = ppgtt->pml4.pdps[pml4e];
+			aub_stream_px(s, PPGTT_LEVEL3, px_base(pdp), pdpe);
+		} else {
+			pdp = &ppgtt->pdp;
+		}
+
+		pd = pdp->page_directory[pdpe];
+		aub_stream_px(s, PPGTT_LEVEL2, px_base(pd), pde);
+	}
+
+	/* Pages are kmap()ed between walks, so no cached mapping here */
+	i915_error_page_walk(s->i915, NULL, vm, offset, pte, pte_paddr);
+}
+
+static void aub_stream_flush_pages(struct i915_aub_stream *s,
+				   struct i915_vma *vma,
+				   enum aub_stream_type type,
+				   u8 class)
+{
+	bool global = i915_is_ggtt(vma->vm);
+	unsigned int n;
+
+	if (!s->count)
+		return;
+
+	switch (type) {
+	case AUB_STREAM_PTES:
+		break;
+	case AUB_STREAM_BUFFER:
+		i915_aub_buffer(s->aub, global,
+				i915_gem_object_get_tiling(vma->obj),
+				s->pages, s->count);
+		break;
+	case AUB_STREAM_BATCH_BUFFER:
+		i915_aub_batchbuffer(s->aub, global, s->pages, s->count);
+		break;
+	case AUB_STREAM_CONTEXT:
+		i915_aub_context(s->aub, class,
+				 s->pages, s->count);
+		break;
+	}
+
+	for (n = 0; n < s->count; n++)
+		kunmap(s->src[n]);
+	s->count = 0;
+}
+
+static void aub_stream_object(struct i915_aub_stream *s,
+			      struct i915_vma *vma,
+			      unsigned int first,
+			      enum aub_stream_type type,
+			      u8 class)
+{
+	struct drm_i915_gem_object *obj = vma->obj;
+	unsigned long num_pages, n;
+
+	if (!i915_gem_object_has_struct_page(obj) ||
+	    vma->pages != obj->mm.pages) {
+		i915_aub_comment(s->aub, "Skipping unsupported object %llx",
+				 vma->node.start);
+		type = AUB_STREAM_PTES;
+	}
+
+	num_pages = min_t(u64, vma->size, obj->base.size) >> PAGE_SHIFT;
+	for (n = first; n < num_pages; n++) {
+		struct drm_i915_error_page *page = &s->pages[s->count];
+		bool dirty;
+
+		aub_stream_walk(s, vma->vm, vma->node.start + n * PAGE_SIZE,
+				&page->pte, &page->pte_paddr);
+
+		dirty = aub_stream_update(s, page->pte_paddr, page->pte);
+		if (type == AUB_STREAM_PTES) {
+			if (dirty)
+				i915_aub_gtt(s->aub,
+					     i915_is_ggtt(vma->vm) ?
+					     GGTT_LEVEL1 : PPGTT_LEVEL1,
+					     page->pte_paddr, &page->pte, 1);
+			continue;
+		}
+
+		/* The batch is rewritten by userspace between submissions */
+		if (!dirty && type != AUB_STREAM_BATCH_BUFFER)
+			continue;
+
+		page->paddr = i915_gem_object_get_dma_address(obj, n);
+		s->src[s->count] = i915_gem_object_get_page(obj, n);
+		page->storage = kmap(s->src[s->count]);
+		if (!(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_READ))
+			drm_clflush_virt_range(page->storage, PAGE_SIZE);
+
+		if (++s->count == AUB_STREAM_BATCH)
+			aub_stream_flush_pages(s, vma, type, class);
+	}
+
+	aub_stream_flush_pages(s, vma, type, class);
+}
+
+static void aub_stream_ring(struct i915_aub_stream *s, struct i915_request *rq)
+{
+	struct intel_ring *ring = rq->ring;
+	struct drm_i915_gem_object *obj = ring->vma->obj;
+	u32 head = rq->head;
+
+	while (head != rq->tail) {
+		u32 end = head < rq->tail ? rq->tail : ring->size;
+		u32 len = min_t(u32, end - head,
+				PAGE_SIZE - offset_in_page(head));
+
+		i915_aub_memory(s->aub, true,
+				i915_gem_object_get_dma_address(obj,
+								head >> PAGE_SHIFT) +
+				offset_in_page(head),
+				ring->vaddr + head, len);
+
+		head += len;
+		if (head == ring->size)
+			head = 0;
+	}
+}
+
+static void aub_stream_context_image(struct i915_aub_stream *s,
+				     struct i915_request *rq)
+{
+	struct intel_engine_cs *engine = rq->engine;
+	struct intel_context *ce = rq->hw_context;
+
+	if (s->engines & ENGINE_MASK(engine->id))
+		return;
+
+	i915_aub_comment(s->aub, "Logical Ring Context %s", engine->name);
+	aub_stream_object(s, ce->state, LRC_GUCSHR_SZ,
+			  AUB_STREAM_CONTEXT, engine->class);
+	aub_stream_object(s, ce->ring->vma, 0, AUB_STREAM_PTES, 0);
+	s->engines |= ENGINE_MASK(engine->id);
+}
+
+static void aub_stream_context(struct i915_aub_stream *s,
+			       struct i915_request *rq)
+{
+	struct drm_i915_gem_object *obj = rq->hw_context->state->obj;
+	phys_addr_t regs;
+	u32 value;
+
+	/* The ring registers are only written into the image upon submit */
+	regs = i915_gem_object_get_dma_address(obj, LRC_STATE_PN);
+
+	value = rq->head;
+	i915_aub_memory(s->aub, false, regs + (CTX_RING_HEAD + 1) * sizeof(u32),
+			&value, sizeof(value));
+
+	value = rq->tail;
+	i915_aub_memory(s->aub, false, regs + (CTX_RING_TAIL + 1) * sizeof(u32),
+			&value, sizeof(value));
+}
+
+void __i915_aub_stream_record(struct i915_request *rq,
+			      struct i915_vma *batch,
+			      struct i915_vma **vma,
+			      unsigned int count)
+{
+	struct i915_aub_stream *s = rq->i915->aub_stream;
+	unsigned int i;
+
+	lockdep_assert_held(&rq->i915->drm.struct_mutex);
+
+	if (!s || rq->gem_context != s->ctx)
+		return;
+
+	i915_aub_comment(s->aub, "Request %llx:%u on %s",
+			 rq->fence.context, rq->fence.seqno, rq->engine->name);
+
+	for (i = 0; i < count; i++) {
+		if (vma[i] == batch)
+			continue;
+
+		aub_stream_object(s, vma[i], 0, AUB_STREAM_BUFFER, 0);
+	}
+
+	if (batch)
+		aub_stream_object(s, batch, 0, AUB_STREAM_BATCH_BUFFER, 0);
+
+	aub_stream_context_image(s, rq);
+}
+
+/* Called once the request has been added, and so its tail is known */
+void __i915_aub_stream_submit(struct i915_request *rq)
+{
+	struct i915_aub_stream *s = rq->i915->aub_stream;
+
+	lockdep_assert_held(&rq->i915->drm.struct_mutex);
+
+	if (!s || rq->gem_context != s->ctx)
+		return;
+
+	aub_stream_context(s, rq);
+	aub_stream_ring(s, rq);
+
+	i915_aub_elsp_submit(s->aub, rq->engine, rq->hw_context->lrc_desc);
+}
+
+static void aub_stream_engines(struct i915_aub_stream *s)
+{
+	struct drm_i915_private *dev_priv = s->i915;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	intel_runtime_pm_get(dev_priv);
+
+	i915_aub_comment(s->aub, "Registers");
+	i915_aub_register(s->aub, GAM_ECOCHK, I915_READ(GAM_ECOCHK));
+	for_each_engine(engine, dev_priv, id) {
+		i915_aub_register(s->aub, RING_MODE_GEN7(engine),
+				  _MASKED_BIT_ENABLE(I915_READ(RING_MODE_GEN7(engine))));
+		i915_aub_register(s->aub, RING_HWS_PGA(engine->mmio_base),
+				  I915_READ(RING_HWS_PGA(engine->mmio_base)));
+	}
+
+	intel_runtime_pm_put(dev_priv);
+
+	for_each_engine(engine, dev_priv, id) {
+		i915_aub_comment(s->aub, "Hardware Status Page %s",
+				 engine->name);
+		aub_stream_object(s, engine->status_page.vma, 0,
+				  AUB_STREAM_BUFFER, 0);
+	}
+}
+
+static void aub_stream_free(struct i915_aub_stream *s)
+{
+	struct aub_stream_entry *e;
+	struct hlist_node *tmp;
+	int bkt;
+
+	hash_for_each_safe(s->entries, bkt, tmp, e, node)
+		kfree(e);
+
+	if (s->ctx)
+		i915_gem_context_put(s->ctx);
+
+	kfree(s);
+}
+
+int i915_aub_stream_start(struct drm_i915_private *i915, u32 hw_id)
+{
+	struct i915_gem_context *ctx;
+	struct i915_aub_stream *s;
+	int err;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (!HAS_LOGICAL_RING_CONTEXTS(i915))
+		return -ENODEV;
+
+	if (i915->aub_stream)
+		return -EBUSY;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (!s)
+		return -ENOMEM;
+
+	s->i915 = i915;
+	hash_init(s->entries);
+
+	err = -ENOENT;
+	list_for_each_entry(ctx, &i915->contexts.list, link) {
+		/* hw_id are reassigned, so only match the current owner */
+		if (list_empty(&ctx->hw_id_link) ||
+		    i915_gem_context_is_kernel(ctx))
+			continue;
+
+		if (ctx->hw_id == hw_id) {
+			s->ctx = i915_gem_context_get(ctx);
+			break;
+		}
+	}
+	if (!s->ctx)
+		goto err_free;
+
+	s->chan = relay_open("i915_aub",
+			     i915->drm.primary->debugfs_root,
+			     AUB_STREAM_SUBBUF_SIZE, AUB_STREAM_N_SUBBUFS,
+			     &relay_callbacks, s);
+	if (!s->chan) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	s->aub = i915_aub_start(i915, aub_stream_write, s, "AubStream", true);
+	if (IS_ERR(s->aub)) {
+		err = PTR_ERR(s->aub);
+		goto err_relay;
+	}
+
+	aub_stream_engines(s);
+
+	i915->aub_stream = s;
+	return 0;
+
+err_relay:
+	relay_close(s->chan);
+err_free:
+	aub_stream_free(s);
+	return err;
+}
+
+void i915_aub_stream_stop(struct drm_i915_private *i915)
+{
+	struct i915_aub_stream *s = i915->aub_stream;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (!s)
+		return;
+
+	i915->aub_stream = NULL;
+
+	if (s->dropped)
+		DRM_NOTE("AUB stream truncated, %lu sub-buffers dropped\n",
+			 s->dropped);
+
+	i915_aub_stop(s->aub);
+	relay_flush(s->chan);
+	relay_close(s->chan);
+	aub_stream_free(s);
+}
+
+u64 i915_aub_stream_hw_id(struct drm_i915_private *i915)
+{
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (!i915->aub_stream)
+		return I915_AUB_STREAM_OFF;
+
+	return i915->aub_stream->ctx->hw_id;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _I915_AUBSTREAM_H_
+#define _I915_AUBSTREAM_H_
+
+#include <linux/compiler.h>
+#include <linux/types.h>
+
+struct drm_i915_private;
+struct i915_request;
+struct i915_vma;
+
+#define I915_AUB_STREAM_OFF (~0ull)
+
+#if IS_ENABLED(CONFIG_DRM_I915_AUB_STREAM)
+
+int i915_aub_stream_start(struct drm_i915_private *i915, u32 hw_id);
+void i915_aub_stream_stop(struct drm_i915_private *i915);
+u64 i915_aub_stream_hw_id(struct drm_i915_private *i915);
+
+void __i915_aub_stream_record(struct i915_request *rq,
+			      struct i915_vma *batch,
+			      struct i915_vma **vma,
+			      unsigned int count);
+
+void __i915_aub_stream_submit(struct i915_request *rq);
+
+static inline void i915_aub_stream_record(struct i915_request *rq,
+					  struct i915_vma *batch,
+					  struct i915_vma **vma,
+					  unsigned int count)
+{
+	if (unlikely(rq->i915->aub_stream))
+		__i915_aub_stream_record(rq, batch, vma, count);
+}
+
+static inline void i915_aub_stream_submit(struct i915_request *rq)
+{
+	if (unlikely(rq->i915->aub_stream))
+		__i915_aub_stream_submit(rq);
+}
+
+#else
+
+static inline int i915_aub_stream_start(struct drm_i915_private *i915,
+					u32 hw_id)
+{
+	return -ENODEV;
+}
+
+static inline void i915_aub_stream_stop(struct drm_i915_private *i915)
+{
+}
+
+static inline u64 i915_aub_stream_hw_id(struct drm_i915_private *i915)
+{
+	return I915_AUB_STREAM_OFF;
+}
+
+static inline void i915_aub_stream_record(struct i915_request *rq,
+					  struct i915_vma *batch,
+					  struct i915_vma **vma,
+					  unsigned int count)
+{
+}
+
+static inline void i915_aub_stream_submit(struct i915_request *rq)
+{
+}
+
+#endif
+
+#endif
@@ -25,6 +25,8 @@
  *
  */
 
+#include <linux/sort.h>
+
 #include "i915_drv.h"
 #include "intel_ringbuffer.h"
 
@@ -782,20 +784,16 @@ static bool validate_regs_sorted(struct intel_engine_cs *engine)
 	return true;
 }
 
-struct cmd_node {
-	const struct drm_i915_cmd_descriptor *desc;
-	struct hlist_node node;
-};
-
 /*
  * Different command ranges have different numbers of bits for the opcode. For
  * example, MI commands use bits 31:23 while 3D commands use bits 31:16. The
  * problem is that, for example, MI commands use bits 22:16 for other fields
  * such as GGTT vs PPGTT bits. If we include those bits in the mask then when
- * we mask a command from a batch it could hash to the wrong bucket due to
+ * we mask a command from a batch it could hash to the wrong slot due to
  * non-opcode bits being set. But if we don't include those bits, some 3D
- * commands may hash to the same bucket due to not including opcode bits that
- * make the command unique. For now, we will risk hashing to the same bucket.
+ * commands may share the same key due to not including opcode bits that
+ * make the command unique. Commands sharing a key are kept together in the
+ * same slot, and are told apart by their masks on lookup.
  */
 static inline u32 cmd_header_key(u32 x)
 {
@@ -810,45 +808,166 @@ static inline u32 cmd_header_key(u32 x)
 	}
 }
 
-static int init_hash_table(struct intel_engine_cs *engine,
-			   const struct drm_i915_cmd_table *cmd_tables,
-			   int cmd_table_count)
+/*
+ * The set of commands known to each engine is fixed, so rather than chaining
+ * through a generic hashtable, we search at init for a multiplicative hash
+ * that maps every distinct key to its own slot. A lookup is then a multiply,
+ * a shift and a single compare of the key, followed by the (rarely more than
+ * one) descriptors sharing that key.
+ */
+struct i915_cmd_slot {
+	u32 key;
+	u16 first;
+	u16 count;
+};
+
+struct cmd_entry {
+	u32 key;
+	unsigned int idx;
+	const struct drm_i915_cmd_descriptor *desc;
+};
+
+#define CMD_LOOKUP_MAX_ORDER 12
+#define CMD_LOOKUP_ATTEMPTS 64
+
+static inline unsigned int cmd_slot(u32 key, u32 mul, unsigned int order)
+{
+	return (key * mul) >> (32 - order);
+}
+
+static int cmd_entry_cmp(const void *A, const void *B)
+{
+	const struct cmd_entry *a = A, *b = B;
+
+	if (a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+
+	/* Keep the table order for descriptors sharing a key */
+	return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+static bool fill_cmd_slots(struct i915_cmd_slot *slots,
+			   unsigned int order, u32 mul,
+			   const struct cmd_entry *entries,
+			   unsigned int count)
 {
-	int i, j;
+	unsigned int i;
+
+	memset(slots, 0, sizeof(*slots) << order);
+
+	for (i = 0; i < count; i++) {
+		struct i915_cmd_slot *slot =
+			&slots[cmd_slot(entries[i].key, mul, order)];
+
+		if (!slot->count) {
+			slot->key = entries[i].key;
+			slot->first = i;
+		} else if (slot->key != entries[i].key) {
+			return false; /* collision, try another multiplier */
+		}
+
+		slot->count++;
+	}
 
-	hash_init(engine->cmd_hash);
+	return true;
+}
 
+static int init_cmd_lookup(struct intel_engine_cs *engine,
+			   const struct drm_i915_cmd_table *cmd_tables,
+			   int cmd_table_count)
+{
+	const struct drm_i915_cmd_descriptor **desc;
+	struct i915_cmd_slot *slots = NULL;
+	struct cmd_entry *entries;
+	unsigned int count, keys, order, attempt, i, j, n;
+	u32 mul = 0;
+	int err;
+
+	count = 0;
+	for (i = 0; i < cmd_table_count; i++)
+		count += cmd_tables[i].count;
+	if (!count || count > U16_MAX)
+		return -EINVAL;
+
+	entries = kmalloc_array(count, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	n = 0;
 	for (i = 0; i < cmd_table_count; i++) {
 		const struct drm_i915_cmd_table *table = &cmd_tables[i];
 
 		for (j = 0; j < table->count; j++) {
-			const struct drm_i915_cmd_descriptor *desc =
-				&table->table[j];
-			struct cmd_node *desc_node =
-				kmalloc(sizeof(*desc_node), GFP_KERNEL);
+			entries[n].key = cmd_header_key(table->table[j].cmd.value);
+			entries[n].idx = n;
+			entries[n].desc = &table->table[j];
+			n++;
+		}
+	}
+	sort(entries, count, sizeof(*entries), cmd_entry_cmp, NULL);
+
+	keys = 1;
+	for (i = 1; i < count; i++)
+		keys += entries[i].key != entries[i - 1].key;
+
+	desc = kmalloc_array(count, sizeof(*desc), GFP_KERNEL);
+	if (!desc) {
+		err = -ENOMEM;
+		goto err_entries;
+	}
+	for (i = 0; i < count; i++)
+		desc[i] = entries[i].desc;
 
-			if (!desc_node)
-				return -ENOMEM;
+	/*
+	 * Aim for a load factor of at most 1/2 to find a hash quickly; the
+	 * order must be non-zero for the shift in cmd_slot() to be defined.
+	 */
+	for (order = max(order_base_2(2 * keys), 1);
+	     order <= CMD_LOOKUP_MAX_ORDER;
+	     order++) {
+		slots = kmalloc_array(BIT(order), sizeof(*slots), GFP_KERNEL);
+		if (!slots) {
+			err = -ENOMEM;
+			goto err_desc;
+		}
 
-			desc_node->desc = desc;
-			hash_add(engine->cmd_hash, &desc_node->node,
-				 cmd_header_key(desc->cmd.value));
+		for (attempt = 0; attempt < CMD_LOOKUP_ATTEMPTS; attempt++) {
+			mul = 0x9e3779b1 + 2 * attempt; /* odd */
+			if (fill_cmd_slots(slots, order, mul, entries, count))
+				goto found;
 		}
+
+		kfree(slots);
 	}
 
+	err = -ENOSPC;
+	goto err_desc;
+
+found:
+	DRM_DEBUG_DRIVER("%s: %u commands, %u keys, in %lu slots\n",
+			 engine->name, count, keys, BIT(order));
+
+	engine->cmd_lookup.desc = desc;
+	engine->cmd_lookup.slot = slots;
+	engine->cmd_lookup.count = count;
+	engine->cmd_lookup.order = order;
+	engine->cmd_lookup.mul = mul;
+
+	kfree(entries);
 	return 0;
+
+err_desc:
+	kfree(desc);
+err_entries:
+	kfree(entries);
+	return err;
 }
 
-static void fini_hash_table(struct intel_engine_cs *engine)
+static void fini_cmd_lookup(struct intel_engine_cs *engine)
 {
-	struct hlist_node *tmp;
-	struct cmd_node *desc_node;
-	int i;
-
-	hash_for_each_safe(engine->cmd_hash, i, tmp, desc_node, node) {
-		hash_del(&desc_node->node);
-		kfree(desc_node);
-	}
+	kfree(engine->cmd_lookup.slot);
+	kfree(engine->cmd_lookup.desc);
+	memset(&engine->cmd_lookup, 0, sizeof(engine->cmd_lookup));
 }
 
 /**
@@ -934,10 +1053,9 @@ void intel_engine_init_cmd_parser(struct intel_engine_cs *engine)
 		return;
 	}
 
-	ret = init_hash_table(engine, cmd_tables, cmd_table_count);
+	ret = init_cmd_lookup(engine, cmd_tables, cmd_table_count);
 	if (ret) {
 		DRM_ERROR("%s: initialised failed!\n", engine->name);
-		fini_hash_table(engine);
 		return;
 	}
 
@@ -956,18 +1074,27 @@ void intel_engine_cleanup_cmd_parser(struct intel_engine_cs *engine)
 	if (!intel_engine_needs_cmd_parser(engine))
 		return;
 
-	fini_hash_table(engine);
+	fini_cmd_lookup(engine);
 }
 
 static const struct drm_i915_cmd_descriptor*
 find_cmd_in_table(struct intel_engine_cs *engine,
 		  u32 cmd_header)
 {
-	struct cmd_node *desc_node;
+	const u32 key = cmd_header_key(cmd_header);
+	const struct i915_cmd_slot *slot =
+		&engine->cmd_lookup.slot[cmd_slot(key,
+						  engine->cmd_lookup.mul,
+						  engine->cmd_lookup.order)];
+	unsigned int i;
+
+	if (slot->key != key)
+		return NULL;
+
+	for (i = slot->first; i < slot->first + slot->count; i++) {
+		const struct drm_i915_cmd_descriptor *desc =
+			engine->cmd_lookup.desc[i];
 
-	hash_for_each_possible(engine->cmd_hash, desc_node, node,
-			       cmd_header_key(cmd_header)) {
-		const struct drm_i915_cmd_descriptor *desc = desc_node->desc;
 		if (((cmd_header ^ desc->cmd.value) & desc->cmd.mask) == 0)
 			return desc;
 	}
@@ -1045,84 +1172,126 @@ find_reg(const struct intel_engine_cs *engine, bool is_master, u32 addr)
 	return NULL;
 }
 
-/* Returns a vmap'd pointer to dst_obj, which the caller must unmap */
-static u32 *copy_batch(struct drm_i915_gem_object *dst_obj,
-		       struct drm_i915_gem_object *src_obj,
-		       u32 batch_start_offset,
-		       u32 batch_len,
-		       bool *needs_clflush_after)
-{
+/*
+ * The batch is copied into the shadow incrementally, a page at a time just
+ * ahead of the parser, so that each command is still hot in the cache when
+ * it is validated and we only stream through the batch once. It also means
+ * that we stop copying as soon as the parser stops, at the end of the batch
+ * or at the first illegal command.
+ */
+struct batch_copy {
+	struct drm_i915_gem_object *src_obj;
+	struct drm_i915_gem_object *dst_obj;
+	void *src; /* WC mapping of src_obj, if reading with movntdqa */
+	void *dst; /* WB mapping of dst_obj */
+	u32 start;
+	u32 len;
+	u32 copied;
 	unsigned int src_needs_clflush;
 	unsigned int dst_needs_clflush;
-	void *dst, *src;
+};
+
+static int copy_batch_init(struct batch_copy *bc,
+			   struct drm_i915_gem_object *dst_obj,
+			   struct drm_i915_gem_object *src_obj,
+			   u32 batch_start_offset,
+			   u32 batch_len)
+{
 	int ret;
 
-	ret = i915_gem_obj_prepare_shmem_read(src_obj, &src_needs_clflush);
+	bc->src_obj = src_obj;
+	bc->dst_obj = dst_obj;
+	bc->start = batch_start_offset;
+	bc->len = batch_len;
+	bc->copied = 0;
+
+	ret = i915_gem_obj_prepare_shmem_read(src_obj, &bc->src_needs_clflush);
 	if (ret)
-		return ERR_PTR(ret);
+		return ret;
 
-	ret = i915_gem_obj_prepare_shmem_write(dst_obj, &dst_needs_clflush);
-	if (ret) {
-		dst = ERR_PTR(ret);
+	ret = i915_gem_obj_prepare_shmem_write(dst_obj, &bc->dst_needs_clflush);
+	if (ret)
 		goto unpin_src;
-	}
 
-	dst = i915_gem_object_pin_map(dst_obj, I915_MAP_FORCE_WB);
-	if (IS_ERR(dst))
+	bc->dst = i915_gem_object_pin_map(dst_obj, I915_MAP_FORCE_WB);
+	if (IS_ERR(bc->dst)) {
+		ret = PTR_ERR(bc->dst);
 		goto unpin_dst;
+	}
 
-	src = ERR_PTR(-ENODEV);
-	if (src_needs_clflush &&
+	bc->src = NULL;
+	if (bc->src_needs_clflush &&
 	    i915_can_memcpy_from_wc(NULL, batch_start_offset, 0)) {
-		src = i915_gem_object_pin_map(src_obj, I915_MAP_WC);
-		if (!IS_ERR(src)) {
-			i915_memcpy_from_wc(dst,
-					    src + batch_start_offset,
-					    ALIGN(batch_len, 16));
-			i915_gem_object_unpin_map(src_obj);
-		}
-	}
-	if (IS_ERR(src)) {
-		void *ptr;
-		int offset, n;
-
-		offset = offset_in_page(batch_start_offset);
-
-		/* We can avoid clflushing partial cachelines before the write
-		 * if we only every write full cache-lines. Since we know that
-		 * both the source and destination are in multiples of
-		 * PAGE_SIZE, we can simply round up to the next cacheline.
-		 * We don't care about copying too much here as we only
-		 * validate up to the end of the batch.
-		 */
-		if (dst_needs_clflush & CLFLUSH_BEFORE)
-			batch_len = roundup(batch_len,
-					    boot_cpu_data.x86_clflush_size);
-
-		ptr = dst;
-		for (n = batch_start_offset >> PAGE_SHIFT; batch_len; n++) {
-			int len = min_t(int, batch_len, PAGE_SIZE - offset);
-
-			src = kmap_atomic(i915_gem_object_get_page(src_obj, n));
-			if (src_needs_clflush)
-				drm_clflush_virt_range(src + offset, len);
-			memcpy(ptr, src + offset, len);
-			kunmap_atomic(src);
-
-			ptr += len;
-			batch_len -= len;
-			offset = 0;
-		}
+		bc->src = i915_gem_object_pin_map(src_obj, I915_MAP_WC);
+		if (IS_ERR(bc->src))
+			bc->src = NULL;
+		else
+			bc->len = ALIGN(batch_len, 16);
 	}
 
-	/* dst_obj is returned with vmap pinned */
-	*needs_clflush_after = dst_needs_clflush & CLFLUSH_AFTER;
+	/*
+	 * We can avoid clflushing partial cachelines before the write
+	 * if we only every write full cache-lines. Since we know that
+	 * both the source and destination are in multiples of
+	 * PAGE_SIZE, we can simply round up to the next cacheline.
+	 * We don't care about copying too much here as we only
+	 * validate up to the end of the batch.
+	 */
+	if (!bc->src && bc->dst_needs_clflush & CLFLUSH_BEFORE)
+		bc->len = roundup(batch_len, boot_cpu_data.x86_clflush_size);
+
+	return 0;
 
 unpin_dst:
 	i915_gem_obj_finish_shmem_access(dst_obj);
 unpin_src:
 	i915_gem_obj_finish_shmem_access(src_obj);
-	return dst;
+	return ret;
+}
+
+static void __copy_batch_ahead(struct batch_copy *bc, u32 bytes)
+{
+	u32 end = min_t(u32, round_up(bytes, PAGE_SIZE), bc->len);
+
+	if (bc->src) {
+		i915_memcpy_from_wc(bc->dst + bc->copied,
+				    bc->src + bc->start + bc->copied,
+				    end - bc->copied);
+		bc->copied = end;
+		return;
+	}
+
+	while (bc->copied < end) {
+		u32 offset = bc->start + bc->copied;
+		u32 len = min_t(u32, end - bc->copied,
+				PAGE_SIZE - offset_in_page(offset));
+		void *src;
+
+		src = kmap_atomic(i915_gem_object_get_page(bc->src_obj,
+							   offset >> PAGE_SHIFT));
+		src += offset_in_page(offset);
+		if (bc->src_needs_clflush)
+			drm_clflush_virt_range(src, len);
+		memcpy(bc->dst + bc->copied, src, len);
+		kunmap_atomic(src);
+
+		bc->copied += len;
+	}
+}
+
+/* Make sure the first @bytes of the batch have been copied into the shadow */
+static inline void copy_batch_ahead(struct batch_copy *bc, u32 bytes)
+{
+	if (unlikely(bytes > bc->copied))
+		__copy_batch_ahead(bc, bytes);
+}
+
+static void copy_batch_fini(struct batch_copy *bc)
+{
+	if (bc->src)
+		i915_gem_object_unpin_map(bc->src_obj);
+	i915_gem_obj_finish_shmem_access(bc->dst_obj);
+	i915_gem_obj_finish_shmem_access(bc->src_obj);
 }
 
 static bool check_cmd(const struct intel_engine_cs *engine,
@@ -1259,35 +1428,39 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 			    u32 batch_len,
 			    bool is_master)
 {
-	u32 *cmd, *batch_end;
+	u32 *cmd, *batch_start, *batch_end;
 	struct drm_i915_cmd_descriptor default_desc = noop_desc;
 	const struct drm_i915_cmd_descriptor *desc = &default_desc;
-	bool needs_clflush_after = false;
+	struct batch_copy bc;
 	int ret = 0;
 
-	cmd = copy_batch(shadow_batch_obj, batch_obj,
-			 batch_start_offset, batch_len,
-			 &needs_clflush_after);
-	if (IS_ERR(cmd)) {
+	ret = copy_batch_init(&bc, shadow_batch_obj, batch_obj,
+			      batch_start_offset, batch_len);
+	if (ret) {
 		DRM_DEBUG_DRIVER("CMD: Failed to copy batch\n");
-		return PTR_ERR(cmd);
+		return ret;
 	}
 
 	/*
 	 * We use the batch length as size because the shadow object is as
-	 * large or larger and copy_batch() will write MI_NOPs to the extra
+	 * large or larger and copy_batch_init() will write MI_NOPs to the extra
 	 * space. Parsing should be faster in some cases this way.
 	 */
+	cmd = batch_start = bc.dst;
 	batch_end = cmd + (batch_len / sizeof(*batch_end));
 	do {
 		u32 length;
 
+		copy_batch_ahead(&bc, (void *)(cmd + 1) - (void *)batch_start);
+
 		if (*cmd == MI_BATCH_BUFFER_END) {
-			if (needs_clflush_after) {
-				void *ptr = page_mask_bits(shadow_batch_obj->mm.mapping);
-				drm_clflush_virt_range(ptr,
-						       (void *)(cmd + 1) - ptr);
-			}
+			if (bc.dst_needs_clflush & CLFLUSH_AFTER)
+				drm_clflush_virt_range(batch_start,
+						       (void *)(cmd + 1) -
+						       (void *)batch_start);
+			/* All that will be executed, see cmd_cache_verify() */
+			shadow_batch_obj->cmd_cache.used =
+				(void *)(cmd + 1) - (void *)batch_start;
 			break;
 		}
 
@@ -1323,6 +1496,9 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 			break;
 		}
 
+		copy_batch_ahead(&bc,
+				 (void *)(cmd + length) - (void *)batch_start);
+
 		if (!check_cmd(engine, desc, cmd, length, is_master)) {
 			ret = -EACCES;
 			break;
@@ -1336,10 +1512,200 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 		}
 	} while (1);
 
+	copy_batch_fini(&bc);
 	i915_gem_object_unpin_map(shadow_batch_obj);
 	return ret;
 }
 
+/*
+ * Batches that are resubmitted unchanged (common for fixed-function
+ * pipelines) need not be copied and parsed again: the shadow copy that was
+ * validated last time is kept with the batch object and reused, for the
+ * same engine, range and privilege, until the batch is written to. The
+ * shadow is never visible to userspace, so reusing it can never bypass
+ * the parser. What we must avoid is executing a stale copy after the batch
+ * was changed, so every path that writes to the batch drops the cached copy.
+ *
+ * That does not catch userspace writing through a CPU or GTT mmap it set up
+ * earlier without moving the object into a write domain again. So before
+ * reusing the shadow, we also compare the commands it holds (up to the
+ * MI_BATCH_BUFFER_END) against the batch. That still reads the batch, but
+ * spares us from writing the copy and parsing it again. Objects whose
+ * storage may be written behind our back (userptr, dma-buf import or
+ * export) are never cached.
+ */
+static unsigned int cmd_cache_key(const struct intel_engine_cs *engine,
+				  bool is_master)
+{
+	return engine->id << 1 | is_master;
+}
+
+static bool cmd_cache_allowed(const struct drm_i915_gem_object *obj)
+{
+	return obj->base.filp && !obj->base.import_attach && !obj->base.dma_buf;
+}
+
+static bool cmd_cache_verify(struct drm_i915_gem_object *shadow,
+			     struct drm_i915_gem_object *batch_obj,
+			     u32 batch_start_offset)
+{
+	const u32 used = shadow->cmd_cache.used;
+	unsigned int needs_clflush;
+	bool same = false;
+	u32 done, len;
+	void *dst;
+
+	if (i915_gem_obj_prepare_shmem_read(batch_obj, &needs_clflush))
+		return false;
+
+	dst = i915_gem_object_pin_map(shadow, I915_MAP_FORCE_WB);
+	if (IS_ERR(dst))
+		goto out;
+
+	for (done = 0; done < used; done += len) {
+		u32 offset = batch_start_offset + done;
+		void *src;
+
+		len = min_t(u32, used - done,
+			    PAGE_SIZE - offset_in_page(offset));
+
+		src = kmap_atomic(i915_gem_object_get_page(batch_obj,
+							   offset >> PAGE_SHIFT));
+		src += offset_in_page(offset);
+		if (needs_clflush)
+			drm_clflush_virt_range(src, len);
+		same = !memcmp(dst + done, src, len);
+		kunmap_atomic(src);
+		if (!same)
+			break;
+	}
+
+	i915_gem_object_unpin_map(shadow);
+out:
+	i915_gem_obj_finish_shmem_access(batch_obj);
+	return same;
+}
+
+static bool cmd_cache_pin_pages(struct drm_i915_gem_object *shadow)
+{
+	bool pinned = false;
+
+	/*
+	 * The shadow's pages may have been reaped by the shrinker whilst it
+	 * was cached, in which case the validated contents are lost and
+	 * re-acquiring the pages would only give us a blank batch.
+	 */
+	mutex_lock(&shadow->mm.lock);
+	if (i915_gem_object_has_pages(shadow)) {
+		__i915_gem_object_pin_pages(shadow);
+		pinned = true;
+	}
+	mutex_unlock(&shadow->mm.lock);
+
+	return pinned;
+}
+
+/**
+ * intel_engine_cmd_parser_lookup() - find a validated copy of a batch
+ * @engine: the engine the batch is to be executed on
+ * @batch_obj: the batch buffer in question
+ * @batch_start_offset: byte offset in the batch at which execution starts
+ * @batch_len: length of the commands in batch_obj
+ * @is_master: is the submitting process the drm master?
+ * @gen: returns the write generation of @batch_obj to be passed to
+ *       intel_engine_cmd_parser_store()
+ *
+ * Return: the cached shadow batch, with its pages pinned, if @batch_obj was
+ * last parsed with the same parameters and its commands still match the
+ * shadow; otherwise NULL. The caller owns the reference to the shadow and must hand
+ * it back through intel_engine_cmd_parser_store().
+ */
+struct drm_i915_gem_object *
+intel_engine_cmd_parser_lookup(struct intel_engine_cs *engine,
+			       struct drm_i915_gem_object *batch_obj,
+			       u32 batch_start_offset,
+			       u32 batch_len,
+			       bool is_master,
+			       unsigned int *gen)
+{
+	struct drm_i915_gem_object *shadow;
+
+	*gen = atomic_read(&batch_obj->cmd_cache.gen);
+	smp_mb(); /* sample the generation before claiming the shadow */
+
+	shadow = xchg(&batch_obj->cmd_cache.shadow, NULL);
+	if (!shadow)
+		return NULL;
+
+	if (shadow->cmd_cache.key != cmd_cache_key(engine, is_master) ||
+	    shadow->cmd_cache.offset != batch_start_offset ||
+	    shadow->cmd_cache.len != batch_len ||
+	    !cmd_cache_pin_pages(shadow)) {
+		i915_gem_object_put(shadow);
+		return NULL;
+	}
+
+	if (!cmd_cache_verify(shadow, batch_obj, batch_start_offset)) {
+		i915_gem_object_unpin_pages(shadow);
+		i915_gem_object_put(shadow);
+		return NULL;
+	}
+
+	return shadow;
+}
+
+/**
+ * intel_engine_cmd_parser_store() - remember a validated copy of a batch
+ * @engine: the engine the batch is to be executed on
+ * @batch_obj: the batch buffer in question
+ * @shadow_batch_obj: the validated copy of the batch, whose reference is
+ *                    consumed
+ * @batch_start_offset: byte offset in the batch at which execution starts
+ * @batch_len: length of the commands in batch_obj
+ * @is_master: is the submitting process the drm master?
+ * @gen: the write generation returned by intel_engine_cmd_parser_lookup()
+ *       before the batch was parsed
+ */
+void intel_engine_cmd_parser_store(struct intel_engine_cs *engine,
+				   struct drm_i915_gem_object *batch_obj,
+				   struct drm_i915_gem_object *shadow_batch_obj,
+				   u32 batch_start_offset,
+				   u32 batch_len,
+				   bool is_master,
+				   unsigned int gen)
+{
+	if (!cmd_cache_allowed(batch_obj))
+		goto out;
+
+	shadow_batch_obj->cmd_cache.key = cmd_cache_key(engine, is_master);
+	shadow_batch_obj->cmd_cache.offset = batch_start_offset;
+	shadow_batch_obj->cmd_cache.len = batch_len;
+
+	if (cmpxchg(&batch_obj->cmd_cache.shadow, NULL, shadow_batch_obj))
+		goto out; /* lost the race against a concurrent parse */
+
+	/*
+	 * The successful cmpxchg() is a full barrier, so either a concurrent
+	 * writer sees the shadow we just published and removes it, or we see
+	 * its new generation here and do so ourselves.
+	 */
+	if (atomic_read(&batch_obj->cmd_cache.gen) != gen)
+		__i915_gem_object_invalidate_cmd_cache(batch_obj);
+	return;
+
+out:
+	i915_gem_object_put(shadow_batch_obj);
+}
+
+void __i915_gem_object_invalidate_cmd_cache(struct drm_i915_gem_object *obj)
+{
+	struct drm_i915_gem_object *shadow;
+
+	shadow = xchg(&obj->cmd_cache.shadow, NULL);
+	if (shadow)
+		i915_gem_object_put(shadow);
+}
+
 /**
  * i915_cmd_parser_get_version() - get the cmd parser version number
  * @dev_priv: i915 device private
@@ -1385,3 +1751,7 @@ int i915_cmd_parser_get_version(struct drm_i915_private *dev_priv)
 	 */
 	return 9;
 }
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+#include "selftests/i915_cmd_parser.c"
+#endif
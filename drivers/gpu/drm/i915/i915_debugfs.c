@@ -32,6 +32,7 @@
 #include "intel_drv.h"
 #include "intel_guc_submission.h"
 #include "i915_aubcrash.h"
+#include "i915_aubstream.h"
 
 static inline struct drm_i915_private *node_to_i915(struct drm_info_node *node)
 {
@@ -505,6 +506,17 @@ static int i915_gem_object_info(struct seq_file *m, void *data)
 		   huge_count,
 		   stringify_page_sizes(page_sizes, buf, sizeof(buf)),
 		   huge_size);
+	if (dev_priv->mm.huge_pool.capacity) {
+		spin_lock(&dev_priv->mm.huge_pool.lock);
+		seq_printf(m, "huge page pool: %lu of %lu 2M pages free, %lu hits, %lu misses\n",
+			   dev_priv->mm.huge_pool.count,
+			   dev_priv->mm.huge_pool.capacity,
+			   dev_priv->mm.huge_pool.hits,
+			   dev_priv->mm.huge_pool.misses);
+		spin_unlock(&dev_priv->mm.huge_pool.lock);
+	}
+	seq_printf(m, "%lu WC page-table pages pooled\n",
+		   i915_gem_wc_pool_count(dev_priv));
 	seq_printf(m, "%u display objects (globally pinned), %llu bytes\n",
 		   dpy_count, dpy_size);
 
@@ -549,6 +561,9 @@ static int i915_gem_object_info(struct seq_file *m, void *data)
 		print_file_stats(m, task ? task->comm : "<unknown>", stats);
 		rcu_read_unlock();
 
+		seq_printf(m, "  busy: %lluns\n",
+			   i915_gem_client_busy_time(file_priv));
+
 		mutex_unlock(&dev->struct_mutex);
 	}
 	mutex_unlock(&dev->filelist_mutex);
@@ -620,6 +635,13 @@ static int i915_gem_batch_pool_info(struct seq_file *m, void *data)
 		return ret;
 
 	for_each_engine(engine, dev_priv, id) {
+		struct i915_gem_batch_pool *pool = &engine->batch_pool;
+
+		seq_printf(m, "%s: %lu objects, %llu bytes; %lu hits, %lu misses, %lu trimmed\n",
+			   engine->name, pool->count, pool->size,
+			   pool->stats.hit, pool->stats.miss,
+			   pool->stats.trimmed);
+
 		for (j = 0; j < ARRAY_SIZE(engine->batch_pool.cache_list); j++) {
 			int count;
 
@@ -924,11 +946,20 @@ static int i915_gem_fence_regs_info(struct seq_file *m, void *data)
 		return ret;
 
 	seq_printf(m, "Total fences = %d\n", dev_priv->num_fence_regs);
+	seq_printf(m, "Steals = %lu, revokes = %lu, waits = %lu\n",
+		   dev_priv->mm.fence_stats.steals,
+		   dev_priv->mm.fence_stats.revokes,
+		   dev_priv->mm.fence_stats.waits);
 	for (i = 0; i < dev_priv->num_fence_regs; i++) {
 		struct i915_vma *vma = dev_priv->fence_regs[i].vma;
 
-		seq_printf(m, "Fence %d, pin count = %d, object = ",
+		seq_printf(m, "Fence %d, pin count = %d, ",
 			   i, dev_priv->fence_regs[i].pin_count);
+		if (vma && i915_vma_has_userfault(vma))
+			seq_printf(m, "last fault = %ums ago, ",
+				   jiffies_to_msecs(jiffies -
+						    dev_priv->fence_regs[i].last_fault));
+		seq_puts(m, "object = ");
 		if (!vma)
 			seq_puts(m, "unused");
 		else
@@ -1069,6 +1100,49 @@ static const struct file_operations i915_error_state_aub_fops = {
 
 #endif
 
+#if IS_ENABLED(CONFIG_DRM_I915_AUB_STREAM)
+
+static int
+i915_aub_stream_get(void *data, u64 *val)
+{
+	struct drm_i915_private *dev_priv = data;
+	int ret;
+
+	ret = mutex_lock_interruptible(&dev_priv->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	*val = i915_aub_stream_hw_id(dev_priv);
+
+	mutex_unlock(&dev_priv->drm.struct_mutex);
+	return 0;
+}
+
+static int
+i915_aub_stream_set(void *data, u64 val)
+{
+	struct drm_i915_private *dev_priv = data;
+	int ret;
+
+	ret = mutex_lock_interruptible(&dev_priv->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	/* Writing any hw_id restarts the stream, -1 just stops it */
+	i915_aub_stream_stop(dev_priv);
+	if (val != I915_AUB_STREAM_OFF)
+		ret = i915_aub_stream_start(dev_priv, val);
+
+	mutex_unlock(&dev_priv->drm.struct_mutex);
+	return ret;
+}
+
+DEFINE_SIMPLE_ATTRIBUTE(i915_aub_stream_fops,
+			i915_aub_stream_get, i915_aub_stream_set,
+			"%lld\n");
+
+#endif
+
 static int
 i915_next_seqno_set(void *data, u64 val)
 {
@@ -1307,6 +1381,7 @@ static int i915_frequency_info(struct seq_file *m, void *unused)
 
 	seq_printf(m, "Current CD clock frequency: %d kHz\n", dev_priv->cdclk.hw.cdclk);
 	seq_printf(m, "Max CD clock frequency: %d kHz\n", dev_priv->max_cdclk_freq);
+	seq_printf(m, "CD clock changes: %lu\n", dev_priv->cdclk.changes);
 	seq_printf(m, "Max pixel clock frequency: %d kHz\n", dev_priv->max_dotclk_freq);
 
 	intel_runtime_pm_put(dev_priv);
@@ -1537,10 +1612,22 @@ static int i915_forcewake_domains(struct seq_file *m, void *data)
 	seq_printf(m, "user.bypass_count = %u\n",
 		   i915->uncore.user_forcewake.count);
 
-	for_each_fw_domain(fw_domain, i915, tmp)
+	for_each_fw_domain(fw_domain, i915, tmp) {
+		const char *name =
+			intel_uncore_forcewake_domain_to_str(fw_domain->id);
+
 		seq_printf(m, "%s.wake_count = %u\n",
-			   intel_uncore_forcewake_domain_to_str(fw_domain->id),
-			   READ_ONCE(fw_domain->wake_count));
+			   name, READ_ONCE(fw_domain->wake_count));
+		seq_printf(m, "%s.hold_us = %u\n",
+			   name, READ_ONCE(fw_domain->hold_ns) / NSEC_PER_USEC);
+		seq_printf(m, "%s.acquisitions = %lu\n",
+			   name, READ_ONCE(fw_domain->stats.acquisitions));
+		seq_printf(m, "%s.ack_wait_us = %llu\n",
+			   name, div_u64(READ_ONCE(fw_domain->stats.ack_wait_ns),
+					 NSEC_PER_USEC));
+		seq_printf(m, "%s.fallbacks = %lu\n",
+			   name, READ_ONCE(fw_domain->stats.fallbacks));
+	}
 
 	return 0;
 }
@@ -1702,6 +1789,7 @@ static int i915_fbc_status(struct seq_file *m, void *unused)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
 	struct intel_fbc *fbc = &dev_priv->fbc;
+	enum pipe pipe;
 
 	if (!HAS_FBC(dev_priv))
 		return -ENODEV;
@@ -1732,6 +1820,24 @@ static int i915_fbc_status(struct seq_file *m, void *unused)
 		seq_printf(m, "Compressing: %s\n", yesno(mask));
 	}
 
+	if (drm_mm_node_allocated(&fbc->compressed_fb))
+		seq_printf(m, "CFB: %llu bytes, threshold %u\n",
+			   fbc->compressed_fb.size, fbc->threshold);
+
+	for_each_pipe(dev_priv, pipe) {
+		u64 active_ns = fbc->stats[pipe].active_ns;
+
+		if (fbc->active && fbc->params.crtc.pipe == pipe)
+			active_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							   fbc->stats[pipe].active_since));
+
+		seq_printf(m, "Pipe %c: %lu activations, %lu recompressions, active for %llu ms\n",
+			   pipe_name(pipe),
+			   fbc->stats[pipe].activations,
+			   fbc->stats[pipe].recompressions,
+			   div_u64(active_ns, NSEC_PER_MSEC));
+	}
+
 	mutex_unlock(&fbc->lock);
 	intel_runtime_pm_put(dev_priv);
 
@@ -2005,8 +2111,14 @@ static int i915_context_status(struct seq_file *m, void *unused)
 	if (ret)
 		return ret;
 
+	seq_printf(m, "HW context id steals: %lu\n",
+		   dev_priv->contexts.hw_id_steals);
+
 	list_for_each_entry(ctx, &dev_priv->contexts.list, link) {
-		seq_printf(m, "HW context %u ", ctx->hw_id);
+		if (list_empty(&ctx->hw_id_link))
+			seq_puts(m, "HW context (no id) ");
+		else
+			seq_printf(m, "HW context %u ", ctx->hw_id);
 		if (ctx->pid) {
 			struct task_struct *task;
 
@@ -2025,11 +2137,17 @@ static int i915_context_status(struct seq_file *m, void *unused)
 		seq_putc(m, ctx->remap_slice ? 'R' : 'r');
 		seq_putc(m, '\n');
 
+		seq_printf(m, "spin: %s, avg %luus, %lu hits, %lu misses\n",
+			   ctx->spin.adaptive ? "adaptive" : "fixed",
+			   ewma_spin_read(&ctx->spin.avg_us),
+			   ctx->spin.hits, ctx->spin.misses);
+
 		for_each_engine(engine, dev_priv, id) {
 			struct intel_context *ce =
 				to_intel_context(ctx, engine);
 
-			seq_printf(m, "%s: ", engine->name);
+			seq_printf(m, "%s: busy %lldns ", engine->name,
+				   ktime_to_ns(intel_context_get_busy_time(ce)));
 			if (ce->state)
 				describe_obj(m, ce->state->obj);
 			if (ce->ring)
@@ -2239,6 +2357,123 @@ static int i915_ppgtt_info(struct seq_file *m, void *data)
 	return ret;
 }
 
+static void print_evictions(struct seq_file *m, const char *name,
+			    const struct i915_address_space *vm)
+{
+	seq_printf(m, "%s: %lu calls, %lu failed, %lu vma evicted (%llu bytes)\n",
+		   name,
+		   vm->evictions.calls, vm->evictions.failures,
+		   vm->evictions.vmas, vm->evictions.bytes);
+}
+
+static int i915_gem_evict_info(struct seq_file *m, void *data)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct drm_device *dev = &dev_priv->drm;
+	struct i915_gem_context *ctx;
+	int ret;
+
+	ret = mutex_lock_interruptible(&dev->struct_mutex);
+	if (ret)
+		return ret;
+
+	print_evictions(m, "GGTT", &dev_priv->ggtt.vm);
+	if (dev_priv->mm.aliasing_ppgtt)
+		print_evictions(m, "aliasing PPGTT",
+				&dev_priv->mm.aliasing_ppgtt->vm);
+
+	list_for_each_entry(ctx, &dev_priv->contexts.list, link) {
+		char name[32];
+
+		if (!ctx->ppgtt)
+			continue;
+
+		snprintf(name, sizeof(name), "HW context %u", ctx->hw_id);
+		print_evictions(m, name, &ctx->ppgtt->vm);
+	}
+
+	mutex_unlock(&dev->struct_mutex);
+
+	return 0;
+}
+
+static int i915_gem_pwrite_info(struct seq_file *m, void *data)
+{
+	static const char * const names[] = {
+		[I915_PWRITE_SHMEM] = "shmem",
+		[I915_PWRITE_GTT] = "gtt",
+		[I915_PWRITE_WC] = "wc",
+	};
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(names) != I915_PWRITE_NUM_PATHS);
+	for (i = 0; i < I915_PWRITE_NUM_PATHS; i++) {
+		struct i915_pwrite_stats *stats = &dev_priv->mm.pwrite_stats[i];
+		u64 bytes = atomic64_read(&stats->bytes);
+		u64 ns = atomic64_read(&stats->ns);
+
+		seq_printf(m, "%s: %lld calls, %llu bytes, %llu MiB/s\n",
+			   names[i], (s64)atomic64_read(&stats->calls), bytes,
+			   ns ? div64_u64((bytes >> 20) * NSEC_PER_SEC, ns) : 0);
+	}
+
+	return 0;
+}
+
+static int i915_request_cache_info(struct seq_file *m, void *data)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct i915_dependency_cache *deps = &dev_priv->dependency_cache;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	for_each_engine(engine, dev_priv, id) {
+		struct i915_request_cache *cache =
+			&dev_priv->request_cache[engine->id];
+		unsigned long hits = READ_ONCE(cache->hits);
+		unsigned long misses = READ_ONCE(cache->misses);
+
+		seq_printf(m, "%s: %d cached, %lu hits, %lu misses (%lu%%)\n",
+			   engine->name, atomic_read(&cache->count),
+			   hits, misses,
+			   hits + misses ? hits * 100 / (hits + misses) : 0);
+	}
+
+	seq_printf(m, "dependencies: %u cached, %lu hits, %lu misses\n",
+		   READ_ONCE(deps->count),
+		   READ_ONCE(deps->hits), READ_ONCE(deps->misses));
+
+	return 0;
+}
+
+static int i915_suspend_timings(struct seq_file *m, void *data)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	const typeof(dev_priv->gt.suspend_time) *st =
+		&dev_priv->gt.suspend_time;
+
+	seq_printf(m, "idle: %lldus\n", ktime_to_us(st->idle));
+	seq_printf(m, "writeback: %lldus\n", ktime_to_us(st->writeback));
+	seq_printf(m, "uc: %lldus\n", ktime_to_us(st->uc));
+	seq_printf(m, "workers: %lldus\n", ktime_to_us(st->workers));
+	seq_printf(m, "domains: %lldus\n", ktime_to_us(st->domains));
+	seq_printf(m, "sanitize: %lldus\n", ktime_to_us(st->sanitize));
+
+	return 0;
+}
+
+static int i915_fence_await_info(struct seq_file *m, void *data)
+{
+	unsigned long awaits, elided;
+
+	i915_sw_fence_await_stats(&awaits, &elided);
+	seq_printf(m, "Reservation fence waits: %lu, elided: %lu\n",
+		   awaits, elided);
+
+	return 0;
+}
+
 static int count_irq_waiters(struct drm_i915_private *i915)
 {
 	struct intel_engine_cs *engine;
@@ -2297,10 +2532,12 @@ static int i915_rps_boost_info(struct seq_file *m, void *data)
 
 		rcu_read_lock();
 		task = pid_task(file->pid, PIDTYPE_PID);
-		seq_printf(m, "%s [%d]: %d boosts\n",
+		seq_printf(m, "%s [%d]: %d boosts, %d skipped, %d throttled\n",
 			   task ? task->comm : "<unknown>",
 			   task ? task->pid : -1,
-			   atomic_read(&file_priv->rps_client.boosts));
+			   atomic_read(&file_priv->rps_client.boosts),
+			   atomic_read(&file_priv->rps_client.skipped),
+			   atomic_read(&file_priv->rps_client.throttled));
 		rcu_read_unlock();
 	}
 	seq_printf(m, "Kernel (anonymous) boosts: %d\n",
@@ -2464,6 +2701,7 @@ static int i915_guc_info(struct seq_file *m, void *data)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
 	const struct intel_guc *guc = &dev_priv->guc;
+	unsigned int n;
 
 	if (!USES_GUC(dev_priv))
 		return -ENODEV;
@@ -2479,8 +2717,11 @@ static int i915_guc_info(struct seq_file *m, void *data)
 	seq_printf(m, "\t%*pb\n", GUC_NUM_DOORBELLS, guc->doorbell_bitmap);
 	seq_printf(m, "Doorbell next cacheline: 0x%x\n", guc->db_cacheline);
 
-	seq_printf(m, "\nGuC execbuf client @ %p:\n", guc->execbuf_client);
-	i915_guc_client_info(m, dev_priv, guc->execbuf_client);
+	for (n = 0; n < guc->num_execbuf_clients; n++) {
+		seq_printf(m, "\nGuC execbuf client %u @ %p:\n",
+			   n, guc->execbuf_clients[n]);
+		i915_guc_client_info(m, dev_priv, guc->execbuf_clients[n]);
+	}
 	if (guc->preempt_client) {
 		seq_printf(m, "\nGuC preempt client @ %p:\n",
 			   guc->preempt_client);
@@ -2790,6 +3031,14 @@ static int i915_edp_psr_status(struct seq_file *m, void *data)
 	}
 
 	psr_source_status(dev_priv, m);
+
+	seq_printf(m, "Activations: %lu, exits: %lu, deferred re-activations: %lu\n",
+		   dev_priv->psr.activations, dev_priv->psr.exits,
+		   dev_priv->psr.deferred);
+	seq_printf(m, "Active residency: %llu ms\n",
+		   div_u64(dev_priv->psr.residency_ns, NSEC_PER_MSEC));
+	seq_printf(m, "Average flush interval: %u us (frame %u us)\n",
+		   dev_priv->psr.flush_interval_us, dev_priv->psr.frame_us);
 	mutex_unlock(&dev_priv->psr.lock);
 
 	if (READ_ONCE(dev_priv->psr.debug)) {
@@ -2797,6 +3046,8 @@ static int i915_edp_psr_status(struct seq_file *m, void *data)
 			   dev_priv->psr.last_entry_attempt);
 		seq_printf(m, "Last exit at: %lld\n",
 			   dev_priv->psr.last_exit);
+		seq_printf(m, "HW entries: %lu, exits: %lu\n",
+			   dev_priv->psr.hw_entries, dev_priv->psr.hw_exits);
 	}
 
 	intel_runtime_pm_put(dev_priv);
@@ -2873,6 +3124,16 @@ static int i915_runtime_pm_status(struct seq_file *m, void *unused)
 
 	seq_printf(m, "GPU idle: %s (epoch %u)\n",
 		   yesno(!dev_priv->gt.awake), dev_priv->gt.epoch);
+	seq_printf(m, "Park delay: %ums; parks: %lu (avg %lluus), unparks: %lu (avg %lluus), premature: %lu\n",
+		   max(dev_priv->gt.park.delay_ms,
+		       i915_modparams.park_delay_ms),
+		   dev_priv->gt.park.parks,
+		   div64_u64(dev_priv->gt.park.park_ns,
+			     max(dev_priv->gt.park.parks, 1ul) * NSEC_PER_USEC),
+		   dev_priv->gt.park.unparks,
+		   div64_u64(dev_priv->gt.park.unpark_ns,
+			     max(dev_priv->gt.park.unparks, 1ul) * NSEC_PER_USEC),
+		   dev_priv->gt.park.thrash);
 	seq_printf(m, "IRQs disabled: %s\n",
 		   yesno(!intel_irqs_enabled(dev_priv)));
 #ifdef CONFIG_PM
@@ -2885,6 +3146,32 @@ static int i915_runtime_pm_status(struct seq_file *m, void *unused)
 		   pci_power_name(pdev->current_state),
 		   pdev->current_state);
 
+	if (HAS_RUNTIME_PM(dev_priv)) {
+		static const char * const steps[] = {
+			[I915_RESUME_PLATFORM] = "platform",
+			[I915_RESUME_UNCORE] = "uncore",
+			[I915_RESUME_IRQ] = "irq",
+			[I915_RESUME_UC] = "uc",
+			[I915_RESUME_GEM] = "gem",
+			[I915_RESUME_DISPLAY] = "display (deferred)",
+		};
+		const typeof(dev_priv->runtime_pm.resume_stats) *stats =
+			&dev_priv->runtime_pm.resume_stats;
+		int i;
+
+		BUILD_BUG_ON(ARRAY_SIZE(steps) != I915_RESUME_NUM_STEPS);
+
+		seq_printf(m, "Runtime resumes: %lu, last %lluus, max %lluus\n",
+			   stats->count,
+			   div_u64(stats->total_ns, NSEC_PER_USEC),
+			   div_u64(stats->max_total_ns, NSEC_PER_USEC));
+		for (i = 0; i < I915_RESUME_NUM_STEPS; i++)
+			seq_printf(m, "  %s: last %lluus, max %lluus\n",
+				   steps[i],
+				   div_u64(stats->last_ns[i], NSEC_PER_USEC),
+				   div_u64(stats->max_ns[i], NSEC_PER_USEC));
+	}
+
 	return 0;
 }
 
@@ -2902,13 +3189,30 @@ static int i915_power_domain_info(struct seq_file *m, void *unused)
 		enum intel_display_power_domain power_domain;
 
 		power_well = &power_domains->power_wells[i];
-		seq_printf(m, "%-25s %d\n", power_well->name,
-			   power_well->count);
-
-		for_each_power_domain(power_domain, power_well->domains)
-			seq_printf(m, "  %-23s %d\n",
-				 intel_display_power_domain_str(power_domain),
-				 power_domains->domain_use_count[power_domain]);
+		seq_printf(m, "%-25s %d (enabled %lu times, disabled %lu times)\n",
+			   power_well->name, power_well->count,
+			   power_well->enable_count,
+			   power_well->disable_count);
+
+		for_each_power_domain(power_domain, power_well->domains) {
+			typeof(power_domains->domain_holder[0]) *holder =
+				&power_domains->domain_holder[power_domain];
+			int count = atomic_read(&power_domains->domain_use_count[power_domain]);
+
+			seq_printf(m, "  %-23s %d",
+				   intel_display_power_domain_str(power_domain),
+				   count);
+			if (count && holder->caller)
+				seq_printf(m, " (held for %lldms, powered up by %pS)",
+					   ktime_ms_delta(ktime_get(),
+							  holder->since),
+					   (void *)holder->caller);
+			seq_putc(m, '\n');
+			if (count)
+				intel_display_power_show_holders(dev_priv,
+								 power_domain,
+								 m);
+		}
 	}
 
 	mutex_unlock(&power_domains->lock);
@@ -2920,6 +3224,7 @@ static int i915_dmc_info(struct seq_file *m, void *unused)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
 	struct intel_csr *csr;
+	ktime_t dc5, dc6;
 
 	if (!HAS_CSR(dev_priv))
 		return -ENODEV;
@@ -2948,6 +3253,23 @@ static int i915_dmc_info(struct seq_file *m, void *unused)
 			   I915_READ(BXT_CSR_DC3_DC5_COUNT));
 	}
 
+	mutex_lock(&dev_priv->power_domains.lock);
+	dc5 = csr->dc5_time;
+	dc6 = csr->dc6_time;
+	/* Include the time spent so far in the current state */
+	if (csr->dc_state_since) {
+		ktime_t dt = ktime_sub(ktime_get(), csr->dc_state_since);
+
+		if (csr->dc_state & DC_STATE_EN_UPTO_DC6)
+			dc6 = ktime_add(dc6, dt);
+		else if (csr->dc_state & DC_STATE_EN_UPTO_DC5)
+			dc5 = ktime_add(dc5, dt);
+	}
+	mutex_unlock(&dev_priv->power_domains.lock);
+
+	seq_printf(m, "DC5 allowed by driver: %lldms\n", ktime_to_ms(dc5));
+	seq_printf(m, "DC6 allowed by driver: %lldms\n", ktime_to_ms(dc6));
+
 out:
 	seq_printf(m, "program base: 0x%08x\n", I915_READ(CSR_PROGRAM(0)));
 	seq_printf(m, "ssp base: 0x%08x\n", I915_READ(CSR_SSP_BASE));
@@ -3040,6 +3362,9 @@ static void intel_dp_info(struct seq_file *m,
 
 	seq_printf(m, "\tDPCD rev: %x\n", intel_dp->dpcd[DP_DPCD_REV]);
 	seq_printf(m, "\taudio support: %s\n", yesno(intel_dp->has_audio));
+	seq_printf(m, "\tlink training cache: %s, %u hits, %u misses\n",
+		   intel_dp->train_cache.valid ? "valid" : "empty",
+		   intel_dp->train_cache.hits, intel_dp->train_cache.misses);
 	if (intel_connector->base.connector_type == DRM_MODE_CONNECTOR_eDP)
 		intel_panel_info(m, &intel_connector->panel);
 
@@ -3235,6 +3560,41 @@ static void intel_scaler_info(struct seq_file *m, struct intel_crtc *intel_crtc)
 	}
 }
 
+static int i915_vblank_evasion_info(struct seq_file *m, void *unused)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct intel_crtc *crtc;
+
+	for_each_intel_crtc(&dev_priv->drm, crtc) {
+		unsigned int i;
+
+		seq_printf(m, "Pipe %c: %lu updates, %lu missed the vblank\n",
+			   pipe_name(crtc->pipe),
+			   crtc->evasion.updates, crtc->evasion.misses);
+
+		seq_puts(m, "\tduration:");
+		for (i = 0; i < I915_EVASION_HIST_BUCKETS; i++)
+			seq_printf(m, " %s%uus: %lu",
+				   i < I915_EVASION_HIST_BUCKETS - 1 ? "<" : ">=",
+				   i < I915_EVASION_HIST_BUCKETS - 1 ? 8 << i : 4 << i,
+				   crtc->evasion.hist[i]);
+		seq_putc(m, '\n');
+
+		for (i = 0; i < ARRAY_SIZE(crtc->evasion.cost_us); i++) {
+			unsigned long cost =
+				ewma_evasion_read(&crtc->evasion.cost_us[i]);
+
+			if (!cost)
+				continue;
+
+			seq_printf(m, "\t%u planes: cost %luus, budget %uus\n",
+				   i, cost, intel_pipe_update_budget_us(crtc, i));
+		}
+	}
+
+	return 0;
+}
+
 static int i915_display_info(struct seq_file *m, void *unused)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
@@ -3321,6 +3681,45 @@ static int i915_engine_info(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static int i915_engine_latency(struct seq_file *m, void *unused)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	struct drm_printer p;
+
+	p = drm_seq_file_printer(m);
+	for_each_engine(engine, dev_priv, id)
+		intel_engine_dump_latency(engine, &p);
+
+	return 0;
+}
+
+static int i915_engine_trace(struct seq_file *m, void *unused)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct intel_engine_trace_entry *entries;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	struct drm_printer p;
+
+	entries = kvmalloc_array(INTEL_ENGINE_TRACE_SIZE, sizeof(*entries),
+				 GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	p = drm_seq_file_printer(m);
+	for_each_engine(engine, dev_priv, id) {
+		drm_printf(&p, "%s\n", engine->name);
+		intel_engine_dump_trace(entries,
+					intel_engine_copy_trace(engine, entries),
+					&p);
+	}
+
+	kvfree(entries);
+	return 0;
+}
+
 static int i915_rcs_topology(struct seq_file *m, void *unused)
 {
 	struct drm_i915_private *dev_priv = node_to_i915(m->private);
@@ -3503,6 +3902,93 @@ static int i915_ddb_info(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void i915_fifo_underrun_snapshot(struct seq_file *m,
+					struct intel_crtc *crtc,
+					const struct intel_underrun_snapshot *snapshot)
+{
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	int max_level = ilk_wm_max_level(dev_priv);
+	enum plane_id plane_id;
+
+	seq_printf(m, "\tlast snapshot at %lldus: cdclk %d kHz, SAGV %s, IPC %s, %u DBuf slices\n",
+		   ktime_to_us(snapshot->time), snapshot->cdclk,
+		   enableddisabled(snapshot->sagv),
+		   enableddisabled(snapshot->ipc),
+		   snapshot->enabled_slices);
+
+	for_each_plane_id_on_crtc(crtc, plane_id) {
+		const struct skl_plane_wm *wm = &snapshot->wm.planes[plane_id];
+		const struct skl_ddb_entry *entry = &snapshot->ddb[plane_id];
+		int level;
+
+		if (plane_id == PLANE_CURSOR)
+			seq_printf(m, "\t  %-8s", "Cursor");
+		else
+			seq_printf(m, "\t  Plane%-3d", plane_id + 1);
+
+		seq_printf(m, " DDB %4u-%4u (%4u)", entry->start, entry->end,
+			   skl_ddb_entry_size(entry));
+
+		entry = &snapshot->uv_ddb[plane_id];
+		if (skl_ddb_entry_size(entry))
+			seq_printf(m, " UV %4u-%4u (%4u)", entry->start,
+				   entry->end, skl_ddb_entry_size(entry));
+
+		seq_puts(m, " WM blocks:");
+		for (level = 0; level <= max_level; level++) {
+			if (wm->wm[level].plane_en)
+				seq_printf(m, " %u", wm->wm[level].plane_res_b);
+			else
+				seq_puts(m, " -");
+		}
+		seq_putc(m, '\n');
+	}
+}
+
+static int i915_fifo_underrun_info(struct seq_file *m, void *unused)
+{
+	struct drm_i915_private *dev_priv = node_to_i915(m->private);
+	struct intel_underrun_snapshot *snapshot;
+	struct intel_crtc *crtc;
+
+	snapshot = kmalloc(sizeof(*snapshot), GFP_KERNEL);
+	if (!snapshot)
+		return -ENOMEM;
+
+	for_each_intel_crtc(&dev_priv->drm, crtc) {
+		unsigned long cpu_count, pch_count;
+		bool cpu_enabled, pch_enabled;
+		unsigned int burst;
+		bool valid;
+
+		spin_lock_irq(&dev_priv->irq_lock);
+		cpu_count = crtc->underrun.cpu_count;
+		pch_count = crtc->underrun.pch_count;
+		burst = crtc->underrun.cpu_burst;
+		cpu_enabled = !crtc->cpu_fifo_underrun_disabled;
+		pch_enabled = !crtc->pch_fifo_underrun_disabled;
+		valid = crtc->underrun.snapshot_valid;
+		if (valid)
+			*snapshot = crtc->underrun.snapshot;
+		spin_unlock_irq(&dev_priv->irq_lock);
+
+		seq_printf(m, "Pipe %c: %lu CPU underruns (%u since modeset, reporting %s)",
+			   pipe_name(crtc->pipe), cpu_count, burst,
+			   enableddisabled(cpu_enabled));
+		if (HAS_PCH_SPLIT(dev_priv) && !HAS_PCH_NOP(dev_priv))
+			seq_printf(m, ", %lu PCH underruns (reporting %s)",
+				   pch_count, enableddisabled(pch_enabled));
+		seq_putc(m, '\n');
+
+		if (valid)
+			i915_fifo_underrun_snapshot(m, crtc, snapshot);
+	}
+
+	kfree(snapshot);
+
+	return 0;
+}
+
 static void drrs_status_per_crtc(struct seq_file *m,
 				 struct drm_device *dev,
 				 struct intel_crtc *intel_crtc)
@@ -4790,6 +5276,11 @@ static const struct drm_info_list i915_debugfs_list[] = {
 	{"i915_forcewake_domains", i915_forcewake_domains, 0},
 	{"i915_swizzle_info", i915_swizzle_info, 0},
 	{"i915_ppgtt_info", i915_ppgtt_info, 0},
+	{"i915_gem_evict_info", i915_gem_evict_info, 0},
+	{"i915_gem_pwrite_info", i915_gem_pwrite_info, 0},
+	{"i915_fence_await_info", i915_fence_await_info, 0},
+	{"i915_request_cache_info", i915_request_cache_info, 0},
+	{"i915_suspend_timings", i915_suspend_timings, 0},
 	{"i915_llc", i915_llc, 0},
 	{"i915_edp_psr_status", i915_edp_psr_status, 0},
 	{"i915_energy_uJ", i915_energy_uJ, 0},
@@ -4797,13 +5288,17 @@ static const struct drm_info_list i915_debugfs_list[] = {
 	{"i915_power_domain_info", i915_power_domain_info, 0},
 	{"i915_dmc_info", i915_dmc_info, 0},
 	{"i915_display_info", i915_display_info, 0},
+	{"i915_vblank_evasion", i915_vblank_evasion_info, 0},
 	{"i915_engine_info", i915_engine_info, 0},
+	{"i915_engine_latency", i915_engine_latency, 0},
+	{"i915_engine_trace", i915_engine_trace, 0},
 	{"i915_rcs_topology", i915_rcs_topology, 0},
 	{"i915_shrinker_info", i915_shrinker_info, 0},
 	{"i915_shared_dplls_info", i915_shared_dplls_info, 0},
 	{"i915_dp_mst_info", i915_dp_mst_info, 0},
 	{"i915_wa_registers", i915_wa_registers, 0},
 	{"i915_ddb_info", i915_ddb_info, 0},
+	{"i915_fifo_underrun_info", i915_fifo_underrun_info, 0},
 	{"i915_sseu_status", i915_sseu_status, 0},
 	{"i915_drrs_status", i915_drrs_status, 0},
 	{"i915_rps_boost_info", i915_rps_boost_info, 0},
@@ -4826,6 +5321,9 @@ static const struct i915_debugfs_files {
 #if IS_ENABLED(CONFIG_DRM_I915_AUB_CRASH_DUMP)
 	{"i915_error_state_aub", &i915_error_state_aub_fops},
 	{"i915_gpu_info_aub", &i915_gpu_info_aub_fops},
+#endif
+#if IS_ENABLED(CONFIG_DRM_I915_AUB_STREAM)
+	{"i915_aub_stream", &i915_aub_stream_fops},
 #endif
 	{"i915_fifo_underrun_reset", &i915_fifo_underrun_reset_ops},
 	{"i915_next_seqno", &i915_next_seqno_fops},
@@ -47,6 +47,7 @@
 #include <drm/i915_drm.h>
 
 #include "i915_drv.h"
+#include "i915_aubstream.h"
 #include "i915_trace.h"
 #include "i915_pmu.h"
 #include "i915_query.h"
@@ -418,6 +419,10 @@ static int i915_getparam_ioctl(struct drm_device *dev, void *data,
 	case I915_PARAM_HAS_EXEC_CAPTURE:
 	case I915_PARAM_HAS_EXEC_BATCH_FIRST:
 	case I915_PARAM_HAS_EXEC_FENCE_ARRAY:
+	case I915_PARAM_HAS_EXEC_RESIDENT_SET:
+	case I915_PARAM_HAS_EXEC_VEC:
+	case I915_PARAM_HAS_GEM_CREATE_BATCH:
+	case I915_PARAM_HAS_GEM_CREATE_RECYCLE:
 		/* For the time being all of these are always true;
 		 * if some supported hardware does not have one of these
 		 * features this value needs to be provided from
@@ -425,6 +430,33 @@ static int i915_getparam_ioctl(struct drm_device *dev, void *data,
 		 */
 		value = 1;
 		break;
+	case I915_PARAM_HUGE_POOL_MB:
+		value = dev_priv->mm.huge_pool.capacity *
+			(I915_GTT_PAGE_SIZE_2M / SZ_1M);
+		break;
+	case I915_PARAM_HAS_EXEC_SEQNO:
+		value = INTEL_GEN(dev_priv) >= 8;
+		break;
+	case I915_PARAM_HAS_EXEC_SPARSE:
+		value = INTEL_GEN(dev_priv) >= 8 && USES_FULL_PPGTT(dev_priv);
+		break;
+	case I915_PARAM_HAS_PREAD_WC_STREAM:
+		value = i915_has_memcpy_from_wc();
+		break;
+	case I915_PARAM_HAS_GEM_DETILE:
+		value = INTEL_GEN(dev_priv) >= 4 &&
+			dev_priv->mm.bit_6_swizzle_x != I915_BIT_6_SWIZZLE_UNKNOWN &&
+			dev_priv->mm.bit_6_swizzle_y != I915_BIT_6_SWIZZLE_UNKNOWN;
+		break;
+	case I915_PARAM_HAS_GEM_CREATE_STOLEN:
+		value = drm_mm_initialized(&dev_priv->mm.stolen);
+		break;
+	case I915_PARAM_HAS_EXEC_BSD_BALANCE:
+		value = HAS_BSD2(dev_priv);
+		break;
+	case I915_PARAM_HAS_EXEC_TIMESTAMP:
+		value = INTEL_GEN(dev_priv) >= 8;
+		break;
 	case I915_PARAM_HAS_CONTEXT_ISOLATION:
 		value = intel_engines_has_context_isolation(dev_priv);
 		break;
@@ -817,8 +849,20 @@ static int i915_workqueues_init(struct drm_i915_private *dev_priv)
 	if (dev_priv->hotplug.dp_wq == NULL)
 		goto out_free_wq;
 
+	/*
+	 * Deferred clflushes sit between userspace and the GPU starting
+	 * on its next batch, so give them their own high priority queue
+	 * free to run on any cpu.
+	 */
+	dev_priv->clflush_wq = alloc_workqueue("i915-clflush",
+					       WQ_UNBOUND | WQ_HIGHPRI, 0);
+	if (dev_priv->clflush_wq == NULL)
+		goto out_free_dp_wq;
+
 	return 0;
 
+out_free_dp_wq:
+	destroy_workqueue(dev_priv->hotplug.dp_wq);
 out_free_wq:
 	destroy_workqueue(dev_priv->wq);
 out_err:
@@ -838,6 +882,7 @@ static void i915_engines_cleanup(struct drm_i915_private *i915)
 
 static void i915_workqueues_cleanup(struct drm_i915_private *dev_priv)
 {
+	destroy_workqueue(dev_priv->clflush_wq);
 	destroy_workqueue(dev_priv->hotplug.dp_wq);
 	destroy_workqueue(dev_priv->wq);
 }
@@ -867,6 +912,55 @@ static void intel_detect_preproduction_hw(struct drm_i915_private *dev_priv)
 	}
 }
 
+static u64 resume_step(struct drm_i915_private *dev_priv,
+		       enum i915_resume_step step, u64 start)
+{
+	u64 *last = dev_priv->runtime_pm.resume_stats.last_ns;
+	u64 *max = dev_priv->runtime_pm.resume_stats.max_ns;
+	u64 now = ktime_get_ns();
+
+	last[step] = now - start;
+	if (last[step] > max[step])
+		max[step] = last[step];
+
+	return now;
+}
+
+static void intel_runtime_resume_work(struct work_struct *work)
+{
+	struct drm_i915_private *dev_priv =
+		container_of(work, typeof(*dev_priv), runtime_pm.resume_work);
+	u64 start = ktime_get_ns();
+
+	/*
+	 * We are serialised against the device suspending again by
+	 * intel_runtime_suspend() cancelling us before it touches the
+	 * hardware, so the device is awake even though we do not hold a
+	 * wakeref of our own.
+	 */
+	disable_rpm_wakeref_asserts(dev_priv);
+
+	/*
+	 * On VLV/CHV display interrupts are part of the display
+	 * power well, so hpd is reinitialized from there. For
+	 * everyone else do it here.
+	 */
+	if (!IS_VALLEYVIEW(dev_priv) && !IS_CHERRYVIEW(dev_priv))
+		intel_hpd_init(dev_priv);
+
+	intel_enable_ipc(dev_priv);
+
+	enable_rpm_wakeref_asserts(dev_priv);
+
+	resume_step(dev_priv, I915_RESUME_DISPLAY, start);
+}
+
+static void intel_runtime_resume_init(struct drm_i915_private *dev_priv)
+{
+	INIT_WORK(&dev_priv->runtime_pm.resume_work,
+		  intel_runtime_resume_work);
+}
+
 /**
  * i915_driver_init_early - setup state not requiring device access
  * @dev_priv: device private
@@ -927,6 +1021,7 @@ static int i915_driver_init_early(struct drm_i915_private *dev_priv,
 	intel_power_domains_init(dev_priv);
 	intel_irq_init(dev_priv);
 	intel_hangcheck_init(dev_priv);
+	intel_runtime_resume_init(dev_priv);
 	intel_init_display_hooks(dev_priv);
 	intel_init_clock_gating_hooks(dev_priv);
 	intel_init_audio_hooks(dev_priv);
@@ -934,6 +1029,10 @@ static int i915_driver_init_early(struct drm_i915_private *dev_priv,
 
 	intel_detect_preproduction_hw(dev_priv);
 
+	/* Look up the firmwares in the background, until they are needed */
+	intel_csr_ucode_prefetch(dev_priv);
+	intel_uc_prefetch_firmwares(dev_priv);
+
 	return 0;
 
 err_workqueues:
@@ -949,6 +1048,7 @@ static int i915_driver_init_early(struct drm_i915_private *dev_priv,
  */
 static void i915_driver_cleanup_early(struct drm_i915_private *dev_priv)
 {
+	intel_csr_ucode_prefetch_cancel(dev_priv);
 	intel_irq_fini(dev_priv);
 	intel_uc_cleanup_early(dev_priv);
 	i915_gem_cleanup_early(dev_priv);
@@ -1267,6 +1367,8 @@ static void i915_driver_register(struct drm_i915_private *dev_priv)
 	 * irqs are fully enabled. We do it last so that the async config
 	 * cannot run before the connectors are registered.
 	 */
+	if (INTEL_INFO(dev_priv)->num_pipes)
+		intel_dp_prefetch_edids(dev_priv);
 	intel_fbdev_initial_config_async(dev);
 
 	/*
@@ -1300,6 +1402,11 @@ static void i915_driver_unregister(struct drm_i915_private *dev_priv)
 	i915_perf_unregister(dev_priv);
 	i915_pmu_unregister(dev_priv);
 
+	/* The relay channel lives in debugfs; close it before unregistering */
+	mutex_lock(&dev_priv->drm.struct_mutex);
+	i915_aub_stream_stop(dev_priv);
+	mutex_unlock(&dev_priv->drm.struct_mutex);
+
 	i915_teardown_sysfs(dev_priv);
 	drm_dev_unregister(&dev_priv->drm);
 
@@ -1321,6 +1428,16 @@ static void i915_welcome_messages(struct drm_i915_private *dev_priv)
 		DRM_INFO("DRM_I915_DEBUG_GEM enabled\n");
 }
 
+static void init_phase(struct drm_i915_private *dev_priv,
+		       const char *name, ktime_t *start)
+{
+	ktime_t now = ktime_get();
+
+	DRM_DEBUG_DRIVER("init %s took %lldus\n",
+			 name, ktime_us_delta(now, *start));
+	*start = now;
+}
+
 /**
  * i915_driver_load - setup chip and create an initial config
  * @pdev: PCI device
@@ -1337,6 +1454,7 @@ int i915_driver_load(struct pci_dev *pdev, const struct pci_device_id *ent)
 	const struct intel_device_info *match_info =
 		(struct intel_device_info *)ent->driver_data;
 	struct drm_i915_private *dev_priv;
+	ktime_t start;
 	int ret;
 
 	/* Enable nuclear pageflip on ILK+ */
@@ -1370,19 +1488,24 @@ int i915_driver_load(struct pci_dev *pdev, const struct pci_device_id *ent)
 	 */
 	dev_pm_set_driver_flags(&pdev->dev, DPM_FLAG_NEVER_SKIP);
 
+	start = ktime_get();
+
 	ret = i915_driver_init_early(dev_priv, ent);
 	if (ret < 0)
 		goto out_pci_disable;
+	init_phase(dev_priv, "early", &start);
 
 	intel_runtime_pm_get(dev_priv);
 
 	ret = i915_driver_init_mmio(dev_priv);
 	if (ret < 0)
 		goto out_runtime_pm_put;
+	init_phase(dev_priv, "mmio", &start);
 
 	ret = i915_driver_init_hw(dev_priv);
 	if (ret < 0)
 		goto out_cleanup_mmio;
+	init_phase(dev_priv, "hw", &start);
 
 	/*
 	 * TODO: move the vblank init and parts of modeset init steps into one
@@ -1399,8 +1522,10 @@ int i915_driver_load(struct pci_dev *pdev, const struct pci_device_id *ent)
 	ret = i915_load_modeset_init(&dev_priv->drm);
 	if (ret < 0)
 		goto out_cleanup_hw;
+	init_phase(dev_priv, "modeset", &start);
 
 	i915_driver_register(dev_priv);
+	init_phase(dev_priv, "register", &start);
 
 	intel_runtime_pm_enable(dev_priv);
 
@@ -1437,6 +1562,8 @@ void i915_driver_unload(struct drm_device *dev)
 
 	i915_driver_unregister(dev_priv);
 
+	flush_work(&dev_priv->runtime_pm.resume_work);
+
 	if (i915_gem_suspend(dev_priv))
 		DRM_ERROR("failed to idle hardware; continuing to unload!\n");
 
@@ -1574,6 +1701,8 @@ static int i915_drm_suspend(struct drm_device *dev)
 
 	disable_rpm_wakeref_asserts(dev_priv);
 
+	flush_work(&dev_priv->runtime_pm.resume_work);
+
 	/* We do a lot of poking in a lot of registers, make sure they work
 	 * properly. */
 	intel_display_set_init_power(dev_priv, true);
@@ -2598,6 +2727,9 @@ static int intel_runtime_suspend(struct device *kdev)
 
 	DRM_DEBUG_KMS("Suspending device\n");
 
+	/* The deferred part of the last resume must not run while asleep */
+	cancel_work_sync(&dev_priv->runtime_pm.resume_work);
+
 	disable_rpm_wakeref_asserts(dev_priv);
 
 	/*
@@ -2683,6 +2815,7 @@ static int intel_runtime_resume(struct device *kdev)
 	struct pci_dev *pdev = to_pci_dev(kdev);
 	struct drm_device *dev = pci_get_drvdata(pdev);
 	struct drm_i915_private *dev_priv = to_i915(dev);
+	u64 start, now;
 	int ret = 0;
 
 	if (WARN_ON_ONCE(!HAS_RUNTIME_PM(dev_priv)))
@@ -2693,6 +2826,8 @@ static int intel_runtime_resume(struct device *kdev)
 	WARN_ON_ONCE(atomic_read(&dev_priv->runtime_pm.wakeref_count));
 	disable_rpm_wakeref_asserts(dev_priv);
 
+	start = now = ktime_get_ns();
+
 	intel_opregion_notify_adapter(dev_priv, PCI_D0);
 	dev_priv->runtime_pm.suspended = false;
 	if (intel_uncore_unclaimed_mmio(dev_priv))
@@ -2709,12 +2844,16 @@ static int intel_runtime_resume(struct device *kdev)
 	} else if (IS_VALLEYVIEW(dev_priv) || IS_CHERRYVIEW(dev_priv)) {
 		ret = vlv_resume_prepare(dev_priv, true);
 	}
+	now = resume_step(dev_priv, I915_RESUME_PLATFORM, now);
 
 	intel_uncore_runtime_resume(dev_priv);
+	now = resume_step(dev_priv, I915_RESUME_UNCORE, now);
 
 	intel_runtime_pm_enable_interrupts(dev_priv);
+	now = resume_step(dev_priv, I915_RESUME_IRQ, now);
 
 	intel_uc_resume(dev_priv);
+	now = resume_step(dev_priv, I915_RESUME_UC, now);
 
 	/*
 	 * No point of rolling back things in case of an error, as the best
@@ -2722,16 +2861,18 @@ static int intel_runtime_resume(struct device *kdev)
 	 */
 	i915_gem_init_swizzling(dev_priv);
 	i915_gem_restore_fences(dev_priv);
+	now = resume_step(dev_priv, I915_RESUME_GEM, now);
 
 	/*
-	 * On VLV/CHV display interrupts are part of the display
-	 * power well, so hpd is reinitialized from there. For
-	 * everyone else do it here.
+	 * That is all the GT needs to execute the request that woke us up.
+	 * Leave the rest of the display to catch up in the background.
 	 */
-	if (!IS_VALLEYVIEW(dev_priv) && !IS_CHERRYVIEW(dev_priv))
-		intel_hpd_init(dev_priv);
+	schedule_work(&dev_priv->runtime_pm.resume_work);
 
-	intel_enable_ipc(dev_priv);
+	dev_priv->runtime_pm.resume_stats.total_ns = now - start;
+	dev_priv->runtime_pm.resume_stats.max_total_ns =
+		max(dev_priv->runtime_pm.resume_stats.max_total_ns, now - start);
+	dev_priv->runtime_pm.resume_stats.count++;
 
 	enable_rpm_wakeref_asserts(dev_priv);
 
@@ -2789,16 +2930,35 @@ static const struct vm_operations_struct i915_gem_vm_ops = {
 	.close = drm_gem_vm_close,
 };
 
+static void i915_show_fdinfo(struct seq_file *m, struct file *f)
+{
+	struct drm_file *file = f->private_data;
+
+	i915_gem_client_show_fdinfo(m, file);
+}
+
+static int i915_file_release(struct inode *inode, struct file *filp)
+{
+	struct drm_file *file = filp->private_data;
+	struct drm_i915_file_private *file_priv = file->driver_priv;
+
+	/* Don't cache the objects closed as the file goes away */
+	WRITE_ONCE(file_priv->recycle.closing, true);
+
+	return drm_release(inode, filp);
+}
+
 static const struct file_operations i915_driver_fops = {
 	.owner = THIS_MODULE,
 	.open = drm_open,
-	.release = drm_release,
+	.release = i915_file_release,
 	.unlocked_ioctl = drm_ioctl,
 	.mmap = drm_gem_mmap,
 	.poll = drm_poll,
 	.read = drm_read,
 	.compat_ioctl = i915_compat_ioctl,
 	.llseek = noop_llseek,
+	.show_fdinfo = i915_show_fdinfo,
 };
 
 static int
@@ -2865,6 +3025,11 @@ static const struct drm_ioctl_desc i915_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(I915_PERF_ADD_CONFIG, i915_perf_add_config_ioctl, DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(I915_PERF_REMOVE_CONFIG, i915_perf_remove_config_ioctl, DRM_UNLOCKED|DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(I915_QUERY, i915_query_ioctl, DRM_UNLOCKED|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(I915_GEM_EXECBUFFER2_VEC, i915_gem_execbuffer2_vec_ioctl, DRM_AUTH|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(I915_GEM_CREATE_BATCH, i915_gem_create_batch_ioctl, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(I915_GEM_BUSY_BATCH, i915_gem_busy_batch_ioctl, DRM_AUTH|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(I915_GEM_WAIT_MULTI, i915_gem_wait_multi_ioctl, DRM_AUTH|DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(I915_GEM_CONTEXT_TRTT_BIND, i915_gem_context_trtt_bind_ioctl, DRM_AUTH|DRM_RENDER_ALLOW),
 };
 
 static struct drm_driver driver = {
@@ -2873,7 +3038,8 @@ static struct drm_driver driver = {
 	 */
 	.driver_features =
 	    DRIVER_HAVE_IRQ | DRIVER_IRQ_SHARED | DRIVER_GEM | DRIVER_PRIME |
-	    DRIVER_RENDER | DRIVER_MODESET | DRIVER_ATOMIC | DRIVER_SYNCOBJ,
+	    DRIVER_RENDER | DRIVER_MODESET | DRIVER_ATOMIC | DRIVER_SYNCOBJ |
+	    DRIVER_GEM_RCU,
 	.release = i915_driver_release,
 	.open = i915_driver_open,
 	.lastclose = i915_driver_lastclose,
@@ -45,6 +45,7 @@
 #include <linux/pm_qos.h>
 #include <linux/reservation.h>
 #include <linux/shmem_fs.h>
+#include <linux/stackdepot.h>
 
 #include <drm/drmP.h>
 #include <drm/intel-gtt.h>
@@ -329,6 +330,28 @@ struct drm_i915_private;
 struct i915_mm_struct;
 struct i915_mmu_object;
 
+/*
+ * Running totals of the memory owned by a client, updated as its objects
+ * are created, bound, marked purgeable and freed so that reporting them
+ * never has to walk the object lists. The counters outlive the file, as
+ * objects may still be referenced (e.g. via dma-buf) after it is closed.
+ */
+enum i915_gem_client_stat {
+	I915_GEM_CLIENT_SHMEM = 0,
+	I915_GEM_CLIENT_USERPTR,
+	I915_GEM_CLIENT_PURGEABLE,
+	I915_GEM_CLIENT_GGTT,
+	I915_GEM_CLIENT_PPGTT,
+	I915_GEM_CLIENT_HUGE_POOL,
+	I915_GEM_CLIENT_STOLEN,
+	I915_GEM_CLIENT_NUM_STATS
+};
+
+struct i915_gem_client_memory {
+	struct kref ref;
+	atomic64_t stat[I915_GEM_CLIENT_NUM_STATS]; /* in bytes */
+};
+
 struct drm_i915_file_private {
 	struct drm_i915_private *dev_priv;
 	struct drm_file *file;
@@ -347,6 +370,9 @@ struct drm_i915_file_private {
 
 	struct intel_rps_client {
 		atomic_t boosts;
+		atomic_t skipped; /* predicted to complete before taking effect */
+		atomic_t throttled; /* too soon after the previous boost */
+		unsigned long next_boost; /* jiffies */
 	} rps_client;
 
 	unsigned int bsd_engine;
@@ -366,6 +392,27 @@ struct drm_i915_file_private {
 	/** ban_score: Accumulated score of all ctx bans and fast hangs. */
 	atomic_t ban_score;
 	unsigned long hang_timestamp;
+
+	/**
+	 * closed_busy_ns: GPU time used by the client's contexts that have
+	 * since been destroyed, see i915_gem_client_busy_time().
+	 */
+	atomic64_t closed_busy_ns;
+
+	/** memory: totals of the memory owned by this client's objects */
+	struct i915_gem_client_memory *memory;
+
+	/**
+	 * recycle: objects closed by the client while marked purgeable,
+	 * bucketed by size, for reuse by I915_GEM_CREATE_RECYCLE. Protected
+	 * by struct_mutex. Bypassed once the file is being released, as
+	 * its remaining handles are then all closed.
+	 */
+	struct {
+		struct list_head cache_list[4];
+		u64 size;
+		bool closing;
+	} recycle;
 };
 
 /* Interface history:
@@ -464,6 +511,10 @@ struct drm_i915_display_funcs {
 struct intel_csr {
 	struct work_struct work;
 	const char *fw_path;
+	/* see intel_csr_ucode_prefetch() */
+	const struct firmware *prefetch;
+	struct completion prefetch_done;
+	bool prefetching;
 	uint32_t *dmc_payload;
 	uint32_t dmc_fw_size;
 	uint32_t version;
@@ -472,6 +523,13 @@ struct intel_csr {
 	uint32_t mmiodata[8];
 	uint32_t dc_state;
 	uint32_t allowed_dc_mask;
+	/*
+	 * time the driver has allowed DC5/DC6 (not the residency the DMC
+	 * actually achieved), under power_domains.lock
+	 */
+	ktime_t dc_state_since;
+	ktime_t dc5_time;
+	ktime_t dc6_time;
 };
 
 enum i915_cache_level {
@@ -528,6 +586,7 @@ struct intel_fbc {
 		struct {
 			unsigned int mode_flags;
 			uint32_t hsw_bdw_pixel_rate;
+			bool async_flip;
 		} crtc;
 
 		struct {
@@ -579,6 +638,14 @@ struct intel_fbc {
 		unsigned int gen9_wa_cfb_stride;
 	} params;
 
+	/* Per pipe compression statistics, shown in i915_fbc_status */
+	struct {
+		unsigned long activations;
+		unsigned long recompressions;
+		ktime_t active_since;
+		u64 active_ns;
+	} stats[I915_MAX_PIPES];
+
 	const char *no_fbc_reason;
 };
 
@@ -614,7 +681,7 @@ struct i915_psr {
 	bool sink_support;
 	struct intel_dp *enabled;
 	bool active;
-	struct work_struct work;
+	struct delayed_work work;
 	unsigned busy_frontbuffer_bits;
 	bool sink_psr2_support;
 	bool link_standby;
@@ -625,6 +692,18 @@ struct i915_psr {
 	bool debug;
 	ktime_t last_entry_attempt;
 	ktime_t last_exit;
+
+	/* Re-activation pacing, see psr_reactivate_delay() */
+	unsigned int frame_us;
+	unsigned int flush_interval_us;
+	ktime_t last_flush;
+	ktime_t active_since;
+	u64 residency_ns;
+	unsigned long activations;
+	unsigned long exits;
+	unsigned long deferred;
+	unsigned long hw_entries;
+	unsigned long hw_exits;
 };
 
 enum intel_pch {
@@ -789,6 +868,19 @@ struct intel_rps {
 	atomic_t num_waiters;
 	atomic_t boosts;
 
+	/*
+	 * Frequency hints of the requests currently executing, counted by
+	 * the frequency requested (U8_MAX for no maximum), see
+	 * I915_CONTEXT_PARAM_FREQUENCY. users is the number of contexts with
+	 * a hint; no accounting is done while there are none.
+	 */
+	struct {
+		atomic_t min[U8_MAX + 1];
+		atomic_t max[U8_MAX + 1];
+		atomic_t users;
+		atomic_t dirty;
+	} qos;
+
 	/* manual wa residency calculations */
 	struct intel_rps_ei ei;
 };
@@ -869,6 +961,9 @@ struct i915_power_well {
 	int count;
 	/* cached hw enabled state */
 	bool hw_enabled;
+	/* number of hw off->on and on->off transitions, for debugfs */
+	unsigned long enable_count;
+	unsigned long disable_count;
 	u64 domains;
 	/* unique identifier for this power well */
 	enum i915_power_well_id id;
@@ -900,9 +995,49 @@ struct i915_power_domains {
 	bool initializing;
 	int power_well_count;
 
+	/*
+	 * Each domain holds a single reference on each of its power wells for
+	 * as long as its use count is non-zero. Only the 0<->1 transitions of
+	 * domain_use_count need to take the lock to update the wells; any
+	 * other get or put is a lockless atomic update.
+	 */
 	struct mutex lock;
-	int domain_use_count[POWER_DOMAIN_NUM];
+	atomic_t domain_use_count[POWER_DOMAIN_NUM];
 	struct i915_power_well *power_wells;
+
+	/*
+	 * Who took the first reference on each domain (that is, who powered
+	 * it up) and when, so that a leaked reference keeping the display
+	 * out of its deep DC states can be identified. Updated under @lock.
+	 */
+	struct {
+		unsigned long caller;
+		ktime_t since;
+	} domain_holder[POWER_DOMAIN_NUM];
+
+#if IS_ENABLED(CONFIG_DRM_I915_DEBUG_RUNTIME_PM)
+	/*
+	 * Every caller that took a reference on each domain, lockless gets
+	 * included, so that the holder of a leaked reference can be found and
+	 * not just whoever powered the domain up. Puts do not say which
+	 * reference they drop, so rather than guess, the callers are counted
+	 * and kept until the domain has no references left (@held reaches
+	 * zero). Protected by @debug_lock.
+	 */
+	spinlock_t debug_lock;
+	struct {
+		struct i915_power_domain_caller {
+			depot_stack_handle_t stack;
+			unsigned int count;
+			ktime_t first;
+			ktime_t last;
+		} *callers;
+		unsigned int count;
+		unsigned int size;
+		unsigned int held;
+		unsigned int untracked;
+	} domain_debug[POWER_DOMAIN_NUM];
+#endif
 };
 
 #define MAX_L3_SLICES 2
@@ -912,12 +1047,24 @@ struct intel_l3_parity {
 	int which_slice;
 };
 
+enum i915_pwrite_path {
+	I915_PWRITE_SHMEM = 0,
+	I915_PWRITE_GTT,
+	I915_PWRITE_WC,
+	I915_PWRITE_NUM_PATHS
+};
+
 struct i915_gem_mm {
 	/** Memory allocator for GTT stolen memory */
 	struct drm_mm stolen;
 	/** Protects the usage of the GTT stolen memory allocator. This is
 	 * always the inner lock when overlapping with struct_mutex. */
 	struct mutex stolen_lock;
+	/** Bytes of stolen allocated to userspace, under stolen_lock */
+	u64 stolen_user;
+#define I915_STOLEN_USER 1 /* drm_mm_node.color of userspace allocations */
+#define I915_STOLEN_USER_MAX(i915) ((i915)->stolen_usable_size / 2)
+#define I915_STOLEN_CLIENT_MAX(i915) (I915_STOLEN_USER_MAX(i915) / 2)
 
 	/* Protects bound_list/unbound_list and #drm_i915_gem_object.mm.link */
 	spinlock_t obj_lock;
@@ -938,9 +1085,19 @@ struct i915_gem_mm {
 	struct list_head userfault_list;
 
 	/**
-	 * List of objects which are pending destruction.
+	 * LRU of the objects whose vmap was most recently used by
+	 * i915_gem_object_pin_map(), up to I915_VMAP_CACHE_SIZE bytes worth.
+	 * The shrinker leaves their pages, and so the mapping, alone unless
+	 * it is reclaiming vmap space or everything. Protected by obj_lock.
+	 */
+	struct list_head vmap_list;
+	u64 vmap_size;
+#define I915_VMAP_CACHE_SIZE SZ_32M
+
+	/**
+	 * Per-cpu lists of objects which are pending destruction.
 	 */
-	struct llist_head free_list;
+	struct llist_head __percpu *free_lists;
 	struct work_struct free_work;
 	spinlock_t free_lock;
 	/**
@@ -948,17 +1105,47 @@ struct i915_gem_mm {
 	 * waiting on an RCU barrier if no objects are waiting to be freed.
 	 */
 	atomic_t free_count;
+#define I915_GEM_FREE_BATCH 16 /* objects freed per struct_mutex */
+#define I915_GEM_FREE_BACKLOG 1024 /* objects before creators help free */
+
+	/**
+	 * Calls, bytes and time spent in each pwrite path, for judging the
+	 * choices made by i915_gem_pwrite_ioctl().
+	 */
+	struct i915_pwrite_stats {
+		atomic64_t calls;
+		atomic64_t bytes;
+		atomic64_t ns;
+	} pwrite_stats[I915_PWRITE_NUM_PATHS];
 
 	/**
-	 * Small stash of WC pages
+	 * Per-node pools of WC pages for page tables, shared by all ppgtts
+	 * so that they need not repeatedly change the page attributes.
 	 */
-	struct pagestash wc_stash;
+	struct i915_wc_pool {
+		spinlock_t lock;
+		struct list_head pages;
+		unsigned long count;
+	} *wc_pool;
 
 	/**
 	 * tmpfs instance used for shmem backed objects
 	 */
 	struct vfsmount *gemfs;
 
+	/**
+	 * Pool of 2M pages reserved at load time for objects created with
+	 * I915_GEM_CREATE_HUGE_POOL, see i915_gem_huge_pool.c
+	 */
+	struct {
+		spinlock_t lock;
+		struct list_head pages;
+		unsigned long count;
+		unsigned long capacity;
+		unsigned long hits;
+		unsigned long misses;
+	} huge_pool;
+
 	/** PPGTT used for aliasing the PPGTT with the GTT */
 	struct i915_hw_ppgtt *aliasing_ppgtt;
 
@@ -966,9 +1153,23 @@ struct i915_gem_mm {
 	struct notifier_block vmap_notifier;
 	struct shrinker shrinker;
 
+	/**
+	 * Background reclaim, releasing our pages ahead of direct reclaim
+	 * on any node that falls below its high watermark.
+	 */
+	struct delayed_work shrink_work;
+	unsigned long shrink_kick; /* jiffies of the last kick */
+
 	/** LRU list of objects with fence regs on them. */
 	struct list_head fence_list;
 
+	/** Fence register contention, reported via debugfs. */
+	struct {
+		unsigned long steals; /* reassigned from another vma */
+		unsigned long revokes; /* ... whose mmap had to be zapped */
+		unsigned long waits; /* no register was available */
+	} fence_stats;
+
 	/**
 	 * Workqueue to fault in userptr pages, flushed by the execbuf
 	 * when required but otherwise left to userspace to try again
@@ -1221,6 +1422,27 @@ struct skl_wm_params {
 	uint32_t dbuf_block_size;
 };
 
+/* Everything the skl+ watermarks of a plane are computed from */
+struct skl_wm_key {
+	struct skl_wm_params wp, uv_wp;
+	uint16_t ddb_blocks, uv_ddb_blocks;
+	int htotal;
+	bool visible;
+	bool active;
+	bool memory_bw_wa;
+	bool ipc_enabled;
+};
+
+enum i915_resume_step {
+	I915_RESUME_PLATFORM, /* DC9/PC8 exit, VLV/CHV state restore */
+	I915_RESUME_UNCORE,
+	I915_RESUME_IRQ,
+	I915_RESUME_UC,
+	I915_RESUME_GEM, /* swizzling and fences */
+	I915_RESUME_DISPLAY, /* deferred: hotplug and IPC */
+	I915_RESUME_NUM_STEPS
+};
+
 /*
  * This struct helps tracking the state needed for runtime PM, which puts the
  * device in PCI D3 state. Notice that when this happens, nothing on the
@@ -1248,6 +1470,22 @@ struct i915_runtime_pm {
 	atomic_t wakeref_count;
 	bool suspended;
 	bool irqs_enabled;
+
+	/*
+	 * Display state not needed by the GT is restored from a worker
+	 * after a runtime resume, so as not to delay the request that
+	 * woke us up.
+	 */
+	struct work_struct resume_work;
+
+	/* Time taken by each step of the last runtime resume, and worst */
+	struct {
+		u64 last_ns[I915_RESUME_NUM_STEPS];
+		u64 max_ns[I915_RESUME_NUM_STEPS];
+		u64 total_ns; /* excluding the deferred steps */
+		u64 max_total_ns;
+		unsigned long count;
+	} resume_stats;
 };
 
 enum intel_pipe_crc_source {
@@ -1457,6 +1695,14 @@ struct i915_perf_stream {
 	 * @oa_config: The OA configuration used by the stream.
 	 */
 	struct i915_oa_config *oa_config;
+
+	/**
+	 * @oa_buffer: The OA buffer object, allocated and pinned when the
+	 * stream is opened and only released when its file is closed. It
+	 * does not change in between, so it can be used without taking
+	 * &drm_i915_private->perf.lock.
+	 */
+	struct drm_i915_gem_object *oa_buffer;
 };
 
 /**
@@ -1558,6 +1804,24 @@ struct drm_i915_private {
 	struct kmem_cache *dependencies;
 	struct kmem_cache *priorities;
 
+	/*
+	 * Recently released requests, per engine, and dependencies, reused
+	 * ahead of the slabs on the submission path. Only ever taken from
+	 * under struct_mutex, see i915_request_alloc().
+	 */
+	struct i915_request_cache {
+		struct llist_head free;
+		atomic_t count;
+		unsigned long hits;
+		unsigned long misses;
+	} request_cache[I915_NUM_ENGINES];
+	struct i915_dependency_cache {
+		struct list_head free;
+		unsigned int count;
+		unsigned long hits;
+		unsigned long misses;
+	} dependency_cache;
+
 	const struct intel_device_info info;
 	struct intel_driver_caps caps;
 
@@ -1628,6 +1892,8 @@ struct drm_i915_private {
 	struct i915_gem_context *preempt_context;
 	struct intel_engine_cs *engine_class[MAX_ENGINE_CLASS + 1]
 					    [MAX_ENGINE_INSTANCE + 1];
+	/* sysfs directory holding the per-engine controls */
+	struct kobject *sysfs_engine;
 
 	struct drm_dma_handle *status_page_dmah;
 	struct resource mch_res;
@@ -1707,6 +1973,8 @@ struct drm_i915_private {
 		struct intel_cdclk_state actual;
 		/* The current hardware cdclk state */
 		struct intel_cdclk_state hw;
+		/* Number of times the hardware cdclk was reprogrammed */
+		unsigned long changes;
 	} cdclk;
 
 	/**
@@ -1718,6 +1986,9 @@ struct drm_i915_private {
 	 */
 	struct workqueue_struct *wq;
 
+	/* unbound, high priority wq for deferred clflushes */
+	struct workqueue_struct *clflush_wq;
+
 	/* ordered wq for modesets */
 	struct workqueue_struct *modeset_wq;
 
@@ -1809,6 +2080,12 @@ struct drm_i915_private {
 
 	struct i915_gpu_error gpu_error;
 
+	/* Engine busy stats enabled for DRM_I915_QUERY_TELEMETRY */
+	unsigned long telemetry_engine_stats;
+
+	/* Live AUB trace of a single context, see i915_aubstream.c */
+	struct i915_aub_stream *aub_stream;
+
 	struct drm_i915_gem_object *vlv_pctx;
 
 	/* list of fbdev register on this device */
@@ -1840,6 +2117,25 @@ struct drm_i915_private {
 #define MAX_CONTEXT_HW_ID (1<<21) /* exclusive */
 #define MAX_GUC_CONTEXT_HW_ID (1 << 20) /* exclusive */
 #define GEN11_MAX_CONTEXT_HW_ID (1<<11) /* exclusive */
+
+		/*
+		 * Contexts holding a hw_id, in LRU order of pinning. Once
+		 * the ida is exhausted, we reassign the id of the least
+		 * recently used context not currently pinned.
+		 */
+		struct list_head hw_id_list;
+		unsigned long hw_id_steals;
+
+		/*
+		 * Recently used contexts that are kept pinned after their
+		 * last request is retired, in LRU order, to save repeating
+		 * the pin, rebind and vmap of their state and ring on the
+		 * next request. Each holds one pin of its intel_context; the
+		 * list is bounded by i915_modparams.context_pin_cache and is
+		 * released under GGTT pressure or once the GPU idles.
+		 */
+		struct list_head pin_lru;
+		unsigned int pin_lru_count;
 	} contexts;
 
 	u32 fdi_rx_config;
@@ -1954,6 +2250,16 @@ struct drm_i915_private {
 			wait_queue_head_t poll_wq;
 			bool pollin;
 
+			/**
+			 * The current period of @poll_check_timer, and with
+			 * @poll_adaptive the hw tail and time at the previous
+			 * check used to measure the rate of reports.
+			 */
+			u64 poll_period;
+			u64 poll_last_ns;
+			u32 poll_last_tail;
+			bool poll_adaptive;
+
 			/**
 			 * For rate limiting any notifications of spurious
 			 * invalid OA reports
@@ -1963,6 +2269,12 @@ struct drm_i915_private {
 			bool periodic;
 			int period_exponent;
 
+			/**
+			 * Only forward the reports bookending the specific
+			 * context, see DRM_I915_PERF_PROP_OA_CTX_SWITCH_ONLY.
+			 */
+			bool ctx_switch_only;
+
 			struct i915_oa_config test_config;
 
 			struct {
@@ -2041,6 +2353,15 @@ struct drm_i915_private {
 			u32 ctx_oactxctrl_offset;
 			u32 ctx_flexeu0_offset;
 
+			/*
+			 * The per-context OA configuration last requested,
+			 * and its generation. Each render context applies it
+			 * from its next request onwards, see
+			 * i915_oa_emit_ctx_config().
+			 */
+			const struct i915_oa_config *ctx_config;
+			u32 ctx_config_seqno;
+
 			/**
 			 * The RPT_ID/reason field for Gen8+ includes a bit
 			 * to determine if the CTX ID in the report is valid
@@ -2059,6 +2380,7 @@ struct drm_i915_private {
 		void (*cleanup_engine)(struct intel_engine_cs *engine);
 
 		struct list_head timelines;
+		struct list_head hwsp_free_list;
 
 		struct list_head active_rings;
 		struct list_head closed_vma;
@@ -2080,6 +2402,25 @@ struct drm_i915_private {
 		unsigned int epoch;
 #define I915_EPOCH_INVALID 0
 
+		/**
+		 * How long we wait after the last retire before parking,
+		 * adapted between i915.park_delay_ms and
+		 * I915_PARK_DELAY_MAX_MS so that bursty loads with short
+		 * gaps do not park and unpark constantly, and statistics
+		 * on the transitions. Protected by struct_mutex.
+		 */
+		struct {
+			unsigned int delay_ms;
+			ktime_t parked; /* when we last parked */
+			ktime_t unparked; /* when we last unparked */
+			unsigned long parks;
+			unsigned long unparks;
+			unsigned long thrash; /* unparked again within the delay */
+			u64 park_ns; /* total time spent parking */
+			u64 unpark_ns; /* total time spent unparking */
+		} park;
+#define I915_PARK_DELAY_MAX_MS 1000
+
 		/**
 		 * We leave the user IRQ off as much as possible,
 		 * but this means that requests will finish and never
@@ -2099,6 +2440,19 @@ struct drm_i915_private {
 		struct delayed_work idle_work;
 
 		ktime_t last_init_time;
+
+		/**
+		 * Duration of each phase of the last system suspend, see
+		 * i915_gem_suspend() and i915_gem_suspend_late().
+		 */
+		struct {
+			ktime_t idle;
+			ktime_t writeback;
+			ktime_t uc;
+			ktime_t workers;
+			ktime_t domains;
+			ktime_t sanitize;
+		} suspend_time;
 	} gt;
 
 	/* perform PHY state sanity checks? */
@@ -2765,6 +3119,20 @@ static inline void i915_queue_hangcheck(struct drm_i915_private *dev_priv)
 			   &dev_priv->gpu_error.hangcheck_work, delay);
 }
 
+/*
+ * Run the hangcheck immediately, e.g. once the hw watchdog has confirmed
+ * that a context stopped making progress, rather than waiting for the next
+ * sampling period.
+ */
+static inline void i915_kick_hangcheck(struct drm_i915_private *dev_priv)
+{
+	if (unlikely(!i915_modparams.enable_hangcheck))
+		return;
+
+	mod_delayed_work(system_long_wq,
+			 &dev_priv->gpu_error.hangcheck_work, 0);
+}
+
 __printf(4, 5)
 void i915_handle_error(struct drm_i915_private *dev_priv,
 		       u32 engine_mask,
@@ -2829,6 +3197,8 @@ static inline void bdw_disable_pipe_irq(struct drm_i915_private *dev_priv,
 {
 	bdw_update_pipe_irq(dev_priv, pipe, bits, 0);
 }
+void skl_arm_flip_done(struct intel_crtc *crtc,
+		       struct drm_pending_vblank_event *event);
 void ibx_display_interrupt_update(struct drm_i915_private *dev_priv,
 				  uint32_t interrupt_mask,
 				  uint32_t enabled_irq_mask);
@@ -2846,6 +3216,8 @@ ibx_disable_display_interrupt(struct drm_i915_private *dev_priv, uint32_t bits)
 /* i915_gem.c */
 int i915_gem_create_ioctl(struct drm_device *dev, void *data,
 			  struct drm_file *file_priv);
+int i915_gem_create_batch_ioctl(struct drm_device *dev, void *data,
+				struct drm_file *file_priv);
 int i915_gem_pread_ioctl(struct drm_device *dev, void *data,
 			 struct drm_file *file_priv);
 int i915_gem_pwrite_ioctl(struct drm_device *dev, void *data,
@@ -2862,8 +3234,12 @@ int i915_gem_execbuffer_ioctl(struct drm_device *dev, void *data,
 			      struct drm_file *file_priv);
 int i915_gem_execbuffer2_ioctl(struct drm_device *dev, void *data,
 			       struct drm_file *file_priv);
+int i915_gem_execbuffer2_vec_ioctl(struct drm_device *dev, void *data,
+				   struct drm_file *file_priv);
 int i915_gem_busy_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_priv);
+int i915_gem_busy_batch_ioctl(struct drm_device *dev, void *data,
+			      struct drm_file *file_priv);
 int i915_gem_get_caching_ioctl(struct drm_device *dev, void *data,
 			       struct drm_file *file);
 int i915_gem_set_caching_ioctl(struct drm_device *dev, void *data,
@@ -2884,6 +3260,8 @@ int i915_gem_get_aperture_ioctl(struct drm_device *dev, void *data,
 				struct drm_file *file_priv);
 int i915_gem_wait_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_priv);
+int i915_gem_wait_multi_ioctl(struct drm_device *dev, void *data,
+			      struct drm_file *file_priv);
 void i915_gem_sanitize(struct drm_i915_private *i915);
 int i915_gem_init_early(struct drm_i915_private *dev_priv);
 void i915_gem_cleanup_early(struct drm_i915_private *dev_priv);
@@ -3185,6 +3563,23 @@ int i915_gem_object_attach_phys(struct drm_i915_gem_object *obj,
 				int align);
 int i915_gem_open(struct drm_i915_private *i915, struct drm_file *file);
 void i915_gem_release(struct drm_device *dev, struct drm_file *file);
+void i915_gem_object_set_client(struct drm_i915_gem_object *obj,
+				struct drm_file *file,
+				enum i915_gem_client_stat type);
+int i915_gem_object_set_client_limited(struct drm_i915_gem_object *obj,
+				       struct drm_file *file,
+				       enum i915_gem_client_stat type,
+				       u64 limit);
+void i915_gem_client_show_fdinfo(struct seq_file *m, struct drm_file *file);
+
+static inline void
+i915_gem_object_client_account(struct drm_i915_gem_object *obj,
+			       enum i915_gem_client_stat stat,
+			       s64 bytes)
+{
+	if (obj->client.memory)
+		atomic64_add(bytes, &obj->client.memory->stat[stat]);
+}
 
 int i915_gem_object_set_cache_level(struct drm_i915_gem_object *obj,
 				    enum i915_cache_level cache_level);
@@ -3297,6 +3692,7 @@ int i915_perf_remove_config_ioctl(struct drm_device *dev, void *data,
 void i915_oa_init_reg_state(struct intel_engine_cs *engine,
 			    struct i915_gem_context *ctx,
 			    uint32_t *reg_state);
+int i915_oa_emit_ctx_config(struct i915_request *rq);
 
 /* i915_gem_evict.c */
 int __must_check i915_gem_evict_something(struct i915_address_space *vm,
@@ -3335,11 +3731,22 @@ struct drm_i915_gem_object *
 i915_gem_object_create_stolen(struct drm_i915_private *dev_priv,
 			      resource_size_t size);
 struct drm_i915_gem_object *
+i915_gem_object_create_stolen_user(struct drm_i915_private *dev_priv,
+				   struct drm_file *file,
+				   resource_size_t size);
+struct drm_i915_gem_object *
 i915_gem_object_create_stolen_for_preallocated(struct drm_i915_private *dev_priv,
 					       resource_size_t stolen_offset,
 					       resource_size_t gtt_offset,
 					       resource_size_t size);
 
+/* i915_gem_huge_pool.c */
+struct drm_i915_gem_object *
+i915_gem_object_create_huge_pool(struct drm_i915_private *i915,
+				 struct drm_file *file, u64 size);
+void i915_gem_huge_pool_init(struct drm_i915_private *i915);
+void i915_gem_huge_pool_fini(struct drm_i915_private *i915);
+
 /* i915_gem_internal.c */
 struct drm_i915_gem_object *
 i915_gem_object_create_internal(struct drm_i915_private *dev_priv,
@@ -3373,6 +3780,9 @@ u32 i915_gem_fence_size(struct drm_i915_private *dev_priv, u32 size,
 			unsigned int tiling, unsigned int stride);
 u32 i915_gem_fence_alignment(struct drm_i915_private *dev_priv, u32 size,
 			     unsigned int tiling, unsigned int stride);
+int i915_gem_object_copy_tiled(struct drm_i915_gem_object *obj,
+			       u64 offset, u64 size, char __user *user,
+			       bool write, unsigned int clflush);
 
 /* i915_debugfs.c */
 #ifdef CONFIG_DEBUG_FS
@@ -3398,6 +3808,34 @@ int intel_engine_cmd_parser(struct intel_engine_cs *engine,
 			    u32 batch_start_offset,
 			    u32 batch_len,
 			    bool is_master);
+struct drm_i915_gem_object *
+intel_engine_cmd_parser_lookup(struct intel_engine_cs *engine,
+			       struct drm_i915_gem_object *batch_obj,
+			       u32 batch_start_offset,
+			       u32 batch_len,
+			       bool is_master,
+			       unsigned int *gen);
+void intel_engine_cmd_parser_store(struct intel_engine_cs *engine,
+				   struct drm_i915_gem_object *batch_obj,
+				   struct drm_i915_gem_object *shadow_batch_obj,
+				   u32 batch_start_offset,
+				   u32 batch_len,
+				   bool is_master,
+				   unsigned int gen);
+void __i915_gem_object_invalidate_cmd_cache(struct drm_i915_gem_object *obj);
+
+/*
+ * Called after the contents of @obj have (or may have) been changed, to
+ * drop any validated copy the command parser kept of it.
+ */
+static inline void
+i915_gem_object_invalidate_cmd_cache(struct drm_i915_gem_object *obj)
+{
+	atomic_inc(&obj->cmd_cache.gen);
+	smp_mb__after_atomic(); /* pairs with intel_engine_cmd_parser_store() */
+	if (READ_ONCE(obj->cmd_cache.shadow))
+		__i915_gem_object_invalidate_cmd_cache(obj);
+}
 
 /* i915_perf.c */
 extern void i915_perf_init(struct drm_i915_private *dev_priv);
@@ -3576,6 +4014,7 @@ int intel_gpu_freq(struct drm_i915_private *dev_priv, int val);
 int intel_freq_opcode(struct drm_i915_private *dev_priv, int val);
 u64 intel_rc6_residency_ns(struct drm_i915_private *dev_priv,
 			   const i915_reg_t reg);
+u64 intel_rc6_total_residency_ns(struct drm_i915_private *dev_priv);
 
 u32 intel_get_cagf(struct drm_i915_private *dev_priv, u32 rpstat1);
 
@@ -137,8 +137,38 @@ int i915_mutex_lock_interruptible(struct drm_device *dev)
 	return 0;
 }
 
+static unsigned int park_delay_min(void)
+{
+	return clamp_t(unsigned int, i915_modparams.park_delay_ms,
+		       1, I915_PARK_DELAY_MAX_MS);
+}
+
+/*
+ * Called as we unpark: if we had only just parked, we were too hasty and
+ * should wait longer before parking next time. If instead we stayed parked
+ * for a good while, the load has become more sparse and we can afford to
+ * park sooner again.
+ */
+static void park_delay_adapt(struct drm_i915_private *i915, ktime_t now)
+{
+	unsigned int min = park_delay_min();
+	unsigned int delay = max(i915->gt.park.delay_ms, min);
+	s64 parked_ms = ktime_ms_delta(now, i915->gt.park.parked);
+
+	if (parked_ms < delay) {
+		i915->gt.park.thrash++;
+		delay = min_t(unsigned int, 2 * delay, I915_PARK_DELAY_MAX_MS);
+	} else if (parked_ms > 8 * delay) {
+		delay = max(delay / 2, min);
+	}
+
+	i915->gt.park.delay_ms = delay;
+}
+
 static u32 __i915_gem_park(struct drm_i915_private *i915)
 {
+	ktime_t start;
+
 	GEM_TRACE("\n");
 
 	lockdep_assert_held(&i915->drm.struct_mutex);
@@ -150,6 +180,8 @@ static u32 __i915_gem_park(struct drm_i915_private *i915)
 
 	GEM_BUG_ON(i915->gt.epoch == I915_EPOCH_INVALID);
 
+	start = ktime_get();
+
 	/*
 	 * Be paranoid and flush a concurrent interrupt to make sure
 	 * we don't reactivate any irq tasklets after parking.
@@ -178,6 +210,11 @@ static u32 __i915_gem_park(struct drm_i915_private *i915)
 
 	intel_runtime_pm_put(i915);
 
+	i915->gt.park.parked = ktime_get();
+	i915->gt.park.park_ns += ktime_to_ns(ktime_sub(i915->gt.park.parked,
+						       start));
+	i915->gt.park.parks++;
+
 	return i915->gt.epoch;
 }
 
@@ -192,11 +229,15 @@ void i915_gem_park(struct drm_i915_private *i915)
 		return;
 
 	/* Defer the actual call to __i915_gem_park() to prevent ping-pongs */
-	mod_delayed_work(i915->wq, &i915->gt.idle_work, msecs_to_jiffies(100));
+	mod_delayed_work(i915->wq, &i915->gt.idle_work,
+			 msecs_to_jiffies(max(i915->gt.park.delay_ms,
+					      park_delay_min())));
 }
 
 void i915_gem_unpark(struct drm_i915_private *i915)
 {
+	ktime_t start;
+
 	GEM_TRACE("\n");
 
 	lockdep_assert_held(&i915->drm.struct_mutex);
@@ -205,6 +246,10 @@ void i915_gem_unpark(struct drm_i915_private *i915)
 	if (i915->gt.awake)
 		return;
 
+	start = ktime_get();
+	if (i915->gt.park.parks)
+		park_delay_adapt(i915, start);
+
 	intel_runtime_pm_get_noresume(i915);
 
 	/*
@@ -237,6 +282,11 @@ void i915_gem_unpark(struct drm_i915_private *i915)
 	queue_delayed_work(i915->wq,
 			   &i915->gt.retire_work,
 			   round_jiffies_up_relative(HZ));
+
+	i915->gt.park.unparked = ktime_get();
+	i915->gt.park.unpark_ns += ktime_to_ns(ktime_sub(i915->gt.park.unparked,
+							 start));
+	i915->gt.park.unparks++;
 }
 
 int
@@ -437,7 +487,14 @@ int i915_gem_object_unbind(struct drm_i915_gem_object *obj)
 	if (ret)
 		return ret;
 
-	while ((vma = list_first_entry_or_null(&obj->vma_list,
+	/*
+	 * Only a bound vma can be active, so once the last binding has been
+	 * released there is nothing left to do. For an object shared by
+	 * hundreds of address spaces, most of which are not currently using
+	 * it, this saves walking the long tail of idle, unbound vma.
+	 */
+	while (obj->bind_count &&
+	       (vma = list_first_entry_or_null(&obj->vma_list,
 					       struct i915_vma,
 					       obj_link))) {
 		list_move_tail(&vma->obj_link, &still_in_list);
@@ -512,6 +569,14 @@ i915_gem_object_wait_reservation(struct reservation_object *resv,
 	struct dma_fence *excl;
 	bool prune_fences = false;
 
+	/*
+	 * Without any shared fences, waiting on all fences is the same as
+	 * waiting on the exclusive fence, which we can grab without taking
+	 * a snapshot of the whole reservation object.
+	 */
+	if (flags & I915_WAIT_ALL && !reservation_object_has_shared_rcu(resv))
+		flags &= ~I915_WAIT_ALL;
+
 	if (flags & I915_WAIT_ALL) {
 		struct dma_fence **shared;
 		unsigned int count, i;
@@ -708,13 +773,242 @@ void i915_gem_object_free(struct drm_i915_gem_object *obj)
 	kmem_cache_free(dev_priv->objects, obj);
 }
 
+static void client_memory_release(struct kref *ref)
+{
+	kfree(container_of(ref, struct i915_gem_client_memory, ref));
+}
+
+static void client_memory_put(struct i915_gem_client_memory *memory)
+{
+	kref_put(&memory->ref, client_memory_release);
+}
+
+static void client_attach(struct drm_i915_gem_object *obj,
+			  struct drm_file *file,
+			  enum i915_gem_client_stat type)
+{
+	struct drm_i915_file_private *file_priv = file->driver_priv;
+
+	GEM_BUG_ON(obj->client.memory);
+	GEM_BUG_ON(obj->bind_count);
+
+	kref_get(&file_priv->memory->ref);
+	obj->client.memory = file_priv->memory;
+	obj->client.type = type;
+}
+
+/**
+ * i915_gem_object_set_client - charge a new object to its creator
+ * @obj: the freshly created object
+ * @file: the client creating the object
+ * @type: which backing store total, shmem or userptr, to charge
+ *
+ * The object keeps a reference to the client's totals so that they remain
+ * balanced for however long the object outlives the file.
+ */
+void i915_gem_object_set_client(struct drm_i915_gem_object *obj,
+				struct drm_file *file,
+				enum i915_gem_client_stat type)
+{
+	client_attach(obj, file, type);
+
+	i915_gem_object_client_account(obj, type, obj->base.size);
+	if (obj->mm.madv == I915_MADV_DONTNEED)
+		i915_gem_object_client_account(obj, I915_GEM_CLIENT_PURGEABLE,
+					       obj->base.size);
+}
+
+/**
+ * i915_gem_object_set_client_limited - charge a new object to its creator
+ * @obj: the freshly created object
+ * @file: the client creating the object
+ * @type: which backing store total to charge
+ * @limit: the most the client's total may reach, in bytes
+ *
+ * As i915_gem_object_set_client(), but refuses to take the client's total
+ * for @type above @limit. The check and the charge are a single atomic
+ * update so that concurrent creations cannot overshoot the limit.
+ *
+ * Return: 0 on success, -ENOSPC if the object would exceed the limit.
+ */
+int i915_gem_object_set_client_limited(struct drm_i915_gem_object *obj,
+				       struct drm_file *file,
+				       enum i915_gem_client_stat type,
+				       u64 limit)
+{
+	struct drm_i915_file_private *file_priv = file->driver_priv;
+	atomic64_t *stat = &file_priv->memory->stat[type];
+
+	GEM_BUG_ON(obj->mm.madv != I915_MADV_WILLNEED);
+
+	if (atomic64_add_return(obj->base.size, stat) > limit) {
+		atomic64_sub(obj->base.size, stat);
+		return -ENOSPC;
+	}
+
+	client_attach(obj, file, type);
+	return 0;
+}
+
+static void i915_gem_object_clear_client(struct drm_i915_gem_object *obj)
+{
+	struct i915_gem_client_memory *memory = obj->client.memory;
+
+	if (!memory)
+		return;
+
+	if (obj->mm.madv == I915_MADV_DONTNEED)
+		i915_gem_object_client_account(obj, I915_GEM_CLIENT_PURGEABLE,
+					       -obj->base.size);
+	i915_gem_object_client_account(obj, obj->client.type,
+				       -obj->base.size);
+
+	obj->client.memory = NULL;
+	client_memory_put(memory);
+}
+
+static void i915_gem_object_set_madv(struct drm_i915_gem_object *obj,
+				     unsigned int madv)
+{
+	if (madv == obj->mm.madv)
+		return;
+
+	/* Only pages that can still be discarded count as purgeable */
+	if (obj->mm.madv == I915_MADV_DONTNEED)
+		i915_gem_object_client_account(obj, I915_GEM_CLIENT_PURGEABLE,
+					       -obj->base.size);
+	else if (madv == I915_MADV_DONTNEED)
+		i915_gem_object_client_account(obj, I915_GEM_CLIENT_PURGEABLE,
+					       obj->base.size);
+
+	obj->mm.madv = madv;
+}
+
+void i915_gem_client_show_fdinfo(struct seq_file *m, struct drm_file *file)
+{
+	static const char * const names[] = {
+		[I915_GEM_CLIENT_SHMEM] = "shmem",
+		[I915_GEM_CLIENT_USERPTR] = "userptr",
+		[I915_GEM_CLIENT_PURGEABLE] = "purgeable",
+		[I915_GEM_CLIENT_GGTT] = "ggtt",
+		[I915_GEM_CLIENT_PPGTT] = "ppgtt",
+		[I915_GEM_CLIENT_HUGE_POOL] = "huge-pool",
+		[I915_GEM_CLIENT_STOLEN] = "stolen",
+	};
+	struct drm_i915_file_private *file_priv = file->driver_priv;
+	int i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(names) != I915_GEM_CLIENT_NUM_STATS);
+
+	for (i = 0; i < I915_GEM_CLIENT_NUM_STATS; i++)
+		seq_printf(m, "i915-memory-%s:\t%lld KiB\n", names[i],
+			   atomic64_read(&file_priv->memory->stat[i]) >> 10);
+}
+
+static struct list_head *
+recycle_bucket(struct drm_i915_file_private *file_priv, u64 size)
+{
+	int n;
+
+	/*
+	 * As for the batch pool, bucket by the order of the size in pages
+	 * and then search the bucket for an exact fit.
+	 */
+	n = fls(size >> PAGE_SHIFT) - 1;
+	if (n >= ARRAY_SIZE(file_priv->recycle.cache_list))
+		n = ARRAY_SIZE(file_priv->recycle.cache_list) - 1;
+
+	return &file_priv->recycle.cache_list[n];
+}
+
+static bool i915_gem_object_can_recycle(struct drm_i915_gem_object *obj,
+					struct drm_i915_file_private *file_priv)
+{
+	struct drm_i915_private *i915 = file_priv->dev_priv;
+	u64 limit = (u64)i915_modparams.recycle_cache_mb << 20;
+
+	/*
+	 * Only plain shmem objects created by this client, which it is
+	 * closing the last handle to and has not shared, so that nobody else
+	 * can observe the object being handed out again. And only those in
+	 * the state a new object is created in, bar their contents.
+	 */
+	if (obj->ops != &i915_gem_object_ops ||
+	    obj->client.memory != file_priv->memory)
+		return false;
+
+	if (obj->base.handle_count != 1 || obj->base.name || obj->base.dma_buf)
+		return false;
+
+	/* Nothing to reuse the objects for once the client is going away */
+	if (READ_ONCE(file_priv->recycle.closing))
+		return false;
+
+	if (obj->mm.madv == I915_MADV_WILLNEED ||
+	    !list_empty(&obj->recycle_link))
+		return false;
+
+	if (obj->pin_global || i915_gem_object_is_tiled(obj) ||
+	    obj->cache_level != (HAS_LLC(i915) ? I915_CACHE_LLC : I915_CACHE_NONE))
+		return false;
+
+	/*
+	 * A new object is idle, and the client must not be handed one that
+	 * the GPU is still reading or writing on behalf of its old self.
+	 */
+	if (!reservation_object_test_signaled_rcu(obj->resv, true))
+		return false;
+
+	return file_priv->recycle.size + obj->base.size <= limit;
+}
+
+static struct drm_i915_gem_object *
+i915_gem_object_recycle(struct drm_file *file, u64 size)
+{
+	struct drm_i915_file_private *file_priv = file->driver_priv;
+	struct drm_i915_private *i915 = file_priv->dev_priv;
+	struct drm_i915_gem_object *obj, *found = NULL;
+
+	if (mutex_lock_interruptible(&i915->drm.struct_mutex))
+		return NULL;
+
+	list_for_each_entry(obj, recycle_bucket(file_priv, size), recycle_link) {
+		if (obj->base.size == size) {
+			list_del_init(&obj->recycle_link);
+			file_priv->recycle.size -= size;
+			found = obj;
+			break;
+		}
+	}
+
+	mutex_unlock(&i915->drm.struct_mutex);
+	if (!found)
+		return NULL;
+
+	mutex_lock(&found->mm.lock);
+	if (found->mm.madv == __I915_MADV_PURGED) {
+		/*
+		 * The shrinker has already truncated the shmem file, which
+		 * repopulates with fresh pages on demand, so the object can be
+		 * revived just by forgetting that it was purged.
+		 */
+		GEM_BUG_ON(i915_gem_object_has_pages(found));
+		found->mm.pages = NULL;
+	}
+	i915_gem_object_set_madv(found, I915_MADV_WILLNEED);
+	mutex_unlock(&found->mm.lock);
+
+	return found;
+}
+
 static int
 i915_gem_create(struct drm_file *file,
 		struct drm_i915_private *dev_priv,
 		uint64_t size,
+		unsigned int flags,
 		uint32_t *handle_p)
 {
-	struct drm_i915_gem_object *obj;
+	struct drm_i915_gem_object *obj = NULL;
 	int ret;
 	u32 handle;
 
@@ -722,10 +1016,27 @@ i915_gem_create(struct drm_file *file,
 	if (size == 0)
 		return -EINVAL;
 
+	/* Reuse an object closed by this client, if allowed */
+	if (flags == I915_GEM_CREATE_RECYCLE)
+		obj = i915_gem_object_recycle(file, size);
+
 	/* Allocate the new object */
-	obj = i915_gem_object_create(dev_priv, size);
-	if (IS_ERR(obj))
-		return PTR_ERR(obj);
+	if (!obj) {
+		if (flags & I915_GEM_CREATE_HUGE_POOL)
+			obj = i915_gem_object_create_huge_pool(dev_priv, file,
+							       size);
+		else if (flags & I915_GEM_CREATE_STOLEN)
+			obj = i915_gem_object_create_stolen_user(dev_priv,
+								 file, size);
+		else
+			obj = i915_gem_object_create(dev_priv, size);
+		if (IS_ERR(obj))
+			return PTR_ERR(obj);
+
+		if (obj->base.filp)
+			i915_gem_object_set_client(obj, file,
+						   I915_GEM_CLIENT_SHMEM);
+	}
 
 	ret = drm_gem_handle_create(file, &obj->base, &handle);
 	/* drop reference from allocate - handle holds it now */
@@ -746,7 +1057,7 @@ i915_gem_dumb_create(struct drm_file *file,
 	args->pitch = ALIGN(args->width * DIV_ROUND_UP(args->bpp, 8), 64);
 	args->size = args->pitch * args->height;
 	return i915_gem_create(file, to_i915(dev),
-			       args->size, &args->handle);
+			       args->size, 0, &args->handle);
 }
 
 static bool gpu_write_needs_clflush(struct drm_i915_gem_object *obj)
@@ -768,10 +1079,76 @@ i915_gem_create_ioctl(struct drm_device *dev, void *data,
 	struct drm_i915_private *dev_priv = to_i915(dev);
 	struct drm_i915_gem_create *args = data;
 
+	/*
+	 * Reject creation flags we do not know. Older userspace passes the
+	 * struct without @flags, which drm_ioctl() zero-fills, so only new
+	 * callers can trip this. @pad is left unchecked: it never was, and
+	 * rejecting the garbage old callers may leave there would break them.
+	 */
+	if (args->flags & __I915_GEM_CREATE_UNKNOWN_FLAGS)
+		return -EINVAL;
+
 	i915_gem_flush_free_objects(dev_priv);
 
 	return i915_gem_create(file, dev_priv,
-			       args->size, &args->handle);
+			       args->size, args->flags, &args->handle);
+}
+
+/**
+ * Creates a batch of new mm objects of the same size and returns handles
+ * to them
+ * @dev: drm device pointer
+ * @data: ioctl data blob
+ * @file: drm file pointer
+ */
+int
+i915_gem_create_batch_ioctl(struct drm_device *dev, void *data,
+			    struct drm_file *file)
+{
+	struct drm_i915_private *dev_priv = to_i915(dev);
+	struct drm_i915_gem_create_batch *args = data;
+	u32 *handles;
+	unsigned int n;
+	int ret;
+
+	if (args->flags & __I915_GEM_CREATE_UNKNOWN_FLAGS)
+		return -EINVAL;
+
+	if (args->count == 0 || args->count > I915_GEM_CREATE_BATCH_MAX)
+		return -EINVAL;
+
+	if (!access_ok(VERIFY_WRITE, u64_to_user_ptr(args->handles_ptr),
+		       args->count * sizeof(u32)))
+		return -EFAULT;
+
+	handles = kvmalloc_array(args->count, sizeof(*handles), GFP_KERNEL);
+	if (!handles)
+		return -ENOMEM;
+
+	/* Reap the freed objects once for the batch, not for every object */
+	i915_gem_flush_free_objects(dev_priv);
+
+	for (n = 0; n < args->count; n++) {
+		ret = i915_gem_create(file, dev_priv,
+				      args->size, args->flags, &handles[n]);
+		if (ret)
+			goto err;
+	}
+
+	if (copy_to_user(u64_to_user_ptr(args->handles_ptr), handles,
+			 args->count * sizeof(*handles))) {
+		ret = -EFAULT;
+		goto err;
+	}
+
+	kvfree(handles);
+	return 0;
+
+err:
+	while (n--)
+		drm_gem_handle_delete(file, handles[n]);
+	kvfree(handles);
+	return ret;
 }
 
 static inline enum fb_op_origin
@@ -1148,6 +1525,31 @@ i915_gem_shmem_pread(struct drm_i915_gem_object *obj,
 	return ret;
 }
 
+static int
+i915_gem_tiled_pread(struct drm_i915_gem_object *obj,
+		     const struct drm_i915_gem_pread *args)
+{
+	unsigned int needs_clflush;
+	int ret;
+
+	ret = mutex_lock_interruptible(&obj->base.dev->struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = i915_gem_obj_prepare_shmem_read(obj, &needs_clflush);
+	mutex_unlock(&obj->base.dev->struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = i915_gem_object_copy_tiled(obj, args->offset, args->size,
+					 u64_to_user_ptr(args->data_ptr),
+					 false,
+					 needs_clflush ? CLFLUSH_BEFORE : 0);
+
+	i915_gem_obj_finish_shmem_access(obj);
+	return ret;
+}
+
 static inline bool
 gtt_user_read(struct io_mapping *mapping,
 	      loff_t base, int offset,
@@ -1172,21 +1574,94 @@ gtt_user_read(struct io_mapping *mapping,
 	return unwritten;
 }
 
+/*
+ * With non-temporal loads, we stream each page of WC into a bounce buffer
+ * and only then copy out to the user in chunks of this size.
+ */
+#define I915_PREAD_BOUNCE_SIZE SZ_64K
+
+struct pread_bounce {
+	void *buf;
+	unsigned int head; /* bytes to skip before the user's data */
+	unsigned int len; /* bytes of user data pending */
+};
+
+static bool pread_bounce_init(struct pread_bounce *b)
+{
+	b->head = 0;
+	b->len = 0;
+
+	if (!i915_has_memcpy_from_wc())
+		return false;
+
+	b->buf = kmalloc(I915_PREAD_BOUNCE_SIZE, GFP_KERNEL | __GFP_NOWARN);
+	return b->buf;
+}
+
+static int pread_bounce_flush(struct pread_bounce *b, void __user **user_data)
+{
+	if (!b->len)
+		return 0;
+
+	if (copy_to_user(*user_data, b->buf + b->head, b->len))
+		return -EFAULT;
+
+	*user_data += b->len;
+	b->head = 0;
+	b->len = 0;
+	return 0;
+}
+
+static int
+gtt_user_read_wc(struct io_mapping *mapping,
+		 loff_t base, unsigned int offset,
+		 struct pread_bounce *b, void __user **user_data,
+		 unsigned int length)
+{
+	/* Both ends of a page are suitably aligned for the streaming loads */
+	unsigned int start = round_down(offset, 16);
+	unsigned int end = round_up(offset + length, 16);
+	void __iomem *vaddr;
+	int err;
+
+	if (b->head + b->len + (end - start) > I915_PREAD_BOUNCE_SIZE) {
+		err = pread_bounce_flush(b, user_data);
+		if (err)
+			return err;
+	}
+
+	if (!b->len)
+		b->head = offset - start;
+
+	vaddr = io_mapping_map_atomic_wc(mapping, base);
+	i915_memcpy_from_wc(b->buf + b->head + b->len - (offset - start),
+			    (void __force *)vaddr + start,
+			    end - start);
+	io_mapping_unmap_atomic(vaddr);
+
+	b->len += length;
+	return 0;
+}
+
 static int
 i915_gem_gtt_pread(struct drm_i915_gem_object *obj,
 		   const struct drm_i915_gem_pread *args)
 {
 	struct drm_i915_private *i915 = to_i915(obj->base.dev);
 	struct i915_ggtt *ggtt = &i915->ggtt;
+	struct pread_bounce bounce;
 	struct drm_mm_node node;
 	struct i915_vma *vma;
 	void __user *user_data;
 	u64 remain, offset;
+	bool stream;
 	int ret;
 
+	stream = pread_bounce_init(&bounce);
+
 	ret = mutex_lock_interruptible(&i915->drm.struct_mutex);
 	if (ret)
-		return ret;
+		goto out_bounce;
 
 	intel_runtime_pm_get(i915);
 	vma = i915_gem_object_ggtt_pin(obj, NULL, 0, 0,
@@ -1240,16 +1715,26 @@ i915_gem_gtt_pread(struct drm_i915_gem_object *obj,
 			page_base += offset & PAGE_MASK;
 		}
 
-		if (gtt_user_read(&ggtt->iomap, page_base, page_offset,
-				  user_data, page_length)) {
-			ret = -EFAULT;
-			break;
+		if (stream) {
+			ret = gtt_user_read_wc(&ggtt->iomap, page_base,
+					       page_offset, &bounce,
+					       &user_data, page_length);
+			if (ret)
+				break;
+		} else {
+			if (gtt_user_read(&ggtt->iomap, page_base, page_offset,
+					  user_data, page_length)) {
+				ret = -EFAULT;
+				break;
+			}
+			user_data += page_length;
 		}
 
 		remain -= page_length;
-		user_data += page_length;
 		offset += page_length;
 	}
+	if (stream && !ret)
+		ret = pread_bounce_flush(&bounce, &user_data);
 
 	mutex_lock(&i915->drm.struct_mutex);
 out_unpin:
@@ -1263,6 +1748,9 @@ i915_gem_gtt_pread(struct drm_i915_gem_object *obj,
 out_unlock:
 	intel_runtime_pm_put(i915);
 	mutex_unlock(&i915->drm.struct_mutex);
+out_bounce:
+	if (stream)
+		kfree(bounce.buf);
 
 	return ret;
 }
@@ -1283,6 +1771,14 @@ i915_gem_pread_ioctl(struct drm_device *dev, void *data,
 	struct drm_i915_gem_object *obj;
 	int ret;
 
+	/*
+	 * @flags was appended in version 2 and is zero for older userspace,
+	 * so unknown read modes can be refused. The @pad after @handle has
+	 * always been ignored, and existing callers may not clear it.
+	 */
+	if (args->flags & __I915_PREAD_UNKNOWN_FLAGS)
+		return -EINVAL;
+
 	if (args->size == 0)
 		return 0;
 
@@ -1314,10 +1810,19 @@ i915_gem_pread_ioctl(struct drm_device *dev, void *data,
 	if (ret)
 		goto out;
 
-	ret = i915_gem_shmem_pread(obj, args);
+	if (args->flags & I915_PREAD_DETILE && i915_gem_object_is_tiled(obj)) {
+		ret = i915_gem_tiled_pread(obj, args);
+		goto out_unpin;
+	}
+
+	if (args->flags & I915_PREAD_WC_STREAM && i915_has_memcpy_from_wc())
+		ret = -ENODEV;
+	else
+		ret = i915_gem_shmem_pread(obj, args);
 	if (ret == -EFAULT || ret == -ENODEV)
 		ret = i915_gem_gtt_pread(obj, args);
 
+out_unpin:
 	i915_gem_object_unpin_pages(obj);
 out:
 	i915_gem_object_put(obj);
@@ -1598,6 +2103,105 @@ i915_gem_shmem_pwrite(struct drm_i915_gem_object *obj,
 	return ret;
 }
 
+/*
+ * Writing through a WC vmap of the whole object avoids the per-page
+ * clflushes of the shmem path and the per-page GGTT updates of the GTT
+ * path, but setting up the vmap is only worth it for larger writes.
+ */
+#define I915_PWRITE_WC_MIN SZ_256K
+
+static bool pwrite_use_wc(struct drm_i915_gem_object *obj,
+			  const struct drm_i915_gem_pwrite *args)
+{
+	enum i915_map_type type;
+
+	if (!i915_gem_object_has_struct_page(obj))
+		return false;
+
+	/* If we already have a WC vmap, reusing it is free */
+	if (page_unpack_bits(READ_ONCE(obj->mm.mapping), &type) &&
+	    type == I915_MAP_WC)
+		return true;
+
+	return args->size >= I915_PWRITE_WC_MIN;
+}
+
+static int
+i915_gem_wc_pwrite(struct drm_i915_gem_object *obj,
+		   const struct drm_i915_gem_pwrite *args)
+{
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	void *vaddr;
+	int ret;
+
+	ret = mutex_lock_interruptible(&i915->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = i915_gem_object_set_to_wc_domain(obj, true);
+	mutex_unlock(&i915->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	/* Fallback to the other paths if we cannot vmap the object */
+	vaddr = i915_gem_object_pin_map(obj, I915_MAP_WC);
+	if (IS_ERR(vaddr))
+		return -ENODEV;
+
+	intel_fb_obj_invalidate(obj, ORIGIN_CPU);
+
+	if (copy_from_user(vaddr + args->offset,
+			   u64_to_user_ptr(args->data_ptr),
+			   args->size))
+		ret = -EFAULT;
+
+	intel_fb_obj_flush(obj, ORIGIN_CPU);
+	i915_gem_object_unpin_map(obj);
+
+	return ret;
+}
+
+static int
+i915_gem_tiled_pwrite(struct drm_i915_gem_object *obj,
+		      const struct drm_i915_gem_pwrite *args)
+{
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	unsigned int needs_clflush;
+	int ret;
+
+	ret = mutex_lock_interruptible(&i915->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = i915_gem_obj_prepare_shmem_write(obj, &needs_clflush);
+	mutex_unlock(&i915->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = i915_gem_object_copy_tiled(obj, args->offset, args->size,
+					 u64_to_user_ptr(args->data_ptr),
+					 true, needs_clflush);
+
+	intel_fb_obj_flush(obj, ORIGIN_CPU);
+	i915_gem_obj_finish_shmem_access(obj);
+	return ret;
+}
+
+static void pwrite_account(struct drm_i915_private *i915,
+			   enum i915_pwrite_path path,
+			   const struct drm_i915_gem_pwrite *args,
+			   ktime_t start, int ret)
+{
+	struct i915_pwrite_stats *stats = &i915->mm.pwrite_stats[path];
+
+	if (ret)
+		return;
+
+	atomic64_inc(&stats->calls);
+	atomic64_add(args->size, &stats->bytes);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)), &stats->ns);
+}
+
 /**
  * Writes data to the object referenced by handle.
  * @dev: drm device
@@ -1612,8 +2216,18 @@ i915_gem_pwrite_ioctl(struct drm_device *dev, void *data,
 {
 	struct drm_i915_gem_pwrite *args = data;
 	struct drm_i915_gem_object *obj;
+	bool detile;
 	int ret;
 
+	/*
+	 * Only I915_PWRITE_DETILE is defined in @flags, refuse anything else
+	 * so that it can be given a meaning later. Unlike @flags, which old
+	 * binaries never pass and so reads as zero, @pad may carry junk from
+	 * them and must keep being ignored.
+	 */
+	if (args->flags & __I915_PWRITE_UNKNOWN_FLAGS)
+		return -EINVAL;
+
 	if (args->size == 0)
 		return 0;
 
@@ -1640,8 +2254,11 @@ i915_gem_pwrite_ioctl(struct drm_device *dev, void *data,
 
 	trace_i915_gem_object_pwrite(obj, args->offset, args->size);
 
+	detile = args->flags & I915_PWRITE_DETILE &&
+		 i915_gem_object_is_tiled(obj);
+
 	ret = -ENODEV;
-	if (obj->ops->pwrite)
+	if (obj->ops->pwrite && !detile)
 		ret = obj->ops->pwrite(obj, args);
 	if (ret != -ENODEV)
 		goto err;
@@ -1658,6 +2275,11 @@ i915_gem_pwrite_ioctl(struct drm_device *dev, void *data,
 	if (ret)
 		goto err;
 
+	if (detile) {
+		ret = i915_gem_tiled_pwrite(obj, args);
+		goto err_unpin;
+	}
+
 	ret = -EFAULT;
 	/* We can only do the GTT pwrite on untiled buffers, as otherwise
 	 * it would end up going through the fenced access, and we'll get
@@ -1666,22 +2288,43 @@ i915_gem_pwrite_ioctl(struct drm_device *dev, void *data,
 	 * perspective, requiring manual detiling by the client.
 	 */
 	if (!i915_gem_object_has_struct_page(obj) ||
-	    cpu_write_needs_clflush(obj))
+	    cpu_write_needs_clflush(obj)) {
+		ktime_t start;
+
+		if (pwrite_use_wc(obj, args)) {
+			start = ktime_get();
+			ret = i915_gem_wc_pwrite(obj, args);
+			pwrite_account(to_i915(dev), I915_PWRITE_WC,
+				       args, start, ret);
+		}
+
 		/* Note that the gtt paths might fail with non-page-backed user
 		 * pointers (e.g. gtt mappings when moving data between
 		 * textures). Fallback to the shmem path in that case.
 		 */
-		ret = i915_gem_gtt_pwrite_fast(obj, args);
+		if (ret == -EFAULT || ret == -ENODEV) {
+			start = ktime_get();
+			ret = i915_gem_gtt_pwrite_fast(obj, args);
+			pwrite_account(to_i915(dev), I915_PWRITE_GTT,
+				       args, start, ret);
+		}
+	}
 
 	if (ret == -EFAULT || ret == -ENOSPC) {
+		ktime_t start = ktime_get();
+
 		if (obj->phys_handle)
 			ret = i915_gem_phys_pwrite(obj, args, file);
 		else
 			ret = i915_gem_shmem_pwrite(obj, args);
+		pwrite_account(to_i915(dev), I915_PWRITE_SHMEM,
+			       args, start, ret);
 	}
 
+err_unpin:
 	i915_gem_object_unpin_pages(obj);
 err:
+	i915_gem_object_invalidate_cmd_cache(obj);
 	i915_gem_object_put(obj);
 	return ret;
 }
@@ -1701,7 +2344,8 @@ static void i915_gem_object_bump_inactive_ggtt(struct drm_i915_gem_object *obj)
 		if (!drm_mm_node_allocated(&vma->node))
 			continue;
 
-		list_move_tail(&vma->vm_link, &vma->vm->inactive_list);
+		vma->last_access = ++vma->vm->access_gen;
+		i915_vma_move_to_inactive(vma);
 	}
 
 	i915 = to_i915(obj->base.dev);
@@ -1861,6 +2505,7 @@ i915_gem_mmap_ioctl(struct drm_device *dev, void *data,
 	struct drm_i915_gem_mmap *args = data;
 	struct drm_i915_gem_object *obj;
 	unsigned long addr;
+	bool readonly;
 
 	if (args->flags & ~(I915_MMAP_WC))
 		return -EINVAL;
@@ -1880,10 +2525,18 @@ i915_gem_mmap_ioctl(struct drm_device *dev, void *data,
 		return -ENXIO;
 	}
 
+	/* Writes not allowed into this read-only object, see pwrite */
+	readonly = i915_gem_object_is_readonly(obj);
+
+	/*
+	 * Leave the placement to shmemfs, which aligns the mapping to
+	 * HPAGE_PMD_SIZE for objects on a huge gemfs (i915.gemfs_huge), so
+	 * that their huge pages can be mapped with a single PMD each.
+	 */
 	addr = vm_mmap(obj->base.filp, 0, args->size,
-		       PROT_READ | PROT_WRITE, MAP_SHARED,
-		       args->offset);
-	if (args->flags & I915_MMAP_WC) {
+		       readonly ? PROT_READ : PROT_READ | PROT_WRITE,
+		       MAP_SHARED, args->offset);
+	if (!IS_ERR_VALUE(addr) && (args->flags & I915_MMAP_WC || readonly)) {
 		struct mm_struct *mm = current->mm;
 		struct vm_area_struct *vma;
 
@@ -1892,13 +2545,19 @@ i915_gem_mmap_ioctl(struct drm_device *dev, void *data,
 			return -EINTR;
 		}
 		vma = find_vma(mm, addr);
-		if (vma)
-			vma->vm_page_prot =
-				pgprot_writecombine(vm_get_page_prot(vma->vm_flags));
-		else
+		if (vma) {
+			/* Nor may it be made writable later by mprotect() */
+			if (readonly)
+				vma->vm_flags &= ~VM_MAYWRITE;
+			if (args->flags & I915_MMAP_WC)
+				vma->vm_page_prot =
+					pgprot_writecombine(vm_get_page_prot(vma->vm_flags));
+		} else {
 			addr = -ENOMEM;
+		}
 		up_write(&mm->mmap_sem);
-
+	}
+	if (args->flags & I915_MMAP_WC) {
 		/* This may race, but that's ok, it only gets set */
 		WRITE_ONCE(obj->frontbuffer_ggtt_origin, ORIGIN_CPU);
 	}
@@ -1992,6 +2651,30 @@ compute_partial_view(const struct drm_i915_gem_object *obj,
 	return view;
 }
 
+/*
+ * When userspace walks linearly through an object too large to map at once,
+ * it faults at the first page after the window we last mapped. For such
+ * sequential access, we double the window each time (up to
+ * i915.mmap_fault_around_mb) to take fewer faults, and return to the
+ * minimum window for any other access pattern.
+ */
+static unsigned int
+fault_around_chunk(const struct drm_i915_gem_object *obj, pgoff_t page_offset)
+{
+	const unsigned int min = SZ_1M >> PAGE_SHIFT;
+	unsigned int max;
+
+	max = min_t(unsigned int, i915_modparams.mmap_fault_around_mb, SZ_1K);
+	max <<= 20 - PAGE_SHIFT;
+	if (max <= min)
+		return min;
+
+	if (!obj->fault_around.chunk || page_offset != obj->fault_around.next)
+		return min;
+
+	return min(obj->fault_around.chunk * 2, max);
+}
+
 /**
  * i915_gem_fault - fault a page into the GTT
  * @vmf: fault info
@@ -2019,7 +2702,10 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 	struct drm_i915_private *dev_priv = to_i915(dev);
 	struct i915_ggtt *ggtt = &dev_priv->ggtt;
 	bool write = !!(vmf->flags & FAULT_FLAG_WRITE);
+	ktime_t start = ktime_get();
+	unsigned long mapped = 0, size;
 	struct i915_vma *vma;
+	unsigned int seq;
 	pgoff_t page_offset;
 	int ret;
 
@@ -2068,8 +2754,9 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 				       PIN_NONFAULT);
 	if (IS_ERR(vma)) {
 		/* Use a partial view if it is bigger than available space */
+		unsigned int chunk = fault_around_chunk(obj, page_offset);
 		struct i915_ggtt_view view =
-			compute_partial_view(obj, page_offset, MIN_CHUNK_PAGES);
+			compute_partial_view(obj, page_offset, chunk);
 		unsigned int flags;
 
 		flags = PIN_MAPPABLE;
@@ -2088,6 +2775,18 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 			view.type = I915_GGTT_VIEW_PARTIAL;
 			vma = i915_gem_object_ggtt_pin(obj, &view, 0, 0, flags);
 		}
+		if (IS_ERR(vma) && chunk > MIN_CHUNK_PAGES) {
+			/* No room for the larger window, just map the minimum */
+			view = compute_partial_view(obj, page_offset,
+						    MIN_CHUNK_PAGES);
+			chunk = MIN_CHUNK_PAGES;
+			vma = i915_gem_object_ggtt_pin(obj, &view, 0, 0,
+						       PIN_MAPPABLE);
+		}
+
+		obj->fault_around.chunk = chunk;
+		obj->fault_around.next =
+			view.partial.offset + view.partial.size;
 	}
 	if (IS_ERR(vma)) {
 		ret = PTR_ERR(vma);
@@ -2102,24 +2801,45 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 	if (ret)
 		goto err_unpin;
 
-	/* Finally, remap it using the new GTT offset */
-	ret = remap_io_mapping(area,
-			       area->vm_start + (vma->ggtt_view.partial.offset << PAGE_SHIFT),
-			       (ggtt->gmadr.start + vma->node.start) >> PAGE_SHIFT,
-			       min_t(u64, vma->size, area->vm_end - area->vm_start),
-			       &ggtt->iomap);
-	if (ret)
-		goto err_fence;
-
 	/* Mark as being mmapped into userspace for later revocation */
 	assert_rpm_wakelock_held(dev_priv);
 	if (!i915_vma_set_userfault(vma) && !obj->userfault_count++)
 		list_add(&obj->userfault_link, &dev_priv->mm.userfault_list);
 	GEM_BUG_ON(!obj->userfault_count);
+	if (vma->fence)
+		vma->fence->last_fault = jiffies;
 
 	i915_vma_set_ggtt_write(vma);
 
-err_fence:
+	/*
+	 * Filling in the user's PTE is the bulk of the fault, and does not
+	 * need struct_mutex: our pins keep the vma bound and its fence in
+	 * place. However, a revocation may now race with us and miss the
+	 * PTE we are about to write, so record the revocation count and if
+	 * it has changed once we are done, revoke our own PTE.
+	 */
+	seq = READ_ONCE(obj->userfault_seq);
+	mutex_unlock(&dev->struct_mutex);
+
+	/* Finally, remap it using the new GTT offset */
+	size = min_t(u64, vma->size, area->vm_end - area->vm_start);
+	ret = remap_io_mapping(area,
+			       area->vm_start + (vma->ggtt_view.partial.offset << PAGE_SHIFT),
+			       (ggtt->gmadr.start + vma->node.start) >> PAGE_SHIFT,
+			       size,
+			       &ggtt->iomap);
+	if (ret == 0) {
+		smp_mb(); /* order the PTE writes before checking for revoke */
+		if (READ_ONCE(obj->userfault_seq) == seq)
+			mapped = size;
+		else
+			unmap_mapping_range(dev->anon_inode->i_mapping,
+					    drm_vma_node_offset_addr(&obj->base.vma_node) +
+					    (vma->ggtt_view.partial.offset << PAGE_SHIFT),
+					    vma->size, 1);
+	}
+
+	mutex_lock(&dev->struct_mutex);
 	i915_vma_unpin_fence(vma);
 err_unpin:
 	__i915_vma_unpin(vma);
@@ -2129,6 +2849,11 @@ vm_fault_t i915_gem_fault(struct vm_fault *vmf)
 	intel_runtime_pm_put(dev_priv);
 	i915_gem_object_unpin_pages(obj);
 err:
+	trace_i915_gem_object_fault_done(obj, page_offset,
+					 mapped >> PAGE_SHIFT,
+					 ktime_to_ns(ktime_sub(ktime_get(),
+							       start)),
+					 ret);
 	switch (ret) {
 	case -EIO:
 		/*
@@ -2172,6 +2897,10 @@ static void __i915_gem_object_release_mmap(struct drm_i915_gem_object *obj)
 
 	GEM_BUG_ON(!obj->userfault_count);
 
+	/* Tell any concurrent i915_gem_fault() to recheck its PTE */
+	WRITE_ONCE(obj->userfault_seq, obj->userfault_seq + 1);
+	smp_wmb();
+
 	obj->userfault_count = 0;
 	list_del(&obj->userfault_link);
 	drm_vma_node_unmap(&obj->base.vma_node,
@@ -2353,6 +3082,7 @@ static void
 i915_gem_object_truncate(struct drm_i915_gem_object *obj)
 {
 	i915_gem_object_free_mmap_offset(obj);
+	i915_gem_object_invalidate_cmd_cache(obj);
 
 	if (obj->base.filp == NULL)
 		return;
@@ -2363,7 +3093,7 @@ i915_gem_object_truncate(struct drm_i915_gem_object *obj)
 	 * backing pages, *now*.
 	 */
 	shmem_truncate_range(file_inode(obj->base.filp), 0, (loff_t)-1);
-	obj->mm.madv = __I915_MADV_PURGED;
+	i915_gem_object_set_madv(obj, __I915_MADV_PURGED);
 	obj->mm.pages = ERR_PTR(-EFAULT);
 }
 
@@ -2420,13 +3150,11 @@ i915_gem_object_put_pages_gtt(struct drm_i915_gem_object *obj,
 
 static void __i915_gem_object_reset_page_iter(struct drm_i915_gem_object *obj)
 {
-	struct radix_tree_iter iter;
-	void __rcu **slot;
+	struct i915_gem_object_page_iter *iter = &obj->mm.get_page;
 
-	rcu_read_lock();
-	radix_tree_for_each_slot(slot, &obj->mm.get_page.radix, &iter, 0)
-		radix_tree_delete(&obj->mm.get_page.radix, iter.index);
-	rcu_read_unlock();
+	kvfree(iter->ranges);
+	iter->ranges = NULL;
+	iter->count = 0;
 }
 
 static struct sg_table *
@@ -2441,6 +3169,10 @@ __i915_gem_object_unset_pages(struct drm_i915_gem_object *obj)
 
 	spin_lock(&i915->mm.obj_lock);
 	list_del(&obj->mm.link);
+	if (!list_empty(&obj->mm.vmap_link)) {
+		list_del_init(&obj->mm.vmap_link);
+		i915->mm.vmap_size -= obj->base.size;
+	}
 	spin_unlock(&i915->mm.obj_lock);
 
 	if (obj->mm.mapping) {
@@ -2530,6 +3262,10 @@ static int i915_gem_object_get_pages_gtt(struct drm_i915_gem_object *obj)
 	unsigned long last_pfn = 0;	/* suppress gcc warning */
 	unsigned int max_segment = i915_sg_segment_size();
 	unsigned int sg_page_sizes;
+	const int node = dev_to_node(&dev_priv->drm.pdev->dev);
+	unsigned long local;
+	nodemask_t nodes;
+	ktime_t start;
 	gfp_t noreclaim;
 	int ret;
 
@@ -2544,6 +3280,8 @@ static int i915_gem_object_get_pages_gtt(struct drm_i915_gem_object *obj)
 	if (st == NULL)
 		return -ENOMEM;
 
+	start = ktime_get();
+
 rebuild_st:
 	if (sg_alloc_table(st, page_count, GFP_KERNEL)) {
 		kfree(st);
@@ -2562,6 +3300,8 @@ static int i915_gem_object_get_pages_gtt(struct drm_i915_gem_object *obj)
 	sg = st->sgl;
 	st->nents = 0;
 	sg_page_sizes = 0;
+	local = 0;
+	nodes_clear(nodes);
 	for (i = 0; i < page_count; i++) {
 		const unsigned int shrink[] = {
 			I915_SHRINK_BOUND | I915_SHRINK_UNBOUND | I915_SHRINK_PURGEABLE,
@@ -2625,6 +3365,10 @@ static int i915_gem_object_get_pages_gtt(struct drm_i915_gem_object *obj)
 		}
 		last_pfn = page_to_pfn(page);
 
+		if (page_to_nid(page) == node)
+			local++;
+		node_set(page_to_nid(page), nodes);
+
 		/* Check that the i965g/gm workaround works. */
 		WARN_ON((gfp & __GFP_DMA32) && (last_pfn >= 0x00100000UL));
 	}
@@ -2662,6 +3406,10 @@ static int i915_gem_object_get_pages_gtt(struct drm_i915_gem_object *obj)
 
 	__i915_gem_object_set_pages(obj, st, sg_page_sizes);
 
+	trace_i915_gem_object_populate(obj, node, local, nodes_weight(nodes),
+				       ktime_to_ns(ktime_sub(ktime_get(),
+							     start)));
+
 	return 0;
 
 err_sg:
@@ -2696,10 +3444,11 @@ void __i915_gem_object_set_pages(struct drm_i915_gem_object *obj,
 
 	lockdep_assert_held(&obj->mm.lock);
 
-	obj->mm.get_page.sg_pos = pages->sgl;
-	obj->mm.get_page.sg_idx = 0;
+	/* Fresh pages must always be flushed once before the GPU sees them */
+	obj->cache_flushed = false;
 
 	obj->mm.pages = pages;
+	obj->mm.pages_gen++;
 
 	if (i915_gem_object_is_tiled(obj) &&
 	    i915->quirks & QUIRK_PIN_SWIZZLED_PAGES) {
@@ -2827,6 +3576,31 @@ static void *i915_gem_object_map(const struct drm_i915_gem_object *obj,
 	return addr;
 }
 
+static void vmap_cache_touch(struct drm_i915_gem_object *obj, void *ptr)
+{
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+
+	/* kmaps of a single page are cheap, only vmaps are worth keeping */
+	if (!is_vmalloc_addr(ptr) || obj->base.size > I915_VMAP_CACHE_SIZE)
+		return;
+
+	spin_lock(&i915->mm.obj_lock);
+	if (list_empty(&obj->mm.vmap_link))
+		i915->mm.vmap_size += obj->base.size;
+	list_move_tail(&obj->mm.vmap_link, &i915->mm.vmap_list);
+
+	/* Past the bound, the oldest mappings are fair game again */
+	while (i915->mm.vmap_size > I915_VMAP_CACHE_SIZE) {
+		struct drm_i915_gem_object *old;
+
+		old = list_first_entry(&i915->mm.vmap_list,
+				       typeof(*old), mm.vmap_link);
+		list_del_init(&old->mm.vmap_link);
+		i915->mm.vmap_size -= old->base.size;
+	}
+	spin_unlock(&i915->mm.obj_lock);
+}
+
 /* get, pin, and map the pages of the object into kernel space */
 void *i915_gem_object_pin_map(struct drm_i915_gem_object *obj,
 			      enum i915_map_type type)
@@ -2886,6 +3660,8 @@ void *i915_gem_object_pin_map(struct drm_i915_gem_object *obj,
 		obj->mm.mapping = page_pack_bits(ptr, type);
 	}
 
+	vmap_cache_touch(obj, ptr);
+
 out_unlock:
 	mutex_unlock(&obj->mm.lock);
 	return ptr;
@@ -3611,6 +4387,9 @@ i915_gem_idle_work_handler(struct work_struct *work)
 	if (new_requests_since_last_retire(dev_priv))
 		goto out_unlock;
 
+	/* Idle for a while now, give back the contexts kept pinned */
+	i915_gem_contexts_unpin_cached(dev_priv);
+
 	epoch = __i915_gem_park(dev_priv);
 
 	assert_kernel_context_is_current(dev_priv);
@@ -3662,6 +4441,7 @@ void i915_gem_close_object(struct drm_gem_object *gem, struct drm_file *file)
 
 		vma = radix_tree_delete(&ctx->handles_vma, lut->handle);
 		GEM_BUG_ON(vma->obj != obj);
+		ctx->handles_gen++; /* invalidate any resident sets */
 
 		/* We allow the process to have multiple handles to the same
 		 * vma, in the same fd namespace, by virtue of flink/open.
@@ -3677,6 +4457,18 @@ void i915_gem_close_object(struct drm_gem_object *gem, struct drm_file *file)
 		__i915_gem_object_release_unless_active(obj);
 	}
 
+	/*
+	 * Keep the last handle to a purgeable object around, for the client
+	 * to reuse with I915_GEM_CREATE_RECYCLE along with whatever pages and
+	 * bindings it still has. The shrinker may still purge it meanwhile.
+	 */
+	if (i915_gem_object_can_recycle(obj, fpriv)) {
+		list_add_tail(&obj->recycle_link,
+			      recycle_bucket(fpriv, obj->base.size));
+		fpriv->recycle.size += obj->base.size;
+		i915_gem_object_get(obj);
+	}
+
 	mutex_unlock(&i915->drm.struct_mutex);
 }
 
@@ -3691,6 +4483,32 @@ static unsigned long to_wait_timeout(s64 timeout_ns)
 	return nsecs_to_jiffies_timeout(timeout_ns);
 }
 
+static long
+update_wait_timeout(s64 *timeout_ns, ktime_t start, long ret)
+{
+	if (*timeout_ns > 0) {
+		*timeout_ns -= ktime_to_ns(ktime_sub(ktime_get(), start));
+		if (*timeout_ns < 0)
+			*timeout_ns = 0;
+
+		/*
+		 * Apparently ktime isn't accurate enough and occasionally has a
+		 * bit of mismatch in the jiffies<->nsecs<->ktime loop. So patch
+		 * things up to make the test happy. We allow up to 1 jiffy.
+		 *
+		 * This is a regression from the timespec->ktime conversion.
+		 */
+		if (ret == -ETIME && !nsecs_to_jiffies(*timeout_ns))
+			*timeout_ns = 0;
+
+		/* Asked to wait beyond the jiffie/scheduler precision? */
+		if (ret == -ETIME && *timeout_ns)
+			ret = -EAGAIN;
+	}
+
+	return ret;
+}
+
 /**
  * i915_gem_wait_ioctl - implements DRM_IOCTL_I915_GEM_WAIT
  * @dev: drm device pointer
@@ -3723,41 +4541,177 @@ i915_gem_wait_ioctl(struct drm_device *dev, void *data, struct drm_file *file)
 	ktime_t start;
 	long ret;
 
-	if (args->flags != 0)
+	if (args->flags != 0)
+		return -EINVAL;
+
+	obj = i915_gem_object_lookup(file, args->bo_handle);
+	if (!obj)
+		return -ENOENT;
+
+	start = ktime_get();
+
+	ret = i915_gem_object_wait(obj,
+				   I915_WAIT_INTERRUPTIBLE | I915_WAIT_ALL,
+				   to_wait_timeout(args->timeout_ns),
+				   to_rps_client(file));
+	ret = update_wait_timeout(&args->timeout_ns, start, ret);
+
+	i915_gem_object_put(obj);
+	return ret;
+}
+
+static struct dma_fence *
+i915_gem_object_pending_fence(struct drm_i915_gem_object *obj)
+{
+	struct dma_fence *excl, **shared, *fence = NULL;
+	unsigned int count, i;
+	int ret;
+
+	ret = reservation_object_get_fences_rcu(obj->resv,
+						&excl, &count, &shared);
+	if (ret)
+		return ERR_PTR(ret);
+
+	for (i = 0; i < count; i++) {
+		if (!fence && !dma_fence_is_signaled(shared[i]))
+			fence = dma_fence_get(shared[i]);
+		dma_fence_put(shared[i]);
+	}
+	kfree(shared);
+
+	if (!fence && excl && !dma_fence_is_signaled(excl))
+		fence = dma_fence_get(excl);
+	dma_fence_put(excl);
+
+	return fence;
+}
+
+static long
+wait_multi_any(struct drm_i915_gem_object **objects, unsigned int count,
+	       long timeout, struct intel_rps_client *rps_client, u32 *idx)
+{
+	struct dma_fence **fences;
+	unsigned int n;
+
+	fences = kvmalloc_array(count, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		return -ENOMEM;
+
+	/*
+	 * An object is only idle once all of its fences are signaled, so we
+	 * wait upon one outstanding fence from each object and, as each one
+	 * signals, look again at its object until we find one that is idle.
+	 * The wait itself is on the fence callbacks, i.e. our breadcrumb
+	 * interrupts, rather than a thread or a poll per object.
+	 */
+	do {
+		for (n = 0; n < count; n++) {
+			struct dma_fence *fence;
+
+			fence = i915_gem_object_pending_fence(objects[n]);
+			if (IS_ERR_OR_NULL(fence)) {
+				if (IS_ERR(fence))
+					timeout = PTR_ERR(fence);
+				*idx = n;
+				goto out;
+			}
+
+			fences[n] = fence;
+
+			/* As for i915_gem_object_wait_fence() */
+			if (rps_client && dma_fence_is_i915(fence) &&
+			    !i915_request_started(to_request(fence)) &&
+			    INTEL_GEN(to_request(fence)->i915) >= 6)
+				gen6_rps_boost(to_request(fence), rps_client);
+		}
+
+		timeout = dma_fence_wait_any_timeout(fences, count, true,
+						     timeout, idx);
+		while (n--)
+			dma_fence_put(fences[n]);
+	} while (timeout > 0);
+
+	if (!timeout)
+		timeout = -ETIME;
+	n = 0;
+out:
+	while (n--)
+		dma_fence_put(fences[n]);
+	kvfree(fences);
+	return timeout;
+}
+
+/**
+ * i915_gem_wait_multi_ioctl - implements DRM_IOCTL_I915_GEM_WAIT_MULTI
+ * @dev: drm device pointer
+ * @data: ioctl data blob
+ * @file: drm file pointer
+ *
+ * Waits for all of the objects, or with I915_GEM_WAIT_MULTI_ANY for any one
+ * of them, to become idle. Returns as for i915_gem_wait_ioctl().
+ */
+int
+i915_gem_wait_multi_ioctl(struct drm_device *dev, void *data,
+			  struct drm_file *file)
+{
+	struct drm_i915_gem_wait_multi *args = data;
+	struct drm_i915_gem_object **objects;
+	u32 __user *user_handles;
+	unsigned int n;
+	ktime_t start;
+	long timeout;
+	int ret;
+
+	if (args->flags & ~I915_GEM_WAIT_MULTI_ANY || args->pad)
 		return -EINVAL;
 
-	obj = i915_gem_object_lookup(file, args->bo_handle);
-	if (!obj)
-		return -ENOENT;
+	if (args->count == 0 || args->count > I915_GEM_WAIT_MULTI_MAX)
+		return -EINVAL;
 
-	start = ktime_get();
+	objects = kvmalloc_array(args->count, sizeof(*objects), GFP_KERNEL);
+	if (!objects)
+		return -ENOMEM;
 
-	ret = i915_gem_object_wait(obj,
-				   I915_WAIT_INTERRUPTIBLE | I915_WAIT_ALL,
-				   to_wait_timeout(args->timeout_ns),
-				   to_rps_client(file));
+	user_handles = u64_to_user_ptr(args->handles_ptr);
+	for (n = 0; n < args->count; n++) {
+		u32 handle;
 
-	if (args->timeout_ns > 0) {
-		args->timeout_ns -= ktime_to_ns(ktime_sub(ktime_get(), start));
-		if (args->timeout_ns < 0)
-			args->timeout_ns = 0;
+		if (get_user(handle, &user_handles[n])) {
+			ret = -EFAULT;
+			goto out;
+		}
 
-		/*
-		 * Apparently ktime isn't accurate enough and occasionally has a
-		 * bit of mismatch in the jiffies<->nsecs<->ktime loop. So patch
-		 * things up to make the test happy. We allow up to 1 jiffy.
-		 *
-		 * This is a regression from the timespec->ktime conversion.
-		 */
-		if (ret == -ETIME && !nsecs_to_jiffies(args->timeout_ns))
-			args->timeout_ns = 0;
+		objects[n] = i915_gem_object_lookup(file, handle);
+		if (!objects[n]) {
+			ret = -ENOENT;
+			goto out;
+		}
+	}
 
-		/* Asked to wait beyond the jiffie/scheduler precision? */
-		if (ret == -ETIME && args->timeout_ns)
-			ret = -EAGAIN;
+	start = ktime_get();
+
+	timeout = to_wait_timeout(args->timeout_ns);
+	if (args->flags & I915_GEM_WAIT_MULTI_ANY) {
+		timeout = wait_multi_any(objects, n, timeout,
+					 to_rps_client(file), &args->first_idle);
+	} else {
+		unsigned int i;
+
+		for (i = 0; i < n && timeout >= 0; i++)
+			timeout = i915_gem_object_wait_reservation(objects[i]->resv,
+								   I915_WAIT_INTERRUPTIBLE |
+								   I915_WAIT_ALL,
+								   timeout,
+								   to_rps_client(file));
 	}
+	ret = timeout < 0 ? timeout : 0;
 
-	i915_gem_object_put(obj);
+	ret = update_wait_timeout(&args->timeout_ns, start, ret);
+
+out:
+	while (n--)
+		i915_gem_object_put(objects[n]);
+	kvfree(objects);
 	return ret;
 }
 
@@ -3892,6 +4846,9 @@ i915_gem_object_set_to_wc_domain(struct drm_i915_gem_object *obj, bool write)
 	if (ret)
 		return ret;
 
+	if (write)
+		i915_gem_object_invalidate_cmd_cache(obj);
+
 	if (obj->write_domain == I915_GEM_DOMAIN_WC)
 		return 0;
 
@@ -3955,6 +4912,9 @@ i915_gem_object_set_to_gtt_domain(struct drm_i915_gem_object *obj, bool write)
 	if (ret)
 		return ret;
 
+	if (write)
+		i915_gem_object_invalidate_cmd_cache(obj);
+
 	if (obj->write_domain == I915_GEM_DOMAIN_GTT)
 		return 0;
 
@@ -4337,6 +5297,9 @@ i915_gem_object_set_to_cpu_domain(struct drm_i915_gem_object *obj, bool write)
 	if (ret)
 		return ret;
 
+	if (write)
+		i915_gem_object_invalidate_cmd_cache(obj);
+
 	flush_write_domain(obj, ~I915_GEM_DOMAIN_CPU);
 
 	/* Flush the CPU cache if it's still invalid. */
@@ -4485,6 +5448,10 @@ i915_gem_object_ggtt_pin(struct drm_i915_gem_object *obj,
 	if (ret)
 		return ERR_PTR(ret);
 
+	/* Our users access the pages directly, not from a request */
+	if (unlikely(vma->bind_fence))
+		i915_ggtt_wait_bind(vma);
+
 	return vma;
 }
 
@@ -4553,21 +5520,10 @@ busy_check_writer(const struct dma_fence *fence)
 	return __busy_set_if_active(fence, __busy_write_id);
 }
 
-int
-i915_gem_busy_ioctl(struct drm_device *dev, void *data,
-		    struct drm_file *file)
+static unsigned int __i915_gem_object_busy(struct drm_i915_gem_object *obj)
 {
-	struct drm_i915_gem_busy *args = data;
-	struct drm_i915_gem_object *obj;
 	struct reservation_object_list *list;
-	unsigned int seq;
-	int err;
-
-	err = -ENOENT;
-	rcu_read_lock();
-	obj = i915_gem_object_lookup_rcu(file, args->handle);
-	if (!obj)
-		goto out;
+	unsigned int seq, busy;
 
 	/* A discrepancy here is that we do not report the status of
 	 * non-i915 fences, i.e. even though we may report the object as idle,
@@ -4589,7 +5545,7 @@ i915_gem_busy_ioctl(struct drm_device *dev, void *data,
 	seq = raw_read_seqcount(&obj->resv->seq);
 
 	/* Translate the exclusive fence to the READ *and* WRITE engine */
-	args->busy = busy_check_writer(rcu_dereference(obj->resv->fence_excl));
+	busy = busy_check_writer(rcu_dereference(obj->resv->fence_excl));
 
 	/* Translate shared fences to READ set of engines */
 	list = rcu_dereference(obj->resv->fence);
@@ -4600,19 +5556,120 @@ i915_gem_busy_ioctl(struct drm_device *dev, void *data,
 			struct dma_fence *fence =
 				rcu_dereference(list->shared[i]);
 
-			args->busy |= busy_check_reader(fence);
+			busy |= busy_check_reader(fence);
 		}
 	}
 
-	if (args->busy && read_seqcount_retry(&obj->resv->seq, seq))
+	if (busy && read_seqcount_retry(&obj->resv->seq, seq))
 		goto retry;
 
+	return busy;
+}
+
+int
+i915_gem_busy_ioctl(struct drm_device *dev, void *data,
+		    struct drm_file *file)
+{
+	struct drm_i915_gem_busy *args = data;
+	struct drm_i915_gem_object *obj;
+	int err;
+
+	err = -ENOENT;
+	rcu_read_lock();
+	obj = i915_gem_object_lookup_rcu(file, args->handle);
+	if (!obj)
+		goto out;
+
+	args->busy = __i915_gem_object_busy(obj);
 	err = 0;
 out:
 	rcu_read_unlock();
 	return err;
 }
 
+/**
+ * Reports the busyness of an array of objects, or finds the idle ones
+ * @dev: drm device pointer
+ * @data: ioctl data blob
+ * @file: drm file pointer
+ */
+int
+i915_gem_busy_batch_ioctl(struct drm_device *dev, void *data,
+			  struct drm_file *file)
+{
+	struct drm_i915_gem_busy_batch *args = data;
+	unsigned int n, max_idle, idle;
+	u32 *handles;
+	int err;
+
+	if (args->flags & ~I915_GEM_BUSY_BATCH_IDLE || args->pad)
+		return -EINVAL;
+
+	if (args->count == 0 || args->count > I915_GEM_BUSY_BATCH_MAX)
+		return -EINVAL;
+
+	max_idle = 0;
+	if (args->flags & I915_GEM_BUSY_BATCH_IDLE)
+		max_idle = min(args->idle_count ?: args->count, args->count);
+	else if (args->idle_count)
+		return -EINVAL;
+
+	handles = kvmalloc_array(args->count, sizeof(*handles), GFP_KERNEL);
+	if (!handles)
+		return -ENOMEM;
+
+	if (copy_from_user(handles, u64_to_user_ptr(args->handles_ptr),
+			   args->count * sizeof(*handles))) {
+		err = -EFAULT;
+		goto out;
+	}
+
+	/*
+	 * The results are written back over the handles, which is safe as
+	 * we never write ahead of the handle being looked up: either each
+	 * busy value replaces its own handle, or the idle handles are
+	 * compacted towards the front of the array.
+	 */
+	err = 0;
+	idle = 0;
+	rcu_read_lock();
+	for (n = 0; n < args->count; n++) {
+		struct drm_i915_gem_object *obj;
+		unsigned int busy;
+
+		obj = i915_gem_object_lookup_rcu(file, handles[n]);
+		if (!obj) {
+			err = -ENOENT;
+			break;
+		}
+
+		busy = __i915_gem_object_busy(obj);
+		if (!max_idle) {
+			handles[n] = busy;
+		} else if (!busy) {
+			handles[idle++] = handles[n];
+			if (idle == max_idle)
+				break;
+		}
+	}
+	rcu_read_unlock();
+	if (err)
+		goto out;
+
+	if (max_idle) {
+		args->idle_count = idle;
+		n = idle;
+	}
+
+	if (copy_to_user(u64_to_user_ptr(args->busy_ptr), handles,
+			 n * sizeof(*handles)))
+		err = -EFAULT;
+
+out:
+	kvfree(handles);
+	return err;
+}
+
 int
 i915_gem_throttle_ioctl(struct drm_device *dev, void *data,
 			struct drm_file *file_priv)
@@ -4661,7 +5718,7 @@ i915_gem_madvise_ioctl(struct drm_device *dev, void *data,
 	}
 
 	if (obj->mm.madv != __I915_MADV_PURGED)
-		obj->mm.madv = args->madv;
+		i915_gem_object_set_madv(obj, args->madv);
 
 	/* if the object is no longer attached, discard its backing storage */
 	if (obj->mm.madv == I915_MADV_DONTNEED &&
@@ -4693,6 +5750,8 @@ void i915_gem_object_init(struct drm_i915_gem_object *obj,
 	INIT_LIST_HEAD(&obj->vma_list);
 	INIT_LIST_HEAD(&obj->lut_list);
 	INIT_LIST_HEAD(&obj->batch_pool_link);
+	INIT_LIST_HEAD(&obj->recycle_link);
+	INIT_LIST_HEAD(&obj->mm.vmap_link);
 
 	obj->ops = ops;
 
@@ -4703,7 +5762,8 @@ void i915_gem_object_init(struct drm_i915_gem_object *obj,
 	init_request_active(&obj->frontbuffer_write, frontbuffer_retire);
 
 	obj->mm.madv = I915_MADV_WILLNEED;
-	INIT_RADIX_TREE(&obj->mm.get_page.radix, GFP_KERNEL | __GFP_NOWARN);
+	obj->mm.get_page.ranges = NULL;
+	obj->mm.get_page.count = 0;
 	mutex_init(&obj->mm.get_page.lock);
 
 	i915_gem_info_add_obj(to_i915(obj->base.dev), obj->base.size);
@@ -4738,6 +5798,15 @@ static int i915_gem_object_create_shmem(struct drm_device *dev,
 	if (IS_ERR(filp))
 		return PTR_ERR(filp);
 
+	/*
+	 * Prefer allocating the backing store on the device's NUMA node.
+	 * This is only a hint to shmemfs, the pages are still allocated
+	 * (and accounted) by whichever client first faults them in.
+	 */
+	if (dev_to_node(&dev->pdev->dev) != NUMA_NO_NODE)
+		mpol_shared_policy_set_preferred(&SHMEM_I(file_inode(filp))->policy,
+						 dev_to_node(&dev->pdev->dev));
+
 	obj->filp = filp;
 
 	return 0;
@@ -4842,67 +5911,91 @@ static bool discard_backing_storage(struct drm_i915_gem_object *obj)
 static void __i915_gem_free_objects(struct drm_i915_private *i915,
 				    struct llist_node *freed)
 {
-	struct drm_i915_gem_object *obj, *on;
-
 	intel_runtime_pm_get(i915);
-	llist_for_each_entry_safe(obj, on, freed, freed) {
-		struct i915_vma *vma, *vn;
-
-		trace_i915_gem_object_destroy(obj);
+	while (freed) {
+		struct llist_node *node, *next;
+		unsigned int n;
 
-		mutex_lock(&i915->drm.struct_mutex);
-
-		GEM_BUG_ON(i915_gem_object_is_active(obj));
-		list_for_each_entry_safe(vma, vn,
-					 &obj->vma_list, obj_link) {
-			GEM_BUG_ON(i915_vma_is_active(vma));
-			vma->flags &= ~I915_VMA_PIN_MASK;
-			i915_vma_destroy(vma);
-		}
-		GEM_BUG_ON(!list_empty(&obj->vma_list));
-		GEM_BUG_ON(!RB_EMPTY_ROOT(&obj->vma_tree));
-
-		/* This serializes freeing with the shrinker. Since the free
-		 * is delayed, first by RCU then by the workqueue, we want the
-		 * shrinker to be able to free pages of unreferenced objects,
-		 * or else we may oom whilst there are plenty of deferred
-		 * freed objects.
+		/*
+		 * Unbind a chunk of objects at a time under a single
+		 * acquisition of struct_mutex, but drop the lock between
+		 * chunks so that we do not hold up everyone else behind
+		 * a long list of freed objects.
 		 */
-		if (i915_gem_object_has_pages(obj)) {
-			spin_lock(&i915->mm.obj_lock);
-			list_del_init(&obj->mm.link);
-			spin_unlock(&i915->mm.obj_lock);
+		mutex_lock(&i915->drm.struct_mutex);
+		for (node = freed, n = 0;
+		     node && n < I915_GEM_FREE_BATCH;
+		     node = node->next, n++) {
+			struct drm_i915_gem_object *obj =
+				llist_entry(node, typeof(*obj), freed);
+			struct i915_vma *vma, *vn;
+
+			trace_i915_gem_object_destroy(obj);
+
+			GEM_BUG_ON(i915_gem_object_is_active(obj));
+			list_for_each_entry_safe(vma, vn,
+						 &obj->vma_list, obj_link) {
+				GEM_BUG_ON(i915_vma_is_active(vma));
+				vma->flags &= ~I915_VMA_PIN_MASK;
+				i915_vma_destroy(vma);
+			}
+			GEM_BUG_ON(!list_empty(&obj->vma_list));
+			GEM_BUG_ON(!RB_EMPTY_ROOT(&obj->vma_tree));
+			GEM_BUG_ON(obj->vma_ppgtt_count);
+			kfree(obj->vma_hash);
+
+			/*
+			 * This serializes freeing with the shrinker. Since
+			 * the free is delayed, first by RCU then by the
+			 * workqueue, we want the shrinker to be able to free
+			 * pages of unreferenced objects, or else we may oom
+			 * whilst there are plenty of deferred freed objects.
+			 */
+			if (i915_gem_object_has_pages(obj)) {
+				spin_lock(&i915->mm.obj_lock);
+				list_del_init(&obj->mm.link);
+				spin_unlock(&i915->mm.obj_lock);
+			}
 		}
-
 		mutex_unlock(&i915->drm.struct_mutex);
 
-		GEM_BUG_ON(obj->bind_count);
-		GEM_BUG_ON(obj->userfault_count);
-		GEM_BUG_ON(atomic_read(&obj->frontbuffer_bits));
-		GEM_BUG_ON(!list_empty(&obj->lut_list));
+		for (next = freed; next != node; ) {
+			struct drm_i915_gem_object *obj =
+				llist_entry(next, typeof(*obj), freed);
+
+			next = next->next;
+
+			GEM_BUG_ON(obj->bind_count);
+			GEM_BUG_ON(obj->userfault_count);
+			GEM_BUG_ON(atomic_read(&obj->frontbuffer_bits));
+			GEM_BUG_ON(!list_empty(&obj->lut_list));
+
+			if (obj->ops->release)
+				obj->ops->release(obj);
 
-		if (obj->ops->release)
-			obj->ops->release(obj);
+			if (WARN_ON(i915_gem_object_has_pinned_pages(obj)))
+				atomic_set(&obj->mm.pages_pin_count, 0);
+			__i915_gem_object_put_pages(obj, I915_MM_NORMAL);
+			GEM_BUG_ON(i915_gem_object_has_pages(obj));
 
-		if (WARN_ON(i915_gem_object_has_pinned_pages(obj)))
-			atomic_set(&obj->mm.pages_pin_count, 0);
-		__i915_gem_object_put_pages(obj, I915_MM_NORMAL);
-		GEM_BUG_ON(i915_gem_object_has_pages(obj));
+			i915_gem_object_clear_client(obj);
 
-		if (obj->base.import_attach)
-			drm_prime_gem_destroy(&obj->base, NULL);
+			if (obj->base.import_attach)
+				drm_prime_gem_destroy(&obj->base, NULL);
 
-		reservation_object_fini(&obj->__builtin_resv);
-		drm_gem_object_release(&obj->base);
-		i915_gem_info_remove_obj(i915, obj->base.size);
+			reservation_object_fini(&obj->__builtin_resv);
+			drm_gem_object_release(&obj->base);
+			i915_gem_info_remove_obj(i915, obj->base.size);
 
-		kfree(obj->bit_17);
-		i915_gem_object_free(obj);
+			kfree(obj->bit_17);
+			i915_gem_object_free(obj);
 
-		GEM_BUG_ON(!atomic_read(&i915->mm.free_count));
-		atomic_dec(&i915->mm.free_count);
+			GEM_BUG_ON(!atomic_read(&i915->mm.free_count));
+			atomic_dec(&i915->mm.free_count);
+		}
 
-		if (on)
+		freed = node;
+		if (freed)
 			cond_resched();
 	}
 	intel_runtime_pm_put(i915);
@@ -4910,27 +6003,36 @@ static void __i915_gem_free_objects(struct drm_i915_private *i915,
 
 static void i915_gem_flush_free_objects(struct drm_i915_private *i915)
 {
+	struct llist_head *list = raw_cpu_ptr(i915->mm.free_lists);
 	struct llist_node *freed;
 
-	/* Free the oldest, most stale object to keep the free_list short */
+	/*
+	 * Free the oldest, most stale object to keep the free_list short.
+	 * If the worker has fallen behind, push back upon the client by
+	 * making it free the whole of its local list itself.
+	 */
 	freed = NULL;
-	if (!llist_empty(&i915->mm.free_list)) { /* quick test for hotpath */
+	if (!llist_empty(list)) { /* quick test for hotpath */
 		/* Only one consumer of llist_del_first() allowed */
 		spin_lock(&i915->mm.free_lock);
-		freed = llist_del_first(&i915->mm.free_list);
+		if (atomic_read(&i915->mm.free_count) > I915_GEM_FREE_BACKLOG) {
+			freed = llist_del_all(list);
+		} else {
+			freed = llist_del_first(list);
+			if (freed)
+				freed->next = NULL;
+		}
 		spin_unlock(&i915->mm.free_lock);
 	}
-	if (unlikely(freed)) {
-		freed->next = NULL;
+	if (unlikely(freed))
 		__i915_gem_free_objects(i915, freed);
-	}
 }
 
 static void __i915_gem_free_work(struct work_struct *work)
 {
 	struct drm_i915_private *i915 =
 		container_of(work, struct drm_i915_private, mm.free_work);
-	struct llist_node *freed;
+	int cpu;
 
 	/*
 	 * All file-owned VMA should have been released by this point through
@@ -4941,17 +6043,25 @@ static void __i915_gem_free_work(struct work_struct *work)
 	 * unbound now.
 	 */
 
-	spin_lock(&i915->mm.free_lock);
-	while ((freed = llist_del_all(&i915->mm.free_list))) {
-		spin_unlock(&i915->mm.free_lock);
-
-		__i915_gem_free_objects(i915, freed);
-		if (need_resched())
-			return;
+	for_each_possible_cpu(cpu) {
+		struct llist_head *list = per_cpu_ptr(i915->mm.free_lists, cpu);
+		struct llist_node *freed;
 
 		spin_lock(&i915->mm.free_lock);
+		while ((freed = llist_del_all(list))) {
+			spin_unlock(&i915->mm.free_lock);
+
+			__i915_gem_free_objects(i915, freed);
+			if (need_resched()) {
+				/* Come back later for the remainder */
+				queue_work(i915->wq, &i915->mm.free_work);
+				return;
+			}
+
+			spin_lock(&i915->mm.free_lock);
+		}
+		spin_unlock(&i915->mm.free_lock);
 	}
-	spin_unlock(&i915->mm.free_lock);
 }
 
 static void __i915_gem_free_object_rcu(struct rcu_head *head)
@@ -4969,8 +6079,12 @@ static void __i915_gem_free_object_rcu(struct rcu_head *head)
 	 * directly onto the work queue so that we can mix between using the
 	 * worker and performing frees directly from subsequent allocations for
 	 * crude but effective memory throttling.
+	 *
+	 * The lists are per-cpu only to avoid bouncing a single cacheline
+	 * between all the cpus freeing objects; the llist itself is safe
+	 * against concurrent producers should we be migrated.
 	 */
-	if (llist_add(&obj->freed, &i915->mm.free_list))
+	if (llist_add(&obj->freed, raw_cpu_ptr(i915->mm.free_lists)))
 		queue_work(i915->wq, &i915->mm.free_work);
 }
 
@@ -4978,11 +6092,13 @@ void i915_gem_free_object(struct drm_gem_object *gem_obj)
 {
 	struct drm_i915_gem_object *obj = to_intel_bo(gem_obj);
 
+	__i915_gem_object_invalidate_cmd_cache(obj);
+
 	if (obj->mm.quirked)
 		__i915_gem_object_unpin_pages(obj);
 
 	if (discard_backing_storage(obj))
-		obj->mm.madv = I915_MADV_DONTNEED;
+		i915_gem_object_set_madv(obj, I915_MADV_DONTNEED);
 
 	/*
 	 * Before we free the object, make sure any pure RCU-only
@@ -5046,8 +6162,56 @@ void i915_gem_sanitize(struct drm_i915_private *i915)
 	mutex_unlock(&i915->drm.struct_mutex);
 }
 
+/*
+ * Once the GPU is idle and userspace frozen, start writing back the CPU
+ * caches of all objects in the CPU write domain. The clflushes are batched
+ * into a single fence and spread across the unbound workers, running
+ * alongside the rest of the suspend sequence; i915_gem_suspend_late() then
+ * merely waits for them as it moves each object into the GTT domain.
+ */
+static void i915_gem_suspend_writeback(struct drm_i915_private *i915)
+{
+	struct list_head *phases[] = {
+		&i915->mm.unbound_list,
+		&i915->mm.bound_list,
+		NULL
+	}, **phase;
+	struct drm_i915_gem_object *obj;
+	struct i915_clflush_batch batch;
+	unsigned int count = 0;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+#define needs_writeback(obj) \
+	((obj)->write_domain == I915_GEM_DOMAIN_CPU && \
+	 (obj)->cache_dirty && \
+	 i915_gem_object_has_pages(obj))
+
+	for (phase = phases; *phase; phase++) {
+		list_for_each_entry(obj, *phase, mm.link)
+			count += needs_writeback(obj);
+	}
+	if (!count)
+		return;
+
+	i915_gem_clflush_batch_init(&batch, count);
+	for (phase = phases; *phase; phase++) {
+		list_for_each_entry(obj, *phase, mm.link) {
+			if (!needs_writeback(obj))
+				continue;
+
+			i915_gem_clflush_batch_add(&batch, obj, 0);
+			obj->write_domain = 0;
+		}
+	}
+	i915_gem_clflush_batch_commit(&batch);
+
+#undef needs_writeback
+}
+
 int i915_gem_suspend(struct drm_i915_private *i915)
 {
+	ktime_t t;
 	int ret;
 
 	GEM_TRACE("\n");
@@ -5057,6 +6221,8 @@ int i915_gem_suspend(struct drm_i915_private *i915)
 
 	mutex_lock(&i915->drm.struct_mutex);
 
+	t = ktime_get();
+
 	/*
 	 * We have to flush all the executing contexts to main memory so
 	 * that they can saved in the hibernation image. To ensure the last
@@ -5083,10 +6249,20 @@ int i915_gem_suspend(struct drm_i915_private *i915)
 	}
 	i915_retire_requests(i915); /* ensure we flush after wedging */
 
+	i915->gt.suspend_time.idle = ktime_sub(ktime_get(), t);
+	t = ktime_get();
+
+	i915_gem_suspend_writeback(i915);
+
+	i915->gt.suspend_time.writeback = ktime_sub(ktime_get(), t);
+
 	mutex_unlock(&i915->drm.struct_mutex);
 
+	t = ktime_get();
 	intel_uc_suspend(i915);
+	i915->gt.suspend_time.uc = ktime_sub(ktime_get(), t);
 
+	t = ktime_get();
 	cancel_delayed_work_sync(&i915->gpu_error.hangcheck_work);
 	cancel_delayed_work_sync(&i915->gt.retire_work);
 
@@ -5095,6 +6271,7 @@ int i915_gem_suspend(struct drm_i915_private *i915)
 	 * repeat the flush until it is definitely idle.
 	 */
 	drain_delayed_work(&i915->gt.idle_work);
+	i915->gt.suspend_time.workers = ktime_sub(ktime_get(), t);
 
 	/*
 	 * Assert that we successfully flushed all the work and
@@ -5121,6 +6298,7 @@ void i915_gem_suspend_late(struct drm_i915_private *i915)
 		&i915->mm.bound_list,
 		NULL
 	}, **phase;
+	ktime_t t;
 
 	/*
 	 * Neither the BIOS, ourselves or any other kernel
@@ -5142,15 +6320,19 @@ void i915_gem_suspend_late(struct drm_i915_private *i915)
 	 * machine in an unusable condition.
 	 */
 
+	t = ktime_get();
 	mutex_lock(&i915->drm.struct_mutex);
 	for (phase = phases; *phase; phase++) {
 		list_for_each_entry(obj, *phase, mm.link)
 			WARN_ON(i915_gem_object_set_to_gtt_domain(obj, false));
 	}
 	mutex_unlock(&i915->drm.struct_mutex);
+	i915->gt.suspend_time.domains = ktime_sub(ktime_get(), t);
 
+	t = ktime_get();
 	intel_uc_sanitize(i915);
 	i915_gem_sanitize(i915);
+	i915->gt.suspend_time.sanitize = ktime_sub(ktime_get(), t);
 }
 
 void i915_gem_resume(struct drm_i915_private *i915)
@@ -5359,6 +6541,12 @@ static int __intel_engines_record_defaults(struct drm_i915_private *i915)
 	 * over to a second context to save that default register state. We
 	 * can then prime every new context with that state so they all start
 	 * from the same default HW values.
+	 *
+	 * This is also the only time engine->init_context() is run: the
+	 * context workarounds (and MOCS, golden render state) it emits are
+	 * saved into the default image along with everything else, so that
+	 * new contexts inherit them without paying for the LRI on their
+	 * first request.
 	 */
 
 	ctx = i915_gem_context_create_kernel(i915, 0);
@@ -5694,20 +6882,40 @@ i915_gem_load_init_fences(struct drm_i915_private *dev_priv)
 	i915_gem_detect_bit_6_swizzle(dev_priv);
 }
 
-static void i915_gem_init__mm(struct drm_i915_private *i915)
+static int i915_gem_init__mm(struct drm_i915_private *i915)
 {
+	int cpu;
+
+	i915->mm.free_lists = alloc_percpu(struct llist_head);
+	if (!i915->mm.free_lists)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		init_llist_head(per_cpu_ptr(i915->mm.free_lists, cpu));
+
 	spin_lock_init(&i915->mm.object_stat_lock);
 	spin_lock_init(&i915->mm.obj_lock);
 	spin_lock_init(&i915->mm.free_lock);
 
-	init_llist_head(&i915->mm.free_list);
-
 	INIT_LIST_HEAD(&i915->mm.unbound_list);
 	INIT_LIST_HEAD(&i915->mm.bound_list);
 	INIT_LIST_HEAD(&i915->mm.fence_list);
 	INIT_LIST_HEAD(&i915->mm.userfault_list);
+	INIT_LIST_HEAD(&i915->mm.vmap_list);
 
 	INIT_WORK(&i915->mm.free_work, __i915_gem_free_work);
+
+	return 0;
+}
+
+static void i915_gem_fini__mm(struct drm_i915_private *i915)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		GEM_BUG_ON(!llist_empty(per_cpu_ptr(i915->mm.free_lists, cpu)));
+
+	free_percpu(i915->mm.free_lists);
 }
 
 int i915_gem_init_early(struct drm_i915_private *dev_priv)
@@ -5743,11 +6951,16 @@ int i915_gem_init_early(struct drm_i915_private *dev_priv)
 	if (!dev_priv->priorities)
 		goto err_dependencies;
 
+	i915_request_caches_init(dev_priv);
+
 	INIT_LIST_HEAD(&dev_priv->gt.timelines);
+	INIT_LIST_HEAD(&dev_priv->gt.hwsp_free_list);
 	INIT_LIST_HEAD(&dev_priv->gt.active_rings);
 	INIT_LIST_HEAD(&dev_priv->gt.closed_vma);
 
-	i915_gem_init__mm(dev_priv);
+	err = i915_gem_init__mm(dev_priv);
+	if (err)
+		goto err_priorities;
 
 	INIT_DELAYED_WORK(&dev_priv->gt.retire_work,
 			  i915_gem_retire_work_handler);
@@ -5764,8 +6977,12 @@ int i915_gem_init_early(struct drm_i915_private *dev_priv)
 	if (err)
 		DRM_NOTE("Unable to create a private tmpfs mount, hugepage support will be disabled(%d).\n", err);
 
+	i915_gem_huge_pool_init(dev_priv);
+
 	return 0;
 
+err_priorities:
+	kmem_cache_destroy(dev_priv->priorities);
 err_dependencies:
 	kmem_cache_destroy(dev_priv->dependencies);
 err_requests:
@@ -5783,10 +7000,13 @@ int i915_gem_init_early(struct drm_i915_private *dev_priv)
 void i915_gem_cleanup_early(struct drm_i915_private *dev_priv)
 {
 	i915_gem_drain_freed_objects(dev_priv);
-	GEM_BUG_ON(!llist_empty(&dev_priv->mm.free_list));
 	GEM_BUG_ON(atomic_read(&dev_priv->mm.free_count));
+	i915_gem_fini__mm(dev_priv);
 	WARN_ON(dev_priv->mm.object_count);
 	WARN_ON(!list_empty(&dev_priv->gt.timelines));
+	WARN_ON(!list_empty(&dev_priv->gt.hwsp_free_list));
+
+	i915_request_caches_drain(dev_priv);
 
 	kmem_cache_destroy(dev_priv->priorities);
 	kmem_cache_destroy(dev_priv->dependencies);
@@ -5798,6 +7018,7 @@ void i915_gem_cleanup_early(struct drm_i915_private *dev_priv)
 	/* And ensure that our DESTROY_BY_RCU slabs are truly destroyed */
 	rcu_barrier();
 
+	i915_gem_huge_pool_fini(dev_priv);
 	i915_gemfs_fini(dev_priv);
 }
 
@@ -5852,6 +7073,21 @@ void i915_gem_release(struct drm_device *dev, struct drm_file *file)
 {
 	struct drm_i915_file_private *file_priv = file->driver_priv;
 	struct i915_request *request;
+	int n;
+
+	lockdep_assert_held(&dev->struct_mutex);
+
+	for (n = 0; n < ARRAY_SIZE(file_priv->recycle.cache_list); n++) {
+		struct drm_i915_gem_object *obj, *on;
+
+		list_for_each_entry_safe(obj, on,
+					 &file_priv->recycle.cache_list[n],
+					 recycle_link) {
+			list_del_init(&obj->recycle_link);
+			i915_gem_object_put(obj);
+		}
+	}
+	file_priv->recycle.size = 0;
 
 	/* Clean up our request list when the client is going away, so that
 	 * later retire_requests won't dereference our soon-to-be-gone
@@ -5861,12 +7097,14 @@ void i915_gem_release(struct drm_device *dev, struct drm_file *file)
 	list_for_each_entry(request, &file_priv->mm.request_list, client_link)
 		request->file_priv = NULL;
 	spin_unlock(&file_priv->mm.lock);
+
+	client_memory_put(file_priv->memory);
 }
 
 int i915_gem_open(struct drm_i915_private *i915, struct drm_file *file)
 {
 	struct drm_i915_file_private *file_priv;
-	int ret;
+	int ret, n;
 
 	DRM_DEBUG("\n");
 
@@ -5874,6 +7112,13 @@ int i915_gem_open(struct drm_i915_private *i915, struct drm_file *file)
 	if (!file_priv)
 		return -ENOMEM;
 
+	file_priv->memory = kzalloc(sizeof(*file_priv->memory), GFP_KERNEL);
+	if (!file_priv->memory) {
+		kfree(file_priv);
+		return -ENOMEM;
+	}
+	kref_init(&file_priv->memory->ref);
+
 	file->driver_priv = file_priv;
 	file_priv->dev_priv = i915;
 	file_priv->file = file;
@@ -5881,12 +7126,18 @@ int i915_gem_open(struct drm_i915_private *i915, struct drm_file *file)
 	spin_lock_init(&file_priv->mm.lock);
 	INIT_LIST_HEAD(&file_priv->mm.request_list);
 
+	for (n = 0; n < ARRAY_SIZE(file_priv->recycle.cache_list); n++)
+		INIT_LIST_HEAD(&file_priv->recycle.cache_list[n]);
+
 	file_priv->bsd_engine = -1;
 	file_priv->hang_timestamp = jiffies;
+	file_priv->rps_client.next_boost = jiffies;
 
 	ret = i915_gem_context_open(i915, file);
-	if (ret)
+	if (ret) {
+		client_memory_put(file_priv->memory);
 		kfree(file_priv);
+	}
 
 	return ret;
 }
@@ -5975,120 +7226,98 @@ i915_gem_object_create_from_data(struct drm_i915_private *dev_priv,
 	return ERR_PTR(err);
 }
 
-struct scatterlist *
-i915_gem_object_get_sg(struct drm_i915_gem_object *obj,
-		       unsigned int n,
-		       unsigned int *offset)
+static const struct i915_gem_object_page_range *
+__i915_gem_object_build_ranges(struct drm_i915_gem_object *obj)
 {
 	struct i915_gem_object_page_iter *iter = &obj->mm.get_page;
+	struct i915_gem_object_page_range *ranges;
+	struct sg_table *pages = obj->mm.pages;
 	struct scatterlist *sg;
-	unsigned int idx, count;
-
-	might_sleep();
-	GEM_BUG_ON(n >= obj->base.size >> PAGE_SHIFT);
-	GEM_BUG_ON(!i915_gem_object_has_pinned_pages(obj));
-
-	/* As we iterate forward through the sg, we record each entry in a
-	 * radixtree for quick repeated (backwards) lookups. If we have seen
-	 * this index previously, we will have an entry for it.
-	 *
-	 * Initial lookup is O(N), but this is amortized to O(1) for
-	 * sequential page access (where each new request is consecutive
-	 * to the previous one). Repeated lookups are O(lg(obj->base.size)),
-	 * i.e. O(1) with a large constant!
-	 */
-	if (n < READ_ONCE(iter->sg_idx))
-		goto lookup;
+	unsigned int idx, count, i;
 
 	mutex_lock(&iter->lock);
 
-	/* We prefer to reuse the last sg so that repeated lookup of this
-	 * (or the subsequent) sg are fast - comparing against the last
-	 * sg is faster than going through the radixtree.
-	 */
-
-	sg = iter->sg_pos;
-	idx = iter->sg_idx;
-	count = __sg_page_count(sg);
+	ranges = iter->ranges;
+	if (ranges) /* built by another thread */
+		goto unlock;
 
-	while (idx + count <= n) {
-		unsigned long exception, i;
-		int ret;
+	ranges = kvmalloc_array(pages->nents, sizeof(*ranges),
+				GFP_KERNEL | __GFP_NOWARN);
+	if (!ranges)
+		goto unlock;
 
-		/* If we cannot allocate and insert this entry, or the
-		 * individual pages from this range, cancel updating the
-		 * sg_idx so that on this lookup we are forced to linearly
-		 * scan onwards, but on future lookups we will try the
-		 * insertion again (in which case we need to be careful of
-		 * the error return reporting that we have already inserted
-		 * this index).
-		 */
-		ret = radix_tree_insert(&iter->radix, idx, sg);
-		if (ret && ret != -EEXIST)
-			goto scan;
-
-		exception =
-			RADIX_TREE_EXCEPTIONAL_ENTRY |
-			idx << RADIX_TREE_EXCEPTIONAL_SHIFT;
-		for (i = 1; i < count; i++) {
-			ret = radix_tree_insert(&iter->radix, idx + i,
-						(void *)exception);
-			if (ret && ret != -EEXIST)
-				goto scan;
-		}
+	idx = 0;
+	count = 0;
+	for_each_sg(pages->sgl, sg, pages->nents, i) {
+		if (!__sg_page_count(sg))
+			continue;
 
-		idx += count;
-		sg = ____sg_next(sg);
-		count = __sg_page_count(sg);
+		ranges[count].sg = sg;
+		ranges[count].idx = idx;
+		idx += __sg_page_count(sg);
+		count++;
 	}
 
-scan:
-	iter->sg_pos = sg;
-	iter->sg_idx = idx;
+	iter->count = count;
+	smp_store_release(&iter->ranges, ranges);
 
+unlock:
 	mutex_unlock(&iter->lock);
+	return ranges;
+}
 
-	if (unlikely(n < idx)) /* insertion completed by another thread */
-		goto lookup;
-
-	/* In case we failed to insert the entry into the radixtree, we need
-	 * to look beyond the current sg.
-	 */
-	while (idx + count <= n) {
-		idx += count;
-		sg = ____sg_next(sg);
-		count = __sg_page_count(sg);
-	}
-
-	*offset = n - idx;
-	return sg;
-
-lookup:
-	rcu_read_lock();
+struct scatterlist *
+i915_gem_object_get_sg(struct drm_i915_gem_object *obj,
+		       unsigned int n,
+		       unsigned int *offset)
+{
+	struct i915_gem_object_page_iter *iter = &obj->mm.get_page;
+	const struct i915_gem_object_page_range *ranges;
+	struct scatterlist *sg;
+	unsigned int lo, hi, idx;
 
-	sg = radix_tree_lookup(&iter->radix, n);
-	GEM_BUG_ON(!sg);
+	might_sleep();
+	GEM_BUG_ON(n >= obj->base.size >> PAGE_SHIFT);
+	GEM_BUG_ON(!i915_gem_object_has_pinned_pages(obj));
 
-	/* If this index is in the middle of multi-page sg entry,
-	 * the radixtree will contain an exceptional entry that points
-	 * to the start of that range. We will return the pointer to
-	 * the base page and the offset of this page within the
-	 * sg entry's range.
+	/*
+	 * On first use we walk the sg_table once, recording the page index at
+	 * which each entry starts, to then binary search that for every
+	 * lookup. This costs just one range per entry, however many pages
+	 * each entry spans, and is stable for as long as the pages are
+	 * pinned.
 	 */
-	*offset = 0;
-	if (unlikely(radix_tree_exception(sg))) {
-		unsigned long base =
-			(unsigned long)sg >> RADIX_TREE_EXCEPTIONAL_SHIFT;
-
-		sg = radix_tree_lookup(&iter->radix, base);
-		GEM_BUG_ON(!sg);
+	ranges = smp_load_acquire(&iter->ranges);
+	if (unlikely(!ranges))
+		ranges = __i915_gem_object_build_ranges(obj);
+	if (unlikely(!ranges)) {
+		/* Without memory for the index, walk the sg_table instead */
+		sg = obj->mm.pages->sgl;
+		idx = 0;
+		while (idx + __sg_page_count(sg) <= n) {
+			idx += __sg_page_count(sg);
+			sg = ____sg_next(sg);
+		}
 
-		*offset = n - base;
+		*offset = n - idx;
+		return sg;
 	}
 
-	rcu_read_unlock();
+	lo = 0;
+	hi = iter->count;
+	GEM_BUG_ON(!hi);
+	while (hi - lo > 1) {
+		unsigned int mid = lo + (hi - lo) / 2;
+
+		if (ranges[mid].idx <= n)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	GEM_BUG_ON(n - ranges[lo].idx >= __sg_page_count(ranges[lo].sg));
 
-	return sg;
+	*offset = n - ranges[lo].idx;
+	return ranges[lo].sg;
 }
 
 struct page *
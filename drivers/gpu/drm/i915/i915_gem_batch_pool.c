@@ -35,6 +35,10 @@ void i915_gem_batch_pool_init(struct i915_gem_batch_pool *pool,
 
 	for (n = 0; n < ARRAY_SIZE(pool->cache_list); n++)
 		INIT_LIST_HEAD(&pool->cache_list[n]);
+
+	pool->size = 0;
+	pool->count = 0;
+	memset(&pool->stats, 0, sizeof(pool->stats));
 }
 
 /**
@@ -59,6 +63,101 @@ void i915_gem_batch_pool_fini(struct i915_gem_batch_pool *pool)
 
 		INIT_LIST_HEAD(&pool->cache_list[n]);
 	}
+
+	pool->size = 0;
+	pool->count = 0;
+}
+
+/**
+ * i915_gem_batch_pool_trim() - release idle buffers from the pool
+ * @pool: the batch buffer pool
+ * @target: the number of bytes the pool may retain
+ *
+ * Frees the least recently used idle buffers, starting from the largest
+ * size class, until the pool holds no more than @target bytes. Buffers
+ * still in use by the GPU are kept.
+ *
+ * Note: Callers must hold the struct_mutex.
+ */
+void i915_gem_batch_pool_trim(struct i915_gem_batch_pool *pool, u64 target)
+{
+	int n;
+
+	lockdep_assert_held(&pool->engine->i915->drm.struct_mutex);
+
+	for (n = ARRAY_SIZE(pool->cache_list); n-- && pool->size > target; ) {
+		struct drm_i915_gem_object *obj, *next;
+
+		list_for_each_entry_safe(obj, next,
+					 &pool->cache_list[n],
+					 batch_pool_link) {
+			/* The batches are strictly LRU ordered */
+			if (i915_gem_object_is_active(obj))
+				break;
+
+			list_del_init(&obj->batch_pool_link);
+			pool->size -= obj->base.size;
+			pool->count--;
+			pool->stats.trimmed++;
+
+			i915_gem_object_put(obj);
+
+			if (pool->size <= target)
+				break;
+		}
+	}
+}
+
+static bool batch_pool_obj_idle(struct i915_gem_batch_pool *pool,
+				struct drm_i915_gem_object *obj)
+{
+	struct reservation_object *resv = obj->resv;
+
+	if (!i915_gem_object_is_active(obj))
+		return true;
+
+	if (!reservation_object_test_signaled_rcu(resv, true))
+		return false;
+
+	i915_retire_requests(pool->engine->i915);
+	GEM_BUG_ON(i915_gem_object_is_active(obj));
+
+	/*
+	 * The object is now idle, clear the array of shared
+	 * fences before we add a new request. Although, we
+	 * remain on the same engine, we may be on a different
+	 * timeline and so may continually grow the array,
+	 * trapping a reference to all the old fences, rather
+	 * than replace the existing fence.
+	 */
+	if (rcu_access_pointer(resv->fence)) {
+		reservation_object_lock(resv, NULL);
+		reservation_object_add_excl_fence(resv, NULL);
+		reservation_object_unlock(resv);
+	}
+
+	return true;
+}
+
+/**
+ * i915_gem_batch_pool_detach() - take a buffer out of the pool
+ * @pool: the batch buffer pool
+ * @obj: a buffer returned by i915_gem_batch_pool_get() from @pool
+ *
+ * Removes @obj from @pool so that it is never handed out again, transferring
+ * the pool's reference to the caller.
+ *
+ * Note: Callers must hold the struct_mutex
+ */
+void i915_gem_batch_pool_detach(struct i915_gem_batch_pool *pool,
+				struct drm_i915_gem_object *obj)
+{
+	lockdep_assert_held(&pool->engine->i915->drm.struct_mutex);
+	GEM_BUG_ON(list_empty(&obj->batch_pool_link));
+
+	list_del_init(&obj->batch_pool_link);
+	pool->size -= obj->base.size;
+	pool->count--;
 }
 
 /**
@@ -84,57 +183,57 @@ i915_gem_batch_pool_get(struct i915_gem_batch_pool *pool,
 
 	lockdep_assert_held(&pool->engine->i915->drm.struct_mutex);
 
-	/* Compute a power-of-two bucket, but throw everything greater than
-	 * 16KiB into the same bucket: i.e. the the buckets hold objects of
-	 * (1 page, 2 pages, 4 pages, 8+ pages).
+	/*
+	 * Compute a power-of-two bucket and round the request up to fill it,
+	 * so that every buffer in a bucket is large enough for any request
+	 * that maps onto it and we only ever need to inspect the oldest
+	 * (least recently used) buffer. Only the final catch-all bucket of
+	 * oversized batches needs a search.
 	 */
-	n = fls(size >> PAGE_SHIFT) - 1;
-	if (n >= ARRAY_SIZE(pool->cache_list))
-		n = ARRAY_SIZE(pool->cache_list) - 1;
-	list = &pool->cache_list[n];
-
-	list_for_each_entry(obj, list, batch_pool_link) {
-		/* The batches are strictly LRU ordered */
-		if (i915_gem_object_is_active(obj)) {
-			struct reservation_object *resv = obj->resv;
+	n = fls((size - 1) >> PAGE_SHIFT);
+	if (n < ARRAY_SIZE(pool->cache_list) - 1) {
+		list = &pool->cache_list[n];
+		size = PAGE_SIZE << n;
+
+		obj = list_first_entry_or_null(list, typeof(*obj),
+					       batch_pool_link);
+		if (obj && batch_pool_obj_idle(pool, obj))
+			goto found;
+	} else {
+		list = &pool->cache_list[ARRAY_SIZE(pool->cache_list) - 1];
+		size = round_up(size, PAGE_SIZE);
 
-			if (!reservation_object_test_signaled_rcu(resv, true))
+		list_for_each_entry(obj, list, batch_pool_link) {
+			if (!batch_pool_obj_idle(pool, obj))
 				break;
 
-			i915_retire_requests(pool->engine->i915);
-			GEM_BUG_ON(i915_gem_object_is_active(obj));
-
-			/*
-			 * The object is now idle, clear the array of shared
-			 * fences before we add a new request. Although, we
-			 * remain on the same engine, we may be on a different
-			 * timeline and so may continually grow the array,
-			 * trapping a reference to all the old fences, rather
-			 * than replace the existing fence.
-			 */
-			if (rcu_access_pointer(resv->fence)) {
-				reservation_object_lock(resv, NULL);
-				reservation_object_add_excl_fence(resv, NULL);
-				reservation_object_unlock(resv);
-			}
+			if (obj->base.size >= size)
+				goto found;
 		}
-
-		GEM_BUG_ON(!reservation_object_test_signaled_rcu(obj->resv,
-								 true));
-
-		if (obj->base.size >= size)
-			goto found;
 	}
 
+	if (size < I915_BATCH_POOL_MAX &&
+	    pool->size + size > I915_BATCH_POOL_MAX)
+		i915_gem_batch_pool_trim(pool, I915_BATCH_POOL_MAX - size);
+
 	obj = i915_gem_object_create_internal(pool->engine->i915, size);
 	if (IS_ERR(obj))
 		return obj;
 
+	pool->size += obj->base.size;
+	pool->count++;
+	pool->stats.miss++;
+	goto add;
+
 found:
+	pool->stats.hit++;
+add:
+	GEM_BUG_ON(!reservation_object_test_signaled_rcu(obj->resv, true));
+	list_move_tail(&obj->batch_pool_link, list);
+
 	ret = i915_gem_object_pin_pages(obj);
 	if (ret)
 		return ERR_PTR(ret);
 
-	list_move_tail(&obj->batch_pool_link, list);
 	return obj;
 }
@@ -11,15 +11,37 @@
 
 struct intel_engine_cs;
 
+/*
+ * Buckets hold objects of exactly 1, 2, 4, ... pages, with everything larger
+ * than the penultimate size class thrown into the final bucket.
+ */
+#define I915_BATCH_POOL_BUCKETS 9
+
+/* Idle buffers kept across parking, and the most we hold at any time */
+#define I915_BATCH_POOL_HIGHWATER SZ_4M
+#define I915_BATCH_POOL_MAX SZ_64M
+
 struct i915_gem_batch_pool {
 	struct intel_engine_cs *engine;
-	struct list_head cache_list[4];
+	struct list_head cache_list[I915_BATCH_POOL_BUCKETS];
+
+	u64 size; /* total bytes of the objects held in the pool */
+	unsigned long count;
+
+	struct {
+		unsigned long hit;
+		unsigned long miss;
+		unsigned long trimmed;
+	} stats;
 };
 
 void i915_gem_batch_pool_init(struct i915_gem_batch_pool *pool,
 			      struct intel_engine_cs *engine);
 void i915_gem_batch_pool_fini(struct i915_gem_batch_pool *pool);
+void i915_gem_batch_pool_trim(struct i915_gem_batch_pool *pool, u64 target);
 struct drm_i915_gem_object*
 i915_gem_batch_pool_get(struct i915_gem_batch_pool *pool, size_t size);
+void i915_gem_batch_pool_detach(struct i915_gem_batch_pool *pool,
+				struct drm_i915_gem_object *obj);
 
 #endif /* I915_GEM_BATCH_POOL_H */
@@ -28,13 +28,41 @@
 
 static DEFINE_SPINLOCK(clflush_lock);
 
+/*
+ * Above this much dirty memory in a single batch, we fan the flushes out
+ * across the unbound workers rather than walk every object from one cpu.
+ */
+#define I915_CLFLUSH_PARALLEL_MIN SZ_4M
+
+/*
+ * Should we fail to allocate a single fence covering the whole batch, we
+ * split the batch into fences of at most this many objects instead.
+ */
+#define I915_CLFLUSH_CHUNK 64
+
+struct clflush_obj {
+	struct work_struct work;
+	struct drm_i915_gem_object *obj;
+};
+
 struct clflush {
 	struct dma_fence dma; /* Must be first for dma_fence_free() */
 	struct i915_sw_fence wait;
 	struct work_struct work;
-	struct drm_i915_gem_object *obj;
+	struct drm_i915_private *i915;
+	u64 size;
+	unsigned int count;
+	unsigned int max;
+	struct clflush_obj objs[];
 };
 
+static void i915_clflush_free_rcu(struct rcu_head *rcu)
+{
+	struct clflush *clflush = container_of(rcu, typeof(*clflush), dma.rcu);
+
+	kvfree(clflush);
+}
+
 static const char *i915_clflush_get_driver_name(struct dma_fence *fence)
 {
 	return DRIVER_NAME;
@@ -56,8 +84,8 @@ static void i915_clflush_release(struct dma_fence *fence)
 
 	i915_sw_fence_fini(&clflush->wait);
 
-	BUILD_BUG_ON(offsetof(typeof(*clflush), dma));
-	dma_fence_free(&clflush->dma);
+	/* As dma_fence_free(), but we may have been vmalloc'ed */
+	call_rcu(&clflush->dma.rcu, i915_clflush_free_rcu);
 }
 
 static const struct dma_fence_ops i915_clflush_ops = {
@@ -75,11 +103,8 @@ static void __i915_do_clflush(struct drm_i915_gem_object *obj)
 	intel_fb_obj_flush(obj, ORIGIN_CPU);
 }
 
-static void i915_clflush_work(struct work_struct *work)
+static void i915_clflush_one(struct drm_i915_gem_object *obj)
 {
-	struct clflush *clflush = container_of(work, typeof(*clflush), work);
-	struct drm_i915_gem_object *obj = clflush->obj;
-
 	if (i915_gem_object_pin_pages(obj)) {
 		DRM_ERROR("Failed to acquire obj->pages for clflushing\n");
 		goto out;
@@ -91,6 +116,41 @@ static void i915_clflush_work(struct work_struct *work)
 
 out:
 	i915_gem_object_put(obj);
+}
+
+static void i915_clflush_obj_work(struct work_struct *work)
+{
+	struct clflush_obj *co = container_of(work, typeof(*co), work);
+
+	i915_clflush_one(co->obj);
+}
+
+static void i915_clflush_work(struct work_struct *work)
+{
+	struct clflush *clflush = container_of(work, typeof(*clflush), work);
+	unsigned int i;
+
+	/*
+	 * For a large batch, hand all but the first object to the system
+	 * unbound workers (not our own queue, so that we never wait upon
+	 * work queued behind ourselves) and flush the first while they run.
+	 */
+	if (clflush->count > 1 && clflush->size >= I915_CLFLUSH_PARALLEL_MIN &&
+	    num_online_cpus() > 1) {
+		for (i = 1; i < clflush->count; i++) {
+			INIT_WORK(&clflush->objs[i].work,
+				  i915_clflush_obj_work);
+			queue_work(system_unbound_wq, &clflush->objs[i].work);
+		}
+
+		i915_clflush_one(clflush->objs[0].obj);
+
+		for (i = 1; i < clflush->count; i++)
+			flush_work(&clflush->objs[i].work);
+	} else {
+		for (i = 0; i < clflush->count; i++)
+			i915_clflush_one(clflush->objs[i].obj);
+	}
 
 	dma_fence_signal(&clflush->dma);
 	dma_fence_put(&clflush->dma);
@@ -104,7 +164,7 @@ i915_clflush_notify(struct i915_sw_fence *fence,
 
 	switch (state) {
 	case FENCE_COMPLETE:
-		schedule_work(&clflush->work);
+		queue_work(clflush->i915->clflush_wq, &clflush->work);
 		break;
 
 	case FENCE_FREE:
@@ -115,8 +175,56 @@ i915_clflush_notify(struct i915_sw_fence *fence,
 	return NOTIFY_DONE;
 }
 
-bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
-			     unsigned int flags)
+static struct clflush *
+clflush_create(struct drm_i915_private *i915, unsigned int max)
+{
+	struct clflush *clflush;
+
+	clflush = kvmalloc(struct_size(clflush, objs, max),
+			   GFP_KERNEL | __GFP_NOWARN);
+	if (!clflush && max > I915_CLFLUSH_CHUNK) {
+		max = I915_CLFLUSH_CHUNK;
+		clflush = kvmalloc(struct_size(clflush, objs, max),
+				   GFP_KERNEL | __GFP_NOWARN);
+	}
+	if (!clflush)
+		return NULL;
+
+	dma_fence_init(&clflush->dma,
+		       &i915_clflush_ops,
+		       &clflush_lock,
+		       i915->mm.unordered_timeline,
+		       0);
+	i915_sw_fence_init(&clflush->wait, i915_clflush_notify);
+	INIT_WORK(&clflush->work, i915_clflush_work);
+
+	clflush->i915 = i915;
+	clflush->size = 0;
+	clflush->count = 0;
+	clflush->max = max;
+
+	dma_fence_get(&clflush->dma);
+
+	return clflush;
+}
+
+/**
+ * i915_gem_clflush_batch_add - queue an object for flushing in a batch
+ * @batch: the batch, initialised by i915_gem_clflush_batch_init()
+ * @obj: the object to flush
+ * @flags: I915_CLFLUSH_FORCE or I915_CLFLUSH_SYNC
+ *
+ * Adds @obj to a single asynchronous flush that may cover many objects, and
+ * so is signaled by a single fence from a single worker. The flush is not
+ * published into the object's reservation until i915_gem_clflush_batch_commit.
+ * Should that fence be too large to allocate, the batch is instead split into
+ * fences of I915_CLFLUSH_CHUNK objects, each committed as it fills.
+ *
+ * Returns true if a flush of @obj was required.
+ */
+bool i915_gem_clflush_batch_add(struct i915_clflush_batch *batch,
+				struct drm_i915_gem_object *obj,
+				unsigned int flags)
 {
 	struct clflush *clflush;
 
@@ -146,34 +254,29 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 
 	trace_i915_gem_object_clflush(obj);
 
-	clflush = NULL;
-	if (!(flags & I915_CLFLUSH_SYNC))
-		clflush = kmalloc(sizeof(*clflush), GFP_KERNEL);
-	if (clflush) {
+	clflush = batch->clflush;
+	if (clflush && clflush->count == clflush->max &&
+	    !(flags & I915_CLFLUSH_SYNC)) {
+		i915_gem_clflush_batch_commit(batch);
+		clflush = NULL;
+	}
+	if (!clflush && !(flags & I915_CLFLUSH_SYNC))
+		clflush = batch->clflush =
+			clflush_create(to_i915(obj->base.dev), batch->max);
+	if (clflush && !(flags & I915_CLFLUSH_SYNC)) {
 		GEM_BUG_ON(!obj->cache_dirty);
-
-		dma_fence_init(&clflush->dma,
-			       &i915_clflush_ops,
-			       &clflush_lock,
-			       to_i915(obj->base.dev)->mm.unordered_timeline,
-			       0);
-		i915_sw_fence_init(&clflush->wait, i915_clflush_notify);
-
-		clflush->obj = i915_gem_object_get(obj);
-		INIT_WORK(&clflush->work, i915_clflush_work);
-
-		dma_fence_get(&clflush->dma);
+		GEM_BUG_ON(clflush->count >= clflush->max);
+		GEM_BUG_ON(!batch->max);
 
 		i915_sw_fence_await_reservation(&clflush->wait,
 						obj->resv, NULL,
+						to_i915(obj->base.dev)->mm.unordered_timeline,
 						true, I915_FENCE_TIMEOUT,
 						I915_FENCE_GFP);
 
-		reservation_object_lock(obj->resv, NULL);
-		reservation_object_add_excl_fence(obj->resv, &clflush->dma);
-		reservation_object_unlock(obj->resv);
-
-		i915_sw_fence_commit(&clflush->wait);
+		clflush->objs[clflush->count++].obj = i915_gem_object_get(obj);
+		clflush->size += obj->base.size;
+		batch->max--;
 	} else if (obj->mm.pages) {
 		__i915_do_clflush(obj);
 	} else {
@@ -181,5 +284,47 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 	}
 
 	obj->cache_dirty = false;
+	obj->cache_flushed = i915_gem_object_has_pages(obj);
 	return true;
 }
+
+/**
+ * i915_gem_clflush_batch_commit - submit the batched flush
+ * @batch: the batch of objects to flush
+ *
+ * Publishes the flush fence as the exclusive fence of every object in
+ * @batch and releases the worker to run once all their prior fences signal.
+ */
+void i915_gem_clflush_batch_commit(struct i915_clflush_batch *batch)
+{
+	struct clflush *clflush = batch->clflush;
+	unsigned int i;
+
+	if (!clflush)
+		return;
+
+	GEM_BUG_ON(!clflush->count);
+	for (i = 0; i < clflush->count; i++) {
+		struct drm_i915_gem_object *obj = clflush->objs[i].obj;
+
+		reservation_object_lock(obj->resv, NULL);
+		reservation_object_add_excl_fence(obj->resv, &clflush->dma);
+		reservation_object_unlock(obj->resv);
+	}
+
+	i915_sw_fence_commit(&clflush->wait);
+	batch->clflush = NULL;
+}
+
+bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
+			     unsigned int flags)
+{
+	struct i915_clflush_batch batch;
+	bool ret;
+
+	i915_gem_clflush_batch_init(&batch, 1);
+	ret = i915_gem_clflush_batch_add(&batch, obj, flags);
+	i915_gem_clflush_batch_commit(&batch);
+
+	return ret;
+}
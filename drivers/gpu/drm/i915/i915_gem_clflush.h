@@ -33,4 +33,23 @@ bool i915_gem_clflush_object(struct drm_i915_gem_object *obj,
 #define I915_CLFLUSH_FORCE BIT(0)
 #define I915_CLFLUSH_SYNC BIT(1)
 
+struct clflush;
+
+struct i915_clflush_batch {
+	struct clflush *clflush;
+	unsigned int max; /* how many more objects may still be added */
+};
+
+static inline void
+i915_gem_clflush_batch_init(struct i915_clflush_batch *batch, unsigned int max)
+{
+	batch->clflush = NULL;
+	batch->max = max;
+}
+
+bool i915_gem_clflush_batch_add(struct i915_clflush_batch *batch,
+				struct drm_i915_gem_object *obj,
+				unsigned int flags);
+void i915_gem_clflush_batch_commit(struct i915_clflush_batch *batch);
+
 #endif /* __I915_GEM_CLFLUSH_H__ */
@@ -86,20 +86,32 @@
  */
 
 #include <linux/log2.h>
+#include <linux/sync_file.h>
 #include <drm/drmP.h>
 #include <drm/i915_drm.h>
 #include "i915_drv.h"
 #include "i915_trace.h"
+#include "intel_mocs.h"
 #include "intel_workarounds.h"
 
 #define ALL_L3_SLICES(dev) (1 << NUM_L3_SLICES(dev)) - 1
 
+static int resident_set_free(int id, void *p, void *data)
+{
+	kvfree(p);
+	return 0;
+}
+
 static void lut_close(struct i915_gem_context *ctx)
 {
 	struct i915_lut_handle *lut, *ln;
 	struct radix_tree_iter iter;
 	void __rcu **slot;
 
+	idr_for_each(&ctx->resident_sets, resident_set_free, NULL);
+	idr_destroy(&ctx->resident_sets);
+	ctx->handles_gen++;
+
 	list_for_each_entry_safe(lut, ln, &ctx->handles_list, ctx_link) {
 		list_del(&lut->obj_link);
 		kmem_cache_free(ctx->i915->luts, lut);
@@ -110,16 +122,44 @@ static void lut_close(struct i915_gem_context *ctx)
 		struct i915_vma *vma = rcu_dereference_raw(*slot);
 
 		radix_tree_iter_delete(&ctx->handles_vma, &iter, slot);
+
+		/*
+		 * If another context still shares our vm, it is not about to
+		 * be closed wholesale and so we must close our vma as the
+		 * handles are, see i915_gem_close_object().
+		 */
+		if (ctx->ppgtt && ctx->ppgtt->open_count > 1) {
+			GEM_BUG_ON(!vma->open_count);
+			if (!--vma->open_count)
+				i915_vma_close(vma);
+		}
+
 		__i915_gem_object_release_unless_active(vma->obj);
 	}
 	rcu_read_unlock();
 }
 
+struct i915_trtt_table {
+	struct i915_vma *vma;
+	bool linked; /* pointed to by its parent table */
+};
+
 static void intel_context_free_trtt(struct i915_gem_context *ctx)
 {
+	struct radix_tree_iter iter;
+	void __rcu **slot;
+
 	if (!ctx->trtt_info.vma)
 		return;
 
+	radix_tree_for_each_slot(slot, &ctx->trtt_info.tables, &iter, 0) {
+		struct i915_trtt_table *table = rcu_dereference_raw(*slot);
+
+		radix_tree_iter_delete(&ctx->trtt_info.tables, &iter, slot);
+		i915_vma_unpin_and_release(&table->vma, 0);
+		kfree(table);
+	}
+
 	intel_trtt_context_destroy_vma(ctx->trtt_info.vma);
 }
 
@@ -131,7 +171,12 @@ static void i915_gem_context_free(struct i915_gem_context *ctx)
 	GEM_BUG_ON(!i915_gem_context_is_closed(ctx));
 
 	intel_context_free_trtt(ctx);
+	kfree(ctx->mocs);
+	if (ctx->freq_hint.min || ctx->freq_hint.max)
+		atomic_dec(&ctx->i915->gt_pm.rps.qos.users);
 	i915_ppgtt_put(ctx->ppgtt);
+	if (ctx->seqno_vma)
+		i915_vma_unpin_and_release(&ctx->seqno_vma, 0);
 
 	for (n = 0; n < ARRAY_SIZE(ctx->__engine); n++) {
 		struct intel_context *ce = &ctx->__engine[n];
@@ -145,7 +190,11 @@ static void i915_gem_context_free(struct i915_gem_context *ctx)
 
 	list_del(&ctx->link);
 
-	ida_simple_remove(&ctx->i915->contexts.hw_ida, ctx->hw_id);
+	GEM_BUG_ON(ctx->hw_id_pin_count > i915_gem_context_is_kernel(ctx));
+	if (!list_empty(&ctx->hw_id_link)) {
+		ida_simple_remove(&ctx->i915->contexts.hw_ida, ctx->hw_id);
+		list_del(&ctx->hw_id_link);
+	}
 	kfree_rcu(ctx, rcu);
 }
 
@@ -195,10 +244,33 @@ void i915_gem_context_release(struct kref *ref)
 		queue_work(i915->wq, &i915->contexts.free_work);
 }
 
+static void pin_cache_evict(struct intel_context *ce)
+{
+	struct drm_i915_private *i915 = ce->gem_context->i915;
+
+	GEM_BUG_ON(list_empty(&ce->pin_link));
+	GEM_BUG_ON(!i915->contexts.pin_lru_count);
+
+	list_del_init(&ce->pin_link);
+	i915->contexts.pin_lru_count--;
+
+	intel_context_unpin(ce);
+}
+
 static void context_close(struct i915_gem_context *ctx)
 {
+	unsigned int n;
+
 	i915_gem_context_set_closed(ctx);
 
+	/* No more requests can be created, so stop keeping it pinned */
+	for (n = 0; n < ARRAY_SIZE(ctx->__engine); n++) {
+		struct intel_context *ce = &ctx->__engine[n];
+
+		if (!list_empty(&ce->pin_link))
+			pin_cache_evict(ce);
+	}
+
 	/*
 	 * The LUT uses the VMA as a backpointer to unref the object,
 	 * so we need to clear the LUT before we close all the VMA (inside
@@ -208,10 +280,46 @@ static void context_close(struct i915_gem_context *ctx)
 	if (ctx->ppgtt)
 		i915_ppgtt_close(&ctx->ppgtt->vm);
 
+	/* Keep the client's bill, even as its contexts come and go */
+	if (!IS_ERR_OR_NULL(ctx->file_priv))
+		atomic64_add(ktime_to_ns(i915_gem_context_get_busy_time(ctx)),
+			     &ctx->file_priv->closed_busy_ns);
+
 	ctx->file_priv = ERR_PTR(-EBADF);
 	i915_gem_context_put(ctx);
 }
 
+static int steal_hw_id(struct drm_i915_private *i915)
+{
+	struct i915_gem_context *ctx, *cn;
+	LIST_HEAD(pinned);
+	int id = -ENOSPC;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	/*
+	 * Take the id of the least recently pinned context that is not
+	 * currently in use, moving those that are out of the way so that
+	 * we do not have to walk over them again on the next steal.
+	 */
+	list_for_each_entry_safe(ctx, cn,
+				 &i915->contexts.hw_id_list, hw_id_link) {
+		if (ctx->hw_id_pin_count) {
+			list_move_tail(&ctx->hw_id_link, &pinned);
+			continue;
+		}
+
+		GEM_BUG_ON(!ctx->hw_id); /* kernel_context is pinned */
+		id = ctx->hw_id;
+		list_del_init(&ctx->hw_id_link);
+		i915->contexts.hw_id_steals++;
+		break;
+	}
+
+	list_splice_tail(&pinned, &i915->contexts.hw_id_list);
+	return id;
+}
+
 static int assign_hw_id(struct drm_i915_private *dev_priv, unsigned *out)
 {
 	int ret;
@@ -230,17 +338,14 @@ static int assign_hw_id(struct drm_i915_private *dev_priv, unsigned *out)
 			max = MAX_CONTEXT_HW_ID;
 	}
 
-
 	ret = ida_simple_get(&dev_priv->contexts.hw_ida,
 			     0, max, GFP_KERNEL);
 	if (ret < 0) {
-		/* Contexts are only released when no longer active.
-		 * Flush any pending retires to hopefully release some
-		 * stale contexts and try again.
+		/*
+		 * Rather than wait for stale contexts to be retired and
+		 * freed, reuse the id of an idle context straight away.
 		 */
-		i915_retire_requests(dev_priv);
-		ret = ida_simple_get(&dev_priv->contexts.hw_ida,
-				     0, max, GFP_KERNEL);
+		ret = steal_hw_id(dev_priv);
 		if (ret < 0)
 			return ret;
 	}
@@ -249,6 +354,167 @@ static int assign_hw_id(struct drm_i915_private *dev_priv, unsigned *out)
 	return 0;
 }
 
+/**
+ * i915_gem_context_pin_hw_id - keep the context's hw_id while in use
+ * @ctx: the context
+ *
+ * Whilst the context is pinned on an engine, the hw_id is baked into its
+ * descriptor and so must not be reassigned. If the id was taken from the
+ * context whilst it was idle, a new one is assigned here.
+ *
+ * Returns:
+ *
+ * 0 on success, negative error code on failure.
+ */
+int i915_gem_context_pin_hw_id(struct i915_gem_context *ctx)
+{
+	struct drm_i915_private *i915 = ctx->i915;
+	int err;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (list_empty(&ctx->hw_id_link)) {
+		GEM_BUG_ON(ctx->hw_id_pin_count);
+
+		err = assign_hw_id(i915, &ctx->hw_id);
+		if (err)
+			return err;
+	}
+
+	list_move_tail(&ctx->hw_id_link, &i915->contexts.hw_id_list);
+	ctx->hw_id_pin_count++;
+	return 0;
+}
+
+/**
+ * intel_context_pin_cache_add - keep a freshly pinned context resident
+ * @ce: the engine's context, just pinned for its first user
+ *
+ * Takes an extra pin on @ce so that its state and ring stay bound and
+ * mapped after its last request is retired, and makes it the most
+ * recently used entry of the pin cache. Should the cache grow beyond
+ * i915_modparams.context_pin_cache, the least recently used contexts are
+ * released.
+ */
+void intel_context_pin_cache_add(struct intel_context *ce)
+{
+	struct drm_i915_private *i915 = ce->gem_context->i915;
+	unsigned int budget = READ_ONCE(i915_modparams.context_pin_cache);
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+	GEM_BUG_ON(!ce->pin_count);
+
+	/* The kernel contexts are permanently pinned already */
+	if (!budget || i915_gem_context_is_kernel(ce->gem_context))
+		return;
+
+	if (!list_empty(&ce->pin_link)) {
+		intel_context_pin_cache_touch(ce);
+		return;
+	}
+
+	__intel_context_pin(ce);
+	list_add_tail(&ce->pin_link, &i915->contexts.pin_lru);
+	i915->contexts.pin_lru_count++;
+
+	while (i915->contexts.pin_lru_count > budget)
+		pin_cache_evict(list_first_entry(&i915->contexts.pin_lru,
+						 struct intel_context,
+						 pin_link));
+}
+
+/**
+ * i915_gem_contexts_unpin_cached - release all contexts kept pinned
+ * @i915: i915 device
+ *
+ * Drops the pins held by the context pin cache, so that the state and
+ * ring of idle contexts may be evicted from the GGTT once their last
+ * request is retired.
+ *
+ * Returns true if any context was released.
+ */
+bool i915_gem_contexts_unpin_cached(struct drm_i915_private *i915)
+{
+	bool released = false;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	while (!list_empty(&i915->contexts.pin_lru)) {
+		pin_cache_evict(list_first_entry(&i915->contexts.pin_lru,
+						 struct intel_context,
+						 pin_link));
+		released = true;
+	}
+
+	return released;
+}
+
+/**
+ * intel_context_get_busy_time - time the context has been active on its engine
+ * @ce: the engine's context
+ *
+ * Returns the accumulated time that @ce has been submitted to the HW,
+ * including the current period should it be active now.
+ */
+ktime_t intel_context_get_busy_time(struct intel_context *ce)
+{
+	unsigned int seq;
+	ktime_t total;
+
+	do {
+		seq = read_seqbegin(&ce->stats.lock);
+		total = ce->stats.total;
+		if (ce->stats.active)
+			total = ktime_add(total,
+					  ktime_sub(ktime_get(), ce->stats.start));
+	} while (read_seqretry(&ce->stats.lock, seq));
+
+	return total;
+}
+
+/**
+ * i915_gem_context_get_busy_time - time the context has been active on the GPU
+ * @ctx: the context
+ *
+ * Returns the total of intel_context_get_busy_time() across all engines.
+ */
+ktime_t i915_gem_context_get_busy_time(struct i915_gem_context *ctx)
+{
+	ktime_t total = 0;
+	unsigned int n;
+
+	for (n = 0; n < ARRAY_SIZE(ctx->__engine); n++)
+		total = ktime_add(total,
+				  intel_context_get_busy_time(&ctx->__engine[n]));
+
+	return total;
+}
+
+static int client_busy_time(int id, void *p, void *data)
+{
+	u64 *total = data;
+
+	*total += ktime_to_ns(i915_gem_context_get_busy_time(p));
+	return 0;
+}
+
+/**
+ * i915_gem_client_busy_time - GPU time used by a client
+ * @file_priv: the client
+ *
+ * Returns the total time in nanoseconds that all of the client's contexts,
+ * past and present, have been submitted to the GPU.
+ */
+u64 i915_gem_client_busy_time(struct drm_i915_file_private *file_priv)
+{
+	u64 total = atomic64_read(&file_priv->closed_busy_ns);
+
+	lockdep_assert_held(&file_priv->dev_priv->drm.struct_mutex);
+
+	idr_for_each(&file_priv->context_idr, client_busy_time, &total);
+	return total;
+}
+
 static u32 default_desc_template(const struct drm_i915_private *i915,
 				 const struct i915_hw_ppgtt *ppgtt)
 {
@@ -290,20 +556,26 @@ __create_hw_context(struct drm_i915_private *dev_priv,
 		kfree(ctx);
 		return ERR_PTR(ret);
 	}
+	list_add_tail(&ctx->hw_id_link, &dev_priv->contexts.hw_id_list);
 
 	kref_init(&ctx->ref);
 	list_add_tail(&ctx->link, &dev_priv->contexts.list);
 	ctx->i915 = dev_priv;
 	ctx->sched.priority = I915_PRIORITY_NORMAL;
+	ewma_spin_init(&ctx->spin.avg_us);
+	ewma_runtime_init(&ctx->runtime_us);
 
 	for (n = 0; n < ARRAY_SIZE(ctx->__engine); n++) {
 		struct intel_context *ce = &ctx->__engine[n];
 
 		ce->gem_context = ctx;
+		INIT_LIST_HEAD(&ce->pin_link);
+		seqlock_init(&ce->stats.lock);
 	}
 
 	INIT_RADIX_TREE(&ctx->handles_vma, GFP_KERNEL);
 	INIT_LIST_HEAD(&ctx->handles_list);
+	idr_init(&ctx->resident_sets);
 
 	/* Default context will never have a file_priv */
 	ret = DEFAULT_CONTEXT_HANDLE;
@@ -443,6 +715,9 @@ i915_gem_context_create_kernel(struct drm_i915_private *i915, int prio)
 	ctx->sched.priority = prio;
 	ctx->ring_size = PAGE_SIZE;
 
+	/* Our own contexts keep their ids for their lifetime */
+	ctx->hw_id_pin_count = 1;
+
 	GEM_BUG_ON(!i915_gem_context_is_kernel(ctx));
 
 	return ctx;
@@ -480,6 +755,8 @@ int i915_gem_contexts_init(struct drm_i915_private *dev_priv)
 		return ret;
 
 	INIT_LIST_HEAD(&dev_priv->contexts.list);
+	INIT_LIST_HEAD(&dev_priv->contexts.hw_id_list);
+	INIT_LIST_HEAD(&dev_priv->contexts.pin_lru);
 	INIT_WORK(&dev_priv->contexts.free_work, contexts_free_worker);
 	init_llist_head(&dev_priv->contexts.free_list);
 
@@ -531,6 +808,9 @@ void i915_gem_contexts_fini(struct drm_i915_private *i915)
 {
 	lockdep_assert_held(&i915->drm.struct_mutex);
 
+	i915_gem_contexts_unpin_cached(i915);
+	GEM_BUG_ON(i915->contexts.pin_lru_count);
+
 	if (i915->preempt_context)
 		destroy_kernel_context(&i915->preempt_context);
 	destroy_kernel_context(&i915->kernel_context);
@@ -686,6 +966,7 @@ intel_context_set_trtt(struct i915_gem_context *ctx,
 	}
 
 	ctx->trtt_info.vma = vma;
+	INIT_RADIX_TREE(&ctx->trtt_info.tables, GFP_KERNEL);
 	ctx->trtt_info.null_tile_val = trtt_params.null_tile_val;
 	ctx->trtt_info.invd_tile_val = trtt_params.invd_tile_val;
 	ctx->trtt_info.l3_table_address = trtt_params.l3_table_address;
@@ -705,6 +986,69 @@ intel_context_set_trtt(struct i915_gem_context *ctx,
 	return ret;
 }
 
+static int
+context_get_mocs(struct i915_gem_context *ctx,
+		 struct drm_i915_gem_context_param *args)
+{
+	struct drm_i915_gem_context_mocs_entry *entries;
+	int count, ret;
+
+	entries = kcalloc(GEN9_NUM_MOCS_ENTRIES, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	ret = i915_mutex_lock_interruptible(&ctx->i915->drm);
+	if (ret)
+		goto out;
+
+	count = intel_mocs_get_context_table(ctx, entries);
+	mutex_unlock(&ctx->i915->drm.struct_mutex);
+	if (count < 0) {
+		ret = count;
+		goto out;
+	}
+
+	if (args->size >= count * sizeof(*entries) &&
+	    copy_to_user(u64_to_user_ptr(args->value),
+			 entries, count * sizeof(*entries)))
+		ret = -EFAULT;
+	args->size = count * sizeof(*entries);
+
+out:
+	kfree(entries);
+	return ret;
+}
+
+static int
+context_set_mocs(struct i915_gem_context *ctx,
+		 struct drm_i915_gem_context_param *args)
+{
+	struct drm_i915_gem_context_mocs_entry *entries = NULL;
+	struct drm_i915_private *i915 = ctx->i915;
+	unsigned int count;
+	int ret;
+
+	if (args->size % sizeof(*entries) ||
+	    args->size > GEN9_NUM_MOCS_ENTRIES * sizeof(*entries))
+		return -EINVAL;
+
+	count = args->size / sizeof(*entries);
+	if (count) {
+		/* As for the TRTT, do not fault under struct_mutex */
+		mutex_unlock(&i915->drm.struct_mutex);
+		entries = memdup_user(u64_to_user_ptr(args->value),
+				      args->size);
+		mutex_lock(&i915->drm.struct_mutex);
+		if (IS_ERR(entries))
+			return PTR_ERR(entries);
+	}
+
+	ret = intel_mocs_set_context_table(ctx, entries, count);
+	kfree(entries);
+
+	return ret;
+}
+
 static struct i915_request *
 last_request_on_engine(struct i915_timeline *timeline,
 		       struct intel_engine_cs *engine)
@@ -994,6 +1338,123 @@ int i915_gem_context_set_watchdog(struct i915_gem_context *ctx,
 }
 
 
+static int context_get_seqno_page(struct drm_i915_private *i915,
+				  struct drm_file *file,
+				  struct i915_gem_context *ctx,
+				  struct drm_i915_gem_context_param *args)
+{
+	struct drm_i915_gem_object *obj;
+	struct i915_vma *vma;
+	u32 handle;
+	int err;
+
+	if (INTEL_GEN(i915) < 8)
+		return -ENODEV;
+
+	err = i915_mutex_lock_interruptible(&i915->drm);
+	if (err)
+		return err;
+
+	vma = ctx->seqno_vma;
+	if (!vma) {
+		obj = i915_gem_object_create(i915, PAGE_SIZE);
+		if (IS_ERR(obj)) {
+			err = PTR_ERR(obj);
+			goto unlock;
+		}
+
+		/* Snooped, so that CPU mmaps see the GPU writes */
+		err = i915_gem_object_set_cache_level(obj, I915_CACHE_LLC);
+		if (err)
+			goto err_obj;
+
+		/* Only the GPU may write (gen8+ has no RO in the GGTT) */
+		i915_gem_object_set_readonly(obj);
+
+		vma = i915_vma_instance(obj, &i915->ggtt.vm, NULL);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			goto err_obj;
+		}
+
+		err = i915_vma_pin(vma, 0, 0, PIN_GLOBAL | PIN_HIGH);
+		if (err)
+			goto err_obj;
+
+		ctx->seqno_vma = vma;
+	}
+
+	err = drm_gem_handle_create(file, &vma->obj->base, &handle);
+	if (err == 0)
+		args->value = handle;
+	goto unlock;
+
+err_obj:
+	i915_gem_object_put(obj);
+unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
+static bool context_has_state(struct i915_gem_context *ctx)
+{
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	for_each_engine(engine, ctx->i915, id) {
+		if (to_intel_context(ctx, engine)->state)
+			return true;
+	}
+
+	return false;
+}
+
+static int context_share_vm(struct drm_i915_file_private *file_priv,
+			    struct i915_gem_context *ctx,
+			    const struct drm_i915_gem_context_param *args)
+{
+	struct i915_gem_context *src;
+	int err = 0;
+
+	lockdep_assert_held(&ctx->i915->drm.struct_mutex);
+
+	if (args->size || upper_32_bits(args->value))
+		return -EINVAL;
+
+	if (!ctx->ppgtt)
+		return -ENODEV;
+
+	src = i915_gem_context_lookup(file_priv, args->value);
+	if (!src)
+		return -ENOENT;
+
+	if (src->ppgtt == ctx->ppgtt)
+		goto out;
+
+	/*
+	 * The context image records the page directories of its vm, and the
+	 * handle LUT the vma within it, so we can only swap the vm before
+	 * anything has been bound into our current one.
+	 */
+	if (!list_empty(&ctx->handles_list) || ctx->trtt_info.vma ||
+	    context_has_state(ctx)) {
+		err = -EBUSY;
+		goto out;
+	}
+
+	i915_ppgtt_close(&ctx->ppgtt->vm);
+	i915_ppgtt_put(ctx->ppgtt);
+
+	i915_ppgtt_get(src->ppgtt);
+	i915_ppgtt_open(src->ppgtt);
+	ctx->ppgtt = src->ppgtt;
+	ctx->desc_template = default_desc_template(ctx->i915, ctx->ppgtt);
+
+out:
+	i915_gem_context_put(src);
+	return err;
+}
+
 int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 				    struct drm_file *file)
 {
@@ -1006,7 +1467,9 @@ int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 	if (!ctx)
 		return -ENOENT;
 
-	args->size = (args->param != I915_CONTEXT_PARAM_TRTT) ? 0 : args->size;
+	if (args->param != I915_CONTEXT_PARAM_TRTT &&
+	    args->param != I915_CONTEXT_PARAM_MOCS)
+		args->size = 0;
 	switch (args->param) {
 	case I915_CONTEXT_PARAM_BAN_PERIOD:
 		ret = -EINVAL;
@@ -1031,12 +1494,51 @@ int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 	case I915_CONTEXT_PARAM_PRIORITY:
 		args->value = ctx->sched.priority;
 		break;
+	case I915_CONTEXT_PARAM_DEADLINE:
+		args->value = ctx->deadline;
+		break;
+	case I915_CONTEXT_PARAM_SPIN:
+		args->value = ctx->spin.adaptive ?
+			I915_CONTEXT_SPIN_ADAPTIVE : I915_CONTEXT_SPIN_FIXED;
+		break;
+	case I915_CONTEXT_PARAM_SEQNO_PAGE:
+		ret = context_get_seqno_page(to_i915(dev), file, ctx, args);
+		break;
+	case I915_CONTEXT_PARAM_STATELESS:
+		args->value = i915_gem_context_is_stateless(ctx);
+		break;
+	case I915_CONTEXT_PARAM_RINGSIZE:
+		args->value = ctx->ring_size;
+		break;
+	case I915_CONTEXT_PARAM_EXPLICIT_COHERENCY:
+		args->value = i915_gem_context_is_explicit_coherency(ctx);
+		break;
+	case I915_CONTEXT_PARAM_BUSY_TIME:
+		args->size = 0;
+		args->value = ktime_to_ns(i915_gem_context_get_busy_time(ctx));
+		break;
+	case I915_CONTEXT_PARAM_FREQUENCY:
+		args->size = 0;
+		args->value = 0;
+		if (ctx->freq_hint.min)
+			args->value |= intel_gpu_freq(to_i915(dev),
+						      ctx->freq_hint.min);
+		if (ctx->freq_hint.max)
+			args->value |= (u64)intel_gpu_freq(to_i915(dev),
+							   ctx->freq_hint.max) << 32;
+		break;
 	case I915_CONTEXT_PARAM_WATCHDOG:
 		ret = i915_gem_context_get_watchdog(ctx, args);
 		break;
 	case I915_CONTEXT_PARAM_TRTT:
 		ret = intel_context_get_trtt(ctx, args);
 		break;
+	case I915_CONTEXT_PARAM_WATCHDOG_ADAPTIVE:
+		args->value = ctx->watchdog_percentile;
+		break;
+	case I915_CONTEXT_PARAM_MOCS:
+		ret = context_get_mocs(ctx, args);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1046,6 +1548,57 @@ int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 	return ret;
 }
 
+static int context_set_freq_hint(struct drm_i915_private *i915,
+				 struct i915_gem_context *ctx,
+				 const struct drm_i915_gem_context_param *args)
+{
+	struct intel_rps *rps = &i915->gt_pm.rps;
+	u32 min_mhz = lower_32_bits(args->value);
+	u32 max_mhz = upper_32_bits(args->value);
+	bool had, has;
+	u8 min = 0, max = 0;
+
+	if (args->size)
+		return -EINVAL;
+
+	if (!HAS_EXECLISTS(i915))
+		return -ENODEV;
+
+	if (min_mhz && max_mhz && min_mhz > max_mhz)
+		return -EINVAL;
+
+	if (min_mhz > INT_MAX || max_mhz > INT_MAX)
+		return -EINVAL;
+
+	/* Raising the floor affects everyone sharing the GPU */
+	if (min_mhz && !capable(CAP_SYS_NICE))
+		return -EPERM;
+
+	/* Stay within the limits the admin set through sysfs */
+	if (min_mhz)
+		min = clamp_t(int, intel_freq_opcode(i915, min_mhz),
+			      READ_ONCE(rps->min_freq_softlimit),
+			      READ_ONCE(rps->max_freq_softlimit));
+	if (max_mhz)
+		max = clamp_t(int, intel_freq_opcode(i915, max_mhz),
+			      READ_ONCE(rps->min_freq_softlimit),
+			      READ_ONCE(rps->max_freq_softlimit));
+
+	had = ctx->freq_hint.min || ctx->freq_hint.max;
+	has = min || max;
+
+	/* Requests already running keep the hint they were accounted with */
+	WRITE_ONCE(ctx->freq_hint.min, min);
+	WRITE_ONCE(ctx->freq_hint.max, max);
+
+	if (has && !had)
+		atomic_inc(&rps->qos.users);
+	else if (had && !has)
+		atomic_dec(&rps->qos.users);
+
+	return 0;
+}
+
 int i915_gem_context_setparam_ioctl(struct drm_device *dev, void *data,
 				    struct drm_file *file)
 {
@@ -1112,12 +1665,102 @@ int i915_gem_context_setparam_ioctl(struct drm_device *dev, void *data,
 		}
 		break;
 
+	case I915_CONTEXT_PARAM_DEADLINE:
+		if (args->size)
+			ret = -EINVAL;
+		else if (!(to_i915(dev)->caps.scheduler & I915_SCHEDULER_CAP_DEADLINE))
+			ret = -ENODEV;
+		else if (args->value > S64_MAX)
+			ret = -EINVAL;
+		else
+			ctx->deadline = args->value;
+		break;
+
+	case I915_CONTEXT_PARAM_SPIN:
+		if (args->size)
+			ret = -EINVAL;
+		else if (args->value == I915_CONTEXT_SPIN_FIXED)
+			ctx->spin.adaptive = false;
+		else if (args->value == I915_CONTEXT_SPIN_ADAPTIVE)
+			ctx->spin.adaptive = true;
+		else
+			ret = -EINVAL;
+		break;
+
 	case I915_CONTEXT_PARAM_WATCHDOG:
 		ret = i915_gem_context_set_watchdog(ctx, args);
 		break;
 	case I915_CONTEXT_PARAM_TRTT:
 		ret = intel_context_set_trtt(ctx, args);
 		break;
+	case I915_CONTEXT_PARAM_WATCHDOG_ADAPTIVE:
+		if (args->size)
+			ret = -EINVAL;
+		else if (!to_i915(dev)->engine[VCS]->emit_start_watchdog)
+			ret = -ENODEV;
+		else if (args->value > 100)
+			ret = -EINVAL;
+		else
+			ctx->watchdog_percentile = args->value;
+		break;
+	case I915_CONTEXT_PARAM_MOCS:
+		ret = context_set_mocs(ctx, args);
+		break;
+	case I915_CONTEXT_PARAM_SHARE_VM:
+		ret = context_share_vm(file_priv, ctx, args);
+		break;
+	case I915_CONTEXT_PARAM_FREQUENCY:
+		ret = context_set_freq_hint(to_i915(dev), ctx, args);
+		break;
+	case I915_CONTEXT_PARAM_STATELESS:
+		if (args->size)
+			ret = -EINVAL;
+		else if (!HAS_EXECLISTS(to_i915(dev)))
+			ret = -ENODEV;
+		else if (context_has_state(ctx))
+			ret = -EBUSY;
+		else if (args->value)
+			i915_gem_context_set_stateless(ctx);
+		else
+			i915_gem_context_clear_stateless(ctx);
+		break;
+	case I915_CONTEXT_PARAM_RINGSIZE:
+		if (args->size)
+			ret = -EINVAL;
+		else if (!HAS_EXECLISTS(to_i915(dev)))
+			ret = -ENODEV;
+		else if (args->value < I915_GTT_PAGE_SIZE ||
+			 args->value > 512 * I915_GTT_PAGE_SIZE ||
+			 !is_power_of_2(args->value))
+			ret = -EINVAL;
+		else if (context_has_state(ctx))
+			ret = -EBUSY;
+		else
+			ctx->ring_size = args->value;
+		break;
+	case I915_CONTEXT_PARAM_EXPLICIT_COHERENCY:
+		if (args->size)
+			ret = -EINVAL;
+		else if (args->value)
+			i915_gem_context_set_explicit_coherency(ctx);
+		else
+			i915_gem_context_clear_explicit_coherency(ctx);
+		break;
+	case I915_CONTEXT_PARAM_RESIDENT_SET:
+		if (args->size) {
+			ret = -EINVAL;
+		} else if (!args->value || args->value > INT_MAX) {
+			ret = -EINVAL;
+		} else {
+			struct i915_resident_set *set;
+
+			set = idr_remove(&ctx->resident_sets, args->value);
+			if (set)
+				kvfree(set);
+			else
+				ret = -ENOENT;
+		}
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -1129,6 +1772,337 @@ int i915_gem_context_setparam_ioctl(struct drm_device *dev, void *data,
 	return ret;
 }
 
+/*
+ * The L2 tables are keyed by their L3 index, the L1 tables following them
+ * by their L3 and L2 indices.
+ */
+static unsigned long trtt_table_key(u64 offset, int level)
+{
+	unsigned long key = offset >> GEN9_TRTT_L3_SHIFT;
+
+	if (level == 1)
+		key = GEN9_TRTT_L3_ENTRIES + (offset >> GEN9_TRTT_L2_SHIFT);
+
+	return key;
+}
+
+static struct i915_trtt_table *
+trtt_table(struct i915_gem_context *ctx, u64 offset, int level)
+{
+	const unsigned long key = trtt_table_key(offset, level);
+	struct drm_i915_gem_object *obj;
+	struct i915_trtt_table *table;
+	struct i915_vma *vma;
+	void *vaddr;
+	int err;
+
+	table = radix_tree_lookup(&ctx->trtt_info.tables, key);
+	if (table)
+		return table;
+
+	table = kzalloc(sizeof(*table), GFP_KERNEL);
+	if (!table)
+		return ERR_PTR(-ENOMEM);
+
+	obj = i915_gem_object_create_internal(ctx->i915, PAGE_SIZE);
+	if (IS_ERR(obj)) {
+		err = PTR_ERR(obj);
+		goto err_free;
+	}
+
+	vma = i915_vma_instance(obj, &ctx->ppgtt->vm, NULL);
+	if (IS_ERR(vma)) {
+		err = PTR_ERR(vma);
+		goto err_obj;
+	}
+
+	err = i915_vma_pin(vma, 0, PAGE_SIZE, PIN_USER | PIN_HIGH);
+	if (err)
+		goto err_obj;
+
+	/* Every tile covered by a new table starts out invalid */
+	vaddr = i915_gem_object_pin_map(obj, I915_MAP_WC);
+	if (IS_ERR(vaddr)) {
+		err = PTR_ERR(vaddr);
+		goto err_unpin;
+	}
+	memset32(vaddr, ctx->trtt_info.invd_tile_val, PAGE_SIZE / sizeof(u32));
+	i915_gem_object_unpin_map(obj);
+
+	err = radix_tree_insert(&ctx->trtt_info.tables, key, table);
+	if (err)
+		goto err_unpin;
+
+	table->vma = vma;
+	return table;
+
+err_unpin:
+	i915_vma_unpin(vma);
+err_obj:
+	i915_gem_object_put(obj);
+err_free:
+	kfree(table);
+	return ERR_PTR(err);
+}
+
+static int trtt_tile_ok(const struct i915_gem_context *ctx,
+			const struct drm_i915_gem_trtt_tile *tile)
+{
+	const u64 base = ctx->trtt_info.segment_base_addr;
+
+	if (tile->flags & ~(I915_TRTT_TILE_UNBIND | I915_TRTT_TILE_NULL) ||
+	    hweight32(tile->flags) > 1 || tile->pad)
+		return -EINVAL;
+
+	if (!IS_ALIGNED(tile->tile_addr, GEN9_TRTT_TILE_SIZE) ||
+	    tile->tile_addr < base ||
+	    tile->tile_addr - base >= GEN9_TRTT_SEGMENT_SIZE)
+		return -EINVAL;
+
+	if (tile->flags)
+		return 0;
+
+	/* The backing store must itself be outside of the segment */
+	if (!IS_ALIGNED(tile->backing_addr, GEN9_TRTT_TILE_SIZE) ||
+	    range_overflows_t(u64, tile->backing_addr, GEN9_TRTT_TILE_SIZE,
+			      ctx->ppgtt->vm.total) ||
+	    (tile->backing_addr >= base &&
+	     tile->backing_addr - base < GEN9_TRTT_SEGMENT_SIZE))
+		return -EINVAL;
+
+	return 0;
+}
+
+static u32 *trtt_store(u32 *cs, u64 addr, u32 value)
+{
+	*cs++ = MI_STORE_DWORD_IMM_GEN4;
+	*cs++ = lower_32_bits(addr);
+	*cs++ = upper_32_bits(addr);
+	*cs++ = value;
+
+	return cs;
+}
+
+static int trtt_emit_tile(struct i915_request *rq,
+			  const struct drm_i915_gem_trtt_tile *tile)
+{
+	struct i915_gem_context *ctx = rq->gem_context;
+	const u64 offset = tile->tile_addr - ctx->trtt_info.segment_base_addr;
+	struct i915_trtt_table *l2, *l1;
+	u64 l2_addr, l1_addr;
+	unsigned int len;
+	u32 entry;
+	u32 *cs;
+
+	/* Both tables were looked up, or created, by trtt_prepare() */
+	l2 = radix_tree_lookup(&ctx->trtt_info.tables,
+			       trtt_table_key(offset, 2));
+	l1 = radix_tree_lookup(&ctx->trtt_info.tables,
+			       trtt_table_key(offset, 1));
+	GEM_BUG_ON(!l2 || !l1);
+	l2_addr = l2->vma->node.start;
+	l1_addr = l1->vma->node.start;
+
+	if (tile->flags & I915_TRTT_TILE_UNBIND)
+		entry = ctx->trtt_info.invd_tile_val;
+	else if (tile->flags & I915_TRTT_TILE_NULL)
+		entry = ctx->trtt_info.null_tile_val;
+	else
+		entry = lower_32_bits(tile->backing_addr >> GEN9_TRTT_TILE_SHIFT);
+
+	len = 4;
+	if (!l2->linked)
+		len += 8;
+	if (!l1->linked)
+		len += 4;
+
+	cs = intel_ring_begin(rq, len);
+	if (IS_ERR(cs))
+		return PTR_ERR(cs);
+
+	if (!l2->linked) {
+		u64 addr = ctx->trtt_info.l3_table_address +
+			(offset >> GEN9_TRTT_L3_SHIFT) * sizeof(u64);
+
+		cs = trtt_store(cs, addr, lower_32_bits(l2_addr));
+		cs = trtt_store(cs, addr + sizeof(u32), upper_32_bits(l2_addr));
+		l2->linked = true;
+	}
+
+	if (!l1->linked) {
+		u64 addr = l2_addr +
+			((offset >> GEN9_TRTT_L2_SHIFT) %
+			 GEN9_TRTT_L2_ENTRIES) * sizeof(u32);
+
+		cs = trtt_store(cs, addr, lower_32_bits(l1_addr >> PAGE_SHIFT));
+		l1->linked = true;
+	}
+
+	cs = trtt_store(cs,
+			l1_addr +
+			((offset >> GEN9_TRTT_TILE_SHIFT) %
+			 GEN9_TRTT_L1_ENTRIES) * sizeof(u32),
+			entry);
+
+	intel_ring_advance(rq, cs);
+	return 0;
+}
+
+/*
+ * Allocate all the tables up front, before the request is constructed, as
+ * binding them may have to evict and so wait upon the GPU.
+ */
+static int trtt_prepare(struct i915_gem_context *ctx,
+			const struct drm_i915_gem_trtt_tile *tiles,
+			unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		const u64 offset =
+			tiles[i].tile_addr - ctx->trtt_info.segment_base_addr;
+		struct i915_trtt_table *table;
+		int err;
+
+		err = trtt_tile_ok(ctx, &tiles[i]);
+		if (err)
+			return err;
+
+		table = trtt_table(ctx, offset, 2);
+		if (IS_ERR(table))
+			return PTR_ERR(table);
+
+		table = trtt_table(ctx, offset, 1);
+		if (IS_ERR(table))
+			return PTR_ERR(table);
+	}
+
+	return 0;
+}
+
+int i915_gem_context_trtt_bind_ioctl(struct drm_device *dev, void *data,
+				     struct drm_file *file)
+{
+	struct drm_i915_private *i915 = to_i915(dev);
+	struct drm_i915_gem_context_trtt_bind *args = data;
+	struct drm_i915_gem_trtt_tile *tiles;
+	struct sync_file *out_fence = NULL;
+	struct dma_fence *in_fence = NULL;
+	struct i915_gem_context *ctx;
+	struct i915_request *rq;
+	int out_fence_fd = -1;
+	unsigned int i;
+	int err;
+
+	if (args->flags & ~(I915_TRTT_BIND_FENCE_IN | I915_TRTT_BIND_FENCE_OUT))
+		return -EINVAL;
+
+	if (args->count > I915_TRTT_BIND_MAX)
+		return -EINVAL;
+
+	tiles = kvmalloc_array(args->count, sizeof(*tiles), GFP_KERNEL);
+	if (!tiles)
+		return -ENOMEM;
+
+	if (copy_from_user(tiles, u64_to_user_ptr(args->tiles_ptr),
+			   args->count * sizeof(*tiles))) {
+		err = -EFAULT;
+		goto err_tiles;
+	}
+
+	ctx = i915_gem_context_lookup(file->driver_priv, args->ctx_id);
+	if (!ctx) {
+		err = -ENOENT;
+		goto err_tiles;
+	}
+
+	if (args->flags & I915_TRTT_BIND_FENCE_IN) {
+		in_fence = sync_file_get_fence(args->fence);
+		if (!in_fence) {
+			err = -EINVAL;
+			goto err_ctx;
+		}
+	}
+
+	if (args->flags & I915_TRTT_BIND_FENCE_OUT) {
+		out_fence_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (out_fence_fd < 0) {
+			err = out_fence_fd;
+			goto err_in_fence;
+		}
+	}
+
+	err = i915_mutex_lock_interruptible(dev);
+	if (err)
+		goto err_out_fence;
+
+	if (!i915_gem_context_use_trtt(ctx)) {
+		err = -ENODEV;
+		goto err_unlock;
+	}
+
+	err = trtt_prepare(ctx, tiles, args->count);
+	if (err)
+		goto err_unlock;
+
+	intel_runtime_pm_get(i915);
+
+	rq = i915_request_alloc(i915->engine[RCS], ctx);
+	if (IS_ERR(rq)) {
+		err = PTR_ERR(rq);
+		goto err_rpm;
+	}
+
+	if (in_fence) {
+		err = i915_request_await_dma_fence(rq, in_fence);
+		if (err < 0)
+			goto err_request;
+	}
+
+	for (i = 0; i < args->count; i++) {
+		err = trtt_emit_tile(rq, &tiles[i]);
+		if (err)
+			goto err_request;
+	}
+
+	/* Flush the stores and drop any stale translations */
+	err = rq->engine->emit_flush(rq, EMIT_FLUSH | EMIT_INVALIDATE);
+	if (err)
+		goto err_request;
+
+	if (out_fence_fd != -1) {
+		out_fence = sync_file_create(&rq->fence);
+		if (!out_fence)
+			err = -ENOMEM;
+	}
+
+err_request:
+	i915_request_add(rq);
+err_rpm:
+	intel_runtime_pm_put(i915);
+err_unlock:
+	mutex_unlock(&dev->struct_mutex);
+	if (out_fence) {
+		if (err == 0) {
+			fd_install(out_fence_fd, out_fence->file);
+			args->fence = out_fence_fd;
+			out_fence_fd = -1;
+		} else {
+			fput(out_fence->file);
+		}
+	}
+err_out_fence:
+	if (out_fence_fd != -1)
+		put_unused_fd(out_fence_fd);
+err_in_fence:
+	dma_fence_put(in_fence);
+err_ctx:
+	i915_gem_context_put(ctx);
+err_tiles:
+	kvfree(tiles);
+	return err;
+}
+
 int i915_gem_context_reset_stats_ioctl(struct drm_device *dev,
 				       void *data, struct drm_file *file)
 {
@@ -25,6 +25,7 @@
 #ifndef __I915_GEM_CONTEXT_H__
 #define __I915_GEM_CONTEXT_H__
 
+#include <linux/average.h>
 #include <linux/bitops.h>
 #include <linux/list.h>
 #include <linux/radix-tree.h>
@@ -39,6 +40,7 @@ struct drm_file;
 
 struct drm_i915_private;
 struct drm_i915_file_private;
+struct drm_i915_mocs_entry;
 struct i915_hw_ppgtt;
 struct i915_request;
 struct i915_vma;
@@ -53,6 +55,9 @@ struct intel_context_ops {
 	void (*destroy)(struct intel_context *ce);
 };
 
+DECLARE_EWMA(spin, 4, 8)
+DECLARE_EWMA(runtime, 4, 8)
+
 /**
  * struct i915_gem_context - client state
  *
@@ -127,6 +132,8 @@ struct i915_gem_context {
 #define CONTEXT_BANNED			4
 #define CONTEXT_FORCE_SINGLE_SUBMISSION	5
 #define CONTEXT_USE_TRTT		6
+#define CONTEXT_STATELESS		7
+#define CONTEXT_EXPLICIT_COHERENCY	8
 
 	/**
 	 * @hw_id: - unique identifier for the context
@@ -135,8 +142,15 @@ struct i915_gem_context {
 	 * functions like fault reporting, PASID, scheduling. The
 	 * &drm_i915_private.context_hw_ida is used to assign a unqiue
 	 * id for the lifetime of the context.
+	 *
+	 * However, the id space is small (only 2048 ids on gen11), so whilst
+	 * the context is not pinned on any engine, its id may be reassigned
+	 * to another context and a new one is then allocated on its next pin
+	 * (see i915_gem_context_pin_hw_id()).
 	 */
 	unsigned int hw_id;
+	unsigned int hw_id_pin_count;
+	struct list_head hw_id_link;
 
 	/**
 	 * @user_handle: userspace identifier
@@ -148,6 +162,55 @@ struct i915_gem_context {
 
 	struct i915_sched_attr sched;
 
+	/**
+	 * @deadline: default deadline, in ns from submission, given to
+	 * each request of the context (0 for none)
+	 */
+	u64 deadline;
+
+	/**
+	 * @freq_hint: frequency bounds (in hw units, 0 for none) requested
+	 * for while the context is running, see I915_CONTEXT_PARAM_FREQUENCY
+	 */
+	struct {
+		u8 min;
+		u8 max;
+	} freq_hint;
+
+	/**
+	 * @seqno_vma: page into which each engine writes the fence seqno
+	 * of our requests as they complete, see I915_CONTEXT_PARAM_SEQNO_PAGE
+	 */
+	struct i915_vma *seqno_vma;
+#define I915_CONTEXT_SEQNO_SLOT(engine) \
+	((engine)->uabi_class * 16 + (engine)->instance)
+
+	/**
+	 * @spin: how long to busywait upon our requests before sleeping,
+	 * see I915_CONTEXT_PARAM_SPIN. The estimate and counters are
+	 * updated as each waited upon request is retired.
+	 */
+	struct {
+		struct ewma_spin avg_us; /* time spent waiting */
+		unsigned long hits; /* completed whilst spinning */
+		unsigned long misses; /* had to sleep */
+		bool adaptive;
+	} spin;
+
+	/**
+	 * @runtime_us: average time our requests take to execute, from the
+	 * CS starting them to their completion, used to predict whether a
+	 * waitboost would take effect in time to be of any use
+	 */
+	struct ewma_runtime runtime_us;
+
+	/**
+	 * @watchdog_percentile: percentile of the recent runtimes used to
+	 * derive the watchdog threshold, see
+	 * I915_CONTEXT_PARAM_WATCHDOG_ADAPTIVE. 0 for the fixed threshold.
+	 */
+	u8 watchdog_percentile;
+
 	/** engine: per-engine logical HW state */
 	struct intel_context {
 		struct i915_gem_context *gem_context;
@@ -156,10 +219,44 @@ struct i915_gem_context {
 		u32 *lrc_reg_state;
 		u64 lrc_desc;
 		int pin_count;
+		/** oa_config_seqno: generation of the OA config in the image */
+		u32 oa_config_seqno;
+		/** pin_link: link in i915->contexts.pin_lru, if kept pinned */
+		struct list_head pin_link;
 		/** watchdog_threshold: hw watchdog threshold value,
 		 * in clock counts
 		 */
 		u32 watchdog_threshold;
+		/** preempted: last switched out with its request incomplete,
+		 * so the image holds live engine state that must be restored
+		 * (see I915_CONTEXT_PARAM_STATELESS). Only updated from the
+		 * engine's submission tasklet.
+		 */
+		bool preempted;
+
+		/**
+		 * runtime_hist: log2 histogram of the runtimes, in us, of
+		 * the recent requests of the context on the engine, from
+		 * which the adaptive watchdog threshold is picked. Only
+		 * updated from the engine's submission tasklet.
+		 */
+		struct intel_context_runtime_hist {
+#define INTEL_RUNTIME_BUCKETS 32
+#define INTEL_RUNTIME_HISTORY 256
+			u16 bucket[INTEL_RUNTIME_BUCKETS];
+			u16 count;
+		} runtime_hist;
+
+		/**
+		 * stats: time spent submitted to the engine, accumulated
+		 * between each schedule-in and schedule-out of the context.
+		 */
+		struct intel_context_stats {
+			seqlock_t lock;
+			unsigned int active;
+			ktime_t start;
+			ktime_t total;
+		} stats;
 
 		const struct intel_context_ops *ops;
 	} __engine[I915_NUM_ENGINES];
@@ -174,8 +271,20 @@ struct i915_gem_context {
 		u64 l3_table_address;
 		u64 segment_base_addr;
 		struct i915_vma *vma;
+
+		/**
+		 * @tables: The L2 and L1 tables managed by the kernel for
+		 * DRM_I915_GEM_CONTEXT_TRTT_BIND, see trtt_table_key().
+		 */
+		struct radix_tree_root tables;
 	} trtt_info;
 
+	/**
+	 * @mocs: The render engine MOCS table installed by userspace, see
+	 * I915_CONTEXT_PARAM_MOCS, or NULL for the platform table.
+	 */
+	struct drm_i915_mocs_entry *mocs;
+
 	/** ring_size: size for allocating the per-engine ring buffer */
 	u32 ring_size;
 	/** desc_template: invariant fields for the HW context descriptor */
@@ -208,8 +317,59 @@ struct i915_gem_context {
 	 * context close.
 	 */
 	struct list_head handles_list;
+
+	/**
+	 * @handles_gen: generation of @handles_vma, advanced whenever a
+	 * handle is removed from the lookup so that any cached vma pointers
+	 * (e.g. in the @resident_sets) can be discarded.
+	 */
+	unsigned int handles_gen;
+
+	/**
+	 * @resident_sets: idr of registered execobject lists, see
+	 * I915_EXEC_RESIDENT_SET.
+	 */
+	struct idr resident_sets;
 };
 
+/**
+ * struct i915_resident_set - cached handle to vma lookup for execbuf
+ *
+ * A resident set records the result of looking up each handle of a
+ * userspace execobject[] in the context's &i915_gem_context.handles_vma,
+ * so that repeated submission of the same object list is able to skip
+ * the radixtree walk. The cached vma are only valid for as long as
+ * @gen matches &i915_gem_context.handles_gen.
+ */
+struct i915_resident_set {
+	unsigned int count;
+	unsigned int gen;
+	u32 *handles;
+	struct i915_vma *vma[];
+};
+
+int i915_gem_context_pin_hw_id(struct i915_gem_context *ctx);
+
+void intel_context_pin_cache_add(struct intel_context *ce);
+bool i915_gem_contexts_unpin_cached(struct drm_i915_private *i915);
+
+static inline void intel_context_pin_cache_touch(struct intel_context *ce)
+{
+	if (!list_empty(&ce->pin_link))
+		list_move_tail(&ce->pin_link,
+			       &ce->gem_context->i915->contexts.pin_lru);
+}
+
+ktime_t intel_context_get_busy_time(struct intel_context *ce);
+ktime_t i915_gem_context_get_busy_time(struct i915_gem_context *ctx);
+u64 i915_gem_client_busy_time(struct drm_i915_file_private *file_priv);
+
+static inline void i915_gem_context_unpin_hw_id(struct i915_gem_context *ctx)
+{
+	GEM_BUG_ON(!ctx->hw_id_pin_count);
+	ctx->hw_id_pin_count--;
+}
+
 static inline bool i915_gem_context_is_closed(const struct i915_gem_context *ctx)
 {
 	return test_bit(CONTEXT_CLOSED, &ctx->flags);
@@ -281,6 +441,39 @@ static inline void i915_gem_context_set_trtt(struct i915_gem_context *ctx)
 	__set_bit(CONTEXT_USE_TRTT, &ctx->flags);
 }
 
+static inline bool i915_gem_context_is_stateless(const struct i915_gem_context *ctx)
+{
+	return test_bit(CONTEXT_STATELESS, &ctx->flags);
+}
+
+static inline void i915_gem_context_set_stateless(struct i915_gem_context *ctx)
+{
+	__set_bit(CONTEXT_STATELESS, &ctx->flags);
+}
+
+static inline void i915_gem_context_clear_stateless(struct i915_gem_context *ctx)
+{
+	__clear_bit(CONTEXT_STATELESS, &ctx->flags);
+}
+
+static inline bool
+i915_gem_context_is_explicit_coherency(const struct i915_gem_context *ctx)
+{
+	return test_bit(CONTEXT_EXPLICIT_COHERENCY, &ctx->flags);
+}
+
+static inline void
+i915_gem_context_set_explicit_coherency(struct i915_gem_context *ctx)
+{
+	__set_bit(CONTEXT_EXPLICIT_COHERENCY, &ctx->flags);
+}
+
+static inline void
+i915_gem_context_clear_explicit_coherency(struct i915_gem_context *ctx)
+{
+	__clear_bit(CONTEXT_EXPLICIT_COHERENCY, &ctx->flags);
+}
+
 static inline bool i915_gem_context_is_default(const struct i915_gem_context *c)
 {
 	return c->user_handle == DEFAULT_CONTEXT_HANDLE;
@@ -344,6 +537,8 @@ int i915_gem_context_getparam_ioctl(struct drm_device *dev, void *data,
 				    struct drm_file *file_priv);
 int i915_gem_context_setparam_ioctl(struct drm_device *dev, void *data,
 				    struct drm_file *file_priv);
+int i915_gem_context_trtt_bind_ioctl(struct drm_device *dev, void *data,
+				     struct drm_file *file);
 int i915_gem_context_reset_stats_ioctl(struct drm_device *dev, void *data,
 				       struct drm_file *file);
 
@@ -25,6 +25,7 @@
  */
 
 #include <linux/dma-buf.h>
+#include <linux/pci.h>
 #include <linux/reservation.h>
 
 #include <drm/drmP.h>
@@ -36,28 +37,145 @@ static struct drm_i915_gem_object *dma_buf_to_obj(struct dma_buf *buf)
 	return to_intel_bo(buf->priv);
 }
 
-static struct sg_table *i915_gem_map_dma_buf(struct dma_buf_attachment *attachment,
-					     enum dma_data_direction dir)
+/*
+ * Importers such as capture and network devices tend to map and unmap
+ * their attachment around every frame. Rather than build and DMA map a
+ * fresh copy of our sg_table each time, we keep the mapping of each
+ * attachment cached from its first use until it is detached, and merely
+ * sync it for the device/cpu around each use. The cached mapping holds a
+ * pin on our pages so that the backing store cannot move underneath it.
+ */
+struct i915_dmabuf_attachment {
+	struct mutex lock;
+	struct sg_table st;
+	enum dma_data_direction dir;
+	bool mapped;
+	bool busy;
+};
+
+/*
+ * Objects that have no struct pages of their own (i.e. those in stolen
+ * memory) cannot be exported as a list of system pages. However, a PCI
+ * peer can reach them directly through our aperture BAR, so for such an
+ * importer we pin the object into the mappable GGTT and hand out the bus
+ * address of that window, letting the two devices stream to each other
+ * without bouncing through system memory. The aperture is a scarce
+ * resource, so unlike the page mappings these are never cached on the
+ * attachment and the pin is only held from map_dma_buf to unmap_dma_buf.
+ * For as long as the peer may access the BAR, we must also keep the device
+ * awake, and so hold a runtime pm wakeref across the same span.
+ */
+static bool use_p2p(struct dma_buf_attachment *attachment)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
+
+	return dev_is_pci(attachment->dev) &&
+		!i915_gem_object_has_struct_page(obj);
+}
+
+static bool is_p2p(const struct sg_table *st)
+{
+	return !sg_page(st->sgl);
+}
+
+static struct sg_table *
+map_dma_buf_p2p(struct dma_buf_attachment *attachment,
+		struct sg_table *st,
+		enum dma_data_direction dir)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	struct i915_vma *vma;
+	dma_addr_t addr;
+	int ret;
+
+	intel_runtime_pm_get(i915);
+
+	ret = i915_mutex_lock_interruptible(&i915->drm);
+	if (ret)
+		goto err_rpm;
+
+	vma = i915_gem_object_ggtt_pin(obj, NULL, 0, 0, PIN_MAPPABLE);
+	if (IS_ERR(vma)) {
+		ret = PTR_ERR(vma);
+		goto err_unlock;
+	}
+
+	ret = i915_gem_object_set_to_gtt_domain(obj, true);
+	if (ret)
+		goto err_unpin;
+
+	ret = sg_alloc_table(st, 1, GFP_KERNEL);
+	if (ret)
+		goto err_unpin;
+
+	addr = dma_map_resource(attachment->dev,
+				i915->ggtt.gmadr.start + vma->node.start,
+				vma->size, dir, 0);
+	if (dma_mapping_error(attachment->dev, addr)) {
+		ret = -ENOMEM;
+		goto err_free_sg;
+	}
+
+	sg_dma_address(st->sgl) = addr;
+	sg_dma_len(st->sgl) = vma->size;
+
+	mutex_unlock(&i915->drm.struct_mutex);
+	return st;
+
+err_free_sg:
+	sg_free_table(st);
+err_unpin:
+	i915_vma_unpin(vma);
+err_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+err_rpm:
+	intel_runtime_pm_put(i915);
+	return ERR_PTR(ret);
+}
+
+static void unmap_dma_buf_p2p(struct dma_buf_attachment *attachment,
+			      struct sg_table *st,
+			      enum dma_data_direction dir)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	struct i915_vma *vma;
+
+	dma_unmap_resource(attachment->dev,
+			   sg_dma_address(st->sgl), sg_dma_len(st->sgl),
+			   dir, 0);
+	sg_free_table(st);
+
+	mutex_lock(&i915->drm.struct_mutex);
+	vma = i915_vma_instance(obj, &i915->ggtt.vm, NULL);
+	GEM_BUG_ON(IS_ERR(vma) || !i915_vma_is_pinned(vma));
+	i915_vma_unpin(vma);
+	mutex_unlock(&i915->drm.struct_mutex);
+
+	intel_runtime_pm_put(i915);
+}
+
+static struct sg_table *
+__i915_gem_map_dma_buf(struct dma_buf_attachment *attachment,
+		       struct sg_table *st,
+		       enum dma_data_direction dir)
 {
 	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
-	struct sg_table *st;
 	struct scatterlist *src, *dst;
 	int ret, i;
 
+	if (use_p2p(attachment))
+		return map_dma_buf_p2p(attachment, st, dir);
+
 	ret = i915_gem_object_pin_pages(obj);
 	if (ret)
 		goto err;
 
 	/* Copy sg so that we make an independent mapping */
-	st = kmalloc(sizeof(struct sg_table), GFP_KERNEL);
-	if (st == NULL) {
-		ret = -ENOMEM;
-		goto err_unpin_pages;
-	}
-
 	ret = sg_alloc_table(st, obj->mm.pages->nents, GFP_KERNEL);
 	if (ret)
-		goto err_free;
+		goto err_unpin_pages;
 
 	src = obj->mm.pages->sgl;
 	dst = st->sgl;
@@ -76,25 +194,128 @@ static struct sg_table *i915_gem_map_dma_buf(struct dma_buf_attachment *attachme
 
 err_free_sg:
 	sg_free_table(st);
-err_free:
-	kfree(st);
 err_unpin_pages:
 	i915_gem_object_unpin_pages(obj);
 err:
 	return ERR_PTR(ret);
 }
 
+static void __i915_gem_unmap_dma_buf(struct dma_buf_attachment *attachment,
+				     struct sg_table *st,
+				     enum dma_data_direction dir)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
+
+	if (is_p2p(st)) {
+		unmap_dma_buf_p2p(attachment, st, dir);
+		return;
+	}
+
+	dma_unmap_sg(attachment->dev, st->sgl, st->nents, dir);
+	sg_free_table(st);
+
+	i915_gem_object_unpin_pages(obj);
+}
+
+static int i915_gem_dmabuf_attach(struct dma_buf *dma_buf,
+				  struct dma_buf_attachment *attachment)
+{
+	struct i915_dmabuf_attachment *cache;
+
+	cache = kzalloc(sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return -ENOMEM;
+
+	mutex_init(&cache->lock);
+	attachment->priv = cache;
+
+	return 0;
+}
+
+static void i915_gem_dmabuf_detach(struct dma_buf *dma_buf,
+				   struct dma_buf_attachment *attachment)
+{
+	struct i915_dmabuf_attachment *cache = attachment->priv;
+
+	GEM_BUG_ON(cache->busy);
+	if (cache->mapped)
+		__i915_gem_unmap_dma_buf(attachment, &cache->st, cache->dir);
+
+	mutex_destroy(&cache->lock);
+	kfree(cache);
+}
+
+static struct sg_table *i915_gem_map_dma_buf(struct dma_buf_attachment *attachment,
+					     enum dma_data_direction dir)
+{
+	struct i915_dmabuf_attachment *cache = attachment->priv;
+	struct sg_table *st, *sg;
+
+	mutex_lock(&cache->lock);
+
+	if (cache->busy) {
+		/* Concurrent mappings of one attachment each get their own */
+		mutex_unlock(&cache->lock);
+		goto uncached;
+	}
+
+	if (cache->mapped && cache->dir != dir) {
+		__i915_gem_unmap_dma_buf(attachment, &cache->st, cache->dir);
+		cache->mapped = false;
+	}
+
+	if (cache->mapped) {
+		dma_sync_sg_for_device(attachment->dev,
+				       cache->st.sgl, cache->st.nents, dir);
+		st = &cache->st;
+	} else {
+		st = __i915_gem_map_dma_buf(attachment, &cache->st, dir);
+		if (!IS_ERR(st)) {
+			cache->dir = dir;
+			cache->mapped = true;
+		}
+	}
+	cache->busy = !IS_ERR(st);
+
+	mutex_unlock(&cache->lock);
+	return st;
+
+uncached:
+	st = kmalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return ERR_PTR(-ENOMEM);
+
+	sg = __i915_gem_map_dma_buf(attachment, st, dir);
+	if (IS_ERR(sg))
+		kfree(st);
+
+	return sg;
+}
+
 static void i915_gem_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				   struct sg_table *sg,
 				   enum dma_data_direction dir)
 {
-	struct drm_i915_gem_object *obj = dma_buf_to_obj(attachment->dmabuf);
+	struct i915_dmabuf_attachment *cache = attachment->priv;
 
-	dma_unmap_sg(attachment->dev, sg->sgl, sg->nents, dir);
-	sg_free_table(sg);
-	kfree(sg);
+	if (sg != &cache->st) {
+		__i915_gem_unmap_dma_buf(attachment, sg, dir);
+		kfree(sg);
+		return;
+	}
 
-	i915_gem_object_unpin_pages(obj);
+	mutex_lock(&cache->lock);
+	GEM_BUG_ON(!cache->busy);
+	if (is_p2p(sg)) {
+		/* Release the aperture rather than hold it until detach */
+		__i915_gem_unmap_dma_buf(attachment, sg, dir);
+		cache->mapped = false;
+	} else {
+		/* Keep the mapping for next time, hand ownership back to us */
+		dma_sync_sg_for_cpu(attachment->dev, sg->sgl, sg->nents, dir);
+	}
+	cache->busy = false;
+	mutex_unlock(&cache->lock);
 }
 
 static void *i915_gem_dmabuf_vmap(struct dma_buf *dma_buf)
@@ -156,6 +377,13 @@ static int i915_gem_dmabuf_mmap(struct dma_buf *dma_buf, struct vm_area_struct *
 	if (!obj->base.filp)
 		return -ENODEV;
 
+	/* As for a GTT mmap, see drm_gem_mmap() */
+	if (i915_gem_object_is_readonly(obj)) {
+		if (vma->vm_flags & VM_WRITE)
+			return -EINVAL;
+		vma->vm_flags &= ~VM_MAYWRITE;
+	}
+
 	ret = call_mmap(obj->base.filp, vma);
 	if (ret)
 		return ret;
@@ -211,10 +439,22 @@ static int i915_gem_end_cpu_access(struct dma_buf *dma_buf, enum dma_data_direct
 	return err;
 }
 
+static void i915_gem_dmabuf_release(struct dma_buf *dma_buf)
+{
+	struct drm_i915_gem_object *obj = dma_buf_to_obj(dma_buf);
+
+	if (obj->ops->dmabuf_release)
+		obj->ops->dmabuf_release(obj, dma_buf);
+
+	drm_gem_dmabuf_release(dma_buf);
+}
+
 static const struct dma_buf_ops i915_dmabuf_ops =  {
+	.attach = i915_gem_dmabuf_attach,
+	.detach = i915_gem_dmabuf_detach,
 	.map_dma_buf = i915_gem_map_dma_buf,
 	.unmap_dma_buf = i915_gem_unmap_dma_buf,
-	.release = drm_gem_dmabuf_release,
+	.release = i915_gem_dmabuf_release,
 	.map = i915_gem_dmabuf_kmap,
 	.unmap = i915_gem_dmabuf_kunmap,
 	.mmap = i915_gem_dmabuf_mmap,
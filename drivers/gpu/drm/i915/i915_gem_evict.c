@@ -78,6 +78,46 @@ static int ggtt_flush(struct drm_i915_private *i915)
 	return 0;
 }
 
+static int evict_vma(struct i915_vma *vma)
+{
+	struct i915_address_space *vm = vma->vm;
+	u64 size = vma->node.size;
+	int ret;
+
+	ret = i915_vma_unbind(vma);
+	if (ret == 0) {
+		vm->evictions.vmas++;
+		vm->evictions.bytes += size;
+	}
+
+	return ret;
+}
+
+/*
+ * How many more candidates to scan after the first suitable hole, looking
+ * for one that is cheaper to evict.
+ */
+#define EVICT_SCAN_BUDGET 32
+
+/* Costs are in units of pages to rebind */
+#define EVICT_COST_FENCE 16
+#define EVICT_COST_ACTIVE BIT_ULL(20)
+
+static u64 evict_cost(const struct drm_mm_node *node)
+{
+	struct i915_vma *vma = container_of(node, struct i915_vma, node);
+	u64 cost = node->size >> PAGE_SHIFT;
+
+	/* Unbinding waits for the GPU, or takes a scanout away from it */
+	if (i915_vma_is_active(vma) || vma->obj->pin_global)
+		cost += EVICT_COST_ACTIVE;
+
+	if (vma->fence)
+		cost += EVICT_COST_FENCE;
+
+	return cost;
+}
+
 static bool
 mark_free(struct drm_mm_scan *scan,
 	  struct i915_vma *vma,
@@ -139,6 +179,7 @@ i915_gem_evict_something(struct i915_address_space *vm,
 
 	lockdep_assert_held(&vm->i915->drm.struct_mutex);
 	trace_i915_gem_evict(vm, min_size, alignment, flags);
+	vm->evictions.calls++;
 
 	/*
 	 * The goal is to evict objects and amalgamate space in LRU order.
@@ -151,7 +192,10 @@ i915_gem_evict_something(struct i915_address_space *vm,
 	 *   2. Active objects (will stall on unbinding)
 	 *
 	 * On each list, the oldest objects lie at the HEAD with the freshest
-	 * object on the TAIL.
+	 * object on the TAIL. Retirement order does not tell us which of the
+	 * idle objects are reused by every execbuf though, so the inactive
+	 * list is instead kept in order of when each vma was last used, see
+	 * i915_vma_move_to_inactive().
 	 */
 	mode = DRM_MM_INSERT_BEST;
 	if (flags & PIN_HIGH)
@@ -161,6 +205,7 @@ i915_gem_evict_something(struct i915_address_space *vm,
 	drm_mm_scan_init_with_range(&scan, &vm->mm,
 				    min_size, alignment, cache_level,
 				    start, end, mode);
+	drm_mm_scan_set_cost(&scan, evict_cost, EVICT_SCAN_BUDGET);
 
 	/*
 	 * Retire before we search the active list. Although we have
@@ -182,6 +227,10 @@ i915_gem_evict_something(struct i915_address_space *vm,
 				goto found;
 	} while (*++phase);
 
+	/* Ran out of candidates while looking for a cheaper hole */
+	if (drm_mm_scan_found(&scan))
+		goto found;
+
 	/* Nothing found, clean up and bail out! */
 	list_for_each_entry_safe(vma, next, &eviction_list, evict_link) {
 		ret = drm_mm_scan_remove_block(&scan, &vma->node);
@@ -194,8 +243,19 @@ i915_gem_evict_something(struct i915_address_space *vm,
 	 * such as scanouts, rinbuffers and contexts, we can skip the
 	 * purge when inspecting per-process local address spaces.
 	 */
-	if (!i915_is_ggtt(vm) || flags & PIN_NONBLOCK)
+	if (!i915_is_ggtt(vm) || flags & PIN_NONBLOCK) {
+		vm->evictions.failures++;
 		return -ENOSPC;
+	}
+
+	/*
+	 * Idle contexts may be held pinned just in case they are reused;
+	 * release them before resorting to idling the GPU.
+	 */
+	if (i915_gem_contexts_unpin_cached(dev_priv)) {
+		i915_retire_requests(dev_priv);
+		goto search_again;
+	}
 
 	/*
 	 * Not everything in the GGTT is tracked via VMA using
@@ -227,7 +287,11 @@ i915_gem_evict_something(struct i915_address_space *vm,
 	 * back to userspace to give our workqueues time to
 	 * acquire our locks and unpin the old scanouts.
 	 */
-	return intel_has_pending_fb_unpin(dev_priv) ? -EAGAIN : -ENOSPC;
+	if (intel_has_pending_fb_unpin(dev_priv))
+		return -EAGAIN;
+
+	vm->evictions.failures++;
+	return -ENOSPC;
 
 found:
 	/* drm_mm doesn't allow any other other operations while
@@ -248,12 +312,12 @@ i915_gem_evict_something(struct i915_address_space *vm,
 	list_for_each_entry_safe(vma, next, &eviction_list, evict_link) {
 		__i915_vma_unpin(vma);
 		if (ret == 0)
-			ret = i915_vma_unbind(vma);
+			ret = evict_vma(vma);
 	}
 
 	while (ret == 0 && (node = drm_mm_scan_color_evict(&scan))) {
 		vma = container_of(node, struct i915_vma, node);
-		ret = i915_vma_unbind(vma);
+		ret = evict_vma(vma);
 	}
 
 	return ret;
@@ -369,7 +433,7 @@ int i915_gem_evict_for_node(struct i915_address_space *vm,
 	list_for_each_entry_safe(vma, next, &eviction_list, evict_link) {
 		__i915_vma_unpin(vma);
 		if (ret == 0)
-			ret = i915_vma_unbind(vma);
+			ret = evict_vma(vma);
 	}
 
 	return ret;
@@ -428,7 +492,7 @@ int i915_gem_evict_vm(struct i915_address_space *vm)
 	list_for_each_entry_safe(vma, next, &eviction_list, evict_link) {
 		__i915_vma_unpin(vma);
 		if (ret == 0)
-			ret = i915_vma_unbind(vma);
+			ret = evict_vma(vma);
 	}
 	return ret;
 }
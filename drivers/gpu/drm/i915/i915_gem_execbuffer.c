@@ -27,6 +27,7 @@
  */
 
 #include <linux/dma_remapping.h>
+#include <linux/mmu_context.h>
 #include <linux/reservation.h>
 #include <linux/sync_file.h>
 #include <linux/uaccess.h>
@@ -39,6 +40,7 @@
 #include "i915_gem_clflush.h"
 #include "i915_trace.h"
 #include "i915_aubcrash.h"
+#include "i915_aubstream.h"
 #include "intel_drv.h"
 #include "intel_frontbuffer.h"
 
@@ -241,6 +243,8 @@ struct i915_execbuffer {
 
 	struct i915_request *request; /** our request to build */
 	struct i915_vma *batch; /** identity of the batch obj/vma */
+	struct i915_vma *timestamp; /** for EXEC_OBJECT_TIMESTAMP */
+	struct i915_gang *gang; /** for I915_EXEC_VEC_GANG */
 
 	/** actual size of execobj[] as we may extend it for the cmdparser */
 	unsigned int buffer_count;
@@ -267,10 +271,15 @@ struct i915_execbuffer {
 		bool needs_unfenced : 1;
 
 		struct i915_request *rq;
+		struct i915_vma *rq_vma; /** last target added to rq */
 		u32 *rq_cmd;
 		unsigned int rq_size;
+		unsigned int rq_max; /** capacity of rq_cmd in dwords */
 	} reloc_cache;
 
+	/** serialises updates to flags[] from parallel relocation workers */
+	spinlock_t flags_lock;
+
 	u64 invalid_flags; /** Set of execobj.flags that are invalid */
 	u32 context_flags; /** Set of execobj.flags to insert from the ctx */
 
@@ -470,6 +479,37 @@ eb_validate_vma(struct i915_execbuffer *eb,
 		entry->pad_to_size = 0;
 	}
 
+	/*
+	 * A sparse object is only populated for the range of pages named by
+	 * rsvd2, and relocations could point anywhere, so forbid them.
+	 */
+	if (entry->flags & EXEC_OBJECT_SPARSE) {
+		u32 first = lower_32_bits(entry->rsvd2);
+		u32 count = upper_32_bits(entry->rsvd2);
+
+		if (unlikely(entry->relocation_count))
+			return -EINVAL;
+
+		if (unlikely(!count ||
+			     range_overflows_t(u64, first, count,
+					       vma->obj->base.size >> PAGE_SHIFT)))
+			return -EINVAL;
+	}
+
+	if (entry->flags & EXEC_OBJECT_TIMESTAMP) {
+		if (unlikely(eb->timestamp ||
+			     entry->flags & EXEC_OBJECT_SPARSE))
+			return -EINVAL;
+
+		if (unlikely(!IS_ALIGNED(entry->rsvd2, sizeof(u64)) ||
+			     range_overflows_t(u64, entry->rsvd2,
+					       2 * sizeof(u64),
+					       vma->obj->base.size)))
+			return -EINVAL;
+
+		entry->flags |= EXEC_OBJECT_WRITE;
+	}
+
 	if (unlikely(vma->exec_flags)) {
 		DRM_DEBUG("Object [handle %d, index %d] appears more than once in object list\n",
 			  entry->handle, (int)(entry - eb->exec));
@@ -553,6 +593,9 @@ eb_add_vma(struct i915_execbuffer *eb,
 		eb->batch = vma;
 	}
 
+	if (entry->flags & EXEC_OBJECT_TIMESTAMP)
+		eb->timestamp = vma;
+
 	err = 0;
 	if (eb_pin_vma(eb, entry, vma)) {
 		if (entry->offset != vma->node.start) {
@@ -617,11 +660,25 @@ static int eb_reserve_vma(const struct i915_execbuffer *eb,
 		pin_flags |= BATCH_OFFSET_BIAS | PIN_OFFSET_BIAS;
 	}
 
+	/* Only reserve the range on binding, see eb_bind_sparse() */
+	if (exec_flags & EXEC_OBJECT_SPARSE &&
+	    !drm_mm_node_allocated(&vma->node))
+		vma->flags |= I915_VMA_SPARSE;
+
+	/*
+	 * Our request will wait for the PTEs to be written, there is no
+	 * need for us to wait as well.
+	 */
+	vma->flags |= I915_VMA_ASYNC_BIND;
 	err = i915_vma_pin(vma,
 			   entry->pad_to_size, entry->alignment,
 			   pin_flags);
-	if (err)
+	vma->flags &= ~I915_VMA_ASYNC_BIND;
+	if (err) {
+		if (!drm_mm_node_allocated(&vma->node))
+			vma->flags &= ~I915_VMA_SPARSE;
 		return err;
+	}
 
 	if (entry->offset != vma->node.start) {
 		entry->offset = vma->node.start | UPDATE;
@@ -743,9 +800,29 @@ static int eb_select_context(struct i915_execbuffer *eb)
 	return 0;
 }
 
-static int eb_lookup_vmas(struct i915_execbuffer *eb)
+static struct i915_resident_set *
+eb_lookup_resident_set(const struct i915_execbuffer *eb)
+{
+	struct i915_resident_set *set;
+
+	if (!eb->args->DR1)
+		return NULL;
+
+	set = idr_find(&eb->ctx->resident_sets, eb->args->DR1);
+	if (unlikely(!set))
+		return ERR_PTR(-ENOENT);
+
+	/* Any handle closed since registration may have freed its vma */
+	if (set->gen != eb->ctx->handles_gen || set->count != eb->buffer_count)
+		return NULL;
+
+	return set;
+}
+
+static int __eb_lookup_vmas(struct i915_execbuffer *eb)
 {
 	struct radix_tree_root *handles_vma = &eb->ctx->handles_vma;
+	struct i915_resident_set *set = NULL;
 	struct drm_i915_gem_object *obj;
 	unsigned int i, batch;
 	int err;
@@ -756,6 +833,12 @@ static int eb_lookup_vmas(struct i915_execbuffer *eb)
 	if (unlikely(i915_gem_context_is_banned(eb->ctx)))
 		return -EIO;
 
+	if (eb->args->flags & I915_EXEC_RESIDENT_SET) {
+		set = eb_lookup_resident_set(eb);
+		if (IS_ERR(set))
+			return PTR_ERR(set);
+	}
+
 	INIT_LIST_HEAD(&eb->relocs);
 	INIT_LIST_HEAD(&eb->unbound);
 
@@ -766,6 +849,11 @@ static int eb_lookup_vmas(struct i915_execbuffer *eb)
 		struct i915_lut_handle *lut;
 		struct i915_vma *vma;
 
+		if (set && likely(set->handles[i] == handle)) {
+			vma = set->vma[i];
+			goto add_vma;
+		}
+
 		vma = radix_tree_lookup(handles_vma, handle);
 		if (likely(vma))
 			goto add_vma;
@@ -823,6 +911,18 @@ static int eb_lookup_vmas(struct i915_execbuffer *eb)
 	return err;
 }
 
+static int eb_lookup_vmas(struct i915_execbuffer *eb)
+{
+	int err;
+
+	/* Invalidate the GGTT TLB once for all the objects we bind */
+	i915_ggtt_defer_invalidate(eb->i915);
+	err = __eb_lookup_vmas(eb);
+	i915_ggtt_flush_invalidate(eb->i915);
+
+	return err;
+}
+
 static struct i915_vma *
 eb_get_vma(const struct i915_execbuffer *eb, unsigned long handle)
 {
@@ -843,6 +943,101 @@ eb_get_vma(const struct i915_execbuffer *eb, unsigned long handle)
 	}
 }
 
+static int eb_bind_sparse(struct i915_execbuffer *eb)
+{
+	const unsigned int count = eb->buffer_count;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		struct drm_i915_gem_exec_object2 *entry = &eb->exec[i];
+		struct i915_vma *vma = eb->vma[i];
+		u64 offset, length;
+
+		if (likely(!(vma->flags & I915_VMA_SPARSE)))
+			continue;
+
+		/*
+		 * The vma may have been left sparse by an earlier execbuf,
+		 * in which case an ordinary user expects all of it.
+		 */
+		if (eb->flags[i] & EXEC_OBJECT_SPARSE) {
+			offset = (u64)lower_32_bits(entry->rsvd2) << PAGE_SHIFT;
+			length = (u64)upper_32_bits(entry->rsvd2) << PAGE_SHIFT;
+		} else {
+			offset = 0;
+			length = vma->obj->base.size;
+		}
+
+		err = i915_vma_sparse_bind(vma, offset, length);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static bool eb_resident_set_is_stale(const struct i915_execbuffer *eb)
+{
+	struct i915_resident_set *set;
+
+	set = idr_find(&eb->ctx->resident_sets, eb->args->DR1);
+	if (!set)
+		return false;
+
+	return set->gen != eb->ctx->handles_gen ||
+	       set->count != eb->buffer_count;
+}
+
+/*
+ * Record the vma just looked up for execobject[] as a new resident set, or
+ * in place of the registered set given by DR1 should that have gone stale,
+ * so that a stale set is not kept around, unusable, until context close.
+ */
+static int eb_register_resident_set(struct i915_execbuffer *eb)
+{
+	const unsigned int count = eb->args->buffer_count;
+	struct i915_resident_set *set;
+	unsigned int i;
+	int id;
+
+	set = kvmalloc(sizeof(*set) +
+		       count * (sizeof(*set->vma) + sizeof(*set->handles)),
+		       GFP_KERNEL);
+	if (!set)
+		return -ENOMEM;
+
+	set->count = count;
+	set->gen = eb->ctx->handles_gen;
+	set->handles = (u32 *)(set->vma + count);
+	for (i = 0; i < count; i++) {
+		set->handles[i] = eb->exec[i].handle;
+		set->vma[i] = eb->vma[i];
+	}
+
+	if (eb->args->DR1) {
+		struct i915_resident_set *old;
+
+		old = idr_replace(&eb->ctx->resident_sets, set, eb->args->DR1);
+		if (IS_ERR(old)) {
+			kvfree(set);
+			return PTR_ERR(old);
+		}
+
+		kvfree(old);
+		return 0;
+	}
+
+	id = idr_alloc(&eb->ctx->resident_sets, set, 1, 0, GFP_KERNEL);
+	if (id < 0) {
+		kvfree(set);
+		return id;
+	}
+
+	eb->args->DR1 = id;
+	return 0;
+}
+
 static void eb_release_vmas(const struct i915_execbuffer *eb)
 {
 	const unsigned int count = eb->buffer_count;
@@ -904,6 +1099,7 @@ static void reloc_cache_init(struct reloc_cache *cache,
 	cache->node.allocated = false;
 	cache->rq = NULL;
 	cache->rq_size = 0;
+	cache->rq_max = 0;
 }
 
 static inline void *unmask_page(unsigned long p)
@@ -927,21 +1123,30 @@ static inline struct i915_ggtt *cache_to_ggtt(struct reloc_cache *cache)
 
 static void reloc_gpu_flush(struct reloc_cache *cache)
 {
-	GEM_BUG_ON(cache->rq_size >= cache->rq->batch->obj->base.size / sizeof(u32));
+	GEM_BUG_ON(cache->rq_size >= cache->rq_max);
 	cache->rq_cmd[cache->rq_size] = MI_BATCH_BUFFER_END;
 	i915_gem_object_unpin_map(cache->rq->batch->obj);
 	i915_gem_chipset_flush(cache->rq->i915);
 
 	i915_request_add(cache->rq);
 	cache->rq = NULL;
+	cache->rq_vma = NULL;
 }
 
-static void reloc_cache_reset(struct reloc_cache *cache)
+/*
+ * The GPU relocations for the whole execbuf are accumulated into a single
+ * request (see reloc_gpu()), which must be submitted before we build the
+ * user's request or drop the struct_mutex.
+ */
+static void reloc_gpu_finish(struct reloc_cache *cache)
 {
-	void *vaddr;
-
 	if (cache->rq)
 		reloc_gpu_flush(cache);
+}
+
+static void reloc_cache_reset(struct reloc_cache *cache)
+{
+	void *vaddr;
 
 	if (!cache->vaddr)
 		return;
@@ -951,7 +1156,8 @@ static void reloc_cache_reset(struct reloc_cache *cache)
 		if (cache->vaddr & CLFLUSH_AFTER)
 			mb();
 
-		kunmap_atomic(vaddr);
+		if (vaddr) /* a primed cache may not have mapped a page yet */
+			kunmap_atomic(vaddr);
 		i915_gem_obj_finish_shmem_access((struct drm_i915_gem_object *)cache->node.mm);
 	} else {
 		wmb();
@@ -979,7 +1185,8 @@ static void *reloc_kmap(struct drm_i915_gem_object *obj,
 	void *vaddr;
 
 	if (cache->vaddr) {
-		kunmap_atomic(unmask_page(cache->vaddr));
+		if (unmask_page(cache->vaddr))
+			kunmap_atomic(unmask_page(cache->vaddr));
 	} else {
 		unsigned int flushes;
 		int err;
@@ -1004,6 +1211,24 @@ static void *reloc_kmap(struct drm_i915_gem_object *obj,
 	return vaddr;
 }
 
+/*
+ * Prepare the cache for CPU relocations into an object for which
+ * i915_gem_obj_prepare_shmem_write() has already been called (and whose
+ * pages remain pinned until the next reloc_cache_reset()). This lets the
+ * relocations be applied without requiring the struct_mutex, see
+ * eb_relocate_parallel().
+ */
+static void reloc_cache_prime_kmap(struct reloc_cache *cache,
+				   struct drm_i915_gem_object *obj,
+				   unsigned int flushes)
+{
+	GEM_BUG_ON(cache->vaddr);
+
+	cache->vaddr = flushes | KMAP;
+	cache->node.mm = (void *)obj;
+	cache->page = -1;
+}
+
 static void *reloc_iomap(struct drm_i915_gem_object *obj,
 			 struct reloc_cache *cache,
 			 unsigned long page)
@@ -1110,20 +1335,41 @@ static void clflush_write32(u32 *addr, u32 value, unsigned int flushes)
 		*addr = value;
 }
 
+#define EB_RELOC_GPU_MAX_SIZE SZ_64K
+
+static unsigned int reloc_gpu_size(const struct i915_execbuffer *eb)
+{
+	const unsigned int len = eb->reloc_cache.use_64bit_reloc ? 8 : 4;
+	const struct i915_vma *vma;
+	u64 size = 1; /* MI_BATCH_BUFFER_END */
+
+	/*
+	 * Size the batch for the worst case of every remaining relocation
+	 * being applied by the GPU, so that all the writes for the execbuf
+	 * can be emitted into one batch and serialised by one request.
+	 */
+	list_for_each_entry(vma, &eb->relocs, reloc_link) {
+		size += (u64)exec_entry(eb, vma)->relocation_count * len;
+		if (size * sizeof(u32) >= EB_RELOC_GPU_MAX_SIZE)
+			return EB_RELOC_GPU_MAX_SIZE;
+	}
+
+	return round_up(size * sizeof(u32), PAGE_SIZE);
+}
+
 static int __reloc_gpu_alloc(struct i915_execbuffer *eb,
 			     struct i915_vma *vma,
 			     unsigned int len)
 {
 	struct reloc_cache *cache = &eb->reloc_cache;
+	const unsigned int size = reloc_gpu_size(eb);
 	struct drm_i915_gem_object *obj;
 	struct i915_request *rq;
 	struct i915_vma *batch;
 	u32 *cmd;
 	int err;
 
-	GEM_BUG_ON(vma->obj->write_domain & I915_GEM_DOMAIN_CPU);
-
-	obj = i915_gem_batch_pool_get(&eb->engine->batch_pool, PAGE_SIZE);
+	obj = i915_gem_batch_pool_get(&eb->engine->batch_pool, size);
 	if (IS_ERR(obj))
 		return PTR_ERR(obj);
 
@@ -1155,12 +1401,8 @@ static int __reloc_gpu_alloc(struct i915_execbuffer *eb,
 		goto err_unpin;
 	}
 
-	err = i915_request_await_object(rq, vma->obj, true);
-	if (err)
-		goto err_request;
-
 	err = eb->engine->emit_bb_start(rq,
-					batch->node.start, PAGE_SIZE,
+					batch->node.start, size,
 					cache->gen > 5 ? 0 : I915_DISPATCH_SECURE);
 	if (err)
 		goto err_request;
@@ -1170,16 +1412,14 @@ static int __reloc_gpu_alloc(struct i915_execbuffer *eb,
 	if (err)
 		goto skip_request;
 
-	err = i915_vma_move_to_active(vma, rq, EXEC_OBJECT_WRITE);
-	if (err)
-		goto skip_request;
-
 	rq->batch = batch;
 	i915_vma_unpin(batch);
 
 	cache->rq = rq;
+	cache->rq_vma = NULL;
 	cache->rq_cmd = cmd;
 	cache->rq_size = 0;
+	cache->rq_max = size / sizeof(u32);
 
 	/* Return with batch mapping (cmd) still pinned */
 	return 0;
@@ -1195,6 +1435,24 @@ static int __reloc_gpu_alloc(struct i915_execbuffer *eb,
 	return err;
 }
 
+static int reloc_gpu_add_vma(struct reloc_cache *cache, struct i915_vma *vma)
+{
+	int err;
+
+	GEM_BUG_ON(vma->obj->write_domain & I915_GEM_DOMAIN_CPU);
+
+	err = i915_request_await_object(cache->rq, vma->obj, true);
+	if (err)
+		return err;
+
+	err = i915_vma_move_to_active(vma, cache->rq, EXEC_OBJECT_WRITE);
+	if (err)
+		return err;
+
+	cache->rq_vma = vma;
+	return 0;
+}
+
 static u32 *reloc_gpu(struct i915_execbuffer *eb,
 		      struct i915_vma *vma,
 		      unsigned int len)
@@ -1202,7 +1460,7 @@ static u32 *reloc_gpu(struct i915_execbuffer *eb,
 	struct reloc_cache *cache = &eb->reloc_cache;
 	u32 *cmd;
 
-	if (cache->rq_size > PAGE_SIZE/sizeof(u32) - (len + 1))
+	if (cache->rq && cache->rq_size > cache->rq_max - (len + 1))
 		reloc_gpu_flush(cache);
 
 	if (unlikely(!cache->rq)) {
@@ -1220,6 +1478,15 @@ static u32 *reloc_gpu(struct i915_execbuffer *eb,
 			return ERR_PTR(err);
 	}
 
+	/* Each target is serialised once against the single reloc request */
+	if (cache->rq_vma != vma) {
+		int err;
+
+		err = reloc_gpu_add_vma(cache, vma);
+		if (unlikely(err))
+			return ERR_PTR(err);
+	}
+
 	cmd = cache->rq_cmd + cache->rq_size;
 	cache->rq_size += len;
 
@@ -1230,21 +1497,25 @@ static u64
 relocate_entry(struct i915_vma *vma,
 	       const struct drm_i915_gem_relocation_entry *reloc,
 	       struct i915_execbuffer *eb,
+	       struct reloc_cache *cache,
 	       const struct i915_vma *target)
 {
 	u64 offset = reloc->offset;
 	u64 target_offset = relocation_target(reloc, target);
-	bool wide = eb->reloc_cache.use_64bit_reloc;
+	bool wide = cache->use_64bit_reloc;
 	void *vaddr;
 
-	if (!eb->reloc_cache.vaddr &&
+	if (!cache->vaddr &&
 	    (DBG_FORCE_RELOC == FORCE_GPU_RELOC ||
 	     !reservation_object_test_signaled_rcu(vma->resv, true))) {
-		const unsigned int gen = eb->reloc_cache.gen;
+		const unsigned int gen = cache->gen;
 		unsigned int len;
 		u32 *batch;
 		u64 addr;
 
+		/* Only the serial path may build GPU relocation requests */
+		GEM_BUG_ON(cache != &eb->reloc_cache);
+
 		if (wide)
 			len = offset & 7 ? 8 : 5;
 		else if (gen >= 4)
@@ -1297,13 +1568,13 @@ relocate_entry(struct i915_vma *vma,
 	}
 
 repeat:
-	vaddr = reloc_vaddr(vma->obj, &eb->reloc_cache, offset >> PAGE_SHIFT);
+	vaddr = reloc_vaddr(vma->obj, cache, offset >> PAGE_SHIFT);
 	if (IS_ERR(vaddr))
 		return PTR_ERR(vaddr);
 
 	clflush_write32(vaddr + offset_in_page(offset),
 			lower_32_bits(target_offset),
-			eb->reloc_cache.vaddr);
+			cache->vaddr);
 
 	if (wide) {
 		offset += sizeof(u32);
@@ -1313,11 +1584,21 @@ relocate_entry(struct i915_vma *vma,
 	}
 
 out:
+	i915_gem_object_invalidate_cmd_cache(vma->obj);
 	return target->node.start | UPDATE;
 }
 
+static void eb_set_flags(struct i915_execbuffer *eb,
+			 unsigned int *flags, unsigned int set, unsigned int clr)
+{
+	spin_lock(&eb->flags_lock);
+	*flags = (*flags & ~clr) | set;
+	spin_unlock(&eb->flags_lock);
+}
+
 static u64
 eb_relocate_entry(struct i915_execbuffer *eb,
+		  struct reloc_cache *cache,
 		  struct i915_vma *vma,
 		  const struct drm_i915_gem_relocation_entry *reloc)
 {
@@ -1353,7 +1634,9 @@ eb_relocate_entry(struct i915_execbuffer *eb,
 	}
 
 	if (reloc->write_domain) {
-		*target->exec_flags |= EXEC_OBJECT_WRITE;
+		if (!(*target->exec_flags & EXEC_OBJECT_WRITE))
+			eb_set_flags(eb, target->exec_flags,
+				     EXEC_OBJECT_WRITE, 0);
 
 		/*
 		 * Sandybridge PPGTT errata: We need a global gtt mapping
@@ -1381,7 +1664,7 @@ eb_relocate_entry(struct i915_execbuffer *eb,
 
 	/* Check that the relocation address is valid... */
 	if (unlikely(reloc->offset >
-		     vma->size - (eb->reloc_cache.use_64bit_reloc ? 8 : 4))) {
+		     vma->size - (cache->use_64bit_reloc ? 8 : 4))) {
 		DRM_DEBUG("Relocation beyond object bounds: "
 			  "target %d offset %d size %d.\n",
 			  reloc->target_handle,
@@ -1405,13 +1688,16 @@ eb_relocate_entry(struct i915_execbuffer *eb,
 	 * do relocations we are already stalling, disable the user's opt
 	 * out of our synchronisation.
 	 */
-	*vma->exec_flags &= ~EXEC_OBJECT_ASYNC;
+	if (*vma->exec_flags & EXEC_OBJECT_ASYNC)
+		eb_set_flags(eb, vma->exec_flags, 0, EXEC_OBJECT_ASYNC);
 
 	/* and update the user's relocation entry */
-	return relocate_entry(vma, reloc, eb, target);
+	return relocate_entry(vma, reloc, eb, cache, target);
 }
 
-static int eb_relocate_vma(struct i915_execbuffer *eb, struct i915_vma *vma)
+static int __eb_relocate_vma(struct i915_execbuffer *eb,
+			     struct reloc_cache *cache,
+			     struct i915_vma *vma)
 {
 #define N_RELOC(x) ((x) / sizeof(struct drm_i915_gem_relocation_entry))
 	struct drm_i915_gem_relocation_entry stack[N_RELOC(512)];
@@ -1456,7 +1742,7 @@ static int eb_relocate_vma(struct i915_execbuffer *eb, struct i915_vma *vma)
 
 		remain -= count;
 		do {
-			u64 offset = eb_relocate_entry(eb, vma, r);
+			u64 offset = eb_relocate_entry(eb, cache, vma, r);
 
 			if (likely(offset == 0)) {
 			} else if ((s64)offset < 0) {
@@ -1492,10 +1778,15 @@ static int eb_relocate_vma(struct i915_execbuffer *eb, struct i915_vma *vma)
 		urelocs += ARRAY_SIZE(stack);
 	} while (remain);
 out:
-	reloc_cache_reset(&eb->reloc_cache);
+	reloc_cache_reset(cache);
 	return remain;
 }
 
+static int eb_relocate_vma(struct i915_execbuffer *eb, struct i915_vma *vma)
+{
+	return __eb_relocate_vma(eb, &eb->reloc_cache, vma);
+}
+
 static int
 eb_relocate_vma_slow(struct i915_execbuffer *eb, struct i915_vma *vma)
 {
@@ -1506,7 +1797,8 @@ eb_relocate_vma_slow(struct i915_execbuffer *eb, struct i915_vma *vma)
 	int err;
 
 	for (i = 0; i < entry->relocation_count; i++) {
-		u64 offset = eb_relocate_entry(eb, vma, &relocs[i]);
+		u64 offset = eb_relocate_entry(eb, &eb->reloc_cache,
+					       vma, &relocs[i]);
 
 		if ((s64)offset < 0) {
 			err = (int)offset;
@@ -1653,6 +1945,8 @@ static noinline int eb_relocate_slow(struct i915_execbuffer *eb)
 	int err = 0;
 
 repeat:
+	reloc_gpu_finish(&eb->reloc_cache);
+
 	if (signal_pending(current)) {
 		err = -ERESTARTSYS;
 		goto out;
@@ -1731,6 +2025,7 @@ static noinline int eb_relocate_slow(struct i915_execbuffer *eb)
 		goto repeat;
 
 out:
+	reloc_gpu_finish(&eb->reloc_cache);
 	if (have_copy) {
 		const unsigned int count = eb->buffer_count;
 		unsigned int i;
@@ -1751,6 +2046,176 @@ static noinline int eb_relocate_slow(struct i915_execbuffer *eb)
 	return err;
 }
 
+/*
+ * For very large object lists, we may spread the CPU relocations across
+ * several workers. Each worker is given its own reloc_cache, and so its own
+ * kmap window, and operates on a disjoint set of objects. To avoid needing
+ * the struct_mutex inside the workers (or having to emit GPU relocations),
+ * we only do so if every object can be written to coherently by the CPU
+ * and is idle, preparing all the objects for the CPU writes beforehand.
+ */
+#define EB_RELOC_PARALLEL_MIN (4 * SZ_1K) /* relocation entries */
+#define EB_RELOC_PER_WORKER SZ_1K
+#define EB_RELOC_MAX_WORKERS 8
+
+struct eb_reloc_worker {
+	struct work_struct work;
+	struct i915_execbuffer *eb;
+	struct mm_struct *mm;
+	struct reloc_cache cache;
+	struct list_head vmas;
+	int err;
+};
+
+static unsigned int eb_relocate_parallel_count(const struct i915_execbuffer *eb)
+{
+	unsigned long total = 0;
+	struct i915_vma *vma;
+
+	if (DBG_FORCE_RELOC || IS_GEN6(eb->i915) || num_online_cpus() < 2)
+		return 0;
+
+	list_for_each_entry(vma, &eb->relocs, reloc_link) {
+		const struct drm_i915_gem_object *obj = vma->obj;
+
+		if (!i915_gem_object_has_struct_page(obj))
+			return 0;
+
+		if (!(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_WRITE))
+			return 0;
+
+		/* Busy objects are better relocated by the GPU */
+		if (!reservation_object_test_signaled_rcu(vma->resv, true))
+			return 0;
+
+		total += exec_entry(eb, vma)->relocation_count;
+	}
+
+	if (total < EB_RELOC_PARALLEL_MIN)
+		return 0;
+
+	return min_t(unsigned long, total / EB_RELOC_PER_WORKER,
+		     min_t(unsigned int,
+			   num_online_cpus(), EB_RELOC_MAX_WORKERS));
+}
+
+static void eb_relocate_worker_vmas(struct eb_reloc_worker *w)
+{
+	struct i915_vma *vma;
+
+	list_for_each_entry(vma, &w->vmas, reloc_link) {
+		/* Upon an error, we still need to release the prepared pages */
+		if (w->err) {
+			i915_gem_obj_finish_shmem_access(vma->obj);
+			continue;
+		}
+
+		reloc_cache_prime_kmap(&w->cache, vma->obj, 0);
+		w->err = __eb_relocate_vma(w->eb, &w->cache, vma);
+		reloc_cache_reset(&w->cache); /* in case of an early error */
+	}
+}
+
+static void eb_relocate_worker(struct work_struct *work)
+{
+	struct eb_reloc_worker *w = container_of(work, typeof(*w), work);
+	mm_segment_t old_fs;
+
+	/*
+	 * The relocation entries are read from (and the presumed offsets
+	 * written back to) the submitter's memory. A kworker runs with
+	 * KERNEL_DS, under which access_ok() would accept any kernel address
+	 * passed in by userspace, so restrict ourselves to USER_DS as the
+	 * ioctl itself would be.
+	 */
+	use_mm(w->mm);
+	old_fs = get_fs();
+	set_fs(USER_DS);
+
+	eb_relocate_worker_vmas(w);
+
+	set_fs(old_fs);
+	unuse_mm(w->mm);
+}
+
+static int eb_relocate_parallel(struct i915_execbuffer *eb, unsigned int count)
+{
+	struct eb_reloc_worker *workers;
+	struct i915_vma *vma, *vn;
+	unsigned long total, quota;
+	unsigned int n;
+	int err;
+
+	workers = kcalloc(count, sizeof(*workers), GFP_KERNEL | __GFP_NOWARN);
+	if (!workers)
+		return -ENOMEM;
+
+	/* Switch all the objects to the CPU domain whilst we hold the lock */
+	total = 0;
+	list_for_each_entry(vma, &eb->relocs, reloc_link) {
+		unsigned int flushes;
+
+		err = i915_gem_obj_prepare_shmem_write(vma->obj, &flushes);
+		if (err)
+			goto err_unprepare;
+		GEM_BUG_ON(flushes);
+
+		total += exec_entry(eb, vma)->relocation_count;
+	}
+
+	for (n = 0; n < count; n++) {
+		struct eb_reloc_worker *w = &workers[n];
+
+		INIT_WORK(&w->work, eb_relocate_worker);
+		INIT_LIST_HEAD(&w->vmas);
+		reloc_cache_init(&w->cache, eb->i915);
+		w->eb = eb;
+		w->mm = current->mm;
+	}
+
+	/* Distribute the objects evenly by their number of relocations */
+	quota = DIV_ROUND_UP(total, count);
+	total = 0;
+	n = 0;
+	list_for_each_entry_safe(vma, vn, &eb->relocs, reloc_link) {
+		list_move_tail(&vma->reloc_link, &workers[n].vmas);
+
+		total += exec_entry(eb, vma)->relocation_count;
+		if (total >= quota && n < count - 1) {
+			total = 0;
+			n++;
+		}
+	}
+
+	for (n = 1; n < count; n++)
+		queue_work(system_unbound_wq, &workers[n].work);
+
+	/* And do our fair share of the work whilst we wait */
+	eb_relocate_worker_vmas(&workers[0]);
+
+	err = 0;
+	for (n = 0; n < count; n++) {
+		struct eb_reloc_worker *w = &workers[n];
+
+		if (n)
+			flush_work(&w->work);
+
+		if (w->err && !err)
+			err = w->err;
+
+		list_splice_tail(&w->vmas, &eb->relocs);
+	}
+
+	kfree(workers);
+	return err;
+
+err_unprepare:
+	list_for_each_entry_continue_reverse(vma, &eb->relocs, reloc_link)
+		i915_gem_obj_finish_shmem_access(vma->obj);
+	kfree(workers);
+	return err;
+}
+
 static int eb_relocate(struct i915_execbuffer *eb)
 {
 	if (eb_lookup_vmas(eb))
@@ -1759,11 +2224,21 @@ static int eb_relocate(struct i915_execbuffer *eb)
 	/* The objects are in their final locations, apply the relocations. */
 	if (eb->args->flags & __EXEC_HAS_RELOC) {
 		struct i915_vma *vma;
+		unsigned int count;
+
+		count = eb_relocate_parallel_count(eb);
+		if (count > 1) {
+			if (eb_relocate_parallel(eb, count))
+				goto slow;
+			return 0;
+		}
 
 		list_for_each_entry(vma, &eb->relocs, reloc_link) {
 			if (eb_relocate_vma(eb, vma))
 				goto slow;
 		}
+
+		reloc_gpu_finish(&eb->reloc_cache);
 	}
 
 	return 0;
@@ -1772,12 +2247,65 @@ static int eb_relocate(struct i915_execbuffer *eb)
 	return eb_relocate_slow(eb);
 }
 
+static void eb_clflush_objects(struct i915_execbuffer *eb)
+{
+	const unsigned int count = eb->buffer_count;
+	const bool explicit = i915_gem_context_is_explicit_coherency(eb->ctx);
+	struct i915_clflush_batch batch;
+	unsigned int i;
+
+	/*
+	 * Collect every object that needs flushing into a single batch,
+	 * so that we use one worker and one fence for the whole execbuf
+	 * rather than one for each object.
+	 */
+	i915_gem_clflush_batch_init(&batch, count);
+	for (i = 0; i < count; i++) {
+		struct drm_i915_gem_object *obj = eb->vma[i]->obj;
+
+		/* Userspace tells us of CPU writes we could not have tracked */
+		if (eb->flags[i] & EXEC_OBJECT_CLFLUSH)
+			obj->cache_dirty = true;
+
+		/*
+		 * If the GPU is not _reading_ through the CPU cache, we need
+		 * to make sure that any writes (both previous GPU writes from
+		 * before a change in snooping levels and normal CPU writes)
+		 * caught in that cache are flushed to main memory.
+		 *
+		 * We want to say
+		 *   obj->cache_dirty &&
+		 *   !(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_READ)
+		 * but gcc's optimiser doesn't handle that as well and emits
+		 * two jumps instead of one. Maybe one day...
+		 */
+		if (unlikely(obj->cache_dirty & ~obj->cache_coherent)) {
+			/*
+			 * In explicit coherency mode, userspace is responsible
+			 * for flushing its own writes, but we always flush
+			 * freshly acquired pages once so that the GPU never
+			 * reads stale data from their previous owner.
+			 */
+			if (explicit && obj->cache_flushed &&
+			    !(eb->flags[i] & EXEC_OBJECT_CLFLUSH))
+				continue;
+
+			if (i915_gem_clflush_batch_add(&batch, obj, 0))
+				eb->flags[i] &= ~EXEC_OBJECT_ASYNC;
+		}
+	}
+	i915_gem_clflush_batch_commit(&batch);
+}
+
 static int eb_move_to_gpu(struct i915_execbuffer *eb)
 {
 	const unsigned int count = eb->buffer_count;
+	const u64 gen = ++eb->vm->access_gen;
 	unsigned int i;
 	int err;
 
+	eb_clflush_objects(eb);
+
 	for (i = 0; i < count; i++) {
 		unsigned int flags = eb->flags[i];
 		struct i915_vma *vma = eb->vma[i];
@@ -1796,23 +2324,6 @@ static int eb_move_to_gpu(struct i915_execbuffer *eb)
 			eb->request->capture_list = capture;
 		}
 
-		/*
-		 * If the GPU is not _reading_ through the CPU cache, we need
-		 * to make sure that any writes (both previous GPU writes from
-		 * before a change in snooping levels and normal CPU writes)
-		 * caught in that cache are flushed to main memory.
-		 *
-		 * We want to say
-		 *   obj->cache_dirty &&
-		 *   !(obj->cache_coherent & I915_BO_CACHE_COHERENT_FOR_READ)
-		 * but gcc's optimiser doesn't handle that as well and emits
-		 * two jumps instead of one. Maybe one day...
-		 */
-		if (unlikely(obj->cache_dirty & ~obj->cache_coherent)) {
-			if (i915_gem_clflush_object(obj, 0))
-				flags &= ~EXEC_OBJECT_ASYNC;
-		}
-
 		if (flags & EXEC_OBJECT_ASYNC)
 			continue;
 
@@ -1831,6 +2342,7 @@ static int eb_move_to_gpu(struct i915_execbuffer *eb)
 			i915_request_skip(eb->request, err);
 			return err;
 		}
+		vma->last_access = gen;
 
 		__eb_unreserve_vma(vma, flags);
 		vma->exec_flags = NULL;
@@ -1857,11 +2369,19 @@ static bool i915_gem_check_execbuffer(struct drm_i915_gem_execbuffer2 *exec)
 			return false;
 	}
 
-	if (exec->DR4 == 0xffffffff) {
-		DRM_DEBUG("UXA submitting garbage DR4, fixing up\n");
-		exec->DR4 = 0;
+	/* DR4 is reused as the deadline */
+	if (!(exec->flags & I915_EXEC_DEADLINE)) {
+		if (exec->DR4 == 0xffffffff) {
+			DRM_DEBUG("UXA submitting garbage DR4, fixing up\n");
+			exec->DR4 = 0;
+		}
+		if (exec->DR4)
+			return false;
 	}
-	if (exec->DR1 || exec->DR4)
+
+	/* DR1 is reused as the resident set id */
+	if (exec->DR1 &&
+	    (!(exec->flags & I915_EXEC_RESIDENT_SET) || exec->DR1 > INT_MAX))
 		return false;
 
 	if ((exec->batch_start_offset | exec->batch_len) & 0x7)
@@ -1899,8 +2419,18 @@ static struct i915_vma *eb_parse(struct i915_execbuffer *eb, bool is_master)
 {
 	struct drm_i915_gem_object *shadow_batch_obj;
 	struct i915_vma *vma;
+	unsigned int gen;
 	int err;
 
+	shadow_batch_obj = intel_engine_cmd_parser_lookup(eb->engine,
+							  eb->batch->obj,
+							  eb->batch_start_offset,
+							  eb->batch_len,
+							  is_master,
+							  &gen);
+	if (shadow_batch_obj)
+		goto pin;
+
 	shadow_batch_obj = i915_gem_batch_pool_get(&eb->engine->batch_pool,
 						   PAGE_ALIGN(eb->batch_len));
 	if (IS_ERR(shadow_batch_obj))
@@ -1917,9 +2447,14 @@ static struct i915_vma *eb_parse(struct i915_execbuffer *eb, bool is_master)
 			vma = NULL;
 		else
 			vma = ERR_PTR(err);
-		goto out;
+		i915_gem_object_unpin_pages(shadow_batch_obj);
+		return vma;
 	}
 
+	/* Keep the validated copy for when the batch is resubmitted */
+	i915_gem_batch_pool_detach(&eb->engine->batch_pool, shadow_batch_obj);
+
+pin:
 	vma = i915_gem_object_ggtt_pin(shadow_batch_obj, NULL, 0, 0, 0);
 	if (IS_ERR(vma))
 		goto out;
@@ -1932,6 +2467,13 @@ static struct i915_vma *eb_parse(struct i915_execbuffer *eb, bool is_master)
 
 out:
 	i915_gem_object_unpin_pages(shadow_batch_obj);
+	intel_engine_cmd_parser_store(eb->engine,
+				      eb->batch->obj,
+				      shadow_batch_obj,
+				      eb->batch_start_offset,
+				      eb->batch_len,
+				      is_master,
+				      gen);
 	return vma;
 }
 
@@ -1942,6 +2484,46 @@ add_to_client(struct i915_request *rq, struct drm_file *file)
 	list_add_tail(&rq->client_link, &rq->file_priv->mm.request_list);
 }
 
+/*
+ * Store the engine's CS timestamp into the EXEC_OBJECT_TIMESTAMP object,
+ * into the first (@slot 0) or second (@slot 1) u64 at the user's offset.
+ * Reading RING_TIMESTAMP with MI_STORE_REGISTER_MEM would sample it as the
+ * CS parses the command, ahead of the work still in the pipeline, and as
+ * two separate dwords. Instead use the timestamp post-sync write of a
+ * stalling PIPE_CONTROL on the render engine, or of MI_FLUSH_DW on the
+ * others, which stores the whole u64 once the preceding work is done.
+ */
+static int eb_emit_timestamp(struct i915_execbuffer *eb, unsigned int slot)
+{
+	const struct drm_i915_gem_exec_object2 *entry =
+		exec_entry(eb, eb->timestamp);
+	u64 addr = eb->timestamp->node.start + entry->rsvd2 + slot * sizeof(u64);
+	u32 *cs;
+
+	cs = intel_ring_begin(eb->request, 6);
+	if (IS_ERR(cs))
+		return PTR_ERR(cs);
+
+	if (eb->engine->class == RENDER_CLASS) {
+		*cs++ = GFX_OP_PIPE_CONTROL(6);
+		*cs++ = PIPE_CONTROL_CS_STALL | PIPE_CONTROL_TIMESTAMP_WRITE;
+		*cs++ = lower_32_bits(addr);
+		*cs++ = upper_32_bits(addr);
+		*cs++ = 0;
+		*cs++ = 0;
+	} else {
+		*cs++ = (MI_FLUSH_DW + 1) | MI_FLUSH_DW_OP_STAMP;
+		*cs++ = lower_32_bits(addr) | MI_FLUSH_DW_USE_PPGTT;
+		*cs++ = upper_32_bits(addr);
+		*cs++ = 0;
+		*cs++ = MI_NOOP;
+		*cs++ = MI_NOOP;
+	}
+
+	intel_ring_advance(eb->request, cs);
+	return 0;
+}
+
 static int eb_submit(struct i915_execbuffer *eb)
 {
 	int err;
@@ -1950,12 +2532,25 @@ static int eb_submit(struct i915_execbuffer *eb)
 	if (err)
 		return err;
 
+	/* Only now are all of the request's dependencies known */
+	if (eb->gang) {
+		err = i915_gang_join(eb->gang, eb->request);
+		if (err)
+			return err;
+	}
+
 	if (eb->args->flags & I915_EXEC_GEN7_SOL_RESET) {
 		err = i915_reset_gen7_sol_offsets(eb->request);
 		if (err)
 			return err;
 	}
 
+	if (eb->timestamp) {
+		err = eb_emit_timestamp(eb, 0);
+		if (err)
+			return err;
+	}
+
 	err = eb->engine->emit_bb_start(eb->request,
 					eb->batch->node.start +
 					eb->batch_start_offset,
@@ -1964,6 +2559,12 @@ static int eb_submit(struct i915_execbuffer *eb)
 	if (err)
 		return err;
 
+	if (eb->timestamp) {
+		err = eb_emit_timestamp(eb, 1);
+		if (err)
+			return err;
+	}
+
 	return 0;
 }
 
@@ -1985,6 +2586,25 @@ gen8_dispatch_bsd_engine(struct drm_i915_private *dev_priv,
 	return file_priv->bsd_engine;
 }
 
+/*
+ * Find the BSD ring that will be free soonest, i.e. the one with the least
+ * amount of work queued ahead of us, preferring the file's own ring (see
+ * gen8_dispatch_bsd_engine()) for a tie.
+ */
+static unsigned int
+gen8_balance_bsd_engine(struct drm_i915_private *dev_priv,
+			struct drm_file *file)
+{
+	unsigned int idx = gen8_dispatch_bsd_engine(dev_priv, file);
+	unsigned int other = idx ^ 1;
+
+	if (intel_engine_load(dev_priv->engine[_VCS(other)]) <
+	    intel_engine_load(dev_priv->engine[_VCS(idx)]))
+		idx = other;
+
+	return idx;
+}
+
 #define I915_USER_RINGS (4)
 
 static const enum intel_engine_id user_ring_map[I915_USER_RINGS + 1] = {
@@ -2020,6 +2640,8 @@ eb_select_engine(struct drm_i915_private *dev_priv,
 
 		if (bsd_idx == I915_EXEC_BSD_DEFAULT) {
 			bsd_idx = gen8_dispatch_bsd_engine(dev_priv, file);
+		} else if (bsd_idx == I915_EXEC_BSD_BALANCE) {
+			bsd_idx = gen8_balance_bsd_engine(dev_priv, file);
 		} else if (bsd_idx >= I915_EXEC_BSD_RING1 &&
 			   bsd_idx <= I915_EXEC_BSD_RING2) {
 			bsd_idx >>= I915_EXEC_BSD_SHIFT;
@@ -2051,13 +2673,17 @@ __free_fence_array(struct drm_syncobj **fences, unsigned int n)
 	kvfree(fences);
 }
 
+#define I915_EXEC_FENCE_LOOKUP_BATCH 32
+
 static struct drm_syncobj **
 get_fence_array(struct drm_i915_gem_execbuffer2 *args,
 		struct drm_file *file)
 {
 	const unsigned long nfences = args->num_cliprects;
 	struct drm_i915_gem_exec_fence __user *user;
+	struct drm_i915_gem_exec_fence *exec;
 	struct drm_syncobj **fences;
+	unsigned int count;
 	unsigned long n;
 	int err;
 
@@ -2080,36 +2706,63 @@ get_fence_array(struct drm_i915_gem_execbuffer2 *args,
 	if (!fences)
 		return ERR_PTR(-ENOMEM);
 
-	for (n = 0; n < nfences; n++) {
-		struct drm_i915_gem_exec_fence fence;
-		struct drm_syncobj *syncobj;
+	/*
+	 * Pull in the whole user array with a single copy, rather than a
+	 * __copy_from_user() per fence, before looking up each syncobj.
+	 */
+	exec = kvmalloc_array(nfences, sizeof(*exec),
+			      __GFP_NOWARN | GFP_KERNEL);
+	if (!exec) {
+		kvfree(fences);
+		return ERR_PTR(-ENOMEM);
+	}
 
-		if (__copy_from_user(&fence, user++, sizeof(fence))) {
-			err = -EFAULT;
-			goto err;
-		}
+	if (__copy_from_user(exec, user, nfences * sizeof(*user))) {
+		n = 0;
+		err = -EFAULT;
+		goto err;
+	}
 
-		if (fence.flags & __I915_EXEC_FENCE_UNKNOWN_FLAGS) {
+	for (n = 0; n < nfences; n++) {
+		if (exec[n].flags & __I915_EXEC_FENCE_UNKNOWN_FLAGS) {
+			n = 0;
 			err = -EINVAL;
 			goto err;
 		}
+	}
+
+	BUILD_BUG_ON(~(ARCH_KMALLOC_MINALIGN - 1) &
+		     ~__I915_EXEC_FENCE_UNKNOWN_FLAGS);
 
-		syncobj = drm_syncobj_find(file, fence.handle);
-		if (!syncobj) {
+	/*
+	 * Look the syncobjs up a batch at a time, taking the file's table
+	 * lock once per batch rather than once per fence. The batch is kept
+	 * small so that a huge fence array cannot hold that spinlock for long.
+	 */
+	for (n = 0; n < nfences; n += count) {
+		u32 handles[I915_EXEC_FENCE_LOOKUP_BATCH];
+		unsigned int i;
+
+		count = min_t(unsigned long, nfences - n, ARRAY_SIZE(handles));
+		for (i = 0; i < count; i++)
+			handles[i] = exec[n + i].handle;
+
+		err = drm_syncobj_find_array(file, handles, count, fences + n);
+		if (err) {
 			DRM_DEBUG("Invalid syncobj handle provided\n");
-			err = -ENOENT;
 			goto err;
 		}
 
-		BUILD_BUG_ON(~(ARCH_KMALLOC_MINALIGN - 1) &
-			     ~__I915_EXEC_FENCE_UNKNOWN_FLAGS);
-
-		fences[n] = ptr_pack_bits(syncobj, fence.flags, 2);
+		for (i = 0; i < count; i++)
+			fences[n + i] = ptr_pack_bits(fences[n + i],
+						      exec[n + i].flags, 2);
 	}
 
+	kvfree(exec);
 	return fences;
 
 err:
+	kvfree(exec);
 	__free_fence_array(fences, n);
 	return ERR_PTR(err);
 }
@@ -2122,15 +2775,38 @@ put_fence_array(struct drm_i915_gem_execbuffer2 *args,
 		__free_fence_array(fences, args->num_cliprects);
 }
 
+static bool
+fence_is_superseded(struct i915_syncmap **latest, const struct dma_fence *fence)
+{
+	/* Is there a later fence on the same timeline within this array? */
+	return *latest && !dma_fence_is_array(fence) &&
+		i915_syncmap_is_later(latest, fence->context, fence->seqno + 1);
+}
+
 static int
 await_fence_array(struct i915_execbuffer *eb,
 		  struct drm_syncobj **fences)
 {
 	const unsigned int nfences = eb->args->num_cliprects;
-	unsigned int n;
+	const u64 unordered = eb->i915->mm.unordered_timeline;
+	struct i915_syncmap *latest;
+	struct dma_fence **pending;
+	unsigned int n, count;
 	int err;
 
-	for (n = 0; n < nfences; n++) {
+	pending = kvmalloc_array(nfences, sizeof(*pending),
+				 __GFP_NOWARN | GFP_KERNEL);
+	if (!pending)
+		return -ENOMEM;
+
+	/*
+	 * Userspace often hands us a long list of syncobjs of which many
+	 * point along the same few timelines. Record the latest seqno on
+	 * each timeline first, so that we only need to wait on that one
+	 * fence and can skip the earlier, implied, waits.
+	 */
+	i915_syncmap_init(&latest);
+	for (n = count = 0; n < nfences; n++) {
 		struct drm_syncobj *syncobj;
 		struct dma_fence *fence;
 		unsigned int flags;
@@ -2140,16 +2816,43 @@ await_fence_array(struct i915_execbuffer *eb,
 			continue;
 
 		fence = drm_syncobj_fence_get(syncobj);
-		if (!fence)
-			return -EINVAL;
+		if (!fence) {
+			err = -EINVAL;
+			goto out;
+		}
+
+		pending[count++] = fence;
+
+		if (dma_fence_is_array(fence) ||
+		    fence->context == unordered ||
+		    i915_syncmap_is_later(&latest,
+					  fence->context, fence->seqno))
+			continue;
+
+		err = i915_syncmap_set(&latest, fence->context, fence->seqno);
+		if (err)
+			goto out;
+	}
+
+	err = 0;
+	for (n = 0; n < count; n++) {
+		struct dma_fence *fence = pending[n];
+
+		if (fence->context != unordered &&
+		    fence_is_superseded(&latest, fence))
+			continue;
 
 		err = i915_request_await_dma_fence(eb->request, fence);
-		dma_fence_put(fence);
 		if (err < 0)
-			return err;
+			break;
 	}
 
-	return 0;
+out:
+	i915_syncmap_free(&latest);
+	while (count--)
+		dma_fence_put(pending[count]);
+	kvfree(pending);
+	return err < 0 ? err : 0;
 }
 
 static void
@@ -2172,12 +2875,24 @@ signal_fence_array(struct i915_execbuffer *eb,
 	}
 }
 
+/*
+ * State carried between the individual execbufs of a vectored submission,
+ * see i915_gem_execbuffer2_vec_ioctl(). The caller holds both the
+ * struct_mutex and a runtime-pm wakeref across the whole vector.
+ */
+struct eb_vec {
+	struct i915_request *prev; /** last request, for I915_EXEC_VEC_CHAIN */
+	struct i915_gang *gang; /** for I915_EXEC_VEC_GANG */
+	bool chain;
+};
+
 static int
 i915_gem_do_execbuffer(struct drm_device *dev,
 		       struct drm_file *file,
 		       struct drm_i915_gem_execbuffer2 *args,
 		       struct drm_i915_gem_exec_object2 *exec,
-		       struct drm_syncobj **fences)
+		       struct drm_syncobj **fences,
+		       struct eb_vec *vec)
 {
 	struct i915_execbuffer eb;
 	struct dma_fence *in_fence = NULL;
@@ -2203,7 +2918,14 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 	eb.invalid_flags = __EXEC_OBJECT_UNKNOWN_FLAGS;
 	if (USES_FULL_PPGTT(eb.i915))
 		eb.invalid_flags |= EXEC_OBJECT_NEEDS_GTT;
+	if (INTEL_GEN(eb.i915) < 8 || !USES_FULL_PPGTT(eb.i915))
+		eb.invalid_flags |= EXEC_OBJECT_SPARSE;
+	if (INTEL_GEN(eb.i915) < 8)
+		eb.invalid_flags |= EXEC_OBJECT_TIMESTAMP;
+	eb.timestamp = NULL;
+	eb.gang = vec ? vec->gang : NULL;
 	reloc_cache_init(&eb.reloc_cache, eb.i915);
+	spin_lock_init(&eb.flags_lock);
 
 	eb.buffer_count = args->buffer_count;
 	eb.batch_start_offset = args->batch_start_offset;
@@ -2237,6 +2959,12 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 		eb.batch_flags |= I915_DISPATCH_RS;
 	}
 
+	if (args->flags & I915_EXEC_DEADLINE &&
+	    !(eb.i915->caps.scheduler & I915_SCHEDULER_CAP_DEADLINE)) {
+		DRM_DEBUG("Deadlines are not supported by the scheduler\n");
+		return -ENODEV;
+	}
+
 	if (args->flags & I915_EXEC_FENCE_IN) {
 		in_fence = sync_file_get_fence(lower_32_bits(args->rsvd2));
 		if (!in_fence)
@@ -2268,11 +2996,13 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 	 * wakeref that we hold until the GPU has been idle for at least
 	 * 100ms.
 	 */
-	intel_runtime_pm_get(eb.i915);
+	if (!vec) {
+		intel_runtime_pm_get(eb.i915);
 
-	err = i915_mutex_lock_interruptible(dev);
-	if (err)
-		goto err_rpm;
+		err = i915_mutex_lock_interruptible(dev);
+		if (err)
+			goto err_rpm;
+	}
 
 	err = eb_relocate(&eb);
 	if (err) {
@@ -2287,6 +3017,17 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 		goto err_vma;
 	}
 
+	err = eb_bind_sparse(&eb);
+	if (err)
+		goto err_vma;
+
+	if (args->flags & I915_EXEC_RESIDENT_SET &&
+	    (!args->DR1 || eb_resident_set_is_stale(&eb))) {
+		err = eb_register_resident_set(&eb);
+		if (err)
+			goto err_vma;
+	}
+
 	if (unlikely(*eb.batch->exec_flags & EXEC_OBJECT_WRITE)) {
 		DRM_DEBUG("Attempting to use self-modifying batch buffer\n");
 		err = -EINVAL;
@@ -2375,6 +3116,25 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 			goto err_request;
 	}
 
+	/* Only media may depend on the HuC having been authenticated */
+	if (eb.engine->class == VIDEO_DECODE_CLASS) {
+		err = intel_huc_await_auth(&eb.i915->huc, eb.request);
+		if (err)
+			goto err_request;
+	}
+
+	if (vec && vec->chain && vec->prev) {
+		err = i915_request_await_dma_fence(eb.request,
+						   &vec->prev->fence);
+		if (err < 0)
+			goto err_request;
+	}
+
+	/* Picked up by i915_request_add() and passed to engine->schedule() */
+	if (args->flags & I915_EXEC_DEADLINE)
+		eb.request->sched.attr.deadline =
+			ktime_get_ns() + (u64)args->DR4 * NSEC_PER_USEC;
+
 	if (out_fence_fd != -1) {
 		out_fence = sync_file_create(&eb.request->fence);
 		if (!out_fence) {
@@ -2394,13 +3154,25 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 
 	trace_i915_request_queue(eb.request, eb.batch_flags);
 	err = eb_submit(&eb);
+	if (err == 0)
+		i915_aub_stream_record(eb.request, eb.batch,
+				       eb.vma, eb.buffer_count);
 err_request:
 	i915_request_add(eb.request);
 	add_to_client(eb.request, file);
 
+	if (err == 0)
+		i915_aub_stream_submit(eb.request);
+
 	if (fences)
 		signal_fence_array(&eb, fences);
 
+	if (vec) {
+		if (vec->prev)
+			i915_request_put(vec->prev);
+		vec->prev = i915_request_get(eb.request);
+	}
+
 	if (out_fence) {
 		if (err == 0) {
 			fd_install(out_fence_fd, out_fence->file);
@@ -2412,15 +3184,22 @@ i915_gem_do_execbuffer(struct drm_device *dev,
 		}
 	}
 
+	if (err == 0 && args->flags & I915_EXEC_SEQNO_OUT) {
+		args->rsvd1 &= I915_EXEC_CONTEXT_ID_MASK; /* keep ctx id */
+		args->rsvd1 |= (u64)eb.request->fence.seqno << 32;
+	}
+
 err_batch_unpin:
 	if (eb.batch_flags & I915_DISPATCH_SECURE)
 		i915_vma_unpin(eb.batch);
 err_vma:
 	if (eb.exec)
 		eb_release_vmas(&eb);
-	mutex_unlock(&dev->struct_mutex);
+	if (!vec)
+		mutex_unlock(&dev->struct_mutex);
 err_rpm:
-	intel_runtime_pm_put(eb.i915);
+	if (!vec)
+		intel_runtime_pm_put(eb.i915);
 	i915_gem_context_put(eb.ctx);
 err_destroy:
 	eb_destroy(&eb);
@@ -2452,6 +3231,33 @@ static bool check_buffer_count(size_t count)
 	return !(count < 1 || count > INT_MAX || count > SIZE_MAX / sz - 1);
 }
 
+static void
+eb_export_offsets(const struct drm_i915_gem_execbuffer2 *args,
+		  struct drm_i915_gem_exec_object2 *exec2_list)
+{
+	struct drm_i915_gem_exec_object2 __user *user_exec_list =
+		u64_to_user_ptr(args->buffers_ptr);
+	unsigned int i;
+
+	if (!(args->flags & __EXEC_HAS_RELOC))
+		return;
+
+	/* Copy the new buffer offsets back to the user's exec list. */
+	user_access_begin();
+	for (i = 0; i < args->buffer_count; i++) {
+		if (!(exec2_list[i].offset & UPDATE))
+			continue;
+
+		exec2_list[i].offset =
+			gen8_canonical_addr(exec2_list[i].offset & PIN_OFFSET_MASK);
+		unsafe_put_user(exec2_list[i].offset,
+				&user_exec_list[i].offset,
+				end_user);
+	}
+end_user:
+	user_access_end();
+}
+
 /*
  * Legacy execbuffer just creates an exec2 list from the original exec object
  * list array and passes it to the real function.
@@ -2522,7 +3328,7 @@ i915_gem_execbuffer_ioctl(struct drm_device *dev, void *data,
 			exec2_list[i].flags = 0;
 	}
 
-	err = i915_gem_do_execbuffer(dev, file, &exec2, exec2_list, NULL);
+	err = i915_gem_do_execbuffer(dev, file, &exec2, exec2_list, NULL, NULL);
 	if (exec2.flags & __EXEC_HAS_RELOC) {
 		struct drm_i915_gem_exec_object __user *user_exec_list =
 			u64_to_user_ptr(args->buffers_ptr);
@@ -2589,7 +3395,7 @@ i915_gem_execbuffer2_ioctl(struct drm_device *dev, void *data,
 		}
 	}
 
-	err = i915_gem_do_execbuffer(dev, file, args, exec2_list, fences);
+	err = i915_gem_do_execbuffer(dev, file, args, exec2_list, fences, NULL);
 
 	/*
 	 * Now that we have begun execution of the batchbuffer, we ignore
@@ -2597,29 +3403,167 @@ i915_gem_execbuffer2_ioctl(struct drm_device *dev, void *data,
 	 * updated the associated relocations, we try to write out the current
 	 * object locations irrespective of any error.
 	 */
-	if (args->flags & __EXEC_HAS_RELOC) {
-		struct drm_i915_gem_exec_object2 __user *user_exec_list =
-			u64_to_user_ptr(args->buffers_ptr);
-		unsigned int i;
+	eb_export_offsets(args, exec2_list);
 
-		/* Copy the new buffer offsets back to the user's exec list. */
-		user_access_begin();
-		for (i = 0; i < args->buffer_count; i++) {
-			if (!(exec2_list[i].offset & UPDATE))
-				continue;
+	args->flags &= ~__I915_EXEC_UNKNOWN_FLAGS;
+	put_fence_array(args, fences);
+	kvfree(exec2_list);
+	return err;
+}
 
-			exec2_list[i].offset =
-				gen8_canonical_addr(exec2_list[i].offset & PIN_OFFSET_MASK);
-			unsafe_put_user(exec2_list[i].offset,
-					&user_exec_list[i].offset,
-					end_user);
+struct eb_vec_entry {
+	struct drm_i915_gem_execbuffer2 args;
+	struct drm_i915_gem_exec_object2 *exec;
+	struct drm_syncobj **fences;
+};
+
+static void eb_vec_free(struct eb_vec_entry *entries, unsigned int count)
+{
+	while (count--) {
+		put_fence_array(&entries[count].args, entries[count].fences);
+		kvfree(entries[count].exec);
+	}
+	kvfree(entries);
+}
+
+int
+i915_gem_execbuffer2_vec_ioctl(struct drm_device *dev, void *data,
+			       struct drm_file *file)
+{
+	struct drm_i915_private *i915 = to_i915(dev);
+	struct drm_i915_gem_execbuffer2_vec *args = data;
+	struct drm_i915_gem_execbuffer2 __user *user;
+	struct eb_vec_entry *entries;
+	const unsigned int count = args->count;
+	struct eb_vec vec = {};
+	unsigned int n, submitted;
+	int err;
+
+	if (args->flags & __I915_EXEC_VEC_UNKNOWN_FLAGS || args->rsvd)
+		return -EINVAL;
+
+	if (args->flags & I915_EXEC_VEC_CHAIN &&
+	    args->flags & I915_EXEC_VEC_GANG)
+		return -EINVAL;
+
+	if (!count || count > I915_EXEC_VEC_MAX)
+		return -EINVAL;
+
+	entries = kvcalloc(count, sizeof(*entries), GFP_KERNEL);
+	if (!entries)
+		return -ENOMEM;
+
+	/*
+	 * Gather and validate every execbuf before we take the struct_mutex,
+	 * so that all the requests are then built and submitted within a
+	 * single critical section. Each execbuf still reserves its own vmas
+	 * in turn, and should one of them fault on its relocations the slow
+	 * path drops the struct_mutex, so prefault them all up front.
+	 */
+	user = u64_to_user_ptr(args->execbuf_ptr);
+	for (n = 0; n < count; n++) {
+		struct eb_vec_entry *e = &entries[n];
+		size_t nobj;
+
+		if (copy_from_user(&e->args, &user[n], sizeof(e->args))) {
+			err = -EFAULT;
+			goto err_free;
+		}
+
+		nobj = e->args.buffer_count;
+		if (!check_buffer_count(nobj) ||
+		    !i915_gem_check_execbuffer(&e->args)) {
+			err = -EINVAL;
+			goto err_free;
+		}
+
+		/* Allocate an extra slot for use by the command parser */
+		e->exec = kvmalloc_array(nobj + 1, eb_element_size(),
+					 __GFP_NOWARN | GFP_KERNEL);
+		if (!e->exec) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+
+		if (copy_from_user(e->exec,
+				   u64_to_user_ptr(e->args.buffers_ptr),
+				   sizeof(*e->exec) * nobj)) {
+			err = -EFAULT;
+			goto err_free;
+		}
+
+		if (!i915_modparams.prefault_disable) {
+			size_t i;
+
+			for (i = 0; i < nobj; i++) {
+				err = check_relocations(&e->exec[i]);
+				if (err)
+					goto err_free;
+			}
+		}
+
+		if (e->args.flags & I915_EXEC_FENCE_ARRAY) {
+			e->fences = get_fence_array(&e->args, file);
+			if (IS_ERR(e->fences)) {
+				err = PTR_ERR(e->fences);
+				e->fences = NULL;
+				goto err_free;
+			}
 		}
-end_user:
-		user_access_end();
 	}
 
-	args->flags &= ~__I915_EXEC_UNKNOWN_FLAGS;
-	put_fence_array(args, fences);
-	kvfree(exec2_list);
+	vec.chain = args->flags & I915_EXEC_VEC_CHAIN;
+	if (args->flags & I915_EXEC_VEC_GANG) {
+		vec.gang = i915_gang_create(count);
+		if (!vec.gang) {
+			err = -ENOMEM;
+			goto err_free;
+		}
+	}
+
+	intel_runtime_pm_get(i915);
+
+	err = i915_mutex_lock_interruptible(dev);
+	if (err) {
+		kfree(vec.gang);
+		goto err_rpm;
+	}
+
+	for (submitted = 0; submitted < count; submitted++) {
+		struct eb_vec_entry *e = &entries[submitted];
+
+		err = i915_gem_do_execbuffer(dev, file,
+					     &e->args, e->exec, e->fences,
+					     &vec);
+		if (err)
+			break;
+	}
+
+	/* Release those we did submit, even if we stopped short */
+	if (vec.gang)
+		i915_gang_seal(vec.gang);
+
+	mutex_unlock(&dev->struct_mutex);
+
+	if (vec.prev)
+		i915_request_put(vec.prev);
+
+	/* Report back the offsets and out-fences of everything we touched */
+	for (n = 0; n < min(submitted + 1, count); n++) {
+		struct eb_vec_entry *e = &entries[n];
+
+		eb_export_offsets(&e->args, e->exec);
+
+		e->args.flags &= ~__I915_EXEC_UNKNOWN_FLAGS;
+		if (copy_to_user(&user[n], &e->args, sizeof(e->args)) &&
+		    !err)
+			err = -EFAULT;
+	}
+
+	args->count = submitted;
+err_rpm:
+	intel_runtime_pm_put(i915);
+err_free:
+	eb_vec_free(entries, count);
 	return err;
 }
@@ -245,7 +245,11 @@ static int fence_update(struct drm_i915_fence_reg *fence,
 		 * stealing the fence.
 		 */
 		GEM_BUG_ON(fence->vma->fence != fence);
+		if (i915_vma_has_userfault(fence->vma))
+			fence->i915->mm.fence_stats.revokes++;
 		i915_vma_revoke_mmap(fence->vma);
+		if (vma)
+			fence->i915->mm.fence_stats.steals++;
 
 		fence->vma->fence = NULL;
 		fence->vma = NULL;
@@ -300,16 +304,39 @@ int i915_vma_put_fence(struct i915_vma *vma)
 
 static struct drm_i915_fence_reg *fence_find(struct drm_i915_private *dev_priv)
 {
-	struct drm_i915_fence_reg *fence;
-
+	struct drm_i915_fence_reg *fence, *victim = NULL;
+
+	/*
+	 * The fence_list is kept in LRU order of pinning, but that is
+	 * dominated by execbuf and display. What is costly to steal is a
+	 * fence that userspace is actively accessing through the GTT, as
+	 * we have to revoke its mmap and it will immediately fault back in
+	 * and steal another. So prefer, in order: an unused register, one
+	 * without any live userspace mmap, and finally the one whose mmap
+	 * was least recently faulted.
+	 */
 	list_for_each_entry(fence, &dev_priv->mm.fence_list, link) {
 		GEM_BUG_ON(fence->vma && fence->vma->fence != fence);
 
 		if (fence->pin_count)
 			continue;
 
-		return fence;
+		if (!fence->vma)
+			return fence;
+
+		if (!i915_vma_has_userfault(fence->vma)) {
+			victim = fence;
+			break;
+		}
+
+		if (!victim ||
+		    time_before(fence->last_fault, victim->last_fault))
+			victim = fence;
 	}
+	if (victim)
+		return victim;
+
+	dev_priv->mm.fence_stats.waits++;
 
 	/* Wait for completion of pending flips which consume fences */
 	if (intel_has_pending_fb_unpin(dev_priv))
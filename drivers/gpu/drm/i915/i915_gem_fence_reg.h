@@ -38,6 +38,11 @@ struct drm_i915_fence_reg {
 	struct i915_vma *vma;
 	int pin_count;
 	int id;
+	/**
+	 * Last time (jiffies) userspace faulted through this fence, used
+	 * to pick the coldest victim when we have to steal a register.
+	 */
+	unsigned long last_fault;
 	/**
 	 * Whether the tiling parameters for the currently
 	 * associated fence register have changed. Note that
@@ -31,6 +31,7 @@
 #include <linux/seq_file.h>
 #include <linux/stop_machine.h>
 
+#include <asm/fpu/api.h>
 #include <asm/set_memory.h>
 
 #include <drm/drmP.h>
@@ -133,6 +134,70 @@ static inline void i915_ggtt_invalidate(struct drm_i915_private *i915)
 	i915->ggtt.invalidate(i915);
 }
 
+/*
+ * Our hardware cannot invalidate a range of the TLB, only all of it. So
+ * instead whilst binding all the objects for an execbuf, we record that an
+ * invalidate is required and only emit the one once every object is bound
+ * (before anyone may access them through the new PTE).
+ *
+ * Only the vma binds (which are all under struct_mutex) are deferred;
+ * insert_page() is used for immediate access through the aperture, and so
+ * must always invalidate.
+ */
+static bool ggtt_defer_invalidate(struct i915_ggtt *ggtt)
+{
+	if (!ggtt->invalidate_defer)
+		return false;
+
+	if (ggtt->invalidate_pending)
+		ggtt->invalidate_saved++;
+	ggtt->invalidate_pending = true;
+	return true;
+}
+
+static void ggtt_invalidate_bind(struct i915_ggtt *ggtt)
+{
+	if (!ggtt_defer_invalidate(ggtt))
+		ggtt->invalidate(ggtt->vm.i915);
+}
+
+/**
+ * i915_ggtt_defer_invalidate - start batching GGTT TLB invalidations
+ * @i915: i915 device
+ *
+ * Until the matching i915_ggtt_flush_invalidate(), binding vma into the
+ * GGTT does not invalidate the TLB; a single invalidation covering all the
+ * binds is instead performed by i915_ggtt_flush_invalidate(). Nothing may
+ * be accessed through the newly bound PTEs until then.
+ */
+void i915_ggtt_defer_invalidate(struct drm_i915_private *i915)
+{
+	lockdep_assert_held(&i915->drm.struct_mutex);
+	i915->ggtt.invalidate_defer++;
+}
+
+/**
+ * i915_ggtt_flush_invalidate - emit the batched GGTT TLB invalidation
+ * @i915: i915 device
+ */
+void i915_ggtt_flush_invalidate(struct drm_i915_private *i915)
+{
+	struct i915_ggtt *ggtt = &i915->ggtt;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+	GEM_BUG_ON(!ggtt->invalidate_defer);
+
+	if (--ggtt->invalidate_defer)
+		return;
+
+	if (!fetch_and_zero(&ggtt->invalidate_pending))
+		return;
+
+	intel_runtime_pm_get(i915);
+	i915_ggtt_invalidate(i915);
+	intel_runtime_pm_put(i915);
+}
+
 int intel_sanitize_enable_ppgtt(struct drm_i915_private *dev_priv,
 			       	int enable_ppgtt)
 {
@@ -182,32 +247,305 @@ int intel_sanitize_enable_ppgtt(struct drm_i915_private *dev_priv,
 	return 1;
 }
 
+static struct sg_table *
+intel_partial_pages(const struct i915_ggtt_view *view,
+		    struct drm_i915_gem_object *obj);
+
+static u32 ppgtt_pte_flags(const struct i915_vma *vma)
+{
+	/* Applicable to VLV, and gen8+ */
+	if (i915_gem_object_is_readonly(vma->obj))
+		return PTE_READ_ONLY;
+
+	return 0;
+}
+
+static u64 sparse_chunk_length(const struct i915_vma *vma, unsigned int chunk)
+{
+	u64 offset = (u64)chunk * I915_VMA_SPARSE_CHUNK;
+
+	return min_t(u64, vma->obj->base.size - offset, I915_VMA_SPARSE_CHUNK);
+}
+
+static unsigned int sparse_chunk_count(const struct i915_vma *vma)
+{
+	return DIV_ROUND_UP_ULL(vma->obj->base.size, I915_VMA_SPARSE_CHUNK);
+}
+
+static int sparse_insert_chunk(struct i915_vma *vma, unsigned int chunk,
+			       enum i915_cache_level cache_level)
+{
+	u64 offset = (u64)chunk * I915_VMA_SPARSE_CHUNK;
+	u64 length = sparse_chunk_length(vma, chunk);
+	struct i915_ggtt_view view = {
+		.type = I915_GGTT_VIEW_PARTIAL,
+		.partial.offset = offset >> PAGE_SHIFT,
+		.partial.size = length >> PAGE_SHIFT,
+	};
+	struct i915_vma *part;
+	int err = 0;
+
+	/*
+	 * The insert_entries() backends take their range and backing store
+	 * from the vma, so describe the chunk with a transient vma that only
+	 * carries the fields they look at. Always use 4K PTEs for the chunk,
+	 * the rest of the 2M page directory may still point at scratch.
+	 */
+	part = kzalloc(sizeof(*part), GFP_KERNEL);
+	if (!part)
+		return -ENOMEM;
+
+	part->vm = vma->vm;
+	part->obj = vma->obj;
+	part->node.start = vma->node.start + offset;
+	part->node.size = length;
+	part->size = length;
+	part->page_sizes.sg = I915_GTT_PAGE_SIZE_4K;
+
+	part->pages = intel_partial_pages(&view, vma->obj);
+	if (IS_ERR(part->pages)) {
+		err = PTR_ERR(part->pages);
+		goto out;
+	}
+
+	vma->vm->insert_entries(vma->vm, part, cache_level,
+				ppgtt_pte_flags(vma));
+
+	sg_free_table(part->pages);
+	kfree(part->pages);
+out:
+	kfree(part);
+	return err;
+}
+
+/**
+ * i915_vma_sparse_bind - populate part of a sparse vma in the ppgtt
+ * @vma: the sparse vma, already bound (i.e. with its address range reserved)
+ * @offset: byte offset into the vma of the range to populate
+ * @length: length in bytes of the range
+ *
+ * A sparse vma only reserves its address range when it is bound, the page
+ * tables and PTEs are filled in on demand in I915_VMA_SPARSE_CHUNK sized
+ * pieces, with every range not yet touched reading from the scratch page.
+ * The caller must hold the vma pinned, and struct_mutex.
+ *
+ * Returns 0 on success, negative error code on failure.
+ */
+int i915_vma_sparse_bind(struct i915_vma *vma, u64 offset, u64 length)
+{
+	unsigned int first, last, chunk;
+	int err;
+
+	lockdep_assert_held(&vma->vm->i915->drm.struct_mutex);
+	GEM_BUG_ON(!i915_vma_is_pinned(vma));
+
+	if (!(vma->flags & I915_VMA_SPARSE))
+		return 0;
+
+	GEM_BUG_ON(!vma->sparse);
+	if (!length || range_overflows_t(u64, offset, length,
+					 vma->obj->base.size))
+		return -EINVAL;
+
+	first = offset / I915_VMA_SPARSE_CHUNK;
+	last = (offset + length - 1) / I915_VMA_SPARSE_CHUNK;
+	for (chunk = first; chunk <= last; chunk++) {
+		if (test_bit(chunk, vma->sparse))
+			continue;
+
+		err = vma->vm->allocate_va_range(vma->vm,
+						 vma->node.start +
+						 (u64)chunk * I915_VMA_SPARSE_CHUNK,
+						 sparse_chunk_length(vma, chunk));
+		if (err)
+			return err;
+
+		err = sparse_insert_chunk(vma, chunk, vma->obj->cache_level);
+		if (err) {
+			vma->vm->clear_range(vma->vm,
+					     vma->node.start +
+					     (u64)chunk * I915_VMA_SPARSE_CHUNK,
+					     sparse_chunk_length(vma, chunk));
+			return err;
+		}
+
+		__set_bit(chunk, vma->sparse);
+	}
+
+	return 0;
+}
+
+static int ppgtt_bind_sparse(struct i915_vma *vma,
+			     enum i915_cache_level cache_level)
+{
+	unsigned int chunk;
+	int err;
+
+	/* Only reserve the range; see i915_vma_sparse_bind() */
+	if (!(vma->flags & I915_VMA_LOCAL_BIND)) {
+		GEM_BUG_ON(vma->sparse);
+		vma->sparse = kcalloc(BITS_TO_LONGS(sparse_chunk_count(vma)),
+				      sizeof(*vma->sparse), GFP_KERNEL);
+		if (!vma->sparse)
+			return -ENOMEM;
+
+		return 0;
+	}
+
+	/* Rebinding (e.g. a change of cache level), rewrite what we have */
+	for_each_set_bit(chunk, vma->sparse, sparse_chunk_count(vma)) {
+		err = sparse_insert_chunk(vma, chunk, cache_level);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static void ppgtt_unbind_sparse(struct i915_vma *vma)
+{
+	unsigned int chunk;
+
+	for_each_set_bit(chunk, vma->sparse, sparse_chunk_count(vma))
+		vma->vm->clear_range(vma->vm,
+				     vma->node.start +
+				     (u64)chunk * I915_VMA_SPARSE_CHUNK,
+				     sparse_chunk_length(vma, chunk));
+
+	kfree(vma->sparse);
+	vma->sparse = NULL;
+	vma->flags &= ~I915_VMA_SPARSE;
+}
+
+/* Smaller objects are quicker to bind inline than to hand to a worker */
+#define I915_VMA_ASYNC_BIND_MIN SZ_2M
+
+struct ppgtt_bind {
+	struct dma_fence dma; /* Must be first for dma_fence_free() */
+	struct work_struct work;
+	struct i915_vma *vma;
+	enum i915_cache_level cache_level;
+};
+
+static DEFINE_SPINLOCK(ppgtt_bind_lock);
+
+static const char *ppgtt_bind_get_driver_name(struct dma_fence *fence)
+{
+	return DRIVER_NAME;
+}
+
+static const char *ppgtt_bind_get_timeline_name(struct dma_fence *fence)
+{
+	return "bind";
+}
+
+static bool ppgtt_bind_enable_signaling(struct dma_fence *fence)
+{
+	return true;
+}
+
+static const struct dma_fence_ops ppgtt_bind_ops = {
+	.get_driver_name = ppgtt_bind_get_driver_name,
+	.get_timeline_name = ppgtt_bind_get_timeline_name,
+	.enable_signaling = ppgtt_bind_enable_signaling,
+	.wait = dma_fence_default_wait,
+};
+
+static void ppgtt_bind_work(struct work_struct *wrk)
+{
+	struct ppgtt_bind *bind = container_of(wrk, typeof(*bind), work);
+	struct i915_vma *vma = bind->vma;
+
+	/*
+	 * The page tables were allocated for us before we were queued, and
+	 * the vma is kept bound (and so both it and its pages alive) until
+	 * we signal, so all that remains is to write the PTEs.
+	 */
+	vma->vm->insert_entries(vma->vm, vma, bind->cache_level,
+				ppgtt_pte_flags(vma));
+
+	dma_fence_signal(&bind->dma);
+	dma_fence_put(&bind->dma);
+}
+
+static bool ppgtt_bind_async(struct i915_vma *vma,
+			     enum i915_cache_level cache_level)
+{
+	struct ppgtt_bind *bind;
+
+	GEM_BUG_ON(vma->bind_fence);
+
+	bind = kmalloc(sizeof(*bind), GFP_KERNEL | __GFP_NOWARN);
+	if (!bind)
+		return false;
+
+	dma_fence_init(&bind->dma, &ppgtt_bind_ops, &ppgtt_bind_lock,
+		       vma->vm->i915->mm.unordered_timeline, 0);
+	INIT_WORK(&bind->work, ppgtt_bind_work);
+	bind->vma = vma;
+	bind->cache_level = cache_level;
+
+	vma->bind_fence = dma_fence_get(&bind->dma);
+	queue_work(system_unbound_wq, &bind->work);
+
+	return true;
+}
+
+static void ppgtt_wait_bind(struct i915_vma *vma)
+{
+	if (!vma->bind_fence)
+		return;
+
+	dma_fence_wait(vma->bind_fence, false);
+	dma_fence_put(vma->bind_fence);
+	vma->bind_fence = NULL;
+}
+
 static int ppgtt_bind_vma(struct i915_vma *vma,
 			  enum i915_cache_level cache_level,
 			  u32 unused)
 {
-	u32 pte_flags;
 	int err;
 
+	/* Never let an old asynchronous bind overwrite our new PTEs */
+	ppgtt_wait_bind(vma);
+
+	if (vma->flags & I915_VMA_SPARSE)
+		return ppgtt_bind_sparse(vma, cache_level);
+
 	if (!(vma->flags & I915_VMA_LOCAL_BIND)) {
 		err = vma->vm->allocate_va_range(vma->vm,
 						 vma->node.start, vma->size);
 		if (err)
 			return err;
-	}
 
-	/* Applicable to VLV, and gen8+ */
-	pte_flags = 0;
-	if (i915_gem_object_is_readonly(vma->obj))
-		pte_flags |= PTE_READ_ONLY;
+		/*
+		 * Writing the PTEs scales with the size of the object, so for
+		 * the large and freshly bound, leave that to a worker and let
+		 * the requests using the vma wait upon it instead of the
+		 * caller (see i915_vma_move_to_active()).
+		 */
+		if (vma->flags & I915_VMA_ASYNC_BIND &&
+		    vma->size >= I915_VMA_ASYNC_BIND_MIN &&
+		    ppgtt_bind_async(vma, cache_level))
+			return 0;
+	}
 
-	vma->vm->insert_entries(vma->vm, vma, cache_level, pte_flags);
+	vma->vm->insert_entries(vma->vm, vma, cache_level,
+				ppgtt_pte_flags(vma));
 
 	return 0;
 }
 
 static void ppgtt_unbind_vma(struct i915_vma *vma)
 {
+	ppgtt_wait_bind(vma);
+
+	if (vma->flags & I915_VMA_SPARSE) {
+		ppgtt_unbind_sparse(vma);
+		return;
+	}
+
 	vma->vm->clear_range(vma->vm, vma->node.start, vma->size);
 }
 
@@ -226,10 +564,9 @@ static void clear_pages(struct i915_vma *vma)
 {
 	GEM_BUG_ON(!vma->pages);
 
-	if (vma->pages != vma->obj->mm.pages) {
-		sg_free_table(vma->pages);
-		kfree(vma->pages);
-	}
+	/* A derived view is kept in vma->view_pages for rebinding */
+	GEM_BUG_ON(vma->pages != vma->obj->mm.pages &&
+		   vma->pages != vma->view_pages);
 	vma->pages = NULL;
 
 	memset(&vma->page_sizes, 0, sizeof(vma->page_sizes));
@@ -405,6 +742,154 @@ static void stash_push_pagevec(struct pagestash *stash, struct pagevec *pvec)
 	pvec->nr -= nr;
 }
 
+/* Upper bound on the WC pages kept by each node's pool, 8MiB */
+#define I915_WC_POOL_MAX_PAGES (SZ_8M >> PAGE_SHIFT)
+
+static int wc_pool_init(struct drm_i915_private *i915)
+{
+	int nid;
+
+	i915->mm.wc_pool = kcalloc(nr_node_ids, sizeof(*i915->mm.wc_pool),
+				   GFP_KERNEL);
+	if (!i915->mm.wc_pool)
+		return -ENOMEM;
+
+	for_each_node(nid) {
+		struct i915_wc_pool *pool = &i915->mm.wc_pool[nid];
+
+		spin_lock_init(&pool->lock);
+		INIT_LIST_HEAD(&pool->pages);
+	}
+
+	return 0;
+}
+
+static void wc_pool_fini(struct drm_i915_private *i915)
+{
+	if (!i915->mm.wc_pool)
+		return;
+
+	i915_gem_wc_pool_shrink(i915, ULONG_MAX);
+	kfree(i915->mm.wc_pool);
+	i915->mm.wc_pool = NULL;
+}
+
+static struct page *wc_pool_get(struct drm_i915_private *i915)
+{
+	struct i915_wc_pool *pool = &i915->mm.wc_pool[numa_mem_id()];
+	struct page *page = NULL;
+
+	if (!READ_ONCE(pool->count))
+		return NULL;
+
+	spin_lock(&pool->lock);
+	if (likely(pool->count)) {
+		page = list_first_entry(&pool->pages, typeof(*page), lru);
+		list_del(&page->lru);
+		pool->count--;
+	}
+	spin_unlock(&pool->lock);
+
+	return page;
+}
+
+/*
+ * Move as many of the WC pages in @pvec into the pool of their node as it
+ * has room for, leaving the remainder in @pvec.
+ */
+static void wc_pool_put_pagevec(struct drm_i915_private *i915,
+				struct pagevec *pvec)
+{
+	unsigned int i, nr = 0;
+
+	for (i = 0; i < pvec->nr; i++) {
+		struct page *page = pvec->pages[i];
+		struct i915_wc_pool *pool =
+			&i915->mm.wc_pool[page_to_nid(page)];
+
+		spin_lock_nested(&pool->lock, SINGLE_DEPTH_NESTING);
+		if (pool->count < I915_WC_POOL_MAX_PAGES) {
+			list_add(&page->lru, &pool->pages);
+			pool->count++;
+			page = NULL;
+		}
+		spin_unlock(&pool->lock);
+
+		if (page)
+			pvec->pages[nr++] = page;
+	}
+	pvec->nr = nr;
+}
+
+/**
+ * i915_gem_wc_pool_count - count the pages held by the WC page-table pool
+ * @i915: i915 device
+ *
+ * Returns the number of pages that i915_gem_wc_pool_shrink() could release.
+ */
+unsigned long i915_gem_wc_pool_count(struct drm_i915_private *i915)
+{
+	unsigned long count = 0;
+	int nid;
+
+	if (!i915->mm.wc_pool)
+		return 0;
+
+	for_each_node(nid)
+		count += READ_ONCE(i915->mm.wc_pool[nid].count);
+
+	return count;
+}
+
+/**
+ * i915_gem_wc_pool_shrink - return pooled WC page-table pages to the system
+ * @i915: i915 device
+ * @target: number of pages to release
+ *
+ * The pages are changed back to WB in batches, which may sleep.
+ *
+ * Returns the number of pages released.
+ */
+unsigned long i915_gem_wc_pool_shrink(struct drm_i915_private *i915,
+				      unsigned long target)
+{
+	unsigned long freed = 0;
+	struct pagevec pvec;
+	int nid;
+
+	if (!i915->mm.wc_pool)
+		return 0;
+
+	pagevec_init(&pvec);
+	for_each_node(nid) {
+		struct i915_wc_pool *pool = &i915->mm.wc_pool[nid];
+
+		while (freed < target) {
+			spin_lock(&pool->lock);
+			while (pool->count && pagevec_space(&pvec) &&
+			       freed + pagevec_count(&pvec) < target) {
+				struct page *page =
+					list_first_entry(&pool->pages,
+							 typeof(*page), lru);
+
+				list_del(&page->lru);
+				pool->count--;
+				pvec.pages[pvec.nr++] = page;
+			}
+			spin_unlock(&pool->lock);
+
+			if (!pagevec_count(&pvec))
+				break;
+
+			freed += pagevec_count(&pvec);
+			set_pages_array_wb(pvec.pages, pvec.nr);
+			__pagevec_release(&pvec);
+		}
+	}
+
+	return freed;
+}
+
 static struct page *vm_alloc_page(struct i915_address_space *vm, gfp_t gfp)
 {
 	struct pagevec stack;
@@ -420,8 +905,8 @@ static struct page *vm_alloc_page(struct i915_address_space *vm, gfp_t gfp)
 	if (!vm->pt_kmap_wc)
 		return alloc_page(gfp);
 
-	/* Look in our global stash of WC pages... */
-	page = stash_pop_page(&vm->i915->mm.wc_stash);
+	/* Look in our global pool of WC pages... */
+	page = wc_pool_get(vm->i915);
 	if (page)
 		return page;
 
@@ -429,9 +914,9 @@ static struct page *vm_alloc_page(struct i915_address_space *vm, gfp_t gfp)
 	 * Otherwise batch allocate pages to amortize cost of set_pages_wc.
 	 *
 	 * We have to be careful as page allocation may trigger the shrinker
-	 * (via direct reclaim) which will fill up the WC stash underneath us.
+	 * (via direct reclaim) which will drain the WC pool underneath us.
 	 * So we add our WB pages into a temporary pvec on the stack and merge
-	 * them into the WC stash after all the allocations are complete.
+	 * them into the WC pool after all the allocations are complete.
 	 */
 	pagevec_init(&stack);
 	do {
@@ -447,8 +932,8 @@ static struct page *vm_alloc_page(struct i915_address_space *vm, gfp_t gfp)
 	if (stack.nr && !set_pages_array_wc(stack.pages, stack.nr)) {
 		page = stack.pages[--stack.nr];
 
-		/* Merge spare WC pages to the global stash */
-		stash_push_pagevec(&vm->i915->mm.wc_stash, &stack);
+		/* Merge spare WC pages to the global pool */
+		wc_pool_put_pagevec(vm->i915, &stack);
 
 		/* Push any surplus WC pages onto the local VM stash */
 		if (stack.nr)
@@ -475,10 +960,10 @@ static void vm_free_pages_release(struct i915_address_space *vm,
 
 	if (vm->pt_kmap_wc) {
 		/*
-		 * When we use WC, first fill up the global stash and then
+		 * When we use WC, first fill up the global pool and then
 		 * only if full immediately free the overflow.
 		 */
-		stash_push_pagevec(&vm->i915->mm.wc_stash, pvec);
+		wc_pool_put_pagevec(vm->i915, pvec);
 
 		/*
 		 * As we have made some room in the VM's free_pages,
@@ -1014,6 +1499,72 @@ static inline struct sgt_dma {
 	return (struct sgt_dma) { sg, addr, addr + sg->length };
 }
 
+/*
+ * Writing a run of PTEs for contiguous dma addresses is just a store of
+ * an incrementing value (the flags live below PAGE_SHIFT, so never carry).
+ * For the longer runs, we use SSE2 to encode and store 4 PTEs per
+ * iteration, which is worth the cost of preserving the FPU state.
+ */
+#define GEN8_FILL_PTES_SIMD_MIN 128
+
+static void gen8_fill_ptes_scalar(gen8_pte_t *pte,
+				  gen8_pte_t encode,
+				  unsigned int count)
+{
+	while (count--) {
+		*pte++ = encode;
+		encode += PAGE_SIZE;
+	}
+}
+
+#ifdef CONFIG_X86_64
+static void gen8_fill_ptes_sse2(gen8_pte_t *pte,
+				gen8_pte_t encode,
+				unsigned int count)
+{
+	const u64 base[2] __aligned(16) = { encode, encode + PAGE_SIZE };
+	const u64 step[2] __aligned(16) = { 2 * PAGE_SIZE, 2 * PAGE_SIZE };
+
+	kernel_fpu_begin();
+
+	/* xmm0 = ptes [0, 1], xmm2 = ptes [2, 3], xmm1 = 4 pages */
+	asm volatile("movdqa %0, %%xmm0\n"
+		     "movdqa %1, %%xmm1\n"
+		     "movdqa %%xmm0, %%xmm2\n"
+		     "paddq %%xmm1, %%xmm2\n"
+		     "paddq %%xmm1, %%xmm1\n"
+		     :: "m" (base), "m" (step));
+
+	for (; count >= 4; count -= 4) {
+		asm volatile("movdqu %%xmm0, (%0)\n"
+			     "movdqu %%xmm2, 16(%0)\n"
+			     "paddq %%xmm1, %%xmm0\n"
+			     "paddq %%xmm1, %%xmm2\n"
+			     :: "r" (pte) : "memory");
+		pte += 4;
+		encode += 4 * PAGE_SIZE;
+	}
+
+	kernel_fpu_end();
+
+	gen8_fill_ptes_scalar(pte, encode, count);
+}
+#endif
+
+static void gen8_fill_ptes(gen8_pte_t *pte,
+			   gen8_pte_t encode,
+			   unsigned int count)
+{
+#ifdef CONFIG_X86_64
+	if (count >= GEN8_FILL_PTES_SIMD_MIN && irq_fpu_usable()) {
+		gen8_fill_ptes_sse2(pte, encode, count);
+		return;
+	}
+#endif
+
+	gen8_fill_ptes_scalar(pte, encode, count);
+}
+
 struct gen8_insert_pte {
 	u16 pml4e;
 	u16 pdpe;
@@ -1048,9 +1599,17 @@ gen8_ppgtt_insert_pte_entries(struct i915_hw_ppgtt *ppgtt,
 	pd = pdp->page_directory[idx->pdpe];
 	vaddr = kmap_atomic_px(pd->page_table[idx->pde]);
 	do {
-		vaddr[idx->pte] = pte_encode | iter->dma;
+		unsigned int count;
+
+		/* Fill the run of contiguous pages within this page table */
+		count = min_t(u64,
+			      DIV_ROUND_UP(iter->max - iter->dma, PAGE_SIZE),
+			      GEN8_PTES - idx->pte);
+		gen8_fill_ptes(vaddr + idx->pte, pte_encode | iter->dma, count);
+
+		iter->dma += (u64)count << PAGE_SHIFT;
+		idx->pte += count;
 
-		iter->dma += PAGE_SIZE;
 		if (iter->dma >= iter->max) {
 			iter->sg = __sg_next(iter->sg);
 			if (!iter->sg) {
@@ -1062,7 +1621,7 @@ gen8_ppgtt_insert_pte_entries(struct i915_hw_ppgtt *ppgtt,
 			iter->max = iter->dma + iter->sg->length;
 		}
 
-		if (++idx->pte == GEN8_PTES) {
+		if (idx->pte == GEN8_PTES) {
 			idx->pte = 0;
 
 			if (++idx->pde == I915_PDES) {
@@ -1954,7 +2513,8 @@ static int gen6_alloc_va_range(struct i915_address_space *vm,
 
 	if (flush) {
 		mark_tlbs_dirty(&ppgtt->base);
-		gen6_ggtt_invalidate(ppgtt->base.vm.i915);
+		if (!ggtt_defer_invalidate(&vm->i915->ggtt))
+			gen6_ggtt_invalidate(vm->i915);
 	}
 
 	return 0;
@@ -2048,7 +2608,8 @@ static int pd_vma_bind(struct i915_vma *vma,
 		gen6_write_pde(ppgtt, pde, pt);
 
 	mark_tlbs_dirty(&ppgtt->base);
-	gen6_ggtt_invalidate(ppgtt->base.vm.i915);
+	if (!ggtt_defer_invalidate(ggtt))
+		gen6_ggtt_invalidate(ppgtt->base.vm.i915);
 
 	return 0;
 }
@@ -2288,6 +2849,7 @@ i915_ppgtt_create(struct drm_i915_private *i915,
 		return ppgtt;
 
 	ppgtt->vm.file = fpriv;
+	ppgtt->open_count = 1;
 
 	trace_i915_ppgtt_create(&ppgtt->vm);
 
@@ -2296,6 +2858,13 @@ i915_ppgtt_create(struct drm_i915_private *i915,
 
 void i915_ppgtt_close(struct i915_address_space *vm)
 {
+	struct i915_hw_ppgtt *ppgtt = i915_vm_to_ppgtt(vm);
+
+	/* Only the last of the contexts sharing the vm closes it */
+	GEM_BUG_ON(!ppgtt->open_count);
+	if (--ppgtt->open_count)
+		return;
+
 	GEM_BUG_ON(vm->closed);
 	vm->closed = true;
 }
@@ -2416,6 +2985,74 @@ void i915_check_and_clear_faults(struct drm_i915_private *dev_priv)
 		return;
 }
 
+static unsigned int ggtt_pte_size(const struct i915_ggtt *ggtt)
+{
+	return INTEL_GEN(ggtt->vm.i915) >= 8 ?
+		sizeof(gen8_pte_t) : sizeof(gen6_pte_t);
+}
+
+/*
+ * Rather than re-encode every PTE of every bound vma from its sg_table upon
+ * resume, keep a copy of the PTEs as they stand in the GSM at suspend and
+ * write them straight back. Nothing may be bound into, or unbound from, the
+ * GGTT in between, as is the case for the suspend/resume sequence, and
+ * should we fail to allocate the image we simply rebind on resume as before.
+ */
+static void ggtt_save_ptes(struct i915_ggtt *ggtt)
+{
+	const unsigned int sz = ggtt_pte_size(ggtt);
+	struct i915_vma *vma;
+
+	/* A stale image from an aborted suspend is of no use */
+	kvfree(ggtt->pte_image);
+	ggtt->pte_image = NULL;
+
+	if (!ggtt->gsm || intel_vgpu_active(ggtt->vm.i915))
+		return;
+
+	if (!list_empty(&ggtt->vm.active_list))
+		return;
+
+	ggtt->pte_image = kvmalloc_array(ggtt->vm.total >> PAGE_SHIFT, sz,
+					 GFP_KERNEL | __GFP_NOWARN);
+	if (!ggtt->pte_image)
+		return;
+
+	list_for_each_entry(vma, &ggtt->vm.inactive_list, vm_link) {
+		const u64 offset = (vma->node.start >> PAGE_SHIFT) * sz;
+
+		if (!(vma->flags & I915_VMA_GLOBAL_BIND))
+			continue;
+
+		memcpy_fromio(ggtt->pte_image + offset, ggtt->gsm + offset,
+			      (vma->node.size >> PAGE_SHIFT) * sz);
+	}
+}
+
+static bool ggtt_restore_ptes(struct i915_ggtt *ggtt)
+{
+	const unsigned int sz = ggtt_pte_size(ggtt);
+	struct i915_vma *vma;
+
+	if (!ggtt->pte_image)
+		return false;
+
+	list_for_each_entry(vma, &ggtt->vm.inactive_list, vm_link) {
+		const u64 offset = (vma->node.start >> PAGE_SHIFT) * sz;
+
+		if (!(vma->flags & I915_VMA_GLOBAL_BIND))
+			continue;
+
+		memcpy_toio(ggtt->gsm + offset, ggtt->pte_image + offset,
+			    (vma->node.size >> PAGE_SHIFT) * sz);
+	}
+
+	kvfree(ggtt->pte_image);
+	ggtt->pte_image = NULL;
+
+	return true;
+}
+
 void i915_gem_suspend_gtt_mappings(struct drm_i915_private *dev_priv)
 {
 	struct i915_ggtt *ggtt = &dev_priv->ggtt;
@@ -2428,6 +3065,8 @@ void i915_gem_suspend_gtt_mappings(struct drm_i915_private *dev_priv)
 
 	i915_check_and_clear_faults(dev_priv);
 
+	ggtt_save_ptes(ggtt);
+
 	ggtt->vm.clear_range(&ggtt->vm, 0, ggtt->vm.total);
 
 	i915_ggtt_invalidate(dev_priv);
@@ -2485,10 +3124,9 @@ static void gen8_ggtt_insert_entries(struct i915_address_space *vm,
 				     u32 flags)
 {
 	struct i915_ggtt *ggtt = i915_vm_to_ggtt(vm);
-	struct sgt_iter sgt_iter;
 	gen8_pte_t __iomem *gtt_entries;
 	const gen8_pte_t pte_encode = gen8_pte_encode(0, level, 0);
-	dma_addr_t addr;
+	struct scatterlist *sg;
 
 	/*
 	 * Note that we ignore PTE_READ_ONLY here. The caller must be careful
@@ -2497,14 +3135,22 @@ static void gen8_ggtt_insert_entries(struct i915_address_space *vm,
 
 	gtt_entries = (gen8_pte_t __iomem *)ggtt->gsm;
 	gtt_entries += vma->node.start >> PAGE_SHIFT;
-	for_each_sgt_dma(addr, sgt_iter, vma->pages)
-		gen8_set_pte(gtt_entries++, pte_encode | addr);
+	for (sg = vma->pages->sgl; sg; sg = __sg_next(sg)) {
+		unsigned int count = DIV_ROUND_UP(sg_dma_len(sg), PAGE_SIZE);
+		gen8_pte_t encode = pte_encode | sg_dma_address(sg);
+
+		/* The GSM is an iomem mapping (UC on some parts), keep to writeq */
+		while (count--) {
+			gen8_set_pte(gtt_entries++, encode);
+			encode += PAGE_SIZE;
+		}
+	}
 
 	/*
 	 * We want to flush the TLBs only after we're certain all the PTE
 	 * updates have finished.
 	 */
-	ggtt->invalidate(vm->i915);
+	ggtt_invalidate_bind(ggtt);
 }
 
 static void gen6_ggtt_insert_page(struct i915_address_space *vm,
@@ -2545,7 +3191,7 @@ static void gen6_ggtt_insert_entries(struct i915_address_space *vm,
 	 * We want to flush the TLBs only after we're certain all the PTE
 	 * updates have finished.
 	 */
-	ggtt->invalidate(vm->i915);
+	ggtt_invalidate_bind(ggtt);
 }
 
 static void nop_clear_range(struct i915_address_space *vm,
@@ -2722,6 +3368,177 @@ static void i915_ggtt_clear_range(struct i915_address_space *vm,
 	intel_gtt_clear_range(start >> PAGE_SHIFT, length >> PAGE_SHIFT);
 }
 
+/* Large binds into the GGTT may be left for the GPU to write instead */
+#define I915_GGTT_GPU_BIND_MIN SZ_4M
+#define GGTT_UPDATE_MAX_PTES 511 /* limited by the MI_UPDATE_GTT length */
+
+static struct intel_engine_cs *ggtt_bind_engine(struct drm_i915_private *i915)
+{
+	/* Prefer the blitter, out of the way of rendering */
+	return i915->engine[BCS] ?: i915->engine[RCS];
+}
+
+/*
+ * Stage the PTEs into a batch of MI_UPDATE_GTT, followed by the GGTT TLB
+ * invalidation, and execute that from the kernel context rather than
+ * stream the PTEs into the GSM with the CPU. vma->bind_fence is
+ * signaled once the PTEs are in place.
+ */
+static bool ggtt_bind_gpu(struct i915_vma *vma,
+			  enum i915_cache_level cache_level)
+{
+	struct drm_i915_private *i915 = vma->vm->i915;
+	struct i915_ggtt *ggtt = i915_vm_to_ggtt(vma->vm);
+	const gen8_pte_t pte_encode = gen8_pte_encode(0, cache_level, 0);
+	struct intel_engine_cs *engine;
+	struct drm_i915_gem_object *obj;
+	struct sgt_iter sgt_iter;
+	struct i915_request *rq;
+	struct i915_vma *batch;
+	unsigned int count, remain, len;
+	dma_addr_t daddr;
+	u32 addr, *cs;
+	int err;
+
+	engine = ggtt_bind_engine(i915);
+	if (!engine || i915_terminally_wedged(&i915->gpu_error))
+		return false;
+
+	count = 0;
+	for_each_sgt_dma(daddr, sgt_iter, vma->pages)
+		count++;
+
+	len = 3 + 3 + 1; /* TLB invalidate (for GuC too), BB_END */
+	len += 2 * DIV_ROUND_UP(count, GGTT_UPDATE_MAX_PTES);
+	len += 2 * count;
+
+	obj = i915_gem_object_create_internal(i915,
+					      round_up(len * sizeof(u32),
+						       PAGE_SIZE));
+	if (IS_ERR(obj))
+		return false;
+
+	cs = i915_gem_object_pin_map(obj, I915_MAP_WC);
+	if (IS_ERR(cs))
+		goto err_obj;
+
+	/* Walk the DMA pages just as gen8_ggtt_insert_entries() does */
+	addr = lower_32_bits(vma->node.start);
+	remain = 0;
+	for_each_sgt_dma(daddr, sgt_iter, vma->pages) {
+		if (!remain) {
+			remain = min(count, GGTT_UPDATE_MAX_PTES);
+			count -= remain;
+
+			*cs++ = MI_UPDATE_GTT | (2 * remain);
+			*cs++ = addr;
+			addr += remain * PAGE_SIZE;
+		}
+
+		*(gen8_pte_t *)cs = pte_encode | daddr;
+		cs += 2;
+		remain--;
+	}
+
+	*cs++ = MI_LOAD_REGISTER_IMM(1);
+	*cs++ = i915_mmio_reg_offset(GFX_FLSH_CNTL_GEN6);
+	*cs++ = GFX_FLSH_CNTL_EN;
+	if (ggtt->invalidate == guc_ggtt_invalidate) {
+		*cs++ = MI_LOAD_REGISTER_IMM(1);
+		*cs++ = i915_mmio_reg_offset(GEN8_GTCR);
+		*cs++ = GEN8_GTCR_INVALIDATE;
+	}
+	*cs++ = MI_BATCH_BUFFER_END;
+
+	i915_gem_object_unpin_map(obj);
+
+	batch = i915_vma_instance(obj, &ggtt->vm, NULL);
+	if (IS_ERR(batch))
+		goto err_obj;
+
+	/* Small enough to be bound by the CPU, as is the ring */
+	err = i915_vma_pin(batch, 0, 0, PIN_GLOBAL);
+	if (err)
+		goto err_obj;
+
+	rq = i915_request_alloc(engine, i915->kernel_context);
+	if (IS_ERR(rq))
+		goto err_unpin;
+
+	err = engine->emit_bb_start(rq, batch->node.start,
+				    len * sizeof(u32), I915_DISPATCH_SECURE);
+	if (!err)
+		err = i915_vma_move_to_active(batch, rq, 0);
+	if (err) {
+		i915_request_add(rq);
+		goto err_unpin;
+	}
+
+	GEM_BUG_ON(vma->bind_fence);
+	vma->bind_fence = dma_fence_get(&rq->fence);
+
+	i915_gem_object_set_active_reference(obj);
+	i915_vma_unpin(batch);
+	i915_request_add(rq);
+
+	return true;
+
+err_unpin:
+	i915_vma_unpin(batch);
+err_obj:
+	i915_gem_object_put(obj);
+	return false;
+}
+
+static int ggtt_wait_bind(struct i915_vma *vma)
+{
+	struct dma_fence *fence;
+	int err;
+
+	lockdep_assert_held(&vma->vm->i915->drm.struct_mutex);
+
+	fence = fetch_and_zero(&vma->bind_fence);
+	if (!fence)
+		return 0;
+
+	/*
+	 * We hold struct_mutex, so must let the reset handler borrow it
+	 * should the GPU hang before the PTEs are written.
+	 */
+	GEM_BUG_ON(!dma_fence_is_i915(fence));
+	i915_request_wait(to_request(fence),
+			  I915_WAIT_LOCKED, MAX_SCHEDULE_TIMEOUT);
+	err = fence->error;
+	dma_fence_put(fence);
+
+	return err;
+}
+
+/**
+ * i915_ggtt_wait_bind - wait for the GPU to write the PTEs of a GGTT vma
+ * @vma: the vma
+ *
+ * Large GGTT binds may be written by the GPU (see the enable_ggtt_gpu_bind
+ * modparam). Every user of the vma, i915_vma_move_to_active() included,
+ * must call this first. Should the bind have been cancelled by a reset,
+ * the PTEs are written by the CPU instead.
+ */
+void i915_ggtt_wait_bind(struct i915_vma *vma)
+{
+	GEM_BUG_ON(!i915_vma_is_ggtt(vma));
+
+	/* Should the update have been cancelled by a reset, redo it */
+	if (ggtt_wait_bind(vma) && vma->pages) {
+		struct drm_i915_private *i915 = vma->vm->i915;
+
+		intel_runtime_pm_get(i915);
+		vma->vm->insert_entries(vma->vm, vma,
+					vma->obj ? vma->obj->cache_level : 0,
+					0);
+		intel_runtime_pm_put(i915);
+	}
+}
+
 static int ggtt_bind_vma(struct i915_vma *vma,
 			 enum i915_cache_level cache_level,
 			 u32 flags)
@@ -2730,13 +3547,31 @@ static int ggtt_bind_vma(struct i915_vma *vma,
 	struct drm_i915_gem_object *obj = vma->obj;
 	u32 pte_flags;
 
+	/* Never let an outstanding update overwrite our new PTEs */
+	ggtt_wait_bind(vma);
+
 	/* Applicable to VLV (gen8+ do not support RO in the GGTT) */
 	pte_flags = 0;
 	if (i915_gem_object_is_readonly(obj))
 		pte_flags |= PTE_READ_ONLY;
 
 	intel_runtime_pm_get(i915);
-	vma->vm->insert_entries(vma->vm, vma, cache_level, pte_flags);
+	if (i915_modparams.enable_ggtt_gpu_bind &&
+	    !(vma->flags & I915_VMA_GLOBAL_BIND) &&
+	    vma->size >= I915_GGTT_GPU_BIND_MIN &&
+	    vma->vm->insert_entries == gen8_ggtt_insert_entries &&
+	    ggtt_bind_gpu(vma, cache_level)) {
+		/*
+		 * Unless only requests are going to use the vma (for which
+		 * i915_vma_move_to_active() completes the bind), our caller
+		 * expects the PTEs to be in place on return. We still spare
+		 * the CPU from writing them.
+		 */
+		if (!(vma->flags & I915_VMA_ASYNC_BIND))
+			i915_ggtt_wait_bind(vma);
+	} else {
+		vma->vm->insert_entries(vma->vm, vma, cache_level, pte_flags);
+	}
 	intel_runtime_pm_put(i915);
 
 	vma->page_sizes.gtt = I915_GTT_PAGE_SIZE;
@@ -2755,6 +3590,8 @@ static void ggtt_unbind_vma(struct i915_vma *vma)
 {
 	struct drm_i915_private *i915 = vma->vm->i915;
 
+	ggtt_wait_bind(vma);
+
 	intel_runtime_pm_get(i915);
 	vma->vm->clear_range(vma->vm, vma->node.start, vma->size);
 	intel_runtime_pm_put(i915);
@@ -2989,7 +3826,6 @@ void i915_ggtt_cleanup_hw(struct drm_i915_private *dev_priv)
 {
 	struct i915_ggtt *ggtt = &dev_priv->ggtt;
 	struct i915_vma *vma, *vn;
-	struct pagevec *pvec;
 
 	ggtt->vm.closed = true;
 
@@ -3010,11 +3846,7 @@ void i915_ggtt_cleanup_hw(struct drm_i915_private *dev_priv)
 
 	ggtt->vm.cleanup(&ggtt->vm);
 
-	pvec = &dev_priv->mm.wc_stash.pvec;
-	if (pvec->nr) {
-		set_pages_array_wb(pvec->pages, pvec->nr);
-		__pagevec_release(pvec);
-	}
+	wc_pool_fini(dev_priv);
 
 	mutex_unlock(&dev_priv->drm.struct_mutex);
 
@@ -3360,6 +4192,7 @@ static void gen6_gmch_remove(struct i915_address_space *vm)
 {
 	struct i915_ggtt *ggtt = i915_vm_to_ggtt(vm);
 
+	kvfree(ggtt->pte_image);
 	iounmap(ggtt->gsm);
 	cleanup_scratch_page(vm);
 }
@@ -3611,7 +4444,9 @@ int i915_ggtt_init_hw(struct drm_i915_private *dev_priv)
 	struct i915_ggtt *ggtt = &dev_priv->ggtt;
 	int ret;
 
-	stash_init(&dev_priv->mm.wc_stash);
+	ret = wc_pool_init(dev_priv);
+	if (ret)
+		return ret;
 
 	/* Note that we use page colouring to enforce a guard page at the
 	 * end of the address space. This is required as the CS may prefetch
@@ -3649,6 +4484,7 @@ int i915_ggtt_init_hw(struct drm_i915_private *dev_priv)
 
 out_gtt_cleanup:
 	ggtt->vm.cleanup(&ggtt->vm);
+	wc_pool_fini(dev_priv);
 	return ret;
 }
 
@@ -3693,10 +4529,23 @@ void i915_gem_restore_gtt_mappings(struct drm_i915_private *dev_priv)
 	/* First fill our portion of the GTT with scratch pages */
 	ggtt->vm.clear_range(&ggtt->vm, 0, ggtt->vm.total);
 
+	GEM_BUG_ON(!list_empty(&ggtt->vm.active_list));
+
+	/* With the PTEs saved at suspend, we need only flush the objects */
+	if (ggtt_restore_ptes(ggtt)) {
+		list_for_each_entry(vma, &ggtt->vm.inactive_list, vm_link) {
+			if (!(vma->flags & I915_VMA_GLOBAL_BIND) || !vma->obj)
+				continue;
+
+			WARN_ON(i915_gem_object_set_to_gtt_domain(vma->obj,
+								  false));
+		}
+		goto out;
+	}
+
 	ggtt->vm.closed = true; /* skip rewriting PTE on VMA unbind */
 
 	/* clflush objects bound into the GGTT and rebind them. */
-	GEM_BUG_ON(!list_empty(&ggtt->vm.active_list));
 	list_for_each_entry_safe(vma, vn, &ggtt->vm.inactive_list, vm_link) {
 		struct drm_i915_gem_object *obj = vma->obj;
 
@@ -3714,6 +4563,7 @@ void i915_gem_restore_gtt_mappings(struct drm_i915_private *dev_priv)
 	}
 
 	ggtt->vm.closed = false;
+out:
 	i915_ggtt_invalidate(dev_priv);
 
 	if (INTEL_GEN(dev_priv) >= 8) {
@@ -3937,23 +4787,41 @@ i915_get_ggtt_vma_pages(struct i915_vma *vma)
 		return 0;
 
 	case I915_GGTT_VIEW_ROTATED:
-		vma->pages =
-			intel_rotate_pages(&vma->ggtt_view.rotated, vma->obj);
-		break;
-
 	case I915_GGTT_VIEW_PARTIAL:
-		vma->pages = intel_partial_pages(&vma->ggtt_view, vma->obj);
 		break;
 	}
 
-	ret = 0;
+	/*
+	 * The derived views are costly to rebuild, so we keep them on the
+	 * vma (itself looked up by the view) across eviction for as long as
+	 * they were built from the current obj->mm.pages.
+	 */
+	if (vma->view_pages) {
+		if (vma->view_pages_gen == vma->obj->mm.pages_gen) {
+			vma->pages = vma->view_pages;
+			return 0;
+		}
+
+		i915_vma_free_view_pages(vma);
+	}
+
+	if (vma->ggtt_view.type == I915_GGTT_VIEW_ROTATED)
+		vma->pages =
+			intel_rotate_pages(&vma->ggtt_view.rotated, vma->obj);
+	else
+		vma->pages = intel_partial_pages(&vma->ggtt_view, vma->obj);
+
 	if (unlikely(IS_ERR(vma->pages))) {
 		ret = PTR_ERR(vma->pages);
 		vma->pages = NULL;
 		DRM_ERROR("Failed to get pages for VMA view type %u (%d)!\n",
 			  vma->ggtt_view.type, ret);
+		return ret;
 	}
-	return ret;
+
+	vma->view_pages = vma->pages;
+	vma->view_pages_gen = vma->obj->mm.pages_gen;
+	return 0;
 }
 
 /**
@@ -163,6 +163,19 @@ typedef u64 gen8_ppgtt_pml4e_t;
 #define GEN9_TRTT_SEG_SIZE_SHIFT	44
 #define GEN9_TRTT_SEGMENT_SIZE		(1ULL << GEN9_TRTT_SEG_SIZE_SHIFT)
 
+/*
+ * The segment is made of 64KiB tiles, translated through 3 levels of tables:
+ * L3 (64b entries, segment offset bits 43:35), L2 (32b entries, bits 34:25)
+ * and L1 (32b entries, bits 24:16).
+ */
+#define GEN9_TRTT_TILE_SHIFT		16
+#define GEN9_TRTT_TILE_SIZE		BIT_ULL(GEN9_TRTT_TILE_SHIFT)
+#define GEN9_TRTT_L3_SHIFT		35
+#define GEN9_TRTT_L2_SHIFT		25
+#define GEN9_TRTT_L3_ENTRIES		512
+#define GEN9_TRTT_L2_ENTRIES		1024
+#define GEN9_TRTT_L1_ENTRIES		512
+
 struct sg_table;
 
 struct intel_rotation_info {
@@ -334,6 +347,20 @@ struct i915_address_space {
 	 */
 	struct list_head unbound_list;
 
+	/**
+	 * Generation of the last execbuf on this address space, from which
+	 * the i915_vma.last_access used to order eviction is taken.
+	 */
+	u64 access_gen;
+
+	/** Eviction statistics, reported by debugfs/i915_gem_evict_info */
+	struct {
+		unsigned long calls;
+		unsigned long failures;
+		unsigned long vmas;
+		u64 bytes;
+	} evictions;
+
 	struct pagestash free_pages;
 
 	/* Some systems require uncached updates of the page directories */
@@ -400,7 +427,12 @@ struct i915_ggtt {
 	/** "Graphics Stolen Memory" holds the global PTEs */
 	phys_addr_t gsm_paddr;
 	void __iomem *gsm;
+	/** PTEs of the bound vma, saved across suspend */
+	void *pte_image;
 	void (*invalidate)(struct drm_i915_private *dev_priv);
+	unsigned int invalidate_defer; /* see i915_ggtt_defer_invalidate() */
+	bool invalidate_pending;
+	u64 invalidate_saved; /* invalidations elided by deferral */
 
 	bool do_idle_maps;
 
@@ -414,6 +446,7 @@ struct i915_ggtt {
 struct i915_hw_ppgtt {
 	struct i915_address_space vm;
 	struct kref ref;
+	unsigned int open_count; /* contexts using the vm, see i915_ppgtt_close() */
 
 	unsigned long pd_dirty_rings;
 	union {
@@ -630,11 +663,21 @@ void i915_ggtt_disable_guc(struct drm_i915_private *i915);
 int i915_gem_init_ggtt(struct drm_i915_private *dev_priv);
 void i915_ggtt_cleanup_hw(struct drm_i915_private *dev_priv);
 
+unsigned long i915_gem_wc_pool_count(struct drm_i915_private *i915);
+unsigned long i915_gem_wc_pool_shrink(struct drm_i915_private *i915,
+				      unsigned long target);
+
 int i915_ppgtt_init_hw(struct drm_i915_private *dev_priv);
 void i915_ppgtt_release(struct kref *kref);
 struct i915_hw_ppgtt *i915_ppgtt_create(struct drm_i915_private *dev_priv,
 					struct drm_i915_file_private *fpriv);
 void i915_ppgtt_close(struct i915_address_space *vm);
+
+static inline void i915_ppgtt_open(struct i915_hw_ppgtt *ppgtt)
+{
+	GEM_BUG_ON(!ppgtt->open_count);
+	ppgtt->open_count++;
+}
 static inline void i915_ppgtt_get(struct i915_hw_ppgtt *ppgtt)
 {
 	if (ppgtt)
@@ -655,6 +698,10 @@ void i915_gem_restore_gtt_mappings(struct drm_i915_private *dev_priv);
 
 int __must_check i915_gem_gtt_prepare_pages(struct drm_i915_gem_object *obj,
 					    struct sg_table *pages);
+void i915_ggtt_defer_invalidate(struct drm_i915_private *i915);
+void i915_ggtt_wait_bind(struct i915_vma *vma);
+void i915_ggtt_flush_invalidate(struct drm_i915_private *i915);
+
 void i915_gem_gtt_finish_pages(struct drm_i915_gem_object *obj,
 			       struct sg_table *pages);
 
@@ -0,0 +1,324 @@
+/*
+ * Copyright © 2018 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ *
+ */
+
+#include <linux/highmem.h>
+
+#include <drm/drmP.h>
+#include <drm/i915_drm.h>
+#include "i915_drv.h"
+
+/*
+ * The huge page pool is a reservation of 2M pages, taken at load time
+ * (see i915.huge_pool_mb) before physical memory becomes fragmented, from
+ * which we back the objects created with I915_GEM_CREATE_HUGE_POOL. Such
+ * objects are always assembled from the largest pages we can find, taking
+ * first from the pool and then, as a miss, from the page allocator in 2M,
+ * 64K and finally 4K chunks, so that they may use huge GTT entries. When
+ * the object releases its pages, the 2M pages are returned to refill the
+ * pool.
+ *
+ * As the pages are not backed by shmemfs, the objects cannot be swapped
+ * out nor be mmapped through the CPU, only through the GTT. Since that
+ * memory is pinned for the lifetime of the object, each client may only
+ * create up to i915.huge_pool_client_mb of such objects.
+ */
+
+#define QUIET (__GFP_NORETRY | __GFP_NOWARN)
+#define MAYFAIL (__GFP_RETRY_MAYFAIL | __GFP_NOWARN)
+#define HUGE_ORDER get_order(I915_GTT_PAGE_SIZE_2M)
+
+static struct page *pool_get(struct drm_i915_private *i915)
+{
+	struct page *page;
+
+	spin_lock(&i915->mm.huge_pool.lock);
+	page = list_first_entry_or_null(&i915->mm.huge_pool.pages,
+					typeof(*page), lru);
+	if (page) {
+		list_del(&page->lru);
+		i915->mm.huge_pool.count--;
+		i915->mm.huge_pool.hits++;
+	} else {
+		i915->mm.huge_pool.misses++;
+	}
+	spin_unlock(&i915->mm.huge_pool.lock);
+
+	return page;
+}
+
+static bool pool_put(struct drm_i915_private *i915, struct page *page)
+{
+	bool kept = false;
+
+	spin_lock(&i915->mm.huge_pool.lock);
+	if (i915->mm.huge_pool.count < i915->mm.huge_pool.capacity) {
+		list_add(&page->lru, &i915->mm.huge_pool.pages);
+		i915->mm.huge_pool.count++;
+		kept = true;
+	}
+	spin_unlock(&i915->mm.huge_pool.lock);
+
+	return kept;
+}
+
+static void clear_pages(struct page *page, unsigned int order)
+{
+	unsigned int n;
+
+	for (n = 0; n < 1u << order; n++)
+		clear_highpage(page + n);
+}
+
+static void huge_pool_free_pages(struct drm_i915_private *i915,
+				 struct sg_table *st)
+{
+	struct scatterlist *sg;
+
+	for (sg = st->sgl; sg; sg = __sg_next(sg)) {
+		struct page *page = sg_page(sg);
+		unsigned int order;
+
+		if (!page)
+			continue;
+
+		order = get_order(sg->length);
+		if (order == HUGE_ORDER && pool_put(i915, page))
+			continue;
+
+		__free_pages(page, order);
+	}
+
+	sg_free_table(st);
+	kfree(st);
+}
+
+static int i915_gem_object_get_pages_huge_pool(struct drm_i915_gem_object *obj)
+{
+	static const unsigned int orders[] = {
+		HUGE_ORDER,
+		get_order(I915_GTT_PAGE_SIZE_64K),
+		0,
+	};
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	unsigned int sg_page_sizes;
+	struct scatterlist *sg;
+	struct sg_table *st;
+	unsigned int npages;
+	unsigned int i;
+	gfp_t gfp;
+
+	/* Not reclaimable: we hold on to the pages until the object is freed */
+	gfp = GFP_KERNEL | __GFP_HIGHMEM | __GFP_COMP;
+
+	st = kmalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	npages = obj->base.size / PAGE_SIZE;
+	if (sg_alloc_table(st, npages, GFP_KERNEL)) {
+		kfree(st);
+		return -ENOMEM;
+	}
+
+	sg = st->sgl;
+	st->nents = 0;
+	sg_page_sizes = 0;
+
+	i = 0;
+	do {
+		struct page *page = NULL;
+		unsigned int order;
+
+		while ((1u << orders[i]) > npages)
+			i++;
+		order = orders[i];
+
+		if (order == HUGE_ORDER)
+			page = pool_get(i915);
+		if (page) {
+			/* Recycled from another object, so scrub it */
+			clear_pages(page, order);
+		} else {
+			do {
+				page = alloc_pages(gfp | __GFP_ZERO |
+						   (order ? QUIET : MAYFAIL),
+						   order);
+				if (page)
+					break;
+
+				/* Limit subsequent allocations as well */
+				if (!order)
+					goto err;
+				order = orders[++i];
+			} while (1);
+		}
+
+		sg_set_page(sg, page, PAGE_SIZE << order, 0);
+		sg_page_sizes |= PAGE_SIZE << order;
+		st->nents++;
+
+		npages -= 1 << order;
+		if (!npages) {
+			sg_mark_end(sg);
+			break;
+		}
+
+		sg = __sg_next(sg);
+	} while (1);
+
+	if (i915_gem_gtt_prepare_pages(obj, st))
+		goto err;
+
+	__i915_gem_object_set_pages(obj, st, sg_page_sizes);
+
+	return 0;
+
+err:
+	sg_set_page(sg, NULL, 0, 0);
+	sg_mark_end(sg);
+	huge_pool_free_pages(i915, st);
+
+	return -ENOMEM;
+}
+
+static void
+i915_gem_object_put_pages_huge_pool(struct drm_i915_gem_object *obj,
+				    struct sg_table *pages)
+{
+	i915_gem_gtt_finish_pages(obj, pages);
+	huge_pool_free_pages(to_i915(obj->base.dev), pages);
+
+	obj->mm.dirty = false;
+}
+
+static const struct drm_i915_gem_object_ops i915_gem_object_huge_pool_ops = {
+	.flags = I915_GEM_OBJECT_HAS_STRUCT_PAGE,
+	.get_pages = i915_gem_object_get_pages_huge_pool,
+	.put_pages = i915_gem_object_put_pages_huge_pool,
+};
+
+/**
+ * i915_gem_object_create_huge_pool: create an object backed by huge pages
+ * @i915: the i915 device
+ * @file: the client creating the object, to which it is charged
+ * @size: the size in bytes of backing storage to allocate for the object
+ *
+ * Creates a new object whose backing storage is taken from the device's
+ * pool of 2M pages, falling back to the largest pages available. The pages
+ * are not swappable and are retained until the object is freed, so the
+ * client may own no more than i915.huge_pool_client_mb of such objects.
+ *
+ * Return: the new object, or an error pointer (-ENOSPC if over the limit).
+ */
+struct drm_i915_gem_object *
+i915_gem_object_create_huge_pool(struct drm_i915_private *i915,
+				 struct drm_file *file, u64 size)
+{
+	struct drm_i915_gem_object *obj;
+	unsigned int cache_level;
+	u64 limit;
+	int err;
+
+	GEM_BUG_ON(!size);
+	GEM_BUG_ON(!IS_ALIGNED(size, PAGE_SIZE));
+
+	if (overflows_type(size, obj->base.size))
+		return ERR_PTR(-E2BIG);
+
+	obj = i915_gem_object_alloc(i915);
+	if (!obj)
+		return ERR_PTR(-ENOMEM);
+
+	drm_gem_private_object_init(&i915->drm, &obj->base, size);
+	i915_gem_object_init(obj, &i915_gem_object_huge_pool_ops);
+
+	obj->read_domains = I915_GEM_DOMAIN_CPU;
+	obj->write_domain = I915_GEM_DOMAIN_CPU;
+
+	cache_level = HAS_LLC(i915) ? I915_CACHE_LLC : I915_CACHE_NONE;
+	i915_gem_object_set_cache_coherency(obj, cache_level);
+
+	limit = (u64)i915_modparams.huge_pool_client_mb << 20;
+	err = i915_gem_object_set_client_limited(obj, file,
+						 I915_GEM_CLIENT_HUGE_POOL,
+						 limit);
+	if (err) {
+		i915_gem_object_put(obj);
+		return ERR_PTR(err);
+	}
+
+	return obj;
+}
+
+/**
+ * i915_gem_huge_pool_init: reserve the pool of 2M pages
+ * @i915: the i915 device
+ *
+ * Fills the pool with up to i915.huge_pool_mb of 2M pages. Failing to
+ * allocate all of them is not fatal, the pool is merely smaller (and
+ * will be topped back up by objects returning pages from elsewhere).
+ */
+void i915_gem_huge_pool_init(struct drm_i915_private *i915)
+{
+	unsigned long capacity;
+
+	spin_lock_init(&i915->mm.huge_pool.lock);
+	INIT_LIST_HEAD(&i915->mm.huge_pool.pages);
+
+	capacity = (u64)i915_modparams.huge_pool_mb * SZ_1M /
+		   I915_GTT_PAGE_SIZE_2M;
+	i915->mm.huge_pool.capacity = capacity;
+
+	while (i915->mm.huge_pool.count < capacity) {
+		struct page *page;
+
+		page = alloc_pages(GFP_KERNEL | __GFP_HIGHMEM | __GFP_COMP |
+				   __GFP_RETRY_MAYFAIL | __GFP_NOWARN,
+				   HUGE_ORDER);
+		if (!page)
+			break;
+
+		list_add(&page->lru, &i915->mm.huge_pool.pages);
+		i915->mm.huge_pool.count++;
+	}
+
+	if (i915->mm.huge_pool.count < capacity)
+		DRM_NOTE("Only reserved %lu of %lu pages for the huge page pool\n",
+			 i915->mm.huge_pool.count, capacity);
+}
+
+/**
+ * i915_gem_huge_pool_fini: release the pool of 2M pages
+ * @i915: the i915 device
+ */
+void i915_gem_huge_pool_fini(struct drm_i915_private *i915)
+{
+	struct page *page, *next;
+
+	list_for_each_entry_safe(page, next, &i915->mm.huge_pool.pages, lru)
+		__free_pages(page, HUGE_ORDER);
+	INIT_LIST_HEAD(&i915->mm.huge_pool.pages);
+	i915->mm.huge_pool.count = 0;
+	i915->mm.huge_pool.capacity = 0;
+}
@@ -37,6 +37,7 @@
 #include "i915_selftest.h"
 
 struct drm_i915_gem_object;
+struct i915_gem_client_memory;
 
 /*
  * struct i915_lut_handle tracks the fast lookups from handle to vma used
@@ -77,6 +78,7 @@ struct drm_i915_gem_object_ops {
 		      const struct drm_i915_gem_pwrite *);
 
 	int (*dmabuf_export)(struct drm_i915_gem_object *);
+	void (*dmabuf_release)(struct drm_i915_gem_object *, struct dma_buf *);
 	void (*release)(struct drm_i915_gem_object *);
 };
 
@@ -103,6 +105,17 @@ struct drm_i915_gem_object {
 	 * They are also added to @vma_list for easy iteration.
 	 */
 	struct rb_root vma_tree;
+	/**
+	 * @vma_hash: Index of the ppGTT VMAs backed by this object
+	 *
+	 * Objects shared between many address spaces (e.g. a texture atlas
+	 * imported by every client) accumulate hundreds of ppGTT VMA. Once
+	 * @vma_ppgtt_count grows past a small threshold, the ppGTT VMA
+	 * (which only ever use the normal view) are also hashed by their
+	 * address space so that vma_lookup() need not walk the @vma_tree.
+	 */
+	struct hlist_head *vma_hash;
+	unsigned int vma_ppgtt_count;
 
 	/**
 	 * @lut_list: List of vma lookup entries in use for this object.
@@ -125,8 +138,35 @@ struct drm_i915_gem_object {
 	 */
 	unsigned int userfault_count;
 	struct list_head userfault_link;
+	/** Bumped by every mmap revocation, see i915_gem_fault() */
+	unsigned int userfault_seq;
+
+	/** Partial GTT mmap window, grown by sequential faults */
+	struct {
+		pgoff_t next;
+		unsigned int chunk;
+	} fault_around;
 
 	struct list_head batch_pool_link;
+
+	/** Link in the client's cache of closed objects to recycle */
+	struct list_head recycle_link;
+
+	/**
+	 * The last shadow copy of this batch validated by the command parser,
+	 * reused for as long as the batch is not written to. See
+	 * intel_engine_cmd_parser_lookup(). For a shadow object itself, the
+	 * parameters of the parse it was validated for.
+	 */
+	struct {
+		struct drm_i915_gem_object *shadow;
+		atomic_t gen;
+
+		u32 offset;
+		u32 len;
+		u32 used;
+		unsigned int key;
+	} cmd_cache;
 	I915_SELFTEST_DECLARE(struct list_head st_link);
 
 	unsigned long flags;
@@ -146,6 +186,12 @@ struct drm_i915_gem_object {
 #define I915_BO_CACHE_COHERENT_FOR_READ BIT(0)
 #define I915_BO_CACHE_COHERENT_FOR_WRITE BIT(1)
 	unsigned int cache_dirty:1;
+	/*
+	 * Whether the current pages have been clflushed since they were
+	 * acquired, after which a context in explicit coherency mode takes
+	 * over responsibility for flushing them.
+	 */
+	unsigned int cache_flushed:1;
 
 	/**
 	 * @read_domains: Read memory domains.
@@ -172,6 +218,15 @@ struct drm_i915_gem_object {
 #define TILING_MASK (FENCE_MINIMUM_STRIDE-1)
 #define STRIDE_MASK (~TILING_MASK)
 
+	/**
+	 * The client that created this object, whose memory totals are
+	 * charged with its size under @client.type.
+	 */
+	struct {
+		struct i915_gem_client_memory *memory;
+		unsigned int type;
+	} client;
+
 	/** Count of VMA actually bound by this object */
 	unsigned int bind_count;
 	unsigned int active_count;
@@ -183,6 +238,7 @@ struct drm_i915_gem_object {
 		atomic_t pages_pin_count;
 
 		struct sg_table *pages;
+		unsigned long pages_gen; /* bumped for each new set of pages */
 		void *mapping;
 
 		/* TODO: whack some of this into the error state */
@@ -214,12 +270,19 @@ struct drm_i915_gem_object {
 
 		I915_SELFTEST_DECLARE(unsigned int page_mask);
 
+		/*
+		 * Index of the sg entries by the page at which each starts,
+		 * built on the first lookup by i915_gem_object_get_sg(): a
+		 * compact range per entry rather than a slot for every page.
+		 */
 		struct i915_gem_object_page_iter {
-			struct scatterlist *sg_pos;
-			unsigned int sg_idx; /* in pages, but 32bit eek! */
+			struct i915_gem_object_page_range {
+				struct scatterlist *sg;
+				unsigned int idx; /* in pages, but 32bit eek! */
+			} *ranges;
+			unsigned int count;
 
-			struct radix_tree_root radix;
-			struct mutex lock; /* protects this cache */
+			struct mutex lock; /* serialises building the ranges */
 		} get_page;
 
 		/**
@@ -228,6 +291,12 @@ struct drm_i915_gem_object {
 		 */
 		struct list_head link;
 
+		/**
+		 * Element within i915->mm.vmap_list while the kernel vmap of
+		 * the pages was recently used, locked by i915->mm.obj_lock.
+		 */
+		struct list_head vmap_link;
+
 		/**
 		 * Advice: are the backing pages purgeable?
 		 */
@@ -271,6 +340,15 @@ struct drm_i915_gem_object {
 			struct i915_mm_struct *mm;
 			struct i915_mmu_object *mmu_object;
 			struct work_struct *work;
+
+			/**
+			 * Pages still pinned from before a partial mmu
+			 * invalidation, with only those in [stale_start,
+			 * stale_end) to be re-acquired by the next get_pages.
+			 */
+			struct page **stash;
+			unsigned long stale_start, stale_end;
+			bool keep_stash; /* transient, under struct_mutex */
 		} userptr;
 
 		unsigned long scratch;
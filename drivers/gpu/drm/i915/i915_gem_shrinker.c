@@ -22,6 +22,7 @@
  *
  */
 
+#include <linux/mmzone.h>
 #include <linux/oom.h>
 #include <linux/sched/mm.h>
 #include <linux/shmem_fs.h>
@@ -64,6 +65,26 @@ static bool shrinker_lock(struct drm_i915_private *i915, bool *unlock)
 	BUG();
 }
 
+/* For direct reclaim: take the mutex only if it is free, never wait upon it */
+static bool shrinker_trylock(struct drm_i915_private *i915, bool *unlock)
+{
+	switch (mutex_trylock_recursive(&i915->drm.struct_mutex)) {
+	case MUTEX_TRYLOCK_RECURSIVE:
+		*unlock = false;
+		return true;
+
+	case MUTEX_TRYLOCK_FAILED:
+		*unlock = false;
+		return false;
+
+	case MUTEX_TRYLOCK_SUCCESS:
+		*unlock = true;
+		return true;
+	}
+
+	BUG();
+}
+
 static void shrinker_unlock(struct drm_i915_private *i915, bool unlock)
 {
 	if (!unlock)
@@ -110,6 +131,32 @@ static bool can_release_pages(struct drm_i915_gem_object *obj)
 	return swap_available() || obj->mm.madv == I915_MADV_DONTNEED;
 }
 
+static bool object_on_node(struct drm_i915_gem_object *obj, int nid)
+{
+	struct sg_table *pages;
+	bool on_node = false;
+
+	if (nid == NUMA_NO_NODE)
+		return true;
+
+	/*
+	 * The pages may be released underneath us, so look at them under
+	 * the lock. Should someone else be holding it, the object is busy
+	 * and not worth waiting for.
+	 */
+	if (!mutex_trylock(&obj->mm.lock))
+		return false;
+
+	/* Judge the whole object by its first page */
+	pages = obj->mm.pages;
+	if (!IS_ERR_OR_NULL(pages) && pages->sgl)
+		on_node = page_to_nid(sg_page(pages->sgl)) == nid;
+
+	mutex_unlock(&obj->mm.lock);
+
+	return on_node;
+}
+
 static bool unsafe_drop_pages(struct drm_i915_gem_object *obj)
 {
 	if (i915_gem_object_unbind(obj) == 0)
@@ -117,36 +164,12 @@ static bool unsafe_drop_pages(struct drm_i915_gem_object *obj)
 	return !i915_gem_object_has_pages(obj);
 }
 
-/**
- * i915_gem_shrink - Shrink buffer object caches
- * @i915: i915 device
- * @target: amount of memory to make available, in pages
- * @nr_scanned: optional output for number of pages scanned (incremental)
- * @flags: control flags for selecting cache types
- *
- * This function is the main interface to the shrinker. It will try to release
- * up to @target pages of main memory backing storage from buffer objects.
- * Selection of the specific caches can be done with @flags. This is e.g. useful
- * when purgeable objects should be removed from caches preferentially.
- *
- * Note that it's not guaranteed that released amount is actually available as
- * free system memory - the pages might still be in-used to due to other reasons
- * (like cpu mmaps) or the mm core has reused them before we could grab them.
- * Therefore code that needs to explicitly shrink buffer objects caches (e.g. to
- * avoid deadlocks in memory reclaim) must fall back to i915_gem_shrink_all().
- *
- * Also note that any kind of pinning (both per-vma address space pins and
- * backing storage pins at the buffer object level) result in the shrinker code
- * having to skip the object.
- *
- * Returns:
- * The number of pages of backing storage actually released.
- */
-unsigned long
-i915_gem_shrink(struct drm_i915_private *i915,
-		unsigned long target,
-		unsigned long *nr_scanned,
-		unsigned flags)
+static unsigned long
+__i915_gem_shrink(struct drm_i915_private *i915,
+		  unsigned long target,
+		  unsigned long *nr_scanned,
+		  unsigned flags,
+		  int nid)
 {
 	const struct {
 		struct list_head *list;
@@ -239,6 +262,15 @@ i915_gem_shrink(struct drm_i915_private *i915,
 			    !is_vmalloc_addr(obj->mm.mapping))
 				continue;
 
+			/*
+			 * Keep the recently used vmaps, so their objects do
+			 * not have to be remapped on the next pin_map(), until
+			 * we are reclaiming vmap space or shrinking everything.
+			 */
+			if (!(flags & (I915_SHRINK_VMAPS | I915_SHRINK_ACTIVE)) &&
+			    !list_empty(&obj->mm.vmap_link))
+				continue;
+
 			if (!(flags & I915_SHRINK_ACTIVE) &&
 			    (i915_gem_object_is_active(obj) ||
 			     i915_gem_object_is_framebuffer(obj)))
@@ -249,6 +281,11 @@ i915_gem_shrink(struct drm_i915_private *i915,
 
 			spin_unlock(&i915->mm.obj_lock);
 
+			if (!object_on_node(obj, nid)) {
+				spin_lock(&i915->mm.obj_lock);
+				continue;
+			}
+
 			if (unsafe_drop_pages(obj)) {
 				/* May arrive from get_pages on another bo */
 				mutex_lock_nested(&obj->mm.lock,
@@ -279,6 +316,41 @@ i915_gem_shrink(struct drm_i915_private *i915,
 	return count;
 }
 
+/**
+ * i915_gem_shrink - Shrink buffer object caches
+ * @i915: i915 device
+ * @target: amount of memory to make available, in pages
+ * @nr_scanned: optional output for number of pages scanned (incremental)
+ * @flags: control flags for selecting cache types
+ *
+ * This function is the main interface to the shrinker. It will try to release
+ * up to @target pages of main memory backing storage from buffer objects.
+ * Selection of the specific caches can be done with @flags. This is e.g. useful
+ * when purgeable objects should be removed from caches preferentially.
+ *
+ * Note that it's not guaranteed that released amount is actually available as
+ * free system memory - the pages might still be in-used to due to other reasons
+ * (like cpu mmaps) or the mm core has reused them before we could grab them.
+ * Therefore code that needs to explicitly shrink buffer objects caches (e.g. to
+ * avoid deadlocks in memory reclaim) must fall back to i915_gem_shrink_all().
+ *
+ * Also note that any kind of pinning (both per-vma address space pins and
+ * backing storage pins at the buffer object level) result in the shrinker code
+ * having to skip the object.
+ *
+ * Returns:
+ * The number of pages of backing storage actually released.
+ */
+unsigned long
+i915_gem_shrink(struct drm_i915_private *i915,
+		unsigned long target,
+		unsigned long *nr_scanned,
+		unsigned flags)
+{
+	return __i915_gem_shrink(i915, target, nr_scanned, flags,
+				 NUMA_NO_NODE);
+}
+
 /**
  * i915_gem_shrink_all - Shrink buffer object caches completely
  * @i915: i915 device
@@ -304,9 +376,31 @@ unsigned long i915_gem_shrink_all(struct drm_i915_private *i915)
 				I915_SHRINK_ACTIVE);
 	intel_runtime_pm_put(i915);
 
+	freed += i915_gem_wc_pool_shrink(i915, -1UL);
+
 	return freed;
 }
 
+/*
+ * The core calls into us for every pass of reclaim, on every node and from
+ * every reclaiming task, but the worker needs only an occasional nudge as it
+ * keeps itself running for as long as it makes progress.
+ */
+#define I915_SHRINK_KICK_INTERVAL (HZ / 10)
+
+static void shrink_work_kick(struct drm_i915_private *i915)
+{
+	unsigned long last = READ_ONCE(i915->mm.shrink_kick);
+
+	if (time_before(jiffies, last + I915_SHRINK_KICK_INTERVAL))
+		return;
+
+	if (cmpxchg(&i915->mm.shrink_kick, last, jiffies) != last)
+		return;
+
+	queue_delayed_work(system_unbound_wq, &i915->mm.shrink_work, 0);
+}
+
 static unsigned long
 i915_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 {
@@ -344,6 +438,13 @@ i915_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 			    128ul /* default SHRINK_BATCH */);
 	}
 
+	/* Reclaim has started, get ahead of it in the background */
+	if (count)
+		shrink_work_kick(i915);
+
+	/* Idle page-table pages held for reuse by future ppgtts */
+	count += i915_gem_wc_pool_count(i915);
+
 	return count;
 }
 
@@ -355,17 +456,33 @@ i915_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 	unsigned long freed;
 	bool unlock;
 
-	sc->nr_scanned = 0;
+	/*
+	 * The pooled page-table pages are the cheapest to give back, they
+	 * need no locking against the GPU.
+	 */
+	freed = i915_gem_wc_pool_shrink(i915, sc->nr_to_scan);
+	sc->nr_scanned = freed;
+	if (sc->nr_scanned >= sc->nr_to_scan)
+		return freed;
 
-	if (!shrinker_lock(i915, &unlock))
-		return SHRINK_STOP;
+	/*
+	 * Only kswapd may wait for the struct_mutex; direct reclaim must
+	 * not stall behind GPU submission, and leaves the work for our
+	 * background worker if the mutex is busy.
+	 */
+	if (current_is_kswapd() ?
+	    !shrinker_lock(i915, &unlock) :
+	    !shrinker_trylock(i915, &unlock)) {
+		shrink_work_kick(i915);
+		return freed ?: SHRINK_STOP;
+	}
 
-	freed = i915_gem_shrink(i915,
-				sc->nr_to_scan,
-				&sc->nr_scanned,
-				I915_SHRINK_BOUND |
-				I915_SHRINK_UNBOUND |
-				I915_SHRINK_PURGEABLE);
+	freed += i915_gem_shrink(i915,
+				 sc->nr_to_scan - sc->nr_scanned,
+				 &sc->nr_scanned,
+				 I915_SHRINK_BOUND |
+				 I915_SHRINK_UNBOUND |
+				 I915_SHRINK_PURGEABLE);
 	if (sc->nr_scanned < sc->nr_to_scan)
 		freed += i915_gem_shrink(i915,
 					 sc->nr_to_scan - sc->nr_scanned,
@@ -388,6 +505,72 @@ i915_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 	return sc->nr_scanned ? freed : SHRINK_STOP;
 }
 
+/*
+ * How many pages short is the node of @mult times its high watermark?
+ */
+static unsigned long node_reclaim_target(int nid, unsigned int mult)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	unsigned long free = 0, wmark = 0;
+	int z;
+
+	for (z = 0; z < MAX_NR_ZONES; z++) {
+		struct zone *zone = &pgdat->node_zones[z];
+
+		if (!managed_zone(zone))
+			continue;
+
+		free += zone_page_state(zone, NR_FREE_PAGES);
+		wmark += high_wmark_pages(zone);
+	}
+
+	wmark *= mult;
+	return free < wmark ? wmark - free : 0;
+}
+
+static void i915_gem_shrinker_worker(struct work_struct *work)
+{
+	struct drm_i915_private *i915 =
+		container_of(work, typeof(*i915), mm.shrink_work.work);
+	bool again = false;
+	int nid;
+
+	mutex_lock(&i915->drm.struct_mutex);
+	for_each_online_node(nid) {
+		unsigned long target, freed;
+
+		/*
+		 * Keep a margin of a further high watermark free on each
+		 * node using only our purgeable objects, and only write
+		 * back inactive objects to keep above the watermark itself.
+		 */
+		target = node_reclaim_target(nid, 2);
+		if (!target)
+			continue;
+
+		freed = __i915_gem_shrink(i915, target, NULL,
+					  I915_SHRINK_BOUND |
+					  I915_SHRINK_UNBOUND |
+					  I915_SHRINK_PURGEABLE,
+					  nid);
+
+		target = node_reclaim_target(nid, 1);
+		if (target)
+			freed += __i915_gem_shrink(i915, target, NULL,
+						   I915_SHRINK_BOUND |
+						   I915_SHRINK_UNBOUND,
+						   nid);
+
+		/* Keep going for as long as we are making progress */
+		if (freed && node_reclaim_target(nid, 1))
+			again = true;
+	}
+	mutex_unlock(&i915->drm.struct_mutex);
+
+	if (again)
+		queue_delayed_work(system_unbound_wq, &i915->mm.shrink_work, 1);
+}
+
 static bool
 shrinker_lock_uninterruptible(struct drm_i915_private *i915, bool *unlock,
 			      int timeout_ms)
@@ -507,6 +690,9 @@ i915_gem_shrinker_vmap(struct notifier_block *nb, unsigned long event, void *ptr
  */
 void i915_gem_shrinker_register(struct drm_i915_private *i915)
 {
+	INIT_DELAYED_WORK(&i915->mm.shrink_work, i915_gem_shrinker_worker);
+	i915->mm.shrink_kick = jiffies - I915_SHRINK_KICK_INTERVAL;
+
 	i915->mm.shrinker.scan_objects = i915_gem_shrinker_scan;
 	i915->mm.shrinker.count_objects = i915_gem_shrinker_count;
 	i915->mm.shrinker.seeks = DEFAULT_SEEKS;
@@ -531,6 +717,7 @@ void i915_gem_shrinker_unregister(struct drm_i915_private *i915)
 	WARN_ON(unregister_vmap_purge_notifier(&i915->mm.vmap_notifier));
 	WARN_ON(unregister_oom_notifier(&i915->mm.oom_notifier));
 	unregister_shrinker(&i915->mm.shrinker);
+	cancel_delayed_work_sync(&i915->mm.shrink_work);
 }
 
 void i915_gem_shrinker_taints_mutex(struct mutex *mutex)
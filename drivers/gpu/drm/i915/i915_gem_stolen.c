@@ -550,7 +550,14 @@ i915_gem_object_release_stolen(struct drm_i915_gem_object *obj)
 
 	__i915_gem_object_unpin_pages(obj);
 
-	i915_gem_stolen_remove_node(dev_priv, stolen);
+	mutex_lock(&dev_priv->mm.stolen_lock);
+	if (stolen->color == I915_STOLEN_USER) {
+		GEM_BUG_ON(dev_priv->mm.stolen_user < stolen->size);
+		dev_priv->mm.stolen_user -= stolen->size;
+	}
+	drm_mm_remove_node(stolen);
+	mutex_unlock(&dev_priv->mm.stolen_lock);
+
 	kfree(stolen);
 }
 
@@ -622,6 +629,162 @@ i915_gem_object_create_stolen(struct drm_i915_private *dev_priv,
 	return NULL;
 }
 
+static int stolen_insert_user(struct drm_i915_private *dev_priv,
+			      struct drm_mm_node *node, u64 size)
+{
+	u64 start = 0;
+	int ret;
+
+	/* WaSkipStolenMemoryFirstPage:bdw+ */
+	if (INTEL_GEN(dev_priv) >= 8)
+		start = 4096;
+
+	mutex_lock(&dev_priv->mm.stolen_lock);
+
+	/*
+	 * Never let userspace take more than its share of stolen, lest
+	 * we have none left for FBC or the rings.
+	 */
+	ret = -ENOSPC;
+	if (dev_priv->mm.stolen_user + size >
+	    I915_STOLEN_USER_MAX(dev_priv))
+		goto out;
+
+	/*
+	 * Hand out naturally aligned power-of-two blocks from the top of
+	 * stolen, buddy style, keeping the user allocations from fragmenting
+	 * the bottom of stolen where the kernel makes its allocations.
+	 */
+	ret = drm_mm_insert_node_in_range(&dev_priv->mm.stolen, node,
+					  size, size, I915_STOLEN_USER,
+					  start, U64_MAX, DRM_MM_INSERT_HIGH);
+	if (ret == 0)
+		dev_priv->mm.stolen_user += size;
+
+out:
+	mutex_unlock(&dev_priv->mm.stolen_lock);
+	return ret;
+}
+
+static int stolen_clear_user(struct drm_i915_gem_object *obj)
+{
+	struct drm_i915_private *dev_priv = to_i915(obj->base.dev);
+	struct i915_ggtt *ggtt = &dev_priv->ggtt;
+	dma_addr_t addr = dev_priv->dsm.start + obj->stolen->start;
+	struct drm_mm_node node = {};
+	u64 offset;
+	int ret;
+
+	/*
+	 * Stolen is not cleared by the BIOS, nor by us upon release, so
+	 * scrub it before handing it to userspace. The CPU may not have
+	 * direct access to stolen, so go through a page of the aperture.
+	 */
+	ret = mutex_lock_interruptible(&dev_priv->drm.struct_mutex);
+	if (ret)
+		return ret;
+
+	ret = drm_mm_insert_node_in_range(&ggtt->vm.mm, &node,
+					  PAGE_SIZE, 0, I915_COLOR_UNEVICTABLE,
+					  0, ggtt->mappable_end,
+					  DRM_MM_INSERT_LOW);
+	if (ret)
+		goto out_unlock;
+
+	intel_runtime_pm_get(dev_priv);
+
+	for (offset = 0; offset < obj->base.size; offset += PAGE_SIZE) {
+		void __iomem *vaddr;
+
+		wmb(); /* flush the write before we modify the GGTT */
+		ggtt->vm.insert_page(&ggtt->vm, addr + offset,
+				     node.start, I915_CACHE_NONE, 0);
+		wmb(); /* flush modifications to the GGTT (insert_page) */
+
+		vaddr = io_mapping_map_atomic_wc(&ggtt->iomap, node.start);
+		memset_io(vaddr, 0, PAGE_SIZE);
+		io_mapping_unmap_atomic(vaddr);
+	}
+
+	wmb();
+	ggtt->vm.clear_range(&ggtt->vm, node.start, node.size);
+	drm_mm_remove_node(&node);
+
+	intel_runtime_pm_put(dev_priv);
+out_unlock:
+	mutex_unlock(&dev_priv->drm.struct_mutex);
+	return ret;
+}
+
+/**
+ * i915_gem_object_create_stolen_user - create a userspace object in stolen
+ * @dev_priv: i915 device
+ * @file: the client creating the object, to which it is charged
+ * @size: minimum size of the object
+ *
+ * Allocates a cleared object for userspace from stolen memory, for scratch
+ * buffers that avoid shmem and clflushing entirely. The allocation is
+ * rounded up to a power of two. Such objects have no struct pages, so may
+ * only be accessed by the CPU through the GTT, and their contents are not
+ * preserved across hibernation. So that a single client cannot claim all
+ * of the stolen memory set aside for userspace, each client is limited to
+ * half of it.
+ *
+ * Return: the new object or an error pointer (-ENOSPC if over the limit)
+ */
+struct drm_i915_gem_object *
+i915_gem_object_create_stolen_user(struct drm_i915_private *dev_priv,
+				   struct drm_file *file,
+				   resource_size_t size)
+{
+	struct drm_i915_gem_object *obj;
+	struct drm_mm_node *stolen;
+	int ret;
+
+	if (!drm_mm_initialized(&dev_priv->mm.stolen))
+		return ERR_PTR(-ENODEV);
+
+	if (size == 0 || size > I915_STOLEN_USER_MAX(dev_priv))
+		return ERR_PTR(-E2BIG);
+
+	stolen = kzalloc(sizeof(*stolen), GFP_KERNEL);
+	if (!stolen)
+		return ERR_PTR(-ENOMEM);
+
+	ret = stolen_insert_user(dev_priv, stolen,
+				 roundup_pow_of_two(size));
+	if (ret) {
+		kfree(stolen);
+		return ERR_PTR(ret);
+	}
+
+	obj = _i915_gem_object_create_stolen(dev_priv, stolen);
+	if (!obj) {
+		mutex_lock(&dev_priv->mm.stolen_lock);
+		dev_priv->mm.stolen_user -= stolen->size;
+		drm_mm_remove_node(stolen);
+		mutex_unlock(&dev_priv->mm.stolen_lock);
+		kfree(stolen);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	ret = i915_gem_object_set_client_limited(obj, file,
+						 I915_GEM_CLIENT_STOLEN,
+						 I915_STOLEN_CLIENT_MAX(dev_priv));
+	if (ret) {
+		i915_gem_object_put(obj);
+		return ERR_PTR(ret);
+	}
+
+	ret = stolen_clear_user(obj);
+	if (ret) {
+		i915_gem_object_put(obj);
+		return ERR_PTR(ret);
+	}
+
+	return obj;
+}
+
 struct drm_i915_gem_object *
 i915_gem_object_create_stolen_for_preallocated(struct drm_i915_private *dev_priv,
 					       resource_size_t stolen_offset,
@@ -703,7 +866,7 @@ i915_gem_object_create_stolen_for_preallocated(struct drm_i915_private *dev_priv
 	vma->pages = obj->mm.pages;
 	vma->flags |= I915_VMA_GLOBAL_BIND;
 	__i915_vma_set_map_and_fenceable(vma);
-	list_move_tail(&vma->vm_link, &ggtt->vm.inactive_list);
+	i915_vma_move_to_inactive(vma);
 
 	spin_lock(&dev_priv->mm.obj_lock);
 	list_move_tail(&obj->mm.link, &dev_priv->mm.bound_list);
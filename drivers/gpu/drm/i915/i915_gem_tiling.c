@@ -27,6 +27,8 @@
 
 #include <linux/string.h>
 #include <linux/bitops.h>
+#include <linux/highmem.h>
+#include <linux/uaccess.h>
 #include <drm/drmP.h>
 #include <drm/i915_drm.h>
 #include "i915_drv.h"
@@ -130,6 +132,149 @@ u32 i915_gem_fence_alignment(struct drm_i915_private *i915, u32 size,
 	return i915_gem_fence_size(i915, size, tiling, stride);
 }
 
+static u64 tiled_offset(unsigned int tiling, unsigned int stride,
+			unsigned int x, unsigned int y, unsigned int *len)
+{
+	u64 tile;
+
+	/*
+	 * gen4+ tiles are always 4KiB: X is 8 rows of 512 bytes, Y is 32 rows
+	 * of 16 bytes per column of OWords, 8 columns across.
+	 */
+	if (tiling == I915_TILING_X) {
+		tile = (u64)(y / 8) * (stride / 512) + x / 512;
+		*len = 512 - x % 512;
+		return tile * SZ_4K + (y % 8) * 512 + x % 512;
+	} else {
+		tile = (u64)(y / 32) * (stride / 128) + x / 128;
+		*len = 16 - x % 16;
+		return tile * SZ_4K + (x % 128) / 16 * 512 + (y % 32) * 16 + x % 16;
+	}
+}
+
+static unsigned int swizzle_bit6(unsigned int swizzle,
+				 unsigned int offset, struct page *page)
+{
+	unsigned int bit;
+
+	switch (swizzle) {
+	case I915_BIT_6_SWIZZLE_9:
+	case I915_BIT_6_SWIZZLE_9_17:
+		bit = offset >> 9;
+		break;
+	case I915_BIT_6_SWIZZLE_9_10:
+	case I915_BIT_6_SWIZZLE_9_10_17:
+		bit = (offset >> 9) ^ (offset >> 10);
+		break;
+	case I915_BIT_6_SWIZZLE_9_11:
+		bit = (offset >> 9) ^ (offset >> 11);
+		break;
+	case I915_BIT_6_SWIZZLE_9_10_11:
+		bit = (offset >> 9) ^ (offset >> 10) ^ (offset >> 11);
+		break;
+	default:
+		return 0;
+	}
+
+	if (swizzle == I915_BIT_6_SWIZZLE_9_17 ||
+	    swizzle == I915_BIT_6_SWIZZLE_9_10_17)
+		bit ^= page_to_phys(page) >> 17;
+
+	return (bit & 1) << 6;
+}
+
+/**
+ * i915_gem_object_copy_tiled - copy between a tiled object and a linear buffer
+ * @obj: tiled object, with its pages pinned for CPU access
+ * @offset: offset into the linear view of the object
+ * @size: number of bytes to copy
+ * @user: user buffer
+ * @write: copy from @user into the object rather than the other way around
+ * @clflush: CLFLUSH_BEFORE and/or CLFLUSH_AFTER, as required for CPU access
+ *
+ * Copies @size bytes, starting at @offset of the linear surface of the same
+ * stride as @obj, doing the detiling and swizzling in software, so that no
+ * fence nor mappable aperture space is required to access a tiled object.
+ *
+ * Returns 0 on success, -ENODEV if the tiling layout is not known, -EINVAL
+ * if the range falls outside of the object and -EFAULT on a bad @user.
+ */
+int i915_gem_object_copy_tiled(struct drm_i915_gem_object *obj,
+			       u64 offset, u64 size, char __user *user,
+			       bool write, unsigned int clflush)
+{
+	struct drm_i915_private *i915 = to_i915(obj->base.dev);
+	const unsigned int tiling = i915_gem_object_get_tiling(obj);
+	const unsigned int stride = i915_gem_object_get_stride(obj);
+	unsigned long idx = ULONG_MAX;
+	struct page *page = NULL;
+	unsigned int swizzle;
+	char *vaddr = NULL;
+	int ret = 0;
+
+	if (INTEL_GEN(i915) < 4 || !i915_gem_object_has_struct_page(obj))
+		return -ENODEV;
+
+	swizzle = tiling == I915_TILING_X ?
+		i915->mm.bit_6_swizzle_x : i915->mm.bit_6_swizzle_y;
+	if (swizzle == I915_BIT_6_SWIZZLE_UNKNOWN)
+		return -ENODEV;
+
+	while (size) {
+		unsigned int x, len;
+		u64 tiled;
+		u32 y;
+
+		y = div_u64_rem(offset, stride, &x);
+		tiled = tiled_offset(tiling, stride, x, y, &len);
+
+		/* Swizzling swaps 64 byte halves of each 128 byte block */
+		if (swizzle != I915_BIT_6_SWIZZLE_NONE)
+			len = min_t(unsigned int, len, 64 - (tiled & 63));
+		len = min_t(u64, len, size);
+
+		if (tiled + len > obj->base.size) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (tiled >> PAGE_SHIFT != idx) {
+			if (vaddr)
+				kunmap(page);
+			idx = tiled >> PAGE_SHIFT;
+			page = i915_gem_object_get_page(obj, idx);
+			vaddr = kmap(page);
+		}
+
+		tiled = offset_in_page(tiled);
+		tiled ^= swizzle_bit6(swizzle, tiled, page);
+
+		if (clflush & CLFLUSH_BEFORE)
+			drm_clflush_virt_range(vaddr + tiled, len);
+
+		if (write)
+			ret = __copy_from_user(vaddr + tiled, user, len);
+		else
+			ret = __copy_to_user(user, vaddr + tiled, len);
+		if (ret) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (clflush & CLFLUSH_AFTER)
+			drm_clflush_virt_range(vaddr + tiled, len);
+
+		user += len;
+		offset += len;
+		size -= len;
+	}
+
+	if (vaddr)
+		kunmap(page);
+
+	return ret;
+}
+
 /* Check pitch constriants for all chips & tiling formats */
 static bool
 i915_tiling_ok(struct drm_i915_gem_object *obj,
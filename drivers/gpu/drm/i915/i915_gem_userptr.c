@@ -42,6 +42,20 @@ struct i915_mm_struct {
 	struct work_struct work;
 };
 
+static void release_pvec(struct page **pvec,
+			 unsigned long start, unsigned long end)
+{
+	for (; start < end; start++) {
+		if (pvec[start]) {
+			put_page(pvec[start]);
+			pvec[start] = NULL;
+		}
+	}
+}
+
+static int
+__i915_gem_userptr_set_active(struct drm_i915_gem_object *obj, bool value);
+
 #if defined(CONFIG_MMU_NOTIFIER)
 #include <linux/interval_tree.h>
 
@@ -57,8 +71,8 @@ struct i915_mmu_object {
 	struct i915_mmu_notifier *mn;
 	struct drm_i915_gem_object *obj;
 	struct interval_tree_node it;
-	struct list_head link;
 	struct work_struct work;
+	unsigned long inval_start, inval_end; /* pages, under mn->lock */
 	bool attached;
 };
 
@@ -67,27 +81,62 @@ static void cancel_userptr(struct work_struct *work)
 	struct i915_mmu_object *mo = container_of(work, typeof(*mo), work);
 	struct drm_i915_gem_object *obj = mo->obj;
 	struct work_struct *active;
+	unsigned long start, end;
+
+	spin_lock(&mo->mn->lock);
+	start = mo->inval_start;
+	end = mo->inval_end;
+	mo->inval_start = ULONG_MAX;
+	mo->inval_end = 0;
+	spin_unlock(&mo->mn->lock);
 
 	/* Cancel any active worker and force us to re-evaluate gup */
 	mutex_lock(&obj->mm.lock);
 	active = fetch_and_zero(&obj->userptr.work);
+	if (active)
+		__i915_gem_userptr_set_active(obj, false);
 	mutex_unlock(&obj->mm.lock);
 	if (active)
 		goto out;
 
 	i915_gem_object_wait(obj, I915_WAIT_ALL, MAX_SCHEDULE_TIMEOUT, NULL);
 
+	/*
+	 * Only the pages inside the invalidated range are now suspect, so
+	 * keep our references to all the others (see put_pages) and just
+	 * re-acquire that range upon next use. We are still on the mmu
+	 * notifier, so any later invalidation of the stash is seen too.
+	 */
+	mutex_lock(&obj->mm.lock);
+	if (obj->userptr.stash) {
+		release_pvec(obj->userptr.stash, start, end);
+		obj->userptr.stale_start = min(obj->userptr.stale_start, start);
+		obj->userptr.stale_end = max(obj->userptr.stale_end, end);
+	} else {
+		obj->userptr.stale_start = start;
+		obj->userptr.stale_end = end;
+	}
+	mutex_unlock(&obj->mm.lock);
+
 	mutex_lock(&obj->base.dev->struct_mutex);
 
 	/* We are inside a kthread context and can't be interrupted */
+	obj->userptr.keep_stash = start < end;
 	if (i915_gem_object_unbind(obj) == 0)
 		__i915_gem_object_put_pages(obj, I915_MM_NORMAL);
+	obj->userptr.keep_stash = false;
 	WARN_ONCE(i915_gem_object_has_pages(obj),
 		  "Failed to release pages: bind_count=%d, pages_pin_count=%d, pin_global=%d\n",
 		  obj->bind_count,
 		  atomic_read(&obj->mm.pages_pin_count),
 		  obj->pin_global);
 
+	/* Nothing left to be told about, put_pages may not have run */
+	mutex_lock(&obj->mm.lock);
+	if (!i915_gem_object_has_pages(obj) && !obj->userptr.stash)
+		__i915_gem_userptr_set_active(obj, false);
+	mutex_unlock(&obj->mm.lock);
+
 	mutex_unlock(&obj->base.dev->struct_mutex);
 
 out:
@@ -121,7 +170,7 @@ static void i915_gem_userptr_mn_invalidate_range_start(struct mmu_notifier *_mn,
 		container_of(_mn, struct i915_mmu_notifier, mn);
 	struct i915_mmu_object *mo;
 	struct interval_tree_node *it;
-	LIST_HEAD(cancelled);
+	bool cancelled = false;
 
 	if (RB_EMPTY_ROOT(&mn->objects.rb_root))
 		return;
@@ -145,14 +194,26 @@ static void i915_gem_userptr_mn_invalidate_range_start(struct mmu_notifier *_mn,
 		if (kref_get_unless_zero(&mo->obj->base.refcount))
 			queue_work(mn->wq, &mo->work);
 
-		list_add(&mo->link, &cancelled);
+		/* Record which of the object's pages are affected */
+		mo->inval_start = min(mo->inval_start,
+				      (max(start, it->start) - it->start) >>
+				      PAGE_SHIFT);
+		mo->inval_end = max(mo->inval_end,
+				    ((min(end, it->last) - it->start) >>
+				     PAGE_SHIFT) + 1);
+
+		/*
+		 * Stay in the tree: the pages outside of this range may be
+		 * kept in the stash, and a later invalidation of those must
+		 * still find us. cancel_userptr() removes the object once it
+		 * no longer holds any pages.
+		 */
+		cancelled = true;
 		it = interval_tree_iter_next(it, start, end);
 	}
-	list_for_each_entry(mo, &cancelled, link)
-		del_object(mo);
 	spin_unlock(&mn->lock);
 
-	if (!list_empty(&cancelled))
+	if (cancelled)
 		flush_workqueue(mn->wq);
 }
 
@@ -266,6 +327,7 @@ i915_gem_userptr_init__mmu_notifier(struct drm_i915_gem_object *obj,
 	mo->obj = obj;
 	mo->it.start = obj->userptr.ptr;
 	mo->it.last = obj->userptr.ptr + obj->base.size - 1;
+	mo->inval_start = ULONG_MAX;
 	INIT_WORK(&mo->work, cancel_userptr);
 
 	obj->userptr.mmu_object = mo;
@@ -409,6 +471,8 @@ struct get_pages_work {
 	struct work_struct work;
 	struct drm_i915_gem_object *obj;
 	struct task_struct *task;
+	struct page **pvec;
+	unsigned long first, count;
 };
 
 static struct sg_table *
@@ -490,42 +554,152 @@ __i915_gem_userptr_set_active(struct drm_i915_gem_object *obj,
 	return ret;
 }
 
+/*
+ * Large userptr are pinned in chunks of this many pages, by several workers
+ * in parallel, so that a multi-GiB import is not bound by the speed of a
+ * single thread walking its page tables and faulting the pages.
+ */
+#define I915_USERPTR_CHUNK_PAGES (SZ_64M >> PAGE_SHIFT)
+
+struct get_pages_chunk {
+	struct work_struct work;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	struct page **pvec;
+	unsigned long start;
+	unsigned int flags;
+	int npages;
+	int pinned;
+	int err;
+};
+
+static void __i915_gem_userptr_pin_chunk(struct get_pages_chunk *chunk)
+{
+	int ret = 0;
+
+	down_read(&chunk->mm->mmap_sem);
+	while (chunk->pinned < chunk->npages) {
+		ret = get_user_pages_remote
+			(chunk->task, chunk->mm,
+			 chunk->start + chunk->pinned * PAGE_SIZE,
+			 chunk->npages - chunk->pinned,
+			 chunk->flags,
+			 chunk->pvec + chunk->pinned, NULL, NULL);
+		if (ret < 0)
+			break;
+
+		chunk->pinned += ret;
+	}
+	up_read(&chunk->mm->mmap_sem);
+	chunk->err = ret < 0 ? ret : 0;
+}
+
+static void __i915_gem_userptr_pin_chunk_worker(struct work_struct *_work)
+{
+	__i915_gem_userptr_pin_chunk(container_of(_work,
+						  struct get_pages_chunk,
+						  work));
+}
+
+/*
+ * Pin the @npages of obj's user pages from @first into pvec, returning 0
+ * if all were pinned or a negative error code with none of them pinned.
+ */
+static int __i915_gem_userptr_pin_pages(struct drm_i915_gem_object *obj,
+					struct task_struct *task,
+					struct mm_struct *mm,
+					struct page **pvec,
+					int first, int npages)
+{
+	int nchunks = DIV_ROUND_UP(npages, I915_USERPTR_CHUNK_PAGES);
+	struct get_pages_chunk *chunks, onstack;
+	unsigned int flags = 0;
+	int i, err;
+
+	if (!i915_gem_object_is_readonly(obj))
+		flags |= FOLL_WRITE;
+
+	chunks = NULL;
+	if (nchunks > 1)
+		chunks = kcalloc(nchunks, sizeof(*chunks),
+				 GFP_KERNEL | __GFP_NOWARN);
+	if (!chunks) {
+		/* Fallback to pinning everything ourselves */
+		memset(&onstack, 0, sizeof(onstack));
+		chunks = &onstack;
+		nchunks = 1;
+	}
+
+	for (i = 0; i < nchunks; i++) {
+		struct get_pages_chunk *chunk = &chunks[i];
+		int offset = i * I915_USERPTR_CHUNK_PAGES;
+
+		chunk->task = task;
+		chunk->mm = mm;
+		chunk->pvec = pvec + first + offset;
+		chunk->start = obj->userptr.ptr + (first + offset) * PAGE_SIZE;
+		chunk->flags = flags;
+		chunk->npages = nchunks == 1 ?
+			npages : min(npages - offset, I915_USERPTR_CHUNK_PAGES);
+
+		/* Keep the first chunk for ourselves */
+		if (i) {
+			INIT_WORK(&chunk->work,
+				  __i915_gem_userptr_pin_chunk_worker);
+			queue_work(to_i915(obj->base.dev)->mm.userptr_wq,
+				   &chunk->work);
+		}
+	}
+
+	__i915_gem_userptr_pin_chunk(&chunks[0]);
+
+	err = 0;
+	for (i = 0; i < nchunks; i++) {
+		if (i)
+			flush_work(&chunks[i].work);
+
+		if (!err)
+			err = chunks[i].err;
+	}
+
+	if (err) {
+		for (i = 0; i < nchunks; i++)
+			release_pvec(chunks[i].pvec, 0, chunks[i].pinned);
+	}
+
+	if (chunks != &onstack)
+		kfree(chunks);
+
+	return err;
+}
+
 static void
 __i915_gem_userptr_get_pages_worker(struct work_struct *_work)
 {
 	struct get_pages_work *work = container_of(_work, typeof(*work), work);
 	struct drm_i915_gem_object *obj = work->obj;
 	const int npages = obj->base.size >> PAGE_SHIFT;
-	struct page **pvec;
-	int pinned, ret;
+	struct page **pvec = work->pvec;
+	bool consumed = false;
+	int ret;
 
-	ret = -ENOMEM;
-	pinned = 0;
+	if (!pvec) {
+		pvec = kvmalloc_array(npages, sizeof(struct page *),
+				      GFP_KERNEL | __GFP_ZERO);
+		work->first = 0;
+		work->count = npages;
+	}
 
-	pvec = kvmalloc_array(npages, sizeof(struct page *), GFP_KERNEL);
+	ret = -ENOMEM;
 	if (pvec != NULL) {
 		struct mm_struct *mm = obj->userptr.mm->mm;
-		unsigned int flags = 0;
-
-		if (!i915_gem_object_is_readonly(obj))
-			flags |= FOLL_WRITE;
 
 		ret = -EFAULT;
 		if (mmget_not_zero(mm)) {
-			down_read(&mm->mmap_sem);
-			while (pinned < npages) {
-				ret = get_user_pages_remote
-					(work->task, mm,
-					 obj->userptr.ptr + pinned * PAGE_SIZE,
-					 npages - pinned,
-					 flags,
-					 pvec + pinned, NULL, NULL);
-				if (ret < 0)
-					break;
-
-				pinned += ret;
-			}
-			up_read(&mm->mmap_sem);
+			ret = __i915_gem_userptr_pin_pages(obj, work->task, mm,
+							   pvec,
+							   work->first,
+							   work->count);
 			mmput(mm);
 		}
 	}
@@ -534,11 +708,11 @@ __i915_gem_userptr_get_pages_worker(struct work_struct *_work)
 	if (obj->userptr.work == &work->work) {
 		struct sg_table *pages = ERR_PTR(ret);
 
-		if (pinned == npages) {
+		if (ret == 0) {
 			pages = __i915_gem_userptr_alloc_pages(obj, pvec,
 							       npages);
 			if (!IS_ERR(pages)) {
-				pinned = 0;
+				consumed = true;
 				pages = NULL;
 			}
 		}
@@ -549,7 +723,8 @@ __i915_gem_userptr_get_pages_worker(struct work_struct *_work)
 	}
 	mutex_unlock(&obj->mm.lock);
 
-	release_pages(pvec, pinned);
+	if (pvec && !consumed)
+		release_pvec(pvec, 0, npages);
 	kvfree(pvec);
 
 	i915_gem_object_put(obj);
@@ -558,7 +733,10 @@ __i915_gem_userptr_get_pages_worker(struct work_struct *_work)
 }
 
 static struct sg_table *
-__i915_gem_userptr_get_pages_schedule(struct drm_i915_gem_object *obj)
+__i915_gem_userptr_get_pages_schedule(struct drm_i915_gem_object *obj,
+				      struct page **pvec,
+				      unsigned long first,
+				      unsigned long count)
 {
 	struct get_pages_work *work;
 
@@ -580,6 +758,10 @@ __i915_gem_userptr_get_pages_schedule(struct drm_i915_gem_object *obj)
 	 * If the worker encounters an error, it reports
 	 * that error back to this function through
 	 * obj->userptr.work = ERR_PTR.
+	 *
+	 * If given a @pvec of the pages retained across a
+	 * partial invalidation, the worker takes ownership
+	 * of it and only pins the @count pages from @first.
 	 */
 	work = kmalloc(sizeof(*work), GFP_KERNEL);
 	if (work == NULL)
@@ -592,6 +774,10 @@ __i915_gem_userptr_get_pages_schedule(struct drm_i915_gem_object *obj)
 	work->task = current;
 	get_task_struct(work->task);
 
+	work->pvec = pvec;
+	work->first = first;
+	work->count = count;
+
 	INIT_WORK(&work->work, __i915_gem_userptr_get_pages_worker);
 	queue_work(to_i915(obj->base.dev)->mm.userptr_wq, &work->work);
 
@@ -602,7 +788,8 @@ static int i915_gem_userptr_get_pages(struct drm_i915_gem_object *obj)
 {
 	const int num_pages = obj->base.size >> PAGE_SHIFT;
 	struct mm_struct *mm = obj->userptr.mm->mm;
-	struct page **pvec;
+	struct page **pvec, **stash;
+	unsigned long first, count;
 	struct sg_table *pages;
 	bool active;
 	int pinned;
@@ -632,28 +819,48 @@ static int i915_gem_userptr_get_pages(struct drm_i915_gem_object *obj)
 			return -EAGAIN;
 	}
 
-	pvec = NULL;
+	/* Reuse whatever survived a partial invalidation */
+	stash = fetch_and_zero(&obj->userptr.stash);
+	if (stash) {
+		first = obj->userptr.stale_start;
+		count = obj->userptr.stale_end - first;
+	} else {
+		first = 0;
+		count = num_pages;
+	}
+
+	pvec = stash;
 	pinned = 0;
 
 	if (mm == current->mm) {
-		pvec = kvmalloc_array(num_pages, sizeof(struct page *),
-				      GFP_KERNEL |
-				      __GFP_NORETRY |
-				      __GFP_NOWARN);
+		if (!pvec)
+			pvec = kvmalloc_array(num_pages, sizeof(struct page *),
+					      GFP_KERNEL |
+					      __GFP_NORETRY |
+					      __GFP_NOWARN);
 		if (pvec) /* defer to worker if malloc fails */
-			pinned = __get_user_pages_fast(obj->userptr.ptr,
-						       num_pages,
+			pinned = __get_user_pages_fast(obj->userptr.ptr +
+						       first * PAGE_SIZE,
+						       count,
 						       !i915_gem_object_is_readonly(obj),
-						       pvec);
+						       pvec + first);
 	}
 
 	active = false;
 	if (pinned < 0) {
 		pages = ERR_PTR(pinned);
 		pinned = 0;
-	} else if (pinned < num_pages) {
-		pages = __i915_gem_userptr_get_pages_schedule(obj);
+	} else if (pinned < count) {
+		release_pvec(pvec, first, first + pinned);
+		pinned = 0;
+
+		pages = __i915_gem_userptr_get_pages_schedule(obj, stash,
+							      first, count);
 		active = pages == ERR_PTR(-EAGAIN);
+		if (active && stash) { /* now owned by the worker */
+			stash = NULL;
+			pvec = NULL;
+		}
 	} else {
 		pages = __i915_gem_userptr_alloc_pages(obj, pvec, num_pages);
 		active = !IS_ERR(pages);
@@ -661,8 +868,12 @@ static int i915_gem_userptr_get_pages(struct drm_i915_gem_object *obj)
 	if (active)
 		__i915_gem_userptr_set_active(obj, true);
 
-	if (IS_ERR(pages))
-		release_pages(pvec, pinned);
+	if (IS_ERR(pages)) {
+		if (stash)
+			release_pvec(stash, 0, num_pages);
+		else
+			release_pages(pvec, pinned);
+	}
 	kvfree(pvec);
 
 	return PTR_ERR_OR_ZERO(pages);
@@ -673,10 +884,24 @@ i915_gem_userptr_put_pages(struct drm_i915_gem_object *obj,
 			   struct sg_table *pages)
 {
 	struct sgt_iter sgt_iter;
+	struct page **stash = NULL;
 	struct page *page;
+	unsigned long i = 0;
 
 	BUG_ON(obj->userptr.work != NULL);
-	__i915_gem_userptr_set_active(obj, false);
+	GEM_BUG_ON(obj->userptr.stash);
+
+	/*
+	 * Following a partial invalidation, hold on to the pages outside
+	 * of the invalidated range so they need not all be re-pinned, and
+	 * stay on the mmu notifier so we learn if they too are invalidated.
+	 */
+	if (obj->userptr.keep_stash)
+		stash = kvmalloc_array(obj->base.size >> PAGE_SHIFT,
+				       sizeof(*stash),
+				       GFP_KERNEL | __GFP_NOWARN);
+	if (!stash)
+		__i915_gem_userptr_set_active(obj, false);
 
 	if (obj->mm.madv != I915_MADV_WILLNEED)
 		obj->mm.dirty = false;
@@ -688,10 +913,23 @@ i915_gem_userptr_put_pages(struct drm_i915_gem_object *obj,
 			set_page_dirty(page);
 
 		mark_page_accessed(page);
+		if (stash &&
+		    (i < obj->userptr.stale_start ||
+		     i >= obj->userptr.stale_end)) {
+			stash[i++] = page;
+			continue;
+		}
+
+		if (stash)
+			stash[i] = NULL;
 		put_page(page);
+		i++;
 	}
 	obj->mm.dirty = false;
 
+	if (stash)
+		obj->userptr.stash = stash;
+
 	sg_free_table(pages);
 	kfree(pages);
 }
@@ -699,6 +937,12 @@ i915_gem_userptr_put_pages(struct drm_i915_gem_object *obj,
 static void
 i915_gem_userptr_release(struct drm_i915_gem_object *obj)
 {
+	if (obj->userptr.stash) {
+		release_pvec(obj->userptr.stash, 0,
+			     obj->base.size >> PAGE_SHIFT);
+		kvfree(fetch_and_zero(&obj->userptr.stash));
+	}
+
 	i915_gem_userptr_release__mmu_notifier(obj);
 	i915_gem_userptr_release__mm_struct(obj);
 }
@@ -775,6 +1019,7 @@ i915_gem_userptr_ioctl(struct drm_device *dev,
 	}
 
 	if (args->flags & ~(I915_USERPTR_READ_ONLY |
+			    I915_USERPTR_PREFAULT |
 			    I915_USERPTR_UNSYNCHRONIZED))
 		return -EINVAL;
 
@@ -818,12 +1063,24 @@ i915_gem_userptr_ioctl(struct drm_device *dev,
 	 * at binding. This means that we need to hook into the mmu_notifier
 	 * in order to detect if the mmu is destroyed.
 	 */
+	i915_gem_object_set_client(obj, file, I915_GEM_CLIENT_USERPTR);
+
 	ret = i915_gem_userptr_init__mm_struct(obj);
 	if (ret == 0)
 		ret = i915_gem_userptr_init__mmu_notifier(obj, args->flags);
 	if (ret == 0)
 		ret = drm_gem_handle_create(file, &obj->base, &handle);
 
+	/*
+	 * Kick off acquiring the pages now, so that the first execbuf need
+	 * not wait for them. Any pages we could not grab immediately are
+	 * left to the worker, so -EAGAIN is expected and any real error will
+	 * be reported again upon use.
+	 */
+	if (ret == 0 && args->flags & I915_USERPTR_PREFAULT &&
+	    i915_gem_object_pin_pages(obj) == 0)
+		i915_gem_object_unpin_pages(obj);
+
 	/* drop reference from allocate - handle holds it now */
 	i915_gem_object_put(obj);
 	if (ret)
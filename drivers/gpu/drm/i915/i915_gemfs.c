@@ -48,16 +48,27 @@ int i915_gemfs_init(struct drm_i915_private *i915)
 	 * we allocate an object of size 2M + 4K, we may get 2M + 2M, but under
 	 * memory pressure shmem should split any huge-pages which can be
 	 * shrunk.
+	 *
+	 * Besides the GTT, the huge pages also benefit CPU mmaps of the
+	 * object (i915_gem_mmap_ioctl), as shmemfs aligns the mapping and
+	 * installs PMD entries for the huge pages on fault, for both the WB
+	 * and WC variants.
 	 */
 
 	if (has_transparent_hugepage()) {
 		struct super_block *sb = gemfs->mnt_sb;
-		/* FIXME: Disabled until we get W/A for read BW issue. */
-		char options[] = "huge=never";
+		/*
+		 * FIXME: Disabled by default until we get W/A for read BW
+		 * issue.
+		 */
+		char huge[] = "huge=within_size";
+		char never[] = "huge=never";
 		int flags = 0;
 		int err;
 
-		err = sb->s_op->remount_fs(sb, &flags, options);
+		err = sb->s_op->remount_fs(sb, &flags,
+					   i915_modparams.gemfs_huge ?
+					   huge : never);
 		if (err) {
 			kern_unmount(gemfs);
 			return err;
@@ -28,7 +28,9 @@
  */
 
 #include <generated/utsrelease.h>
+#include <linux/highmem.h>
 #include <linux/stop_machine.h>
+#include <linux/workqueue.h>
 #include <linux/zlib.h>
 #include <drm/drm_print.h>
 
@@ -223,7 +225,10 @@ static bool compress_init(struct compress *c)
 	if (!zstream->workspace)
 		return false;
 
-	if (zlib_deflateInit(zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+	if (zlib_deflateInit(zstream,
+			     clamp(i915_modparams.error_compression,
+				   Z_DEFAULT_COMPRESSION,
+				   Z_BEST_COMPRESSION)) != Z_OK) {
 		kfree(zstream->workspace);
 		return false;
 	}
@@ -642,6 +647,8 @@ int i915_error_state_to_str(struct drm_i915_error_state_buf *m,
 		return 0;
 	}
 
+	i915_gpu_state_wait(error);
+
 	if (*error->error_msg)
 		err_printf(m, "%s\n", error->error_msg);
 	err_printf(m, "Kernel: " UTS_RELEASE "\n");
@@ -806,6 +813,14 @@ int i915_error_state_to_str(struct drm_i915_error_state_buf *m,
 			}
 		}
 
+		if (ee->num_trace) {
+			struct drm_printer p = i915_error_printer(m);
+
+			err_printf(m, "%s --- %u trace events\n",
+				   dev_priv->engine[i]->name, ee->num_trace);
+			intel_engine_dump_trace(ee->trace, ee->num_trace, &p);
+		}
+
 		print_error_obj(m, dev_priv->engine[i],
 				"ringbuffer", ee->ringbuffer);
 
@@ -873,6 +888,18 @@ int i915_error_state_buf_init(struct drm_i915_error_state_buf *ebuf,
 	return 0;
 }
 
+static void error_object_release_src(struct drm_i915_error_object *obj)
+{
+	unsigned long n;
+
+	for (n = 0; n < obj->src_count; n++)
+		free_page((unsigned long)obj->src[n]);
+	kfree(obj->src);
+
+	obj->src = NULL;
+	obj->src_count = 0;
+}
+
 static void i915_error_object_free(struct drm_i915_error_object *obj)
 {
 	int page;
@@ -880,6 +907,8 @@ static void i915_error_object_free(struct drm_i915_error_object *obj)
 	if (obj == NULL)
 		return;
 
+	error_object_release_src(obj);
+
 	for (page = 0; page < obj->page_count; page++)
 		free_page((unsigned long)obj->pages[page].storage);
 
@@ -914,6 +943,8 @@ void __i915_gpu_state_free(struct kref *error_ref)
 		container_of(error_ref, typeof(*error), ref);
 	long i, j;
 
+	i915_gpu_state_wait(error);
+
 	for (i = 0; i < ARRAY_SIZE(error->engine); i++) {
 		struct drm_i915_error_engine *ee = &error->engine[i];
 
@@ -929,6 +960,7 @@ void __i915_gpu_state_free(struct kref *error_ref)
 		i915_error_object_free(ee->wa_ctx);
 
 		kfree(ee->requests);
+		kfree(ee->trace);
 		if (!IS_ERR_OR_NULL(ee->waiters))
 			kfree(ee->waiters);
 	}
@@ -960,6 +992,159 @@ static bool is_fake_vma(struct i915_vma *vma)
 	return true;
 }
 
+static bool error_object_defer(struct drm_i915_private *i915,
+			       struct i915_vma *vma,
+			       struct drm_i915_error_object *dst)
+{
+	unsigned long count =
+		min_t(u64, vma->size, vma->obj->base.size) >> PAGE_SHIFT;
+	struct sgt_iter iter;
+	struct page *page;
+	unsigned long n;
+	dma_addr_t dma;
+
+	if (!i915->gpu_error.capture_deferred)
+		return false;
+
+	/* Only the normal view shares the object's backing pages */
+	if (!i915_gem_object_has_struct_page(vma->obj) ||
+	    vma->pages != vma->obj->mm.pages)
+		return false;
+
+	dst->src = kmalloc_array(count, sizeof(*dst->src),
+				 GFP_ATOMIC | __GFP_NOWARN);
+	if (!dst->src)
+		return false;
+
+	/*
+	 * Copy the contents now, while the GPU is stopped and before the
+	 * pages can be rewritten or reused; only the compression is deferred.
+	 */
+	dst->src_count = 0;
+	for_each_sgt_page(page, iter, vma->pages) {
+		void *copy, *s;
+
+		if (dst->src_count == count)
+			break;
+
+		copy = (void *)__get_free_page(GFP_ATOMIC | __GFP_NOWARN);
+		if (!copy) {
+			error_object_release_src(dst);
+			return false;
+		}
+
+		s = kmap_atomic(page);
+		/* The GPU may have written behind the CPU cache */
+		drm_clflush_virt_range(s, PAGE_SIZE);
+		memcpy(copy, s, PAGE_SIZE);
+		kunmap_atomic(s);
+
+		dst->src[dst->src_count++] = copy;
+	}
+
+	if (INTEL_GEN(i915) >= 8 && vma->node.start != U64_MAX) {
+		struct i915_error_walk walk = {};
+
+		n = 0;
+		for_each_sgt_dma(dma, iter, vma->pages) {
+			if (n == count)
+				break;
+
+			dst->pages[n].paddr = dma;
+			i915_error_page_walk(i915, &walk, vma->vm,
+					     dst->gtt_offset + n * PAGE_SIZE,
+					     &dst->pages[n].pte,
+					     &dst->pages[n].pte_paddr);
+			n++;
+		}
+		i915_error_walk_fini(&walk);
+	}
+
+	list_add_tail(&dst->link, i915->gpu_error.capture_deferred);
+	return true;
+}
+
+static void error_object_compress(struct drm_i915_error_object *dst)
+{
+	struct compress compress;
+	unsigned long n;
+	int ret = 0;
+
+	if (!compress_init(&compress))
+		goto out;
+
+	for (n = 0; n < dst->src_count; n++) {
+		ret = compress_page(&compress, dst->src[n], dst);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		while (dst->page_count--)
+			free_page((unsigned long)dst->pages[dst->page_count].storage);
+		dst->page_count = 0;
+	}
+
+	compress_fini(&compress, ret ? NULL : dst);
+out:
+	error_object_release_src(dst);
+}
+
+struct error_compress_work {
+	struct work_struct work;
+	struct i915_gpu_state *error;
+	struct drm_i915_error_object *obj;
+};
+
+static void error_compress_worker(struct work_struct *work)
+{
+	struct error_compress_work *w =
+		container_of(work, typeof(*w), work);
+	struct i915_gpu_state *error = w->error;
+
+	error_object_compress(w->obj);
+	kfree(w);
+
+	if (atomic_dec_and_test(&error->pending))
+		wake_up_var(&error->pending);
+}
+
+static void i915_gpu_state_compress(struct i915_gpu_state *error)
+{
+	struct drm_i915_error_object *obj, *on;
+
+	/*
+	 * Spread the compression of the captured objects over the unbound
+	 * workqueue so that neither the reset nor the other clients wait
+	 * upon it. Readers of the error state wait for it to complete.
+	 */
+	list_for_each_entry_safe(obj, on, &error->deferred, link) {
+		struct error_compress_work *w;
+
+		list_del(&obj->link);
+
+		w = kmalloc(sizeof(*w), GFP_ATOMIC | __GFP_NOWARN);
+		if (!w) {
+			error_object_compress(obj);
+			continue;
+		}
+
+		INIT_WORK(&w->work, error_compress_worker);
+		w->error = error;
+		w->obj = obj;
+
+		atomic_inc(&error->pending);
+		queue_work(system_unbound_wq, &w->work);
+	}
+}
+
+void i915_gpu_state_wait(const struct i915_gpu_state *error)
+{
+	atomic_t *pending = (atomic_t *)&error->pending;
+
+	wait_var_event(pending, !atomic_read(pending));
+}
+
 static struct drm_i915_error_object *
 i915_error_object_create(struct drm_i915_private *i915,
 			 struct i915_vma *vma)
@@ -967,6 +1152,7 @@ i915_error_object_create(struct drm_i915_private *i915,
 	struct i915_ggtt *ggtt = &i915->ggtt;
 	const u64 slot = ggtt->error_capture.start;
 	struct drm_i915_error_object *dst;
+	struct i915_error_walk walk = {};
 	struct compress compress;
 	unsigned long num_pages;
 	struct sgt_iter iter;
@@ -987,6 +1173,11 @@ i915_error_object_create(struct drm_i915_private *i915,
 	dst->tiling = i915_gem_object_get_tiling(vma->obj);
 	dst->page_count = 0;
 	dst->unused = 0;
+	dst->src = NULL;
+	dst->src_count = 0;
+
+	if (error_object_defer(i915, vma, dst))
+		return dst;
 
 	if (!compress_init(&compress)) {
 		kfree(dst);
@@ -1001,7 +1192,8 @@ i915_error_object_create(struct drm_i915_private *i915,
 
 		if (INTEL_GEN(i915) >= 8 && !is_fake_vma(vma)) {
 			dst->pages[dst->page_count].paddr = dma;
-			i915_error_page_walk(i915, vma->vm, dst->gtt_offset +
+			i915_error_page_walk(i915, &walk, vma->vm,
+					     dst->gtt_offset +
 					     dst->page_count * PAGE_SIZE,
 					     &dst->pages[dst->page_count].pte,
 					     &dst->pages[dst->page_count].pte_paddr);
@@ -1023,6 +1215,7 @@ i915_error_object_create(struct drm_i915_private *i915,
 	dst = NULL;
 
 out:
+	i915_error_walk_fini(&walk);
 	compress_fini(&compress, dst);
 	ggtt->vm.clear_range(&ggtt->vm, slot, PAGE_SIZE);
 	return dst;
@@ -1546,6 +1739,12 @@ static void gem_record_rings(struct i915_gpu_state *error)
 		ee->wa_ctx = i915_error_object_create(i915, engine->wa_ctx.vma);
 
 		ee->default_state = capture_object(i915, engine->default_state);
+
+		ee->trace = kmalloc_array(INTEL_ENGINE_TRACE_SIZE,
+					  sizeof(*ee->trace), GFP_ATOMIC);
+		if (ee->trace)
+			ee->num_trace = intel_engine_copy_trace(engine,
+								ee->trace);
 	}
 }
 
@@ -1841,6 +2040,8 @@ static int capture(void *data)
 {
 	struct i915_gpu_state *error = data;
 
+	error->i915->gpu_error.capture_deferred = &error->deferred;
+
 	error->time = ktime_get_real();
 	error->boottime = ktime_get_boottime();
 	error->uptime = ktime_sub(ktime_get(),
@@ -1862,6 +2063,7 @@ static int capture(void *data)
 
 	error->epoch = capture_find_epoch(error);
 
+	error->i915->gpu_error.capture_deferred = NULL;
 	return 0;
 }
 
@@ -1878,9 +2080,13 @@ i915_capture_gpu_state(struct drm_i915_private *i915)
 
 	kref_init(&error->ref);
 	error->i915 = i915;
+	INIT_LIST_HEAD(&error->deferred);
+	atomic_set(&error->pending, 0);
 
 	stop_machine(capture, error, NULL);
 
+	i915_gpu_state_compress(error);
+
 	return error;
 }
 
@@ -36,6 +36,10 @@ struct i915_gpu_state {
 
 	struct drm_i915_private *i915;
 
+	/* objects awaiting compression outside of stop_machine */
+	struct list_head deferred;
+	atomic_t pending;
+
 	char error_msg[128];
 	bool simulated;
 	bool awake;
@@ -144,6 +148,10 @@ struct i915_gpu_state {
 			u32 tiling:2;
 			int page_count;
 			int unused;
+			/* raw copy held until compressed after capture */
+			struct list_head link;
+			void **src;
+			unsigned long src_count;
 			struct drm_i915_error_page {
 				phys_addr_t pte_paddr;
 				gen8_pte_t pte;
@@ -178,6 +186,9 @@ struct i915_gpu_state {
 			u32 seqno;
 		} *waiters;
 
+		struct intel_engine_trace_entry *trace;
+		unsigned int num_trace;
+
 		struct {
 			u32 gfx_mode;
 			union {
@@ -224,6 +235,12 @@ struct i915_gpu_error {
 	/* Protected by the above dev->gpu_error.lock. */
 	struct i915_gpu_state *first_error;
 
+	/*
+	 * Only valid underneath stop_machine(): objects backed by struct
+	 * pages are copied here and compressed after the machine restarts.
+	 */
+	struct list_head *capture_deferred;
+
 	atomic_t pending_fb_pin;
 
 	unsigned long missed_irq_rings;
@@ -347,6 +364,7 @@ i915_error_state_buf_release(struct drm_i915_error_state_buf *eb)
 }
 
 struct i915_gpu_state *i915_capture_gpu_state(struct drm_i915_private *i915);
+void i915_gpu_state_wait(const struct i915_gpu_state *error);
 void i915_capture_error_state(struct drm_i915_private *dev_priv,
 			      u32 engine_mask,
 			      const char *error_msg);
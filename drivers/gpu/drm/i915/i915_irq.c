@@ -1281,6 +1281,7 @@ static void gen6_pm_rps_work(struct work_struct *work)
 		container_of(work, struct drm_i915_private, gt_pm.rps.work);
 	struct intel_rps *rps = &dev_priv->gt_pm.rps;
 	bool client_boost = false;
+	bool qos = false;
 	int new_delay, adj, min, max;
 	u32 pm_iir = 0;
 
@@ -1288,12 +1289,13 @@ static void gen6_pm_rps_work(struct work_struct *work)
 	if (rps->interrupts_enabled) {
 		pm_iir = fetch_and_zero(&rps->pm_iir);
 		client_boost = atomic_read(&rps->num_waiters);
+		qos = atomic_xchg(&rps->qos.dirty, 0);
 	}
 	spin_unlock_irq(&dev_priv->irq_lock);
 
 	/* Make sure we didn't queue anything we're not going to process. */
 	WARN_ON(pm_iir & ~dev_priv->pm_rps_events);
-	if ((pm_iir & dev_priv->pm_rps_events) == 0 && !client_boost)
+	if ((pm_iir & dev_priv->pm_rps_events) == 0 && !client_boost && !qos)
 		goto out;
 
 	mutex_lock(&dev_priv->pcu_lock);
@@ -1304,6 +1306,8 @@ static void gen6_pm_rps_work(struct work_struct *work)
 	new_delay = rps->cur_freq;
 	min = rps->min_freq_softlimit;
 	max = rps->max_freq_softlimit;
+	if (atomic_read(&rps->qos.users))
+		intel_rps_qos_limits(rps, &min, &max);
 	if (client_boost)
 		max = rps->max_freq;
 	if (client_boost && new_delay < rps->boost_freq) {
@@ -1504,7 +1508,7 @@ gen8_cs_irq_handler(struct intel_engine_cs *engine, u32 iir)
 	}
 
 	if (tasklet)
-		tasklet_hi_schedule(&engine->execlists.tasklet);
+		intel_engine_kick_irq_tasklet(engine);
 
 	if (iir & (GT_GEN8_WATCHDOG_INTERRUPT))
 		tasklet_schedule(&engine->execlists.watchdog_tasklet);
@@ -2724,6 +2728,24 @@ static void gen11_hpd_irq_handler(struct drm_i915_private *dev_priv, u32 iir)
 		DRM_ERROR("Unexpected DE HPD interrupt 0x%08x\n", iir);
 }
 
+static void skl_flip_done_irq_handler(struct drm_i915_private *dev_priv,
+				      enum pipe pipe)
+{
+	struct intel_crtc *crtc = intel_get_crtc_for_pipe(dev_priv, pipe);
+	struct drm_pending_vblank_event *event;
+
+	spin_lock(&dev_priv->irq_lock);
+	bdw_disable_pipe_irq(dev_priv, pipe,
+			     GEN9_PIPE_PLANE_FLIP_DONE(PLANE_PRIMARY));
+	spin_unlock(&dev_priv->irq_lock);
+
+	spin_lock(&dev_priv->drm.event_lock);
+	event = fetch_and_zero(&crtc->flip_done_event);
+	if (event)
+		drm_crtc_send_vblank_event(&crtc->base, event);
+	spin_unlock(&dev_priv->drm.event_lock);
+}
+
 static irqreturn_t
 gen8_de_irq_handler(struct drm_i915_private *dev_priv, u32 master_ctl)
 {
@@ -2843,6 +2865,10 @@ gen8_de_irq_handler(struct drm_i915_private *dev_priv, u32 master_ctl)
 		if (iir & GEN8_PIPE_VBLANK)
 			drm_handle_vblank(&dev_priv->drm, pipe);
 
+		if (INTEL_GEN(dev_priv) >= 9 &&
+		    iir & GEN9_PIPE_PLANE_FLIP_DONE(PLANE_PRIMARY))
+			skl_flip_done_irq_handler(dev_priv, pipe);
+
 		if (iir & GEN8_PIPE_CDCLK_CRC_DONE)
 			hsw_pipe_crc_irq_handler(dev_priv, pipe);
 
@@ -3462,6 +3488,33 @@ static void gen8_disable_vblank(struct drm_device *dev, unsigned int pipe)
 	spin_unlock_irqrestore(&dev_priv->irq_lock, irqflags);
 }
 
+/**
+ * skl_arm_flip_done - send an event once an async flip has been latched
+ * @crtc: the crtc whose primary plane is being flipped
+ * @event: the pending event to send
+ *
+ * An async flip does not wait for the vblank, instead the plane raises a
+ * flip done interrupt once it has latched the new surface address. Unmask
+ * that interrupt, which must be done before writing PLANE_SURF, and have
+ * its handler send @event.
+ */
+void skl_arm_flip_done(struct intel_crtc *crtc,
+		       struct drm_pending_vblank_event *event)
+{
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&dev_priv->drm.event_lock, irqflags);
+	WARN_ON(crtc->flip_done_event);
+	crtc->flip_done_event = event;
+	spin_unlock_irqrestore(&dev_priv->drm.event_lock, irqflags);
+
+	spin_lock_irqsave(&dev_priv->irq_lock, irqflags);
+	bdw_enable_pipe_irq(dev_priv, crtc->pipe,
+			    GEN9_PIPE_PLANE_FLIP_DONE(PLANE_PRIMARY));
+	spin_unlock_irqrestore(&dev_priv->irq_lock, irqflags);
+}
+
 static void ibx_irq_reset(struct drm_i915_private *dev_priv)
 {
 	if (HAS_PCH_NOP(dev_priv))
@@ -3667,6 +3720,9 @@ void gen8_irq_power_well_post_enable(struct drm_i915_private *dev_priv,
 	uint32_t extra_ier = GEN8_PIPE_VBLANK | GEN8_PIPE_FIFO_UNDERRUN;
 	enum pipe pipe;
 
+	if (INTEL_GEN(dev_priv) >= 9)
+		extra_ier |= GEN9_PIPE_PLANE_FLIP_DONE(PLANE_PRIMARY);
+
 	spin_lock_irq(&dev_priv->irq_lock);
 
 	if (!intel_irqs_enabled(dev_priv)) {
@@ -4199,6 +4255,8 @@ static void gen8_de_irq_postinstall(struct drm_i915_private *dev_priv)
 
 	de_pipe_enables = de_pipe_masked | GEN8_PIPE_VBLANK |
 					   GEN8_PIPE_FIFO_UNDERRUN;
+	if (INTEL_GEN(dev_priv) >= 9)
+		de_pipe_enables |= GEN9_PIPE_PLANE_FLIP_DONE(PLANE_PRIMARY);
 
 	de_port_enables = de_port_masked;
 	if (IS_GEN9_LP(dev_priv))
@@ -75,6 +75,10 @@ i915_param_named(error_capture, bool, 0600,
 	"Record the GPU state following a hang. "
 	"This information in /sys/class/drm/card<N>/error is vital for "
 	"triaging and debugging hangs.");
+
+i915_param_named(error_compression, int, 0600,
+	"zlib compression level used for the recorded GPU state "
+	"(-1=zlib default [default], 0=store only, 1=fastest ... 9=best)");
 #endif
 
 i915_param_named_unsafe(enable_hangcheck, bool, 0644,
@@ -82,6 +86,15 @@ i915_param_named_unsafe(enable_hangcheck, bool, 0644,
 	"WARNING: Disabling this can cause system wide hangs. "
 	"(default: true)");
 
+i915_param_named(enable_ggtt_gpu_bind, bool, 0600,
+	"Write the PTEs of large GGTT binds with the GPU (MI_UPDATE_GTT) "
+	"rather than through the CPU (default: false)");
+
+i915_param_named_unsafe(gemfs_huge, bool, 0400,
+	"Back shmem objects of at least 2M with transparent huge pages, "
+	"which CPU mmaps of those objects then map with PMD entries "
+	"(default: false)");
+
 i915_param_named_unsafe(enable_ppgtt, int, 0400,
 	"Override PPGTT usage. "
 	"(-1=auto [default], 0=disabled, 1=aliasing, 2=full, 3=full with extended address space)");
@@ -151,6 +164,10 @@ i915_param_named(guc_log_level, int, 0400,
 	"GuC firmware logging level. Requires GuC to be loaded. "
 	"(-1=auto [default], 0=disable, 1..4=enable with verbosity min..max)");
 
+i915_param_named_unsafe(guc_execbuf_clients, int, 0400,
+	"Number of GuC clients (doorbells and work queues) to spread the "
+	"engines across for GuC submission (default: 1)");
+
 i915_param_named_unsafe(guc_firmware_path, charp, 0400,
 	"GuC firmware path to use instead of the default one");
 
@@ -168,12 +185,74 @@ i915_param_named_unsafe(inject_load_failure, uint, 0400,
 	"Force an error after a number of failure check points (0:disabled (default), N:force failure at the Nth failure check point)");
 #endif
 
+i915_param_named_unsafe(huge_pool_mb, uint, 0400,
+	"Reserve a pool of this many MiB of 2M pages at load time for "
+	"objects created with I915_GEM_CREATE_HUGE_POOL (default: 0)");
+
+i915_param_named(huge_pool_client_mb, uint, 0600,
+	"Most MiB of objects created with I915_GEM_CREATE_HUGE_POOL that "
+	"a single client may own (default: 256)");
+
+i915_param_named(mmap_fault_around_mb, uint, 0600,
+	"Largest window in MiB mapped by a single GTT mmap fault when "
+	"accessing a large object sequentially, 1 to disable (default: 8)");
+
+i915_param_named(min_cdclk, int, 0600,
+	"Lowest cdclk in kHz to run at while any pipe is active, so that "
+	"enabling further outputs up to that bandwidth doesn't need a cdclk "
+	"change and the global modeset it may imply "
+	"(-1=maximum supported, default: 0=just what the active pipes need)");
+
+i915_param_named(park_delay_ms, uint, 0600,
+	"Minimum time in ms the GPU stays awake after going idle before it is "
+	"parked; longer delays are used automatically if it keeps being "
+	"woken up again shortly after parking (default: 100)");
+
+i915_param_named_unsafe(csb_in_irq, uint, 0400,
+	"Mask of engines (by id, bit0:rcs) whose context-switch events are "
+	"processed, and the next requests submitted, directly from the "
+	"interrupt handler rather than deferred to a tasklet (default: 0)");
+
+i915_param_named(steer_engine_irqs, bool, 0400,
+	"Process each engine's interrupts on its own CPU near the device "
+	"rather than on the CPU servicing the interrupt (default: false)");
+
 i915_param_named(enable_dpcd_backlight, bool, 0600,
 	"Enable support for DPCD backlight control (default:false)");
 
+i915_param_named(semaphores, bool, 0600,
+	"On gen8+, wait for requests on other engines with MI_SEMAPHORE_WAIT "
+	"when their context has a seqno page, rather than with an interrupt "
+	"(default:false)");
+
 i915_param_named(enable_gvt, bool, 0400,
 	"Enable support for Intel GVT-g graphics virtualization host support(default:false)");
 
+i915_param_named(gvt_balance_period_ms, uint, 0600,
+	"Period over which GVT-g shares the GPU time between vGPUs by their "
+	"weight, in milliseconds (default: 100)");
+
+i915_param_named(gvt_timeslice_us, uint, 0600,
+	"GVT-g scheduling tick, which is the quantum of interactive vGPUs, "
+	"in microseconds (default: 1000)");
+
+i915_param_named(gvt_batch_timeslice_us, uint, 0600,
+	"Minimum time a throughput class vGPU runs before GVT-g switches to "
+	"another one, in microseconds (default: 10000)");
+
+i915_param_named(gvt_irq_coalesce_us, uint, 0600,
+	"Minimum interval between two MSIs injected into a vGPU, events "
+	"inside the window are merged into one interrupt, in microseconds "
+	"(default: 0 [disabled])");
+
+i915_param_named(recycle_cache_mb, uint, 0600,
+	"Maximum size in MiB of the purgeable objects each client may keep "
+	"closed for reuse by I915_GEM_CREATE_RECYCLE (default: 64)");
+
+i915_param_named(context_pin_cache, uint, 0600,
+	"Number of recently used contexts kept pinned after they idle, "
+	"0 to unpin each context as soon as it is retired (default: 16)");
+
 static __always_inline void _print_param(struct drm_printer *p,
 					 const char *name,
 					 const char *type,
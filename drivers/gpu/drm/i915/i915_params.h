@@ -48,16 +48,32 @@ struct drm_printer;
 	param(int, invert_brightness, 0) \
 	param(int, enable_guc, 0) \
 	param(int, guc_log_level, -1) \
+	param(int, guc_execbuf_clients, 1) \
 	param(char *, guc_firmware_path, NULL) \
 	param(char *, huc_firmware_path, NULL) \
 	param(char *, dmc_firmware_path, NULL) \
 	param(int, mmio_debug, 0) \
 	param(int, edp_vswing, 0) \
 	param(int, reset, 2) \
+	param(int, error_compression, -1) \
+	param(int, min_cdclk, 0) \
 	param(unsigned int, inject_load_failure, 0) \
+	param(unsigned int, huge_pool_mb, 0) \
+	param(unsigned int, huge_pool_client_mb, 256) \
+	param(unsigned int, mmap_fault_around_mb, 8) \
+	param(unsigned int, csb_in_irq, 0) \
+	param(unsigned int, park_delay_ms, 100) \
+	param(unsigned int, gvt_balance_period_ms, 100) \
+	param(unsigned int, gvt_timeslice_us, 1000) \
+	param(unsigned int, gvt_batch_timeslice_us, 10000) \
+	param(unsigned int, gvt_irq_coalesce_us, 0) \
+	param(unsigned int, recycle_cache_mb, 64) \
+	param(unsigned int, context_pin_cache, 16) \
 	/* leave bools at the end to not create holes */ \
 	param(bool, alpha_support, IS_ENABLED(CONFIG_DRM_I915_ALPHA_SUPPORT)) \
 	param(bool, enable_hangcheck, true) \
+	param(bool, enable_ggtt_gpu_bind, false) \
+	param(bool, gemfs_huge, false) \
 	param(bool, fastboot, false) \
 	param(bool, prefault_disable, false) \
 	param(bool, load_detect_test, false) \
@@ -68,7 +84,9 @@ struct drm_printer;
 	param(bool, nuclear_pageflip, false) \
 	param(bool, enable_dp_mst, true) \
 	param(bool, enable_dpcd_backlight, false) \
-	param(bool, enable_gvt, false)
+	param(bool, enable_gvt, false) \
+	param(bool, steer_engine_irqs, false) \
+	param(bool, semaphores, false)
 
 #define MEMBER(T, member, ...) T member;
 struct i915_params {
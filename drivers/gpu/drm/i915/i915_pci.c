@@ -28,6 +28,7 @@
 
 #include "i915_drv.h"
 #include "i915_selftest.h"
+#include "intel_drv.h"
 
 #define PLATFORM(x) .platform = (x), .platform_mask = BIT(x)
 #define GEN(x) .gen = (x), .gen_mask = BIT((x) - 1)
@@ -779,7 +780,15 @@ static int __init i915_init(void)
 		return 0;
 	}
 
-	return pci_register_driver(&i915_pci_driver);
+	err = intel_atomic_slabs_init();
+	if (err)
+		return err;
+
+	err = pci_register_driver(&i915_pci_driver);
+	if (err)
+		intel_atomic_slabs_fini();
+
+	return err;
 }
 
 static void __exit i915_exit(void)
@@ -788,6 +797,7 @@ static void __exit i915_exit(void)
 		return;
 
 	pci_unregister_driver(&i915_pci_driver);
+	intel_atomic_slabs_fini();
 }
 
 module_init(i915_init);
@@ -192,6 +192,7 @@
  */
 
 #include <linux/anon_inodes.h>
+#include <linux/compat.h>
 #include <linux/sizes.h>
 #include <linux/uuid.h>
 
@@ -269,6 +270,17 @@
 #define POLL_FREQUENCY 200
 #define POLL_PERIOD (NSEC_PER_SEC / POLL_FREQUENCY)
 
+/*
+ * Bounds on the poll period, whether set by userspace or adapted to the
+ * report rate. There is no point polling faster than the tail may age.
+ * With adaptive polling, we aim to find an eighth of the buffer filled on
+ * each wakeup, leaving plenty of headroom against an overflow should the
+ * rate then jump before the period catches up.
+ */
+#define POLL_PERIOD_MIN		OA_TAIL_MARGIN_NSEC
+#define POLL_PERIOD_MAX		(100 * NSEC_PER_MSEC)
+#define POLL_ADAPTIVE_BYTES	(OA_BUFFER_SIZE / 8)
+
 /* for sysctl proc_dointvec_minmax of dev.i915.perf_stream_paranoid */
 static int zero;
 static int one = 1;
@@ -360,6 +372,9 @@ struct perf_open_properties {
 	int oa_format;
 	bool oa_periodic;
 	int oa_period_exponent;
+	bool oa_ctx_switch_only;
+
+	u64 poll_oa_period; /* 0 for adaptive */
 };
 
 static void free_oa_config(struct drm_i915_private *dev_priv,
@@ -780,7 +795,21 @@ static int gen8_append_oa_reports(struct i915_perf_stream *stream,
 		 * We don't rely solely on the reason field to identify context
 		 * switches since it's not-uncommon for periodic samples to
 		 * identify a switch before any 'context switch' report.
+		 *
+		 * If userspace only wants the bookends, we can drop every
+		 * report that isn't a transition into or out of our context
+		 * (with the same caveat of not trusting the reason field), so
+		 * that only the per-context deltas are left to be read.
 		 */
+		if (dev_priv->perf.oa.ctx_switch_only &&
+		    (dev_priv->perf.oa.specific_ctx_id == ctx_id) ==
+		    (dev_priv->perf.oa.oa_buffer.last_ctx_id ==
+		     dev_priv->perf.oa.specific_ctx_id)) {
+			dev_priv->perf.oa.oa_buffer.last_ctx_id = ctx_id;
+			report32[0] = 0;
+			continue;
+		}
+
 		if (!dev_priv->perf.oa.exclusive_stream->ctx ||
 		    dev_priv->perf.oa.specific_ctx_id == ctx_id ||
 		    (dev_priv->perf.oa.oa_buffer.last_ctx_id ==
@@ -1682,8 +1711,8 @@ static void gen8_update_reg_state_unlocked(struct i915_gem_context *ctx,
 }
 
 /*
- * Same as gen8_update_reg_state_unlocked only through the batchbuffer. This
- * is only used by the kernel context.
+ * Same as gen8_update_reg_state_unlocked only through the batchbuffer, so
+ * that the context image picks up the new values as the context runs.
  */
 static int gen8_emit_oa_config(struct i915_request *rq,
 			       const struct i915_oa_config *oa_config)
@@ -1745,40 +1774,33 @@ static int gen8_emit_oa_config(struct i915_request *rq,
 	return 0;
 }
 
-static int gen8_switch_to_updated_kernel_context(struct drm_i915_private *dev_priv,
-						 const struct i915_oa_config *oa_config)
+/**
+ * i915_oa_emit_ctx_config - bring a render context up to date with OA
+ * @rq: the request about to start the context's next submission
+ *
+ * Emits the per-context OA configuration into @rq, ahead of its payload,
+ * if the metric set has changed since the context was last configured.
+ * The LRI is saved into the context image along with the rest of the
+ * register state, so each context pays for a reconfiguration just once.
+ *
+ * Returns 0 on success, negative error code on failure.
+ */
+int i915_oa_emit_ctx_config(struct i915_request *rq)
 {
-	struct intel_engine_cs *engine = dev_priv->engine[RCS];
-	struct i915_timeline *timeline;
-	struct i915_request *rq;
+	struct drm_i915_private *dev_priv = rq->i915;
+	struct intel_context *ce = rq->hw_context;
 	int ret;
 
 	lockdep_assert_held(&dev_priv->drm.struct_mutex);
 
-	i915_retire_requests(dev_priv);
-
-	rq = i915_request_alloc(engine, dev_priv->kernel_context);
-	if (IS_ERR(rq))
-		return PTR_ERR(rq);
+	if (likely(ce->oa_config_seqno == dev_priv->perf.oa.ctx_config_seqno))
+		return 0;
 
-	ret = gen8_emit_oa_config(rq, oa_config);
-	if (ret) {
-		i915_request_add(rq);
+	ret = gen8_emit_oa_config(rq, dev_priv->perf.oa.ctx_config);
+	if (ret)
 		return ret;
-	}
-
-	/* Queue this switch after all other activity */
-	list_for_each_entry(timeline, &dev_priv->gt.timelines, link) {
-		struct i915_request *prev;
-
-		prev = i915_gem_active_raw(&timeline->last_request,
-					   &dev_priv->drm.struct_mutex);
-		if (prev)
-			i915_request_await_dma_fence(rq, &prev->fence);
-	}
-
-	i915_request_add(rq);
 
+	ce->oa_config_seqno = dev_priv->perf.oa.ctx_config_seqno;
 	return 0;
 }
 
@@ -1791,14 +1813,19 @@ static int gen8_switch_to_updated_kernel_context(struct drm_i915_private *dev_pr
  * wide profiling where we'd like a consistent sampling period even in
  * the face of context switches.
  *
- * Our approach of updating the register state context (as opposed to
- * say using a workaround batch buffer) ensures that the hardware
- * won't automatically reload an out-of-date timer exponent even
- * transiently before a WA BB could be parsed.
+ * Rewriting every context image requires the GPU to first be drained of
+ * all work (as the image may be written by the GPU on context switch),
+ * stalling every client whenever the metric set changes. Instead we only
+ * bump the generation of the configuration, and each render context
+ * applies it with an LRI at the head of its next request (see
+ * i915_oa_emit_ctx_config()). The trade-off is that a context that was
+ * already in flight keeps running with its previous configuration until
+ * its next submission, and that on restoring a context the stale timer
+ * exponent may be live for the few instructions until the LRI.
  *
  * This function needs to:
  * - Ensure the currently running context's per-context OA state is
- *   updated
+ *   updated, which we do by submitting the kernel context.
  * - Ensure that all existing contexts will have the correct per-context
  *   OA state if they are scheduled for use.
  * - Ensure any new contexts will be initialized with the correct
@@ -1810,61 +1837,24 @@ static int gen8_configure_all_contexts(struct drm_i915_private *dev_priv,
 				       const struct i915_oa_config *oa_config)
 {
 	struct intel_engine_cs *engine = dev_priv->engine[RCS];
-	struct i915_gem_context *ctx;
-	int ret;
-	unsigned int wait_flags = I915_WAIT_LOCKED;
+	struct i915_request *rq;
 
 	lockdep_assert_held(&dev_priv->drm.struct_mutex);
 
-	/* Switch away from any user context. */
-	ret = gen8_switch_to_updated_kernel_context(dev_priv, oa_config);
-	if (ret)
-		goto out;
+	dev_priv->perf.oa.ctx_config = oa_config;
+	dev_priv->perf.oa.ctx_config_seqno++;
 
 	/*
-	 * The OA register config is setup through the context image. This image
-	 * might be written to by the GPU on context switch (in particular on
-	 * lite-restore). This means we can't safely update a context's image,
-	 * if this context is scheduled/submitted to run on the GPU.
-	 *
-	 * We could emit the OA register config through the batch buffer but
-	 * this might leave small interval of time where the OA unit is
-	 * configured at an invalid sampling period.
-	 *
-	 * So far the best way to work around this issue seems to be draining
-	 * the GPU from any submitted work.
+	 * Program the OA unit now even if the GPU is idle, without waiting
+	 * for anyone else; the request picks up the new config itself.
 	 */
-	ret = i915_gem_wait_for_idle(dev_priv,
-				     wait_flags,
-				     MAX_SCHEDULE_TIMEOUT);
-	if (ret)
-		goto out;
-
-	/* Update all contexts now that we've stalled the submission. */
-	list_for_each_entry(ctx, &dev_priv->contexts.list, link) {
-		struct intel_context *ce = to_intel_context(ctx, engine);
-		u32 *regs;
-
-		/* OA settings will be set upon first use */
-		if (!ce->state)
-			continue;
-
-		regs = i915_gem_object_pin_map(ce->state->obj, I915_MAP_WB);
-		if (IS_ERR(regs)) {
-			ret = PTR_ERR(regs);
-			goto out;
-		}
-
-		ce->state->obj->mm.dirty = true;
-		regs += LRC_STATE_PN * PAGE_SIZE / sizeof(*regs);
-
-		gen8_update_reg_state_unlocked(ctx, regs, oa_config);
+	rq = i915_request_alloc(engine, dev_priv->kernel_context);
+	if (IS_ERR(rq))
+		return PTR_ERR(rq);
 
-		i915_gem_object_unpin_map(ce->state->obj);
-	}
+	i915_request_add(rq);
 
- out:
-	return ret;
+	return 0;
 }
 
 static int gen8_enable_metric_set(struct drm_i915_private *dev_priv,
@@ -2007,10 +1997,15 @@ static void i915_oa_stream_enable(struct i915_perf_stream *stream)
 
 	dev_priv->perf.oa.ops.oa_enable(dev_priv);
 
-	if (dev_priv->perf.oa.periodic)
+	if (dev_priv->perf.oa.periodic) {
+		dev_priv->perf.oa.poll_last_tail =
+			dev_priv->perf.oa.ops.oa_hw_tail_read(dev_priv);
+		dev_priv->perf.oa.poll_last_ns = ktime_get_mono_fast_ns();
+
 		hrtimer_start(&dev_priv->perf.oa.poll_check_timer,
-			      ns_to_ktime(POLL_PERIOD),
+			      ns_to_ktime(dev_priv->perf.oa.poll_period),
 			      HRTIMER_MODE_REL_PINNED);
+	}
 }
 
 static void gen7_oa_disable(struct drm_i915_private *dev_priv)
@@ -2151,9 +2146,25 @@ static int i915_oa_stream_init(struct i915_perf_stream *stream,
 	dev_priv->perf.oa.oa_buffer.format =
 		dev_priv->perf.oa.oa_formats[props->oa_format].format;
 
+	if (props->oa_ctx_switch_only) {
+		/*
+		 * Only gen8+ tag each report with the running context, and
+		 * we need a context to filter for.
+		 */
+		if (INTEL_GEN(dev_priv) < 8 || !stream->ctx) {
+			DRM_DEBUG("Context switch filtering requires a gen8+ single context stream\n");
+			return -EINVAL;
+		}
+	}
+
 	dev_priv->perf.oa.periodic = props->oa_periodic;
 	if (dev_priv->perf.oa.periodic)
 		dev_priv->perf.oa.period_exponent = props->oa_period_exponent;
+	dev_priv->perf.oa.ctx_switch_only = props->oa_ctx_switch_only;
+
+	dev_priv->perf.oa.poll_adaptive = !props->poll_oa_period;
+	dev_priv->perf.oa.poll_period =
+		props->poll_oa_period ?: POLL_PERIOD;
 
 	if (stream->ctx) {
 		ret = oa_get_render_ctx_id(stream);
@@ -2200,6 +2211,7 @@ static int i915_oa_stream_init(struct i915_perf_stream *stream,
 	}
 
 	stream->ops = &i915_oa_stream_ops;
+	stream->oa_buffer = dev_priv->perf.oa.oa_buffer.vma->obj;
 
 	dev_priv->perf.oa.exclusive_stream = stream;
 
@@ -2231,14 +2243,18 @@ void i915_oa_init_reg_state(struct intel_engine_cs *engine,
 			    struct i915_gem_context *ctx,
 			    u32 *reg_state)
 {
-	struct i915_perf_stream *stream;
+	struct drm_i915_private *dev_priv = engine->i915;
 
 	if (engine->id != RCS)
 		return;
 
-	stream = engine->i915->perf.oa.exclusive_stream;
-	if (stream)
-		gen8_update_reg_state_unlocked(ctx, reg_state, stream->oa_config);
+	/* A fresh image starts out with the current configuration */
+	to_intel_context(ctx, engine)->oa_config_seqno =
+		dev_priv->perf.oa.ctx_config_seqno;
+
+	if (dev_priv->perf.oa.ctx_config_seqno)
+		gen8_update_reg_state_unlocked(ctx, reg_state,
+					       dev_priv->perf.oa.ctx_config);
 }
 
 /**
@@ -2360,6 +2376,35 @@ static ssize_t i915_perf_read(struct file *file,
 	return ret;
 }
 
+/*
+ * Rescale the poll period so that the next wakeup should find about
+ * POLL_ADAPTIVE_BYTES of new reports, as measured from the rate at which
+ * the hardware tail advanced since the last check. The result is averaged
+ * with the previous period to smooth over bursts, and when nothing at all
+ * was written we simply back off.
+ */
+static void oa_poll_adapt_period(struct drm_i915_private *dev_priv)
+{
+	u32 tail = dev_priv->perf.oa.ops.oa_hw_tail_read(dev_priv);
+	u64 now = ktime_get_mono_fast_ns();
+	u64 elapsed = now - dev_priv->perf.oa.poll_last_ns;
+	u32 written = OA_TAKEN(tail, dev_priv->perf.oa.poll_last_tail);
+	u64 period = dev_priv->perf.oa.poll_period;
+
+	if (written) {
+		u64 target = div_u64(elapsed * POLL_ADAPTIVE_BYTES, written);
+
+		period = (period + target) / 2;
+	} else {
+		period *= 2;
+	}
+
+	dev_priv->perf.oa.poll_period =
+		clamp_t(u64, period, POLL_PERIOD_MIN, POLL_PERIOD_MAX);
+	dev_priv->perf.oa.poll_last_tail = tail;
+	dev_priv->perf.oa.poll_last_ns = now;
+}
+
 static enum hrtimer_restart oa_poll_check_timer_cb(struct hrtimer *hrtimer)
 {
 	struct drm_i915_private *dev_priv =
@@ -2371,7 +2416,11 @@ static enum hrtimer_restart oa_poll_check_timer_cb(struct hrtimer *hrtimer)
 		wake_up(&dev_priv->perf.oa.poll_wq);
 	}
 
-	hrtimer_forward_now(hrtimer, ns_to_ktime(POLL_PERIOD));
+	if (dev_priv->perf.oa.poll_adaptive)
+		oa_poll_adapt_period(dev_priv);
+
+	hrtimer_forward_now(hrtimer,
+			    ns_to_ktime(dev_priv->perf.oa.poll_period));
 
 	return HRTIMER_RESTART;
 }
@@ -2487,6 +2536,115 @@ static void i915_perf_disable_locked(struct i915_perf_stream *stream)
 		stream->ops->disable(stream);
 }
 
+/**
+ * i915_oa_buffer_info_locked - handle `I915_PERF_IOCTL_OA_BUFFER_INFO` ioctl
+ * @stream: An i915 perf stream
+ * @uinfo: where to report the OA buffer head and tail
+ *
+ * Reports the head and the aged (i.e. trusted to have landed) tail of the OA
+ * buffer, as offsets into the buffer, for userspace that has mapped the
+ * buffer with mmap() rather than using read().
+ *
+ * Returns: zero on success or a negative error code.
+ */
+static int i915_oa_buffer_info_locked(struct i915_perf_stream *stream,
+				      struct drm_i915_perf_oa_buffer_info __user *uinfo)
+{
+	struct drm_i915_private *dev_priv = stream->dev_priv;
+	struct drm_i915_perf_oa_buffer_info info;
+	u32 gtt_offset, head, tail;
+	unsigned long flags;
+
+	if (stream != dev_priv->perf.oa.exclusive_stream)
+		return -EINVAL;
+
+	/* As with read(), the OA unit is only sampling while enabled */
+	if (!stream->enabled)
+		return -EIO;
+
+	gtt_offset = i915_ggtt_offset(dev_priv->perf.oa.oa_buffer.vma);
+
+	/* Age the latest tail (as for the hrtimer) before reporting it */
+	oa_buffer_check_unlocked(dev_priv);
+
+	spin_lock_irqsave(&dev_priv->perf.oa.oa_buffer.ptr_lock, flags);
+	head = dev_priv->perf.oa.oa_buffer.head;
+	tail = dev_priv->perf.oa.oa_buffer.tails[dev_priv->perf.oa.oa_buffer.aged_tail_idx].offset;
+	spin_unlock_irqrestore(&dev_priv->perf.oa.oa_buffer.ptr_lock, flags);
+
+	if (tail == INVALID_TAIL_PTR)
+		tail = head;
+
+	info.size = OA_BUFFER_SIZE;
+	info.report_size = dev_priv->perf.oa.oa_buffer.format_size;
+	info.head = head - gtt_offset;
+	info.tail = tail - gtt_offset;
+
+	if (copy_to_user(uinfo, &info, sizeof(info)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/**
+ * i915_oa_buffer_set_head_locked - handle `I915_PERF_IOCTL_OA_BUFFER_HEAD`
+ * @stream: An i915 perf stream
+ * @uhead: the new head, as an offset into the OA buffer
+ *
+ * Consumes the reports before the new head, handing the space back to the
+ * OA unit. The new head may not overtake the aged tail.
+ *
+ * Returns: zero on success or a negative error code.
+ */
+static int i915_oa_buffer_set_head_locked(struct i915_perf_stream *stream,
+					  u32 __user *uhead)
+{
+	struct drm_i915_private *dev_priv = stream->dev_priv;
+	int report_size = dev_priv->perf.oa.oa_buffer.format_size;
+	u32 gtt_offset, head, old, tail;
+	unsigned long flags;
+	int ret = 0;
+
+	if (stream != dev_priv->perf.oa.exclusive_stream)
+		return -EINVAL;
+
+	if (!stream->enabled)
+		return -EIO;
+
+	if (get_user(head, uhead))
+		return -EFAULT;
+
+	if (head >= OA_BUFFER_SIZE || head & (report_size - 1))
+		return -EINVAL;
+
+	gtt_offset = i915_ggtt_offset(dev_priv->perf.oa.oa_buffer.vma);
+	head += gtt_offset;
+
+	spin_lock_irqsave(&dev_priv->perf.oa.oa_buffer.ptr_lock, flags);
+
+	old = dev_priv->perf.oa.oa_buffer.head;
+	tail = dev_priv->perf.oa.oa_buffer.tails[dev_priv->perf.oa.oa_buffer.aged_tail_idx].offset;
+	if (tail == INVALID_TAIL_PTR)
+		tail = old;
+
+	if (OA_TAKEN(head, old) > OA_TAKEN(tail, old)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	if (INTEL_GEN(dev_priv) >= 8)
+		I915_WRITE(GEN8_OAHEADPTR, head & GEN8_OAHEADPTR_MASK);
+	else
+		I915_WRITE(GEN7_OASTATUS2,
+			   ((head & GEN7_OASTATUS2_HEAD_MASK) |
+			    GEN7_OASTATUS2_MEM_SELECT_GGTT));
+	dev_priv->perf.oa.oa_buffer.head = head;
+
+unlock:
+	spin_unlock_irqrestore(&dev_priv->perf.oa.oa_buffer.ptr_lock, flags);
+	return ret;
+}
+
 /**
  * i915_perf_ioctl - support ioctl() usage with i915 perf stream FDs
  * @stream: An i915 perf stream
@@ -2510,6 +2668,10 @@ static long i915_perf_ioctl_locked(struct i915_perf_stream *stream,
 	case I915_PERF_IOCTL_DISABLE:
 		i915_perf_disable_locked(stream);
 		return 0;
+	case I915_PERF_IOCTL_OA_BUFFER_INFO:
+		return i915_oa_buffer_info_locked(stream, (void __user *)arg);
+	case I915_PERF_IOCTL_OA_BUFFER_HEAD:
+		return i915_oa_buffer_set_head_locked(stream, (void __user *)arg);
 	}
 
 	return -EINVAL;
@@ -2541,6 +2703,82 @@ static long i915_perf_ioctl(struct file *file,
 	return ret;
 }
 
+#ifdef CONFIG_COMPAT
+static long i915_perf_compat_ioctl(struct file *file,
+				   unsigned int cmd,
+				   unsigned long arg)
+{
+	/* The ioctl arguments are all laid out the same for 32bit */
+	return i915_perf_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
+}
+#else
+#define i915_perf_compat_ioctl NULL
+#endif
+
+/**
+ * i915_perf_mmap - handles mmap() of the OA buffer of a stream
+ * @file: An i915 perf stream file
+ * @vma: the user mapping
+ *
+ * Maps the OA buffer read-only into userspace, so that the reports can be
+ * consumed in place, see `I915_PERF_IOCTL_OA_BUFFER_INFO`. The buffer lives
+ * for as long as the stream, and the mapping keeps the stream file open.
+ *
+ * Returns: zero on success or a negative error code.
+ */
+static int i915_perf_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct i915_perf_stream *stream = file->private_data;
+	struct drm_i915_gem_object *obj = stream->oa_buffer;
+	unsigned long addr = vma->vm_start;
+	struct sgt_iter iter;
+	struct page *page;
+	int ret = 0;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > OA_BUFFER_SIZE)
+		return -EINVAL;
+
+	if (vma->vm_flags & VM_WRITE)
+		return -EACCES;
+
+	/*
+	 * read() filters out the reports of other contexts for a stream
+	 * opened on a single context, but the raw buffer holds them all. So
+	 * only hand it out to those who could have opened a system wide
+	 * stream in the first place.
+	 */
+	if (stream->ctx && i915_perf_stream_paranoid && !capable(CAP_SYS_ADMIN)) {
+		DRM_DEBUG("Insufficient privileges to map the OA buffer of a context filtered stream\n");
+		return -EACCES;
+	}
+
+	/*
+	 * We are called with mmap_sem held, while read() and the ioctls may
+	 * fault on user memory under perf.lock, so we must not take it here.
+	 * Our caller holds a reference on the file, and so the stream and
+	 * its OA buffer cannot be released underneath us.
+	 */
+	if (!obj)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+
+	/* The pages are pinned alongside the kernel's vmap of the buffer */
+	for_each_sgt_page(page, iter, obj->mm.pages) {
+		if (addr >= vma->vm_end)
+			break;
+
+		ret = vm_insert_page(vma, addr, page);
+		if (ret)
+			break;
+
+		addr += PAGE_SIZE;
+	}
+
+	return ret;
+}
+
 /**
  * i915_perf_destroy_locked - destroy an i915 perf stream
  * @stream: An i915 perf stream
@@ -2597,11 +2835,9 @@ static const struct file_operations fops = {
 	.release	= i915_perf_release,
 	.poll		= i915_perf_poll,
 	.read		= i915_perf_read,
+	.mmap		= i915_perf_mmap,
 	.unlocked_ioctl	= i915_perf_ioctl,
-	/* Our ioctl have no arguments, so it's safe to use the same function
-	 * to handle 32bits compatibility.
-	 */
-	.compat_ioctl   = i915_perf_ioctl,
+	.compat_ioctl   = i915_perf_compat_ioctl,
 };
 
 
@@ -2768,6 +3004,7 @@ static int read_properties_unlocked(struct drm_i915_private *dev_priv,
 	u32 i;
 
 	memset(props, 0, sizeof(struct perf_open_properties));
+	props->poll_oa_period = POLL_PERIOD;
 
 	if (!n_props) {
 		DRM_DEBUG("No i915 perf properties given\n");
@@ -2871,6 +3108,19 @@ static int read_properties_unlocked(struct drm_i915_private *dev_priv,
 			props->oa_periodic = true;
 			props->oa_period_exponent = value;
 			break;
+		case DRM_I915_PERF_PROP_OA_CTX_SWITCH_ONLY:
+			props->oa_ctx_switch_only = value;
+			break;
+		case DRM_I915_PERF_PROP_POLL_OA_PERIOD:
+			if (value &&
+			    (value < POLL_PERIOD_MIN || value > POLL_PERIOD_MAX)) {
+				DRM_DEBUG("OA poll period out of range [%llu, %llu]ns\n",
+					  POLL_PERIOD_MIN,
+					  (u64)POLL_PERIOD_MAX);
+				return -EINVAL;
+			}
+			props->poll_oa_period = value;
+			break;
 		case DRM_I915_PERF_PROP_MAX:
 			MISSING_CASE(id);
 			return -EINVAL;
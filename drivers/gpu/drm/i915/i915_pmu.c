@@ -46,6 +46,21 @@ static bool is_engine_config(u64 config)
 	return config < __I915_PMU_OTHER(0);
 }
 
+static bool is_vgpu_config(u64 config)
+{
+	return config >= __I915_PMU_VGPU_BASE;
+}
+
+static unsigned int vgpu_config_id(u64 config)
+{
+	return (config - __I915_PMU_VGPU_BASE) >> I915_PMU_SAMPLE_BITS;
+}
+
+static unsigned int vgpu_config_sample(u64 config)
+{
+	return config & I915_PMU_SAMPLE_MASK;
+}
+
 static unsigned int config_enabled_bit(u64 config)
 {
 	if (is_engine_config(config))
@@ -64,6 +79,11 @@ static bool is_engine_event(struct perf_event *event)
 	return is_engine_config(event->attr.config);
 }
 
+static bool is_vgpu_event(struct perf_event *event)
+{
+	return is_vgpu_config(event->attr.config);
+}
+
 static unsigned int event_enabled_bit(struct perf_event *event)
 {
 	return config_enabled_bit(event->attr.config);
@@ -85,7 +105,6 @@ static bool pmu_needs_timer(struct drm_i915_private *i915, bool gpu_active)
 	 * other words keep all the ones that could need the timer.
 	 */
 	enable &= config_enabled_mask(I915_PMU_ACTUAL_FREQUENCY) |
-		  config_enabled_mask(I915_PMU_REQUESTED_FREQUENCY) |
 		  ENGINE_SAMPLE_MASK;
 
 	/*
@@ -147,14 +166,6 @@ void i915_pmu_gt_unparked(struct drm_i915_private *i915)
 	spin_unlock_irq(&i915->pmu.lock);
 }
 
-static bool grab_forcewake(struct drm_i915_private *i915, bool fw)
-{
-	if (!fw)
-		intel_uncore_forcewake_get(i915, FORCEWAKE_ALL);
-
-	return true;
-}
-
 static void
 add_sample(struct i915_pmu_sample *sample, u32 val)
 {
@@ -164,9 +175,13 @@ add_sample(struct i915_pmu_sample *sample, u32 val)
 static void
 engines_sample(struct drm_i915_private *dev_priv, unsigned int period_ns)
 {
+	struct intel_engine_cs *wait[I915_NUM_ENGINES];
+	i915_reg_t regs[I915_NUM_ENGINES];
+	struct intel_uncore_fw_batch batch;
 	struct intel_engine_cs *engine;
 	enum intel_engine_id id;
-	bool fw = false;
+	unsigned int count = 0;
+	unsigned int i;
 
 	if ((dev_priv->pmu.enable & ENGINE_SAMPLE_MASK) == 0)
 		return;
@@ -180,34 +195,37 @@ engines_sample(struct drm_i915_private *dev_priv, unsigned int period_ns)
 	for_each_engine(engine, dev_priv, id) {
 		u32 current_seqno = intel_engine_get_seqno(engine);
 		u32 last_seqno = intel_engine_last_submit(engine);
-		u32 val;
-
-		val = !i915_seqno_passed(current_seqno, last_seqno);
 
-		if (val)
-			add_sample(&engine->pmu.sample[I915_SAMPLE_BUSY],
-				   period_ns);
+		if (i915_seqno_passed(current_seqno, last_seqno))
+			continue;
 
-		if (val && (engine->pmu.enable &
-		    (BIT(I915_SAMPLE_WAIT) | BIT(I915_SAMPLE_SEMA)))) {
-			fw = grab_forcewake(dev_priv, fw);
+		add_sample(&engine->pmu.sample[I915_SAMPLE_BUSY], period_ns);
 
-			val = I915_READ_FW(RING_CTL(engine->mmio_base));
-		} else {
-			val = 0;
+		if (engine->pmu.enable &
+		    (BIT(I915_SAMPLE_WAIT) | BIT(I915_SAMPLE_SEMA))) {
+			regs[count] = RING_CTL(engine->mmio_base);
+			wait[count] = engine;
+			count++;
 		}
+	}
 
-		if (val & RING_WAIT)
-			add_sample(&engine->pmu.sample[I915_SAMPLE_WAIT],
-				   period_ns);
+	/* Only wake up the domains of the busy engines we need to inspect */
+	if (count) {
+		intel_uncore_fw_batch_begin(dev_priv, &batch,
+					    regs, count, FW_REG_READ);
+		for (i = 0; i < count; i++) {
+			u32 val = I915_READ_FW(regs[i]);
 
-		if (val & RING_WAIT_SEMAPHORE)
-			add_sample(&engine->pmu.sample[I915_SAMPLE_SEMA],
-				   period_ns);
-	}
+			if (val & RING_WAIT)
+				add_sample(&wait[i]->pmu.sample[I915_SAMPLE_WAIT],
+					   period_ns);
 
-	if (fw)
-		intel_uncore_forcewake_put(dev_priv, FORCEWAKE_ALL);
+			if (val & RING_WAIT_SEMAPHORE)
+				add_sample(&wait[i]->pmu.sample[I915_SAMPLE_SEMA],
+					   period_ns);
+		}
+		intel_uncore_fw_batch_end(dev_priv, &batch);
+	}
 
 	intel_runtime_pm_put(dev_priv);
 }
@@ -237,14 +255,57 @@ frequency_sample(struct drm_i915_private *dev_priv, unsigned int period_ns)
 				intel_gpu_freq(dev_priv, val),
 				period_ns / 1000);
 	}
+}
 
-	if (dev_priv->pmu.enable &
-	    config_enabled_mask(I915_PMU_REQUESTED_FREQUENCY)) {
-		add_sample_mult(&dev_priv->pmu.sample[__I915_SAMPLE_FREQ_REQ],
-				intel_gpu_freq(dev_priv,
-					       dev_priv->gt_pm.rps.cur_freq),
-				period_ns / 1000);
-	}
+/*
+ * The requested frequency only changes when we ask for it, so rather than
+ * sample it from the timer we integrate it over the time between each
+ * change (and up to the point the counter is read).
+ */
+static void __requested_freq_update(struct drm_i915_private *i915, ktime_t now)
+{
+	struct i915_pmu *pmu = &i915->pmu;
+
+	lockdep_assert_held(&pmu->lock);
+
+	if (pmu->enable & config_enabled_mask(I915_PMU_REQUESTED_FREQUENCY))
+		pmu->sample[__I915_SAMPLE_FREQ_REQ].cur +=
+			pmu->freq_req * ktime_us_delta(now, pmu->freq_req_last);
+
+	pmu->freq_req_last = now;
+}
+
+/**
+ * i915_pmu_rps_changed - account the frequency change for the PMU
+ * @i915: i915 device instance
+ * @val: the newly requested frequency
+ *
+ * Called by RPS whenever it requests a new frequency.
+ */
+void i915_pmu_rps_changed(struct drm_i915_private *i915, u8 val)
+{
+	unsigned long flags;
+
+	if (!i915->pmu.base.event_init)
+		return;
+
+	spin_lock_irqsave(&i915->pmu.lock, flags);
+	__requested_freq_update(i915, ktime_get());
+	i915->pmu.freq_req = intel_gpu_freq(i915, val);
+	spin_unlock_irqrestore(&i915->pmu.lock, flags);
+}
+
+static u64 get_requested_freq(struct drm_i915_private *i915)
+{
+	unsigned long flags;
+	u64 val;
+
+	spin_lock_irqsave(&i915->pmu.lock, flags);
+	__requested_freq_update(i915, ktime_get());
+	val = i915->pmu.sample[__I915_SAMPLE_FREQ_REQ].cur;
+	spin_unlock_irqrestore(&i915->pmu.lock, flags);
+
+	return val;
 }
 
 static enum hrtimer_restart i915_sample(struct hrtimer *hrtimer)
@@ -328,6 +389,21 @@ engine_event_status(struct intel_engine_cs *engine,
 		if (INTEL_GEN(engine->i915) < 6)
 			return -ENODEV;
 		break;
+	case I915_SAMPLE_ELSP:
+	case I915_SAMPLE_COALESCED:
+	case I915_SAMPLE_LITE_RESTORE:
+	case I915_SAMPLE_PORT_IDLE:
+		/* Maintained by the execlists submission backend. */
+		if (!HAS_EXECLISTS(engine->i915) ||
+		    USES_GUC_SUBMISSION(engine->i915))
+			return -ENODEV;
+		break;
+	case I915_SAMPLE_WATCHDOG:
+	case I915_SAMPLE_WATCHDOG_NEAR:
+		if (!engine->emit_start_watchdog ||
+		    USES_GUC_SUBMISSION(engine->i915))
+			return -ENODEV;
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -335,9 +411,26 @@ engine_event_status(struct intel_engine_cs *engine,
 	return 0;
 }
 
+static int
+vgpu_config_status(struct drm_i915_private *i915, u64 config)
+{
+	u64 val;
+
+	/* Anything above the last counter would alias a valid vGPU id */
+	if (config > __I915_PMU_VGPU(INTEL_GVT_MAX_VGPU - 1ULL,
+				     I915_VGPU_SAMPLE_SCHED_DELAY))
+		return -ENOENT;
+
+	return intel_gvt_read_vgpu_counter(i915, vgpu_config_id(config),
+					   vgpu_config_sample(config), &val);
+}
+
 static int
 config_status(struct drm_i915_private *i915, u64 config)
 {
+	if (is_vgpu_config(config))
+		return vgpu_config_status(i915, config);
+
 	switch (config) {
 	case I915_PMU_ACTUAL_FREQUENCY:
 		if (IS_VALLEYVIEW(i915) || IS_CHERRYVIEW(i915))
@@ -354,6 +447,8 @@ config_status(struct drm_i915_private *i915, u64 config)
 		if (!HAS_RC6(i915))
 			return -ENODEV;
 		break;
+	case I915_PMU_TLB_INVALIDATIONS_SAVED:
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -423,20 +518,7 @@ static int i915_pmu_event_init(struct perf_event *event)
 
 static u64 __get_rc6(struct drm_i915_private *i915)
 {
-	u64 val;
-
-	val = intel_rc6_residency_ns(i915,
-				     IS_VALLEYVIEW(i915) ?
-				     VLV_GT_RENDER_RC6 :
-				     GEN6_GT_GFX_RC6);
-
-	if (HAS_RC6p(i915))
-		val += intel_rc6_residency_ns(i915, GEN6_GT_GFX_RC6p);
-
-	if (HAS_RC6pp(i915))
-		val += intel_rc6_residency_ns(i915, GEN6_GT_GFX_RC6pp);
-
-	return val;
+	return intel_rc6_total_residency_ns(i915);
 }
 
 static u64 get_rc6(struct drm_i915_private *i915)
@@ -519,6 +601,36 @@ static u64 get_rc6(struct drm_i915_private *i915)
 #endif
 }
 
+/**
+ * i915_pmu_rc6_residency_ns - total RC6 residency, as the PMU reports it
+ * @i915: the i915 device
+ *
+ * Reads the RC6 residency without waking the device. Whilst it is runtime
+ * suspended, and so cannot be read, the time spent suspended is instead
+ * added to the last value read, same as for the rc6-residency event, so
+ * that the result still grows monotonically.
+ *
+ * Returns: the RC6 residency in ns.
+ */
+u64 i915_pmu_rc6_residency_ns(struct drm_i915_private *i915)
+{
+	u64 val = 0;
+
+	if (INTEL_GEN(i915) < 6)
+		return 0;
+
+	/* Without the PMU there is no estimate to fall back upon */
+	if (!i915->pmu.base.event_init) {
+		if (intel_runtime_pm_get_if_in_use(i915)) {
+			val = __get_rc6(i915);
+			intel_runtime_pm_put(i915);
+		}
+		return val;
+	}
+
+	return get_rc6(i915);
+}
+
 static u64 __i915_pmu_event_read(struct perf_event *event)
 {
 	struct drm_i915_private *i915 =
@@ -541,6 +653,12 @@ static u64 __i915_pmu_event_read(struct perf_event *event)
 		} else {
 			val = engine->pmu.sample[sample].cur;
 		}
+	} else if (is_vgpu_event(event)) {
+		u64 config = event->attr.config;
+
+		/* Maintained by GVT-g, no sampling required. */
+		intel_gvt_read_vgpu_counter(i915, vgpu_config_id(config),
+					    vgpu_config_sample(config), &val);
 	} else {
 		switch (event->attr.config) {
 		case I915_PMU_ACTUAL_FREQUENCY:
@@ -549,9 +667,8 @@ static u64 __i915_pmu_event_read(struct perf_event *event)
 				   USEC_PER_SEC /* to MHz */);
 			break;
 		case I915_PMU_REQUESTED_FREQUENCY:
-			val =
-			   div_u64(i915->pmu.sample[__I915_SAMPLE_FREQ_REQ].cur,
-				   USEC_PER_SEC /* to MHz */);
+			val = div_u64(get_requested_freq(i915),
+				      USEC_PER_SEC /* to MHz */);
 			break;
 		case I915_PMU_INTERRUPTS:
 			val = count_interrupts(i915);
@@ -559,6 +676,9 @@ static u64 __i915_pmu_event_read(struct perf_event *event)
 		case I915_PMU_RC6_RESIDENCY:
 			val = get_rc6(i915);
 			break;
+		case I915_PMU_TLB_INVALIDATIONS_SAVED:
+			val = READ_ONCE(i915->ggtt.invalidate_saved);
+			break;
 		}
 	}
 
@@ -584,9 +704,13 @@ static void i915_pmu_enable(struct perf_event *event)
 {
 	struct drm_i915_private *i915 =
 		container_of(event->pmu, typeof(*i915), pmu.base);
-	unsigned int bit = event_enabled_bit(event);
+	unsigned int bit;
 	unsigned long flags;
 
+	if (is_vgpu_event(event))
+		goto out;
+
+	bit = event_enabled_bit(event);
 	spin_lock_irqsave(&i915->pmu.lock, flags);
 
 	/*
@@ -595,6 +719,15 @@ static void i915_pmu_enable(struct perf_event *event)
 	 */
 	GEM_BUG_ON(bit >= I915_PMU_MASK_BITS);
 	GEM_BUG_ON(i915->pmu.enable_count[bit] == ~0);
+
+	/* Start integrating the requested frequency from now */
+	if (!i915->pmu.enable_count[bit] &&
+	    event->attr.config == I915_PMU_REQUESTED_FREQUENCY) {
+		i915->pmu.freq_req =
+			intel_gpu_freq(i915, i915->gt_pm.rps.cur_freq);
+		i915->pmu.freq_req_last = ktime_get();
+	}
+
 	i915->pmu.enable |= BIT_ULL(bit);
 	i915->pmu.enable_count[bit]++;
 
@@ -617,13 +750,14 @@ static void i915_pmu_enable(struct perf_event *event)
 		GEM_BUG_ON(!engine);
 		engine->pmu.enable |= BIT(sample);
 
-		GEM_BUG_ON(sample >= I915_PMU_SAMPLE_BITS);
+		GEM_BUG_ON(sample >= I915_ENGINE_SAMPLE_MAX);
 		GEM_BUG_ON(engine->pmu.enable_count[sample] == ~0);
 		engine->pmu.enable_count[sample]++;
 	}
 
 	spin_unlock_irqrestore(&i915->pmu.lock, flags);
 
+out:
 	/*
 	 * Store the current counter value so we can report the correct delta
 	 * for all listeners. Even when the event was already enabled and has
@@ -636,9 +770,13 @@ static void i915_pmu_disable(struct perf_event *event)
 {
 	struct drm_i915_private *i915 =
 		container_of(event->pmu, typeof(*i915), pmu.base);
-	unsigned int bit = event_enabled_bit(event);
+	unsigned int bit;
 	unsigned long flags;
 
+	if (is_vgpu_event(event))
+		return;
+
+	bit = event_enabled_bit(event);
 	spin_lock_irqsave(&i915->pmu.lock, flags);
 
 	if (is_engine_event(event)) {
@@ -649,7 +787,7 @@ static void i915_pmu_disable(struct perf_event *event)
 						  engine_event_class(event),
 						  engine_event_instance(event));
 		GEM_BUG_ON(!engine);
-		GEM_BUG_ON(sample >= I915_PMU_SAMPLE_BITS);
+		GEM_BUG_ON(sample >= I915_ENGINE_SAMPLE_MAX);
 		GEM_BUG_ON(engine->pmu.enable_count[sample] == 0);
 		/*
 		 * Decrement the reference count and clear the enabled
@@ -666,6 +804,8 @@ static void i915_pmu_disable(struct perf_event *event)
 	 * bitmask when the last listener on an event goes away.
 	 */
 	if (--i915->pmu.enable_count[bit] == 0) {
+		if (event->attr.config == I915_PMU_REQUESTED_FREQUENCY)
+			__requested_freq_update(i915, ktime_get());
 		i915->pmu.enable &= ~BIT_ULL(bit);
 		i915->pmu.timer_enabled &= pmu_needs_timer(i915, true);
 	}
@@ -726,7 +866,7 @@ static ssize_t i915_pmu_format_show(struct device *dev,
 	})[0].attr.attr)
 
 static struct attribute *i915_pmu_format_attrs[] = {
-	I915_PMU_FORMAT_ATTR(i915_eventid, "config:0-20"),
+	I915_PMU_FORMAT_ATTR(i915_eventid, "config:0-20,32"),
 	NULL,
 };
 
@@ -787,10 +927,11 @@ static const struct attribute_group *i915_pmu_attr_groups[] = {
 	.unit = (__unit), \
 }
 
-#define __engine_event(__sample, __name) \
+#define __engine_event(__sample, __name, __unit) \
 { \
 	.sample = (__sample), \
 	.name = (__name), \
+	.unit = (__unit), \
 }
 
 static struct i915_ext_attribute *
@@ -830,14 +971,32 @@ create_event_attributes(struct drm_i915_private *i915)
 		__event(I915_PMU_REQUESTED_FREQUENCY, "requested-frequency", "MHz"),
 		__event(I915_PMU_INTERRUPTS, "interrupts", NULL),
 		__event(I915_PMU_RC6_RESIDENCY, "rc6-residency", "ns"),
+		__event(I915_PMU_TLB_INVALIDATIONS_SAVED, "tlb-invalidations-saved", NULL),
 	};
 	static const struct {
 		enum drm_i915_pmu_engine_sample sample;
 		char *name;
+		const char *unit;
 	} engine_events[] = {
-		__engine_event(I915_SAMPLE_BUSY, "busy"),
-		__engine_event(I915_SAMPLE_SEMA, "sema"),
-		__engine_event(I915_SAMPLE_WAIT, "wait"),
+		__engine_event(I915_SAMPLE_BUSY, "busy", "ns"),
+		__engine_event(I915_SAMPLE_SEMA, "sema", "ns"),
+		__engine_event(I915_SAMPLE_WAIT, "wait", "ns"),
+		__engine_event(I915_SAMPLE_ELSP, "elsp", NULL),
+		__engine_event(I915_SAMPLE_COALESCED, "coalesced", NULL),
+		__engine_event(I915_SAMPLE_LITE_RESTORE, "lite-restore", NULL),
+		__engine_event(I915_SAMPLE_PORT_IDLE, "port-idle", "ns"),
+		__engine_event(I915_SAMPLE_WATCHDOG, "watchdog", NULL),
+		__engine_event(I915_SAMPLE_WATCHDOG_NEAR, "watchdog-near", NULL),
+	};
+	static const struct {
+		enum drm_i915_pmu_vgpu_sample sample;
+		char *name;
+		const char *unit;
+	} vgpu_events[] = {
+		__engine_event(I915_VGPU_SAMPLE_BUSY, "busy", "ns"),
+		__engine_event(I915_VGPU_SAMPLE_WORKLOADS, "workloads", NULL),
+		__engine_event(I915_VGPU_SAMPLE_SHADOW, "shadow", "ns"),
+		__engine_event(I915_VGPU_SAMPLE_SCHED_DELAY, "sched-delay", "ns"),
 	};
 	unsigned int count = 0;
 	struct perf_pmu_events_attr *pmu_attr = NULL, *pmu_iter;
@@ -845,7 +1004,7 @@ create_event_attributes(struct drm_i915_private *i915)
 	struct attribute **attr = NULL, **attr_iter;
 	struct intel_engine_cs *engine;
 	enum intel_engine_id id;
-	unsigned int i;
+	unsigned int i, vgpu;
 
 	/* Count how many counters we will be exposing. */
 	for (i = 0; i < ARRAY_SIZE(events); i++) {
@@ -861,6 +1020,9 @@ create_event_attributes(struct drm_i915_private *i915)
 		}
 	}
 
+	for (vgpu = 1; !vgpu_config_status(i915, __I915_PMU_VGPU(vgpu, 0)); vgpu++)
+		count += ARRAY_SIZE(vgpu_events);
+
 	/* Allocate attribute objects and table. */
 	i915_attr = kcalloc(count, sizeof(*i915_attr), GFP_KERNEL);
 	if (!i915_attr)
@@ -924,13 +1086,47 @@ create_event_attributes(struct drm_i915_private *i915)
 								engine->instance,
 								engine_events[i].sample));
 
+			if (!engine_events[i].unit)
+				continue;
+
 			str = kasprintf(GFP_KERNEL, "%s-%s.unit",
 					engine->name, engine_events[i].name);
 			if (!str)
 				goto err;
 
 			*attr_iter++ = &pmu_iter->attr.attr;
-			pmu_iter = add_pmu_attr(pmu_iter, str, "ns");
+			pmu_iter = add_pmu_attr(pmu_iter, str,
+						engine_events[i].unit);
+		}
+	}
+
+	/* Initialize GVT-g counters, one set per possible vGPU id. */
+	for (vgpu = 1; !vgpu_config_status(i915, __I915_PMU_VGPU(vgpu, 0)); vgpu++) {
+		for (i = 0; i < ARRAY_SIZE(vgpu_events); i++) {
+			char *str;
+
+			str = kasprintf(GFP_KERNEL, "vgpu%u-%s",
+					vgpu, vgpu_events[i].name);
+			if (!str)
+				goto err;
+
+			*attr_iter++ = &i915_iter->attr.attr;
+			i915_iter =
+				add_i915_attr(i915_iter, str,
+					      __I915_PMU_VGPU(vgpu,
+							      vgpu_events[i].sample));
+
+			if (!vgpu_events[i].unit)
+				continue;
+
+			str = kasprintf(GFP_KERNEL, "vgpu%u-%s.unit",
+					vgpu, vgpu_events[i].name);
+			if (!str)
+				goto err;
+
+			*attr_iter++ = &pmu_iter->attr.attr;
+			pmu_iter = add_pmu_attr(pmu_iter, str,
+						vgpu_events[i].unit);
 		}
 	}
 
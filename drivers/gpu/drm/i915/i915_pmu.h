@@ -94,6 +94,12 @@ struct i915_pmu {
 	 * struct intel_engine_cs.
 	 */
 	struct i915_pmu_sample sample[__I915_NUM_PMU_SAMPLERS];
+	/**
+	 * @freq_req: Currently requested frequency (MHz), and @freq_req_last
+	 * when it was last accumulated into __I915_SAMPLE_FREQ_REQ.
+	 */
+	u32 freq_req;
+	ktime_t freq_req_last;
 	/**
 	 * @suspended_jiffies_last: Cached suspend time from PM core.
 	 */
@@ -113,11 +119,18 @@ void i915_pmu_register(struct drm_i915_private *i915);
 void i915_pmu_unregister(struct drm_i915_private *i915);
 void i915_pmu_gt_parked(struct drm_i915_private *i915);
 void i915_pmu_gt_unparked(struct drm_i915_private *i915);
+void i915_pmu_rps_changed(struct drm_i915_private *i915, u8 val);
+u64 i915_pmu_rc6_residency_ns(struct drm_i915_private *i915);
 #else
 static inline void i915_pmu_register(struct drm_i915_private *i915) {}
 static inline void i915_pmu_unregister(struct drm_i915_private *i915) {}
 static inline void i915_pmu_gt_parked(struct drm_i915_private *i915) {}
 static inline void i915_pmu_gt_unparked(struct drm_i915_private *i915) {}
+static inline void i915_pmu_rps_changed(struct drm_i915_private *i915, u8 val) {}
+static inline u64 i915_pmu_rc6_residency_ns(struct drm_i915_private *i915)
+{
+	return 0;
+}
 #endif
 
 #endif
@@ -46,6 +46,7 @@ enum vgt_g2v_type {
 	VGT_G2V_PPGTT_L4_PAGE_TABLE_DESTROY,
 	VGT_G2V_EXECLIST_CONTEXT_CREATE,
 	VGT_G2V_EXECLIST_CONTEXT_DESTROY,
+	VGT_G2V_PV_SUBMISSION_NOTIFY,
 	VGT_G2V_MAX,
 };
 
@@ -55,6 +56,33 @@ enum vgt_g2v_type {
 #define VGT_CAPS_FULL_48BIT_PPGTT	BIT(2)
 #define VGT_CAPS_HWSP_EMULATION		BIT(3)
 #define VGT_CAPS_HUGE_GTT		BIT(4)
+#define VGT_CAPS_PV_SUBMISSION		BIT(5)
+
+/*
+ * PV submission queues, used with VGT_CAPS_PV_SUBMISSION
+ *
+ * The guest places a struct vgt_pv_submission in its memory, writes its
+ * GPA into vgt_if.pv_sq_gpa and then, instead of writing the ELSP, adds
+ * context descriptors at the tail of an engine's queue and sends
+ * VGT_G2V_PV_SUBMISSION_NOTIFY once for any number of them. The host
+ * moves head as it takes descriptors and bumps completed, followed by a
+ * context switch interrupt, for each one that finishes. The indices are
+ * free running, wrapping at VGT_PV_SQ_SIZE.
+ */
+#define VGT_PV_SQ_ENGINES	8
+#define VGT_PV_SQ_SIZE		32
+
+struct vgt_pv_sq {
+	u32 head;		/* written by the host */
+	u32 tail;		/* written by the guest */
+	u32 completed;		/* written by the host */
+	u32 rsv;
+	u64 desc[VGT_PV_SQ_SIZE];
+} __packed;
+
+struct vgt_pv_submission {
+	struct vgt_pv_sq sq[VGT_PV_SQ_ENGINES];	/* indexed by engine id */
+} __packed;
 
 struct vgt_if {
 	u64 magic;		/* VGT_MAGIC */
@@ -107,7 +135,12 @@ struct vgt_if {
 	u32 execlist_context_descriptor_lo;
 	u32 execlist_context_descriptor_hi;
 
-	u32  rsv7[0x200 - 24];    /* pad to one page */
+	struct {
+		u32 lo;
+		u32 hi;
+	} pv_sq_gpa;		/* struct vgt_pv_submission */
+
+	u32  rsv7[0x200 - 26];    /* pad to one page */
 } __packed;
 
 #define vgtif_reg(x) \
@@ -84,9 +84,193 @@ static int query_topology_info(struct drm_i915_private *dev_priv,
 	return total_length;
 }
 
+static int query_cs_timestamp(struct drm_i915_private *dev_priv,
+			      struct drm_i915_query_item *query_item)
+{
+	struct drm_i915_query_cs_timestamp __user *query_ptr =
+		u64_to_user_ptr(query_item->data_ptr);
+	struct drm_i915_query_cs_timestamp query;
+	struct intel_engine_cs *engine;
+	unsigned long flags;
+	u64 start, end;
+	u32 base;
+
+	if (query_item->flags != 0)
+		return -EINVAL;
+
+	if (query_item->length == 0)
+		return sizeof(query);
+
+	if (query_item->length < sizeof(query))
+		return -EINVAL;
+
+	if (copy_from_user(&query, query_ptr, sizeof(query)))
+		return -EFAULT;
+
+	if (query.flags || query.rsvd)
+		return -EINVAL;
+
+	if (!INTEL_INFO(dev_priv)->cs_timestamp_frequency_khz)
+		return -ENODEV;
+
+	engine = intel_engine_lookup_user(dev_priv,
+					  query.engine_class,
+					  query.engine_instance);
+	if (!engine)
+		return -EINVAL;
+
+	base = engine->mmio_base;
+
+	intel_runtime_pm_get(dev_priv);
+	intel_uncore_forcewake_get(dev_priv, FORCEWAKE_ALL);
+
+	/* Keep the window between the CPU clock reads as tight as we can */
+	local_irq_save(flags);
+	start = ktime_get_ns();
+	query.cs_timestamp = I915_READ64_2x32(RING_TIMESTAMP(base),
+					      RING_TIMESTAMP_UDW(base));
+	end = ktime_get_ns();
+	local_irq_restore(flags);
+
+	intel_uncore_forcewake_put(dev_priv, FORCEWAKE_ALL);
+	intel_runtime_pm_put(dev_priv);
+
+	query.cpu_timestamp = start;
+	query.cpu_delta = end - start;
+	query.frequency =
+		INTEL_INFO(dev_priv)->cs_timestamp_frequency_khz * 1000;
+
+	if (copy_to_user(query_ptr, &query, sizeof(query)))
+		return -EFAULT;
+
+	return sizeof(query);
+}
+
+static void telemetry_enable_engine_stats(struct drm_i915_private *dev_priv)
+{
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	/*
+	 * Engine busyness is only tracked once asked for. Turn it on upon the
+	 * first query, and leave it on for the monitor to sample the deltas.
+	 * Like the engine events of the PMU, this is a system wide view of
+	 * what all the clients are doing, so it is left to the privileged.
+	 */
+	if (test_and_set_bit(0, &dev_priv->telemetry_engine_stats))
+		return;
+
+	for_each_engine(engine, dev_priv, id)
+		intel_enable_engine_stats(engine);
+}
+
+static int query_telemetry(struct drm_i915_private *dev_priv,
+			   struct drm_i915_query_item *query_item)
+{
+	struct drm_i915_query_telemetry __user *query_ptr =
+		u64_to_user_ptr(query_item->data_ptr);
+	struct drm_i915_query_telemetry_engine __user *engine_ptr =
+		query_ptr->engines;
+	const struct intel_rps *rps = &dev_priv->gt_pm.rps;
+	struct drm_i915_query_telemetry query;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	u32 num_engines, total_length;
+	bool engine_stats;
+
+	if (query_item->flags != 0)
+		return -EINVAL;
+
+	num_engines = hweight32(INTEL_INFO(dev_priv)->ring_mask);
+	total_length = sizeof(query) + num_engines * sizeof(*engine_ptr);
+
+	if (query_item->length == 0)
+		return total_length;
+
+	if (query_item->length < total_length)
+		return -EINVAL;
+
+	if (copy_from_user(&query, query_ptr, sizeof(query)))
+		return -EFAULT;
+
+	if (query.flags != 0)
+		return -EINVAL;
+
+	if (!access_ok(VERIFY_WRITE, query_ptr, total_length))
+		return -EFAULT;
+
+	/*
+	 * The engine stats stay enabled once the first privileged caller
+	 * turned them on, so check every caller for itself.
+	 */
+	engine_stats = capable(CAP_SYS_ADMIN);
+	if (engine_stats)
+		telemetry_enable_engine_stats(dev_priv);
+
+	memset(&query, 0, sizeof(query));
+	query.timestamp = ktime_get_ns();
+	query.num_engines = num_engines;
+
+	if (INTEL_GEN(dev_priv) >= 6) {
+		query.req_freq = intel_gpu_freq(dev_priv, rps->cur_freq);
+		query.min_freq = intel_gpu_freq(dev_priv, rps->min_freq_softlimit);
+		query.max_freq = intel_gpu_freq(dev_priv, rps->max_freq_softlimit);
+	}
+
+	/* Don't wake the device just to tell the monitor it was asleep */
+	if (intel_runtime_pm_get_if_in_use(dev_priv)) {
+		query.flags |= I915_TELEMETRY_AWAKE;
+
+		if (INTEL_GEN(dev_priv) >= 6) {
+			u32 rpstat = I915_READ_NOTRACE(GEN6_RPSTAT1);
+
+			query.act_freq =
+				intel_gpu_freq(dev_priv,
+					       intel_get_cagf(dev_priv, rpstat));
+			if (!IS_ENABLED(CONFIG_PERF_EVENTS))
+				query.rc6_residency_ns =
+					intel_rc6_total_residency_ns(dev_priv);
+		}
+
+		intel_runtime_pm_put(dev_priv);
+	}
+
+	/* The PMU keeps counting RC6 whilst runtime suspended */
+	if (IS_ENABLED(CONFIG_PERF_EVENTS))
+		query.rc6_residency_ns = i915_pmu_rc6_residency_ns(dev_priv);
+
+	spin_lock(&dev_priv->mm.object_stat_lock);
+	query.object_count = dev_priv->mm.object_count;
+	query.object_memory = dev_priv->mm.object_memory;
+	spin_unlock(&dev_priv->mm.object_stat_lock);
+
+	for_each_engine(engine, dev_priv, id) {
+		struct drm_i915_query_telemetry_engine e = {
+			.engine_class = engine->uabi_class,
+			.engine_instance = engine->instance,
+		};
+
+		if (engine_stats && intel_engine_supports_stats(engine)) {
+			e.flags |= I915_TELEMETRY_ENGINE_BUSY;
+			e.busy_ns =
+				ktime_to_ns(intel_engine_get_busy_time(engine));
+		}
+
+		if (__copy_to_user(engine_ptr++, &e, sizeof(e)))
+			return -EFAULT;
+	}
+
+	if (__copy_to_user(query_ptr, &query, sizeof(query)))
+		return -EFAULT;
+
+	return total_length;
+}
+
 static int (* const i915_query_funcs[])(struct drm_i915_private *dev_priv,
 					struct drm_i915_query_item *query_item) = {
 	query_topology_info,
+	query_cs_timestamp,
+	query_telemetry,
 };
 
 int i915_query_ioctl(struct drm_device *dev, void *data, struct drm_file *file)
@@ -69,6 +69,89 @@ static signed long i915_fence_wait(struct dma_fence *fence,
 	return i915_request_wait(to_request(fence), interruptible, timeout);
 }
 
+#define I915_REQUEST_CACHE_SIZE 64 /* per engine */
+#define I915_DEPENDENCY_CACHE_SIZE 256
+
+/*
+ * As for the slab itself (SLAB_TYPESAFE_BY_RCU), a request on the freelist
+ * may still be looked at under RCU, and so must only be reused as another
+ * request and never be cleared, see i915_request_alloc().
+ */
+static void request_cache_put(struct i915_request *rq)
+{
+	struct i915_request_cache *cache =
+		&rq->i915->request_cache[rq->engine->id];
+
+	if (atomic_inc_return(&cache->count) > I915_REQUEST_CACHE_SIZE) {
+		atomic_dec(&cache->count);
+		kmem_cache_free(rq->i915->requests, rq);
+		return;
+	}
+
+	llist_add(&rq->free_link, &cache->free);
+}
+
+static struct i915_request *request_cache_get(struct intel_engine_cs *engine)
+{
+	struct i915_request_cache *cache =
+		&engine->i915->request_cache[engine->id];
+	struct llist_node *node;
+
+	/* struct_mutex makes us the only consumer, as llist_del_first needs */
+	lockdep_assert_held(&engine->i915->drm.struct_mutex);
+
+	node = llist_del_first(&cache->free);
+	if (!node) {
+		cache->misses++;
+		return NULL;
+	}
+
+	atomic_dec(&cache->count);
+	cache->hits++;
+
+	return llist_entry(node, struct i915_request, free_link);
+}
+
+void i915_request_caches_init(struct drm_i915_private *i915)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(i915->request_cache); i++)
+		init_llist_head(&i915->request_cache[i].free);
+
+	INIT_LIST_HEAD(&i915->dependency_cache.free);
+}
+
+/**
+ * i915_request_caches_drain - return the recycled requests to the slabs
+ * @i915: i915 device
+ *
+ * Called with struct_mutex held, or once the device is idle and going away.
+ */
+void i915_request_caches_drain(struct drm_i915_private *i915)
+{
+	struct i915_dependency *dep, *dn;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(i915->request_cache); i++) {
+		struct i915_request_cache *cache = &i915->request_cache[i];
+		struct i915_request *rq, *rn;
+
+		llist_for_each_entry_safe(rq, rn,
+					  llist_del_all(&cache->free),
+					  free_link) {
+			atomic_dec(&cache->count);
+			kmem_cache_free(i915->requests, rq);
+		}
+	}
+
+	list_for_each_entry_safe(dep, dn,
+				 &i915->dependency_cache.free, signal_link)
+		kmem_cache_free(i915->dependencies, dep);
+	INIT_LIST_HEAD(&i915->dependency_cache.free);
+	i915->dependency_cache.count = 0;
+}
+
 static void i915_fence_release(struct dma_fence *fence)
 {
 	struct i915_request *rq = to_request(fence);
@@ -82,7 +165,7 @@ static void i915_fence_release(struct dma_fence *fence)
 	 */
 	i915_sw_fence_fini(&rq->submit);
 
-	kmem_cache_free(rq->i915->requests, rq);
+	request_cache_put(rq);
 }
 
 const struct dma_fence_ops i915_fence_ops = {
@@ -111,9 +194,24 @@ i915_request_remove_from_client(struct i915_request *request)
 	spin_unlock(&file_priv->mm.lock);
 }
 
+/* Dependencies are only added and removed under struct_mutex */
 static struct i915_dependency *
 i915_dependency_alloc(struct drm_i915_private *i915)
 {
+	struct i915_dependency_cache *cache = &i915->dependency_cache;
+	struct i915_dependency *dep;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	dep = list_first_entry_or_null(&cache->free, typeof(*dep), signal_link);
+	if (dep) {
+		list_del(&dep->signal_link);
+		cache->count--;
+		cache->hits++;
+		return dep;
+	}
+
+	cache->misses++;
 	return kmem_cache_alloc(i915->dependencies, GFP_KERNEL);
 }
 
@@ -121,6 +219,16 @@ static void
 i915_dependency_free(struct drm_i915_private *i915,
 		     struct i915_dependency *dep)
 {
+	struct i915_dependency_cache *cache = &i915->dependency_cache;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (cache->count < I915_DEPENDENCY_CACHE_SIZE) {
+		list_add(&dep->signal_link, &cache->free);
+		cache->count++;
+		return;
+	}
+
 	kmem_cache_free(i915->dependencies, dep);
 }
 
@@ -130,7 +238,6 @@ __i915_sched_node_add_dependency(struct i915_sched_node *node,
 				 struct i915_dependency *dep,
 				 unsigned long flags)
 {
-	INIT_LIST_HEAD(&dep->dfs_link);
 	list_add(&dep->wait_link, &signal->waiters_list);
 	list_add(&dep->signal_link, &node->signalers_list);
 	dep->signaler = signal;
@@ -160,6 +267,7 @@ i915_sched_node_fini(struct drm_i915_private *i915,
 	struct i915_dependency *dep, *tmp;
 
 	GEM_BUG_ON(!list_empty(&node->link));
+	GEM_BUG_ON(!list_empty(&node->dfs_link));
 
 	/*
 	 * Everyone we depended upon (the fences we wait to be signaled)
@@ -169,7 +277,6 @@ i915_sched_node_fini(struct drm_i915_private *i915,
 	 */
 	list_for_each_entry_safe(dep, tmp, &node->signalers_list, signal_link) {
 		GEM_BUG_ON(!i915_sched_node_signaled(dep->signaler));
-		GEM_BUG_ON(!list_empty(&dep->dfs_link));
 
 		list_del(&dep->wait_link);
 		if (dep->flags & I915_DEPENDENCY_ALLOC)
@@ -179,7 +286,6 @@ i915_sched_node_fini(struct drm_i915_private *i915,
 	/* Remove ourselves from everyone who depends upon us */
 	list_for_each_entry_safe(dep, tmp, &node->waiters_list, wait_link) {
 		GEM_BUG_ON(dep->signaler != node);
-		GEM_BUG_ON(!list_empty(&dep->dfs_link));
 
 		list_del(&dep->signal_link);
 		if (dep->flags & I915_DEPENDENCY_ALLOC)
@@ -193,7 +299,9 @@ i915_sched_node_init(struct i915_sched_node *node)
 	INIT_LIST_HEAD(&node->signalers_list);
 	INIT_LIST_HEAD(&node->waiters_list);
 	INIT_LIST_HEAD(&node->link);
+	INIT_LIST_HEAD(&node->dfs_link);
 	node->attr.priority = I915_PRIORITY_INVALID;
+	node->attr.deadline = 0;
 }
 
 static int reset_all_global_seqno(struct drm_i915_private *i915, u32 seqno)
@@ -406,6 +514,19 @@ static void __retire_engine_upto(struct intel_engine_cs *engine,
 	} while (tmp != rq);
 }
 
+static void context_record_spin(struct i915_gem_context *ctx,
+				const struct i915_request *rq)
+{
+	if (!rq->spin.wait_us)
+		return;
+
+	ewma_spin_add(&ctx->spin.avg_us, rq->spin.wait_us);
+	if (rq->spin.hit)
+		ctx->spin.hits++;
+	else
+		ctx->spin.misses++;
+}
+
 static void i915_request_retire(struct i915_request *request)
 {
 	struct i915_gem_active *active, *next;
@@ -420,7 +541,11 @@ static void i915_request_retire(struct i915_request *request)
 	GEM_BUG_ON(!i915_sw_fence_signaled(&request->submit));
 	GEM_BUG_ON(!i915_request_completed(request));
 
+	/* Decouple from the timeline's status page before it may be freed */
+	WRITE_ONCE(request->hwsp_seqno, (const u32 *)&request->fence.seqno);
+
 	trace_i915_request_retire(request);
+	intel_engine_trace(request->engine, INTEL_TRACE_RETIRE, request);
 
 	advance_ring(request);
 	free_capture_list(request);
@@ -455,6 +580,7 @@ static void i915_request_retire(struct i915_request *request)
 	}
 
 	i915_request_remove_from_client(request);
+	context_record_spin(request->gem_context, request);
 
 	/* Retirement decays the ban score as it is a sign of ctx progress */
 	atomic_dec_if_positive(&request->gem_context->ban_score);
@@ -509,10 +635,46 @@ static void move_to_timeline(struct i915_request *request,
 	spin_unlock(&request->timeline->lock);
 }
 
+/*
+ * If the context has a seqno page, each request stores its fence seqno into
+ * it upon completion. This is written alongside the breadcrumb, as part of
+ * the postfix, so that it is neither cleared by i915_request_skip() nor
+ * skipped over by an engine reset: other engines may be waiting upon it in
+ * an MI_SEMAPHORE_WAIT, see i915_request_await_request().
+ */
+#define CONTEXT_SEQNO_DWORDS 4
+#define TIMELINE_SEQNO_DWORDS 4
+
+static u32 *emit_context_seqno(struct i915_request *rq, u32 *cs)
+{
+	*cs++ = MI_STORE_DWORD_IMM_GEN4 | MI_USE_GGTT;
+	*cs++ = i915_ggtt_offset(rq->gem_context->seqno_vma) +
+		I915_CONTEXT_SEQNO_SLOT(rq->engine) * sizeof(u32);
+	*cs++ = 0;
+	*cs++ = rq->fence.seqno;
+
+	return cs;
+}
+
+/*
+ * Likewise, write the fence seqno into the timeline's status page ahead of
+ * the breadcrumb (and its interrupt), so that by the time the global seqno
+ * is seen to pass the request, so has its timeline.
+ */
+static u32 *emit_timeline_seqno(struct i915_request *rq, u32 *cs)
+{
+	*cs++ = MI_STORE_DWORD_IMM_GEN4 | MI_USE_GGTT;
+	*cs++ = rq->timeline->hwsp_offset;
+	*cs++ = 0;
+	*cs++ = rq->fence.seqno;
+
+	return cs;
+}
+
 void __i915_request_submit(struct i915_request *request)
 {
 	struct intel_engine_cs *engine = request->engine;
-	u32 seqno;
+	u32 seqno, *cs;
 
 	GEM_TRACE("%s fence %llx:%d -> global=%d, current %d\n",
 		  engine->name,
@@ -524,6 +686,7 @@ void __i915_request_submit(struct i915_request *request)
 	lockdep_assert_held(&engine->timeline.lock);
 
 	GEM_BUG_ON(request->global_seqno);
+	atomic_dec(&engine->queued);
 
 	seqno = timeline_get_seqno(&engine->timeline);
 	GEM_BUG_ON(!seqno);
@@ -536,13 +699,29 @@ void __i915_request_submit(struct i915_request *request)
 		intel_engine_enable_signaling(request, false);
 	spin_unlock(&request->lock);
 
-	engine->emit_breadcrumb(request,
-				request->ring->vaddr + request->postfix);
+	cs = request->ring->vaddr + request->postfix;
+	if (request->gem_context->seqno_vma)
+		cs = emit_context_seqno(request, cs);
+	if (request->timeline->hwsp)
+		cs = emit_timeline_seqno(request, cs);
+	engine->emit_breadcrumb(request, cs);
 
 	/* Transfer from per-context onto the global per-engine timeline */
 	move_to_timeline(request, &engine->timeline);
 
+	/* Only account the first submission, not any replay after preemption */
+	if (!request->latency.submit) {
+		request->latency.submit = ktime_get_ns();
+		intel_engine_record_latency(engine, INTEL_LATENCY_DEPS, request,
+					    request->latency.add,
+					    request->latency.ready);
+		intel_engine_record_latency(engine, INTEL_LATENCY_QUEUE, request,
+					    request->latency.ready,
+					    request->latency.submit);
+	}
+
 	trace_i915_request_execute(request);
+	intel_engine_trace(engine, INTEL_TRACE_SUBMIT, request);
 
 	wake_up_all(&request->execute);
 }
@@ -572,6 +751,7 @@ void __i915_request_unsubmit(struct i915_request *request)
 
 	GEM_BUG_ON(!irqs_disabled());
 	lockdep_assert_held(&engine->timeline.lock);
+	atomic_inc(&engine->queued);
 
 	/*
 	 * Only unwind in reverse order, required so that the per-context list
@@ -615,6 +795,170 @@ void i915_request_unsubmit(struct i915_request *request)
 	spin_unlock_irqrestore(&engine->timeline.lock, flags);
 }
 
+static void gang_ready(struct i915_gang *gang)
+{
+	unsigned int n;
+
+	if (!atomic_dec_and_test(&gang->pending))
+		return;
+
+	/* See submit_notify() for the serialisation against wedging */
+	rcu_read_lock();
+	for (n = 0; n < gang->count; n++) {
+		struct i915_request *rq = gang->requests[n];
+
+		/* The gang is about to be freed, see gang_depends() */
+		WRITE_ONCE(rq->gang, NULL);
+		rq->engine->submit_request(rq);
+	}
+	rcu_read_unlock();
+
+	for (n = 0; n < gang->count; n++)
+		i915_request_put(gang->requests[n]);
+	kfree(gang);
+}
+
+static bool gang_depends(const struct i915_gang *gang,
+			 struct i915_request *rq)
+{
+	struct i915_sched_node *node, *next;
+	struct i915_dependency *p;
+	bool found = false;
+	LIST_HEAD(dfs);
+
+	/* Need BKL in order to use the temporary link inside i915_sched_node */
+	lockdep_assert_held(&rq->i915->drm.struct_mutex);
+
+	/*
+	 * Walk every unsignaled request that @rq waits upon, directly or
+	 * not, visiting each only once, looking for a member of @gang.
+	 */
+	GEM_BUG_ON(!list_empty(&rq->sched.dfs_link));
+	list_add(&rq->sched.dfs_link, &dfs);
+	list_for_each_entry(node, &dfs, dfs_link) {
+		list_for_each_entry(p, &node->signalers_list, signal_link) {
+			struct i915_sched_node *s = p->signaler;
+
+			if (i915_sched_node_signaled(s) ||
+			    !list_empty(&s->dfs_link))
+				continue;
+
+			if (READ_ONCE(container_of(s, struct i915_request,
+						   sched)->gang) == gang) {
+				found = true;
+				goto out;
+			}
+
+			list_add_tail(&s->dfs_link, &dfs);
+		}
+	}
+
+out:
+	list_for_each_entry_safe(node, next, &dfs, dfs_link)
+		INIT_LIST_HEAD(&node->dfs_link);
+
+	return found;
+}
+
+/**
+ * i915_gang_create - prepare to submit several requests together
+ * @max: the most requests that will join the gang
+ *
+ * Returns:
+ *
+ * The new gang, or NULL if out of memory.
+ */
+struct i915_gang *i915_gang_create(unsigned int max)
+{
+	struct i915_gang *gang;
+
+	gang = kmalloc(struct_size(gang, requests, max), GFP_KERNEL);
+	if (!gang)
+		return NULL;
+
+	atomic_set(&gang->pending, 1);
+	gang->count = 0;
+
+	return gang;
+}
+
+/**
+ * i915_gang_join - add a request to a gang
+ * @gang: the gang
+ * @rq: the request, not yet passed to i915_request_add()
+ *
+ * The request is held back from the hardware, even once its own
+ * dependencies are met, until every other member of the gang is ready as
+ * well, and all are then submitted together. Each member must be on a
+ * different engine, as those on the same engine could not start together.
+ * Likewise, @rq must not depend upon any other member, as those will not
+ * start until @rq is ready, so all its dependencies must be added first.
+ *
+ * Returns:
+ *
+ * 0 on success, -EDEADLK if @rq waits upon another member of the gang,
+ * or another negative error code on failure.
+ */
+int i915_gang_join(struct i915_gang *gang, struct i915_request *rq)
+{
+	unsigned int n;
+
+	lockdep_assert_held(&rq->i915->drm.struct_mutex);
+	GEM_BUG_ON(rq->gang);
+
+	for (n = 0; n < gang->count; n++) {
+		if (gang->requests[n]->engine == rq->engine)
+			return -EINVAL;
+	}
+
+	if (gang_depends(gang, rq))
+		return -EDEADLK;
+
+	gang->requests[gang->count++] = i915_request_get(rq);
+	atomic_inc(&gang->pending);
+	rq->gang = gang;
+
+	return 0;
+}
+
+/**
+ * i915_gang_seal - close the gang to new members
+ * @gang: the gang
+ *
+ * Once sealed, the gang submits its requests as soon as they are all ready,
+ * at which point the gang is freed. Before that, all members are raised to
+ * the priority of the most important, so that none is left waiting upon the
+ * hardware when the others are ready.
+ */
+void i915_gang_seal(struct i915_gang *gang)
+{
+	struct i915_sched_attr attr = {
+		.priority = I915_PRIORITY_INVALID,
+	};
+	unsigned int n;
+
+	for (n = 0; n < gang->count; n++)
+		attr.priority = max(attr.priority,
+				    gang->requests[n]->sched.attr.priority);
+
+	local_bh_disable();
+	rcu_read_lock(); /* RCU serialisation for set-wedged protection */
+	for (n = 0; n < gang->count; n++) {
+		struct i915_request *rq = gang->requests[n];
+
+		if (rq->engine->schedule) {
+			struct i915_sched_attr rq_attr = rq->sched.attr;
+
+			rq_attr.priority = attr.priority;
+			rq->engine->schedule(rq, &rq_attr);
+		}
+	}
+	rcu_read_unlock();
+
+	gang_ready(gang);
+	local_bh_enable(); /* Kick the execlists tasklets if just scheduled */
+}
+
 static int __i915_sw_fence_call
 submit_notify(struct i915_sw_fence *fence, enum i915_sw_fence_notify state)
 {
@@ -624,6 +968,11 @@ submit_notify(struct i915_sw_fence *fence, enum i915_sw_fence_notify state)
 	switch (state) {
 	case FENCE_COMPLETE:
 		trace_i915_request_submit(request);
+		request->latency.ready = ktime_get_ns();
+		if (request->gang) {
+			gang_ready(request->gang);
+			break;
+		}
 		/*
 		 * We need to serialize use of the submit_request() callback
 		 * with its hotplugging performed during an emergency
@@ -645,6 +994,30 @@ submit_notify(struct i915_sw_fence *fence, enum i915_sw_fence_notify state)
 	return NOTIFY_DONE;
 }
 
+#define I915_SPIN_FIXED_US 5
+#define I915_SPIN_MAX_US 1000
+
+static u32 context_spin_budget(struct i915_gem_context *ctx)
+{
+	unsigned long avg;
+
+	if (!ctx->spin.adaptive)
+		return I915_SPIN_FIXED_US;
+
+	/*
+	 * Spin for a little longer than our requests have recently taken
+	 * to complete, or not at all if they were so slow that we would
+	 * be better off sleeping straight away.
+	 */
+	avg = ewma_spin_read(&ctx->spin.avg_us);
+	if (!avg)
+		return I915_SPIN_FIXED_US;
+	if (avg > I915_SPIN_MAX_US)
+		return 0;
+
+	return max(avg + avg / 2, 2ul);
+}
+
 /**
  * i915_request_alloc - allocate a request structure
  *
@@ -728,10 +1101,13 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 	 * then we grab a reference and double check that it is still the
 	 * active request - which it won't be and restart the lookup.
 	 *
-	 * Do not use kmem_cache_zalloc() here!
+	 * Do not use kmem_cache_zalloc() here! The same applies to reusing a
+	 * recently released request from the engine's freelist.
 	 */
-	rq = kmem_cache_alloc(i915->requests,
-			      GFP_KERNEL | __GFP_RETRY_MAYFAIL | __GFP_NOWARN);
+	rq = request_cache_get(engine);
+	if (!rq)
+		rq = kmem_cache_alloc(i915->requests,
+				      GFP_KERNEL | __GFP_RETRY_MAYFAIL | __GFP_NOWARN);
 	if (unlikely(!rq)) {
 		/* Ratelimit ourselves to prevent oom from malicious clients */
 		ret = i915_gem_wait_for_idle(i915,
@@ -749,6 +1125,7 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 		 * Having already penalized the client to stall, we spend
 		 * a little extra time to re-optimise page allocation.
 		 */
+		i915_request_caches_drain(i915);
 		kmem_cache_shrink(i915->requests);
 		rcu_barrier(); /* Recover the TYPESAFE_BY_RCU pages */
 
@@ -767,6 +1144,7 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 	rq->ring = ce->ring;
 	rq->timeline = ce->ring->timeline;
 	GEM_BUG_ON(rq->timeline == &engine->timeline);
+	rq->hwsp_seqno = rq->timeline->hwsp_seqno;
 
 	spin_lock_init(&rq->lock);
 	dma_fence_init(&rq->fence,
@@ -782,12 +1160,18 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 	i915_sched_node_init(&rq->sched);
 
 	/* No zalloc, must clear what we need by hand */
+	rq->spin.budget_us = context_spin_budget(ctx);
+	rq->spin.wait_us = 0;
 	rq->global_seqno = 0;
 	rq->signaling.wait.seqno = 0;
 	rq->file_priv = NULL;
 	rq->batch = NULL;
 	rq->capture_list = NULL;
+	rq->gang = NULL;
 	rq->waitboost = false;
+	rq->freq_hint = 0;
+	rq->watchdog_threshold = 0;
+	memset(&rq->latency, 0, sizeof(rq->latency));
 
 	/*
 	 * Reserve space in the ring buffer for all the commands required to
@@ -841,6 +1225,38 @@ i915_request_alloc(struct intel_engine_cs *engine, struct i915_gem_context *ctx)
 	return ERR_PTR(ret);
 }
 
+static int
+emit_semaphore_wait(struct i915_request *to, struct i915_request *from)
+{
+	u32 *cs;
+
+	/*
+	 * Only wait upon a request already on its way to the hardware,
+	 * rather than occupy our engine polling for one that may itself be
+	 * waiting for an unbounded time. The seqno written to the page is
+	 * that of the context's timeline, so it is not perturbed should the
+	 * signaler be preempted and resubmitted.
+	 */
+	if (!i915_request_global_seqno(from))
+		return -EAGAIN;
+
+	cs = intel_ring_begin(to, 4);
+	if (IS_ERR(cs))
+		return PTR_ERR(cs);
+
+	*cs++ = MI_SEMAPHORE_WAIT |
+		MI_SEMAPHORE_GLOBAL_GTT |
+		MI_SEMAPHORE_POLL |
+		MI_SEMAPHORE_SAD_GTE_SDD;
+	*cs++ = from->fence.seqno;
+	*cs++ = i915_ggtt_offset(from->gem_context->seqno_vma) +
+		I915_CONTEXT_SEQNO_SLOT(from->engine) * sizeof(u32);
+	*cs++ = 0;
+	intel_ring_advance(to, cs);
+
+	return 0;
+}
+
 static int
 i915_request_await_request(struct i915_request *to, struct i915_request *from)
 {
@@ -867,6 +1283,13 @@ i915_request_await_request(struct i915_request *to, struct i915_request *from)
 		return ret < 0 ? ret : 0;
 	}
 
+	if (i915_modparams.semaphores && INTEL_GEN(to->i915) >= 8 &&
+	    from->gem_context->seqno_vma) {
+		ret = emit_semaphore_wait(to, from);
+		if (ret != -EAGAIN)
+			return ret;
+	}
+
 	if (to->engine->semaphore.sync_to) {
 		u32 seqno;
 
@@ -1076,7 +1499,12 @@ void i915_request_add(struct i915_request *request)
 	 * GPU processing the request, we never over-estimate the
 	 * position of the ring's HEAD.
 	 */
-	cs = intel_ring_begin(request, engine->emit_breadcrumb_sz);
+	cs = intel_ring_begin(request,
+			      engine->emit_breadcrumb_sz +
+			      (request->gem_context->seqno_vma ?
+			       CONTEXT_SEQNO_DWORDS : 0) +
+			      (request->timeline->hwsp ?
+			       TIMELINE_SEQNO_DWORDS : 0));
 	GEM_BUG_ON(IS_ERR(cs));
 	request->postfix = intel_ring_offset(request, cs);
 
@@ -1124,11 +1552,24 @@ void i915_request_add(struct i915_request *request)
 	 * decide whether to preempt the entire chain so that it is ready to
 	 * run at the earliest possible convenience.
 	 */
+	request->latency.add = ktime_get_ns();
+
 	local_bh_disable();
 	rcu_read_lock(); /* RCU serialisation for set-wedged protection */
-	if (engine->schedule)
-		engine->schedule(request, &request->gem_context->sched);
+	if (engine->schedule) {
+		struct i915_sched_attr attr = request->gem_context->sched;
+
+		/* An explicit deadline (from execbuf) overrides the context's */
+		attr.deadline = request->sched.attr.deadline;
+		if (!attr.deadline && request->gem_context->deadline)
+			attr.deadline = request->latency.add +
+					request->gem_context->deadline;
+
+		engine->schedule(request, &attr);
+	}
 	rcu_read_unlock();
+
+	atomic_inc(&engine->queued);
 	i915_sw_fence_commit(&request->submit);
 	local_bh_enable(); /* Kick the execlists tasklet if just scheduled */
 
@@ -1287,6 +1728,8 @@ long i915_request_wait(struct i915_request *rq,
 	DEFINE_WAIT_FUNC(reset, default_wake_function);
 	DEFINE_WAIT_FUNC(exec, default_wake_function);
 	struct intel_wait wait;
+	bool spin_hit = false;
+	u64 spin_start = 0;
 
 	might_sleep();
 #if IS_ENABLED(CONFIG_LOCKDEP)
@@ -1337,8 +1780,11 @@ long i915_request_wait(struct i915_request *rq,
 	GEM_BUG_ON(!i915_sw_fence_signaled(&rq->submit));
 
 	/* Optimistic short spin before touching IRQs */
-	if (__i915_spin_request(rq, wait.seqno, state, 5))
+	spin_start = local_clock();
+	if (__i915_spin_request(rq, wait.seqno, state, rq->spin.budget_us)) {
+		spin_hit = true;
 		goto complete;
+	}
 
 	set_current_state(state);
 	if (intel_engine_add_wait(rq->engine, &wait))
@@ -1409,6 +1855,12 @@ long i915_request_wait(struct i915_request *rq,
 	intel_engine_remove_wait(rq->engine, &wait);
 complete:
 	__set_current_state(TASK_RUNNING);
+	if (spin_start && timeout >= 0 && !rq->spin.wait_us) {
+		rq->spin.wait_us =
+			max_t(u64, div_u64(local_clock() - spin_start,
+					   NSEC_PER_USEC), 1);
+		rq->spin.hit = spin_hit;
+	}
 	if (flags & I915_WAIT_LOCKED)
 		remove_wait_queue(errq, &reset);
 	remove_wait_queue(&rq->execute, &exec);
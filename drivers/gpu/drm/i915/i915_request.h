@@ -26,6 +26,7 @@
 #define I915_REQUEST_H
 
 #include <linux/dma-fence.h>
+#include <linux/llist.h>
 
 #include "i915_gem.h"
 #include "i915_scheduler.h"
@@ -56,6 +57,16 @@ struct i915_capture_list {
 	struct i915_vma *vma;
 };
 
+/*
+ * A gang of requests, each on a different engine, that are only submitted
+ * to the hardware together, once all of their dependencies are met.
+ */
+struct i915_gang {
+	atomic_t pending; /* members not yet ready, plus one until sealed */
+	unsigned int count;
+	struct i915_request *requests[];
+};
+
 /**
  * Request queue structure.
  *
@@ -123,6 +134,44 @@ struct i915_request {
 	struct i915_sched_node sched;
 	struct i915_dependency dep;
 
+	/*
+	 * Timestamps (ktime_get_ns()) of the request passing through each
+	 * stage of submission, from which we build the per-engine latency
+	 * histograms (see intel_engine_record_latency()). 0 if not yet seen.
+	 */
+	struct {
+		u64 add; /* i915_request_add() */
+		u64 ready; /* all dependencies signaled */
+		u64 submit; /* __i915_request_submit() */
+		u64 elsp; /* written to the ELSP */
+		u64 start; /* acknowledged by the CS */
+	} latency;
+
+	/*
+	 * Priority band charged in engine->stats while the request is in
+	 * the ELSP, fixed at schedule-in so that a later priority bump
+	 * cannot unbalance the per-band accounting.
+	 */
+	u8 stats_band;
+
+	/*
+	 * Busywait budget for i915_request_wait(), chosen from the context
+	 * at construction, and the outcome of the first wait upon us which
+	 * is fed back into the context's estimate upon retirement.
+	 */
+	struct {
+		u32 budget_us;
+		u32 wait_us; /* 0 if never waited upon */
+		bool hit; /* completed within the budget */
+	} spin;
+
+	/*
+	 * Link into the engine's lockless submission queue, used from
+	 * submission until the tasklet moves the request into its
+	 * priority queue (see execlists_submit_request()).
+	 */
+	struct llist_node submit_link;
+
 	/**
 	 * GEM sequence number associated with this request on the
 	 * global execution timeline. It is zero when the request is not
@@ -131,6 +180,14 @@ struct i915_request {
 	 */
 	u32 global_seqno;
 
+	/**
+	 * Location of the timeline's seqno in its status page, written
+	 * by the breadcrumb, or NULL if the timeline has none. Redirected
+	 * to our own fence.seqno on retirement so that we never look at
+	 * the status page after the timeline may have been freed.
+	 */
+	const u32 *hwsp_seqno;
+
 	/** Position in the ring of the start of the request */
 	u32 head;
 
@@ -166,14 +223,29 @@ struct i915_request {
 	struct i915_capture_list *capture_list;
 	struct list_head active_list;
 
+	/** Gang we are submitted with, if any, see i915_gang_join() */
+	struct i915_gang *gang;
+
 	/** Time at which this request was emitted, in jiffies. */
 	unsigned long emitted_jiffies;
 
 	bool waitboost;
 
+	/** Frequency hint accounted to RPS while in the ELSP, 0 if none */
+	u16 freq_hint;
+
+	/** Watchdog threshold armed around the batch, in clock counts */
+	u32 watchdog_threshold;
+
 	/** engine->request_list entry for this request */
 	struct list_head link;
 
+	/**
+	 * i915->request_cache entry once released. Kept apart from the rest
+	 * of the request, which may still be inspected under RCU.
+	 */
+	struct llist_node free_link;
+
 	/** ring->request_list entry for this request */
 	struct list_head ring_link;
 
@@ -255,6 +327,10 @@ int i915_request_await_dma_fence(struct i915_request *rq,
 
 void i915_request_add(struct i915_request *rq);
 
+struct i915_gang *i915_gang_create(unsigned int max);
+int i915_gang_join(struct i915_gang *gang, struct i915_request *rq);
+void i915_gang_seal(struct i915_gang *gang);
+
 void __i915_request_submit(struct i915_request *request);
 void i915_request_submit(struct i915_request *request);
 
@@ -292,8 +368,18 @@ __i915_request_completed(const struct i915_request *rq, u32 seqno)
 
 static inline bool i915_request_completed(const struct i915_request *rq)
 {
+	const u32 *hwsp = READ_ONCE(rq->hwsp_seqno);
 	u32 seqno;
 
+	/*
+	 * The timeline's own seqno is not revoked on preemption nor reset
+	 * on wraparound, and so is authoritative once written. We still
+	 * fall back to the global seqno, for the timelines without a status
+	 * page and for requests completed by fiat (e.g. upon wedging).
+	 */
+	if (hwsp && i915_seqno_passed(READ_ONCE(*hwsp), rq->fence.seqno))
+		return true;
+
 	seqno = i915_request_global_seqno(rq);
 	if (!seqno)
 		return false;
@@ -323,6 +409,9 @@ static inline bool i915_sched_node_signaled(const struct i915_sched_node *node)
 
 void i915_retire_requests(struct drm_i915_private *i915);
 
+void i915_request_caches_init(struct drm_i915_private *i915);
+void i915_request_caches_drain(struct drm_i915_private *i915);
+
 /*
  * We treat requests as fences. This is not be to confused with our
  * "fence registers" but pipeline synchronisation objects ala GL_ARB_sync.
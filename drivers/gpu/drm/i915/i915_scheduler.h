@@ -32,6 +32,15 @@ struct i915_sched_attr {
 	 * The &drm_i915_private.kernel_context is assigned the lowest priority.
 	 */
 	int priority;
+
+	/**
+	 * @deadline: time (ktime_get_ns()) by which we should complete
+	 *
+	 * Within a priority level, requests with an earlier @deadline are
+	 * executed first; a @deadline of 0 means none, and so is later than
+	 * any other.
+	 */
+	u64 deadline;
 };
 
 /*
@@ -57,6 +66,7 @@ struct i915_sched_node {
 	struct list_head signalers_list; /* those before us, we depend upon */
 	struct list_head waiters_list; /* those after us, they depend upon us */
 	struct list_head link;
+	struct list_head dfs_link; /* temporary, see execlists_schedule() */
 	struct i915_sched_attr attr;
 };
 
@@ -64,7 +74,6 @@ struct i915_dependency {
 	struct i915_sched_node *signaler;
 	struct list_head signal_link;
 	struct list_head wait_link;
-	struct list_head dfs_link;
 	unsigned long flags;
 #define I915_DEPENDENCY_ALLOC BIT(0)
 };
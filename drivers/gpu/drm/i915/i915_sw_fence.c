@@ -13,6 +13,7 @@
 #include <linux/reservation.h>
 
 #include "i915_sw_fence.h"
+#include "i915_syncmap.h"
 #include "i915_selftest.h"
 
 #define I915_SW_FENCE_FLAG_ALLOC BIT(3) /* after WQ_FLAG_* for safety */
@@ -182,6 +183,9 @@ static void __i915_sw_fence_complete(struct i915_sw_fence *fence,
 	if (!atomic_dec_and_test(&fence->pending))
 		return;
 
+	/* No more waits can be added, forget what we waited upon */
+	i915_syncmap_free(&fence->sync);
+
 	debug_fence_set_state(fence, DEBUG_FENCE_IDLE, DEBUG_FENCE_NOTIFY);
 
 	if (__i915_sw_fence_notify(fence, FENCE_COMPLETE) != NOTIFY_DONE)
@@ -223,6 +227,7 @@ void __i915_sw_fence_init(struct i915_sw_fence *fence,
 	__init_waitqueue_head(&fence->wait, name, key);
 	atomic_set(&fence->pending, 1);
 	fence->flags = (unsigned long)fn;
+	i915_syncmap_init(&fence->sync);
 }
 
 void i915_sw_fence_commit(struct i915_sw_fence *fence)
@@ -482,9 +487,57 @@ int i915_sw_fence_await_dma_fence(struct i915_sw_fence *fence,
 	return ret;
 }
 
+static atomic_long_t reservation_awaits = ATOMIC_LONG_INIT(0);
+static atomic_long_t reservation_awaits_elided = ATOMIC_LONG_INIT(0);
+
+/*
+ * Fences along one context signal in order, so once we have waited upon
+ * a fence we can skip any earlier fence from the same context added to
+ * the same i915_sw_fence, e.g. by many objects rendered by one timeline.
+ * Fences on the @unordered context do not obey that rule and are always
+ * awaited. The caller must serialise waits added to @fence.
+ */
+static int __i915_sw_fence_await_ordered(struct i915_sw_fence *fence,
+					 struct dma_fence *dma,
+					 u64 unordered,
+					 unsigned long timeout,
+					 gfp_t gfp)
+{
+	int pending;
+
+	atomic_long_inc(&reservation_awaits);
+
+	if (dma->context != unordered &&
+	    i915_syncmap_is_later(&fence->sync, dma->context, dma->seqno)) {
+		atomic_long_inc(&reservation_awaits_elided);
+		return 0;
+	}
+
+	pending = i915_sw_fence_await_dma_fence(fence, dma, timeout, gfp);
+
+	/* Failing to record the fence only costs us future elisions */
+	if (pending >= 0 && dma->context != unordered &&
+	    gfpflags_allow_blocking(gfp))
+		i915_syncmap_set(&fence->sync, dma->context, dma->seqno);
+
+	return pending;
+}
+
+/**
+ * i915_sw_fence_await_stats - report fence waits elided by context
+ * @awaits: number of fences passed to i915_sw_fence_await_reservation()
+ * @elided: how many of those were already covered by a later fence
+ */
+void i915_sw_fence_await_stats(unsigned long *awaits, unsigned long *elided)
+{
+	*awaits = atomic_long_read(&reservation_awaits);
+	*elided = atomic_long_read(&reservation_awaits_elided);
+}
+
 int i915_sw_fence_await_reservation(struct i915_sw_fence *fence,
 				    struct reservation_object *resv,
 				    const struct dma_fence_ops *exclude,
+				    u64 unordered,
 				    bool write,
 				    unsigned long timeout,
 				    gfp_t gfp)
@@ -508,8 +561,9 @@ int i915_sw_fence_await_reservation(struct i915_sw_fence *fence,
 			if (shared[i]->ops == exclude)
 				continue;
 
-			pending = i915_sw_fence_await_dma_fence(fence,
+			pending = __i915_sw_fence_await_ordered(fence,
 								shared[i],
+								unordered,
 								timeout,
 								gfp);
 			if (pending < 0) {
@@ -528,8 +582,9 @@ int i915_sw_fence_await_reservation(struct i915_sw_fence *fence,
 	}
 
 	if (ret >= 0 && excl && excl->ops != exclude) {
-		pending = i915_sw_fence_await_dma_fence(fence,
+		pending = __i915_sw_fence_await_ordered(fence,
 							excl,
+							unordered,
 							timeout,
 							gfp);
 		if (pending < 0)
@@ -19,11 +19,13 @@ struct completion;
 struct dma_fence;
 struct dma_fence_ops;
 struct reservation_object;
+struct i915_syncmap;
 
 struct i915_sw_fence {
 	wait_queue_head_t wait;
 	unsigned long flags;
 	atomic_t pending;
+	struct i915_syncmap *sync; /* latest fence awaited per context */
 };
 
 #define I915_SW_FENCE_CHECKED_BIT	0 /* used internally for DAG checking */
@@ -76,10 +78,13 @@ int i915_sw_fence_await_dma_fence(struct i915_sw_fence *fence,
 int i915_sw_fence_await_reservation(struct i915_sw_fence *fence,
 				    struct reservation_object *resv,
 				    const struct dma_fence_ops *exclude,
+				    u64 unordered,
 				    bool write,
 				    unsigned long timeout,
 				    gfp_t gfp);
 
+void i915_sw_fence_await_stats(unsigned long *awaits, unsigned long *elided);
+
 static inline bool i915_sw_fence_signaled(const struct i915_sw_fence *fence)
 {
 	return atomic_read(&fence->pending) <= 0;
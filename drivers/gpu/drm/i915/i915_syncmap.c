@@ -72,8 +72,8 @@
 
 struct i915_syncmap {
 	u64 prefix;
+	unsigned long bitmap;
 	unsigned int height;
-	unsigned int bitmap;
 	struct i915_syncmap *parent;
 	/*
 	 * Following this header is an array of either seqno or child pointers:
@@ -91,7 +91,6 @@ struct i915_syncmap {
 void i915_syncmap_init(struct i915_syncmap **root)
 {
 	BUILD_BUG_ON_NOT_POWER_OF_2(KSYNCMAP);
-	BUILD_BUG_ON_NOT_POWER_OF_2(SHIFT);
 	BUILD_BUG_ON(KSYNCMAP > BITS_PER_BYTE * sizeof((*root)->bitmap));
 	*root = NULL;
 }
@@ -195,12 +194,25 @@ bool i915_syncmap_is_later(struct i915_syncmap **root, u64 id, u32 seqno)
 	return seqno_later(__sync_seqno(p)[idx], seqno);
 }
 
+/*
+ * A lookup touches the leaf header (prefix, bitmap) and then a single seqno.
+ * Rounding the leaf up to a power-of-two allocation hands it out from a
+ * naturally aligned kmalloc cache, so the header always shares its cacheline
+ * with the first seqnos of the leaf and no leaf straddles more cachelines
+ * than its size demands.
+ */
+#define SYNC_LEAF_SIZE \
+	roundup_pow_of_two(max_t(size_t, \
+				 sizeof(struct i915_syncmap) + \
+				 KSYNCMAP * sizeof(u32), \
+				 L1_CACHE_BYTES))
+
 static struct i915_syncmap *
 __sync_alloc_leaf(struct i915_syncmap *parent, u64 id)
 {
 	struct i915_syncmap *p;
 
-	p = kmalloc(sizeof(*p) + KSYNCMAP * sizeof(u32), GFP_KERNEL);
+	p = kmalloc(SYNC_LEAF_SIZE, GFP_KERNEL);
 	if (unlikely(!p))
 		return NULL;
 
@@ -287,9 +299,12 @@ static noinline int __sync_set(struct i915_syncmap **root, u64 id, u32 seqno)
 			if (unlikely(!next))
 				return -ENOMEM;
 
-			/* Compute the height at which these two diverge */
+			/*
+			 * Compute the height at which these two diverge. SHIFT
+			 * need not be a power of two for the wider radices.
+			 */
 			above = fls64(__sync_branch_prefix(p, id) ^ p->prefix);
-			above = round_up(above, SHIFT);
+			above = roundup(above, SHIFT);
 			next->height = above + p->height;
 			next->prefix = __sync_branch_prefix(next, id);
 
@@ -371,10 +386,8 @@ static void __sync_free(struct i915_syncmap *p)
 	if (p->height) {
 		unsigned int i;
 
-		while ((i = ffs(p->bitmap))) {
-			p->bitmap &= ~0u << i;
-			__sync_free(__sync_child(p)[i - 1]);
-		}
+		for_each_set_bit(i, &p->bitmap, KSYNCMAP)
+			__sync_free(__sync_child(p)[i]);
 	}
 
 	kfree(p);
@@ -28,7 +28,11 @@
 #include <linux/types.h>
 
 struct i915_syncmap;
+#ifdef CONFIG_DRM_I915_SYNCMAP_RADIX
+#define KSYNCMAP CONFIG_DRM_I915_SYNCMAP_RADIX
+#else
 #define KSYNCMAP 16 /* radix of the tree, how many slots in each layer */
+#endif
 
 void i915_syncmap_init(struct i915_syncmap **root);
 int i915_syncmap_set(struct i915_syncmap **root, u64 id, u32 seqno);
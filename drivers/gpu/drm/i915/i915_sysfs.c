@@ -620,6 +620,194 @@ static void i915_setup_error_capture_aub(struct device *kdev) {}
 static void i915_teardown_error_capture_aub(struct device *kdev) {}
 #endif
 
+struct kobj_engine {
+	struct kobject base;
+	struct intel_engine_cs *engine;
+};
+
+static struct intel_engine_cs *kobj_to_engine(struct kobject *kobj)
+{
+	return container_of(kobj, struct kobj_engine, base)->engine;
+}
+
+static ssize_t
+timeslice_duration_ms_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(engine->execlists.timeslice_duration_ms));
+}
+
+static ssize_t
+timeslice_duration_ms_store(struct kobject *kobj, struct kobj_attribute *attr,
+			    const char *buf, size_t count)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+	unsigned int duration;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &duration);
+	if (ret)
+		return ret;
+
+	if (duration > jiffies_to_msecs(MAX_JIFFY_OFFSET))
+		return -EINVAL;
+
+	/* Takes effect from the next context switch */
+	WRITE_ONCE(engine->execlists.timeslice_duration_ms, duration);
+
+	return count;
+}
+
+static struct kobj_attribute timeslice_duration_attr =
+	__ATTR(timeslice_duration_ms, 0644,
+	       timeslice_duration_ms_show, timeslice_duration_ms_store);
+
+static ssize_t
+irq_coalesce_show(struct kobject *kobj, struct kobj_attribute *attr,
+		  char *buf)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(engine->breadcrumbs.coalesce.interval));
+}
+
+static ssize_t
+irq_coalesce_store(struct kobject *kobj, struct kobj_attribute *attr,
+		   const char *buf, size_t count)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+	unsigned int interval;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &interval);
+	if (ret)
+		return ret;
+
+	/* Takes effect from the next breadcrumb submitted */
+	WRITE_ONCE(engine->breadcrumbs.coalesce.interval, interval);
+
+	return count;
+}
+
+static struct kobj_attribute irq_coalesce_attr =
+	__ATTR(irq_coalesce, 0644, irq_coalesce_show, irq_coalesce_store);
+
+static ssize_t
+irq_coalesce_us_show(struct kobject *kobj, struct kobj_attribute *attr,
+		     char *buf)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(engine->breadcrumbs.coalesce.window_us));
+}
+
+static ssize_t
+irq_coalesce_us_store(struct kobject *kobj, struct kobj_attribute *attr,
+		      const char *buf, size_t count)
+{
+	struct intel_engine_cs *engine = kobj_to_engine(kobj);
+	unsigned int window;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &window);
+	if (ret)
+		return ret;
+
+	/* The waiters may be left asleep for up to a window */
+	if (!window || window > USEC_PER_SEC)
+		return -EINVAL;
+
+	WRITE_ONCE(engine->breadcrumbs.coalesce.window_us, window);
+
+	return count;
+}
+
+static struct kobj_attribute irq_coalesce_us_attr =
+	__ATTR(irq_coalesce_us, 0644,
+	       irq_coalesce_us_show, irq_coalesce_us_store);
+
+static const struct attribute *irq_coalesce_attrs[] = {
+	&irq_coalesce_attr.attr,
+	&irq_coalesce_us_attr.attr,
+	NULL
+};
+
+static void kobj_engine_release(struct kobject *kobj)
+{
+	kfree(container_of(kobj, struct kobj_engine, base));
+}
+
+static struct kobj_type kobj_engine_type = {
+	.release = kobj_engine_release,
+	.sysfs_ops = &kobj_sysfs_ops,
+};
+
+static void i915_setup_engine_sysfs(struct drm_i915_private *dev_priv)
+{
+	struct device *kdev = dev_priv->drm.primary->kdev;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	if (!HAS_EXECLISTS(dev_priv))
+		return;
+
+	dev_priv->sysfs_engine = kobject_create_and_add("engine", &kdev->kobj);
+	if (!dev_priv->sysfs_engine)
+		goto err;
+
+	for_each_engine(engine, dev_priv, id) {
+		struct kobj_engine *ke;
+
+		ke = kzalloc(sizeof(*ke), GFP_KERNEL);
+		if (!ke)
+			goto err;
+
+		ke->engine = engine;
+		kobject_init(&ke->base, &kobj_engine_type);
+		if (kobject_add(&ke->base, dev_priv->sysfs_engine,
+				"%s", engine->name)) {
+			kobject_put(&ke->base);
+			goto err;
+		}
+		engine->kobj = &ke->base;
+
+		/* Interrupt moderation is applied by the gen8+ breadcrumbs */
+		if (sysfs_create_files(engine->kobj, irq_coalesce_attrs))
+			goto err;
+
+		/* Timeslicing is only implemented by execlists using preemption */
+		if (!USES_GUC_SUBMISSION(dev_priv) &&
+		    dev_priv->preempt_context &&
+		    sysfs_create_file(engine->kobj,
+				      &timeslice_duration_attr.attr))
+			goto err;
+	}
+
+	return;
+
+err:
+	DRM_ERROR("engine sysfs setup failed\n");
+}
+
+static void i915_teardown_engine_sysfs(struct drm_i915_private *dev_priv)
+{
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+
+	for_each_engine(engine, dev_priv, id) {
+		kobject_put(engine->kobj);
+		engine->kobj = NULL;
+	}
+
+	kobject_put(dev_priv->sysfs_engine);
+	dev_priv->sysfs_engine = NULL;
+}
+
 void i915_setup_sysfs(struct drm_i915_private *dev_priv)
 {
 	struct device *kdev = dev_priv->drm.primary->kdev;
@@ -666,6 +854,8 @@ void i915_setup_sysfs(struct drm_i915_private *dev_priv)
 	if (ret)
 		DRM_ERROR("RPS sysfs setup failed\n");
 
+	i915_setup_engine_sysfs(dev_priv);
+
 	i915_setup_error_capture(kdev);
 	i915_setup_error_capture_aub(kdev);
 }
@@ -677,6 +867,8 @@ void i915_teardown_sysfs(struct drm_i915_private *dev_priv)
 	i915_teardown_error_capture(kdev);
 	i915_teardown_error_capture_aub(kdev);
 
+	i915_teardown_engine_sysfs(dev_priv);
+
 	if (IS_VALLEYVIEW(dev_priv) || IS_CHERRYVIEW(dev_priv))
 		sysfs_remove_files(&kdev->kobj, vlv_attrs);
 	else
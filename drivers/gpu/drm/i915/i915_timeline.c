@@ -9,6 +9,136 @@
 #include "i915_timeline.h"
 #include "i915_syncmap.h"
 
+#define CACHELINE_BYTES 64
+#define CACHELINES_PER_PAGE (PAGE_SIZE / CACHELINE_BYTES)
+
+/*
+ * A page of the GGTT, kept pinned and mapped, carved up into a cacheline
+ * for each timeline to write its seqno into. Pages with free cachelines
+ * are kept on i915->gt.hwsp_free_list, all under struct_mutex.
+ */
+struct i915_timeline_hwsp {
+	struct drm_i915_private *i915;
+	struct i915_vma *vma;
+	void *vaddr;
+	struct list_head free_link;
+	u64 free_bitmap;
+};
+
+static struct i915_timeline_hwsp *
+hwsp_alloc(struct drm_i915_private *i915, unsigned int *cacheline)
+{
+	struct i915_timeline_hwsp *hwsp;
+	struct drm_i915_gem_object *obj;
+	struct i915_vma *vma;
+	void *vaddr;
+	int err;
+
+	BUILD_BUG_ON(CACHELINES_PER_PAGE > BITS_PER_TYPE(u64));
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	hwsp = list_first_entry_or_null(&i915->gt.hwsp_free_list,
+					typeof(*hwsp), free_link);
+	if (!hwsp) {
+		hwsp = kmalloc(sizeof(*hwsp), GFP_KERNEL);
+		if (!hwsp)
+			return ERR_PTR(-ENOMEM);
+
+		obj = i915_gem_object_create_internal(i915, PAGE_SIZE);
+		if (IS_ERR(obj)) {
+			err = PTR_ERR(obj);
+			goto err_free;
+		}
+
+		/* Snooped, so that we see the GPU writes through our WB map */
+		err = i915_gem_object_set_cache_level(obj, I915_CACHE_LLC);
+		if (err)
+			goto err_obj;
+
+		vma = i915_vma_instance(obj, &i915->ggtt.vm, NULL);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			goto err_obj;
+		}
+
+		err = i915_vma_pin(vma, 0, 0, PIN_GLOBAL | PIN_HIGH);
+		if (err)
+			goto err_obj;
+
+		vaddr = i915_gem_object_pin_map(obj, I915_MAP_WB);
+		if (IS_ERR(vaddr)) {
+			err = PTR_ERR(vaddr);
+			goto err_unpin;
+		}
+
+		hwsp->i915 = i915;
+		hwsp->vma = vma;
+		hwsp->vaddr = vaddr;
+		hwsp->free_bitmap = ~0ull >> (64 - CACHELINES_PER_PAGE);
+		list_add(&hwsp->free_link, &i915->gt.hwsp_free_list);
+	}
+
+	GEM_BUG_ON(!hwsp->free_bitmap);
+	*cacheline = __ffs64(hwsp->free_bitmap);
+	hwsp->free_bitmap &= ~BIT_ULL(*cacheline);
+	if (!hwsp->free_bitmap)
+		list_del(&hwsp->free_link);
+
+	return hwsp;
+
+err_unpin:
+	i915_vma_unpin(vma);
+err_obj:
+	i915_gem_object_put(obj);
+err_free:
+	kfree(hwsp);
+	return ERR_PTR(err);
+}
+
+static void hwsp_free(struct i915_timeline_hwsp *hwsp, unsigned int cacheline)
+{
+	const u64 all = ~0ull >> (64 - CACHELINES_PER_PAGE);
+
+	lockdep_assert_held(&hwsp->i915->drm.struct_mutex);
+
+	/* A full page is off the free list, return it on its first release */
+	if (!hwsp->free_bitmap)
+		list_add_tail(&hwsp->free_link, &hwsp->i915->gt.hwsp_free_list);
+
+	GEM_BUG_ON(hwsp->free_bitmap & BIT_ULL(cacheline));
+	hwsp->free_bitmap |= BIT_ULL(cacheline);
+
+	/* And release the page once the last of its timelines is gone */
+	if (hwsp->free_bitmap == all) {
+		list_del(&hwsp->free_link);
+		i915_gem_object_unpin_map(hwsp->vma->obj);
+		i915_vma_unpin_and_release(&hwsp->vma, 0);
+		kfree(hwsp);
+	}
+}
+
+static int timeline_attach_hwsp(struct drm_i915_private *i915,
+				struct i915_timeline *timeline)
+{
+	struct i915_timeline_hwsp *hwsp;
+	unsigned int cacheline;
+
+	hwsp = hwsp_alloc(i915, &cacheline);
+	if (IS_ERR(hwsp))
+		return PTR_ERR(hwsp);
+
+	timeline->hwsp = hwsp;
+	timeline->hwsp_cacheline = cacheline;
+	timeline->hwsp_offset =
+		i915_ggtt_offset(hwsp->vma) + cacheline * CACHELINE_BYTES;
+	timeline->hwsp_seqno = hwsp->vaddr + cacheline * CACHELINE_BYTES;
+
+	/* A recycled cacheline still holds the seqno of its last owner */
+	WRITE_ONCE(*timeline->hwsp_seqno, timeline->seqno);
+
+	return 0;
+}
+
 void i915_timeline_init(struct drm_i915_private *i915,
 			struct i915_timeline *timeline,
 			const char *name)
@@ -37,6 +167,10 @@ void i915_timeline_init(struct drm_i915_private *i915,
 	INIT_LIST_HEAD(&timeline->requests);
 
 	i915_syncmap_init(&timeline->sync);
+	timeline->sync_cache_valid = 0;
+
+	timeline->hwsp = NULL;
+	timeline->hwsp_seqno = NULL;
 }
 
 /**
@@ -62,7 +196,7 @@ void i915_timelines_park(struct drm_i915_private *i915)
 		 * any attempt to wait upon a previous sync point
 		 * will be skipped as the fence was signaled.
 		 */
-		i915_syncmap_free(&timeline->sync);
+		i915_timeline_sync_reset(timeline);
 	}
 }
 
@@ -70,7 +204,10 @@ void i915_timeline_fini(struct i915_timeline *timeline)
 {
 	GEM_BUG_ON(!list_empty(&timeline->requests));
 
-	i915_syncmap_free(&timeline->sync);
+	i915_timeline_sync_reset(timeline);
+
+	if (timeline->hwsp)
+		hwsp_free(timeline->hwsp, timeline->hwsp_cacheline);
 
 	list_del(&timeline->link);
 }
@@ -79,6 +216,7 @@ struct i915_timeline *
 i915_timeline_create(struct drm_i915_private *i915, const char *name)
 {
 	struct i915_timeline *timeline;
+	int err;
 
 	timeline = kzalloc(sizeof(*timeline), GFP_KERNEL);
 	if (!timeline)
@@ -87,6 +225,15 @@ i915_timeline_create(struct drm_i915_private *i915, const char *name)
 	i915_timeline_init(i915, timeline, name);
 	kref_init(&timeline->kref);
 
+	if (INTEL_GEN(i915) >= 8) {
+		err = timeline_attach_hwsp(i915, timeline);
+		if (err) {
+			i915_timeline_fini(timeline);
+			kfree(timeline);
+			return ERR_PTR(err);
+		}
+	}
+
 	return timeline;
 }
 
@@ -32,10 +32,28 @@
 #include "i915_syncmap.h"
 #include "i915_utils.h"
 
+#define I915_TIMELINE_SYNC_CACHE 4
+
+struct i915_timeline_hwsp;
+
 struct i915_timeline {
 	u64 fence_context;
 	u32 seqno;
 
+	/**
+	 * Each request on this timeline writes its fence seqno into a
+	 * cacheline of a status page shared between timelines as it
+	 * completes. Unlike the global engine seqno, this is neither
+	 * revoked by preemption nor rebased on wraparound, so completion
+	 * can be checked directly against the fence, see
+	 * i915_request_completed(). Only present for timelines created by
+	 * i915_timeline_create() on gen8+.
+	 */
+	struct i915_timeline_hwsp *hwsp;
+	unsigned int hwsp_cacheline;
+	u32 hwsp_offset;
+	u32 *hwsp_seqno;
+
 	spinlock_t lock;
 #define TIMELINE_CLIENT 0 /* default subclass */
 #define TIMELINE_ENGINE 1
@@ -63,6 +81,18 @@ struct i915_timeline {
 	 * redundant and we can discard it without loss of generality.
 	 */
 	struct i915_syncmap *sync;
+	/**
+	 * A few of the most recently set sync points, mirroring their entries
+	 * in @sync, checked before walking the tree. Awaits mostly alternate
+	 * between a handful of other timelines (e.g. the same context on the
+	 * other engines), which need not share a leaf of the syncmap.
+	 */
+	struct i915_timeline_sync_cache {
+		u64 context;
+		u32 seqno;
+	} sync_cache[I915_TIMELINE_SYNC_CACHE];
+	unsigned int sync_cache_valid;
+	unsigned int sync_cache_next;
 	/**
 	 * Separately to the inter-context seqno map above, we track the last
 	 * barrier (e.g. semaphore wait) to the global engine timelines. Note
@@ -99,10 +129,51 @@ static inline void i915_timeline_put(struct i915_timeline *timeline)
 	kref_put(&timeline->kref, __i915_timeline_free);
 }
 
+static inline struct i915_timeline_sync_cache *
+__i915_timeline_sync_lookup(struct i915_timeline *tl, u64 context)
+{
+	unsigned int valid = tl->sync_cache_valid;
+
+	while (valid) {
+		unsigned int i = __ffs(valid);
+
+		if (tl->sync_cache[i].context == context)
+			return &tl->sync_cache[i];
+
+		valid &= ~BIT(i);
+	}
+
+	return NULL;
+}
+
+static inline void i915_timeline_sync_reset(struct i915_timeline *tl)
+{
+	i915_syncmap_free(&tl->sync);
+	tl->sync_cache_valid = 0;
+}
+
 static inline int __i915_timeline_sync_set(struct i915_timeline *tl,
 					   u64 context, u32 seqno)
 {
-	return i915_syncmap_set(&tl->sync, context, seqno);
+	struct i915_timeline_sync_cache *c;
+	int err;
+
+	err = i915_syncmap_set(&tl->sync, context, seqno);
+	if (err)
+		return err;
+
+	c = __i915_timeline_sync_lookup(tl, context);
+	if (!c) {
+		unsigned int i;
+
+		i = tl->sync_cache_next++ % I915_TIMELINE_SYNC_CACHE;
+		c = &tl->sync_cache[i];
+		c->context = context;
+		tl->sync_cache_valid |= BIT(i);
+	}
+	c->seqno = seqno;
+
+	return 0;
 }
 
 static inline int i915_timeline_sync_set(struct i915_timeline *tl,
@@ -114,6 +185,12 @@ static inline int i915_timeline_sync_set(struct i915_timeline *tl,
 static inline bool __i915_timeline_sync_is_later(struct i915_timeline *tl,
 						 u64 context, u32 seqno)
 {
+	const struct i915_timeline_sync_cache *c;
+
+	c = __i915_timeline_sync_lookup(tl, context);
+	if (c)
+		return i915_seqno_passed(c->seqno, seqno);
+
 	return i915_syncmap_is_later(&tl->sync, context, seqno);
 }
 
@@ -357,6 +357,34 @@ TRACE_EVENT(i915_gem_object_create,
 	    TP_printk("obj=%p, size=0x%llx", __entry->obj, __entry->size)
 );
 
+TRACE_EVENT(i915_gem_object_populate,
+	    TP_PROTO(struct drm_i915_gem_object *obj, int node,
+		     unsigned long local, unsigned int nodes, u64 ns),
+	    TP_ARGS(obj, node, local, nodes, ns),
+
+	    TP_STRUCT__entry(
+			     __field(struct drm_i915_gem_object *, obj)
+			     __field(u64, size)
+			     __field(int, node)
+			     __field(unsigned long, local)
+			     __field(unsigned int, nodes)
+			     __field(u64, ns)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->obj = obj;
+			   __entry->size = obj->base.size;
+			   __entry->node = node;
+			   __entry->local = local;
+			   __entry->nodes = nodes;
+			   __entry->ns = ns;
+			   ),
+
+	    TP_printk("obj=%p, size=0x%llx, node=%d, local pages=%lu, nodes=%u, time=%lluns",
+		      __entry->obj, __entry->size, __entry->node,
+		      __entry->local, __entry->nodes, __entry->ns)
+);
+
 TRACE_EVENT(i915_gem_shrink,
 	    TP_PROTO(struct drm_i915_private *i915, unsigned long target, unsigned flags),
 	    TP_ARGS(i915, target, flags),
@@ -490,6 +518,32 @@ TRACE_EVENT(i915_gem_object_fault,
 		      __entry->write ? ", writable" : "")
 );
 
+TRACE_EVENT(i915_gem_object_fault_done,
+	    TP_PROTO(struct drm_i915_gem_object *obj, u64 index,
+		     unsigned long pages, u64 ns, int ret),
+	    TP_ARGS(obj, index, pages, ns, ret),
+
+	    TP_STRUCT__entry(
+			     __field(struct drm_i915_gem_object *, obj)
+			     __field(u64, index)
+			     __field(unsigned long, pages)
+			     __field(u64, ns)
+			     __field(int, ret)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->obj = obj;
+			   __entry->index = index;
+			   __entry->pages = pages;
+			   __entry->ns = ns;
+			   __entry->ret = ret;
+			   ),
+
+	    TP_printk("obj=%p, index=%llu, mapped %lu pages in %lluns, ret=%d",
+		      __entry->obj, __entry->index, __entry->pages,
+		      __entry->ns, __entry->ret)
+);
+
 DECLARE_EVENT_CLASS(i915_gem_object,
 	    TP_PROTO(struct drm_i915_gem_object *obj),
 	    TP_ARGS(obj),
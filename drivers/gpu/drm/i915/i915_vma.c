@@ -29,6 +29,7 @@
 #include "intel_frontbuffer.h"
 
 #include <drm/drm_gem.h>
+#include <linux/hash.h>
 
 #if IS_ENABLED(CONFIG_DRM_I915_ERRLOG_GEM) && IS_ENABLED(CONFIG_DRM_DEBUG_MM)
 
@@ -63,6 +64,33 @@ static void vma_print_allocator(struct i915_vma *vma, const char *reason)
 
 #endif
 
+/**
+ * i915_vma_move_to_inactive - add a vma to the inactive list of its vm
+ * @vma: the vma, bound and idle
+ *
+ * The inactive list is kept in order of i915_vma.last_access, oldest
+ * first, so that eviction scans the least recently used vma first without
+ * having to sort. A vma usually retires soon after its last use, so the
+ * walk back from the tail to its place is short.
+ */
+void i915_vma_move_to_inactive(struct i915_vma *vma)
+{
+	struct list_head *inactive = &vma->vm->inactive_list;
+	struct list_head *pos;
+
+	list_del(&vma->vm_link);
+
+	for (pos = inactive->prev; pos != inactive; pos = pos->prev) {
+		const struct i915_vma *prev =
+			list_entry(pos, typeof(*prev), vm_link);
+
+		if (prev->last_access <= vma->last_access)
+			break;
+	}
+
+	list_add(&vma->vm_link, pos);
+}
+
 struct i915_vma_active {
 	struct i915_gem_active base;
 	struct i915_vma *vma;
@@ -80,7 +108,7 @@ __i915_vma_retire(struct i915_vma *vma, struct i915_request *rq)
 		return;
 
 	GEM_BUG_ON(!drm_mm_node_allocated(&vma->node));
-	list_move_tail(&vma->vm_link, &vma->vm->inactive_list);
+	i915_vma_move_to_inactive(vma);
 
 	GEM_BUG_ON(!i915_gem_object_is_active(obj));
 	if (--obj->active_count)
@@ -125,6 +153,46 @@ i915_vma_last_retire(struct i915_gem_active *base, struct i915_request *rq)
 	__i915_vma_retire(container_of(base, struct i915_vma, last_active), rq);
 }
 
+#define VMA_HASH_BITS 6
+#define VMA_HASH_THRESHOLD 16
+
+static struct hlist_head *
+vma_hash_bucket(struct hlist_head *hash, const struct i915_address_space *vm)
+{
+	return &hash[hash_ptr(vm, VMA_HASH_BITS)];
+}
+
+static void vma_hash_add(struct drm_i915_gem_object *obj, struct i915_vma *vma)
+{
+	struct i915_vma *it;
+
+	GEM_BUG_ON(i915_vma_is_ggtt(vma));
+
+	if (obj->vma_hash) {
+		hlist_add_head(&vma->obj_hash,
+			       vma_hash_bucket(obj->vma_hash, vma->vm));
+		return;
+	}
+
+	if (obj->vma_ppgtt_count < VMA_HASH_THRESHOLD)
+		return;
+
+	/* Failing to build the index just leaves us with the vma_tree */
+	obj->vma_hash = kcalloc(BIT(VMA_HASH_BITS), sizeof(*obj->vma_hash),
+				GFP_KERNEL | __GFP_NOWARN);
+	if (!obj->vma_hash)
+		return;
+
+	/* The ppGTT vma are kept at the tail of the vma_list */
+	list_for_each_entry_reverse(it, &obj->vma_list, obj_link) {
+		if (i915_vma_is_ggtt(it))
+			break;
+
+		hlist_add_head(&it->obj_hash,
+			       vma_hash_bucket(obj->vma_hash, it->vm));
+	}
+}
+
 static struct i915_vma *
 vma_create(struct drm_i915_gem_object *obj,
 	   struct i915_address_space *vm,
@@ -141,6 +209,7 @@ vma_create(struct drm_i915_gem_object *obj,
 		return ERR_PTR(-ENOMEM);
 
 	vma->active = RB_ROOT;
+	INIT_HLIST_NODE(&vma->obj_hash);
 
 	init_request_active(&vma->last_active, i915_vma_last_retire);
 	init_request_active(&vma->last_fence, NULL);
@@ -217,6 +286,10 @@ vma_create(struct drm_i915_gem_object *obj,
 	}
 	rb_link_node(&vma->obj_node, rb, p);
 	rb_insert_color(&vma->obj_node, &obj->vma_tree);
+	if (!i915_vma_is_ggtt(vma)) {
+		obj->vma_ppgtt_count++;
+		vma_hash_add(obj, vma);
+	}
 	list_add(&vma->vm_link, &vm->unbound_list);
 
 	return vma;
@@ -233,6 +306,19 @@ vma_lookup(struct drm_i915_gem_object *obj,
 {
 	struct rb_node *rb;
 
+	if (obj->vma_hash && !i915_is_ggtt(vm)) {
+		struct i915_vma *vma;
+
+		hlist_for_each_entry(vma,
+				     vma_hash_bucket(obj->vma_hash, vm),
+				     obj_hash) {
+			if (vma->vm == vm)
+				return vma;
+		}
+
+		return NULL;
+	}
+
 	rb = obj->vma_tree.rb_node;
 	while (rb) {
 		struct i915_vma *vma = rb_entry(rb, struct i915_vma, obj_node);
@@ -660,7 +746,9 @@ i915_vma_insert(struct i915_vma *vma, u64 size, u64 alignment, u64 flags)
 	GEM_BUG_ON(!drm_mm_node_allocated(&vma->node));
 	GEM_BUG_ON(!i915_gem_valid_gtt_space(vma, cache_level));
 
-	list_move_tail(&vma->vm_link, &vma->vm->inactive_list);
+	/* Binding is a use, so the fresh vma is not the first to be evicted */
+	vma->last_access = ++vma->vm->access_gen;
+	i915_vma_move_to_inactive(vma);
 
 	if (vma->obj) {
 		struct drm_i915_gem_object *obj = vma->obj;
@@ -670,6 +758,12 @@ i915_vma_insert(struct i915_vma *vma, u64 size, u64 alignment, u64 flags)
 		obj->bind_count++;
 		spin_unlock(&dev_priv->mm.obj_lock);
 
+		i915_gem_object_client_account(obj,
+					       i915_is_ggtt(vma->vm) ?
+					       I915_GEM_CLIENT_GGTT :
+					       I915_GEM_CLIENT_PPGTT,
+					       vma->node.size);
+
 		assert_bind_count(obj);
 	}
 
@@ -708,6 +802,12 @@ i915_vma_remove(struct i915_vma *vma)
 			list_move_tail(&obj->mm.link, &i915->mm.unbound_list);
 		spin_unlock(&i915->mm.obj_lock);
 
+		i915_gem_object_client_account(obj,
+					       i915_is_ggtt(vma->vm) ?
+					       I915_GEM_CLIENT_GGTT :
+					       I915_GEM_CLIENT_PPGTT,
+					       -vma->node.size);
+
 		/*
 		 * And finally now the object is completely decoupled from this
 		 * vma, we can drop its hold on the backing storage and allow
@@ -802,13 +902,21 @@ static void __i915_vma_destroy(struct i915_vma *vma)
 
 	GEM_BUG_ON(vma->node.allocated);
 	GEM_BUG_ON(vma->fence);
+	GEM_BUG_ON(vma->bind_fence);
 
 	GEM_BUG_ON(i915_gem_active_isset(&vma->last_fence));
 
 	list_del(&vma->obj_link);
 	list_del(&vma->vm_link);
-	if (vma->obj)
+	if (vma->obj) {
 		rb_erase(&vma->obj_node, &vma->obj->vma_tree);
+		if (!i915_vma_is_ggtt(vma))
+			vma->obj->vma_ppgtt_count--;
+		if (!hlist_unhashed(&vma->obj_hash))
+			hlist_del(&vma->obj_hash);
+	}
+
+	i915_vma_free_view_pages(vma);
 
 	if (!i915_vma_is_ggtt(vma))
 		i915_ppgtt_put(i915_vm_to_ppgtt(vma->vm));
@@ -821,6 +929,18 @@ static void __i915_vma_destroy(struct i915_vma *vma)
 	kmem_cache_free(i915->vmas, vma);
 }
 
+void i915_vma_free_view_pages(struct i915_vma *vma)
+{
+	GEM_BUG_ON(vma->pages && vma->pages == vma->view_pages);
+
+	if (!vma->view_pages)
+		return;
+
+	sg_free_table(vma->view_pages);
+	kfree(vma->view_pages);
+	vma->view_pages = NULL;
+}
+
 void i915_vma_destroy(struct i915_vma *vma)
 {
 	lockdep_assert_held(&vma->vm->i915->drm.struct_mutex);
@@ -871,6 +991,10 @@ void i915_vma_revoke_mmap(struct i915_vma *vma)
 	GEM_BUG_ON(!i915_vma_is_map_and_fenceable(vma));
 	GEM_BUG_ON(!vma->obj->userfault_count);
 
+	/* Tell any concurrent i915_gem_fault() to recheck its PTE */
+	WRITE_ONCE(vma->obj->userfault_seq, vma->obj->userfault_seq + 1);
+	smp_wmb();
+
 	vma_offset = vma->ggtt_view.partial.offset << PAGE_SHIFT;
 	unmap_mapping_range(vma->vm->i915->drm.anon_inode->i_mapping,
 			    drm_vma_node_offset_addr(node) + vma_offset,
@@ -995,6 +1119,28 @@ int i915_vma_move_to_active(struct i915_vma *vma,
 	lockdep_assert_held(&rq->i915->drm.struct_mutex);
 	GEM_BUG_ON(!drm_mm_node_allocated(&vma->node));
 
+	/* The PTEs may still be being written in the background */
+	if (unlikely(vma->bind_fence)) {
+		/*
+		 * A GGTT bind is written by the GPU, and is lost should that
+		 * request be cancelled by a reset. As nothing would then tell
+		 * our request, complete the bind here instead, redoing it
+		 * with the CPU if need be.
+		 */
+		if (i915_vma_is_ggtt(vma)) {
+			i915_ggtt_wait_bind(vma);
+		} else if (dma_fence_is_signaled(vma->bind_fence)) {
+			dma_fence_put(vma->bind_fence);
+			vma->bind_fence = NULL;
+		} else {
+			int err;
+
+			err = i915_request_await_dma_fence(rq, vma->bind_fence);
+			if (err)
+				return err;
+		}
+	}
+
 	active = active_instance(vma, rq->fence.context);
 	if (IS_ERR(active))
 		return PTR_ERR(active);
@@ -1018,6 +1164,7 @@ int i915_vma_move_to_active(struct i915_vma *vma,
 	obj->write_domain = 0;
 	if (flags & EXEC_OBJECT_WRITE) {
 		obj->write_domain = I915_GEM_DOMAIN_RENDER;
+		i915_gem_object_invalidate_cmd_cache(obj);
 
 		if (intel_fb_obj_invalidate(obj, ORIGIN_CS))
 			i915_gem_active_set(&obj->frontbuffer_write, rq);
@@ -54,12 +54,34 @@ struct i915_vma {
 	struct drm_i915_fence_reg *fence;
 	struct reservation_object *resv; /** Alias of obj->resv */
 	struct sg_table *pages;
+	/**
+	 * The page list derived for a rotated or partial view, kept across
+	 * unbinding so that rebinding is just writing the PTEs, for as long
+	 * as the object keeps the same backing store (@view_pages_gen
+	 * matches obj->mm.pages_gen).
+	 */
+	struct sg_table *view_pages;
+	unsigned long view_pages_gen;
 	void __iomem *iomap;
 	void *private; /* owned by creator */
 	u64 size;
 	u64 display_alignment;
 	struct i915_page_sizes page_sizes;
 
+	/**
+	 * Bitmap of the I915_VMA_SPARSE_CHUNK sized ranges of a sparse vma
+	 * that have been populated in the ppgtt; the rest point at scratch.
+	 */
+	unsigned long *sparse;
+#define I915_VMA_SPARSE_CHUNK SZ_2M
+
+	/**
+	 * Signaled once the PTEs written by an asynchronous bind (see
+	 * I915_VMA_ASYNC_BIND) are in place; requests using the vma must
+	 * wait upon it. A GGTT bind may fail, see i915_ggtt_wait_bind().
+	 */
+	struct dma_fence *bind_fence;
+
 	u32 fence_size;
 	u32 fence_alignment;
 
@@ -94,6 +116,8 @@ struct i915_vma {
 #define I915_VMA_USERFAULT_BIT	11
 #define I915_VMA_USERFAULT	BIT(I915_VMA_USERFAULT_BIT)
 #define I915_VMA_GGTT_WRITE	BIT(12)
+#define I915_VMA_SPARSE		BIT(13)
+#define I915_VMA_ASYNC_BIND	BIT(14)
 
 	unsigned int active_count;
 	struct rb_root active;
@@ -112,6 +136,9 @@ struct i915_vma {
 	/** This object's place on the active/inactive lists */
 	struct list_head vm_link;
 
+	/** vm->access_gen when last used, eviction prefers the oldest */
+	u64 last_access;
+
 	struct list_head obj_link; /* Link in the object's VMA list */
 	struct rb_node obj_node;
 	struct hlist_node obj_hash;
@@ -149,6 +176,7 @@ static inline bool i915_vma_is_active(struct i915_vma *vma)
 int __must_check i915_vma_move_to_active(struct i915_vma *vma,
 					 struct i915_request *rq,
 					 unsigned int flags);
+void i915_vma_move_to_inactive(struct i915_vma *vma);
 
 static inline bool i915_vma_is_ggtt(const struct i915_vma *vma)
 {
@@ -270,6 +298,7 @@ i915_vma_compare(struct i915_vma *vma,
 
 int i915_vma_bind(struct i915_vma *vma, enum i915_cache_level cache_level,
 		  u32 flags);
+int i915_vma_sparse_bind(struct i915_vma *vma, u64 offset, u64 length);
 bool i915_gem_valid_gtt_space(struct i915_vma *vma, unsigned long cache_level);
 bool i915_vma_misplaced(const struct i915_vma *vma,
 			u64 size, u64 alignment, u64 flags);
@@ -280,6 +309,7 @@ void i915_vma_unlink_ctx(struct i915_vma *vma);
 void i915_vma_close(struct i915_vma *vma);
 void i915_vma_reopen(struct i915_vma *vma);
 void i915_vma_destroy(struct i915_vma *vma);
+void i915_vma_free_view_pages(struct i915_vma *vma);
 
 int __i915_vma_do_pin(struct i915_vma *vma,
 		      u64 size, u64 alignment, u64 flags);
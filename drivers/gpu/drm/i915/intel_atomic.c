@@ -35,6 +35,76 @@
 #include <drm/drm_plane_helper.h>
 #include "intel_drv.h"
 
+/*
+ * Every commit duplicates the state of each object it touches and frees
+ * the old copies once it completes, so at high flip rates these are some
+ * of the hottest allocations in the driver. Give them their own slabs.
+ */
+static struct kmem_cache *slab_atomic_states;
+static struct kmem_cache *slab_crtc_states;
+static struct kmem_cache *slab_plane_states;
+
+/**
+ * intel_atomic_slabs_init - create the atomic state slab caches
+ *
+ * Returns: 0 on success, -ENOMEM on failure.
+ */
+int __init intel_atomic_slabs_init(void)
+{
+	slab_atomic_states = KMEM_CACHE(intel_atomic_state, SLAB_HWCACHE_ALIGN);
+	if (!slab_atomic_states)
+		goto err;
+
+	slab_crtc_states = KMEM_CACHE(intel_crtc_state, SLAB_HWCACHE_ALIGN);
+	if (!slab_crtc_states)
+		goto err_atomic;
+
+	slab_plane_states = KMEM_CACHE(intel_plane_state, SLAB_HWCACHE_ALIGN);
+	if (!slab_plane_states)
+		goto err_crtc;
+
+	return 0;
+
+err_crtc:
+	kmem_cache_destroy(slab_crtc_states);
+err_atomic:
+	kmem_cache_destroy(slab_atomic_states);
+err:
+	return -ENOMEM;
+}
+
+/**
+ * intel_atomic_slabs_fini - destroy the atomic state slab caches
+ */
+void intel_atomic_slabs_fini(void)
+{
+	kmem_cache_destroy(slab_plane_states);
+	kmem_cache_destroy(slab_crtc_states);
+	kmem_cache_destroy(slab_atomic_states);
+}
+
+struct intel_crtc_state *intel_crtc_state_alloc(void)
+{
+	return kmem_cache_zalloc(slab_crtc_states, GFP_KERNEL);
+}
+
+void intel_crtc_state_free(struct intel_crtc_state *crtc_state)
+{
+	if (crtc_state)
+		kmem_cache_free(slab_crtc_states, crtc_state);
+}
+
+struct intel_plane_state *intel_plane_state_alloc(void)
+{
+	return kmem_cache_zalloc(slab_plane_states, GFP_KERNEL);
+}
+
+void intel_plane_state_free(struct intel_plane_state *plane_state)
+{
+	if (plane_state)
+		kmem_cache_free(slab_plane_states, plane_state);
+}
+
 /**
  * intel_digital_connector_atomic_get_property - hook for connector->atomic_get_property.
  * @connector: Connector to get the property for.
@@ -169,10 +239,12 @@ intel_crtc_duplicate_state(struct drm_crtc *crtc)
 {
 	struct intel_crtc_state *crtc_state;
 
-	crtc_state = kmemdup(crtc->state, sizeof(*crtc_state), GFP_KERNEL);
+	crtc_state = kmem_cache_alloc(slab_crtc_states, GFP_KERNEL);
 	if (!crtc_state)
 		return NULL;
 
+	memcpy(crtc_state, crtc->state, sizeof(*crtc_state));
+
 	__drm_atomic_helper_crtc_duplicate_state(crtc, &crtc_state->base);
 
 	crtc_state->update_pipe = false;
@@ -182,6 +254,8 @@ intel_crtc_duplicate_state(struct drm_crtc *crtc)
 	crtc_state->update_wm_post = false;
 	crtc_state->fb_changed = false;
 	crtc_state->fifo_changed = false;
+	crtc_state->flip_only = true;
+	crtc_state->async_flip = false;
 	crtc_state->wm.need_postvbl_update = false;
 	crtc_state->fb_bits = 0;
 
@@ -200,7 +274,8 @@ void
 intel_crtc_destroy_state(struct drm_crtc *crtc,
 			 struct drm_crtc_state *state)
 {
-	drm_atomic_helper_crtc_destroy_state(crtc, state);
+	__drm_atomic_helper_crtc_destroy_state(state);
+	intel_crtc_state_free(to_intel_crtc_state(state));
 }
 
 /**
@@ -365,16 +440,31 @@ int intel_atomic_setup_scalers(struct drm_i915_private *dev_priv,
 struct drm_atomic_state *
 intel_atomic_state_alloc(struct drm_device *dev)
 {
-	struct intel_atomic_state *state = kzalloc(sizeof(*state), GFP_KERNEL);
+	struct intel_atomic_state *state;
 
-	if (!state || drm_atomic_state_init(dev, &state->base) < 0) {
-		kfree(state);
+	state = kmem_cache_zalloc(slab_atomic_states, GFP_KERNEL);
+	if (!state)
+		return NULL;
+
+	if (drm_atomic_state_init(dev, &state->base) < 0) {
+		kmem_cache_free(slab_atomic_states, state);
 		return NULL;
 	}
 
 	return &state->base;
 }
 
+void intel_atomic_state_free(struct drm_atomic_state *state)
+{
+	struct intel_atomic_state *intel_state = to_intel_atomic_state(state);
+
+	drm_atomic_state_default_release(state);
+
+	i915_sw_fence_fini(&intel_state->commit_ready);
+
+	kmem_cache_free(slab_atomic_states, intel_state);
+}
+
 void intel_atomic_state_clear(struct drm_atomic_state *s)
 {
 	struct intel_atomic_state *state = to_intel_atomic_state(s);
@@ -50,7 +50,7 @@ intel_create_plane_state(struct drm_plane *plane)
 {
 	struct intel_plane_state *state;
 
-	state = kzalloc(sizeof(*state), GFP_KERNEL);
+	state = intel_plane_state_alloc();
 	if (!state)
 		return NULL;
 
@@ -75,11 +75,12 @@ intel_plane_duplicate_state(struct drm_plane *plane)
 	struct drm_plane_state *state;
 	struct intel_plane_state *intel_state;
 
-	intel_state = kmemdup(plane->state, sizeof(*intel_state), GFP_KERNEL);
-
+	intel_state = intel_plane_state_alloc();
 	if (!intel_state)
 		return NULL;
 
+	memcpy(intel_state, plane->state, sizeof(*intel_state));
+
 	state = &intel_state->base;
 
 	__drm_atomic_helper_plane_duplicate_state(plane, state);
@@ -104,7 +105,39 @@ intel_plane_destroy_state(struct drm_plane *plane,
 {
 	WARN_ON(to_intel_plane_state(state)->vma);
 
-	drm_atomic_helper_plane_destroy_state(plane, state);
+	__drm_atomic_helper_plane_destroy_state(state);
+	intel_plane_state_free(to_intel_plane_state(state));
+}
+
+/*
+ * A plane update that only swaps the framebuffer for one with the same
+ * layout leaves everything the watermarks and the DDB allocation are
+ * derived from untouched, so the pipe can reuse its previous values.
+ */
+static bool
+intel_plane_flip_only(const struct intel_plane_state *old_plane_state,
+		      const struct intel_plane_state *new_plane_state)
+{
+	const struct drm_plane_state *old = &old_plane_state->base;
+	const struct drm_plane_state *new = &new_plane_state->base;
+
+	if (old->crtc != new->crtc || old->visible != new->visible)
+		return false;
+
+	if (!old->visible)
+		return true;
+
+	if (old->fb->format != new->fb->format ||
+	    old->fb->modifier != new->fb->modifier ||
+	    old->rotation != new->rotation)
+		return false;
+
+	if (!drm_rect_equals(&old->src, &new->src) ||
+	    !drm_rect_equals(&old->dst, &new->dst))
+		return false;
+
+	return old_plane_state->scaler_id == new_plane_state->scaler_id &&
+		old_plane_state->ckey.flags == new_plane_state->ckey.flags;
 }
 
 int intel_plane_atomic_check_with_state(const struct intel_crtc_state *old_crtc_state,
@@ -187,6 +220,9 @@ int intel_plane_atomic_check_with_state(const struct intel_crtc_state *old_crtc_
 	else
 		crtc_state->nv12_planes &= ~BIT(intel_plane->id);
 
+	if (!intel_plane_flip_only(old_plane_state, intel_state))
+		crtc_state->flip_only = false;
+
 	return intel_plane_atomic_calc_changes(old_crtc_state,
 					       &crtc_state->base,
 					       old_plane_state,
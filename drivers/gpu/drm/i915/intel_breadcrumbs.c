@@ -293,6 +293,98 @@ static void enable_fake_irq(struct intel_breadcrumbs *b)
 		mod_timer(&b->hangcheck, wait_timeout());
 }
 
+static void start_coalesce_timer(struct intel_breadcrumbs *b)
+{
+	if (hrtimer_active(&b->coalesce.timer))
+		return;
+
+	hrtimer_start(&b->coalesce.timer,
+		      ns_to_ktime(READ_ONCE(b->coalesce.window_us) *
+				  NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+}
+
+static enum hrtimer_restart intel_breadcrumbs_coalesce(struct hrtimer *hrtimer)
+{
+	struct intel_engine_cs *engine =
+		container_of(hrtimer, typeof(*engine),
+			     breadcrumbs.coalesce.timer);
+	struct intel_breadcrumbs *b = &engine->breadcrumbs;
+	unsigned long flags;
+	bool restart;
+	u32 seqno;
+
+	/*
+	 * Stand in for the interrupts we did not emit: wake the oldest
+	 * waiter if it is complete (it will then wake the next in turn),
+	 * and keep polling until the GPU has passed every breadcrumb
+	 * that was emitted without an interrupt.
+	 */
+	spin_lock_irqsave(&b->irq_lock, flags);
+	seqno = intel_engine_get_seqno(engine);
+	if (b->irq_wait && i915_seqno_passed(seqno, b->irq_wait->seqno)) {
+		b->irq_count++;
+		__intel_breadcrumbs_wakeup(b);
+	}
+	restart = b->irq_armed &&
+		  !i915_seqno_passed(seqno, READ_ONCE(b->coalesce.seqno));
+	spin_unlock_irqrestore(&b->irq_lock, flags);
+	if (!restart)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(hrtimer,
+			    ns_to_ktime(READ_ONCE(b->coalesce.window_us) *
+					NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+/**
+ * intel_engine_breadcrumb_irq - should this breadcrumb raise an interrupt?
+ * @engine: the engine executing the request
+ * @rq: the request whose breadcrumb is being emitted
+ *
+ * Called under the engine timeline lock as the breadcrumb is written at
+ * submission. With interrupt moderation enabled, we only raise an interrupt
+ * for every Nth breadcrumb, or for the first after a quiet window, or for
+ * a request whose fence has callbacks waiting to run (e.g. to submit the
+ * next request). Waiters upon the others are then woken by the coalesce
+ * timer at most a window later, or by the next interrupt.
+ *
+ * Returns true if MI_USER_INTERRUPT should be emitted.
+ */
+bool intel_engine_breadcrumb_irq(struct intel_engine_cs *engine,
+				 const struct i915_request *rq)
+{
+	struct intel_breadcrumbs *b = &engine->breadcrumbs;
+	unsigned int interval = READ_ONCE(b->coalesce.interval);
+	u64 now;
+
+	lockdep_assert_held(&engine->timeline.lock);
+
+	if (!interval)
+		return true;
+
+	if (test_bit(DMA_FENCE_FLAG_ENABLE_SIGNAL_BIT, &rq->fence.flags))
+		goto irq;
+
+	now = ktime_get_ns();
+	if (++b->coalesce.count >= interval ||
+	    now - b->coalesce.last >=
+	    (u64)READ_ONCE(b->coalesce.window_us) * NSEC_PER_USEC)
+		goto irq;
+
+	WRITE_ONCE(b->coalesce.seqno, rq->global_seqno);
+	b->coalesce.skipped++;
+	if (READ_ONCE(b->irq_armed))
+		start_coalesce_timer(b);
+	return false;
+
+irq:
+	b->coalesce.count = 0;
+	b->coalesce.last = ktime_get_ns();
+	return true;
+}
+
 static bool __intel_breadcrumbs_enable_irq(struct intel_breadcrumbs *b)
 {
 	struct intel_engine_cs *engine =
@@ -338,6 +430,13 @@ static bool __intel_breadcrumbs_enable_irq(struct intel_breadcrumbs *b)
 	}
 
 	enable_fake_irq(b);
+
+	/* Pick up any breadcrumbs already emitted without an interrupt */
+	if (READ_ONCE(b->coalesce.interval) &&
+	    !i915_seqno_passed(intel_engine_get_seqno(engine),
+			       READ_ONCE(b->coalesce.seqno)))
+		start_coalesce_timer(b);
+
 	return enabled;
 }
 
@@ -819,6 +918,10 @@ int intel_engine_init_breadcrumbs(struct intel_engine_cs *engine)
 	timer_setup(&b->fake_irq, intel_breadcrumbs_fake_irq, 0);
 	timer_setup(&b->hangcheck, intel_breadcrumbs_hangcheck, 0);
 
+	hrtimer_init(&b->coalesce.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	b->coalesce.timer.function = intel_breadcrumbs_coalesce;
+	b->coalesce.window_us = 100;
+
 	INIT_LIST_HEAD(&b->signals);
 
 	/* Spawn a thread to provide a common bottom-half for all signals.
@@ -841,6 +944,7 @@ static void cancel_fake_irq(struct intel_engine_cs *engine)
 {
 	struct intel_breadcrumbs *b = &engine->breadcrumbs;
 
+	hrtimer_cancel(&b->coalesce.timer);
 	del_timer_sync(&b->fake_irq); /* may queue b->hangcheck */
 	del_timer_sync(&b->hangcheck);
 	clear_bit(engine->id, &engine->i915->gpu_error.missed_irq_rings);
@@ -875,6 +979,9 @@ void intel_engine_reset_breadcrumbs(struct intel_engine_cs *engine)
 	 */
 	clear_bit(ENGINE_IRQ_BREADCRUMB, &engine->irq_posted);
 
+	/* Forget the breadcrumbs emitted without interrupts, now lost */
+	WRITE_ONCE(b->coalesce.seqno, intel_engine_get_seqno(engine));
+
 	spin_unlock_irqrestore(&b->irq_lock, flags);
 }
 
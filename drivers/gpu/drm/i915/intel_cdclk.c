@@ -2127,6 +2127,7 @@ void intel_set_cdclk(struct drm_i915_private *dev_priv,
 	intel_dump_cdclk_state(cdclk_state, "Changing CDCLK to");
 
 	dev_priv->display.set_cdclk(dev_priv, cdclk_state);
+	dev_priv->cdclk.changes++;
 
 	if (WARN(intel_cdclk_changed(&dev_priv->cdclk.hw, cdclk_state),
 		 "cdclk state doesn't match!\n")) {
@@ -2249,6 +2250,20 @@ static int intel_compute_min_cdclk(struct drm_atomic_state *state)
 	for_each_pipe(dev_priv, pipe)
 		min_cdclk = max(intel_state->min_cdclk[pipe], min_cdclk);
 
+	/*
+	 * Optionally keep enough headroom for the biggest expected
+	 * topology, so that lighting up another output doesn't change the
+	 * cdclk, which on most platforms means a modeset on every pipe.
+	 */
+	if (intel_state->active_crtcs && i915_modparams.min_cdclk) {
+		int floor = i915_modparams.min_cdclk < 0 ?
+			dev_priv->max_cdclk_freq :
+			min_t(int, i915_modparams.min_cdclk,
+			      dev_priv->max_cdclk_freq);
+
+		min_cdclk = max(floor, min_cdclk);
+	}
+
 	return min_cdclk;
 }
 
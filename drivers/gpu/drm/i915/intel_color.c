@@ -388,34 +388,81 @@ static void haswell_load_luts(struct drm_crtc_state *crtc_state)
 		hsw_enable_ips(intel_crtc_state);
 }
 
-static void bdw_load_degamma_lut(struct drm_crtc_state *state)
+static u32 bdw_lut_word(const struct drm_color_lut *lut, u32 i, u32 lut_size)
 {
-	struct drm_i915_private *dev_priv = to_i915(state->crtc->dev);
-	enum pipe pipe = to_intel_crtc(state->crtc)->pipe;
-	uint32_t i, lut_size = INTEL_INFO(dev_priv)->color.degamma_lut_size;
-
-	I915_WRITE(PREC_PAL_INDEX(pipe),
-		   PAL_PREC_SPLIT_MODE | PAL_PREC_AUTO_INCREMENT);
+	u32 v;
 
-	if (state->degamma_lut) {
-		struct drm_color_lut *lut = state->degamma_lut->data;
-
-		for (i = 0; i < lut_size; i++) {
-			uint32_t word =
-			drm_color_lut_extract(lut[i].red, 10) << 20 |
+	if (lut)
+		return drm_color_lut_extract(lut[i].red, 10) << 20 |
 			drm_color_lut_extract(lut[i].green, 10) << 10 |
 			drm_color_lut_extract(lut[i].blue, 10);
 
-			I915_WRITE(PREC_PAL_DATA(pipe), word);
-		}
-	} else {
-		for (i = 0; i < lut_size; i++) {
-			uint32_t v = (i * ((1 << 10) - 1)) / (lut_size - 1);
+	v = (i * ((1 << 10) - 1)) / (lut_size - 1);
+	return (v << 20) | (v << 10) | v;
+}
 
-			I915_WRITE(PREC_PAL_DATA(pipe),
-				   (v << 20) | (v << 10) | v);
+/*
+ * Write @lut (or a linear ramp) to the precision palette from index @offset.
+ * Only the runs of entries that differ from what was last written are sent,
+ * each preceded by an index write, so an incremental update of a few entries
+ * costs a few register writes instead of a thousand. The writes are issued
+ * back to back under the uncore lock rather than one locked write each.
+ */
+static void bdw_write_prec_pal(struct intel_crtc *crtc,
+			       const struct drm_color_lut *lut,
+			       u32 lut_size, u32 offset, u32 index_flags)
+{
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	enum pipe pipe = crtc->pipe;
+	u32 *shadow = crtc->lut_shadow.words;
+	bool valid = crtc->lut_shadow.valid && shadow;
+	u32 i = 0;
+
+	if (shadow)
+		shadow += offset;
+
+	spin_lock_irq(&dev_priv->uncore.lock);
+
+	while (i < lut_size) {
+		u32 word = bdw_lut_word(lut, i, lut_size);
+
+		if (valid && shadow[i] == word) {
+			i++;
+			continue;
 		}
+
+		I915_WRITE_FW(PREC_PAL_INDEX(pipe), index_flags |
+			      PAL_PREC_AUTO_INCREMENT | (offset + i));
+
+		do {
+			I915_WRITE_FW(PREC_PAL_DATA(pipe), word);
+			if (shadow)
+				shadow[i] = word;
+
+			if (++i == lut_size)
+				break;
+
+			/* Don't keep interrupts off for a whole palette */
+			if (i % 64 == 0) {
+				spin_unlock_irq(&dev_priv->uncore.lock);
+				spin_lock_irq(&dev_priv->uncore.lock);
+			}
+
+			word = bdw_lut_word(lut, i, lut_size);
+		} while (!valid || shadow[i] != word);
 	}
+
+	spin_unlock_irq(&dev_priv->uncore.lock);
+}
+
+static void bdw_load_degamma_lut(struct drm_crtc_state *state)
+{
+	struct drm_i915_private *dev_priv = to_i915(state->crtc->dev);
+	uint32_t lut_size = INTEL_INFO(dev_priv)->color.degamma_lut_size;
+
+	bdw_write_prec_pal(to_intel_crtc(state->crtc),
+			   state->degamma_lut ? state->degamma_lut->data : NULL,
+			   lut_size, 0, PAL_PREC_SPLIT_MODE);
 }
 
 static void bdw_load_gamma_lut(struct drm_crtc_state *state, u32 offset)
@@ -426,23 +473,13 @@ static void bdw_load_gamma_lut(struct drm_crtc_state *state, u32 offset)
 
 	WARN_ON(offset & ~PAL_PREC_INDEX_VALUE_MASK);
 
-	I915_WRITE(PREC_PAL_INDEX(pipe),
-		   (offset ? PAL_PREC_SPLIT_MODE : 0) |
-		   PAL_PREC_AUTO_INCREMENT |
-		   offset);
+	bdw_write_prec_pal(to_intel_crtc(state->crtc),
+			   state->gamma_lut ? state->gamma_lut->data : NULL,
+			   lut_size, offset, offset ? PAL_PREC_SPLIT_MODE : 0);
 
 	if (state->gamma_lut) {
 		struct drm_color_lut *lut = state->gamma_lut->data;
 
-		for (i = 0; i < lut_size; i++) {
-			uint32_t word =
-			(drm_color_lut_extract(lut[i].red, 10) << 20) |
-			(drm_color_lut_extract(lut[i].green, 10) << 10) |
-			drm_color_lut_extract(lut[i].blue, 10);
-
-			I915_WRITE(PREC_PAL_DATA(pipe), word);
-		}
-
 		/* Program the max register to clamp values > 1.0. */
 		i = lut_size - 1;
 		I915_WRITE(PREC_PAL_GC_MAX(pipe, 0),
@@ -452,19 +489,28 @@ static void bdw_load_gamma_lut(struct drm_crtc_state *state, u32 offset)
 		I915_WRITE(PREC_PAL_GC_MAX(pipe, 2),
 			   drm_color_lut_extract(lut[i].blue, 16));
 	} else {
-		for (i = 0; i < lut_size; i++) {
-			uint32_t v = (i * ((1 << 10) - 1)) / (lut_size - 1);
-
-			I915_WRITE(PREC_PAL_DATA(pipe),
-				   (v << 20) | (v << 10) | v);
-		}
-
 		I915_WRITE(PREC_PAL_GC_MAX(pipe, 0), (1 << 16) - 1);
 		I915_WRITE(PREC_PAL_GC_MAX(pipe, 1), (1 << 16) - 1);
 		I915_WRITE(PREC_PAL_GC_MAX(pipe, 2), (1 << 16) - 1);
 	}
 }
 
+/*
+ * The shadow is only good for the palette layout it was written in, and
+ * only once the whole palette has been written in that layout.
+ */
+static void bdw_lut_shadow_begin(struct intel_crtc *crtc, u32 gamma_mode)
+{
+	if (crtc->lut_shadow.gamma_mode != gamma_mode)
+		crtc->lut_shadow.valid = false;
+}
+
+static void bdw_lut_shadow_end(struct intel_crtc *crtc, u32 gamma_mode)
+{
+	crtc->lut_shadow.gamma_mode = gamma_mode;
+	crtc->lut_shadow.valid = true;
+}
+
 /* Loads the palette/gamma unit for the CRTC on Broadwell+. */
 static void broadwell_load_luts(struct drm_crtc_state *state)
 {
@@ -473,13 +519,16 @@ static void broadwell_load_luts(struct drm_crtc_state *state)
 	enum pipe pipe = to_intel_crtc(state->crtc)->pipe;
 
 	if (crtc_state_is_legacy_gamma(state)) {
+		to_intel_crtc(state->crtc)->lut_shadow.valid = false;
 		haswell_load_luts(state);
 		return;
 	}
 
+	bdw_lut_shadow_begin(to_intel_crtc(state->crtc), GAMMA_MODE_MODE_SPLIT);
 	bdw_load_degamma_lut(state);
 	bdw_load_gamma_lut(state,
 			   INTEL_INFO(dev_priv)->color.degamma_lut_size);
+	bdw_lut_shadow_end(to_intel_crtc(state->crtc), GAMMA_MODE_MODE_SPLIT);
 
 	intel_state->gamma_mode = GAMMA_MODE_MODE_SPLIT;
 	I915_WRITE(GAMMA_MODE(pipe), GAMMA_MODE_MODE_SPLIT);
@@ -533,11 +582,14 @@ static void glk_load_luts(struct drm_crtc_state *state)
 	glk_load_degamma_lut(state);
 
 	if (crtc_state_is_legacy_gamma(state)) {
+		to_intel_crtc(crtc)->lut_shadow.valid = false;
 		haswell_load_luts(state);
 		return;
 	}
 
+	bdw_lut_shadow_begin(to_intel_crtc(crtc), GAMMA_MODE_MODE_10BIT);
 	bdw_load_gamma_lut(state, 0);
+	bdw_lut_shadow_end(to_intel_crtc(crtc), GAMMA_MODE_MODE_10BIT);
 
 	intel_state->gamma_mode = GAMMA_MODE_MODE_10BIT;
 	I915_WRITE(GAMMA_MODE(pipe), GAMMA_MODE_MODE_10BIT);
@@ -610,6 +662,10 @@ void intel_color_load_luts(struct drm_crtc_state *crtc_state)
 	struct drm_device *dev = crtc_state->crtc->dev;
 	struct drm_i915_private *dev_priv = to_i915(dev);
 
+	/* The palette may have lost its contents while the pipe was off */
+	if (drm_atomic_crtc_needs_modeset(crtc_state))
+		to_intel_crtc(crtc_state->crtc)->lut_shadow.valid = false;
+
 	dev_priv->display.load_luts(crtc_state);
 }
 
@@ -642,6 +698,17 @@ int intel_color_check(struct drm_crtc *crtc,
 	return -EINVAL;
 }
 
+/* Without a shadow every LUT load writes the whole palette, as before */
+static void intel_color_alloc_lut_shadow(struct intel_crtc *crtc)
+{
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+
+	crtc->lut_shadow.words =
+		kcalloc(INTEL_INFO(dev_priv)->color.degamma_lut_size +
+			INTEL_INFO(dev_priv)->color.gamma_lut_size,
+			sizeof(u32), GFP_KERNEL);
+}
+
 void intel_color_init(struct drm_crtc *crtc)
 {
 	struct drm_i915_private *dev_priv = to_i915(crtc->dev);
@@ -658,9 +725,11 @@ void intel_color_init(struct drm_crtc *crtc)
 		   IS_BROXTON(dev_priv)) {
 		dev_priv->display.load_csc_matrix = ilk_load_csc_matrix;
 		dev_priv->display.load_luts = broadwell_load_luts;
+		intel_color_alloc_lut_shadow(to_intel_crtc(crtc));
 	} else if (IS_GEMINILAKE(dev_priv) || IS_CANNONLAKE(dev_priv)) {
 		dev_priv->display.load_csc_matrix = ilk_load_csc_matrix;
 		dev_priv->display.load_luts = glk_load_luts;
+		intel_color_alloc_lut_shadow(to_intel_crtc(crtc));
 	} else {
 		dev_priv->display.load_luts = i9xx_load_luts;
 	}
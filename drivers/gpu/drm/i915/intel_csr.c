@@ -406,6 +406,83 @@ static uint32_t *parse_csr_fw(struct drm_i915_private *dev_priv,
 	return memcpy(dmc_payload, &fw->data[readcount], nbytes);
 }
 
+static const char *csr_fw_path(struct drm_i915_private *dev_priv)
+{
+	if (i915_modparams.dmc_firmware_path)
+		return i915_modparams.dmc_firmware_path;
+	else if (IS_CANNONLAKE(dev_priv))
+		return I915_CSR_CNL;
+	else if (IS_GEMINILAKE(dev_priv))
+		return I915_CSR_GLK;
+	else if (IS_KABYLAKE(dev_priv) || IS_COFFEELAKE(dev_priv))
+		return I915_CSR_KBL;
+	else if (IS_SKYLAKE(dev_priv))
+		return I915_CSR_SKL;
+	else if (IS_BROXTON(dev_priv))
+		return I915_CSR_BXT;
+	else
+		return NULL;
+}
+
+static void csr_prefetch_done(const struct firmware *fw, void *context)
+{
+	struct intel_csr *csr = context;
+
+	csr->prefetch = fw;
+	complete_all(&csr->prefetch_done);
+}
+
+/**
+ * intel_csr_ucode_prefetch() - start looking up the DMC firmware
+ * @dev_priv: i915 drm device.
+ *
+ * Called early in driver load, so that the firmware lookup proceeds in
+ * parallel with the rest of init. intel_csr_ucode_init() later picks up
+ * the result, waiting for it only from its worker.
+ */
+void intel_csr_ucode_prefetch(struct drm_i915_private *dev_priv)
+{
+	struct intel_csr *csr = &dev_priv->csr;
+	const char *path;
+
+	if (!HAS_CSR(dev_priv))
+		return;
+
+	path = csr_fw_path(dev_priv);
+	if (!path)
+		return;
+
+	init_completion(&csr->prefetch_done);
+	csr->prefetch = NULL;
+
+	if (request_firmware_nowait(THIS_MODULE, true, path,
+				    &dev_priv->drm.pdev->dev, GFP_KERNEL,
+				    csr, csr_prefetch_done))
+		return;
+
+	csr->prefetching = true;
+}
+
+static const struct firmware *csr_prefetch_wait(struct intel_csr *csr)
+{
+	if (!csr->prefetching)
+		return NULL;
+
+	wait_for_completion(&csr->prefetch_done);
+	csr->prefetching = false;
+
+	return fetch_and_zero(&csr->prefetch);
+}
+
+/**
+ * intel_csr_ucode_prefetch_cancel() - release a prefetched but unused DMC
+ * @dev_priv: i915 drm device.
+ */
+void intel_csr_ucode_prefetch_cancel(struct drm_i915_private *dev_priv)
+{
+	release_firmware(csr_prefetch_wait(&dev_priv->csr));
+}
+
 static void csr_load_work_fn(struct work_struct *work)
 {
 	struct drm_i915_private *dev_priv;
@@ -415,7 +492,11 @@ static void csr_load_work_fn(struct work_struct *work)
 	dev_priv = container_of(work, typeof(*dev_priv), csr.work);
 	csr = &dev_priv->csr;
 
-	request_firmware(&fw, dev_priv->csr.fw_path, &dev_priv->drm.pdev->dev);
+	if (csr->prefetching)
+		fw = csr_prefetch_wait(csr);
+	else
+		request_firmware(&fw, dev_priv->csr.fw_path,
+				 &dev_priv->drm.pdev->dev);
 	if (fw)
 		dev_priv->csr.dmc_payload = parse_csr_fw(dev_priv, fw);
 
@@ -456,19 +537,8 @@ void intel_csr_ucode_init(struct drm_i915_private *dev_priv)
 	if (!HAS_CSR(dev_priv))
 		return;
 
-	if (i915_modparams.dmc_firmware_path)
-		csr->fw_path = i915_modparams.dmc_firmware_path;
-	else if (IS_CANNONLAKE(dev_priv))
-		csr->fw_path = I915_CSR_CNL;
-	else if (IS_GEMINILAKE(dev_priv))
-		csr->fw_path = I915_CSR_GLK;
-	else if (IS_KABYLAKE(dev_priv) || IS_COFFEELAKE(dev_priv))
-		csr->fw_path = I915_CSR_KBL;
-	else if (IS_SKYLAKE(dev_priv))
-		csr->fw_path = I915_CSR_SKL;
-	else if (IS_BROXTON(dev_priv))
-		csr->fw_path = I915_CSR_BXT;
-	else {
+	csr->fw_path = csr_fw_path(dev_priv);
+	if (!csr->fw_path) {
 		DRM_ERROR("Unexpected: no known CSR firmware for platform\n");
 		return;
 	}
@@ -10455,7 +10455,9 @@ static void intel_crtc_destroy(struct drm_crtc *crtc)
 {
 	struct intel_crtc *intel_crtc = to_intel_crtc(crtc);
 
+	intel_fifo_underrun_fini(intel_crtc);
 	drm_crtc_cleanup(crtc);
+	kfree(intel_crtc->lut_shadow.words);
 	kfree(intel_crtc);
 }
 
@@ -12291,6 +12293,136 @@ static int calc_watermark_data(struct drm_atomic_state *state)
 	return 0;
 }
 
+/*
+ * PLANE_CTL_ASYNC_FLIP is itself double buffered, latched at the vblank
+ * like the rest of PLANE_CTL. So the first flip asking to be async is
+ * done as a sync flip that only sets the bit, and the flips that follow
+ * are then truly async until one no longer asks for it.
+ */
+static void intel_atomic_setup_async_flip(struct intel_crtc_state *old_crtc_state,
+					  struct intel_crtc_state *new_crtc_state)
+{
+	new_crtc_state->async_flip_enabled =
+		new_crtc_state->base.pageflip_flags & DRM_MODE_PAGE_FLIP_ASYNC;
+	new_crtc_state->async_flip =
+		new_crtc_state->async_flip_enabled &&
+		old_crtc_state->async_flip_enabled;
+}
+
+/*
+ * Likewise, clearing PLANE_CTL_ASYNC_FLIP only takes effect at the vblank,
+ * and until then the next PLANE_SURF write would still be latched
+ * immediately. So rearm the current surface with the bit cleared and wait
+ * for it to be latched before the sync update.
+ */
+static void skl_disable_async_flip(struct intel_crtc *crtc)
+{
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	enum plane_id plane_id = PLANE_PRIMARY;
+	enum pipe pipe = crtc->pipe;
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&dev_priv->uncore.lock, irqflags);
+	I915_WRITE_FW(PLANE_CTL(pipe, plane_id),
+		      I915_READ_FW(PLANE_CTL(pipe, plane_id)) &
+		      ~PLANE_CTL_ASYNC_FLIP);
+	I915_WRITE_FW(PLANE_SURF(pipe, plane_id),
+		      I915_READ_FW(PLANE_SURF(pipe, plane_id)));
+	POSTING_READ_FW(PLANE_SURF(pipe, plane_id));
+	spin_unlock_irqrestore(&dev_priv->uncore.lock, irqflags);
+
+	intel_wait_for_vblank(dev_priv, pipe);
+}
+
+/*
+ * An async flip only latches a new PLANE_SURF, immediately and mid-scanout,
+ * so everything else about the primary plane has to stay exactly as it is
+ * and no other plane on the pipe may be updated along with it.
+ */
+static int intel_atomic_check_async(struct intel_atomic_state *state)
+{
+	struct intel_crtc_state *old_crtc_state, *new_crtc_state;
+	struct intel_plane_state *old_plane_state, *new_plane_state;
+	struct intel_crtc *crtc;
+	struct intel_plane *plane;
+	int i;
+
+	for_each_oldnew_intel_plane_in_state(state, plane, old_plane_state,
+					     new_plane_state, i) {
+		const struct drm_framebuffer *old_fb = old_plane_state->base.fb;
+		const struct drm_framebuffer *new_fb = new_plane_state->base.fb;
+
+		crtc = to_intel_crtc(new_plane_state->base.crtc ?:
+				     old_plane_state->base.crtc);
+		if (!crtc)
+			continue;
+
+		new_crtc_state = intel_atomic_get_new_crtc_state(state, crtc);
+		if (!new_crtc_state || !new_crtc_state->async_flip_enabled)
+			continue;
+
+		if (plane->id != PLANE_PRIMARY) {
+			DRM_DEBUG_KMS("[PLANE:%d:%s] async flip only supported on the primary plane\n",
+				      plane->base.base.id, plane->base.name);
+			return -EINVAL;
+		}
+
+		if (!old_plane_state->base.visible ||
+		    !new_plane_state->base.visible) {
+			DRM_DEBUG_KMS("[PLANE:%d:%s] async flip requires a visible plane\n",
+				      plane->base.base.id, plane->base.name);
+			return -EINVAL;
+		}
+
+		switch (new_fb->modifier) {
+		case I915_FORMAT_MOD_X_TILED:
+		case I915_FORMAT_MOD_Y_TILED:
+		case I915_FORMAT_MOD_Yf_TILED:
+			break;
+		default:
+			DRM_DEBUG_KMS("[PLANE:%d:%s] async flip not supported with modifier 0x%llx\n",
+				      plane->base.base.id, plane->base.name,
+				      new_fb->modifier);
+			return -EINVAL;
+		}
+
+		if (old_fb->pitches[0] != new_fb->pitches[0] ||
+		    old_plane_state->main.offset != new_plane_state->main.offset ||
+		    old_plane_state->main.x != new_plane_state->main.x ||
+		    old_plane_state->main.y != new_plane_state->main.y) {
+			DRM_DEBUG_KMS("[PLANE:%d:%s] async flip cannot change the stride or offset\n",
+				      plane->base.base.id, plane->base.name);
+			return -EINVAL;
+		}
+	}
+
+	for_each_oldnew_intel_crtc_in_state(state, crtc, old_crtc_state,
+					    new_crtc_state, i) {
+		if (!new_crtc_state->async_flip_enabled)
+			continue;
+
+		if (!new_crtc_state->base.active ||
+		    needs_modeset(&new_crtc_state->base) ||
+		    new_crtc_state->update_pipe ||
+		    new_crtc_state->base.color_mgmt_changed) {
+			DRM_DEBUG_KMS("[CRTC:%d:%s] async flip not allowed with a pipe update\n",
+				      crtc->base.base.id, crtc->base.name);
+			return -EINVAL;
+		}
+
+		/* Format, size, position and rotation must all stay put */
+		if (!new_crtc_state->flip_only ||
+		    new_crtc_state->base.plane_mask !=
+		    old_crtc_state->base.plane_mask) {
+			DRM_DEBUG_KMS("[CRTC:%d:%s] async flip can only change the framebuffer\n",
+				      crtc->base.base.id, crtc->base.name);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
 /**
  * intel_atomic_check - validate state object
  * @dev: drm device
@@ -12312,6 +12444,9 @@ static int intel_atomic_check(struct drm_device *dev,
 		if (crtc_state->mode.private_flags !=
 		    old_crtc_state->mode.private_flags)
 			crtc_state->mode_changed = true;
+
+		intel_atomic_setup_async_flip(to_intel_crtc_state(old_crtc_state),
+					      to_intel_crtc_state(crtc_state));
 	}
 
 	ret = drm_atomic_helper_check_modeset(dev, state);
@@ -12366,6 +12501,10 @@ static int intel_atomic_check(struct drm_device *dev,
 	if (ret)
 		return ret;
 
+	ret = intel_atomic_check_async(intel_state);
+	if (ret)
+		return ret;
+
 	intel_fbc_choose_crtc(dev_priv, intel_state);
 	return calc_watermark_data(state);
 }
@@ -12409,6 +12548,10 @@ static void intel_update_crtc(struct drm_crtc *crtc,
 	} else {
 		intel_pre_plane_update(to_intel_crtc_state(old_crtc_state),
 				       pipe_config);
+
+		if (to_intel_crtc_state(old_crtc_state)->async_flip_enabled &&
+		    !pipe_config->async_flip_enabled)
+			skl_disable_async_flip(intel_crtc);
 	}
 
 	if (new_plane_state)
@@ -13045,6 +13188,7 @@ intel_prepare_plane_fb(struct drm_plane *plane,
 		if (needs_modeset(crtc_state)) {
 			ret = i915_sw_fence_await_reservation(&intel_state->commit_ready,
 							      old_obj->resv, NULL,
+							      dev_priv->mm.unordered_timeline,
 							      false, 0,
 							      GFP_KERNEL);
 			if (ret < 0)
@@ -13090,6 +13234,7 @@ intel_prepare_plane_fb(struct drm_plane *plane,
 
 		ret = i915_sw_fence_await_reservation(&intel_state->commit_ready,
 						      obj->resv, NULL,
+						      dev_priv->mm.unordered_timeline,
 						      false, I915_FENCE_TIMEOUT,
 						      GFP_KERNEL);
 		if (ret < 0)
@@ -13206,6 +13351,8 @@ intel_check_primary_plane(struct intel_plane *plane,
 			return ret;
 
 		state->ctl = skl_plane_ctl(crtc_state, state);
+		if (crtc_state->async_flip_enabled)
+			state->ctl |= PLANE_CTL_ASYNC_FLIP;
 	} else {
 		ret = i9xx_check_plane_surface(state);
 		if (ret)
@@ -13786,7 +13933,7 @@ intel_primary_plane_create(struct drm_i915_private *dev_priv, enum pipe pipe)
 	return primary;
 
 fail:
-	kfree(state);
+	intel_plane_state_free(state);
 	kfree(primary);
 
 	return ERR_PTR(ret);
@@ -13863,7 +14010,7 @@ intel_cursor_plane_create(struct drm_i915_private *dev_priv,
 	return cursor;
 
 fail:
-	kfree(state);
+	intel_plane_state_free(state);
 	kfree(cursor);
 
 	return ERR_PTR(ret);
@@ -13903,7 +14050,7 @@ static int intel_crtc_init(struct drm_i915_private *dev_priv, enum pipe pipe)
 	if (!intel_crtc)
 		return -ENOMEM;
 
-	crtc_state = kzalloc(sizeof(*crtc_state), GFP_KERNEL);
+	crtc_state = intel_crtc_state_alloc();
 	if (!crtc_state) {
 		ret = -ENOMEM;
 		goto fail;
@@ -13946,6 +14093,8 @@ static int intel_crtc_init(struct drm_i915_private *dev_priv, enum pipe pipe)
 
 	intel_crtc->pipe = pipe;
 
+	intel_fifo_underrun_init(intel_crtc);
+
 	/* initialize shared scalers */
 	intel_crtc_init_scalers(intel_crtc, crtc_state);
 
@@ -13974,7 +14123,7 @@ static int intel_crtc_init(struct drm_i915_private *dev_priv, enum pipe pipe)
 	 * drm_mode_config_cleanup() will free up any
 	 * crtcs/planes already initialized.
 	 */
-	kfree(crtc_state);
+	intel_crtc_state_free(crtc_state);
 	kfree(intel_crtc);
 
 	return ret;
@@ -14332,9 +14481,31 @@ static int intel_user_framebuffer_dirty(struct drm_framebuffer *fb,
 					unsigned num_clips)
 {
 	struct drm_i915_gem_object *obj = intel_fb_obj(fb);
+	struct drm_rect damage;
+	unsigned int i;
 
 	i915_gem_object_flush_if_display(obj);
-	intel_fb_obj_flush(obj, ORIGIN_DIRTYFB);
+
+	if (!num_clips) {
+		intel_fb_obj_flush(obj, ORIGIN_DIRTYFB);
+		return 0;
+	}
+
+	/*
+	 * With DRM_MODE_FB_DIRTY_ANNOTATE_COPY the clips come in source and
+	 * destination pairs, including the sources only makes the damage
+	 * larger than strictly needed.
+	 */
+	damage.x1 = damage.y1 = INT_MAX;
+	damage.x2 = damage.y2 = INT_MIN;
+	for (i = 0; i < num_clips; i++) {
+		damage.x1 = min_t(int, damage.x1, clips[i].x1);
+		damage.y1 = min_t(int, damage.y1, clips[i].y1);
+		damage.x2 = max_t(int, damage.x2, clips[i].x2);
+		damage.y2 = max_t(int, damage.y2, clips[i].y2);
+	}
+
+	intel_fb_obj_flush_damage(obj, ORIGIN_DIRTYFB, &damage);
 
 	return 0;
 }
@@ -14623,17 +14794,6 @@ intel_user_framebuffer_create(struct drm_device *dev,
 	return fb;
 }
 
-static void intel_atomic_state_free(struct drm_atomic_state *state)
-{
-	struct intel_atomic_state *intel_state = to_intel_atomic_state(state);
-
-	drm_atomic_state_default_release(state);
-
-	i915_sw_fence_fini(&intel_state->commit_ready);
-
-	kfree(state);
-}
-
 static enum drm_mode_status
 intel_mode_valid(struct drm_device *dev,
 		 const struct drm_display_mode *mode)
@@ -15175,6 +15335,7 @@ int intel_modeset_init(struct drm_device *dev)
 	dev->mode_config.prefer_shadow = 1;
 
 	dev->mode_config.allow_fb_modifiers = true;
+	dev->mode_config.async_page_flip = INTEL_GEN(dev_priv) >= 9;
 
 	dev->mode_config.funcs = &intel_mode_funcs;
 
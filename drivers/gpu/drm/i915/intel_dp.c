@@ -2419,6 +2419,17 @@ static void edp_panel_vdd_schedule_off(struct intel_dp *intel_dp)
 {
 	unsigned long delay;
 
+	/*
+	 * With the panel already powered, forcing VDD buys nothing for the
+	 * AUX channel and turning it back on later needs no power cycle
+	 * delays, so drop it (and its AUX power domain reference) straight
+	 * away rather than keeping the display out of its DC states.
+	 */
+	if (edp_have_panel_power(intel_dp)) {
+		edp_panel_vdd_off_sync(intel_dp);
+		return;
+	}
+
 	/*
 	 * Queue the timer to fire a long time from now (relative to the power
 	 * down delay) to keep the panel power up across a sequence of
@@ -3957,29 +3968,65 @@ intel_edp_init_dpcd(struct intel_dp *intel_dp)
 }
 
 
+/*
+ * The receiver capabilities only change along with a hotplug pulse, so while
+ * HPD is trusted for the port a repeated detect (e.g. a userspace probe) can
+ * reuse what the last one read instead of redoing the AUX transactions.
+ */
+static bool intel_dp_dpcd_cache_valid(struct intel_dp *intel_dp)
+{
+	struct drm_i915_private *dev_priv = to_i915(intel_dp_to_dev(intel_dp));
+	enum hpd_pin pin = dp_to_dig_port(intel_dp)->base.hpd_pin;
+
+	if (!intel_dp->dpcd_cached)
+		return false;
+
+	/* Without HPD nobody tells us the sink went away, so re-read. */
+	if (pin == HPD_NONE ||
+	    dev_priv->hotplug.stats[pin].state != HPD_ENABLED)
+		return false;
+
+	return true;
+}
+
+static void intel_dp_dpcd_cache_invalidate(struct intel_dp *intel_dp)
+{
+	intel_dp->dpcd_cached = false;
+}
+
 static bool
 intel_dp_get_dpcd(struct intel_dp *intel_dp)
 {
-	u8 sink_count;
+	u8 sink_count[2];
+	bool cached = intel_dp_dpcd_cache_valid(intel_dp);
+	int len;
 
-	if (!intel_dp_read_dpcd(intel_dp))
-		return false;
+	if (!cached && !intel_dp_read_dpcd(intel_dp))
+		goto err;
 
 	/* Don't clobber cached eDP rates. */
-	if (!intel_dp_is_edp(intel_dp)) {
+	if (!cached && !intel_dp_is_edp(intel_dp)) {
 		intel_dp_set_sink_rates(intel_dp);
 		intel_dp_set_common_rates(intel_dp);
 	}
 
-	if (drm_dp_dpcd_readb(&intel_dp->aux, DP_SINK_COUNT, &sink_count) <= 0)
-		return false;
+	/*
+	 * DP_DEVICE_SERVICE_IRQ_VECTOR follows DP_SINK_COUNT, so fetch it in
+	 * the same transaction for the short pulse handler rather than going
+	 * back to the sink for it.
+	 */
+	len = intel_dp->dpcd[DP_DPCD_REV] >= 0x11 ? 2 : 1;
+	if (drm_dp_dpcd_read(&intel_dp->aux, DP_SINK_COUNT,
+			     sink_count, len) != len)
+		goto err;
 
 	/*
 	 * Sink count can change between short pulse hpd hence
 	 * a member variable in intel_dp will track any changes
 	 * between short pulse interrupts.
 	 */
-	intel_dp->sink_count = DP_GET_SINK_COUNT(sink_count);
+	intel_dp->sink_count = DP_GET_SINK_COUNT(sink_count[0]);
+	intel_dp->sink_irq_vector = len > 1 ? sink_count[1] : 0;
 
 	/*
 	 * SINK_COUNT == 0 and DOWNSTREAM_PORT_PRESENT == 1 implies that
@@ -3989,7 +4036,10 @@ intel_dp_get_dpcd(struct intel_dp *intel_dp)
 	 * time from performing other operations which are not required.
 	 */
 	if (!intel_dp_is_edp(intel_dp) && !intel_dp->sink_count)
-		return false;
+		goto err;
+
+	if (cached)
+		return true;
 
 	if (!drm_dp_is_branch(intel_dp->dpcd))
 		return true; /* native DP sink */
@@ -4000,9 +4050,13 @@ intel_dp_get_dpcd(struct intel_dp *intel_dp)
 	if (drm_dp_dpcd_read(&intel_dp->aux, DP_DOWNSTREAM_PORT_0,
 			     intel_dp->downstream_ports,
 			     DP_MAX_DOWNSTREAM_PORTS) < 0)
-		return false; /* downstream port status fetch failed */
+		goto err; /* downstream port status fetch failed */
 
 	return true;
+
+err:
+	intel_dp_dpcd_cache_invalidate(intel_dp);
+	return false;
 }
 
 static bool
@@ -4468,7 +4522,7 @@ static bool
 intel_dp_short_pulse(struct intel_dp *intel_dp)
 {
 	struct drm_i915_private *dev_priv = to_i915(intel_dp_to_dev(intel_dp));
-	u8 sink_irq_vector = 0;
+	u8 sink_irq_vector;
 	u8 old_sink_count = intel_dp->sink_count;
 	bool ret;
 
@@ -4491,10 +4545,9 @@ intel_dp_short_pulse(struct intel_dp *intel_dp)
 		return false;
 	}
 
-	/* Try to read the source of the interrupt */
-	if (intel_dp->dpcd[DP_DPCD_REV] >= 0x11 &&
-	    intel_dp_get_sink_irq(intel_dp, &sink_irq_vector) &&
-	    sink_irq_vector != 0) {
+	/* The source of the interrupt was read along with the sink count */
+	sink_irq_vector = intel_dp->sink_irq_vector;
+	if (sink_irq_vector != 0) {
 		/* Clear interrupt source */
 		drm_dp_dpcd_writeb(&intel_dp->aux,
 				   DP_DEVICE_SERVICE_IRQ_VECTOR,
@@ -4879,10 +4932,87 @@ bool intel_digital_port_connected(struct intel_encoder *encoder)
 		return icl_digital_port_connected(encoder);
 }
 
+/*
+ * The EDID reads get their own async domain, so that a detect waiting for
+ * them, under the connection_mutex, does not also wait for unrelated async
+ * work. A prefetched EDID is only trusted for a short while after the read.
+ */
+static ASYNC_DOMAIN(intel_dp_edid_domain);
+#define INTEL_DP_EDID_PREFETCH_TIMEOUT_MS 5000
+
+static void intel_dp_prefetch_edid(void *data, async_cookie_t cookie)
+{
+	struct intel_connector *intel_connector = data;
+	struct drm_i915_private *dev_priv = to_i915(intel_connector->base.dev);
+	struct intel_dp *intel_dp = intel_attached_dp(&intel_connector->base);
+	struct edid *edid = NULL;
+
+	intel_display_power_get(dev_priv, intel_dp->aux_power_domain);
+
+	if (intel_digital_port_connected(&dp_to_dig_port(intel_dp)->base))
+		edid = drm_get_edid(&intel_connector->base,
+				    &intel_dp->aux.ddc);
+
+	intel_display_power_put(dev_priv, intel_dp->aux_power_domain);
+
+	intel_connector->prefetch_expires =
+		jiffies + msecs_to_jiffies(INTEL_DP_EDID_PREFETCH_TIMEOUT_MS);
+	intel_connector->prefetched_edid = edid;
+}
+
+/**
+ * intel_dp_prefetch_edids - read the EDIDs of all external DP sinks
+ * @dev_priv: i915 device
+ *
+ * Detection of the connectors is serialised by the connection_mutex, yet
+ * the slow part of it, reading the EDID, is independent on each AUX
+ * channel. So at load we read all of them in parallel, in the background,
+ * for the first detect of each connector to pick up. An EDID not picked up
+ * within a few seconds, or before the next long hotplug pulse, is discarded.
+ */
+void intel_dp_prefetch_edids(struct drm_i915_private *dev_priv)
+{
+	struct drm_connector_list_iter conn_iter;
+	struct intel_connector *connector;
+
+	drm_connector_list_iter_begin(&dev_priv->drm, &conn_iter);
+	for_each_intel_connector_iter(connector, &conn_iter) {
+		if (connector->base.connector_type !=
+		    DRM_MODE_CONNECTOR_DisplayPort)
+			continue;
+
+		if (connector->mst_port)
+			continue;
+
+		async_schedule_domain(intel_dp_prefetch_edid, connector,
+				      &intel_dp_edid_domain);
+	}
+	drm_connector_list_iter_end(&conn_iter);
+}
+
+static struct edid *
+intel_dp_take_prefetched_edid(struct intel_connector *intel_connector)
+{
+	struct edid *edid;
+
+	/* Only ever waits for the EDID reads, and only until they complete */
+	async_synchronize_full_domain(&intel_dp_edid_domain);
+
+	/* Detect and the hotplug work may race to take it, only one wins */
+	edid = xchg(&intel_connector->prefetched_edid, NULL);
+	if (edid && time_after(jiffies, intel_connector->prefetch_expires)) {
+		kfree(edid);
+		edid = NULL;
+	}
+
+	return edid;
+}
+
 static struct edid *
 intel_dp_get_edid(struct intel_dp *intel_dp)
 {
 	struct intel_connector *intel_connector = intel_dp->attached_connector;
+	struct edid *edid;
 
 	/* use cached edid if we have one */
 	if (intel_connector->edid) {
@@ -4891,9 +5021,13 @@ intel_dp_get_edid(struct intel_dp *intel_dp)
 			return NULL;
 
 		return drm_edid_duplicate(intel_connector->edid);
-	} else
-		return drm_get_edid(&intel_connector->base,
-				    &intel_dp->aux.ddc);
+	}
+
+	edid = intel_dp_take_prefetched_edid(intel_connector);
+	if (edid)
+		return edid;
+
+	return drm_get_edid(&intel_connector->base, &intel_dp->aux.ddc);
 }
 
 static void
@@ -4929,11 +5063,14 @@ intel_dp_long_pulse(struct intel_connector *connector)
 	struct intel_dp *intel_dp = intel_attached_dp(&connector->base);
 	enum drm_connector_status status;
 	u8 sink_irq_vector = 0;
+	bool cached;
 
 	WARN_ON(!drm_modeset_is_locked(&dev_priv->drm.mode_config.connection_mutex));
 
 	intel_display_power_get(dev_priv, intel_dp->aux_power_domain);
 
+	cached = intel_dp_dpcd_cache_valid(intel_dp);
+
 	/* Can't disconnect eDP */
 	if (intel_dp_is_edp(intel_dp))
 		status = edp_detect(intel_dp);
@@ -4944,6 +5081,7 @@ intel_dp_long_pulse(struct intel_connector *connector)
 
 	if (status == connector_status_disconnected) {
 		memset(&intel_dp->compliance, 0, sizeof(intel_dp->compliance));
+		intel_dp_dpcd_cache_invalidate(intel_dp);
 
 		if (intel_dp->is_mst) {
 			DRM_DEBUG_KMS("MST device may have disappeared %d vs %d\n",
@@ -4967,10 +5105,14 @@ intel_dp_long_pulse(struct intel_connector *connector)
 		intel_dp->reset_link_params = false;
 	}
 
-	intel_dp_print_rates(intel_dp);
+	if (!cached) {
+		intel_dp_print_rates(intel_dp);
 
-	drm_dp_read_desc(&intel_dp->aux, &intel_dp->desc,
-			 drm_dp_is_branch(intel_dp->dpcd));
+		drm_dp_read_desc(&intel_dp->aux, &intel_dp->desc,
+				 drm_dp_is_branch(intel_dp->dpcd));
+
+		intel_dp->dpcd_cached = true;
+	}
 
 	intel_dp_configure_mst(intel_dp);
 
@@ -5139,6 +5281,7 @@ intel_dp_connector_destroy(struct drm_connector *connector)
 {
 	struct intel_connector *intel_connector = to_intel_connector(connector);
 
+	kfree(intel_dp_take_prefetched_edid(intel_connector));
 	kfree(intel_connector->detect_edid);
 
 	if (!IS_ERR_OR_NULL(intel_connector->edid))
@@ -5479,6 +5622,7 @@ void intel_dp_encoder_reset(struct drm_encoder *encoder)
 		lspcon_resume(lspcon);
 
 	intel_dp->reset_link_params = true;
+	intel_dp_dpcd_cache_invalidate(intel_dp);
 
 	pps_lock(intel_dp);
 
@@ -5541,7 +5685,16 @@ intel_dp_hpd_pulse(struct intel_digital_port *intel_dig_port, bool long_hpd)
 		      port_name(intel_dig_port->base.port),
 		      long_hpd ? "long" : "short");
 
+	/* Any pulse may come with new receiver capabilities */
+	intel_dp_dpcd_cache_invalidate(intel_dp);
+
 	if (long_hpd) {
+		struct intel_connector *connector = intel_dp->attached_connector;
+
+		/* The sink may have changed since we prefetched its EDID */
+		if (connector)
+			kfree(intel_dp_take_prefetched_edid(connector));
+
 		intel_dp->reset_link_params = true;
 		intel_dp->detect_done = false;
 		return IRQ_NONE;
@@ -92,9 +92,14 @@ intel_dp_set_link_train(struct intel_dp *intel_dp,
 
 static bool
 intel_dp_reset_link_train(struct intel_dp *intel_dp,
-			uint8_t dp_train_pat)
+			  const uint8_t *train_set,
+			  uint8_t dp_train_pat)
 {
-	memset(intel_dp->train_set, 0, sizeof(intel_dp->train_set));
+	if (train_set)
+		memcpy(intel_dp->train_set, train_set,
+		       sizeof(intel_dp->train_set));
+	else
+		memset(intel_dp->train_set, 0, sizeof(intel_dp->train_set));
 	intel_dp_set_signal_levels(intel_dp);
 	return intel_dp_set_link_train(intel_dp, dp_train_pat);
 }
@@ -124,9 +129,13 @@ static bool intel_dp_link_max_vswing_reached(struct intel_dp *intel_dp)
 	return true;
 }
 
-/* Enable corresponding port and start training pattern 1 */
+/*
+ * Enable corresponding port and start training pattern 1, starting from
+ * @train_set if given, or from the lowest drive settings otherwise.
+ */
 static bool
-intel_dp_link_training_clock_recovery(struct intel_dp *intel_dp)
+intel_dp_link_training_clock_recovery(struct intel_dp *intel_dp,
+				      const uint8_t *train_set)
 {
 	uint8_t voltage;
 	int voltage_tries, cr_tries, max_cr_tries;
@@ -164,7 +173,7 @@ intel_dp_link_training_clock_recovery(struct intel_dp *intel_dp)
 	intel_dp->DP |= DP_PORT_EN;
 
 	/* clock recovery */
-	if (!intel_dp_reset_link_train(intel_dp,
+	if (!intel_dp_reset_link_train(intel_dp, train_set,
 				       DP_TRAINING_PATTERN_1 |
 				       DP_LINK_SCRAMBLING_DISABLE)) {
 		DRM_ERROR("failed to enable link training\n");
@@ -350,16 +359,90 @@ void intel_dp_stop_link_train(struct intel_dp *intel_dp)
 				DP_TRAINING_PATTERN_DISABLE);
 }
 
+/*
+ * Identify the sink by its EDID vendor, product and serial, so that cached
+ * drive settings are never applied to a different sink on the same port.
+ * Returns 0 if the sink can't be identified.
+ */
+static u64 intel_dp_train_sink_id(struct intel_dp *intel_dp)
+{
+	struct intel_connector *intel_connector = intel_dp->attached_connector;
+	const struct edid *edid = intel_connector->detect_edid;
+
+	if (!edid && !IS_ERR_OR_NULL(intel_connector->edid))
+		edid = intel_connector->edid;
+	if (!edid)
+		return 0;
+
+	return (u64)edid->serial << 32 |
+		(u32)EDID_PRODUCT_ID(edid) << 16 |
+		edid->mfg_id[1] << 8 | edid->mfg_id[0];
+}
+
+static const uint8_t *
+intel_dp_train_cache_lookup(struct intel_dp *intel_dp, u64 sink_id)
+{
+	if (!intel_dp->train_cache.valid || !sink_id)
+		return NULL;
+
+	if (intel_dp->train_cache.sink_id != sink_id ||
+	    intel_dp->train_cache.link_rate != intel_dp->link_rate ||
+	    intel_dp->train_cache.lane_count != intel_dp->lane_count)
+		return NULL;
+
+	return intel_dp->train_cache.train_set;
+}
+
+static void
+intel_dp_train_cache_store(struct intel_dp *intel_dp, u64 sink_id)
+{
+	intel_dp->train_cache.valid = sink_id != 0;
+	intel_dp->train_cache.sink_id = sink_id;
+	intel_dp->train_cache.link_rate = intel_dp->link_rate;
+	intel_dp->train_cache.lane_count = intel_dp->lane_count;
+	memcpy(intel_dp->train_cache.train_set, intel_dp->train_set,
+	       sizeof(intel_dp->train_cache.train_set));
+}
+
 void
 intel_dp_start_link_train(struct intel_dp *intel_dp)
 {
 	struct intel_connector *intel_connector = intel_dp->attached_connector;
+	u64 sink_id = intel_dp_train_sink_id(intel_dp);
+	const uint8_t *train_set;
 
-	if (!intel_dp_link_training_clock_recovery(intel_dp))
+	/*
+	 * Retraining the same sink over the same link (modeset, resume,
+	 * DPMS) usually lands on the same drive settings, so start clock
+	 * recovery from where the last training ended. That normally passes
+	 * on the first iteration, instead of walking the sink up from the
+	 * lowest vswing/pre-emphasis one AUX round trip at a time. If the
+	 * cached settings no longer work, forget them and train from scratch
+	 * before considering a link fallback.
+	 */
+	train_set = intel_dp_train_cache_lookup(intel_dp, sink_id);
+	if (train_set) {
+		if (intel_dp_link_training_clock_recovery(intel_dp, train_set) &&
+		    intel_dp_link_training_channel_equalization(intel_dp)) {
+			intel_dp->train_cache.hits++;
+			goto success;
+		}
+
+		DRM_DEBUG_KMS("[CONNECTOR:%d:%s] Cached drive settings failed, retraining\n",
+			      intel_connector->base.base.id,
+			      intel_connector->base.name);
+		intel_dp->train_cache.valid = false;
+		intel_dp->train_cache.misses++;
+	}
+
+	if (!intel_dp_link_training_clock_recovery(intel_dp, NULL))
 		goto failure_handling;
 	if (!intel_dp_link_training_channel_equalization(intel_dp))
 		goto failure_handling;
 
+ success:
+	intel_dp_train_cache_store(intel_dp, sink_id);
+
 	DRM_DEBUG_KMS("[CONNECTOR:%d:%s] Link Training Passed at Link Rate = %d, Lane count = %d",
 		      intel_connector->base.base.id,
 		      intel_connector->base.name,
@@ -367,6 +450,8 @@ intel_dp_start_link_train(struct intel_dp *intel_dp)
 	return;
 
  failure_handling:
+	intel_dp->train_cache.valid = false;
+
 	/* Dont fallback and prune modes if its eDP */
 	if (!intel_dp_is_edp(intel_dp)) {
 		DRM_DEBUG_KMS("[CONNECTOR:%d:%s] Link Training failed at link rate = %d, lane count = %d",
@@ -26,6 +26,7 @@
 #define __INTEL_DRV_H__
 
 #include <linux/async.h>
+#include <linux/average.h>
 #include <linux/i2c.h>
 #include <linux/hdmi.h>
 #include <linux/sched/clock.h>
@@ -401,6 +402,14 @@ struct intel_connector {
 	struct edid *edid;
 	struct edid *detect_edid;
 
+	/*
+	 * EDID read in the background at load, in parallel with the other
+	 * connectors, and consumed by the first detect before it expires.
+	 * See intel_dp_prefetch_edids().
+	 */
+	struct edid *prefetched_edid;
+	unsigned long prefetch_expires;
+
 	/* since POLL and HPD connectors may use the same HPD line keep the native
 	   state of connector->polled in case hotplug storm detection changes it */
 	u8 polled;
@@ -417,6 +426,8 @@ struct intel_connector {
 	uint64_t hdcp_value; /* protected by hdcp_mutex */
 	struct delayed_work hdcp_check_work;
 	struct work_struct hdcp_prop_work;
+	struct delayed_work hdcp_auth_work;
+	unsigned int hdcp_auth_attempts; /* protected by hdcp_mutex */
 };
 
 struct intel_digital_connector_state {
@@ -726,6 +737,9 @@ struct intel_crtc_state {
 	bool update_wm_pre, update_wm_post; /* watermarks are updated */
 	bool fb_changed; /* fb on any of the planes is changed */
 	bool fifo_changed; /* FIFO split is changed */
+	bool flip_only; /* planes only changed fb, wm/ddb can be reused */
+	bool async_flip; /* primary plane flips without waiting for vblank */
+	bool async_flip_enabled; /* PLANE_CTL_ASYNC_FLIP set on the primary */
 
 	/* Pipe source size (ie. panel fitter input size)
 	 * All planes will be positioned inside this space,
@@ -897,6 +911,20 @@ struct intel_crtc_state {
 	bool ycbcr420;
 };
 
+DECLARE_EWMA(evasion, 2, 4)
+
+/* Watermark/DDB hardware state of a pipe captured after a FIFO underrun */
+struct intel_underrun_snapshot {
+	ktime_t time;
+	int cdclk;
+	bool sagv;
+	bool ipc;
+	u8 enabled_slices;
+	struct skl_ddb_entry ddb[I915_MAX_PLANES];
+	struct skl_ddb_entry uv_ddb[I915_MAX_PLANES];
+	struct skl_pipe_wm wm;
+};
+
 struct intel_crtc {
 	struct drm_crtc base;
 	enum pipe pipe;
@@ -912,6 +940,9 @@ struct intel_crtc {
 
 	struct intel_crtc_state *config;
 
+	/* event of an async flip waiting for flip done, under event_lock */
+	struct drm_pending_vblank_event *flip_done_event;
+
 	/* global reset count when the last flip was submitted */
 	unsigned int reset_count;
 
@@ -919,6 +950,25 @@ struct intel_crtc {
 	bool cpu_fifo_underrun_disabled;
 	bool pch_fifo_underrun_disabled;
 
+	/*
+	 * FIFO underrun telemetry, see intel_fifo_underrun.c. The counters
+	 * and flags are protected by dev_priv->irq_lock, like the above.
+	 */
+	struct {
+		unsigned long cpu_count;
+		unsigned long pch_count;
+		/* underruns since reporting was last enabled by the driver */
+		unsigned int cpu_burst;
+		unsigned int pch_burst;
+		ktime_t last;
+		bool cpu_rearm;
+		bool pch_rearm;
+		bool snapshot_valid;
+		struct intel_underrun_snapshot snapshot;
+		struct work_struct snapshot_work;
+		struct delayed_work rearm_work;
+	} underrun;
+
 	/* per-pipe watermark state */
 	struct {
 		/* watermarks currently being used  */
@@ -936,10 +986,32 @@ struct intel_crtc {
 		ktime_t start_vbl_time;
 		int min_vbl, max_vbl;
 		int scanline_start;
+		unsigned int budget_us;
+		unsigned int planes;
 	} debug;
 
+	/* Time spent updating the pipe under vblank evasion */
+	struct {
+		unsigned long updates;
+		unsigned long misses;
+#define I915_EVASION_HIST_BUCKETS 8 /* <8us, <16us, ... >=512us */
+		unsigned long hist[I915_EVASION_HIST_BUCKETS];
+		/* indexed by the number of planes enabled on the pipe */
+		struct ewma_evasion cost_us[I915_MAX_PLANES + 1];
+	} evasion;
+
 	/* scalers available on this crtc */
 	int num_scalers;
+
+	/*
+	 * Precision palette contents last written, so that a LUT update only
+	 * writes the entries that changed. Dropped on modeset.
+	 */
+	struct {
+		u32 *words;
+		u32 gamma_mode;
+		bool valid;
+	} lut_shadow;
 };
 
 struct intel_plane {
@@ -957,6 +1029,16 @@ struct intel_plane {
 		u32 base, cntl, size;
 	} cursor;
 
+	/*
+	 * Last skl+ watermarks computed for this plane, reused while their
+	 * inputs stay the same. Only accessed under the crtc lock.
+	 */
+	struct {
+		struct skl_wm_key key;
+		struct skl_plane_wm wm;
+		bool valid;
+	} wm_cache;
+
 	/*
 	 * NOTE: Do not place new plane state fields here (e.g., when adding
 	 * new plane properties).  New runtime state should now be placed in
@@ -1065,6 +1147,13 @@ struct intel_dp {
 	bool has_audio;
 	bool detect_done;
 	bool reset_link_params;
+	/*
+	 * dpcd, downstream_ports and desc are current and needn't be re-read
+	 * on detect, until the next hotplug pulse or resume.
+	 */
+	bool dpcd_cached;
+	/* DP_DEVICE_SERVICE_IRQ_VECTOR, read along with DP_SINK_COUNT */
+	uint8_t sink_irq_vector;
 	enum aux_ch aux_ch;
 	uint8_t dpcd[DP_RECEIVER_CAP_SIZE];
 	uint8_t psr_dpcd[EDP_PSR_RECEIVER_CAP_SIZE];
@@ -1089,6 +1178,20 @@ struct intel_dp {
 	struct drm_dp_aux aux;
 	enum intel_display_power_domain aux_power_domain;
 	uint8_t train_set[4];
+	/*
+	 * Drive settings the sink settled on at the last successful link
+	 * training, used as the starting point for the next training of
+	 * the same sink at the same link configuration.
+	 */
+	struct {
+		u64 sink_id;
+		int link_rate;
+		uint8_t lane_count;
+		uint8_t train_set[4];
+		bool valid;
+		unsigned int hits;
+		unsigned int misses;
+	} train_cache;
 	int panel_power_up_delay;
 	int panel_power_down_delay;
 	int panel_power_cycle_delay;
@@ -1353,6 +1456,8 @@ void intel_pch_fifo_underrun_irq_handler(struct drm_i915_private *dev_priv,
 					 enum pipe pch_transcoder);
 void intel_check_cpu_fifo_underruns(struct drm_i915_private *dev_priv);
 void intel_check_pch_fifo_underruns(struct drm_i915_private *dev_priv);
+void intel_fifo_underrun_init(struct intel_crtc *crtc);
+void intel_fifo_underrun_fini(struct intel_crtc *crtc);
 
 /* i915_irq.c */
 void gen5_enable_gt_irq(struct drm_i915_private *dev_priv, uint32_t mask);
@@ -1657,6 +1762,8 @@ int i9xx_check_plane_surface(struct intel_plane_state *plane_state);
 int skl_format_to_fourcc(int format, bool rgb_order, bool alpha);
 
 /* intel_csr.c */
+void intel_csr_ucode_prefetch(struct drm_i915_private *);
+void intel_csr_ucode_prefetch_cancel(struct drm_i915_private *);
 void intel_csr_ucode_init(struct drm_i915_private *);
 void intel_csr_load_program(struct drm_i915_private *);
 void intel_csr_ucode_fini(struct drm_i915_private *);
@@ -1697,6 +1804,7 @@ void intel_edp_backlight_off(const struct drm_connector_state *conn_state);
 void intel_edp_panel_vdd_on(struct intel_dp *intel_dp);
 void intel_edp_panel_on(struct intel_dp *intel_dp);
 void intel_edp_panel_off(struct intel_dp *intel_dp);
+void intel_dp_prefetch_edids(struct drm_i915_private *dev_priv);
 void intel_dp_mst_suspend(struct drm_i915_private *dev_priv);
 void intel_dp_mst_resume(struct drm_i915_private *dev_priv);
 int intel_dp_max_link_rate(struct intel_dp *intel_dp);
@@ -1823,7 +1931,8 @@ void intel_fbc_invalidate(struct drm_i915_private *dev_priv,
 			  unsigned int frontbuffer_bits,
 			  enum fb_op_origin origin);
 void intel_fbc_flush(struct drm_i915_private *dev_priv,
-		     unsigned int frontbuffer_bits, enum fb_op_origin origin);
+		     unsigned int frontbuffer_bits, unsigned int damaged_bits,
+		     enum fb_op_origin origin);
 void intel_fbc_cleanup_cfb(struct drm_i915_private *dev_priv);
 void intel_fbc_handle_fifo_underrun_irq(struct drm_i915_private *dev_priv);
 int intel_fbc_reset_underrun(struct drm_i915_private *dev_priv);
@@ -1935,6 +2044,7 @@ void intel_psr_invalidate(struct drm_i915_private *dev_priv,
 			  enum fb_op_origin origin);
 void intel_psr_flush(struct drm_i915_private *dev_priv,
 		     unsigned frontbuffer_bits,
+		     unsigned damaged_bits,
 		     enum fb_op_origin origin);
 void intel_psr_init(struct drm_i915_private *dev_priv);
 void intel_psr_compute_config(struct intel_dp *intel_dp,
@@ -1966,6 +2076,18 @@ bool intel_display_power_get_if_enabled(struct drm_i915_private *dev_priv,
 					enum intel_display_power_domain domain);
 void intel_display_power_put(struct drm_i915_private *dev_priv,
 			     enum intel_display_power_domain domain);
+#if IS_ENABLED(CONFIG_DRM_I915_DEBUG_RUNTIME_PM)
+void intel_display_power_show_holders(struct drm_i915_private *dev_priv,
+				      enum intel_display_power_domain domain,
+				      struct seq_file *m);
+#else
+static inline void
+intel_display_power_show_holders(struct drm_i915_private *dev_priv,
+				 enum intel_display_power_domain domain,
+				 struct seq_file *m)
+{
+}
+#endif
 void icl_dbuf_slices_update(struct drm_i915_private *dev_priv,
 			    u8 req_slices);
 
@@ -2058,6 +2180,9 @@ void gen6_rps_busy(struct drm_i915_private *dev_priv);
 void gen6_rps_reset_ei(struct drm_i915_private *dev_priv);
 void gen6_rps_idle(struct drm_i915_private *dev_priv);
 void gen6_rps_boost(struct i915_request *rq, struct intel_rps_client *rps);
+void intel_rps_qos_in(struct i915_request *rq);
+void intel_rps_qos_out(struct i915_request *rq);
+void intel_rps_qos_limits(struct intel_rps *rps, int *min, int *max);
 void g4x_wm_get_hw_state(struct drm_device *dev);
 void vlv_wm_get_hw_state(struct drm_device *dev);
 void ilk_wm_get_hw_state(struct drm_device *dev);
@@ -2099,6 +2224,8 @@ int intel_sprite_set_colorkey_ioctl(struct drm_device *dev, void *data,
 				    struct drm_file *file_priv);
 void intel_pipe_update_start(const struct intel_crtc_state *new_crtc_state);
 void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state);
+unsigned int intel_pipe_update_budget_us(struct intel_crtc *crtc,
+					 unsigned int planes);
 void skl_update_plane(struct intel_plane *plane,
 		      const struct intel_crtc_state *crtc_state,
 		      const struct intel_plane_state *plane_state);
@@ -2126,10 +2253,17 @@ int intel_digital_connector_atomic_check(struct drm_connector *conn,
 struct drm_connector_state *
 intel_digital_connector_duplicate_state(struct drm_connector *connector);
 
+int intel_atomic_slabs_init(void);
+void intel_atomic_slabs_fini(void);
+struct intel_crtc_state *intel_crtc_state_alloc(void);
+void intel_crtc_state_free(struct intel_crtc_state *crtc_state);
+struct intel_plane_state *intel_plane_state_alloc(void);
+void intel_plane_state_free(struct intel_plane_state *plane_state);
 struct drm_crtc_state *intel_crtc_duplicate_state(struct drm_crtc *crtc);
 void intel_crtc_destroy_state(struct drm_crtc *crtc,
 			       struct drm_crtc_state *state);
 struct drm_atomic_state *intel_atomic_state_alloc(struct drm_device *dev);
+void intel_atomic_state_free(struct drm_atomic_state *state);
 void intel_atomic_state_clear(struct drm_atomic_state *);
 
 static inline struct intel_crtc_state *
@@ -468,6 +468,7 @@ static void intel_engine_init_execlist(struct intel_engine_cs *engine)
 
 	execlists->queue_priority = INT_MIN;
 	execlists->queue = RB_ROOT_CACHED;
+	init_llist_head(&execlists->submit_queue);
 }
 
 /**
@@ -993,7 +994,8 @@ bool intel_engine_is_idle(struct intel_engine_cs *engine)
 	}
 
 	/* ELSP is empty, but there are ready requests? E.g. after reset */
-	if (!RB_EMPTY_ROOT(&engine->execlists.queue.rb_root))
+	if (!RB_EMPTY_ROOT(&engine->execlists.queue.rb_root) ||
+	    !llist_empty(&engine->execlists.submit_queue))
 		return false;
 
 	/* Ring stopped? */
@@ -1125,7 +1127,8 @@ void intel_engines_park(struct drm_i915_private *i915)
 			engine->pinned_default_state = NULL;
 		}
 
-		i915_gem_batch_pool_fini(&engine->batch_pool);
+		i915_gem_batch_pool_trim(&engine->batch_pool,
+					 I915_BATCH_POOL_HIGHWATER);
 		engine->execlists.no_priolist = false;
 	}
 }
@@ -1218,6 +1221,11 @@ static int print_sched_attr(struct drm_i915_private *i915,
 	x += snprintf(buf + x, len - x,
 		      " prio=%d", attr->priority);
 
+	if (attr->deadline)
+		x += snprintf(buf + x, len - x,
+			      " deadline=%lld",
+			      (s64)(attr->deadline - ktime_get_ns()));
+
 	return x;
 }
 
@@ -1432,6 +1440,110 @@ static void print_request_ring(struct drm_printer *m, struct i915_request *rq)
 	}
 }
 
+/**
+ * intel_engine_copy_trace - take a snapshot of the engine's trace ring
+ * @engine: the engine
+ * @dst: room for INTEL_ENGINE_TRACE_SIZE entries
+ *
+ * Copies the most recent entries of the trace ring, oldest first. As the
+ * ring is lockless, an entry being written concurrently may be torn.
+ *
+ * Returns the number of entries copied.
+ */
+unsigned int intel_engine_copy_trace(struct intel_engine_cs *engine,
+				     struct intel_engine_trace_entry *dst)
+{
+	unsigned int head = atomic_read(&engine->trace.head);
+	unsigned int count = min_t(unsigned int, head, INTEL_ENGINE_TRACE_SIZE);
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		unsigned int idx = head - count + i;
+
+		dst[i] = engine->trace.entries[idx &
+					       (INTEL_ENGINE_TRACE_SIZE - 1)];
+	}
+
+	return count;
+}
+
+void intel_engine_dump_trace(const struct intel_engine_trace_entry *entries,
+			     unsigned int count,
+			     struct drm_printer *m)
+{
+	static const char * const events[] = {
+		[INTEL_TRACE_SUBMIT] = "submit",
+		[INTEL_TRACE_IN] = "in",
+		[INTEL_TRACE_OUT] = "out",
+		[INTEL_TRACE_RETIRE] = "retire",
+	};
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		const struct intel_engine_trace_entry *e = &entries[i];
+
+		drm_printf(m, "\t%llu: %llx:%u %s\n",
+			   e->timestamp, e->context, e->seqno,
+			   e->event < ARRAY_SIZE(events) ?
+			   events[e->event] : "?");
+	}
+}
+
+void intel_engine_dump_latency(struct intel_engine_cs *engine,
+			       struct drm_printer *m)
+{
+	static const char * const stages[] = {
+		[INTEL_LATENCY_DEPS] = "deps",
+		[INTEL_LATENCY_QUEUE] = "queue",
+		[INTEL_LATENCY_ELSP] = "elsp",
+		[INTEL_LATENCY_HW] = "hw",
+	};
+	static const char * const bands[] = {
+		[INTEL_LATENCY_LOW] = "low",
+		[INTEL_LATENCY_NORMAL] = "normal",
+		[INTEL_LATENCY_HIGH] = "high",
+	};
+	unsigned int stage, band, i;
+
+	BUILD_BUG_ON(ARRAY_SIZE(stages) != INTEL_LATENCY_STAGES);
+	BUILD_BUG_ON(ARRAY_SIZE(bands) != INTEL_LATENCY_BANDS);
+
+	drm_printf(m, "%s\n", engine->name);
+	if (READ_ONCE(engine->stats.enabled)) {
+		for (band = 0; band < INTEL_LATENCY_BANDS; band++)
+			drm_printf(m, "\tbusy, %s priority: %lldns\n",
+				   bands[band],
+				   ktime_to_ns(intel_engine_get_busy_time_band(engine, band)));
+	}
+	for (stage = 0; stage < INTEL_LATENCY_STAGES; stage++) {
+		for (band = 0; band < INTEL_LATENCY_BANDS; band++) {
+			const u32 *hist = engine->latency.hist[stage][band];
+			u64 count = 0;
+
+			for (i = 0; i < INTEL_LATENCY_BUCKETS; i++)
+				count += READ_ONCE(hist[i]);
+			if (!count)
+				continue;
+
+			drm_printf(m, "\t%s, %s priority: %llu requests\n",
+				   stages[stage], bands[band], count);
+			for (i = 0; i < INTEL_LATENCY_BUCKETS; i++) {
+				u32 x = READ_ONCE(hist[i]);
+
+				if (!x)
+					continue;
+
+				if (i == INTEL_LATENCY_BUCKETS - 1)
+					drm_printf(m, "\t\t>= %lluns: %u\n",
+						   BIT_ULL(i - 1), x);
+				else
+					drm_printf(m, "\t\t< %lluns: %u\n",
+						   BIT_ULL(i), x);
+			}
+		}
+	}
+}
+
 void intel_engine_dump(struct intel_engine_cs *engine,
 		       struct drm_printer *m,
 		       const char *header, ...)
@@ -1565,6 +1677,10 @@ void intel_engine_dump(struct intel_engine_cs *engine,
 		   engine->irq_posted,
 		   yesno(test_bit(ENGINE_IRQ_BREADCRUMB,
 				  &engine->irq_posted)));
+	if (b->coalesce.interval)
+		drm_printf(m, "IRQ coalescing: every %u or %uus, %lu skipped, last without irq %x\n",
+			   b->coalesce.interval, b->coalesce.window_us,
+			   b->coalesce.skipped, b->coalesce.seqno);
 
 	drm_printf(m, "HWSP:\n");
 	hexdump(m, engine->status_page.page_addr, PAGE_SIZE);
@@ -1623,17 +1739,25 @@ int intel_enable_engine_stats(struct intel_engine_cs *engine)
 	if (engine->stats.enabled++ == 0) {
 		const struct execlist_port *port = execlists->port;
 		unsigned int num_ports = execlists_num_ports(execlists);
+		unsigned int band;
 
 		engine->stats.enabled_at = ktime_get();
 
 		/* XXX submission method oblivious? */
 		while (num_ports-- && port_isset(port)) {
 			engine->stats.active++;
+			engine->stats.band[port_request(port)->stats_band].active++;
 			port++;
 		}
 
 		if (engine->stats.active)
 			engine->stats.start = engine->stats.enabled_at;
+
+		for (band = 0; band < INTEL_LATENCY_BANDS; band++) {
+			if (engine->stats.band[band].active)
+				engine->stats.band[band].start =
+					engine->stats.enabled_at;
+		}
 	}
 
 unlock:
@@ -1658,6 +1782,20 @@ static ktime_t __intel_engine_get_busy_time(struct intel_engine_cs *engine)
 	return total;
 }
 
+static ktime_t
+__intel_engine_get_busy_time_band(struct intel_engine_cs *engine,
+				  enum intel_engine_latency_band band)
+{
+	ktime_t total = engine->stats.band[band].total;
+
+	if (engine->stats.band[band].active)
+		total = ktime_add(total,
+				  ktime_sub(ktime_get(),
+					    engine->stats.band[band].start));
+
+	return total;
+}
+
 /**
  * intel_engine_get_busy_time() - Return current accumulated engine busyness
  * @engine: engine to report on
@@ -1677,6 +1815,29 @@ ktime_t intel_engine_get_busy_time(struct intel_engine_cs *engine)
 	return total;
 }
 
+/**
+ * intel_engine_get_busy_time_band() - Return busyness for one priority band
+ * @engine: engine to report on
+ * @band: priority band of the contexts to account
+ *
+ * Returns accumulated time @engine was busy executing contexts of the given
+ * priority @band since engine stats were enabled. Like
+ * intel_engine_get_busy_time(), this never blocks the submission tasklet.
+ */
+ktime_t intel_engine_get_busy_time_band(struct intel_engine_cs *engine,
+					enum intel_engine_latency_band band)
+{
+	unsigned int seq;
+	ktime_t total;
+
+	do {
+		seq = read_seqbegin(&engine->stats.lock);
+		total = __intel_engine_get_busy_time_band(engine, band);
+	} while (read_seqretry(&engine->stats.lock, seq));
+
+	return total;
+}
+
 /**
  * intel_disable_engine_stats() - Disable engine busy tracking on engine
  * @engine: engine to disable stats collection
@@ -1693,8 +1854,16 @@ void intel_disable_engine_stats(struct intel_engine_cs *engine)
 	write_seqlock_irqsave(&engine->stats.lock, flags);
 	WARN_ON_ONCE(engine->stats.enabled == 0);
 	if (--engine->stats.enabled == 0) {
+		unsigned int band;
+
 		engine->stats.total = __intel_engine_get_busy_time(engine);
 		engine->stats.active = 0;
+
+		for (band = 0; band < INTEL_LATENCY_BANDS; band++) {
+			engine->stats.band[band].total =
+				__intel_engine_get_busy_time_band(engine, band);
+			engine->stats.band[band].active = 0;
+		}
 	}
 	write_sequnlock_irqrestore(&engine->stats.lock, flags);
 }
@@ -358,8 +358,11 @@ static bool intel_fbc_hw_is_active(struct drm_i915_private *dev_priv)
 static void intel_fbc_hw_activate(struct drm_i915_private *dev_priv)
 {
 	struct intel_fbc *fbc = &dev_priv->fbc;
+	enum pipe pipe = fbc->params.crtc.pipe;
 
 	fbc->active = true;
+	fbc->stats[pipe].activations++;
+	fbc->stats[pipe].active_since = ktime_get();
 
 	if (INTEL_GEN(dev_priv) >= 7)
 		gen7_fbc_activate(dev_priv);
@@ -374,7 +377,13 @@ static void intel_fbc_hw_activate(struct drm_i915_private *dev_priv)
 static void intel_fbc_hw_deactivate(struct drm_i915_private *dev_priv)
 {
 	struct intel_fbc *fbc = &dev_priv->fbc;
+	enum pipe pipe = fbc->params.crtc.pipe;
 
+	/* Not accounted when called to sanitize what the BIOS left on */
+	if (fbc->active)
+		fbc->stats[pipe].active_ns +=
+			ktime_to_ns(ktime_sub(ktime_get(),
+					      fbc->stats[pipe].active_since));
 	fbc->active = false;
 
 	if (INTEL_GEN(dev_priv) >= 5)
@@ -480,6 +489,42 @@ static int find_compression_threshold(struct drm_i915_private *dev_priv,
 	}
 }
 
+static void __intel_fbc_cleanup_cfb(struct drm_i915_private *dev_priv)
+{
+	struct intel_fbc *fbc = &dev_priv->fbc;
+
+	if (drm_mm_node_allocated(&fbc->compressed_fb))
+		i915_gem_stolen_remove_node(dev_priv, &fbc->compressed_fb);
+
+	if (fbc->compressed_llb) {
+		i915_gem_stolen_remove_node(dev_priv, fbc->compressed_llb);
+		kfree(fbc->compressed_llb);
+		fbc->compressed_llb = NULL;
+	}
+}
+
+static void intel_fbc_program_cfb(struct drm_i915_private *dev_priv)
+{
+	struct intel_fbc *fbc = &dev_priv->fbc;
+
+	if (INTEL_GEN(dev_priv) >= 5) {
+		I915_WRITE(ILK_DPFC_CB_BASE, fbc->compressed_fb.start);
+	} else if (IS_GM45(dev_priv)) {
+		I915_WRITE(DPFC_CB_BASE, fbc->compressed_fb.start);
+	} else {
+		GEM_BUG_ON(range_overflows_t(u64, dev_priv->dsm.start,
+					     fbc->compressed_fb.start,
+					     U32_MAX));
+		GEM_BUG_ON(range_overflows_t(u64, dev_priv->dsm.start,
+					     fbc->compressed_llb->start,
+					     U32_MAX));
+		I915_WRITE(FBC_CFB_BASE,
+			   dev_priv->dsm.start + fbc->compressed_fb.start);
+		I915_WRITE(FBC_LL_BASE,
+			   dev_priv->dsm.start + fbc->compressed_llb->start);
+	}
+}
+
 static int intel_fbc_alloc_cfb(struct intel_crtc *crtc)
 {
 	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
@@ -487,11 +532,24 @@ static int intel_fbc_alloc_cfb(struct intel_crtc *crtc)
 	struct drm_mm_node *uninitialized_var(compressed_llb);
 	int size, fb_cpp, ret;
 
-	WARN_ON(drm_mm_node_allocated(&fbc->compressed_fb));
-
 	size = intel_fbc_calculate_cfb_size(dev_priv, &fbc->state_cache);
 	fb_cpp = fbc->state_cache.fb.format->cpp[0];
 
+	/*
+	 * The CFB outlives FBC being disabled, so that moving FBC to another
+	 * pipe or re-enabling it after a modeset doesn't have to go back to
+	 * stolen memory, where by then it may only fit at a worse
+	 * compression threshold. Only grow it if the new plane doesn't fit.
+	 */
+	if (drm_mm_node_allocated(&fbc->compressed_fb)) {
+		if (size <= fbc->compressed_fb.size) {
+			fbc->threshold = 1;
+			goto program;
+		}
+
+		__intel_fbc_cleanup_cfb(dev_priv);
+	}
+
 	ret = find_compression_threshold(dev_priv, &fbc->compressed_fb,
 					 size, fb_cpp);
 	if (!ret)
@@ -503,11 +561,7 @@ static int intel_fbc_alloc_cfb(struct intel_crtc *crtc)
 
 	fbc->threshold = ret;
 
-	if (INTEL_GEN(dev_priv) >= 5)
-		I915_WRITE(ILK_DPFC_CB_BASE, fbc->compressed_fb.start);
-	else if (IS_GM45(dev_priv)) {
-		I915_WRITE(DPFC_CB_BASE, fbc->compressed_fb.start);
-	} else {
+	if (INTEL_GEN(dev_priv) <= 4 && !IS_GM45(dev_priv)) {
 		compressed_llb = kzalloc(sizeof(*compressed_llb), GFP_KERNEL);
 		if (!compressed_llb)
 			goto err_fb;
@@ -518,19 +572,11 @@ static int intel_fbc_alloc_cfb(struct intel_crtc *crtc)
 			goto err_fb;
 
 		fbc->compressed_llb = compressed_llb;
-
-		GEM_BUG_ON(range_overflows_t(u64, dev_priv->dsm.start,
-					     fbc->compressed_fb.start,
-					     U32_MAX));
-		GEM_BUG_ON(range_overflows_t(u64, dev_priv->dsm.start,
-					     fbc->compressed_llb->start,
-					     U32_MAX));
-		I915_WRITE(FBC_CFB_BASE,
-			   dev_priv->dsm.start + fbc->compressed_fb.start);
-		I915_WRITE(FBC_LL_BASE,
-			   dev_priv->dsm.start + compressed_llb->start);
 	}
 
+program:
+	intel_fbc_program_cfb(dev_priv);
+
 	DRM_DEBUG_KMS("reserved %llu bytes of contiguous stolen space for FBC, threshold: %d\n",
 		      fbc->compressed_fb.size, fbc->threshold);
 
@@ -545,19 +591,6 @@ static int intel_fbc_alloc_cfb(struct intel_crtc *crtc)
 	return -ENOSPC;
 }
 
-static void __intel_fbc_cleanup_cfb(struct drm_i915_private *dev_priv)
-{
-	struct intel_fbc *fbc = &dev_priv->fbc;
-
-	if (drm_mm_node_allocated(&fbc->compressed_fb))
-		i915_gem_stolen_remove_node(dev_priv, &fbc->compressed_fb);
-
-	if (fbc->compressed_llb) {
-		i915_gem_stolen_remove_node(dev_priv, fbc->compressed_llb);
-		kfree(fbc->compressed_llb);
-	}
-}
-
 void intel_fbc_cleanup_cfb(struct drm_i915_private *dev_priv)
 {
 	struct intel_fbc *fbc = &dev_priv->fbc;
@@ -658,6 +691,7 @@ static void intel_fbc_update_state_cache(struct intel_crtc *crtc,
 	cache->flags = 0;
 
 	cache->crtc.mode_flags = crtc_state->base.adjusted_mode.flags;
+	cache->crtc.async_flip = crtc_state->async_flip_enabled;
 	if (IS_HASWELL(dev_priv) || IS_BROADWELL(dev_priv))
 		cache->crtc.hsw_bdw_pixel_rate = crtc_state->pixel_rate;
 
@@ -710,6 +744,12 @@ static bool intel_fbc_can_activate(struct intel_crtc *crtc)
 		return false;
 	}
 
+	/* The compressor cannot follow a surface flipped mid-scanout */
+	if (cache->crtc.async_flip) {
+		fbc->no_fbc_reason = "async flip";
+		return false;
+	}
+
 	if (!intel_fbc_hw_tracking_covers_screen(crtc)) {
 		fbc->no_fbc_reason = "mode too large for compression";
 		return false;
@@ -884,7 +924,7 @@ static void __intel_fbc_disable(struct drm_i915_private *dev_priv)
 
 	DRM_DEBUG_KMS("Disabling FBC on pipe %c\n", pipe_name(crtc->pipe));
 
-	__intel_fbc_cleanup_cfb(dev_priv);
+	/* The CFB is kept for the next intel_fbc_enable(), on any pipe */
 
 	fbc->enabled = false;
 	fbc->crtc = NULL;
@@ -966,9 +1006,11 @@ void intel_fbc_invalidate(struct drm_i915_private *dev_priv,
 }
 
 void intel_fbc_flush(struct drm_i915_private *dev_priv,
-		     unsigned int frontbuffer_bits, enum fb_op_origin origin)
+		     unsigned int frontbuffer_bits, unsigned int damaged_bits,
+		     enum fb_op_origin origin)
 {
 	struct intel_fbc *fbc = &dev_priv->fbc;
+	unsigned int fbc_bit;
 
 	if (!fbc_supported(dev_priv))
 		return;
@@ -980,11 +1022,15 @@ void intel_fbc_flush(struct drm_i915_private *dev_priv,
 	if (origin == ORIGIN_GTT || origin == ORIGIN_FLIP)
 		goto out;
 
-	if (!fbc->busy_bits && fbc->enabled &&
-	    (frontbuffer_bits & intel_fbc_get_frontbuffer_bit(fbc))) {
-		if (fbc->active)
-			intel_fbc_recompress(dev_priv);
-		else if (!fbc->flip_pending)
+	fbc_bit = intel_fbc_get_frontbuffer_bit(fbc);
+	if (!fbc->busy_bits && fbc->enabled && (frontbuffer_bits & fbc_bit)) {
+		/* An undamaged plane only needs reactivating, not a nuke. */
+		if (fbc->active) {
+			if (damaged_bits & fbc_bit) {
+				intel_fbc_recompress(dev_priv);
+				fbc->stats[fbc->params.crtc.pipe].recompressions++;
+			}
+		} else if (!fbc->flip_pending)
 			__intel_fbc_post_update(fbc->crtc);
 	}
 
@@ -1010,7 +1056,8 @@ void intel_fbc_choose_crtc(struct drm_i915_private *dev_priv,
 	struct intel_fbc *fbc = &dev_priv->fbc;
 	struct intel_plane *plane;
 	struct intel_plane_state *plane_state;
-	bool crtc_chosen = false;
+	struct intel_crtc_state *best_crtc_state = NULL;
+	unsigned int best_area = 0;
 	int i;
 
 	mutex_lock(&fbc->lock);
@@ -1023,13 +1070,14 @@ void intel_fbc_choose_crtc(struct drm_i915_private *dev_priv,
 	if (!intel_fbc_can_enable(dev_priv))
 		goto out;
 
-	/* Simply choose the first CRTC that is compatible and has a visible
-	 * plane. We could go for fancier schemes such as checking the plane
-	 * size, but this would just affect the few platforms that don't tie FBC
-	 * to pipe or plane A. */
+	/*
+	 * There is a single FBC unit, so on the platforms that don't tie it
+	 * to pipe or plane A give it to the largest visible plane, where
+	 * compression saves the most memory bandwidth.
+	 */
 	for_each_new_intel_plane_in_state(state, plane, plane_state, i) {
-		struct intel_crtc_state *crtc_state;
 		struct intel_crtc *crtc = to_intel_crtc(plane_state->base.crtc);
+		unsigned int area;
 
 		if (!plane->has_fbc)
 			continue;
@@ -1037,14 +1085,18 @@ void intel_fbc_choose_crtc(struct drm_i915_private *dev_priv,
 		if (!plane_state->base.visible)
 			continue;
 
-		crtc_state = intel_atomic_get_new_crtc_state(state, crtc);
+		area = (drm_rect_width(&plane_state->base.src) >> 16) *
+		       (drm_rect_height(&plane_state->base.src) >> 16);
+		if (best_crtc_state && area <= best_area)
+			continue;
 
-		crtc_state->enable_fbc = true;
-		crtc_chosen = true;
-		break;
+		best_crtc_state = intel_atomic_get_new_crtc_state(state, crtc);
+		best_area = area;
 	}
 
-	if (!crtc_chosen)
+	if (best_crtc_state)
+		best_crtc_state->enable_fbc = true;
+	else
 		fbc->no_fbc_reason = "no suitable CRTC for FBC";
 
 out:
@@ -36,8 +36,17 @@
  * debug display issues, especially watermark settings.
  *
  * If an underrun is detected this is logged into dmesg. To avoid flooding logs
- * and occupying the cpu underrun interrupts are disabled after the first
- * occurrence until the next modeset on a given pipe.
+ * and occupying the cpu underrun interrupts are disabled after each
+ * occurrence, and re-enabled from a worker about a second later. Only the
+ * first underrun after a modeset is logged as an error, the following ones are
+ * merely counted, and after a burst of UNDERRUN_BURST_MAX underruns the
+ * interrupts stay disabled until the next modeset on the pipe.
+ *
+ * On gen9+ each reported CPU underrun also captures the DDB allocation and
+ * watermarks programmed into the hardware for the planes of the pipe, along
+ * with cdclk, SAGV and IPC state, so that the plane whose allocation fell short
+ * can be identified after the fact. The per-pipe counters and the last snapshot
+ * are exposed in debugfs.
  *
  * Note that underrun detection on gmch platforms is a bit more ugly since there
  * is no interrupt (despite that the signalling bit is in the PIPESTAT pipe
@@ -48,6 +57,9 @@
  * The code also supports underrun detection on the PCH transcoder.
  */
 
+#define UNDERRUN_REARM_MS 1000
+#define UNDERRUN_BURST_MAX 16
+
 static bool ivb_can_enable_err_int(struct drm_device *dev)
 {
 	struct drm_i915_private *dev_priv = to_i915(dev);
@@ -99,6 +111,9 @@ static void i9xx_check_fifo_underruns(struct intel_crtc *crtc)
 	I915_WRITE(reg, enable_mask | PIPE_FIFO_UNDERRUN_STATUS);
 	POSTING_READ(reg);
 
+	crtc->underrun.cpu_count++;
+	crtc->underrun.last = ktime_get();
+
 	trace_intel_cpu_fifo_underrun(dev_priv, crtc->pipe);
 	DRM_ERROR("pipe %c underrun\n", pipe_name(crtc->pipe));
 }
@@ -150,6 +165,9 @@ static void ivybridge_check_fifo_underruns(struct intel_crtc *crtc)
 	I915_WRITE(GEN7_ERR_INT, ERR_INT_FIFO_UNDERRUN(pipe));
 	POSTING_READ(GEN7_ERR_INT);
 
+	crtc->underrun.cpu_count++;
+	crtc->underrun.last = ktime_get();
+
 	trace_intel_cpu_fifo_underrun(dev_priv, pipe);
 	DRM_ERROR("fifo underrun on pipe %c\n", pipe_name(pipe));
 }
@@ -216,6 +234,9 @@ static void cpt_check_pch_fifo_underruns(struct intel_crtc *crtc)
 	I915_WRITE(SERR_INT, SERR_INT_TRANS_FIFO_UNDERRUN(pch_transcoder));
 	POSTING_READ(SERR_INT);
 
+	crtc->underrun.pch_count++;
+	crtc->underrun.last = ktime_get();
+
 	trace_intel_pch_fifo_underrun(dev_priv, pch_transcoder);
 	DRM_ERROR("pch fifo underrun on pch transcoder %c\n",
 		  pipe_name(pch_transcoder));
@@ -270,6 +291,31 @@ static bool __intel_set_cpu_fifo_underrun_reporting(struct drm_device *dev,
 	return old;
 }
 
+static bool __intel_set_pch_fifo_underrun_reporting(struct drm_i915_private *dev_priv,
+						    enum pipe pch_transcoder,
+						    bool enable)
+{
+	struct intel_crtc *crtc =
+		intel_get_crtc_for_pipe(dev_priv, pch_transcoder);
+	bool old;
+
+	lockdep_assert_held(&dev_priv->irq_lock);
+
+	old = !crtc->pch_fifo_underrun_disabled;
+	crtc->pch_fifo_underrun_disabled = !enable;
+
+	if (HAS_PCH_IBX(dev_priv))
+		ibx_set_fifo_underrun_reporting(&dev_priv->drm,
+						pch_transcoder,
+						enable);
+	else
+		cpt_set_fifo_underrun_reporting(&dev_priv->drm,
+						pch_transcoder,
+						enable, old);
+
+	return old;
+}
+
 /**
  * intel_set_cpu_fifo_underrun_reporting - set cpu fifo underrrun reporting state
  * @dev_priv: i915 device instance
@@ -284,15 +330,22 @@ static bool __intel_set_cpu_fifo_underrun_reporting(struct drm_device *dev,
  * disables for all due to shared interrupts. Actual reporting is still per-pipe
  * though.
  *
+ * This also cancels any pending re-arm after an underrun, the caller now owns
+ * the reporting state, and enabling reporting starts a new underrun burst.
+ *
  * Returns the previous state of underrun reporting.
  */
 bool intel_set_cpu_fifo_underrun_reporting(struct drm_i915_private *dev_priv,
 					   enum pipe pipe, bool enable)
 {
+	struct intel_crtc *crtc = intel_get_crtc_for_pipe(dev_priv, pipe);
 	unsigned long flags;
 	bool ret;
 
 	spin_lock_irqsave(&dev_priv->irq_lock, flags);
+	crtc->underrun.cpu_rearm = false;
+	if (enable)
+		crtc->underrun.cpu_burst = 0;
 	ret = __intel_set_cpu_fifo_underrun_reporting(&dev_priv->drm, pipe,
 						      enable);
 	spin_unlock_irqrestore(&dev_priv->irq_lock, flags);
@@ -327,27 +380,166 @@ bool intel_set_pch_fifo_underrun_reporting(struct drm_i915_private *dev_priv,
 	 * NOTE: Pre-LPT has a fixed cpu pipe -> pch transcoder mapping, but LPT
 	 * has only one pch transcoder A that all pipes can use. To avoid racy
 	 * pch transcoder -> pipe lookups from interrupt code simply store the
-	 * underrun statistics in crtc A. Since we never expose this anywhere
-	 * nor use it outside of the fifo underrun code here using the "wrong"
-	 * crtc on LPT won't cause issues.
+	 * underrun statistics in crtc A. Since we only ever expose this as
+	 * pch transcoder state, and don't use it outside of the fifo underrun
+	 * code here, using the "wrong" crtc on LPT won't cause issues.
 	 */
 
 	spin_lock_irqsave(&dev_priv->irq_lock, flags);
+	crtc->underrun.pch_rearm = false;
+	if (enable)
+		crtc->underrun.pch_burst = 0;
+	old = __intel_set_pch_fifo_underrun_reporting(dev_priv, pch_transcoder,
+						      enable);
+	spin_unlock_irqrestore(&dev_priv->irq_lock, flags);
 
-	old = !crtc->pch_fifo_underrun_disabled;
-	crtc->pch_fifo_underrun_disabled = !enable;
+	return old;
+}
 
-	if (HAS_PCH_IBX(dev_priv))
-		ibx_set_fifo_underrun_reporting(&dev_priv->drm,
-						pch_transcoder,
-						enable);
-	else
-		cpt_set_fifo_underrun_reporting(&dev_priv->drm,
-						pch_transcoder,
-						enable, old);
+static void intel_fifo_underrun_snapshot_work(struct work_struct *work)
+{
+	struct intel_crtc *crtc =
+		container_of(work, typeof(*crtc), underrun.snapshot_work);
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	enum intel_display_power_domain power_domain;
+	struct intel_underrun_snapshot *snapshot;
+	struct skl_ddb_allocation *ddb;
+	enum pipe pipe = crtc->pipe;
+	enum plane_id plane_id;
 
-	spin_unlock_irqrestore(&dev_priv->irq_lock, flags);
-	return old;
+	snapshot = kzalloc(sizeof(*snapshot), GFP_KERNEL);
+	ddb = kmalloc(sizeof(*ddb), GFP_KERNEL);
+	if (!snapshot || !ddb)
+		goto out;
+
+	power_domain = POWER_DOMAIN_PIPE(pipe);
+	if (!intel_display_power_get_if_enabled(dev_priv, power_domain))
+		goto out;
+
+	skl_pipe_wm_get_hw_state(&crtc->base, &snapshot->wm);
+	intel_display_power_put(dev_priv, power_domain);
+
+	skl_ddb_get_hw_state(dev_priv, ddb);
+	for_each_plane_id_on_crtc(crtc, plane_id) {
+		snapshot->ddb[plane_id] = ddb->plane[pipe][plane_id];
+		snapshot->uv_ddb[plane_id] = ddb->uv_plane[pipe][plane_id];
+	}
+	snapshot->enabled_slices = ddb->enabled_slices;
+	snapshot->cdclk = dev_priv->cdclk.hw.cdclk;
+	snapshot->sagv = dev_priv->sagv_status == I915_SAGV_ENABLED;
+	snapshot->ipc = dev_priv->ipc_enabled;
+
+	spin_lock_irq(&dev_priv->irq_lock);
+	snapshot->time = crtc->underrun.last;
+	crtc->underrun.snapshot = *snapshot;
+	crtc->underrun.snapshot_valid = true;
+	spin_unlock_irq(&dev_priv->irq_lock);
+
+	DRM_DEBUG_KMS("pipe %c underrun: cdclk %d kHz, SAGV %s, IPC %s, %u DBuf slices\n",
+		      pipe_name(pipe), snapshot->cdclk,
+		      enableddisabled(snapshot->sagv),
+		      enableddisabled(snapshot->ipc),
+		      snapshot->enabled_slices);
+
+	for_each_plane_id_on_crtc(crtc, plane_id) {
+		const struct skl_plane_wm *wm = &snapshot->wm.planes[plane_id];
+		const struct skl_ddb_entry *entry = &snapshot->ddb[plane_id];
+		int level = ARRAY_SIZE(wm->wm) - 1;
+
+		while (level >= 0 && !wm->wm[level].plane_en)
+			level--;
+		if (level < 0)
+			continue;
+
+		DRM_DEBUG_KMS("pipe %c plane %d: DDB %u-%u (%u blocks), WM%d %u blocks, %u lines\n",
+			      pipe_name(pipe), plane_id, entry->start,
+			      entry->end, skl_ddb_entry_size(entry), level,
+			      wm->wm[level].plane_res_b,
+			      wm->wm[level].plane_res_l);
+	}
+
+out:
+	kfree(ddb);
+	kfree(snapshot);
+}
+
+static void intel_fifo_underrun_rearm_work(struct work_struct *work)
+{
+	struct intel_crtc *crtc =
+		container_of(work, typeof(*crtc), underrun.rearm_work.work);
+	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+
+	spin_lock_irq(&dev_priv->irq_lock);
+
+	/*
+	 * Only undo our own disabling: if the modeset code took over the
+	 * reporting state in the meantime, the rearm flags have been cleared.
+	 */
+	if (intel_irqs_enabled(dev_priv)) {
+		if (crtc->underrun.cpu_rearm)
+			__intel_set_cpu_fifo_underrun_reporting(&dev_priv->drm,
+								crtc->pipe,
+								true);
+		if (crtc->underrun.pch_rearm)
+			__intel_set_pch_fifo_underrun_reporting(dev_priv,
+								crtc->pipe,
+								true);
+	}
+
+	crtc->underrun.cpu_rearm = false;
+	crtc->underrun.pch_rearm = false;
+
+	spin_unlock_irq(&dev_priv->irq_lock);
+}
+
+/**
+ * intel_fifo_underrun_init - initialize the fifo underrun telemetry of a crtc
+ * @crtc: the crtc
+ */
+void intel_fifo_underrun_init(struct intel_crtc *crtc)
+{
+	INIT_WORK(&crtc->underrun.snapshot_work,
+		  intel_fifo_underrun_snapshot_work);
+	INIT_DELAYED_WORK(&crtc->underrun.rearm_work,
+			  intel_fifo_underrun_rearm_work);
+}
+
+/**
+ * intel_fifo_underrun_fini - stop the fifo underrun workers of a crtc
+ * @crtc: the crtc
+ */
+void intel_fifo_underrun_fini(struct intel_crtc *crtc)
+{
+	cancel_work_sync(&crtc->underrun.snapshot_work);
+	cancel_delayed_work_sync(&crtc->underrun.rearm_work);
+}
+
+/*
+ * Called with the underrun reporting just disabled by the interrupt handler.
+ * Returns the number of underruns in the current burst, the first one of which
+ * is worth an error in the logs.
+ */
+static unsigned int intel_fifo_underrun_account(struct intel_crtc *crtc,
+						 bool pch)
+{
+	unsigned int burst;
+
+	crtc->underrun.last = ktime_get();
+	if (pch) {
+		crtc->underrun.pch_count++;
+		burst = ++crtc->underrun.pch_burst;
+		crtc->underrun.pch_rearm = burst < UNDERRUN_BURST_MAX;
+	} else {
+		crtc->underrun.cpu_count++;
+		burst = ++crtc->underrun.cpu_burst;
+		crtc->underrun.cpu_rearm = burst < UNDERRUN_BURST_MAX;
+	}
+
+	if (burst < UNDERRUN_BURST_MAX)
+		schedule_delayed_work(&crtc->underrun.rearm_work,
+				      msecs_to_jiffies(UNDERRUN_REARM_MS));
+
+	return burst;
 }
 
 /**
@@ -363,6 +555,7 @@ void intel_cpu_fifo_underrun_irq_handler(struct drm_i915_private *dev_priv,
 					 enum pipe pipe)
 {
 	struct intel_crtc *crtc = intel_get_crtc_for_pipe(dev_priv, pipe);
+	unsigned int burst = 0;
 
 	/* We may be called too early in init, thanks BIOS! */
 	if (crtc == NULL)
@@ -373,10 +566,22 @@ void intel_cpu_fifo_underrun_irq_handler(struct drm_i915_private *dev_priv,
 	    crtc->cpu_fifo_underrun_disabled)
 		return;
 
-	if (intel_set_cpu_fifo_underrun_reporting(dev_priv, pipe, false)) {
+	spin_lock(&dev_priv->irq_lock);
+	if (__intel_set_cpu_fifo_underrun_reporting(&dev_priv->drm, pipe, false))
+		burst = intel_fifo_underrun_account(crtc, false);
+	spin_unlock(&dev_priv->irq_lock);
+
+	if (burst) {
 		trace_intel_cpu_fifo_underrun(dev_priv, pipe);
-		DRM_ERROR("CPU pipe %c FIFO underrun\n",
-			  pipe_name(pipe));
+		if (burst == 1)
+			DRM_ERROR("CPU pipe %c FIFO underrun\n",
+				  pipe_name(pipe));
+		else
+			DRM_DEBUG_KMS("CPU pipe %c FIFO underrun (%u since modeset)\n",
+				      pipe_name(pipe), burst);
+
+		if (INTEL_GEN(dev_priv) >= 9)
+			schedule_work(&crtc->underrun.snapshot_work);
 	}
 
 	intel_fbc_handle_fifo_underrun_irq(dev_priv);
@@ -394,12 +599,26 @@ void intel_cpu_fifo_underrun_irq_handler(struct drm_i915_private *dev_priv,
 void intel_pch_fifo_underrun_irq_handler(struct drm_i915_private *dev_priv,
 					 enum pipe pch_transcoder)
 {
-	if (intel_set_pch_fifo_underrun_reporting(dev_priv, pch_transcoder,
-						  false)) {
-		trace_intel_pch_fifo_underrun(dev_priv, pch_transcoder);
+	struct intel_crtc *crtc =
+		intel_get_crtc_for_pipe(dev_priv, pch_transcoder);
+	unsigned int burst = 0;
+
+	spin_lock(&dev_priv->irq_lock);
+	if (__intel_set_pch_fifo_underrun_reporting(dev_priv, pch_transcoder,
+						    false))
+		burst = intel_fifo_underrun_account(crtc, true);
+	spin_unlock(&dev_priv->irq_lock);
+
+	if (!burst)
+		return;
+
+	trace_intel_pch_fifo_underrun(dev_priv, pch_transcoder);
+	if (burst == 1)
 		DRM_ERROR("PCH transcoder %c FIFO underrun\n",
 			  pipe_name(pch_transcoder));
-	}
+	else
+		DRM_DEBUG_KMS("PCH transcoder %c FIFO underrun (%u since modeset)\n",
+			      pipe_name(pch_transcoder), burst);
 }
 
 /**
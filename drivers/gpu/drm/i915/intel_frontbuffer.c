@@ -89,16 +89,20 @@ void __intel_fb_obj_invalidate(struct drm_i915_gem_object *obj,
  * intel_frontbuffer_flush - flush frontbuffer
  * @dev_priv: i915 device
  * @frontbuffer_bits: frontbuffer plane tracking bits
+ * @damaged_bits: subset of @frontbuffer_bits whose contents actually changed
  * @origin: which operation caused the flush
  *
  * This function gets called every time rendering on the given planes has
  * completed and frontbuffer caching can be started again. Flushes will get
  * delayed if they're blocked by some outstanding asynchronous rendering.
+ * Planes outside @damaged_bits only drop their busy tracking, they don't
+ * force a PSR exit or FBC nuke.
  *
  * Can be called without any locks held.
  */
 static void intel_frontbuffer_flush(struct drm_i915_private *dev_priv,
 				    unsigned frontbuffer_bits,
+				    unsigned damaged_bits,
 				    enum fb_op_origin origin)
 {
 	/* Delay flushing when rings are still busy.*/
@@ -109,17 +113,67 @@ static void intel_frontbuffer_flush(struct drm_i915_private *dev_priv,
 	if (!frontbuffer_bits)
 		return;
 
+	damaged_bits &= frontbuffer_bits;
+
 	might_sleep();
 	intel_edp_drrs_flush(dev_priv, frontbuffer_bits);
-	intel_psr_flush(dev_priv, frontbuffer_bits, origin);
-	intel_fbc_flush(dev_priv, frontbuffer_bits, origin);
+	intel_psr_flush(dev_priv, frontbuffer_bits, damaged_bits, origin);
+	intel_fbc_flush(dev_priv, frontbuffer_bits, damaged_bits, origin);
+}
+
+/*
+ * Drop the frontbuffer bits of the planes scanning out @obj whose visible
+ * area doesn't overlap @damage. Planes we can't reason about (rotated, or
+ * no longer showing @obj) keep their bit and get a full flush.
+ */
+static unsigned int
+intel_frontbuffer_damaged_bits(struct drm_i915_gem_object *obj,
+			       unsigned int frontbuffer_bits,
+			       const struct drm_rect *damage)
+{
+	struct drm_i915_private *dev_priv = to_i915(obj->base.dev);
+	struct intel_plane *plane;
+
+	for_each_intel_plane(&dev_priv->drm, plane) {
+		const struct drm_plane_state *state;
+		struct drm_rect clip = *damage;
+		struct drm_rect src;
+
+		if (!(frontbuffer_bits & plane->frontbuffer_bit))
+			continue;
+
+		drm_modeset_lock(&plane->base.mutex, NULL);
+		state = plane->base.state;
+
+		if (state->visible && state->fb && intel_fb_obj(state->fb) == obj &&
+		    !drm_rotation_90_or_270(state->rotation)) {
+			src.x1 = state->src.x1 >> 16;
+			src.y1 = state->src.y1 >> 16;
+			src.x2 = DIV_ROUND_UP(state->src.x2, 1 << 16);
+			src.y2 = DIV_ROUND_UP(state->src.y2, 1 << 16);
+
+			if (!drm_rect_intersect(&clip, &src))
+				frontbuffer_bits &= ~plane->frontbuffer_bit;
+		}
+
+		drm_modeset_unlock(&plane->base.mutex);
+	}
+
+	return frontbuffer_bits;
 }
 
 void __intel_fb_obj_flush(struct drm_i915_gem_object *obj,
 			  enum fb_op_origin origin,
-			  unsigned int frontbuffer_bits)
+			  unsigned int frontbuffer_bits,
+			  const struct drm_rect *damage)
 {
 	struct drm_i915_private *dev_priv = to_i915(obj->base.dev);
+	unsigned int damaged_bits = frontbuffer_bits;
+
+	if (damage)
+		damaged_bits = intel_frontbuffer_damaged_bits(obj,
+							      frontbuffer_bits,
+							      damage);
 
 	if (origin == ORIGIN_CS) {
 		spin_lock(&dev_priv->fb_tracking.lock);
@@ -130,7 +184,8 @@ void __intel_fb_obj_flush(struct drm_i915_gem_object *obj,
 	}
 
 	if (frontbuffer_bits)
-		intel_frontbuffer_flush(dev_priv, frontbuffer_bits, origin);
+		intel_frontbuffer_flush(dev_priv, frontbuffer_bits,
+					damaged_bits, origin);
 }
 
 /**
@@ -175,7 +230,7 @@ void intel_frontbuffer_flip_complete(struct drm_i915_private *dev_priv,
 	spin_unlock(&dev_priv->fb_tracking.lock);
 
 	if (frontbuffer_bits)
-		intel_frontbuffer_flush(dev_priv,
+		intel_frontbuffer_flush(dev_priv, frontbuffer_bits,
 					frontbuffer_bits, ORIGIN_FLIP);
 }
 
@@ -198,5 +253,6 @@ void intel_frontbuffer_flip(struct drm_i915_private *dev_priv,
 	dev_priv->fb_tracking.busy_bits &= ~frontbuffer_bits;
 	spin_unlock(&dev_priv->fb_tracking.lock);
 
-	intel_frontbuffer_flush(dev_priv, frontbuffer_bits, ORIGIN_FLIP);
+	intel_frontbuffer_flush(dev_priv, frontbuffer_bits,
+				frontbuffer_bits, ORIGIN_FLIP);
 }
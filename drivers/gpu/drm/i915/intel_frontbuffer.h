@@ -26,6 +26,7 @@
 
 struct drm_i915_private;
 struct drm_i915_gem_object;
+struct drm_rect;
 
 void intel_frontbuffer_flip_prepare(struct drm_i915_private *dev_priv,
 				    unsigned frontbuffer_bits);
@@ -39,7 +40,8 @@ void __intel_fb_obj_invalidate(struct drm_i915_gem_object *obj,
 			       unsigned int frontbuffer_bits);
 void __intel_fb_obj_flush(struct drm_i915_gem_object *obj,
 			  enum fb_op_origin origin,
-			  unsigned int frontbuffer_bits);
+			  unsigned int frontbuffer_bits,
+			  const struct drm_rect *damage);
 
 /**
  * intel_fb_obj_invalidate - invalidate frontbuffer object
@@ -82,7 +84,30 @@ static inline void intel_fb_obj_flush(struct drm_i915_gem_object *obj,
 	if (!frontbuffer_bits)
 		return;
 
-	__intel_fb_obj_flush(obj, origin, frontbuffer_bits);
+	__intel_fb_obj_flush(obj, origin, frontbuffer_bits, NULL);
+}
+
+/**
+ * intel_fb_obj_flush_damage - flush part of a frontbuffer object
+ * @obj: GEM object to flush
+ * @origin: which operation caused the flush
+ * @damage: the modified area, in framebuffer coordinates
+ *
+ * Like intel_fb_obj_flush(), but only the planes actually scanning out some
+ * of @damage are flushed, so that e.g. updates to an offscreen part of the
+ * framebuffer don't force PSR or FBC to drop what they have cached.
+ */
+static inline void intel_fb_obj_flush_damage(struct drm_i915_gem_object *obj,
+					     enum fb_op_origin origin,
+					     const struct drm_rect *damage)
+{
+	unsigned int frontbuffer_bits;
+
+	frontbuffer_bits = atomic_read(&obj->frontbuffer_bits);
+	if (!frontbuffer_bits)
+		return;
+
+	__intel_fb_obj_flush(obj, origin, frontbuffer_bits, damage);
 }
 
 #endif /* __INTEL_FRONTBUFFER_H__ */
@@ -551,14 +551,14 @@ int intel_guc_reset_engine(struct intel_guc *guc,
 {
 	u32 data[7];
 
-	GEM_BUG_ON(!guc->execbuf_client);
+	GEM_BUG_ON(!guc->engine_client[engine->id]);
 
 	data[0] = INTEL_GUC_ACTION_REQUEST_ENGINE_RESET;
 	data[1] = engine->guc_id;
 	data[2] = 0;
 	data[3] = 0;
 	data[4] = 0;
-	data[5] = guc->execbuf_client->stage_id;
+	data[5] = guc->engine_client[engine->id]->stage_id;
 	data[6] = intel_guc_ggtt_offset(guc, guc->shared_data);
 
 	return intel_guc_send(guc, data, ARRAY_SIZE(data));
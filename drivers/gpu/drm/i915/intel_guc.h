@@ -67,6 +67,15 @@ struct intel_guc {
 	struct intel_guc_client *execbuf_client;
 	struct intel_guc_client *preempt_client;
 
+	/*
+	 * The engines may be spread across several execbuf clients (see
+	 * i915_modparams.guc_execbuf_clients), each with its own doorbell
+	 * and work queue; execbuf_client is always the first of them.
+	 */
+	struct intel_guc_client *execbuf_clients[I915_NUM_ENGINES];
+	struct intel_guc_client *engine_client[I915_NUM_ENGINES];
+	unsigned int num_execbuf_clients;
+
 	struct guc_preempt_work preempt_work[I915_NUM_ENGINES];
 	struct workqueue_struct *preempt_wq;
 
@@ -561,6 +561,179 @@ static int intel_guc_send_ct(struct intel_guc *guc, const u32 *action, u32 len,
 	return ret;
 }
 
+/**
+ * DOC: CTB batched requests
+ *
+ * Rather than paying a full round trip to the GuC for each request, several
+ * requests may be written into the send buffer back to back and the GuC
+ * notified of them only once. The responses are then collected together,
+ * and the result of each request handed to its completion callback.
+ *
+ * Over CT, the batch holds the send mutex from intel_guc_ct_batch_begin()
+ * until intel_guc_ct_batch_end(), so the callbacks must not send to the GuC
+ * themselves. When the GuC is not using CT, each request is simply sent
+ * synchronously as it is added.
+ */
+
+struct ct_batch_request {
+	struct ct_request base;
+	struct list_head link;
+	intel_guc_ct_done_t done;
+	void *data;
+};
+
+static void ct_batch_flush(struct intel_guc_ct *ct,
+			   struct intel_guc_ct_batch *batch)
+{
+	struct ct_batch_request *rq, *rn;
+	unsigned long flags;
+
+	if (list_empty(&batch->requests))
+		return;
+
+	intel_guc_notify(ct_to_guc(ct));
+
+	list_for_each_entry_safe(rq, rn, &batch->requests, link) {
+		u32 status = ~0;
+		int err;
+
+		err = wait_for_ct_request_update(&rq->base, &status);
+		if (!err && !INTEL_GUC_MSG_IS_RESPONSE_SUCCESS(status))
+			err = -EIO;
+		if (!err)
+			err = INTEL_GUC_MSG_TO_DATA(status);
+
+		spin_lock_irqsave(&ct->lock, flags);
+		list_del(&rq->base.link);
+		spin_unlock_irqrestore(&ct->lock, flags);
+
+		if (err < 0) {
+			DRM_ERROR("CT: batched fence %u failed; err=%d status=%#X\n",
+				  rq->base.fence, err, status);
+			if (!batch->err)
+				batch->err = err;
+		}
+
+		if (rq->done)
+			rq->done(rq->data, err);
+
+		list_del(&rq->link);
+		kfree(rq);
+	}
+}
+
+/**
+ * intel_guc_ct_batch_begin - Start gathering requests for the GuC
+ * @guc: the guc
+ * @batch: the batch to initialise
+ */
+void intel_guc_ct_batch_begin(struct intel_guc *guc,
+			      struct intel_guc_ct_batch *batch)
+{
+	INIT_LIST_HEAD(&batch->requests);
+	batch->err = 0;
+
+	/* Other backends serialise each send themselves */
+	batch->ct = guc->send == intel_guc_send_ct;
+	if (batch->ct)
+		mutex_lock(&guc->send_mutex);
+}
+
+/**
+ * intel_guc_ct_batch_add - Queue a request into the batch
+ * @guc: the guc
+ * @batch: the batch started by intel_guc_ct_batch_begin()
+ * @action: the request, as for intel_guc_send()
+ * @len: length of the request in dwords
+ * @done: optional callback receiving the result of the request
+ * @data: opaque pointer passed to @done
+ *
+ * The request is written to the GuC straight away, but the GuC is only told
+ * about it by intel_guc_ct_batch_end() (or once the send buffer is full).
+ *
+ * Return: 0 if the request was queued, or a negative error code.
+ */
+int intel_guc_ct_batch_add(struct intel_guc *guc,
+			   struct intel_guc_ct_batch *batch,
+			   const u32 *action, u32 len,
+			   intel_guc_ct_done_t done, void *data)
+{
+	struct intel_guc_ct *ct = &guc->ct;
+	struct intel_guc_ct_channel *ctch = &ct->host_channel;
+	struct ct_batch_request *rq;
+	unsigned long flags;
+	int err;
+
+	if (!batch->ct) {
+		err = guc->send(guc, action, len, NULL, 0);
+		if (err < 0 && !batch->err)
+			batch->err = err;
+		if (done)
+			done(data, err);
+		return 0;
+	}
+
+	lockdep_assert_held(&guc->send_mutex);
+	GEM_BUG_ON(!ctch_is_open(ctch));
+	GEM_BUG_ON(!len);
+	GEM_BUG_ON(len & ~GUC_CT_MSG_LEN_MASK);
+
+	rq = kmalloc(sizeof(*rq), GFP_KERNEL);
+	if (!rq)
+		return -ENOMEM;
+
+	rq->base.fence = ctch_get_next_fence(ctch);
+	rq->base.status = 0;
+	rq->base.response_len = 0;
+	rq->base.response_buf = NULL;
+	rq->done = done;
+	rq->data = data;
+
+	spin_lock_irqsave(&ct->lock, flags);
+	list_add_tail(&rq->base.link, &ct->pending_requests);
+	spin_unlock_irqrestore(&ct->lock, flags);
+
+	/* Ask for a status response, so each request reports individually */
+	err = ctb_write(&ctch->ctbs[CTB_SEND], action, len, rq->base.fence, true);
+	if (err == -ENOSPC) {
+		/* Drain what we have already queued and try again */
+		ct_batch_flush(ct, batch);
+		err = ctb_write(&ctch->ctbs[CTB_SEND],
+				action, len, rq->base.fence, true);
+	}
+	if (unlikely(err)) {
+		spin_lock_irqsave(&ct->lock, flags);
+		list_del(&rq->base.link);
+		spin_unlock_irqrestore(&ct->lock, flags);
+		kfree(rq);
+		return err;
+	}
+
+	list_add_tail(&rq->link, &batch->requests);
+	return 0;
+}
+
+/**
+ * intel_guc_ct_batch_end - Submit the batch and collect its responses
+ * @guc: the guc
+ * @batch: the batch started by intel_guc_ct_batch_begin()
+ *
+ * Notifies the GuC once for all the queued requests, waits for each one to
+ * be answered and reports the result to its callback.
+ *
+ * Return: 0 if all requests succeeded, or the first error encountered.
+ */
+int intel_guc_ct_batch_end(struct intel_guc *guc,
+			   struct intel_guc_ct_batch *batch)
+{
+	if (batch->ct) {
+		ct_batch_flush(&guc->ct, batch);
+		mutex_unlock(&guc->send_mutex);
+	}
+
+	return batch->err;
+}
+
 static inline unsigned int ct_header_get_len(u32 header)
 {
 	return (header >> GUC_CT_MSG_LEN_SHIFT) & GUC_CT_MSG_LEN_MASK;
@@ -89,8 +89,31 @@ struct intel_guc_ct {
 	struct work_struct worker;
 };
 
+typedef void (*intel_guc_ct_done_t)(void *data, int result);
+
+/** Gathers several requests to be sent with a single GuC notification.
+ *
+ * @requests: requests written to the CTB, awaiting their response
+ * @err: first error reported for any request in the batch
+ * @ct: whether the requests are sent over CT, or one at a time
+ */
+struct intel_guc_ct_batch {
+	struct list_head requests;
+	int err;
+	bool ct;
+};
+
 void intel_guc_ct_init_early(struct intel_guc_ct *ct);
 int intel_guc_ct_enable(struct intel_guc_ct *ct);
 void intel_guc_ct_disable(struct intel_guc_ct *ct);
 
+void intel_guc_ct_batch_begin(struct intel_guc *guc,
+			      struct intel_guc_ct_batch *batch);
+int intel_guc_ct_batch_add(struct intel_guc *guc,
+			   struct intel_guc_ct_batch *batch,
+			   const u32 *action, u32 len,
+			   intel_guc_ct_done_t done, void *data);
+int intel_guc_ct_batch_end(struct intel_guc *guc,
+			   struct intel_guc_ct_batch *batch);
+
 #endif /* _INTEL_GUC_CT_H_ */
@@ -227,9 +227,29 @@ static unsigned int guc_get_log_buffer_size(enum guc_log_buffer_type type)
 	return 0;
 }
 
+/*
+ * Copy [start, end) of a log section out of the WC mapping. Both the GuC
+ * buffer and the relay sub-buffer are page aligned, and the sections are
+ * page sized, so widening the range to whole cachelines keeps the copy on
+ * the movntdqa path without ever straying outside of the section. Should
+ * that not be available, fall back to a plain (and slow) uncached read
+ * rather than losing the data.
+ */
+static void guc_copy_log_section(void *dst, const void *src,
+				 unsigned int start, unsigned int end)
+{
+	start = round_down(start, 64);
+	end = round_up(end, 64);
+	if (start >= end)
+		return;
+
+	if (!i915_memcpy_from_wc(dst + start, src + start, end - start))
+		memcpy(dst + start, src + start, end - start);
+}
+
 static void guc_read_update_log_buffer(struct intel_guc_log *log)
 {
-	unsigned int buffer_size, read_offset, write_offset, bytes_to_copy, full_cnt;
+	unsigned int buffer_size, read_offset, write_offset, full_cnt;
 	struct guc_log_buffer_state *log_buf_state, *log_buf_snapshot_state;
 	struct guc_log_buffer_state log_buf_state_local;
 	enum guc_log_buffer_type type;
@@ -312,13 +332,14 @@ static void guc_read_update_log_buffer(struct intel_guc_log *log)
 
 		/* Just copy the newly written data */
 		if (read_offset > write_offset) {
-			i915_memcpy_from_wc(dst_data, src_data, write_offset);
-			bytes_to_copy = buffer_size - read_offset;
+			guc_copy_log_section(dst_data, src_data,
+					     0, write_offset);
+			guc_copy_log_section(dst_data, src_data,
+					     read_offset, buffer_size);
 		} else {
-			bytes_to_copy = write_offset - read_offset;
+			guc_copy_log_section(dst_data, src_data,
+					     read_offset, write_offset);
 		}
-		i915_memcpy_from_wc(dst_data + read_offset,
-				    src_data + read_offset, bytes_to_copy);
 
 		src_data += buffer_size;
 		dst_data += buffer_size;
@@ -38,10 +38,11 @@
  * DOC: GuC-based command submission
  *
  * GuC client:
- * A intel_guc_client refers to a submission path through GuC. Currently, there
- * are two clients. One of them (the execbuf_client) is charged with all
- * submissions to the GuC, the other one (preempt_client) is responsible for
- * preempting the execbuf_client. This struct is the owner of a doorbell, a
+ * A intel_guc_client refers to a submission path through GuC. The execbuf
+ * clients are charged with all submissions to the GuC, each engine belonging
+ * to exactly one of them (by default there is a single execbuf_client for all
+ * engines, see i915.guc_execbuf_clients), and the preempt_client is
+ * responsible for preempting them. This struct is the owner of a doorbell, a
  * process descriptor and a workqueue (all of them inside a single gem object
  * that contains all required pages for these elements).
  *
@@ -219,28 +220,6 @@ static void __destroy_doorbell(struct intel_guc_client *client)
 		WARN_ONCE(true, "Doorbell never became invalid after disable\n");
 }
 
-static int create_doorbell(struct intel_guc_client *client)
-{
-	int ret;
-
-	if (WARN_ON(!has_doorbell(client)))
-		return -ENODEV; /* internal setup error, should never happen */
-
-	__update_doorbell_desc(client, client->doorbell_id);
-	__create_doorbell(client);
-
-	ret = __guc_allocate_doorbell(client->guc, client->stage_id);
-	if (ret) {
-		__destroy_doorbell(client);
-		__update_doorbell_desc(client, GUC_DOORBELL_INVALID);
-		DRM_DEBUG_DRIVER("Couldn't create client %u doorbell: %d\n",
-				 client->stage_id, ret);
-		return ret;
-	}
-
-	return 0;
-}
-
 static int destroy_doorbell(struct intel_guc_client *client)
 {
 	int ret;
@@ -510,8 +489,8 @@ static void guc_ring_doorbell(struct intel_guc_client *client)
 
 static void guc_add_request(struct intel_guc *guc, struct i915_request *rq)
 {
-	struct intel_guc_client *client = guc->execbuf_client;
 	struct intel_engine_cs *engine = rq->engine;
+	struct intel_guc_client *client = guc->engine_client[engine->id];
 	u32 ctx_desc = lower_32_bits(rq->hw_context->lrc_desc);
 	u32 ring_tail = intel_ring_set_tail(rq->ring, rq->tail) / sizeof(u64);
 
@@ -582,8 +561,8 @@ static void inject_preempt_context(struct work_struct *work)
 	data[2] = INTEL_GUC_PREEMPT_OPTION_DROP_WORK_Q |
 		  INTEL_GUC_PREEMPT_OPTION_DROP_SUBMIT_Q;
 	data[3] = engine->guc_id;
-	data[4] = guc->execbuf_client->priority;
-	data[5] = guc->execbuf_client->stage_id;
+	data[4] = guc->engine_client[engine->id]->priority;
+	data[5] = guc->engine_client[engine->id]->stage_id;
 	data[6] = intel_guc_ggtt_offset(guc, guc->shared_data);
 
 	if (WARN_ON(intel_guc_send(guc, data, ARRAY_SIZE(data)))) {
@@ -695,6 +674,8 @@ static bool __guc_dequeue(struct intel_engine_cs *engine)
 
 	lockdep_assert_held(&engine->timeline.lock);
 
+	execlists_flush_submit_queue(execlists);
+
 	if (port_isset(port)) {
 		if (intel_engine_has_preemption(engine)) {
 			struct guc_preempt_work *preempt_work =
@@ -810,6 +791,32 @@ static void guc_submission_tasklet(unsigned long data)
 		guc_dequeue(engine);
 }
 
+static void guc_submit_request(struct i915_request *rq)
+{
+	struct intel_engine_execlists * const execlists = &rq->engine->execlists;
+	struct tasklet_struct * const t = &execlists->tasklet;
+
+	/* Will be called from irq-context when using foreign fences. */
+	if (!llist_add(&rq->submit_link, &execlists->submit_queue))
+		return; /* the tasklet has already been kicked */
+
+	/*
+	 * Rather than bounce through the softirq, submit to the GuC work
+	 * queue directly from the caller if nobody else is currently running
+	 * the tasklet; holding the tasklet lock gives us the same exclusive
+	 * access to the ports as the tasklet itself. A disabled tasklet means
+	 * a reset is in progress, and the queue will be replayed once it
+	 * is re-enabled in execlists_reset_finish().
+	 */
+	if (tasklet_trylock(t)) {
+		if (__tasklet_is_enabled(t))
+			guc_submission_tasklet((unsigned long)rq->engine);
+		tasklet_unlock(t);
+	} else if (__tasklet_is_enabled(t)) {
+		tasklet_hi_schedule(t);
+	}
+}
+
 static struct i915_request *
 guc_reset_prepare(struct intel_engine_cs *engine)
 {
@@ -879,27 +886,89 @@ static bool guc_verify_doorbells(struct intel_guc *guc)
 	return true;
 }
 
+struct doorbell_request {
+	struct intel_guc_client *client;
+	int result;
+};
+
+static void doorbell_allocated(void *data, int result)
+{
+	struct doorbell_request *req = data;
+	struct intel_guc_client *client = req->client;
+
+	req->result = result;
+	if (result < 0) {
+		__destroy_doorbell(client);
+		__update_doorbell_desc(client, GUC_DOORBELL_INVALID);
+		DRM_DEBUG_DRIVER("Couldn't create client %u doorbell: %d\n",
+				 client->stage_id, result);
+	}
+}
+
 static int guc_clients_doorbell_init(struct intel_guc *guc)
 {
-	int ret;
+	struct intel_guc_ct_batch batch;
+	struct doorbell_request *reqs;
+	unsigned int count, n;
+	int ret, err;
+
+	count = guc->num_execbuf_clients + !!guc->preempt_client;
+	reqs = kcalloc(count, sizeof(*reqs), GFP_KERNEL);
+	if (!reqs)
+		return -ENOMEM;
+
+	for (n = 0; n < count; n++)
+		reqs[n].result = -EINPROGRESS;
+	for (n = 0; n < guc->num_execbuf_clients; n++)
+		reqs[n].client = guc->execbuf_clients[n];
+	if (guc->preempt_client)
+		reqs[n].client = guc->preempt_client;
+
+	/* Allocate all the doorbells with a single notification of the GuC */
+	ret = 0;
+	intel_guc_ct_batch_begin(guc, &batch);
+	for (n = 0; n < count; n++) {
+		struct intel_guc_client *client = reqs[n].client;
+		u32 action[] = {
+			INTEL_GUC_ACTION_ALLOCATE_DOORBELL,
+			client->stage_id
+		};
+
+		if (WARN_ON(!has_doorbell(client))) {
+			ret = -ENODEV; /* internal setup error */
+			break;
+		}
 
-	ret = create_doorbell(guc->execbuf_client);
-	if (ret)
-		return ret;
+		__update_doorbell_desc(client, client->doorbell_id);
+		__create_doorbell(client);
 
-	if (guc->preempt_client) {
-		ret = create_doorbell(guc->preempt_client);
+		ret = intel_guc_ct_batch_add(guc, &batch,
+					     action, ARRAY_SIZE(action),
+					     doorbell_allocated, &reqs[n]);
 		if (ret) {
-			destroy_doorbell(guc->execbuf_client);
-			return ret;
+			doorbell_allocated(&reqs[n], ret);
+			break;
 		}
 	}
+	err = intel_guc_ct_batch_end(guc, &batch);
+	if (!ret)
+		ret = err;
 
-	return 0;
+	/* Release any doorbell that the GuC did allocate */
+	if (ret) {
+		for (n = 0; n < count; n++)
+			if (reqs[n].result >= 0)
+				destroy_doorbell(reqs[n].client);
+	}
+
+	kfree(reqs);
+	return ret;
 }
 
 static void guc_clients_doorbell_fini(struct intel_guc *guc)
 {
+	unsigned int n;
+
 	/*
 	 * By the time we're here, GuC has already been reset.
 	 * Instead of trying (in vain) to communicate with it, let's just
@@ -911,9 +980,9 @@ static void guc_clients_doorbell_fini(struct intel_guc *guc)
 				       GUC_DOORBELL_INVALID);
 	}
 
-	if (guc->execbuf_client) {
-		__destroy_doorbell(guc->execbuf_client);
-		__update_doorbell_desc(guc->execbuf_client,
+	for (n = 0; n < guc->num_execbuf_clients; n++) {
+		__destroy_doorbell(guc->execbuf_clients[n]);
+		__update_doorbell_desc(guc->execbuf_clients[n],
 				       GUC_DOORBELL_INVALID);
 	}
 }
@@ -1084,20 +1153,46 @@ static void guc_fill_preempt_context(struct intel_guc *guc)
 static int guc_clients_create(struct intel_guc *guc)
 {
 	struct drm_i915_private *dev_priv = guc_to_i915(guc);
+	u32 engines[I915_NUM_ENGINES] = {};
 	struct intel_guc_client *client;
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	unsigned int count, n;
+	int err;
 
 	GEM_BUG_ON(guc->execbuf_client);
 	GEM_BUG_ON(guc->preempt_client);
 
-	client = guc_client_alloc(dev_priv,
-				  INTEL_INFO(dev_priv)->ring_mask,
-				  GUC_CLIENT_PRIORITY_KMD_NORMAL,
-				  dev_priv->kernel_context);
-	if (IS_ERR(client)) {
-		DRM_ERROR("Failed to create GuC client for submission!\n");
-		return PTR_ERR(client);
+	/*
+	 * Deal the engines out between the execbuf clients, so that each
+	 * engine is backed by exactly one client (and so one work queue and
+	 * one doorbell) and preempt-to-idle knows which client to drop.
+	 */
+	count = clamp_t(int, i915_modparams.guc_execbuf_clients,
+			1, INTEL_INFO(dev_priv)->num_rings);
+	n = 0;
+	for_each_engine(engine, dev_priv, id) {
+		engines[n] |= ENGINE_MASK(id);
+		n = (n + 1) % count;
+	}
+
+	for (n = 0; n < count; n++) {
+		client = guc_client_alloc(dev_priv,
+					  engines[n],
+					  GUC_CLIENT_PRIORITY_KMD_NORMAL,
+					  dev_priv->kernel_context);
+		if (IS_ERR(client)) {
+			DRM_ERROR("Failed to create GuC client for submission!\n");
+			err = PTR_ERR(client);
+			goto err_execbuf;
+		}
+		guc->execbuf_clients[n] = client;
+
+		for_each_engine_masked(engine, dev_priv, engines[n], id)
+			guc->engine_client[id] = client;
 	}
-	guc->execbuf_client = client;
+	guc->num_execbuf_clients = count;
+	guc->execbuf_client = guc->execbuf_clients[0];
 
 	if (dev_priv->preempt_context) {
 		client = guc_client_alloc(dev_priv,
@@ -1106,9 +1201,8 @@ static int guc_clients_create(struct intel_guc *guc)
 					  dev_priv->preempt_context);
 		if (IS_ERR(client)) {
 			DRM_ERROR("Failed to create GuC client for preemption!\n");
-			guc_client_free(guc->execbuf_client);
-			guc->execbuf_client = NULL;
-			return PTR_ERR(client);
+			err = PTR_ERR(client);
+			goto err_execbuf;
 		}
 		guc->preempt_client = client;
 
@@ -1116,19 +1210,30 @@ static int guc_clients_create(struct intel_guc *guc)
 	}
 
 	return 0;
+
+err_execbuf:
+	while (n--)
+		guc_client_free(fetch_and_zero(&guc->execbuf_clients[n]));
+	memset(guc->engine_client, 0, sizeof(guc->engine_client));
+	guc->num_execbuf_clients = 0;
+	guc->execbuf_client = NULL;
+	return err;
 }
 
 static void guc_clients_destroy(struct intel_guc *guc)
 {
 	struct intel_guc_client *client;
+	unsigned int n;
 
 	client = fetch_and_zero(&guc->preempt_client);
 	if (client)
 		guc_client_free(client);
 
-	client = fetch_and_zero(&guc->execbuf_client);
-	if (client)
-		guc_client_free(client);
+	guc->execbuf_client = NULL;
+	memset(guc->engine_client, 0, sizeof(guc->engine_client));
+	for (n = 0; n < guc->num_execbuf_clients; n++)
+		guc_client_free(fetch_and_zero(&guc->execbuf_clients[n]));
+	guc->num_execbuf_clients = 0;
 }
 
 /*
@@ -1273,7 +1378,6 @@ static void guc_set_default_submission(struct intel_engine_cs *engine)
 	 * We inherit a bunch of functions from execlists that we'd like
 	 * to keep using:
 	 *
-	 *    engine->submit_request = execlists_submit_request;
 	 *    engine->cancel_requests = execlists_cancel_requests;
 	 *    engine->schedule = execlists_schedule;
 	 *
@@ -1282,6 +1386,7 @@ static void guc_set_default_submission(struct intel_engine_cs *engine)
 	 */
 	intel_execlists_set_default_submission(engine);
 
+	engine->submit_request = guc_submit_request;
 	engine->execlists.tasklet.func = guc_submission_tasklet;
 
 	engine->park = guc_submission_park;
@@ -1289,7 +1394,7 @@ static void guc_set_default_submission(struct intel_engine_cs *engine)
 
 	engine->reset.prepare = guc_reset_prepare;
 
-	engine->flags &= ~I915_ENGINE_SUPPORTS_STATS;
+	engine->flags &= ~(I915_ENGINE_SUPPORTS_STATS | I915_ENGINE_CSB_IN_IRQ);
 }
 
 int intel_guc_submission_enable(struct intel_guc *guc)
@@ -1297,6 +1402,7 @@ int intel_guc_submission_enable(struct intel_guc *guc)
 	struct drm_i915_private *dev_priv = guc_to_i915(guc);
 	struct intel_engine_cs *engine;
 	enum intel_engine_id id;
+	unsigned int n;
 	int err;
 
 	/*
@@ -1314,7 +1420,8 @@ int intel_guc_submission_enable(struct intel_guc *guc)
 
 	GEM_BUG_ON(!guc->execbuf_client);
 
-	guc_reset_wq(guc->execbuf_client);
+	for (n = 0; n < guc->num_execbuf_clients; n++)
+		guc_reset_wq(guc->execbuf_clients[n]);
 	if (guc->preempt_client)
 		guc_reset_wq(guc->preempt_client);
 
@@ -26,6 +26,9 @@
 
 struct intel_gvt;
 
+/* vGPU ids, and so the i915 PMU vGPU counters, range below this */
+#define INTEL_GVT_MAX_VGPU 8
+
 #ifdef CONFIG_DRM_I915_GVT
 int intel_gvt_init(struct drm_i915_private *dev_priv);
 void intel_gvt_cleanup(struct drm_i915_private *dev_priv);
@@ -33,6 +36,8 @@ int intel_gvt_init_device(struct drm_i915_private *dev_priv);
 void intel_gvt_clean_device(struct drm_i915_private *dev_priv);
 int intel_gvt_init_host(void);
 void intel_gvt_sanitize_options(struct drm_i915_private *dev_priv);
+int intel_gvt_read_vgpu_counter(struct drm_i915_private *dev_priv,
+				unsigned int id, unsigned int sample, u64 *val);
 #else
 static inline int intel_gvt_init(struct drm_i915_private *dev_priv)
 {
@@ -45,6 +50,13 @@ static inline void intel_gvt_cleanup(struct drm_i915_private *dev_priv)
 static inline void intel_gvt_sanitize_options(struct drm_i915_private *dev_priv)
 {
 }
+
+static inline int intel_gvt_read_vgpu_counter(struct drm_i915_private *dev_priv,
+					      unsigned int id,
+					      unsigned int sample, u64 *val)
+{
+	return -ENODEV;
+}
 #endif
 
 #endif /* _INTEL_GVT_H_ */
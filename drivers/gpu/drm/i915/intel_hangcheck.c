@@ -402,6 +402,37 @@ static void hangcheck_declare_hang(struct drm_i915_private *i915,
 				 "%s", msg);
 }
 
+static bool hangcheck_watchdog_expired(struct intel_engine_cs *engine)
+{
+	return engine->hangcheck.stalled &&
+	       engine->hangcheck.watchdog == intel_engine_get_seqno(engine) &&
+	       !intel_engine_is_idle(engine);
+}
+
+/*
+ * The hw watchdog has already decided which context overran its budget
+ * without progress, so only those engines are reset. The other engines
+ * keep accumulating their samples at the usual period, so that a single
+ * misbehaving context does not disturb the verdict on everyone else.
+ */
+static void hangcheck_watchdog(struct drm_i915_private *i915)
+{
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	unsigned int hung = 0;
+
+	for_each_engine(engine, i915, id) {
+		if (engine->irq_seqno_barrier)
+			engine->irq_seqno_barrier(engine);
+
+		if (hangcheck_watchdog_expired(engine))
+			hung |= intel_engine_flag(engine);
+	}
+
+	if (hung)
+		hangcheck_declare_hang(i915, hung, hung, 1);
+}
+
 /*
  * This is called when the chip hasn't reported back with completed
  * batchbuffers in a long time. We keep track per ring seqno progress and
@@ -417,7 +448,7 @@ static void i915_hangcheck_elapsed(struct work_struct *work)
 			     gpu_error.hangcheck_work.work);
 	struct intel_engine_cs *engine;
 	enum intel_engine_id id;
-	unsigned int hung = 0, stuck = 0, wedged = 0, watchdog = 0;
+	unsigned int hung = 0, stuck = 0, wedged = 0;
 
 	if (!i915_modparams.enable_hangcheck)
 		return;
@@ -428,8 +459,10 @@ static void i915_hangcheck_elapsed(struct work_struct *work)
 	if (i915_terminally_wedged(&dev_priv->gpu_error))
 		return;
 
-	if (test_and_clear_bit(I915_RESET_WATCHDOG, &dev_priv->gpu_error.flags))
-		watchdog = 1;
+	if (test_and_clear_bit(I915_RESET_WATCHDOG, &dev_priv->gpu_error.flags)) {
+		hangcheck_watchdog(dev_priv);
+		goto out;
+	}
 
 	/* As enabling the GPU requires fairly extensive mmio access,
 	 * periodically arm the mmio checker to see if we are triggering
@@ -466,8 +499,9 @@ static void i915_hangcheck_elapsed(struct work_struct *work)
 	}
 
 	if (hung)
-		hangcheck_declare_hang(dev_priv, hung, stuck, watchdog);
+		hangcheck_declare_hang(dev_priv, hung, stuck, 0);
 
+out:
 	/* Reset timer in case GPU hangs without another request being added */
 	i915_queue_hangcheck(dev_priv);
 }
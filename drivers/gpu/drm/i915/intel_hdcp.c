@@ -16,6 +16,14 @@
 
 #define KEY_LOAD_TRIES	5
 
+/*
+ * Authentication runs from hdcp_auth_work. Each attempt already retries the
+ * authentication itself a few times, a failed attempt is followed by another
+ * one after an exponentially growing delay, up to HDCP_AUTH_ATTEMPTS.
+ */
+#define HDCP_AUTH_ATTEMPTS	4
+#define HDCP_AUTH_BACKOFF_MS	100
+
 static int intel_hdcp_poll_ksv_fifo(struct intel_digital_port *intel_dig_port,
 				    const struct intel_hdcp_shim *shim)
 {
@@ -702,6 +710,55 @@ static void intel_hdcp_check_work(struct work_struct *work)
 				      DRM_HDCP_CHECK_PERIOD_MS);
 }
 
+/* Caller must hold hdcp_mutex, with hdcp_value set to DESIRED */
+static void intel_hdcp_queue_auth(struct intel_connector *connector)
+{
+	connector->hdcp_auth_attempts = 0;
+	mod_delayed_work(system_long_wq, &connector->hdcp_auth_work, 0);
+}
+
+static void intel_hdcp_auth_work(struct work_struct *work)
+{
+	struct intel_connector *connector = container_of(to_delayed_work(work),
+							 struct intel_connector,
+							 hdcp_auth_work);
+	int ret;
+
+	mutex_lock(&connector->hdcp_mutex);
+
+	/* Disabled, or re-enabled by someone else, since we were queued */
+	if (connector->hdcp_value != DRM_MODE_CONTENT_PROTECTION_DESIRED)
+		goto out;
+
+	ret = _intel_hdcp_enable(connector);
+	if (ret) {
+		if (++connector->hdcp_auth_attempts < HDCP_AUTH_ATTEMPTS) {
+			unsigned int delay = HDCP_AUTH_BACKOFF_MS <<
+				(connector->hdcp_auth_attempts - 1);
+
+			DRM_DEBUG_KMS("[%s:%d] HDCP authentication failed (%d), retrying in %ums\n",
+				      connector->base.name,
+				      connector->base.base.id, ret, delay);
+			queue_delayed_work(system_long_wq,
+					   &connector->hdcp_auth_work,
+					   msecs_to_jiffies(delay));
+		} else {
+			DRM_ERROR("[%s:%d] HDCP authentication failed, giving up after %u attempts\n",
+				  connector->base.name,
+				  connector->base.base.id,
+				  connector->hdcp_auth_attempts);
+		}
+		goto out;
+	}
+
+	connector->hdcp_value = DRM_MODE_CONTENT_PROTECTION_ENABLED;
+	schedule_work(&connector->hdcp_prop_work);
+	schedule_delayed_work(&connector->hdcp_check_work,
+			      DRM_HDCP_CHECK_PERIOD_MS);
+out:
+	mutex_unlock(&connector->hdcp_mutex);
+}
+
 static void intel_hdcp_prop_work(struct work_struct *work)
 {
 	struct intel_connector *connector = container_of(work,
@@ -748,29 +805,27 @@ int intel_hdcp_init(struct intel_connector *connector,
 	mutex_init(&connector->hdcp_mutex);
 	INIT_DELAYED_WORK(&connector->hdcp_check_work, intel_hdcp_check_work);
 	INIT_WORK(&connector->hdcp_prop_work, intel_hdcp_prop_work);
+	INIT_DELAYED_WORK(&connector->hdcp_auth_work, intel_hdcp_auth_work);
 	return 0;
 }
 
+/*
+ * Authentication, with its repeater KSV list reading, takes from hundreds of
+ * milliseconds to seconds, so don't hold up the modeset for it: it is run
+ * from hdcp_auth_work, which updates the content protection property to
+ * ENABLED once it succeeds. Until then the property stays DESIRED.
+ */
 int intel_hdcp_enable(struct intel_connector *connector)
 {
-	int ret;
-
 	if (!connector->hdcp_shim)
 		return -ENOENT;
 
 	mutex_lock(&connector->hdcp_mutex);
-
-	ret = _intel_hdcp_enable(connector);
-	if (ret)
-		goto out;
-
-	connector->hdcp_value = DRM_MODE_CONTENT_PROTECTION_ENABLED;
-	schedule_work(&connector->hdcp_prop_work);
-	schedule_delayed_work(&connector->hdcp_check_work,
-			      DRM_HDCP_CHECK_PERIOD_MS);
-out:
+	connector->hdcp_value = DRM_MODE_CONTENT_PROTECTION_DESIRED;
+	intel_hdcp_queue_auth(connector);
 	mutex_unlock(&connector->hdcp_mutex);
-	return ret;
+
+	return 0;
 }
 
 int intel_hdcp_disable(struct intel_connector *connector)
@@ -788,6 +843,7 @@ int intel_hdcp_disable(struct intel_connector *connector)
 	}
 
 	mutex_unlock(&connector->hdcp_mutex);
+	cancel_delayed_work_sync(&connector->hdcp_auth_work);
 	cancel_delayed_work_sync(&connector->hdcp_check_work);
 	return ret;
 }
@@ -841,6 +897,12 @@ int intel_hdcp_check_link(struct intel_connector *connector)
 	if (connector->hdcp_value == DRM_MODE_CONTENT_PROTECTION_UNDESIRED)
 		goto out;
 
+	/* Authentication is pending, the auth worker restarts the checks */
+	if (connector->hdcp_value == DRM_MODE_CONTENT_PROTECTION_DESIRED) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
 	if (!(I915_READ(PORT_HDCP_STATUS(port)) & HDCP_STATUS_ENC)) {
 		DRM_ERROR("%s:%d HDCP check failed: link is not encrypted,%x\n",
 			  connector->base.name, connector->base.base.id,
@@ -872,13 +934,15 @@ int intel_hdcp_check_link(struct intel_connector *connector)
 		goto out;
 	}
 
-	ret = _intel_hdcp_enable(connector);
-	if (ret) {
-		DRM_ERROR("Failed to enable hdcp (%d)\n", ret);
-		connector->hdcp_value = DRM_MODE_CONTENT_PROTECTION_DESIRED;
-		schedule_work(&connector->hdcp_prop_work);
-		goto out;
-	}
+	/*
+	 * Reauthenticate from the auth worker rather than from here, as we
+	 * may be called from the hotplug handler. The worker restarts the
+	 * link checks once it succeeds.
+	 */
+	connector->hdcp_value = DRM_MODE_CONTENT_PROTECTION_DESIRED;
+	schedule_work(&connector->hdcp_prop_work);
+	intel_hdcp_queue_auth(connector);
+	ret = -EAGAIN;
 
 out:
 	mutex_unlock(&connector->hdcp_mutex);
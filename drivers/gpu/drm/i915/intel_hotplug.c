@@ -255,6 +255,8 @@ bool intel_encoder_hotplug(struct intel_encoder *encoder,
 	WARN_ON(!mutex_is_locked(&dev->mode_config.mutex));
 	old_status = connector->base.status;
 
+	/* The sink may have been swapped, read its EDID afresh */
+	connector->base.edid_reusable = false;
 	connector->base.status =
 		drm_helper_probe_detect(&connector->base, NULL, false);
 
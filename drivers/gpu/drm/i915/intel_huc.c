@@ -27,9 +27,90 @@
 #include "intel_huc.h"
 #include "i915_drv.h"
 
+static const char *huc_auth_get_driver_name(struct dma_fence *fence)
+{
+	return DRIVER_NAME;
+}
+
+static const char *huc_auth_get_timeline_name(struct dma_fence *fence)
+{
+	return "huc-auth";
+}
+
+static bool huc_auth_enable_signaling(struct dma_fence *fence)
+{
+	return true;
+}
+
+static const struct dma_fence_ops huc_auth_ops = {
+	.get_driver_name = huc_auth_get_driver_name,
+	.get_timeline_name = huc_auth_get_timeline_name,
+	.enable_signaling = huc_auth_enable_signaling,
+	.wait = dma_fence_default_wait,
+};
+
+static struct dma_fence *huc_auth_fence(struct intel_huc *huc)
+{
+	struct dma_fence *fence;
+
+	spin_lock_irq(&huc->auth.lock);
+	fence = dma_fence_get(huc->auth.fence);
+	spin_unlock_irq(&huc->auth.lock);
+
+	return fence;
+}
+
+static void huc_flush_auth(struct intel_huc *huc)
+{
+	/* Not just the fence, the worker still touches the device after it */
+	flush_work(&huc->auth.work);
+}
+
+static int huc_wait_for_auth(struct intel_huc *huc)
+{
+	struct drm_i915_private *i915 = huc_to_i915(huc);
+	u32 status;
+	int ret;
+
+	ret = __intel_wait_for_register(i915,
+					HUC_STATUS2,
+					HUC_FW_VERIFIED,
+					HUC_FW_VERIFIED,
+					2, 50, &status);
+	if (ret) {
+		DRM_ERROR("HuC: Firmware not verified %#x\n", status);
+		huc->fw.load_status = INTEL_UC_FIRMWARE_FAIL;
+		DRM_ERROR("HuC: Authentication failed %d\n", ret);
+	}
+
+	return ret;
+}
+
+static void huc_auth_work(struct work_struct *wrk)
+{
+	struct intel_huc *huc = container_of(wrk, typeof(*huc), auth.work);
+	struct drm_i915_private *i915 = huc_to_i915(huc);
+	struct dma_fence *fence;
+	int err;
+
+	/* Only replaced after flushing us, so this is the one to signal */
+	fence = huc_auth_fence(huc);
+
+	err = huc_wait_for_auth(huc);
+	if (err)
+		dma_fence_set_error(fence, err);
+
+	dma_fence_signal(fence);
+	dma_fence_put(fence);
+
+	intel_runtime_pm_put(i915);
+}
+
 void intel_huc_init_early(struct intel_huc *huc)
 {
 	intel_huc_fw_init_early(huc);
+	spin_lock_init(&huc->auth.lock);
+	INIT_WORK(&huc->auth.work, huc_auth_work);
 }
 
 int intel_huc_init_misc(struct intel_huc *huc)
@@ -40,60 +121,78 @@ int intel_huc_init_misc(struct intel_huc *huc)
 	return 0;
 }
 
+void intel_huc_fini_misc(struct intel_huc *huc)
+{
+	huc_flush_auth(huc);
+	dma_fence_put(fetch_and_zero(&huc->auth.fence));
+
+	intel_uc_fw_fini(&huc->fw);
+}
+
+int intel_huc_sanitize(struct intel_huc *huc)
+{
+	/* The status register is about to be lost, so let the wait finish */
+	huc_flush_auth(huc);
+
+	intel_uc_fw_sanitize(&huc->fw);
+	return 0;
+}
+
 /**
  * intel_huc_auth() - Authenticate HuC uCode
  * @huc: intel_huc structure
  *
  * Called after HuC and GuC firmware loading during intel_uc_init_hw().
  *
- * This function pins HuC firmware image object into GGTT.
- * Then it invokes GuC action to authenticate passing the offset to RSA
- * signature through intel_guc_auth_huc(). It then waits for 50ms for
- * firmware verification ACK and unpins the object.
+ * This function invokes GuC action to authenticate passing the offset to RSA
+ * signature of the HuC firmware image (kept pinned in the GGTT since its
+ * upload) through intel_guc_auth_huc(). Rather than wait here for the
+ * firmware verification ACK, that is left to a worker which signals
+ * huc->auth.fence once the HuC reports itself verified, so that only the
+ * requests that depend on the HuC have to wait (see intel_huc_await_auth()).
  */
 int intel_huc_auth(struct intel_huc *huc)
 {
 	struct drm_i915_private *i915 = huc_to_i915(huc);
 	struct intel_guc *guc = &i915->guc;
-	struct i915_vma *vma;
-	u32 status;
+	struct dma_fence *fence, *old;
 	int ret;
 
 	if (huc->fw.load_status != INTEL_UC_FIRMWARE_SUCCESS)
 		return -ENOEXEC;
 
-	vma = i915_gem_object_ggtt_pin(huc->fw.obj, NULL, 0, 0,
-				       PIN_OFFSET_BIAS | i915->ggtt.pin_bias);
-	if (IS_ERR(vma)) {
-		ret = PTR_ERR(vma);
-		DRM_ERROR("HuC: Failed to pin huc fw object %d\n", ret);
-		goto fail;
-	}
+	GEM_BUG_ON(!huc->fw.vma);
+
+	/* Never let a stale verification complete the new one */
+	huc_flush_auth(huc);
 
 	ret = intel_guc_auth_huc(guc,
-				 intel_guc_ggtt_offset(guc, vma) +
+				 intel_guc_ggtt_offset(guc, huc->fw.vma) +
 				 huc->fw.rsa_offset);
 	if (ret) {
 		DRM_ERROR("HuC: GuC did not ack Auth request %d\n", ret);
-		goto fail_unpin;
+		goto fail;
 	}
 
-	/* Check authentication status, it should be done by now */
-	ret = __intel_wait_for_register(i915,
-					HUC_STATUS2,
-					HUC_FW_VERIFIED,
-					HUC_FW_VERIFIED,
-					2, 50, &status);
-	if (ret) {
-		DRM_ERROR("HuC: Firmware not verified %#x\n", status);
-		goto fail_unpin;
-	}
+	fence = kmalloc(sizeof(*fence), GFP_KERNEL | __GFP_NOWARN);
+	if (!fence)
+		return huc_wait_for_auth(huc);
+
+	dma_fence_init(fence, &huc_auth_ops, &huc->auth.lock,
+		       i915->mm.unordered_timeline, 0);
+
+	spin_lock_irq(&huc->auth.lock);
+	old = huc->auth.fence;
+	huc->auth.fence = fence;
+	spin_unlock_irq(&huc->auth.lock);
+	dma_fence_put(old);
+
+	/* Our caller keeps the device awake; the worker inherits that */
+	intel_runtime_pm_get_noresume(i915);
+	queue_work(system_unbound_wq, &huc->auth.work);
 
-	i915_vma_unpin(vma);
 	return 0;
 
-fail_unpin:
-	i915_vma_unpin(vma);
 fail:
 	huc->fw.load_status = INTEL_UC_FIRMWARE_FAIL;
 
@@ -101,6 +200,34 @@ int intel_huc_auth(struct intel_huc *huc)
 	return ret;
 }
 
+/**
+ * intel_huc_await_auth() - order a request after HuC authentication
+ * @huc: intel_huc structure
+ * @rq: the request that may use the HuC
+ *
+ * Makes @rq wait for the pending HuC authentication, if any, before it is
+ * submitted to the hardware.
+ *
+ * Returns 0 on success, negative error code on failure.
+ */
+int intel_huc_await_auth(struct intel_huc *huc, struct i915_request *rq)
+{
+	struct dma_fence *fence;
+	int err = 0;
+
+	if (!READ_ONCE(huc->auth.fence))
+		return 0;
+
+	fence = huc_auth_fence(huc);
+	if (fence) {
+		if (!dma_fence_is_signaled(fence))
+			err = i915_request_await_dma_fence(rq, fence);
+		dma_fence_put(fence);
+	}
+
+	return err < 0 ? err : 0;
+}
+
 /**
  * intel_huc_check_status() - check HuC status
  * @huc: intel_huc structure
@@ -114,11 +241,22 @@ int intel_huc_auth(struct intel_huc *huc)
 int intel_huc_check_status(struct intel_huc *huc)
 {
 	struct drm_i915_private *dev_priv = huc_to_i915(huc);
+	struct dma_fence *fence;
 	u32 status;
 
 	if (!HAS_HUC(dev_priv))
 		return -ENODEV;
 
+	/* Report the outcome of the authentication, not its progress */
+	fence = huc_auth_fence(huc);
+	if (fence) {
+		long ret = dma_fence_wait(fence, true);
+
+		dma_fence_put(fence);
+		if (ret)
+			return ret;
+	}
+
 	intel_runtime_pm_get(dev_priv);
 	status = I915_READ(HUC_STATUS2) & HUC_FW_VERIFIED;
 	intel_runtime_pm_put(dev_priv);
@@ -25,30 +25,44 @@
 #ifndef _INTEL_HUC_H_
 #define _INTEL_HUC_H_
 
+#include <linux/dma-fence.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
 #include "intel_uc_fw.h"
 #include "intel_huc_fw.h"
 
+struct i915_request;
+
 struct intel_huc {
 	/* Generic uC firmware management */
 	struct intel_uc_fw fw;
 
 	/* HuC-specific additions */
+	struct {
+		/*
+		 * Signaled once the HuC reports the firmware as verified
+		 * after the last upload (with an error should it not).
+		 * Media requests wait upon it rather than intel_uc_init_hw().
+		 */
+		struct dma_fence *fence;
+		spinlock_t lock;
+
+		/*
+		 * Waits for the verification and signals @fence. Flushed,
+		 * not just the fence waited upon, before teardown as it
+		 * still drops its wakeref after signaling.
+		 */
+		struct work_struct work;
+	} auth;
 };
 
 void intel_huc_init_early(struct intel_huc *huc);
 int intel_huc_init_misc(struct intel_huc *huc);
+void intel_huc_fini_misc(struct intel_huc *huc);
+int intel_huc_sanitize(struct intel_huc *huc);
 int intel_huc_auth(struct intel_huc *huc);
+int intel_huc_await_auth(struct intel_huc *huc, struct i915_request *rq);
 int intel_huc_check_status(struct intel_huc *huc);
 
-static inline void intel_huc_fini_misc(struct intel_huc *huc)
-{
-	intel_uc_fw_fini(&huc->fw);
-}
-
-static inline int intel_huc_sanitize(struct intel_huc *huc)
-{
-	intel_uc_fw_sanitize(&huc->fw);
-	return 0;
-}
-
 #endif
@@ -172,6 +172,48 @@ static inline int rq_prio(const struct i915_request *rq)
 	return rq->sched.attr.priority;
 }
 
+static inline bool deadline_before(u64 a, u64 b)
+{
+	/* A deadline of 0 is no deadline at all, i.e. after all others */
+	return a && (!b || a < b);
+}
+
+static inline u64 rq_deadline(const struct i915_request *rq)
+{
+	return rq->sched.attr.deadline ?: U64_MAX;
+}
+
+/*
+ * Within each priolist, requests are kept sorted by their deadline; those
+ * without one are all equal and so remain in submission order. As each
+ * request inherits the deadline of those that depend upon it, and so a
+ * request is never due after its successors, the sorting also keeps the
+ * requests of each context in ring order.
+ */
+static void priolist_add_tail(struct i915_priolist *p, struct i915_request *rq)
+{
+	const u64 deadline = rq_deadline(rq);
+	struct i915_request *pos;
+
+	list_for_each_entry_reverse(pos, &p->requests, sched.link) {
+		if (rq_deadline(pos) <= deadline)
+			break;
+	}
+	list_add(&rq->sched.link, &pos->sched.link);
+}
+
+static void priolist_add_head(struct i915_priolist *p, struct i915_request *rq)
+{
+	const u64 deadline = rq_deadline(rq);
+	struct i915_request *pos;
+
+	list_for_each_entry(pos, &p->requests, sched.link) {
+		if (rq_deadline(pos) >= deadline)
+			break;
+	}
+	list_add_tail(&rq->sched.link, &pos->sched.link);
+}
+
 static inline bool need_preempt(const struct intel_engine_cs *engine,
 				const struct i915_request *last,
 				int prio)
@@ -181,6 +223,79 @@ static inline bool need_preempt(const struct intel_engine_cs *engine,
 		!i915_request_completed(last));
 }
 
+static bool need_timeslice(const struct intel_engine_cs *engine,
+			   const struct i915_request *last)
+{
+	const struct intel_engine_execlists *execlists = &engine->execlists;
+	const struct i915_request *rq;
+	struct rb_node *rb;
+
+	if (!READ_ONCE(execlists->timeslice_expired))
+		return false;
+
+	if (!intel_engine_has_preemption(engine) ||
+	    i915_request_completed(last))
+		return false;
+
+	/*
+	 * Only rotate if someone else of the same priority is waiting,
+	 * either queued behind us in port[1] or still in the priolist
+	 * (anyone of a higher priority would have preempted us already).
+	 */
+	rq = port_request(&execlists->port[1]);
+	if (rq && rq_prio(rq) >= rq_prio(last))
+		return true;
+
+	rb = rb_first_cached(&execlists->queue);
+	if (!rb || to_priolist(rb)->priority < rq_prio(last))
+		return false;
+
+	rq = list_first_entry_or_null(&to_priolist(rb)->requests,
+				      typeof(*rq), sched.link);
+	return rq && rq->hw_context != last->hw_context;
+}
+
+static void execlists_timeslice(struct timer_list *timer)
+{
+	struct intel_engine_cs *engine =
+		from_timer(engine, timer, execlists.timeslice);
+
+	WRITE_ONCE(engine->execlists.timeslice_expired, true);
+	tasklet_hi_schedule(&engine->execlists.tasklet);
+}
+
+static void irq_steer_init(struct intel_engine_cs *engine)
+{
+	struct intel_engine_execlists * const execlists = &engine->execlists;
+
+	execlists->irq_steer.csd.func = execlists_irq_steer;
+	execlists->irq_steer.csd.info = execlists;
+	execlists->irq_steer.pending = 0;
+
+	/* Spread the engines over the CPUs closest to the device, one each */
+	execlists->irq_steer.cpu = -1;
+	if (i915_modparams.steer_engine_irqs && num_online_cpus() > 1)
+		execlists->irq_steer.cpu =
+			cpumask_local_spread(engine->id,
+					     dev_to_node(engine->i915->drm.dev));
+}
+
+static void start_timeslice(struct intel_engine_execlists *execlists)
+{
+	unsigned int duration = READ_ONCE(execlists->timeslice_duration_ms);
+
+	execlists->timeslice_expired = false;
+	if (duration)
+		mod_timer(&execlists->timeslice,
+			  jiffies + msecs_to_jiffies(duration));
+}
+
+static void cancel_timeslice(struct intel_engine_execlists *execlists)
+{
+	del_timer(&execlists->timeslice);
+	execlists->timeslice_expired = false;
+}
+
 /*
  * The context descriptor encodes various attributes of a context,
  * including its GTT address and some flags. Because it's fairly
@@ -336,7 +451,34 @@ static void __unwind_incomplete_requests(struct intel_engine_cs *engine)
 		}
 
 		GEM_BUG_ON(p->priority != rq_prio(rq));
-		list_add(&rq->sched.link, &p->requests);
+		priolist_add_head(p, rq);
+	}
+}
+
+static void yield_context(struct intel_engine_cs *engine,
+			  const struct intel_context *ce)
+{
+	struct intel_engine_execlists * const execlists = &engine->execlists;
+	struct rb_node *rb;
+
+	lockdep_assert_held(&engine->timeline.lock);
+
+	/*
+	 * Having been unwound, the requests of the context whose timeslice
+	 * expired are at the head of their priolists. Move them behind
+	 * their peers, keeping their relative order, so that the next
+	 * dequeue runs somebody else first.
+	 */
+	for (rb = rb_first_cached(&execlists->queue); rb; rb = rb_next(rb)) {
+		struct i915_priolist *p = to_priolist(rb);
+		struct i915_request *rq, *rn;
+		LIST_HEAD(yield);
+
+		list_for_each_entry_safe(rq, rn, &p->requests, sched.link) {
+			if (rq->hw_context == ce)
+				list_move_tail(&rq->sched.link, &yield);
+		}
+		list_splice_tail(&yield, &p->requests);
 	}
 }
 
@@ -354,6 +496,31 @@ execlists_unwind_incomplete_requests(struct intel_engine_execlists *execlists)
 	spin_unlock_irqrestore(&engine->timeline.lock, flags);
 }
 
+void
+execlists_flush_submit_queue(struct intel_engine_execlists *execlists)
+{
+	struct intel_engine_cs *engine =
+		container_of(execlists, typeof(*engine), execlists);
+	struct i915_request *rq, *rn;
+	struct llist_node *first;
+
+	lockdep_assert_held(&engine->timeline.lock);
+
+	first = llist_del_all(&execlists->submit_queue);
+	if (!first)
+		return;
+
+	/* The llist is LIFO; restore submission order for each priority */
+	first = llist_reverse_order(first);
+	llist_for_each_entry_safe(rq, rn, first, submit_link) {
+		const int prio = rq_prio(rq);
+
+		priolist_add_tail(lookup_priolist(engine, prio), rq);
+		if (prio > execlists->queue_priority)
+			execlists->queue_priority = prio;
+	}
+}
+
 static inline void
 execlists_context_status_change(struct i915_request *rq, unsigned long status)
 {
@@ -381,17 +548,137 @@ execlists_user_end(struct intel_engine_execlists *execlists)
 	execlists_clear_active(execlists, EXECLISTS_ACTIVE_USER);
 }
 
+static void execlists_update_port_idle(struct intel_engine_cs *engine)
+{
+	const struct intel_engine_execlists * const execlists =
+		&engine->execlists;
+	bool idle;
+	ktime_t now;
+
+	/*
+	 * Track how long we leave the last ELSP empty whilst the engine is
+	 * busy, i.e. how often we fail to keep a second context queued up
+	 * behind the active one and so risk a bubble on the context switch.
+	 * As this requires reading the clock, we only do so while someone
+	 * is listening (and to close an interval already open).
+	 */
+	if (!(engine->pmu.enable & BIT(I915_SAMPLE_PORT_IDLE)) &&
+	    !engine->pmu.port_idle_start)
+		return;
+
+	idle = port_isset(&execlists->port[0]) &&
+	       !port_isset(&execlists->port[execlists->port_mask]);
+	if (idle == !!engine->pmu.port_idle_start)
+		return;
+
+	now = ktime_get();
+	if (idle) {
+		engine->pmu.port_idle_start = now;
+	} else {
+		engine->pmu.sample[I915_SAMPLE_PORT_IDLE].cur +=
+			ktime_to_ns(ktime_sub(now,
+					      engine->pmu.port_idle_start));
+		engine->pmu.port_idle_start = 0;
+	}
+}
+
+static void record_elsp(struct i915_request *rq)
+{
+	if (rq->latency.elsp)
+		return;
+
+	rq->latency.elsp = ktime_get_ns();
+	intel_engine_record_latency(rq->engine, INTEL_LATENCY_ELSP, rq,
+				    rq->latency.submit, rq->latency.elsp);
+}
+
+static void record_start(struct i915_request *rq)
+{
+	if (!rq || rq->latency.start || !rq->latency.elsp)
+		return;
+
+	rq->latency.start = ktime_get_ns();
+	intel_engine_record_latency(rq->engine, INTEL_LATENCY_HW, rq,
+				    rq->latency.elsp, rq->latency.start);
+}
+
+static inline void intel_context_stats_in(struct intel_context *ce)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&ce->stats.lock, flags);
+	if (ce->stats.active++ == 0)
+		ce->stats.start = ktime_get();
+	write_sequnlock_irqrestore(&ce->stats.lock, flags);
+}
+
+static inline void intel_context_stats_out(struct intel_context *ce)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&ce->stats.lock, flags);
+	GEM_BUG_ON(!ce->stats.active);
+	if (--ce->stats.active == 0)
+		ce->stats.total =
+			ktime_add(ce->stats.total,
+				  ktime_sub(ktime_get(), ce->stats.start));
+	write_sequnlock_irqrestore(&ce->stats.lock, flags);
+}
+
+static void intel_context_record_runtime(struct i915_request *rq, u32 us)
+{
+	struct intel_context_runtime_hist *hist = &rq->hw_context->runtime_hist;
+	unsigned int i;
+
+	/* Age the history, so that the threshold follows the workload */
+	if (hist->count == INTEL_RUNTIME_HISTORY) {
+		hist->count = 0;
+		for (i = 0; i < INTEL_RUNTIME_BUCKETS; i++) {
+			hist->bucket[i] /= 2;
+			hist->count += hist->bucket[i];
+		}
+	}
+
+	hist->bucket[min_t(unsigned int, ilog2(us), INTEL_RUNTIME_BUCKETS - 1)]++;
+	hist->count++;
+
+	/* Did we come close to the watchdog biting? */
+	if (rq->watchdog_threshold &&
+	    4ull * us > 3ull * watchdog_to_us(rq->i915, rq->watchdog_threshold))
+		rq->engine->pmu.sample[I915_SAMPLE_WATCHDOG_NEAR].cur++;
+}
+
 static inline void
 execlists_context_schedule_in(struct i915_request *rq)
 {
 	execlists_context_status_change(rq, INTEL_CONTEXT_SCHEDULE_IN);
-	intel_engine_context_in(rq->engine);
+	rq->stats_band = intel_engine_priority_band(rq->sched.attr.priority);
+	intel_engine_context_in(rq->engine, rq->stats_band);
+	intel_context_stats_in(rq->hw_context);
+	if (atomic_read(&rq->i915->gt_pm.rps.qos.users))
+		intel_rps_qos_in(rq);
+	intel_engine_trace(rq->engine, INTEL_TRACE_IN, rq);
 }
 
 static inline void
 execlists_context_schedule_out(struct i915_request *rq, unsigned long status)
 {
-	intel_engine_context_out(rq->engine);
+	intel_engine_trace(rq->engine, INTEL_TRACE_OUT, rq);
+	if (rq->freq_hint)
+		intel_rps_qos_out(rq);
+	if (status == INTEL_CONTEXT_SCHEDULE_OUT && rq->latency.start) {
+		u64 dt = ktime_get_ns() - rq->latency.start;
+		u32 us = min_t(u64, max_t(u64, div_u64(dt, NSEC_PER_USEC), 1),
+			       U32_MAX);
+
+		/* Racy across engines, but this is only ever a guide */
+		ewma_runtime_add(&rq->gem_context->runtime_us, us);
+
+		intel_context_record_runtime(rq, us);
+	}
+	rq->hw_context->preempted = status == INTEL_CONTEXT_SCHEDULE_PREEMPTED;
+	intel_context_stats_out(rq->hw_context);
+	intel_engine_context_out(rq->engine, rq->stats_band);
 	execlists_context_status_change(rq, status);
 	trace_i915_request_out(rq);
 }
@@ -414,6 +701,17 @@ static u64 execlists_update_context(struct i915_request *rq)
 
 	reg_state[CTX_RING_TAIL+1] = intel_ring_set_tail(rq->ring, rq->tail);
 
+	/*
+	 * The engine state of a stateless context is never reused between
+	 * requests, so skip reloading it from the image. The inhibit is
+	 * cleared as the context is saved, so it must be reapplied on every
+	 * submission; except after a preemption, when the image holds the
+	 * state of the request we are about to resume.
+	 */
+	if (i915_gem_context_is_stateless(rq->gem_context) && !ce->preempted)
+		reg_state[CTX_CONTEXT_CONTROL+1] |=
+			_MASKED_BIT_ENABLE(CTX_CTRL_ENGINE_CTX_RESTORE_INHIBIT);
+
 	/* True 32b PPGTT with dynamic page allocation: update PDP
 	 * registers and point the unallocated PDPs to scratch page.
 	 * PML4 is allocated during ppgtt init, so this is not needed
@@ -466,9 +764,14 @@ static void execlists_submit_ports(struct intel_engine_cs *engine)
 		rq = port_unpack(&port[n], &count);
 		if (rq) {
 			GEM_BUG_ON(count > !n);
-			if (!count++)
+			if (!count++) {
 				execlists_context_schedule_in(rq);
+				if (!n)
+					start_timeslice(execlists);
+			} else
+				engine->pmu.sample[I915_SAMPLE_LITE_RESTORE].cur++;
 			port_set(&port[n], port_pack(rq, count));
+			record_elsp(rq);
 			desc = execlists_update_context(rq);
 			GEM_DEBUG_EXEC(port[n].context_id = upper_32_bits(desc));
 
@@ -492,6 +795,9 @@ static void execlists_submit_ports(struct intel_engine_cs *engine)
 		writel(EL_CTRL_LOAD, execlists->ctrl_reg);
 
 	execlists_clear_active(execlists, EXECLISTS_ACTIVE_HWACK);
+
+	engine->pmu.sample[I915_SAMPLE_ELSP].cur++;
+	execlists_update_port_idle(engine);
 }
 
 static bool ctx_single_port_submission(const struct intel_context *ce)
@@ -566,6 +872,14 @@ static void complete_preempt_context(struct intel_engine_execlists *execlists)
 	__unwind_incomplete_requests(container_of(execlists,
 						  struct intel_engine_cs,
 						  execlists));
+
+	if (execlists->yield) {
+		yield_context(container_of(execlists,
+					   struct intel_engine_cs,
+					   execlists),
+			      execlists->yield);
+		execlists->yield = NULL;
+	}
 }
 
 static void execlists_dequeue(struct intel_engine_cs *engine)
@@ -626,6 +940,19 @@ static void execlists_dequeue(struct intel_engine_cs *engine)
 			return;
 		}
 
+		/*
+		 * Otherwise, if the active context has exhausted its
+		 * timeslice and another of equal priority is waiting,
+		 * preempt it and put it to the back of the queue.
+		 */
+		if (need_timeslice(engine, last)) {
+			GEM_TRACE("%s timeslice expired for ctx=%d\n",
+				  engine->name, port[0].context_id);
+			execlists->yield = last->hw_context;
+			inject_preempt_context(engine);
+			return;
+		}
+
 		/*
 		 * In theory, we could coalesce more requests onto
 		 * the second port (the first port is active, with
@@ -711,6 +1038,9 @@ static void execlists_dequeue(struct intel_engine_cs *engine)
 				port++;
 
 				GEM_BUG_ON(port_isset(port));
+			} else if (last) {
+				/* Folded into the RING_TAIL of the port */
+				engine->pmu.sample[I915_SAMPLE_COALESCED].cur++;
 			}
 
 			INIT_LIST_HEAD(&rq->sched.link);
@@ -739,9 +1069,9 @@ static void execlists_dequeue(struct intel_engine_cs *engine)
 	 * the priority of the lowest executing request, i.e. last.
 	 *
 	 * When we do receive a higher priority request ready to run from the
-	 * user, see queue_request(), the queue_priority is bumped to that
-	 * request triggering preemption on the next dequeue (or subsequent
-	 * interrupt for secondary ports).
+	 * user, see execlists_flush_submit_queue(), the queue_priority is
+	 * bumped to that request triggering preemption on the next dequeue
+	 * (or subsequent interrupt for secondary ports).
 	 */
 	execlists->queue_priority =
 		port != execlists->port ? rq_prio(last) : INT_MIN;
@@ -794,6 +1124,10 @@ execlists_cancel_port_requests(struct intel_engine_execlists * const execlists)
 	}
 
 	execlists_clear_all_active(execlists);
+	cancel_timeslice(execlists);
+	execlists_update_port_idle(container_of(execlists,
+						struct intel_engine_cs,
+						execlists));
 }
 
 static void reset_csb_pointers(struct intel_engine_execlists *execlists)
@@ -844,6 +1178,7 @@ static void execlists_cancel_requests(struct intel_engine_cs *engine)
 
 	/* Cancel the requests on the HW and clear the ELSP tracker. */
 	execlists_cancel_port_requests(execlists);
+	execlists->yield = NULL;
 	execlists_user_end(execlists);
 
 	/* Mark all executing requests as skipped. */
@@ -854,6 +1189,7 @@ static void execlists_cancel_requests(struct intel_engine_cs *engine)
 	}
 
 	/* Flush the queued requests to the timeline list (for retiring). */
+	execlists_flush_submit_queue(execlists);
 	while ((rb = rb_first_cached(&execlists->queue))) {
 		struct i915_priolist *p = to_priolist(rb);
 
@@ -970,9 +1306,11 @@ static void process_csb(struct intel_engine_cs *engine)
 
 		status = buf[2 * head];
 		if (status & (GEN8_CTX_STATUS_IDLE_ACTIVE |
-			      GEN8_CTX_STATUS_PREEMPTED))
+			      GEN8_CTX_STATUS_PREEMPTED)) {
 			execlists_set_active(execlists,
 					     EXECLISTS_ACTIVE_HWACK);
+			record_start(port_request(port));
+		}
 		if (status & GEN8_CTX_STATUS_ACTIVE_IDLE)
 			execlists_clear_active(execlists,
 					       EXECLISTS_ACTIVE_HWACK);
@@ -1050,10 +1388,15 @@ static void process_csb(struct intel_engine_cs *engine)
 				  engine->name, port->context_id);
 
 			port = execlists_port_complete(execlists, port);
-			if (port_isset(port))
+			if (port_isset(port)) {
 				execlists_user_begin(execlists, port);
-			else
+				start_timeslice(execlists);
+				record_start(port_request(port));
+			} else {
 				execlists_user_end(execlists);
+				cancel_timeslice(execlists);
+			}
+			execlists_update_port_idle(engine);
 		} else {
 			port_set(port, port_pack(rq, count));
 		}
@@ -1066,6 +1409,8 @@ static void __execlists_submission_tasklet(struct intel_engine_cs *const engine)
 {
 	lockdep_assert_held(&engine->timeline.lock);
 
+	execlists_flush_submit_queue(&engine->execlists);
+
 	process_csb(engine);
 	if (!execlists_is_active(&engine->execlists, EXECLISTS_ACTIVE_PREEMPT))
 		execlists_dequeue(engine);
@@ -1090,56 +1435,100 @@ static void execlists_submission_tasklet(unsigned long data)
 	spin_unlock_irqrestore(&engine->timeline.lock, flags);
 }
 
-static void queue_request(struct intel_engine_cs *engine,
-			  struct i915_sched_node *node,
-			  int prio)
+static void execlists_irq_steer(void *data)
 {
-	list_add_tail(&node->link,
-		      &lookup_priolist(engine, prio)->requests);
-}
+	struct intel_engine_execlists *execlists = data;
 
-static void __update_queue(struct intel_engine_cs *engine, int prio)
-{
-	engine->execlists.queue_priority = prio;
+	clear_bit(0, &execlists->irq_steer.pending);
+	tasklet_hi_schedule(&execlists->tasklet);
 }
 
-static void __submit_queue_imm(struct intel_engine_cs *engine)
+/**
+ * intel_engine_kick_irq_tasklet() - schedule the engine's interrupt bottom half
+ * @engine: the engine that raised the interrupt
+ *
+ * All engines share a single interrupt vector, so left alone the CSB
+ * processing for every engine ends up on whichever CPU services the MSI,
+ * saturating it under heavy multi-engine load. With i915.steer_engine_irqs
+ * each engine is given its own CPU and the tasklet is raised there by an
+ * IPI instead, spreading the bottom halves across the cores.
+ *
+ * Engines selected by i915.csb_in_irq skip the tasklet altogether where
+ * possible and are serviced immediately from the interrupt.
+ */
+void intel_engine_kick_irq_tasklet(struct intel_engine_cs *engine)
 {
 	struct intel_engine_execlists * const execlists = &engine->execlists;
+	int cpu;
+
+	/*
+	 * If the tasklet is postponed to ksoftirqd, the GPU may sit idle
+	 * for milliseconds waiting for its next ELSP write. For the engines
+	 * where that matters, process the CSB and resubmit directly from
+	 * the interrupt instead. The cost is bounded: at most a CSB's worth
+	 * of events and filling the ELSP ports. If anyone else is already
+	 * busy with the engine, or it is being reset, leave it to them and
+	 * the tasklet.
+	 */
+	if (intel_engine_csb_in_irq(engine) &&
+	    !reset_in_progress(execlists) &&
+	    spin_trylock(&engine->timeline.lock)) {
+		bool done = false;
+
+		GEM_BUG_ON(!irqs_disabled());
+		if (!reset_in_progress(execlists)) {
+			__execlists_submission_tasklet(engine);
+			done = true;
+		}
+		spin_unlock(&engine->timeline.lock);
+		if (done)
+			return;
+	}
 
-	if (reset_in_progress(execlists))
-		return; /* defer until we restart the engine following reset */
+	cpu = READ_ONCE(execlists->irq_steer.cpu);
+	if (cpu < 0 || cpu == smp_processor_id() || !cpu_online(cpu))
+		goto local;
 
-	if (execlists->tasklet.func == execlists_submission_tasklet)
-		__execlists_submission_tasklet(engine);
-	else
-		tasklet_hi_schedule(&execlists->tasklet);
+	/* Already on its way, the tasklet will see this CSB update too */
+	if (test_bit(TASKLET_STATE_SCHED, &execlists->tasklet.state))
+		return;
+
+	/* The csd may only be in flight once, see smp_call_function_single_async() */
+	if (test_and_set_bit(0, &execlists->irq_steer.pending))
+		return;
+
+	if (!smp_call_function_single_async(cpu, &execlists->irq_steer.csd))
+		return;
+
+	clear_bit(0, &execlists->irq_steer.pending);
+local:
+	tasklet_hi_schedule(&execlists->tasklet);
 }
 
-static void submit_queue(struct intel_engine_cs *engine, int prio)
+static void __update_queue(struct intel_engine_cs *engine, int prio)
 {
-	if (prio > engine->execlists.queue_priority) {
-		__update_queue(engine, prio);
-		__submit_queue_imm(engine);
-	}
+	engine->execlists.queue_priority = prio;
 }
 
 static void execlists_submit_request(struct i915_request *request)
 {
-	struct intel_engine_cs *engine = request->engine;
-	unsigned long flags;
-
-	/* Will be called from irq-context when using foreign fences. */
-	spin_lock_irqsave(&engine->timeline.lock, flags);
-
-	queue_request(engine, &request->sched, rq_prio(request));
-
-	GEM_BUG_ON(RB_EMPTY_ROOT(&engine->execlists.queue.rb_root));
-	GEM_BUG_ON(list_empty(&request->sched.link));
+	struct intel_engine_execlists * const execlists =
+		&request->engine->execlists;
 
-	submit_queue(engine, rq_prio(request));
-
-	spin_unlock_irqrestore(&engine->timeline.lock, flags);
+	/*
+	 * Will be called from irq-context when using foreign fences.
+	 *
+	 * Rather than contend on the timeline lock with the tasklet (and
+	 * every other submitter), we push the request onto the lockless
+	 * submit_queue and leave it to the tasklet to sort it into the
+	 * priority queue. Only the first submitter to find the list empty
+	 * needs to kick the tasklet; i915_request_add() runs us with bh
+	 * disabled so that the tasklet is run as soon as we return.
+	 */
+	GEM_BUG_ON(!list_empty(&request->sched.link));
+	if (llist_add(&request->submit_link, &execlists->submit_queue) &&
+	    !reset_in_progress(execlists))
+		tasklet_hi_schedule(&execlists->tasklet);
 }
 
 static struct i915_request *sched_to_request(struct i915_sched_node *node)
@@ -1162,14 +1551,54 @@ sched_lock_engine(struct i915_sched_node *node, struct intel_engine_cs *locked)
 	return engine;
 }
 
+static bool need_bump(const struct i915_sched_attr *node,
+		      const struct i915_sched_attr *attr)
+{
+	return (attr->priority > READ_ONCE(node->priority) ||
+		deadline_before(attr->deadline, READ_ONCE(node->deadline)));
+}
+
+/*
+ * Upper bound on the number of dependencies we are prepared to inspect for
+ * a single bump. Past that, the bump is abandoned: it is only advisory, the
+ * fences still ensure the correct execution order.
+ */
+#define SCHED_WALK_MAX 4096
+
+static void clamp_to_signalers(const struct i915_sched_node *node,
+			       struct i915_sched_attr *attr)
+{
+	const struct i915_dependency *p;
+
+	/*
+	 * Our signalers must never be of a lower priority, or of a later
+	 * deadline, than ourselves, as otherwise we may be queued ahead of
+	 * the requests before us in the ring. As they already respect that
+	 * amongst themselves, we only have to look at our direct signalers.
+	 */
+	list_for_each_entry(p, &node->signalers_list, signal_link) {
+		const struct i915_sched_attr *sig = &p->signaler->attr;
+
+		if (i915_sched_node_signaled(p->signaler) ||
+		    sig->priority == I915_PRIORITY_INVALID)
+			continue;
+
+		if (sig->priority < attr->priority)
+			attr->priority = sig->priority;
+		if (deadline_before(attr->deadline, sig->deadline))
+			attr->deadline = sig->deadline;
+	}
+}
+
 static void execlists_schedule(struct i915_request *request,
 			       const struct i915_sched_attr *attr)
 {
 	struct i915_priolist *uninitialized_var(pl);
 	struct intel_engine_cs *engine, *last;
-	struct i915_dependency *dep, *p;
-	struct i915_dependency stack;
+	struct i915_sched_node *node, *next;
+	struct i915_dependency *p;
 	const int prio = attr->priority;
+	unsigned int walk = 0;
 	LIST_HEAD(dfs);
 
 	GEM_BUG_ON(prio == I915_PRIORITY_INVALID);
@@ -1177,17 +1606,18 @@ static void execlists_schedule(struct i915_request *request,
 	if (i915_request_completed(request))
 		return;
 
-	if (prio <= READ_ONCE(request->sched.attr.priority))
+	if (!need_bump(&request->sched.attr, attr))
 		return;
 
-	/* Need BKL in order to use the temporary link inside i915_dependency */
+	/* Need BKL in order to use the temporary link inside i915_sched_node */
 	lockdep_assert_held(&request->i915->drm.struct_mutex);
 
-	stack.signaler = &request->sched;
-	list_add(&stack.dfs_link, &dfs);
+	GEM_BUG_ON(!list_empty(&request->sched.dfs_link));
+	list_add(&request->sched.dfs_link, &dfs);
 
 	/*
-	 * Recursively bump all dependent priorities to match the new request.
+	 * Recursively bump all dependent priorities (and deadlines) to match
+	 * the new request.
 	 *
 	 * A naive approach would be to use recursion:
 	 * static void update_priorities(struct i915_sched_node *node, prio) {
@@ -1203,10 +1633,14 @@ static void execlists_schedule(struct i915_request *request,
 	 * request) and continue to walk onwards onto the new dependencies. The
 	 * end result is a topological list of requests in reverse order, the
 	 * last element in the list is the request we must execute first.
+	 *
+	 * The list is of nodes rather than of their dependencies, so that a
+	 * request found along several paths (e.g. as both the previous
+	 * request on the timeline and the last writer of a buffer) is only
+	 * kept once, and we prune every subgraph that has either been
+	 * signaled already or has already been bumped at least this far.
 	 */
-	list_for_each_entry(dep, &dfs, dfs_link) {
-		struct i915_sched_node *node = dep->signaler;
-
+	list_for_each_entry(node, &dfs, dfs_link) {
 		/*
 		 * Within an engine, there can be no cycle, but we may
 		 * refer to the same dependency chain multiple times
@@ -1214,14 +1648,17 @@ static void execlists_schedule(struct i915_request *request,
 		 * engines.
 		 */
 		list_for_each_entry(p, &node->signalers_list, signal_link) {
-			GEM_BUG_ON(p == dep); /* no cycles! */
+			GEM_BUG_ON(p->signaler == node); /* no cycles! */
+
+			if (unlikely(++walk > SCHED_WALK_MAX))
+				goto abort;
 
 			if (i915_sched_node_signaled(p->signaler))
 				continue;
 
 			GEM_BUG_ON(p->signaler->attr.priority < node->attr.priority);
-			if (prio > READ_ONCE(p->signaler->attr.priority))
-				list_move_tail(&p->dfs_link, &dfs);
+			if (need_bump(&p->signaler->attr, attr))
+				list_move_tail(&p->signaler->dfs_link, &dfs);
 		}
 	}
 
@@ -1234,9 +1671,9 @@ static void execlists_schedule(struct i915_request *request,
 	if (request->sched.attr.priority == I915_PRIORITY_INVALID) {
 		GEM_BUG_ON(!list_empty(&request->sched.link));
 		request->sched.attr = *attr;
-		if (stack.dfs_link.next == stack.dfs_link.prev)
+		list_del_init(&request->sched.dfs_link);
+		if (list_empty(&dfs))
 			return;
-		__list_del_entry(&stack.dfs_link);
 	}
 
 	last = NULL;
@@ -1244,35 +1681,56 @@ static void execlists_schedule(struct i915_request *request,
 	spin_lock_irq(&engine->timeline.lock);
 
 	/* Fifo and depth-first replacement ensure our deps execute before us */
-	list_for_each_entry_safe_reverse(dep, p, &dfs, dfs_link) {
-		struct i915_sched_node *node = dep->signaler;
-
-		INIT_LIST_HEAD(&dep->dfs_link);
+	list_for_each_entry_safe_reverse(node, next, &dfs, dfs_link) {
+		INIT_LIST_HEAD(&node->dfs_link);
 
 		engine = sched_lock_engine(node, engine);
 
-		if (prio <= node->attr.priority)
+		if (!need_bump(&node->attr, attr))
 			continue;
 
-		node->attr.priority = prio;
+		if (prio > node->attr.priority)
+			node->attr.priority = prio;
+		if (deadline_before(attr->deadline, node->attr.deadline))
+			node->attr.deadline = attr->deadline;
+
 		if (!list_empty(&node->link)) {
-			if (last != engine) {
-				pl = lookup_priolist(engine, prio);
+			const int node_prio = node->attr.priority;
+
+			if (last != engine || pl->priority != node_prio) {
+				pl = lookup_priolist(engine, node_prio);
 				last = engine;
 			}
-			GEM_BUG_ON(pl->priority != prio);
-			list_move_tail(&node->link, &pl->requests);
+			GEM_BUG_ON(pl->priority != node->attr.priority);
+			list_del(&node->link);
+			priolist_add_tail(pl, sched_to_request(node));
 		}
 
-		if (prio > engine->execlists.queue_priority &&
+		if (node->attr.priority > engine->execlists.queue_priority &&
 		    i915_sw_fence_done(&sched_to_request(node)->submit)) {
 			/* defer submission until after all of our updates */
-			__update_queue(engine, prio);
+			__update_queue(engine, node->attr.priority);
 			tasklet_hi_schedule(&engine->execlists.tasklet);
 		}
 	}
 
 	spin_unlock_irq(&engine->timeline.lock);
+	return;
+
+abort:
+	list_for_each_entry_safe(node, next, &dfs, dfs_link)
+		INIT_LIST_HEAD(&node->dfs_link);
+
+	/*
+	 * A new request must still be given its attributes, so take what
+	 * we asked for but no more than our signalers already have.
+	 */
+	if (request->sched.attr.priority == I915_PRIORITY_INVALID) {
+		struct i915_sched_attr clamp = *attr;
+
+		clamp_to_signalers(&request->sched, &clamp);
+		request->sched.attr = clamp;
+	}
 }
 
 static void execlists_context_destroy(struct intel_context *ce)
@@ -1290,6 +1748,8 @@ static void execlists_context_destroy(struct intel_context *ce)
 
 static void execlists_context_unpin(struct intel_context *ce)
 {
+	i915_gem_context_unpin_hw_id(ce->gem_context);
+
 	intel_ring_unpin(ce->ring);
 
 	ce->state->obj->pin_global--;
@@ -1348,6 +1808,10 @@ __execlists_context_pin(struct intel_engine_cs *engine,
 	if (ret)
 		goto unpin_map;
 
+	ret = i915_gem_context_pin_hw_id(ctx);
+	if (ret)
+		goto unpin_ring;
+
 	intel_lr_context_descriptor_update(ctx, engine, ce);
 
 	ce->lrc_reg_state = vaddr + LRC_STATE_PN * PAGE_SIZE;
@@ -1360,6 +1824,8 @@ __execlists_context_pin(struct intel_engine_cs *engine,
 	i915_gem_context_get(ctx);
 	return ce;
 
+unpin_ring:
+	intel_ring_unpin(ce->ring);
 unpin_map:
 	i915_gem_object_unpin_map(ce->state->obj);
 unpin_vma:
@@ -1382,13 +1848,19 @@ execlists_context_pin(struct intel_engine_cs *engine,
 
 	lockdep_assert_held(&ctx->i915->drm.struct_mutex);
 
-	if (likely(ce->pin_count++))
+	if (likely(ce->pin_count++)) {
+		intel_context_pin_cache_touch(ce);
 		return ce;
+	}
 	GEM_BUG_ON(!ce->pin_count); /* no overflow please! */
 
 	ce->ops = &execlists_context_ops;
 
-	return __execlists_context_pin(engine, ctx, ce);
+	ce = __execlists_context_pin(engine, ctx, ce);
+	if (!IS_ERR(ce))
+		intel_context_pin_cache_add(ce);
+
+	return ce;
 }
 
 static int execlists_request_alloc(struct i915_request *request)
@@ -1415,6 +1887,14 @@ static int execlists_request_alloc(struct i915_request *request)
 	 */
 
 	request->reserved_space -= EXECLISTS_REQUEST_SIZE;
+
+	/* Pick up any change of OA metric set before the context's payload */
+	if (request->engine->id == RCS) {
+		ret = i915_oa_emit_ctx_config(request);
+		if (ret)
+			return ret;
+	}
+
 	return 0;
 }
 
@@ -1927,6 +2407,7 @@ static void execlists_reset(struct intel_engine_cs *engine,
 	 * requests were completed.
 	 */
 	execlists_cancel_port_requests(execlists);
+	execlists->yield = NULL;
 
 	/* Push back any incomplete requests for replay after the reset. */
 	__unwind_incomplete_requests(engine);
@@ -1984,7 +2465,8 @@ static void execlists_reset_finish(struct intel_engine_cs *engine)
 	struct intel_engine_execlists * const execlists = &engine->execlists;
 
 	/* After a GPU reset, we may have requests to replay */
-	if (!RB_EMPTY_ROOT(&execlists->queue.rb_root))
+	if (!RB_EMPTY_ROOT(&execlists->queue.rb_root) ||
+	    !llist_empty(&execlists->submit_queue))
 		tasklet_schedule(&execlists->tasklet);
 
 	/*
@@ -2029,6 +2511,40 @@ static int intel_logical_ring_emit_pdps(struct i915_request *rq)
 	return 0;
 }
 
+#define WATCHDOG_ADAPTIVE_MIN_SAMPLES	16
+#define WATCHDOG_ADAPTIVE_MIN_US	1000
+
+static u32 watchdog_threshold(struct i915_request *rq)
+{
+	const struct intel_context *ce = rq->hw_context;
+	const struct intel_context_runtime_hist *hist = &ce->runtime_hist;
+	unsigned int pct = rq->gem_context->watchdog_percentile;
+	unsigned int sum, target, i;
+	u32 threshold;
+
+	if (!pct || !rq->engine->emit_start_watchdog ||
+	    READ_ONCE(hist->count) < WATCHDOG_ADAPTIVE_MIN_SAMPLES)
+		return ce->watchdog_threshold;
+
+	/* The percentile falls within bucket i, i.e. below 2^(i+1) us */
+	target = DIV_ROUND_UP(READ_ONCE(hist->count) * pct, 100);
+	sum = 0;
+	for (i = 0; i < INTEL_RUNTIME_BUCKETS - 1; i++) {
+		sum += READ_ONCE(hist->bucket[i]);
+		if (sum >= target)
+			break;
+	}
+
+	/* Allow for twice the percentile, but not so little as to misfire */
+	threshold = watchdog_to_clock_counts(rq->i915,
+					     max_t(u64, 2ull << (i + 1),
+						   WATCHDOG_ADAPTIVE_MIN_US));
+	if (threshold == -EINVAL)
+		return ce->watchdog_threshold;
+
+	return threshold;
+}
+
 static int gen8_emit_bb_start(struct i915_request *rq,
 			      u64 offset, u32 len,
 			      const unsigned int flags)
@@ -2060,7 +2576,8 @@ static int gen8_emit_bb_start(struct i915_request *rq,
 	num_dwords = 6;
 
 	/* check if watchdog will be required */
-	if (to_intel_context(rq->gem_context, engine)->watchdog_threshold != 0) {
+	rq->watchdog_threshold = watchdog_threshold(rq);
+	if (rq->watchdog_threshold != 0) {
 		GEM_BUG_ON(!engine->emit_start_watchdog ||
 			   !engine->emit_stop_watchdog);
 
@@ -2280,12 +2797,16 @@ static void gen8_watchdog_irq_handler(unsigned long data)
 		engine->hangcheck.acthd = intel_engine_get_active_head(engine);
 		engine->hangcheck.seqno = current_seqno;
 
-		/* And try to run the hangcheck_work as soon as possible */
+		/*
+		 * The context has now overrun its threshold and made no
+		 * progress during the grace period, so reset it right away
+		 * instead of leaving it to the periodic sampling.
+		 */
 		set_bit(I915_RESET_WATCHDOG, &dev_priv->gpu_error.flags);
-		queue_delayed_work(system_long_wq,
-				   &dev_priv->gpu_error.hangcheck_work,
-				   round_jiffies_up_relative(HZ));
+		i915_kick_hangcheck(dev_priv);
 	} else {
+		engine->pmu.sample[I915_SAMPLE_WATCHDOG].cur++;
+
 		engine->hangcheck.watchdog = current_seqno;
 		/* Re-start the counter, if really hung, it will expire again */
 		I915_WRITE_FW(RING_THRESH(engine->mmio_base),
@@ -2300,8 +2821,6 @@ static void gen8_watchdog_irq_handler(unsigned long data)
 static u32 *gen8_emit_start_watchdog(struct i915_request *rq, u32 *cs)
 {
 	struct intel_engine_cs *engine = rq->engine;
-	struct i915_gem_context *ctx = rq->gem_context;
-	struct intel_context *ce = to_intel_context(ctx, engine);
 
 	/* XXX: no watchdog support in BCS engine */
 	GEM_BUG_ON(engine->id == BCS);
@@ -2311,12 +2830,12 @@ static u32 *gen8_emit_start_watchdog(struct i915_request *rq, u32 *cs)
 	 * cause the watchdog counter to exceed and not allow the engine to
 	 * go into IDLE state
 	 */
-	GEM_BUG_ON(ce->watchdog_threshold == 0);
+	GEM_BUG_ON(rq->watchdog_threshold == 0);
 
 	/* Set counter period */
 	*cs++ = MI_LOAD_REGISTER_IMM(2);
 	*cs++ = i915_mmio_reg_offset(RING_THRESH(engine->mmio_base));
-	*cs++ = ce->watchdog_threshold;
+	*cs++ = rq->watchdog_threshold;
 	/* Start counter */
 	*cs++ = i915_mmio_reg_offset(RING_CNTR(engine->mmio_base));
 	*cs++ = GEN8_WATCHDOG_ENABLE;
@@ -2360,7 +2879,8 @@ static void gen8_emit_breadcrumb(struct i915_request *request, u32 *cs)
 
 	cs = gen8_emit_ggtt_write(cs, request->global_seqno,
 				  intel_hws_seqno_address(request->engine));
-	*cs++ = MI_USER_INTERRUPT;
+	*cs++ = intel_engine_breadcrumb_irq(request->engine, request) ?
+		MI_USER_INTERRUPT : MI_NOOP;
 	*cs++ = MI_ARB_ON_OFF | MI_ARB_ENABLE;
 	request->tail = intel_ring_offset(request, cs);
 	assert_ring_tail_valid(request->ring, request->tail);
@@ -2376,7 +2896,8 @@ static void gen8_emit_breadcrumb_rcs(struct i915_request *request, u32 *cs)
 
 	cs = gen8_emit_ggtt_write_rcs(cs, request->global_seqno,
 				      intel_hws_seqno_address(request->engine));
-	*cs++ = MI_USER_INTERRUPT;
+	*cs++ = intel_engine_breadcrumb_irq(request->engine, request) ?
+		MI_USER_INTERRUPT : MI_NOOP;
 	*cs++ = MI_ARB_ON_OFF | MI_ARB_ENABLE;
 	request->tail = intel_ring_offset(request, cs);
 	assert_ring_tail_valid(request->ring, request->tail);
@@ -2501,6 +3022,9 @@ void intel_logical_ring_cleanup(struct intel_engine_cs *engine)
 	 * Tasklet cannot be active at this point due intel_mark_active/idle
 	 * so this is just for documentation.
 	 */
+	while (READ_ONCE(engine->execlists.irq_steer.pending))
+		cpu_relax();
+
 	if (WARN_ON(test_bit(TASKLET_STATE_SCHED,
 			     &engine->execlists.tasklet.state)))
 		tasklet_kill(&engine->execlists.tasklet);
@@ -2508,6 +3032,8 @@ void intel_logical_ring_cleanup(struct intel_engine_cs *engine)
 	if (WARN_ON(test_bit(TASKLET_STATE_SCHED, &engine->execlists.watchdog_tasklet.state)))
 		tasklet_kill(&engine->execlists.watchdog_tasklet);
 
+	del_timer_sync(&engine->execlists.timeslice);
+
 	dev_priv = engine->i915;
 
 	if (engine->buffer) {
@@ -2517,6 +3043,8 @@ void intel_logical_ring_cleanup(struct intel_engine_cs *engine)
 	if (engine->cleanup)
 		engine->cleanup(engine);
 
+	lrc_pool_fini(engine);
+
 	intel_engine_cleanup_common(engine);
 
 	lrc_destroy_wa_ctx(engine);
@@ -2541,10 +3069,13 @@ void intel_execlists_set_default_submission(struct intel_engine_cs *engine)
 	engine->flags |= I915_ENGINE_SUPPORTS_STATS;
 	if (engine->i915->preempt_context)
 		engine->flags |= I915_ENGINE_HAS_PREEMPTION;
+	if (i915_modparams.csb_in_irq & ENGINE_MASK(engine->id))
+		engine->flags |= I915_ENGINE_CSB_IN_IRQ;
 
 	engine->i915->caps.scheduler =
 		I915_SCHEDULER_CAP_ENABLED |
-		I915_SCHEDULER_CAP_PRIORITY;
+		I915_SCHEDULER_CAP_PRIORITY |
+		I915_SCHEDULER_CAP_DEADLINE;
 	if (intel_engine_has_preemption(engine))
 		engine->i915->caps.scheduler |= I915_SCHEDULER_CAP_PREEMPTION;
 }
@@ -2633,6 +3164,13 @@ logical_ring_setup(struct intel_engine_cs *engine)
 	tasklet_init(&engine->execlists.watchdog_tasklet,
 		     gen8_watchdog_irq_handler, (unsigned long)engine);
 
+	irq_steer_init(engine);
+
+	timer_setup(&engine->execlists.timeslice, execlists_timeslice, 0);
+
+	INIT_LIST_HEAD(&engine->context_pool.list);
+	INIT_DELAYED_WORK(&engine->context_pool.refill, lrc_pool_refill);
+
 	logical_ring_default_vfuncs(engine);
 	logical_ring_default_irqs(engine);
 }
@@ -2924,7 +3462,8 @@ static int
 populate_lr_context(struct i915_gem_context *ctx,
 		    struct drm_i915_gem_object *ctx_obj,
 		    struct intel_engine_cs *engine,
-		    struct intel_ring *ring)
+		    struct intel_ring *ring,
+		    bool prefilled)
 {
 	void *vaddr;
 	u32 *regs;
@@ -2944,7 +3483,8 @@ populate_lr_context(struct i915_gem_context *ctx,
 	}
 	ctx_obj->mm.dirty = true;
 
-	if (engine->default_state) {
+	if (engine->default_state && !prefilled &&
+	    !i915_gem_context_is_stateless(ctx)) {
 		/*
 		 * We only want to copy over the template context state;
 		 * skipping over the headers reserved for GuC communication,
@@ -2968,7 +3508,7 @@ populate_lr_context(struct i915_gem_context *ctx,
 	 * be set up prior to the first execution. */
 	regs = vaddr + LRC_STATE_PN * PAGE_SIZE;
 	execlists_init_reg_state(regs, ctx, engine, ring);
-	if (!engine->default_state)
+	if (!engine->default_state || i915_gem_context_is_stateless(ctx))
 		regs[CTX_CONTEXT_CONTROL + 1] |=
 			_MASKED_BIT_ENABLE(CTX_CTRL_ENGINE_CTX_RESTORE_INHIBIT);
 	if (ctx == ctx->i915->preempt_context && INTEL_GEN(engine->i915) < 11)
@@ -2981,52 +3521,209 @@ populate_lr_context(struct i915_gem_context *ctx,
 	return ret;
 }
 
+static u32 lrc_context_size(const struct intel_engine_cs *engine)
+{
+	u32 context_size = round_up(engine->context_size, I915_GTT_PAGE_SIZE);
+
+	/*
+	 * Before the actual start of the context image, we insert a few pages
+	 * for our own use and for sharing with the GuC.
+	 */
+	return context_size + LRC_HEADER_PAGES * PAGE_SIZE;
+}
+
+#define LRC_POOL_SIZE 4
+#define LRC_POOL_RING_SIZE (4 * PAGE_SIZE) /* the default ctx->ring_size */
+
+struct lrc_pool_entry {
+	struct list_head link;
+	struct drm_i915_gem_object *obj;
+	struct intel_ring *ring;
+};
+
+static struct lrc_pool_entry *lrc_pool_create(struct intel_engine_cs *engine)
+{
+	struct drm_i915_private *i915 = engine->i915;
+	const unsigned long start = LRC_HEADER_PAGES * PAGE_SIZE;
+	struct lrc_pool_entry *entry;
+	struct i915_timeline *timeline;
+	void *vaddr, *defaults;
+	int err;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+	GEM_BUG_ON(!engine->default_state);
+
+	entry = kmalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		return ERR_PTR(-ENOMEM);
+
+	entry->obj = i915_gem_object_create(i915, lrc_context_size(engine));
+	if (IS_ERR(entry->obj)) {
+		err = PTR_ERR(entry->obj);
+		goto err_free;
+	}
+
+	err = i915_gem_object_set_to_cpu_domain(entry->obj, true);
+	if (err)
+		goto err_obj;
+
+	vaddr = i915_gem_object_pin_map(entry->obj, I915_MAP_WB);
+	if (IS_ERR(vaddr)) {
+		err = PTR_ERR(vaddr);
+		goto err_obj;
+	}
+
+	defaults = i915_gem_object_pin_map(engine->default_state, I915_MAP_WB);
+	if (IS_ERR(defaults)) {
+		i915_gem_object_unpin_map(entry->obj);
+		err = PTR_ERR(defaults);
+		goto err_obj;
+	}
+
+	/* As populate_lr_context(), leaving the GuC headers as zero */
+	memcpy(vaddr + start, defaults + start, engine->context_size);
+	i915_gem_object_unpin_map(engine->default_state);
+
+	entry->obj->mm.dirty = true;
+	i915_gem_object_unpin_map(entry->obj);
+
+	timeline = i915_timeline_create(i915, engine->name);
+	if (IS_ERR(timeline)) {
+		err = PTR_ERR(timeline);
+		goto err_obj;
+	}
+
+	entry->ring = intel_engine_create_ring(engine, timeline,
+					       LRC_POOL_RING_SIZE);
+	i915_timeline_put(timeline);
+	if (IS_ERR(entry->ring)) {
+		err = PTR_ERR(entry->ring);
+		goto err_obj;
+	}
+
+	return entry;
+
+err_obj:
+	i915_gem_object_put(entry->obj);
+err_free:
+	kfree(entry);
+	return ERR_PTR(err);
+}
+
+static void lrc_pool_refill(struct work_struct *work)
+{
+	struct intel_engine_cs *engine =
+		container_of(work, typeof(*engine), context_pool.refill.work);
+	struct drm_i915_private *i915 = engine->i915;
+	struct lrc_pool_entry *entry;
+
+	/* Come back later if the device is busy, one image at a time */
+	if (!mutex_trylock(&i915->drm.struct_mutex)) {
+		queue_delayed_work(i915->wq, &engine->context_pool.refill, 1);
+		return;
+	}
+
+	if (engine->context_pool.count < LRC_POOL_SIZE) {
+		entry = lrc_pool_create(engine);
+		if (!IS_ERR(entry)) {
+			list_add_tail(&entry->link, &engine->context_pool.list);
+			if (++engine->context_pool.count < LRC_POOL_SIZE)
+				queue_delayed_work(i915->wq,
+						   &engine->context_pool.refill,
+						   0);
+		}
+	}
+
+	mutex_unlock(&i915->drm.struct_mutex);
+}
+
+static struct lrc_pool_entry *lrc_pool_get(struct intel_engine_cs *engine,
+					   struct i915_gem_context *ctx)
+{
+	struct lrc_pool_entry *entry;
+
+	lockdep_assert_held(&engine->i915->drm.struct_mutex);
+
+	/* Only once we have the defaults to prepare the images from */
+	if (!engine->default_state || ctx->ring_size != LRC_POOL_RING_SIZE)
+		return NULL;
+
+	entry = list_first_entry_or_null(&engine->context_pool.list,
+					 typeof(*entry), link);
+	if (entry) {
+		list_del(&entry->link);
+		engine->context_pool.count--;
+	}
+
+	queue_delayed_work(engine->i915->wq, &engine->context_pool.refill, 0);
+	return entry;
+}
+
+static void lrc_pool_fini(struct intel_engine_cs *engine)
+{
+	struct lrc_pool_entry *entry, *next;
+
+	cancel_delayed_work_sync(&engine->context_pool.refill);
+
+	list_for_each_entry_safe(entry, next,
+				 &engine->context_pool.list, link) {
+		intel_ring_free(entry->ring);
+		i915_gem_object_put(entry->obj);
+		kfree(entry);
+	}
+	INIT_LIST_HEAD(&engine->context_pool.list);
+	engine->context_pool.count = 0;
+}
+
 static int execlists_context_deferred_alloc(struct i915_gem_context *ctx,
 					    struct intel_engine_cs *engine,
 					    struct intel_context *ce)
 {
 	struct drm_i915_gem_object *ctx_obj;
+	struct lrc_pool_entry *entry;
 	struct i915_vma *vma;
-	uint32_t context_size;
 	struct intel_ring *ring;
 	struct i915_timeline *timeline;
+	bool prefilled;
 	int ret;
 
 	if (ce->state)
 		return 0;
 
-	context_size = round_up(engine->context_size, I915_GTT_PAGE_SIZE);
-
-	/*
-	 * Before the actual start of the context image, we insert a few pages
-	 * for our own use and for sharing with the GuC.
-	 */
-	context_size += LRC_HEADER_PAGES * PAGE_SIZE;
+	entry = lrc_pool_get(engine, ctx);
+	prefilled = entry;
+	if (entry) {
+		ctx_obj = entry->obj;
+		ring = entry->ring;
+		kfree(entry);
+	} else {
+		ctx_obj = i915_gem_object_create(ctx->i915,
+						 lrc_context_size(engine));
+		if (IS_ERR(ctx_obj))
+			return PTR_ERR(ctx_obj);
+
+		timeline = i915_timeline_create(ctx->i915, ctx->name);
+		if (IS_ERR(timeline)) {
+			ret = PTR_ERR(timeline);
+			goto error_deref_obj;
+		}
 
-	ctx_obj = i915_gem_object_create(ctx->i915, context_size);
-	if (IS_ERR(ctx_obj))
-		return PTR_ERR(ctx_obj);
+		ring = intel_engine_create_ring(engine, timeline,
+						ctx->ring_size);
+		i915_timeline_put(timeline);
+		if (IS_ERR(ring)) {
+			ret = PTR_ERR(ring);
+			goto error_deref_obj;
+		}
+	}
 
 	vma = i915_vma_instance(ctx_obj, &ctx->i915->ggtt.vm, NULL);
 	if (IS_ERR(vma)) {
 		ret = PTR_ERR(vma);
-		goto error_deref_obj;
-	}
-
-	timeline = i915_timeline_create(ctx->i915, ctx->name);
-	if (IS_ERR(timeline)) {
-		ret = PTR_ERR(timeline);
-		goto error_deref_obj;
-	}
-
-	ring = intel_engine_create_ring(engine, timeline, ctx->ring_size);
-	i915_timeline_put(timeline);
-	if (IS_ERR(ring)) {
-		ret = PTR_ERR(ring);
-		goto error_deref_obj;
+		goto error_ring_free;
 	}
 
-	ret = populate_lr_context(ctx, ctx_obj, engine, ring);
+	ret = populate_lr_context(ctx, ctx_obj, engine, ring, prefilled);
 	if (ret) {
 		DRM_DEBUG_DRIVER("Failed to populate LRC: %d\n", ret);
 		goto error_ring_free;
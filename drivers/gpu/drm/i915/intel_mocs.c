@@ -25,11 +25,6 @@
 #include "intel_ringbuffer.h"
 
 /* structures required */
-struct drm_i915_mocs_entry {
-	u32 control_value;
-	u16 l3cc_value;
-};
-
 struct drm_i915_mocs_table {
 	u32 size;
 	const struct drm_i915_mocs_entry *table;
@@ -50,9 +45,6 @@ struct drm_i915_mocs_table {
 #define L3_SCC(value)		((value) << 1)
 #define L3_CACHEABILITY(value)	((value) << 4)
 
-/* Helper defines */
-#define GEN9_NUM_MOCS_ENTRIES	62  /* 62 out of 64 - 63 & 64 are reserved. */
-
 /* (e)LLC caching options */
 #define LE_PAGETABLE		0
 #define LE_UC			1
@@ -440,8 +432,19 @@ int intel_rcs_context_init_mocs(struct i915_request *rq)
 	int ret;
 
 	if (get_mocs_settings(rq->i915, &t)) {
+		struct drm_i915_mocs_table c = t;
+
+		/*
+		 * Use the control values installed by the context, if any.
+		 * The l3cc registers are global, so always the platform table.
+		 */
+		if (rq->gem_context->mocs) {
+			c.size = GEN9_NUM_MOCS_ENTRIES;
+			c.table = rq->gem_context->mocs;
+		}
+
 		/* Program the RCS control registers */
-		ret = emit_mocs_control_table(rq, &t);
+		ret = emit_mocs_control_table(rq, &c);
 		if (ret)
 			return ret;
 
@@ -453,3 +456,143 @@ int intel_rcs_context_init_mocs(struct i915_request *rq)
 
 	return 0;
 }
+
+/* Only the (e)LLC caching policy may be chosen by userspace */
+#define MOCS_USER_CONTROL_MASK \
+	(LE_CACHEABILITY(0x3) | LE_TGT_CACHE(0x3) | LE_LRUM(0x3))
+
+static bool mocs_entry_ok(const struct drm_i915_mocs_table *table,
+			  const struct drm_i915_gem_context_mocs_entry *entry)
+{
+	/* The entries of the platform table are ABI, only the rest is free */
+	if (entry->index < table->size ||
+	    entry->index >= GEN9_NUM_MOCS_ENTRIES)
+		return false;
+
+	if (entry->control_value & ~MOCS_USER_CONTROL_MASK)
+		return false;
+
+	/* LNCFCMOCS is shared by all contexts, not saved in the image */
+	if (entry->l3cc_value)
+		return false;
+
+	return !entry->rsvd;
+}
+
+/**
+ * intel_mocs_get_context_table() - read back the MOCS table of a context
+ * @ctx: the context
+ * @entries: array of GEN9_NUM_MOCS_ENTRIES entries to fill
+ *
+ * Return: the number of entries filled, or -ENODEV if the platform has no
+ * MOCS table.
+ */
+int intel_mocs_get_context_table(struct i915_gem_context *ctx,
+				 struct drm_i915_gem_context_mocs_entry *entries)
+{
+	struct drm_i915_mocs_table t;
+	unsigned int i;
+
+	lockdep_assert_held(&ctx->i915->drm.struct_mutex);
+
+	if (!get_mocs_settings(ctx->i915, &t))
+		return -ENODEV;
+
+	for (i = 0; i < GEN9_NUM_MOCS_ENTRIES; i++) {
+		const struct drm_i915_mocs_entry *e;
+
+		if (ctx->mocs)
+			e = &ctx->mocs[i];
+		else
+			e = &t.table[i < t.size ? i : 0];
+
+		entries[i].index = i;
+		entries[i].control_value = e->control_value;
+		entries[i].l3cc_value = e->l3cc_value;
+		entries[i].rsvd = 0;
+	}
+
+	return GEN9_NUM_MOCS_ENTRIES;
+}
+
+/**
+ * intel_mocs_set_context_table() - install a per-context MOCS table
+ * @ctx: the context
+ * @entries: the spare entries to program
+ * @count: number of @entries, 0 to restore the platform table
+ *
+ * Builds the context's table from the platform table and the validated
+ * @entries, and emits its control values through the render engine as for
+ * the platform table when the context image is first initialised. Only the
+ * render GFX_MOCS registers are saved in the context image, so only those
+ * follow the context; the LNCFCMOCS (l3cc) registers are global and always
+ * hold the platform table, hence @entries may not change them.
+ *
+ * Return: 0 on success, otherwise the error status.
+ */
+int intel_mocs_set_context_table(struct i915_gem_context *ctx,
+				 const struct drm_i915_gem_context_mocs_entry *entries,
+				 unsigned int count)
+{
+	struct drm_i915_private *i915 = ctx->i915;
+	struct drm_i915_mocs_entry *table = NULL;
+	struct drm_i915_mocs_table t;
+	struct i915_request *rq;
+	unsigned int i;
+	int err;
+
+	lockdep_assert_held(&i915->drm.struct_mutex);
+
+	if (!HAS_EXECLISTS(i915) || !get_mocs_settings(i915, &t))
+		return -ENODEV;
+
+	if (count) {
+		table = kmalloc_array(GEN9_NUM_MOCS_ENTRIES, sizeof(*table),
+				      GFP_KERNEL);
+		if (!table)
+			return -ENOMEM;
+
+		for (i = 0; i < GEN9_NUM_MOCS_ENTRIES; i++)
+			table[i] = t.table[i < t.size ? i : 0];
+
+		for (i = 0; i < count; i++) {
+			if (!mocs_entry_ok(&t, &entries[i])) {
+				err = -EINVAL;
+				goto err_free;
+			}
+
+			table[entries[i].index].control_value =
+				entries[i].control_value;
+		}
+
+		t.size = GEN9_NUM_MOCS_ENTRIES;
+		t.table = table;
+	}
+
+	intel_runtime_pm_get(i915);
+
+	rq = i915_request_alloc(i915->engine[RCS], ctx);
+	if (IS_ERR(rq)) {
+		err = PTR_ERR(rq);
+		goto err_rpm;
+	}
+
+	err = emit_mocs_control_table(rq, &t);
+
+	i915_request_add(rq);
+	if (err)
+		goto err_rpm;
+
+	intel_runtime_pm_put(i915);
+
+	kfree(ctx->mocs);
+	ctx->mocs = table;
+
+	return 0;
+
+err_rpm:
+	intel_runtime_pm_put(i915);
+err_free:
+	kfree(table);
+	return err;
+}
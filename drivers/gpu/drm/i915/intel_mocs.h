@@ -52,8 +52,21 @@
 #include <drm/drmP.h>
 #include "i915_drv.h"
 
+#define GEN9_NUM_MOCS_ENTRIES	62  /* 62 out of 64 - 63 & 64 are reserved. */
+
+struct drm_i915_mocs_entry {
+	u32 control_value;
+	u16 l3cc_value;
+};
+
 int intel_rcs_context_init_mocs(struct i915_request *rq);
 void intel_mocs_init_l3cc_table(struct drm_i915_private *dev_priv);
 int intel_mocs_init_engine(struct intel_engine_cs *engine);
 
+int intel_mocs_get_context_table(struct i915_gem_context *ctx,
+				 struct drm_i915_gem_context_mocs_entry *entries);
+int intel_mocs_set_context_table(struct i915_gem_context *ctx,
+				 const struct drm_i915_gem_context_mocs_entry *entries,
+				 unsigned int count);
+
 #endif
@@ -4867,6 +4867,27 @@ static void skl_compute_transition_wm(struct intel_crtc_state *cstate,
 	trans_wm->plane_en = false;
 }
 
+static bool skl_wm_cache_lookup(struct intel_plane *plane,
+				const struct skl_wm_key *key,
+				struct skl_plane_wm *wm)
+{
+	if (!plane->wm_cache.valid ||
+	    memcmp(&plane->wm_cache.key, key, sizeof(*key)))
+		return false;
+
+	*wm = plane->wm_cache.wm;
+	return true;
+}
+
+static void skl_wm_cache_store(struct intel_plane *plane,
+			       const struct skl_wm_key *key,
+			       const struct skl_plane_wm *wm)
+{
+	plane->wm_cache.key = *key;
+	plane->wm_cache.wm = *wm;
+	plane->wm_cache.valid = true;
+}
+
 static int skl_build_pipe_wm(struct intel_crtc_state *cstate,
 			     struct skl_ddb_allocation *ddb,
 			     struct skl_pipe_wm *pipe_wm)
@@ -4874,6 +4895,8 @@ static int skl_build_pipe_wm(struct intel_crtc_state *cstate,
 	struct drm_device *dev = cstate->base.crtc->dev;
 	struct drm_crtc_state *crtc_state = &cstate->base;
 	const struct drm_i915_private *dev_priv = to_i915(dev);
+	struct intel_atomic_state *state =
+		to_intel_atomic_state(crtc_state->state);
 	struct drm_plane *plane;
 	const struct drm_plane_state *pstate;
 	struct skl_plane_wm *wm;
@@ -4888,44 +4911,60 @@ static int skl_build_pipe_wm(struct intel_crtc_state *cstate,
 	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
 		const struct intel_plane_state *intel_pstate =
 						to_intel_plane_state(pstate);
-		enum plane_id plane_id = to_intel_plane(plane)->id;
-		struct skl_wm_params wm_params;
+		struct intel_plane *intel_plane = to_intel_plane(plane);
+		enum plane_id plane_id = intel_plane->id;
 		enum pipe pipe = to_intel_crtc(cstate->base.crtc)->pipe;
-		uint16_t ddb_blocks;
+		struct skl_wm_key key;
 
 		wm = &pipe_wm->planes[plane_id];
-		ddb_blocks = skl_ddb_entry_size(&ddb->plane[pipe][plane_id]);
+
+		/* Zeroed so that padding doesn't defeat the memcmp() */
+		memset(&key, 0, sizeof(key));
+		key.ddb_blocks = skl_ddb_entry_size(&ddb->plane[pipe][plane_id]);
+		key.uv_ddb_blocks =
+			skl_ddb_entry_size(&ddb->uv_plane[pipe][plane_id]);
+		key.htotal = crtc_state->adjusted_mode.crtc_htotal;
+		key.visible = intel_wm_plane_visible(cstate, intel_pstate);
+		key.active = crtc_state->active;
+		key.memory_bw_wa = skl_needs_memory_bw_wa(state);
+		key.ipc_enabled = dev_priv->ipc_enabled;
 
 		ret = skl_compute_plane_wm_params(dev_priv, cstate,
-						  intel_pstate, &wm_params, 0);
+						  intel_pstate, &key.wp, 0);
 		if (ret)
 			return ret;
 
+		/* uv plane watermarks must also be validated for NV12/Planar */
+		if (key.wp.is_planar) {
+			ret = skl_compute_plane_wm_params(dev_priv, cstate,
+							  intel_pstate,
+							  &key.uv_wp, 1);
+			if (ret)
+				return ret;
+		}
+
+		if (skl_wm_cache_lookup(intel_plane, &key, wm))
+			continue;
+
 		ret = skl_compute_wm_levels(dev_priv, ddb, cstate,
-					    intel_pstate, &wm_params, wm, 0);
+					    intel_pstate, &key.wp, wm, 0);
 		if (ret)
 			return ret;
 
-		skl_compute_transition_wm(cstate, &wm_params, &wm->wm[0],
-					  ddb_blocks, &wm->trans_wm);
+		skl_compute_transition_wm(cstate, &key.wp, &wm->wm[0],
+					  key.ddb_blocks, &wm->trans_wm);
 
-		/* uv plane watermarks must also be validated for NV12/Planar */
-		if (wm_params.is_planar) {
-			memset(&wm_params, 0, sizeof(struct skl_wm_params));
+		if (key.wp.is_planar) {
 			wm->is_planar = true;
 
-			ret = skl_compute_plane_wm_params(dev_priv, cstate,
-							  intel_pstate,
-							  &wm_params, 1);
-			if (ret)
-				return ret;
-
 			ret = skl_compute_wm_levels(dev_priv, ddb, cstate,
-						    intel_pstate, &wm_params,
+						    intel_pstate, &key.uv_wp,
 						    wm, 1);
 			if (ret)
 				return ret;
 		}
+
+		skl_wm_cache_store(intel_plane, &key, wm);
 	}
 
 	pipe_wm->linetime = skl_compute_linetime_wm(cstate);
@@ -5117,6 +5156,29 @@ skl_ddb_add_affected_planes(struct intel_crtc_state *cstate)
 	return 0;
 }
 
+/*
+ * Page flips that only swap a plane's framebuffer for one of the same
+ * layout do not change anything the DDB allocation or the watermarks
+ * are computed from, so keep the current values for the pipe rather
+ * than recomputing (and then comparing) them for every flip.
+ */
+static bool skl_crtc_wm_unchanged(const struct intel_atomic_state *state,
+				  const struct intel_crtc_state *cstate)
+{
+	const struct drm_i915_private *dev_priv = to_i915(state->base.dev);
+	const struct drm_crtc *crtc = cstate->base.crtc;
+
+	if (state->modeset || dev_priv->wm.distrust_bios_wm)
+		return false;
+
+	if (drm_atomic_crtc_needs_modeset(&cstate->base) ||
+	    cstate->base.color_mgmt_changed)
+		return false;
+
+	return cstate->flip_only &&
+		cstate->base.plane_mask == crtc->state->plane_mask;
+}
+
 static int
 skl_compute_ddb(struct drm_atomic_state *state)
 {
@@ -5130,6 +5192,9 @@ skl_compute_ddb(struct drm_atomic_state *state)
 	memcpy(ddb, &dev_priv->wm.skl_hw.ddb, sizeof(*ddb));
 
 	for_each_new_intel_crtc_in_state(intel_state, crtc, cstate, i) {
+		if (skl_crtc_wm_unchanged(intel_state, cstate))
+			continue;
+
 		ret = skl_allocate_pipe_ddb(cstate, ddb);
 		if (ret)
 			return ret;
@@ -5307,6 +5372,10 @@ skl_compute_wm(struct drm_atomic_state *state)
 		const struct skl_pipe_wm *old_pipe_wm =
 			&to_intel_crtc_state(crtc->state)->wm.skl.optimal;
 
+		/* Still carries the old (and current) watermarks */
+		if (skl_crtc_wm_unchanged(intel_state, intel_cstate))
+			continue;
+
 		pipe_wm = &intel_cstate->wm.skl.optimal;
 		ret = skl_update_pipe_wm(cstate, old_pipe_wm, pipe_wm,
 					 &results->ddb, &changed);
@@ -6409,6 +6478,7 @@ static int gen6_set_rps(struct drm_i915_private *dev_priv, u8 val)
 	I915_WRITE(GEN6_RP_INTERRUPT_LIMITS, intel_rps_limits(dev_priv, val));
 	I915_WRITE(GEN6_PMINTRMSK, gen6_rps_pm_mask(dev_priv, val));
 
+	i915_pmu_rps_changed(dev_priv, val);
 	rps->cur_freq = val;
 	trace_intel_gpu_freq_change(intel_gpu_freq(dev_priv, val));
 
@@ -6433,6 +6503,7 @@ static int valleyview_set_rps(struct drm_i915_private *dev_priv, u8 val)
 		gen6_set_rps_thresholds(dev_priv, val);
 	}
 
+	i915_pmu_rps_changed(dev_priv, val);
 	dev_priv->gt_pm.rps.cur_freq = val;
 	trace_intel_gpu_freq_change(intel_gpu_freq(dev_priv, val));
 
@@ -6529,6 +6600,49 @@ void gen6_rps_idle(struct drm_i915_private *dev_priv)
 	mutex_unlock(&dev_priv->pcu_lock);
 }
 
+/*
+ * Roughly how long it takes from deciding to boost until the GPU is running
+ * at the new frequency: the RPS worker has to run and then the pcode has to
+ * reclock. A request expected to be finished by then gains nothing.
+ */
+#define RPS_BOOST_LATENCY_US 1000
+
+/* Each client may waitboost at most this often */
+#define RPS_CLIENT_BOOST_INTERVAL msecs_to_jiffies(50)
+
+static bool rps_boost_too_late(const struct i915_request *rq)
+{
+	u64 expected = ewma_runtime_read(&rq->gem_context->runtime_us);
+	u64 elapsed = 0;
+
+	/* No history yet */
+	if (!expected)
+		return false;
+
+	if (rq->latency.start)
+		elapsed = div_u64(ktime_get_ns() - rq->latency.start,
+				  NSEC_PER_USEC);
+
+	/* Already overdue, so our prediction is off; boost after all */
+	if (elapsed >= expected)
+		return false;
+
+	return expected - elapsed < RPS_BOOST_LATENCY_US;
+}
+
+static bool rps_client_may_boost(struct intel_rps_client *rps_client)
+{
+	unsigned long now = jiffies;
+	unsigned long next = READ_ONCE(rps_client->next_boost);
+
+	if (time_before(now, next))
+		return false;
+
+	/* Only one concurrent waiter of the client gets to claim the boost */
+	return cmpxchg(&rps_client->next_boost,
+		       next, now + RPS_CLIENT_BOOST_INTERVAL) == next;
+}
+
 void gen6_rps_boost(struct i915_request *rq,
 		    struct intel_rps_client *rps_client)
 {
@@ -6545,6 +6659,25 @@ void gen6_rps_boost(struct i915_request *rq,
 	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &rq->fence.flags))
 		return;
 
+	/*
+	 * Clients that wait constantly (e.g. frame pacing) would otherwise
+	 * keep the GPU at its maximum frequency. Don't boost for requests
+	 * that, going by their context's history, will be finished before
+	 * the boost takes effect, and limit how often each client may boost.
+	 * Boosts by the kernel itself, e.g. to race to idle, are left alone.
+	 */
+	if (rps_client && !READ_ONCE(rq->waitboost)) {
+		if (rps_boost_too_late(rq)) {
+			atomic_inc(&rps_client->skipped);
+			return;
+		}
+
+		if (!rps_client_may_boost(rps_client)) {
+			atomic_inc(&rps_client->throttled);
+			return;
+		}
+	}
+
 	/* Serializes with i915_request_retire() */
 	boost = false;
 	spin_lock_irqsave(&rq->lock, flags);
@@ -6562,6 +6695,74 @@ void gen6_rps_boost(struct i915_request *rq,
 	atomic_inc(rps_client ? &rps_client->boosts : &rps->boosts);
 }
 
+static void rps_qos_kick(struct intel_rps *rps)
+{
+	atomic_set(&rps->qos.dirty, 1);
+	schedule_work(&rps->work);
+}
+
+/*
+ * Called as each request enters the ELSP: account its context's frequency
+ * hint, kicking the RPS worker if that changes the bounds to apply.
+ */
+void intel_rps_qos_in(struct i915_request *rq)
+{
+	struct intel_rps *rps = &rq->i915->gt_pm.rps;
+	struct i915_gem_context *ctx = rq->gem_context;
+	u8 min = READ_ONCE(ctx->freq_hint.min);
+	u8 max = READ_ONCE(ctx->freq_hint.max) ?: U8_MAX;
+	bool kick = false;
+
+	GEM_BUG_ON(rq->freq_hint);
+	rq->freq_hint = max << 8 | min;
+
+	if (atomic_inc_return(&rps->qos.max[max]) == 1)
+		kick = true;
+	if (min && atomic_inc_return(&rps->qos.min[min]) == 1)
+		kick = true;
+
+	if (kick)
+		rps_qos_kick(rps);
+}
+
+void intel_rps_qos_out(struct i915_request *rq)
+{
+	struct intel_rps *rps = &rq->i915->gt_pm.rps;
+	u8 min = rq->freq_hint & 0xff;
+	u8 max = rq->freq_hint >> 8;
+	bool kick = false;
+
+	rq->freq_hint = 0;
+
+	if (atomic_dec_and_test(&rps->qos.max[max]))
+		kick = true;
+	if (min && atomic_dec_and_test(&rps->qos.min[min]))
+		kick = true;
+
+	if (kick)
+		rps_qos_kick(rps);
+}
+
+/* Narrow [*min, *max] to the bounds requested by the executing contexts */
+void intel_rps_qos_limits(struct intel_rps *rps, int *min, int *max)
+{
+	int i;
+
+	for (i = U8_MAX; i > *min; i--) {
+		if (atomic_read(&rps->qos.min[i])) {
+			*min = min_t(int, i, *max);
+			break;
+		}
+	}
+
+	for (i = U8_MAX; i >= 0; i--) {
+		if (atomic_read(&rps->qos.max[i])) {
+			*max = clamp(i, *min, *max);
+			break;
+		}
+	}
+}
+
 int intel_set_rps(struct drm_i915_private *dev_priv, u8 val)
 {
 	struct intel_rps *rps = &dev_priv->gt_pm.rps;
@@ -6572,6 +6773,7 @@ int intel_set_rps(struct drm_i915_private *dev_priv, u8 val)
 	GEM_BUG_ON(val < rps->min_freq);
 
 	if (!rps->enabled) {
+		i915_pmu_rps_changed(dev_priv, val);
 		rps->cur_freq = val;
 		return 0;
 	}
@@ -9698,6 +9900,24 @@ u64 intel_rc6_residency_ns(struct drm_i915_private *dev_priv,
 	return mul_u64_u32_div(time_hw, mul, div);
 }
 
+u64 intel_rc6_total_residency_ns(struct drm_i915_private *dev_priv)
+{
+	u64 val;
+
+	val = intel_rc6_residency_ns(dev_priv,
+				     IS_VALLEYVIEW(dev_priv) ?
+				     VLV_GT_RENDER_RC6 :
+				     GEN6_GT_GFX_RC6);
+
+	if (HAS_RC6p(dev_priv))
+		val += intel_rc6_residency_ns(dev_priv, GEN6_GT_GFX_RC6p);
+
+	if (HAS_RC6pp(dev_priv))
+		val += intel_rc6_residency_ns(dev_priv, GEN6_GT_GFX_RC6pp);
+
+	return val;
+}
+
 u32 intel_get_cagf(struct drm_i915_private *dev_priv, u32 rpstat)
 {
 	u32 cagf;
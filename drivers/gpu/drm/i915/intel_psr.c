@@ -140,12 +140,14 @@ void intel_psr_irq_handler(struct drm_i915_private *dev_priv, u32 psr_iir)
 
 		if (psr_iir & EDP_PSR_PRE_ENTRY(cpu_transcoder)) {
 			dev_priv->psr.last_entry_attempt = time_ns;
+			dev_priv->psr.hw_entries++;
 			DRM_DEBUG_KMS("[transcoder %s] PSR entry attempt in 2 vblanks\n",
 				      transcoder_name(cpu_transcoder));
 		}
 
 		if (psr_iir & EDP_PSR_POST_EXIT(cpu_transcoder)) {
 			dev_priv->psr.last_exit = time_ns;
+			dev_priv->psr.hw_exits++;
 			DRM_DEBUG_KMS("[transcoder %s] PSR exit completed\n",
 				      transcoder_name(cpu_transcoder));
 
@@ -539,6 +541,8 @@ static void intel_psr_activate(struct intel_dp *intel_dp)
 		hsw_activate_psr1(intel_dp);
 
 	dev_priv->psr.active = true;
+	dev_priv->psr.active_since = ktime_get();
+	dev_priv->psr.activations++;
 }
 
 static void intel_psr_enable_source(struct intel_dp *intel_dp,
@@ -618,6 +622,12 @@ void intel_psr_enable(struct intel_dp *intel_dp,
 
 	dev_priv->psr.psr2_enabled = crtc_state->has_psr2;
 	dev_priv->psr.busy_frontbuffer_bits = 0;
+	dev_priv->psr.frame_us =
+		div_u64((u64)crtc_state->base.adjusted_mode.crtc_htotal *
+			crtc_state->base.adjusted_mode.crtc_vtotal * 1000,
+			max(crtc_state->base.adjusted_mode.crtc_clock, 1));
+	dev_priv->psr.flush_interval_us = 0;
+	dev_priv->psr.last_flush = ktime_get();
 
 	intel_psr_setup_vsc(intel_dp, crtc_state);
 	intel_psr_enable_sink(intel_dp);
@@ -664,6 +674,9 @@ intel_psr_disable_source(struct intel_dp *intel_dp)
 			DRM_ERROR("Timed out waiting for PSR Idle State\n");
 
 		dev_priv->psr.active = false;
+		dev_priv->psr.residency_ns +=
+			ktime_to_ns(ktime_sub(ktime_get(),
+					      dev_priv->psr.active_since));
 	} else {
 		if (dev_priv->psr.psr2_enabled)
 			WARN_ON(I915_READ(EDP_PSR2_CTL) & EDP_PSR2_ENABLE);
@@ -714,7 +727,7 @@ void intel_psr_disable(struct intel_dp *intel_dp,
 	mutex_lock(&dev_priv->psr.lock);
 	intel_psr_disable_locked(intel_dp);
 	mutex_unlock(&dev_priv->psr.lock);
-	cancel_work_sync(&dev_priv->psr.work);
+	cancel_delayed_work_sync(&dev_priv->psr.work);
 }
 
 int intel_psr_wait_for_idle(const struct intel_crtc_state *new_crtc_state)
@@ -787,7 +800,7 @@ static bool __psr_wait_for_idle_locked(struct drm_i915_private *dev_priv)
 static void intel_psr_work(struct work_struct *work)
 {
 	struct drm_i915_private *dev_priv =
-		container_of(work, typeof(*dev_priv), psr.work);
+		container_of(work, typeof(*dev_priv), psr.work.work);
 
 	mutex_lock(&dev_priv->psr.lock);
 
@@ -833,6 +846,51 @@ static void intel_psr_exit(struct drm_i915_private *dev_priv)
 		I915_WRITE(EDP_PSR_CTL, val & ~EDP_PSR_ENABLE);
 	}
 	dev_priv->psr.active = false;
+	dev_priv->psr.residency_ns +=
+		ktime_to_ns(ktime_sub(ktime_get(), dev_priv->psr.active_since));
+	dev_priv->psr.exits++;
+}
+
+/*
+ * Once activated, the hardware still waits for the idle frame count before
+ * it enters self refresh, and every exit afterwards adds latency to the
+ * next frame. When the frontbuffer keeps being flushed faster than that
+ * (a blinking cursor is fine, a scrolling terminal isn't), re-activating
+ * PSR right away only makes each update pay for an exit while the panel
+ * barely gets to self refresh. So keep track of how often flushes arrive,
+ * and while they come in quicker than twice the entry time, wait out two
+ * such intervals of quiet before re-activating. Sparse updates still get
+ * PSR back immediately.
+ */
+#define PSR_FLUSH_INTERVAL_MAX_US (1000 * 1000)
+#define PSR_REACTIVATE_DELAY_MAX_US (100 * 1000)
+
+static int psr_idle_frames(struct drm_i915_private *dev_priv)
+{
+	/* Same as programmed by hsw_activate_psr1() and hsw_activate_psr2() */
+	return max3(6, dev_priv->vbt.psr.idle_frames,
+		    dev_priv->psr.sink_sync_latency + 1);
+}
+
+static unsigned long psr_reactivate_delay(struct drm_i915_private *dev_priv)
+{
+	struct i915_psr *psr = &dev_priv->psr;
+	ktime_t now = ktime_get();
+	unsigned int interval, entry_us;
+
+	interval = min_t(s64, ktime_us_delta(now, psr->last_flush),
+			 PSR_FLUSH_INTERVAL_MAX_US);
+	psr->last_flush = now;
+	psr->flush_interval_us = (3 * psr->flush_interval_us + interval) / 4;
+
+	entry_us = psr_idle_frames(dev_priv) * psr->frame_us;
+	if (psr->flush_interval_us >= 2 * entry_us)
+		return 0;
+
+	psr->deferred++;
+	return usecs_to_jiffies(min_t(unsigned int,
+				      2 * psr->flush_interval_us,
+				      PSR_REACTIVATE_DELAY_MAX_US));
 }
 
 /**
@@ -882,18 +940,22 @@ void intel_psr_invalidate(struct drm_i915_private *dev_priv,
  * intel_psr_flush - Flush PSR
  * @dev_priv: i915 device
  * @frontbuffer_bits: frontbuffer plane tracking bits
+ * @damaged_bits: subset of @frontbuffer_bits whose contents changed
  * @origin: which operation caused the flush
  *
  * Since the hardware frontbuffer tracking has gaps we need to integrate
  * with the software frontbuffer tracking. This function gets called every
  * time frontbuffer rendering has completed and flushed out to memory. PSR
  * can be enabled again if no other frontbuffer relevant to PSR is dirty.
+ * Only planes in @damaged_bits force an exit from PSR.
  *
  * Dirty frontbuffers relevant to PSR are tracked in busy_frontbuffer_bits.
  */
 void intel_psr_flush(struct drm_i915_private *dev_priv,
-		     unsigned frontbuffer_bits, enum fb_op_origin origin)
+		     unsigned frontbuffer_bits, unsigned damaged_bits,
+		     enum fb_op_origin origin)
 {
+	unsigned long delay = 0;
 	struct drm_crtc *crtc;
 	enum pipe pipe;
 
@@ -916,7 +978,9 @@ void intel_psr_flush(struct drm_i915_private *dev_priv,
 	dev_priv->psr.busy_frontbuffer_bits &= ~frontbuffer_bits;
 
 	/* By definition flush = invalidate + flush */
-	if (frontbuffer_bits) {
+	if (frontbuffer_bits & damaged_bits) {
+		delay = psr_reactivate_delay(dev_priv);
+
 		if (dev_priv->psr.psr2_enabled) {
 			intel_psr_exit(dev_priv);
 		} else {
@@ -934,7 +998,7 @@ void intel_psr_flush(struct drm_i915_private *dev_priv,
 	}
 
 	if (!dev_priv->psr.active && !dev_priv->psr.busy_frontbuffer_bits)
-		schedule_work(&dev_priv->psr.work);
+		mod_delayed_work(system_wq, &dev_priv->psr.work, delay);
 	mutex_unlock(&dev_priv->psr.lock);
 }
 
@@ -971,7 +1035,7 @@ void intel_psr_init(struct drm_i915_private *dev_priv)
 		/* For new platforms let's respect VBT back again */
 		dev_priv->psr.link_standby = dev_priv->vbt.psr.full_link;
 
-	INIT_WORK(&dev_priv->psr.work, intel_psr_work);
+	INIT_DELAYED_WORK(&dev_priv->psr.work, intel_psr_work);
 	mutex_init(&dev_priv->psr.lock);
 }
 
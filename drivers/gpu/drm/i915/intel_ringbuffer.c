@@ -1745,6 +1745,28 @@ static int ring_request_alloc(struct i915_request *request)
 	return 0;
 }
 
+static unsigned int reclaim_space(struct intel_ring *ring)
+{
+	struct i915_request *rq;
+	u32 head = ring->head;
+
+	/*
+	 * The requests on the ring complete in order, so everything before
+	 * the postfix of the last completed request has been consumed by the
+	 * GPU and can be reused, even though the requests have yet to be
+	 * retired. ring->head itself is left for retirement to advance.
+	 */
+	list_for_each_entry(rq, &ring->request_list, ring_link) {
+		if (!i915_request_completed(rq))
+			break;
+
+		head = rq->postfix;
+	}
+
+	ring->space = __intel_ring_space(head, ring->emit, ring->size);
+	return ring->space;
+}
+
 static noinline int wait_for_space(struct intel_ring *ring, unsigned int bytes)
 {
 	struct i915_request *target;
@@ -1755,6 +1777,9 @@ static noinline int wait_for_space(struct intel_ring *ring, unsigned int bytes)
 	if (intel_ring_update_space(ring) >= bytes)
 		return 0;
 
+	if (reclaim_space(ring) >= bytes)
+		return 0;
+
 	GEM_BUG_ON(list_empty(&ring->request_list));
 	list_for_each_entry(target, &ring->request_list, ring_link) {
 		/* Would completion of this request free enough space? */
@@ -1772,9 +1797,13 @@ static noinline int wait_for_space(struct intel_ring *ring, unsigned int bytes)
 	if (timeout < 0)
 		return timeout;
 
-	i915_request_retire_upto(target);
-
-	intel_ring_update_space(ring);
+	/*
+	 * Don't retire the requests here: that would run the completion
+	 * of every other context on the ring from the submitter, whereas we
+	 * only need the space behind the breadcrumb. Retirement is left to
+	 * the usual retire worker and request allocation.
+	 */
+	reclaim_space(ring);
 	GEM_BUG_ON(ring->space < bytes);
 	return 0;
 }
@@ -3,6 +3,7 @@
 #define _INTEL_RINGBUFFER_H_
 
 #include <linux/hashtable.h>
+#include <linux/hrtimer.h>
 #include <linux/seqlock.h>
 
 #include "i915_gem_batch_pool.h"
@@ -15,10 +16,9 @@
 #include "intel_gpu_commands.h"
 
 struct drm_printer;
+struct i915_cmd_slot;
 struct i915_sched_attr;
 
-#define I915_CMD_HASH_ORDER 9
-
 /* Early gen2 devices have a cacheline of just 32 bytes, using 64 is overkill,
  * but keeps the logic simple. Indeed, the whole purpose of this macro is just
  * to give some inclination as to some of the magic values used in the various
@@ -216,6 +216,16 @@ struct intel_engine_execlists {
 	 */
 	struct tasklet_struct watchdog_tasklet;
 
+	/**
+	 * @irq_steer: state for running @tasklet on a CPU other than the one
+	 * servicing the interrupt, see intel_engine_kick_irq_tasklet()
+	 */
+	struct {
+		call_single_data_t csd;
+		unsigned long pending;
+		int cpu;
+	} irq_steer;
+
 	/**
 	 * @default_priolist: priority list for I915_PRIORITY_NORMAL
 	 */
@@ -305,6 +315,15 @@ struct intel_engine_execlists {
 	 */
 	struct rb_root_cached queue;
 
+	/**
+	 * @submit_queue: lockless list of requests ready to be queued
+	 *
+	 * Submitters push their ready requests onto this list without
+	 * taking the engine timeline lock, so that they never wait behind
+	 * the CSB processing. The tasklet then moves them into @queue.
+	 */
+	struct llist_head submit_queue;
+
 	/**
 	 * @csb_read: control register for Context Switch buffer
 	 *
@@ -345,11 +364,80 @@ struct intel_engine_execlists {
 	 */
 	u8 csb_head;
 
+	/**
+	 * @timeslice: timer marking the end of the timeslice of port[0]
+	 */
+	struct timer_list timeslice;
+
+	/**
+	 * @timeslice_duration_ms: length of a timeslice, 0 to disable
+	 *
+	 * Once the context in port[0] has run for this long, we allow
+	 * another context of the same priority to preempt it.
+	 */
+	unsigned int timeslice_duration_ms;
+
+	/**
+	 * @timeslice_expired: the context in port[0] has used up its slice
+	 */
+	bool timeslice_expired;
+
+	/**
+	 * @yield: context to move behind its peers of equal priority once
+	 * the pending preemption completes
+	 */
+	const struct intel_context *yield;
+
 	I915_SELFTEST_DECLARE(struct st_preempt_hang preempt_hang;)
 };
 
 #define INTEL_ENGINE_CS_MAX_NAME 8
 
+/*
+ * The stages of submission for which we record the latency of each
+ * request: from i915_request_add() until all of its dependencies are
+ * signaled, waiting in the priority queue until __i915_request_submit(),
+ * until the ELSP write and finally until the CS switches to the context.
+ */
+enum intel_engine_latency_stage {
+	INTEL_LATENCY_DEPS = 0,
+	INTEL_LATENCY_QUEUE,
+	INTEL_LATENCY_ELSP,
+	INTEL_LATENCY_HW,
+	INTEL_LATENCY_STAGES
+};
+
+/* Requests are grouped as below, at or above the default priority */
+enum intel_engine_latency_band {
+	INTEL_LATENCY_LOW = 0,
+	INTEL_LATENCY_NORMAL,
+	INTEL_LATENCY_HIGH,
+	INTEL_LATENCY_BANDS
+};
+
+#define INTEL_LATENCY_BUCKETS 32 /* log2(ns), the last includes all above */
+
+/*
+ * The events recorded into the always-on per-engine trace ring, see
+ * intel_engine_trace(): as each request is submitted to the backend,
+ * switched in and out by the HW, and finally retired.
+ */
+enum intel_engine_trace_event {
+	INTEL_TRACE_SUBMIT = 0,
+	INTEL_TRACE_IN,
+	INTEL_TRACE_OUT,
+	INTEL_TRACE_RETIRE,
+};
+
+#define INTEL_ENGINE_TRACE_SIZE 512 /* entries, must be a power-of-two */
+
+struct intel_engine_trace_entry {
+	u64 timestamp; /* ktime_get_ns() */
+	u64 context; /* fence.context */
+	u32 seqno; /* fence.seqno */
+	u32 event;
+};
+
 struct intel_engine_cs {
 	struct drm_i915_private *i915;
 	char name[INTEL_ENGINE_CS_MAX_NAME];
@@ -370,9 +458,31 @@ struct intel_engine_cs {
 
 	struct i915_timeline timeline;
 
+	/**
+	 * @queued: requests added to the engine but not yet submitted to
+	 * the hardware, i.e. still waiting upon their dependencies or in the
+	 * execlists queue; see intel_engine_load().
+	 */
+	atomic_t queued;
+
 	struct drm_i915_gem_object *default_state;
 	void *pinned_default_state;
 
+	/**
+	 * @context_pool: context images and rings prepared in advance
+	 *
+	 * The first use of a new context on an engine has to allocate its
+	 * context image, copy in the @default_state and allocate its ring.
+	 * For clients that create a context for each job, that is on the
+	 * critical path, so we keep a few prepared in the background.
+	 * Protected by struct_mutex.
+	 */
+	struct {
+		struct list_head list;
+		unsigned int count;
+		struct delayed_work refill;
+	} context_pool;
+
 	unsigned long irq_posted;
 #define ENGINE_IRQ_BREADCRUMB 0
 
@@ -410,6 +520,23 @@ struct intel_engine_cs {
 
 		bool irq_armed : 1;
 		I915_SELFTEST_DECLARE(bool mock : 1);
+
+		/*
+		 * Interrupt moderation: at high request rates, only every
+		 * @interval breadcrumbs (or after @window_us) do we emit a
+		 * MI_USER_INTERRUPT, and the @timer then wakes the waiters
+		 * upon the others in batches.
+		 * See intel_engine_breadcrumb_irq().
+		 */
+		struct {
+			struct hrtimer timer;
+			u64 last; /* ktime_get_ns() of the last irq emitted */
+			u32 seqno; /* last breadcrumb emitted without an irq */
+			unsigned int count; /* breadcrumbs since the last irq */
+			unsigned int interval; /* 0 to disable */
+			unsigned int window_us;
+			unsigned long skipped;
+		} coalesce;
 	} breadcrumbs;
 
 	struct {
@@ -425,16 +552,45 @@ struct intel_engine_cs {
 		 *
 		 * Index number corresponds to the bit number from @enable.
 		 */
-		unsigned int enable_count[I915_PMU_SAMPLE_BITS];
+#define I915_ENGINE_SAMPLE_MAX (I915_SAMPLE_WATCHDOG_NEAR + 1)
+		unsigned int enable_count[I915_ENGINE_SAMPLE_MAX];
 		/**
 		 * @sample: Counter values for sampling events.
 		 *
 		 * Our internal timer stores the current counters in this field.
 		 */
-#define I915_ENGINE_SAMPLE_MAX (I915_SAMPLE_SEMA + 1)
 		struct i915_pmu_sample sample[I915_ENGINE_SAMPLE_MAX];
+		/**
+		 * @port_idle_start: Timestamp of when the last execlists
+		 * port was left empty whilst the first port was busy, or 0.
+		 *
+		 * Used to accumulate the I915_SAMPLE_PORT_IDLE counter.
+		 */
+		ktime_t port_idle_start;
 	} pmu;
 
+	/*
+	 * Log2 histograms of the time each request spent in each stage of
+	 * submission, see intel_engine_record_latency(). Updated under the
+	 * timeline.lock.
+	 */
+	struct {
+		u32 hist[INTEL_LATENCY_STAGES]
+			[INTEL_LATENCY_BANDS]
+			[INTEL_LATENCY_BUCKETS];
+	} latency;
+
+	/*
+	 * A small ring of the most recent request events on this engine, kept
+	 * lockless (entries are claimed by incrementing @head) so that it is
+	 * cheap enough to leave always on. See intel_engine_trace().
+	 */
+	struct {
+		atomic_t head;
+		struct intel_engine_trace_entry
+			entries[INTEL_ENGINE_TRACE_SIZE];
+	} trace;
+
 	/*
 	 * A pool of objects to use as shadow copies of client batch buffers
 	 * when the command parser is enabled. Prevents the client from
@@ -578,6 +734,9 @@ struct intel_engine_cs {
 
 	struct intel_engine_execlists execlists;
 
+	/* Per-engine sysfs directory, see i915_setup_sysfs() */
+	struct kobject *kobj;
+
 	/* Contexts are pinned whilst they are active on the GPU. The last
 	 * context executed remains active whilst the GPU is idle - the
 	 * switch away and write to the context object only occurs on the
@@ -597,13 +756,20 @@ struct intel_engine_cs {
 #define I915_ENGINE_NEEDS_CMD_PARSER BIT(0)
 #define I915_ENGINE_SUPPORTS_STATS   BIT(1)
 #define I915_ENGINE_HAS_PREEMPTION   BIT(2)
+#define I915_ENGINE_CSB_IN_IRQ       BIT(3)
 	unsigned int flags;
 
 	/*
 	 * Table of commands the command parser needs to know about
-	 * for this engine.
+	 * for this engine, indexed by a perfect hash of their opcodes.
 	 */
-	DECLARE_HASHTABLE(cmd_hash, I915_CMD_HASH_ORDER);
+	struct {
+		const struct drm_i915_cmd_descriptor **desc;
+		struct i915_cmd_slot *slot;
+		unsigned int count;
+		unsigned int order;
+		u32 mul;
+	} cmd_lookup;
 
 	/*
 	 * Table of registers allowed in commands that read/write registers.
@@ -653,6 +819,17 @@ struct intel_engine_cs {
 		 * where engine is currently busy (active > 0).
 		 */
 		ktime_t total;
+		/**
+		 * @band: Busy time split by the priority band of the contexts
+		 * scheduled in, accounted the same way as @active, @start and
+		 * @total above. The bands may overlap, so their sum can exceed
+		 * @total.
+		 */
+		struct {
+			unsigned int active;
+			ktime_t start;
+			ktime_t total;
+		} band[INTEL_LATENCY_BANDS];
 	} stats;
 };
 
@@ -674,6 +851,12 @@ intel_engine_has_preemption(const struct intel_engine_cs *engine)
 	return engine->flags & I915_ENGINE_HAS_PREEMPTION;
 }
 
+static inline bool
+intel_engine_csb_in_irq(const struct intel_engine_cs *engine)
+{
+	return engine->flags & I915_ENGINE_CSB_IN_IRQ;
+}
+
 static inline bool __execlists_need_preempt(int prio, int last)
 {
 	return prio > max(0, last);
@@ -723,6 +906,9 @@ execlists_cancel_port_requests(struct intel_engine_execlists * const execlists);
 void
 execlists_unwind_incomplete_requests(struct intel_engine_execlists *execlists);
 
+void
+execlists_flush_submit_queue(struct intel_engine_execlists *execlists);
+
 static inline unsigned int
 execlists_num_ports(const struct intel_engine_execlists * const execlists)
 {
@@ -938,6 +1124,16 @@ static inline u32 intel_engine_last_submit(struct intel_engine_cs *engine)
 	return READ_ONCE(engine->timeline.seqno);
 }
 
+/*
+ * An estimate of the work outstanding on the engine, being the number of
+ * requests ahead of one submitted now.
+ */
+static inline unsigned int intel_engine_load(struct intel_engine_cs *engine)
+{
+	return atomic_read(&engine->queued) +
+		intel_engine_last_submit(engine) - intel_engine_get_seqno(engine);
+}
+
 void intel_engine_get_instdone(struct intel_engine_cs *engine,
 			       struct intel_instdone *instdone);
 
@@ -1037,6 +1233,9 @@ void intel_engine_disarm_breadcrumbs(struct intel_engine_cs *engine);
 void intel_engine_reset_breadcrumbs(struct intel_engine_cs *engine);
 void intel_engine_fini_breadcrumbs(struct intel_engine_cs *engine);
 
+bool intel_engine_breadcrumb_irq(struct intel_engine_cs *engine,
+				 const struct i915_request *rq);
+
 static inline u32 *gen8_emit_pipe_control(u32 *batch, u32 flags, u32 offset)
 {
 	memset(batch, 0, 6 * sizeof(u32));
@@ -1106,11 +1305,70 @@ __printf(3, 4)
 void intel_engine_dump(struct intel_engine_cs *engine,
 		       struct drm_printer *m,
 		       const char *header, ...);
+void intel_engine_dump_latency(struct intel_engine_cs *engine,
+			       struct drm_printer *m);
+void intel_engine_dump_trace(const struct intel_engine_trace_entry *entries,
+			     unsigned int count,
+			     struct drm_printer *m);
+unsigned int intel_engine_copy_trace(struct intel_engine_cs *engine,
+				     struct intel_engine_trace_entry *dst);
+
+static inline void
+intel_engine_trace(struct intel_engine_cs *engine,
+		   enum intel_engine_trace_event event,
+		   const struct i915_request *rq)
+{
+	struct intel_engine_trace_entry *e;
+	unsigned int idx;
+
+	BUILD_BUG_ON_NOT_POWER_OF_2(INTEL_ENGINE_TRACE_SIZE);
+
+	idx = atomic_inc_return(&engine->trace.head) - 1;
+	e = &engine->trace.entries[idx & (INTEL_ENGINE_TRACE_SIZE - 1)];
+
+	e->timestamp = ktime_get_ns();
+	e->context = rq->fence.context;
+	e->seqno = rq->fence.seqno;
+	e->event = event;
+}
+
+static inline enum intel_engine_latency_band
+intel_engine_priority_band(int prio)
+{
+	if (prio == I915_PRIORITY_INVALID || prio == I915_PRIORITY_NORMAL)
+		return INTEL_LATENCY_NORMAL;
+	else if (prio < I915_PRIORITY_NORMAL)
+		return INTEL_LATENCY_LOW;
+	else
+		return INTEL_LATENCY_HIGH;
+}
+
+static inline void
+intel_engine_record_latency(struct intel_engine_cs *engine,
+			    enum intel_engine_latency_stage stage,
+			    const struct i915_request *rq,
+			    u64 start, u64 end)
+{
+	enum intel_engine_latency_band band;
+	unsigned int bucket;
+
+	lockdep_assert_held(&engine->timeline.lock);
+
+	if (!start || end < start)
+		return;
+
+	band = intel_engine_priority_band(rq->sched.attr.priority);
+	bucket = min_t(unsigned int, fls64(end - start),
+		       INTEL_LATENCY_BUCKETS - 1);
+	engine->latency.hist[stage][band][bucket]++;
+}
 
 struct intel_engine_cs *
 intel_engine_lookup_user(struct drm_i915_private *i915, u8 class, u8 instance);
 
-static inline void intel_engine_context_in(struct intel_engine_cs *engine)
+static inline void
+intel_engine_context_in(struct intel_engine_cs *engine,
+			enum intel_engine_latency_band band)
 {
 	unsigned long flags;
 
@@ -1120,15 +1378,22 @@ static inline void intel_engine_context_in(struct intel_engine_cs *engine)
 	write_seqlock_irqsave(&engine->stats.lock, flags);
 
 	if (engine->stats.enabled > 0) {
+		ktime_t now = ktime_get();
+
 		if (engine->stats.active++ == 0)
-			engine->stats.start = ktime_get();
+			engine->stats.start = now;
 		GEM_BUG_ON(engine->stats.active == 0);
+
+		if (engine->stats.band[band].active++ == 0)
+			engine->stats.band[band].start = now;
 	}
 
 	write_sequnlock_irqrestore(&engine->stats.lock, flags);
 }
 
-static inline void intel_engine_context_out(struct intel_engine_cs *engine)
+static inline void
+intel_engine_context_out(struct intel_engine_cs *engine,
+			 enum intel_engine_latency_band band)
 {
 	unsigned long flags;
 
@@ -1138,6 +1403,7 @@ static inline void intel_engine_context_out(struct intel_engine_cs *engine)
 	write_seqlock_irqsave(&engine->stats.lock, flags);
 
 	if (engine->stats.enabled > 0) {
+		ktime_t now = ktime_get();
 		ktime_t last;
 
 		if (engine->stats.active && --engine->stats.active == 0) {
@@ -1145,7 +1411,7 @@ static inline void intel_engine_context_out(struct intel_engine_cs *engine)
 			 * Decrement the active context count and in case GPU
 			 * is now idle add up to the running total.
 			 */
-			last = ktime_sub(ktime_get(), engine->stats.start);
+			last = ktime_sub(now, engine->stats.start);
 
 			engine->stats.total = ktime_add(engine->stats.total,
 							last);
@@ -1155,11 +1421,21 @@ static inline void intel_engine_context_out(struct intel_engine_cs *engine)
 			 * the first event in which case we account from the
 			 * time stats gathering was turned on.
 			 */
-			last = ktime_sub(ktime_get(), engine->stats.enabled_at);
+			last = ktime_sub(now, engine->stats.enabled_at);
 
 			engine->stats.total = ktime_add(engine->stats.total,
 							last);
 		}
+
+		if (engine->stats.band[band].active &&
+		    --engine->stats.band[band].active == 0)
+			last = ktime_sub(now, engine->stats.band[band].start);
+		else if (engine->stats.band[band].active == 0)
+			last = ktime_sub(now, engine->stats.enabled_at);
+		else
+			last = 0;
+		engine->stats.band[band].total =
+			ktime_add(engine->stats.band[band].total, last);
 	}
 
 	write_sequnlock_irqrestore(&engine->stats.lock, flags);
@@ -1169,6 +1445,8 @@ int intel_enable_engine_stats(struct intel_engine_cs *engine);
 void intel_disable_engine_stats(struct intel_engine_cs *engine);
 
 ktime_t intel_engine_get_busy_time(struct intel_engine_cs *engine);
+ktime_t intel_engine_get_busy_time_band(struct intel_engine_cs *engine,
+					enum intel_engine_latency_band band);
 
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
 
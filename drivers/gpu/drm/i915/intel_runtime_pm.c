@@ -27,6 +27,7 @@
  */
 
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
 #include <linux/vgaarb.h>
 
 #include "i915_drv.h"
@@ -162,6 +163,7 @@ static void intel_power_well_enable(struct drm_i915_private *dev_priv,
 	DRM_DEBUG_KMS("enabling %s\n", power_well->name);
 	power_well->ops->enable(dev_priv, power_well);
 	power_well->hw_enabled = true;
+	power_well->enable_count++;
 }
 
 static void intel_power_well_disable(struct drm_i915_private *dev_priv,
@@ -170,6 +172,7 @@ static void intel_power_well_disable(struct drm_i915_private *dev_priv,
 	DRM_DEBUG_KMS("disabling %s\n", power_well->name);
 	power_well->hw_enabled = false;
 	power_well->ops->disable(dev_priv, power_well);
+	power_well->disable_count++;
 }
 
 static void intel_power_well_get(struct drm_i915_private *dev_priv,
@@ -579,6 +582,24 @@ static u32 gen9_dc_mask(struct drm_i915_private *dev_priv)
 	return mask;
 }
 
+/* Accumulate the time spent in the current DC state before changing it */
+static void gen9_account_dc_state(struct drm_i915_private *dev_priv)
+{
+	struct intel_csr *csr = &dev_priv->csr;
+	ktime_t now = ktime_get();
+
+	if (csr->dc_state_since) {
+		ktime_t dt = ktime_sub(now, csr->dc_state_since);
+
+		if (csr->dc_state & DC_STATE_EN_UPTO_DC6)
+			csr->dc6_time = ktime_add(csr->dc6_time, dt);
+		else if (csr->dc_state & DC_STATE_EN_UPTO_DC5)
+			csr->dc5_time = ktime_add(csr->dc5_time, dt);
+	}
+
+	csr->dc_state_since = now;
+}
+
 void gen9_sanitize_dc_state(struct drm_i915_private *dev_priv)
 {
 	u32 val;
@@ -587,6 +608,7 @@ void gen9_sanitize_dc_state(struct drm_i915_private *dev_priv)
 
 	DRM_DEBUG_KMS("Resetting DC state tracking from %02x to %02x\n",
 		      dev_priv->csr.dc_state, val);
+	gen9_account_dc_state(dev_priv);
 	dev_priv->csr.dc_state = val;
 }
 
@@ -636,6 +658,7 @@ static void gen9_set_dc_state(struct drm_i915_private *dev_priv, uint32_t state)
 
 	gen9_write_dc_state(dev_priv, val);
 
+	gen9_account_dc_state(dev_priv);
 	dev_priv->csr.dc_state = val & mask;
 }
 
@@ -1533,17 +1556,225 @@ static void chv_pipe_power_well_disable(struct drm_i915_private *dev_priv,
 	chv_set_pipe_power_well(dev_priv, power_well, false);
 }
 
+#if IS_ENABLED(CONFIG_DRM_I915_DEBUG_RUNTIME_PM)
+#include <linux/stacktrace.h>
+
+#define STACKDEPTH 16
+#define BUFSZ 4096
+
+static noinline depot_stack_handle_t __save_depot_stack(void)
+{
+	unsigned long entries[STACKDEPTH];
+	struct stack_trace trace = {
+		.entries = entries,
+		.max_entries = STACKDEPTH,
+		.skip = 1,
+	};
+
+	save_stack_trace(&trace);
+	if (trace.nr_entries != 0 &&
+	    trace.entries[trace.nr_entries - 1] == ULONG_MAX)
+		trace.nr_entries--;
+
+	return depot_save_stack(&trace, GFP_NOWAIT | __GFP_NOWARN);
+}
+
+static void track_domain_get(struct i915_power_domains *power_domains,
+			     enum intel_display_power_domain domain)
+{
+	typeof(power_domains->domain_debug[0]) *debug =
+		&power_domains->domain_debug[domain];
+	depot_stack_handle_t stack = __save_depot_stack();
+	struct i915_power_domain_caller *caller;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&power_domains->debug_lock, flags);
+
+	debug->held++;
+
+	for (i = 0; i < debug->count; i++) {
+		caller = &debug->callers[i];
+		if (caller->stack == stack)
+			goto found;
+	}
+
+	if (debug->count >= debug->size) {
+		unsigned int size = max(2 * debug->size, 4u);
+		struct i915_power_domain_caller *callers;
+
+		/* Under the debug spinlock, so avoid sleeping */
+		callers = krealloc(debug->callers, size * sizeof(*callers),
+				   GFP_NOWAIT | __GFP_NOWARN);
+		if (!callers) {
+			/* Reported as taken by an unknown owner */
+			debug->untracked++;
+			goto unlock;
+		}
+
+		memset(callers + debug->size, 0,
+		       (size - debug->size) * sizeof(*callers));
+		debug->callers = callers;
+		debug->size = size;
+	}
+
+	caller = &debug->callers[debug->count++];
+	caller->stack = stack;
+	caller->count = 0;
+	caller->first = now;
+
+found:
+	caller->count++;
+	caller->last = now;
+unlock:
+	spin_unlock_irqrestore(&power_domains->debug_lock, flags);
+}
+
+static void untrack_domain_put(struct i915_power_domains *power_domains,
+			       enum intel_display_power_domain domain)
+{
+	typeof(power_domains->domain_debug[0]) *debug =
+		&power_domains->domain_debug[domain];
+	unsigned long flags;
+
+	/*
+	 * We cannot tell which reference a put drops, so the callers are
+	 * only forgotten once the domain has no references left at all.
+	 */
+	spin_lock_irqsave(&power_domains->debug_lock, flags);
+	if (debug->held && !--debug->held) {
+		debug->count = 0;
+		debug->untracked = 0;
+	}
+	spin_unlock_irqrestore(&power_domains->debug_lock, flags);
+}
+
+static void init_domain_tracking(struct i915_power_domains *power_domains)
+{
+	spin_lock_init(&power_domains->debug_lock);
+}
+
+static void fini_domain_tracking(struct i915_power_domains *power_domains)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(power_domains->domain_debug); i++) {
+		kfree(power_domains->domain_debug[i].callers);
+		memset(&power_domains->domain_debug[i], 0,
+		       sizeof(power_domains->domain_debug[i]));
+	}
+}
+
+/**
+ * intel_display_power_show_holders - list the holders of a power domain
+ * @dev_priv: i915 device instance
+ * @domain: power domain to report
+ * @m: seq_file to print to
+ *
+ * Prints the stack trace of every caller that took a reference on @domain
+ * since the domain was last released by everyone, with how many references
+ * each took and when it took its first and last one. A leaked reference
+ * shows up as a caller whose count keeps growing while the domain stays on.
+ */
+void intel_display_power_show_holders(struct drm_i915_private *dev_priv,
+				      enum intel_display_power_domain domain,
+				      struct seq_file *m)
+{
+	struct i915_power_domains *power_domains = &dev_priv->power_domains;
+	typeof(power_domains->domain_debug[0]) *debug =
+		&power_domains->domain_debug[domain];
+	unsigned long entries[STACKDEPTH];
+	ktime_t now = ktime_get();
+	unsigned int i;
+	char *buf;
+
+	buf = kmalloc(BUFSZ, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	spin_lock_irq(&power_domains->debug_lock);
+	for (i = 0; i < debug->count; i++) {
+		const struct i915_power_domain_caller *caller =
+			&debug->callers[i];
+		struct stack_trace trace = {
+			.entries = entries,
+			.max_entries = STACKDEPTH,
+		};
+
+		seq_printf(m, "    %u reference(s) taken, first %lldms ago, last %lldms ago, ",
+			   caller->count,
+			   ktime_ms_delta(now, caller->first),
+			   ktime_ms_delta(now, caller->last));
+
+		if (!caller->stack) {
+			seq_puts(m, "by unknown owner\n");
+			continue;
+		}
+
+		depot_fetch_stack(caller->stack, &trace);
+		snprint_stack_trace(buf, BUFSZ, &trace, 6);
+		seq_printf(m, "at\n%s", buf);
+	}
+	if (debug->untracked)
+		seq_printf(m, "    %u reference(s) taken by unknown owner\n",
+			   debug->untracked);
+	spin_unlock_irq(&power_domains->debug_lock);
+
+	kfree(buf);
+}
+
+#undef STACKDEPTH
+#undef BUFSZ
+#else
+static void track_domain_get(struct i915_power_domains *power_domains,
+			     enum intel_display_power_domain domain) { }
+static void untrack_domain_put(struct i915_power_domains *power_domains,
+			       enum intel_display_power_domain domain) { }
+static void init_domain_tracking(struct i915_power_domains *power_domains) { }
+static void fini_domain_tracking(struct i915_power_domains *power_domains) { }
+#endif
+
 static void
 __intel_display_power_get_domain(struct drm_i915_private *dev_priv,
-				 enum intel_display_power_domain domain)
+				 enum intel_display_power_domain domain,
+				 unsigned long caller)
 {
 	struct i915_power_domains *power_domains = &dev_priv->power_domains;
 	struct i915_power_well *power_well;
 
+	lockdep_assert_held(&power_domains->lock);
+
+	/* Raced with another user taking the first reference? */
+	if (atomic_inc_not_zero(&power_domains->domain_use_count[domain]))
+		return;
+
 	for_each_power_domain_well(dev_priv, power_well, BIT_ULL(domain))
 		intel_power_well_get(dev_priv, power_well);
 
-	power_domains->domain_use_count[domain]++;
+	power_domains->domain_holder[domain].caller = caller;
+	power_domains->domain_holder[domain].since = ktime_get();
+
+	atomic_inc(&power_domains->domain_use_count[domain]);
+}
+
+/*
+ * Drop a domain reference without taking the lock, unless it is the last one
+ * (or the count is already zero) and so the power wells must be released.
+ */
+static bool
+__intel_display_power_put_domain_fast(struct i915_power_domains *power_domains,
+				      enum intel_display_power_domain domain)
+{
+	atomic_t *count = &power_domains->domain_use_count[domain];
+	int old = atomic_read(count);
+
+	do {
+		if (old <= 1)
+			return false;
+	} while (!atomic_try_cmpxchg(count, &old, old - 1));
+
+	return true;
 }
 
 /**
@@ -1565,9 +1796,15 @@ void intel_display_power_get(struct drm_i915_private *dev_priv,
 
 	intel_runtime_pm_get(dev_priv);
 
+	track_domain_get(power_domains, domain);
+
+	/* The domain's wells are already on while anyone holds a reference */
+	if (atomic_inc_not_zero(&power_domains->domain_use_count[domain]))
+		return;
+
 	mutex_lock(&power_domains->lock);
 
-	__intel_display_power_get_domain(dev_priv, domain);
+	__intel_display_power_get_domain(dev_priv, domain, _RET_IP_);
 
 	mutex_unlock(&power_domains->lock);
 }
@@ -1593,10 +1830,15 @@ bool intel_display_power_get_if_enabled(struct drm_i915_private *dev_priv,
 	if (!intel_runtime_pm_get_if_in_use(dev_priv))
 		return false;
 
+	if (atomic_inc_not_zero(&power_domains->domain_use_count[domain])) {
+		track_domain_get(power_domains, domain);
+		return true;
+	}
+
 	mutex_lock(&power_domains->lock);
 
 	if (__intel_display_power_is_enabled(dev_priv, domain)) {
-		__intel_display_power_get_domain(dev_priv, domain);
+		__intel_display_power_get_domain(dev_priv, domain, _RET_IP_);
 		is_enabled = true;
 	} else {
 		is_enabled = false;
@@ -1604,7 +1846,9 @@ bool intel_display_power_get_if_enabled(struct drm_i915_private *dev_priv,
 
 	mutex_unlock(&power_domains->lock);
 
-	if (!is_enabled)
+	if (is_enabled)
+		track_domain_get(power_domains, domain);
+	else
 		intel_runtime_pm_put(dev_priv);
 
 	return is_enabled;
@@ -1627,18 +1871,29 @@ void intel_display_power_put(struct drm_i915_private *dev_priv,
 
 	power_domains = &dev_priv->power_domains;
 
+	untrack_domain_put(power_domains, domain);
+
+	if (__intel_display_power_put_domain_fast(power_domains, domain))
+		goto out;
+
 	mutex_lock(&power_domains->lock);
 
-	WARN(!power_domains->domain_use_count[domain],
-	     "Use count on domain %s is already zero\n",
-	     intel_display_power_domain_str(domain));
-	power_domains->domain_use_count[domain]--;
+	if (WARN(!atomic_read(&power_domains->domain_use_count[domain]),
+		 "Use count on domain %s is already zero\n",
+		 intel_display_power_domain_str(domain)))
+		goto out_unlock;
 
-	for_each_power_domain_well_rev(dev_priv, power_well, BIT_ULL(domain))
-		intel_power_well_put(dev_priv, power_well);
+	if (atomic_dec_and_test(&power_domains->domain_use_count[domain])) {
+		for_each_power_domain_well_rev(dev_priv, power_well,
+					       BIT_ULL(domain))
+			intel_power_well_put(dev_priv, power_well);
 
-	mutex_unlock(&power_domains->lock);
+		power_domains->domain_holder[domain].caller = 0;
+	}
 
+out_unlock:
+	mutex_unlock(&power_domains->lock);
+out:
 	intel_runtime_pm_put(dev_priv);
 }
 
@@ -2850,6 +3105,7 @@ int intel_power_domains_init(struct drm_i915_private *dev_priv)
 	BUILD_BUG_ON(POWER_DOMAIN_NUM > 64);
 
 	mutex_init(&power_domains->lock);
+	init_domain_tracking(power_domains);
 
 	/*
 	 * The enabling order will be from lower to higher indexed wells,
@@ -2927,6 +3183,8 @@ void intel_power_domains_fini(struct drm_i915_private *dev_priv)
 	 */
 	if (!HAS_RUNTIME_PM(dev_priv))
 		pm_runtime_put(kdev);
+
+	fini_domain_tracking(&dev_priv->power_domains);
 }
 
 static void intel_power_domains_sync_hw(struct drm_i915_private *dev_priv)
@@ -3608,7 +3866,7 @@ static void intel_power_domains_dump_info(struct drm_i915_private *dev_priv)
 		for_each_power_domain(domain, power_well->domains)
 			DRM_DEBUG_DRIVER("  %-23s %d\n",
 					 intel_display_power_domain_str(domain),
-					 power_domains->domain_use_count[domain]);
+					 atomic_read(&power_domains->domain_use_count[domain]));
 	}
 }
 
@@ -3617,7 +3875,7 @@ static void intel_power_domains_dump_info(struct drm_i915_private *dev_priv)
  * @dev_priv: i915 device instance
  *
  * Verify if the reference count of each power well matches its HW enabled
- * state and the total refcount of the domains it belongs to. This must be
+ * state and the number of its domains that are in use. This must be
  * called after modeset HW state sanitization, which is responsible for
  * acquiring reference counts for any power wells in use and disabling the
  * ones left on by BIOS but not required by any active output.
@@ -3649,9 +3907,10 @@ void intel_power_domains_verify_state(struct drm_i915_private *dev_priv)
 			DRM_ERROR("power well %s state mismatch (refcount %d/enabled %d)",
 				  power_well->name, power_well->count, enabled);
 
+		/* Each domain in use holds a single reference on its wells */
 		domains_count = 0;
 		for_each_power_domain(domain, power_well->domains)
-			domains_count += power_domains->domain_use_count[domain];
+			domains_count += !!atomic_read(&power_domains->domain_use_count[domain]);
 
 		if (power_well->count != domains_count) {
 			DRM_ERROR("power well %s refcount/domain refcount mismatch "
@@ -60,13 +60,54 @@ int intel_usecs_to_scanlines(const struct drm_display_mode *adjusted_mode,
 #define VBLANK_EVASION_TIME_US 100
 #endif
 
+/*
+ * Once we have measured how long updating a given number of planes takes,
+ * evade the vblank by twice that plus some slack instead of the fixed
+ * VBLANK_EVASION_TIME_US: cheap updates then wait for the vblank less
+ * often, and expensive ones no longer run past the start of vblank.
+ */
+#define VBLANK_EVASION_MIN_US 30
+#define VBLANK_EVASION_SLACK_US 20
+#define VBLANK_EVASION_MAX_US (4 * VBLANK_EVASION_TIME_US)
+
+unsigned int
+intel_pipe_update_budget_us(struct intel_crtc *crtc, unsigned int planes)
+{
+	unsigned long cost;
+
+	cost = ewma_evasion_read(&crtc->evasion.cost_us[planes]);
+	if (!cost)
+		return VBLANK_EVASION_TIME_US;
+
+	return clamp_t(unsigned long, 2 * cost + VBLANK_EVASION_SLACK_US,
+		       VBLANK_EVASION_MIN_US, VBLANK_EVASION_MAX_US);
+}
+
+static void intel_pipe_update_account(struct intel_crtc *crtc,
+				      s64 duration_us, bool missed)
+{
+	unsigned int bucket;
+
+	bucket = min_t(unsigned int, fls64(max_t(s64, duration_us, 0) >> 3),
+		       I915_EVASION_HIST_BUCKETS - 1);
+
+	crtc->evasion.updates++;
+	crtc->evasion.hist[bucket]++;
+	if (missed)
+		crtc->evasion.misses++;
+
+	ewma_evasion_add(&crtc->evasion.cost_us[crtc->debug.planes],
+			 max_t(s64, duration_us, 1));
+}
+
 /**
  * intel_pipe_update_start() - start update of a set of display registers
  * @new_crtc_state: the new crtc state
  *
  * Mark the start of an update to pipe registers that should be updated
  * atomically regarding vblank. If the next vblank will happens within
- * the next 100 us, this function waits until the vblank passes.
+ * the evasion budget for this plane configuration (initially 100 us), this
+ * function waits until the vblank passes.
  *
  * After a successful call to this function, interrupts will be disabled
  * until a subsequent call to intel_pipe_update_end(). That is done to
@@ -84,13 +125,28 @@ void intel_pipe_update_start(const struct intel_crtc_state *new_crtc_state)
 		intel_crtc_has_type(new_crtc_state, INTEL_OUTPUT_DSI);
 	DEFINE_WAIT(wait);
 
+	crtc->debug.start_vbl_count = 0;
+
+	/* Async flips are allowed to tear, there is no vblank to evade */
+	if (new_crtc_state->async_flip) {
+		if (new_crtc_state->base.event)
+			skl_arm_flip_done(crtc, new_crtc_state->base.event);
+		goto irq_disable;
+	}
+
+	crtc->debug.planes = min_t(unsigned int,
+				   hweight32(new_crtc_state->base.plane_mask),
+				   I915_MAX_PLANES);
+	crtc->debug.budget_us =
+		intel_pipe_update_budget_us(crtc, crtc->debug.planes);
+
 	vblank_start = adjusted_mode->crtc_vblank_start;
 	if (adjusted_mode->flags & DRM_MODE_FLAG_INTERLACE)
 		vblank_start = DIV_ROUND_UP(vblank_start, 2);
 
 	/* FIXME needs to be calibrated sensibly */
 	min = vblank_start - intel_usecs_to_scanlines(adjusted_mode,
-						      VBLANK_EVASION_TIME_US);
+						      crtc->debug.budget_us);
 	max = vblank_start - 1;
 
 	if (min <= 0 || max <= 0)
@@ -187,6 +243,7 @@ void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state)
 	u32 end_vbl_count = intel_crtc_get_vblank_counter(crtc);
 	ktime_t end_vbl_time = ktime_get();
 	struct drm_i915_private *dev_priv = to_i915(crtc->base.dev);
+	s64 duration_us;
 
 	trace_i915_pipe_update_end(crtc, end_vbl_count, scanline_end);
 
@@ -194,7 +251,10 @@ void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state)
 	 * Would be slightly nice to just grab the vblank count and arm the
 	 * event outside of the critical section - the spinlock might spin for a
 	 * while ... */
-	if (new_crtc_state->base.event) {
+	if (new_crtc_state->async_flip) {
+		/* The flip done interrupt sends the event, see skl_arm_flip_done() */
+		new_crtc_state->base.event = NULL;
+	} else if (new_crtc_state->base.event) {
 		WARN_ON(drm_crtc_vblank_get(&crtc->base) != 0);
 
 		spin_lock(&crtc->base.dev->event_lock);
@@ -209,22 +269,24 @@ void intel_pipe_update_end(struct intel_crtc_state *new_crtc_state)
 	if (intel_vgpu_active(dev_priv))
 		return;
 
-	if (crtc->debug.start_vbl_count &&
-	    crtc->debug.start_vbl_count != end_vbl_count) {
+	if (!crtc->debug.start_vbl_count)
+		return;
+
+	duration_us = ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time);
+	intel_pipe_update_account(crtc, duration_us,
+				  crtc->debug.start_vbl_count != end_vbl_count);
+
+	if (crtc->debug.start_vbl_count != end_vbl_count) {
 		DRM_ERROR("Atomic update failure on pipe %c (start=%u end=%u) time %lld us, min %d, max %d, scanline start %d, end %d\n",
 			  pipe_name(pipe), crtc->debug.start_vbl_count,
-			  end_vbl_count,
-			  ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time),
+			  end_vbl_count, duration_us,
 			  crtc->debug.min_vbl, crtc->debug.max_vbl,
 			  crtc->debug.scanline_start, scanline_end);
 	}
 #ifdef CONFIG_DRM_I915_DEBUG_VBLANK_EVADE
-	else if (ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time) >
-		 VBLANK_EVASION_TIME_US)
+	else if (duration_us > crtc->debug.budget_us)
 		DRM_WARN("Atomic update on pipe (%c) took %lld us, max time under evasion is %u us\n",
-			 pipe_name(pipe),
-			 ktime_us_delta(end_vbl_time, crtc->debug.start_vbl_time),
-			 VBLANK_EVASION_TIME_US);
+			 pipe_name(pipe), duration_us, crtc->debug.budget_us);
 #endif
 }
 
@@ -1655,7 +1717,7 @@ intel_sprite_plane_create(struct drm_i915_private *dev_priv,
 	return intel_plane;
 
 fail:
-	kfree(state);
+	intel_plane_state_free(state);
 	kfree(intel_plane);
 
 	return ERR_PTR(ret);
@@ -173,10 +173,31 @@ void intel_uc_init_early(struct drm_i915_private *i915)
 	sanitize_options_early(i915);
 }
 
+/**
+ * intel_uc_prefetch_firmwares - start looking up the GuC and HuC firmwares
+ * @i915: device private
+ *
+ * The lookup proceeds in parallel with the rest of driver load, and is
+ * only waited upon when the firmware objects are created, from
+ * intel_uc_init_misc().
+ */
+void intel_uc_prefetch_firmwares(struct drm_i915_private *i915)
+{
+	if (!USES_GUC(i915))
+		return;
+
+	intel_uc_fw_prefetch(i915, &i915->guc.fw);
+	if (USES_HUC(i915))
+		intel_uc_fw_prefetch(i915, &i915->huc.fw);
+}
+
 void intel_uc_cleanup_early(struct drm_i915_private *i915)
 {
 	struct intel_guc *guc = &i915->guc;
 
+	intel_uc_fw_prefetch_cancel(&i915->huc.fw);
+	intel_uc_fw_prefetch_cancel(&guc->fw);
+
 	guc_free_load_err_log(guc);
 }
 
@@ -28,6 +28,68 @@
 #include "intel_uc_fw.h"
 #include "i915_drv.h"
 
+static void uc_fw_prefetch_done(const struct firmware *fw, void *context)
+{
+	struct intel_uc_fw *uc_fw = context;
+
+	uc_fw->prefetch = fw;
+	complete_all(&uc_fw->prefetch_done);
+}
+
+/**
+ * intel_uc_fw_prefetch - start requesting uC firmware in the background
+ *
+ * @dev_priv: device private
+ * @uc_fw: uC firmware
+ *
+ * Looking up the firmware may take a while, so we start it as soon as we
+ * know which firmware we want, and intel_uc_fw_fetch() waits for it only
+ * once we need it.
+ */
+void intel_uc_fw_prefetch(struct drm_i915_private *dev_priv,
+			  struct intel_uc_fw *uc_fw)
+{
+	int err;
+
+	if (!uc_fw->path || uc_fw->prefetching)
+		return;
+
+	init_completion(&uc_fw->prefetch_done);
+	uc_fw->prefetch = NULL;
+
+	err = request_firmware_nowait(THIS_MODULE, true, uc_fw->path,
+				      &dev_priv->drm.pdev->dev, GFP_KERNEL,
+				      uc_fw, uc_fw_prefetch_done);
+	if (err) {
+		DRM_DEBUG_DRIVER("%s fw prefetch err=%d\n",
+				 intel_uc_fw_type_repr(uc_fw->type), err);
+		return;
+	}
+
+	uc_fw->prefetching = true;
+}
+
+static const struct firmware *uc_fw_prefetch_wait(struct intel_uc_fw *uc_fw)
+{
+	if (!uc_fw->prefetching)
+		return NULL;
+
+	wait_for_completion(&uc_fw->prefetch_done);
+	uc_fw->prefetching = false;
+
+	return fetch_and_zero(&uc_fw->prefetch);
+}
+
+/**
+ * intel_uc_fw_prefetch_cancel - release uC firmware prefetched but not used
+ *
+ * @uc_fw: uC firmware
+ */
+void intel_uc_fw_prefetch_cancel(struct intel_uc_fw *uc_fw)
+{
+	release_firmware(uc_fw_prefetch_wait(uc_fw));
+}
+
 /**
  * intel_uc_fw_fetch - fetch uC firmware
  *
@@ -57,7 +119,12 @@ void intel_uc_fw_fetch(struct drm_i915_private *dev_priv,
 			 intel_uc_fw_type_repr(uc_fw->type),
 			 intel_uc_fw_status_repr(uc_fw->fetch_status));
 
-	err = request_firmware(&fw, uc_fw->path, &pdev->dev);
+	if (uc_fw->prefetching) {
+		fw = uc_fw_prefetch_wait(uc_fw);
+		err = fw ? 0 : -ENOENT;
+	} else {
+		err = request_firmware(&fw, uc_fw->path, &pdev->dev);
+	}
 	if (err) {
 		DRM_DEBUG_DRIVER("%s fw request_firmware err=%d\n",
 				 intel_uc_fw_type_repr(uc_fw->type), err);
@@ -214,33 +281,35 @@ int intel_uc_fw_upload(struct intel_uc_fw *uc_fw,
 			 intel_uc_fw_type_repr(uc_fw->type),
 			 intel_uc_fw_status_repr(uc_fw->load_status));
 
-	/* Pin object with firmware */
-	err = i915_gem_object_set_to_gtt_domain(uc_fw->obj, false);
-	if (err) {
-		DRM_DEBUG_DRIVER("%s fw set-domain err=%d\n",
-				 intel_uc_fw_type_repr(uc_fw->type), err);
-		goto fail;
-	}
-
-	ggtt_pin_bias = to_i915(uc_fw->obj->base.dev)->ggtt.pin_bias;
-	vma = i915_gem_object_ggtt_pin(uc_fw->obj, NULL, 0, 0,
-				       PIN_OFFSET_BIAS | ggtt_pin_bias);
-	if (IS_ERR(vma)) {
-		err = PTR_ERR(vma);
-		DRM_DEBUG_DRIVER("%s fw ggtt-pin err=%d\n",
-				 intel_uc_fw_type_repr(uc_fw->type), err);
-		goto fail;
+	/*
+	 * Pin object with firmware. We keep it pinned (and so bound in the
+	 * GGTT, which is restored across suspend) for reuse on every resume
+	 * and reset, where the image only has to be DMA'ed again.
+	 */
+	vma = uc_fw->vma;
+	if (!vma) {
+		err = i915_gem_object_set_to_gtt_domain(uc_fw->obj, false);
+		if (err) {
+			DRM_DEBUG_DRIVER("%s fw set-domain err=%d\n",
+					 intel_uc_fw_type_repr(uc_fw->type), err);
+			goto fail;
+		}
+
+		ggtt_pin_bias = to_i915(uc_fw->obj->base.dev)->ggtt.pin_bias;
+		vma = i915_gem_object_ggtt_pin(uc_fw->obj, NULL, 0, 0,
+					       PIN_OFFSET_BIAS | ggtt_pin_bias);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			DRM_DEBUG_DRIVER("%s fw ggtt-pin err=%d\n",
+					 intel_uc_fw_type_repr(uc_fw->type), err);
+			goto fail;
+		}
+
+		uc_fw->vma = vma;
 	}
 
 	/* Call custom loader */
 	err = xfer(uc_fw, vma);
-
-	/*
-	 * We keep the object pages for reuse during resume. But we can unpin it
-	 * now that DMA has completed, so it doesn't continue to take up space.
-	 */
-	i915_vma_unpin(vma);
-
 	if (err)
 		goto fail;
 
@@ -273,11 +342,16 @@ int intel_uc_fw_upload(struct intel_uc_fw *uc_fw,
  *
  * @uc_fw: uC firmware
  *
- * Cleans up uC firmware by releasing the firmware GEM obj.
+ * Cleans up uC firmware by releasing its GGTT pin and the firmware GEM obj.
  */
 void intel_uc_fw_fini(struct intel_uc_fw *uc_fw)
 {
 	struct drm_i915_gem_object *obj;
+	struct i915_vma *vma;
+
+	vma = fetch_and_zero(&uc_fw->vma);
+	if (vma)
+		i915_vma_unpin(vma);
 
 	obj = fetch_and_zero(&uc_fw->obj);
 	if (obj)
@@ -25,8 +25,11 @@
 #ifndef _INTEL_UC_FW_H_
 #define _INTEL_UC_FW_H_
 
+#include <linux/completion.h>
+
 struct drm_printer;
 struct drm_i915_private;
+struct firmware;
 struct i915_vma;
 
 /* Home of GuC, HuC and DMC firmwares */
@@ -52,9 +55,20 @@ struct intel_uc_fw {
 	const char *path;
 	size_t size;
 	struct drm_i915_gem_object *obj;
+	/* The image, kept pinned in the GGTT ready for DMA after first use */
+	struct i915_vma *vma;
 	enum intel_uc_fw_status fetch_status;
 	enum intel_uc_fw_status load_status;
 
+	/*
+	 * The firmware is requested from userspace early in driver load,
+	 * in parallel with the rest of init, and only waited upon once we
+	 * are ready to create its object. See intel_uc_fw_prefetch().
+	 */
+	const struct firmware *prefetch;
+	struct completion prefetch_done;
+	bool prefetching;
+
 	/*
 	 * The firmware build process will generate a version header file with major and
 	 * minor version defined. The versions are built into CSS header of firmware.
@@ -137,6 +151,9 @@ static inline u32 intel_uc_fw_get_upload_size(struct intel_uc_fw *uc_fw)
 	return uc_fw->header_size + uc_fw->ucode_size;
 }
 
+void intel_uc_fw_prefetch(struct drm_i915_private *dev_priv,
+			  struct intel_uc_fw *uc_fw);
+void intel_uc_fw_prefetch_cancel(struct intel_uc_fw *uc_fw);
 void intel_uc_fw_fetch(struct drm_i915_private *dev_priv,
 		       struct intel_uc_fw *uc_fw);
 int intel_uc_fw_upload(struct intel_uc_fw *uc_fw,
@@ -70,16 +70,44 @@ fw_domain_reset(struct drm_i915_private *i915,
 	__raw_i915_write32(i915, d->reg_set, i915->uncore.fw_reset);
 }
 
+#define FW_HOLD_MIN_NS	NSEC_PER_MSEC
+#define FW_HOLD_MAX_NS	(16 * NSEC_PER_MSEC)
+
 static inline void
 fw_domain_arm_timer(struct intel_uncore_forcewake_domain *d)
 {
 	d->wake_count++;
 	hrtimer_start_range_ns(&d->timer,
-			       NSEC_PER_MSEC,
+			       d->hold_ns,
 			       NSEC_PER_MSEC,
 			       HRTIMER_MODE_REL);
 }
 
+static void
+fw_domain_adapt_hold(struct intel_uncore_forcewake_domain *d, ktime_t now)
+{
+	s64 asleep = ktime_to_ns(ktime_sub(now, d->released));
+
+	/*
+	 * If we are woken up again within the hold-off period of having been
+	 * released, holding on for a little longer would have saved the
+	 * wake/ack cycle, so back off exponentially. Once the domain has been
+	 * left asleep for much longer than the hold-off, the bursts are over
+	 * and we can return to releasing the domain sooner.
+	 */
+	if (asleep < d->hold_ns)
+		d->hold_ns = min_t(u32, 2 * d->hold_ns, FW_HOLD_MAX_NS);
+	else if (asleep > 8ll * d->hold_ns)
+		d->hold_ns = max_t(u32, d->hold_ns / 2, FW_HOLD_MIN_NS);
+}
+
+static void
+fw_domain_account_ack(struct intel_uncore_forcewake_domain *d, ktime_t start)
+{
+	d->stats.acquisitions++;
+	d->stats.ack_wait_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
 static inline int
 __wait_for_ack(const struct drm_i915_private *i915,
 	       const struct intel_uncore_forcewake_domain *d,
@@ -122,7 +150,7 @@ enum ack_type {
 
 static int
 fw_domain_wait_ack_with_fallback(const struct drm_i915_private *i915,
-				 const struct intel_uncore_forcewake_domain *d,
+				 struct intel_uncore_forcewake_domain *d,
 				 const enum ack_type type)
 {
 	const u32 ack_bit = FORCEWAKE_KERNEL;
@@ -144,6 +172,8 @@ fw_domain_wait_ack_with_fallback(const struct drm_i915_private *i915,
 	 * although the name is a bit misleading.
 	 */
 
+	d->stats.fallbacks++;
+
 	pass = 1;
 	do {
 		wait_ack_clear(i915, d, FORCEWAKE_KERNEL_FALLBACK);
@@ -171,7 +201,7 @@ fw_domain_wait_ack_with_fallback(const struct drm_i915_private *i915,
 
 static inline void
 fw_domain_wait_ack_clear_fallback(const struct drm_i915_private *i915,
-				  const struct intel_uncore_forcewake_domain *d)
+				  struct intel_uncore_forcewake_domain *d)
 {
 	if (likely(!wait_ack_clear(i915, d, FORCEWAKE_KERNEL)))
 		return;
@@ -198,7 +228,7 @@ fw_domain_wait_ack_set(const struct drm_i915_private *i915,
 
 static inline void
 fw_domain_wait_ack_set_fallback(const struct drm_i915_private *i915,
-				const struct intel_uncore_forcewake_domain *d)
+				struct intel_uncore_forcewake_domain *d)
 {
 	if (likely(!wait_ack_set(i915, d, FORCEWAKE_KERNEL)))
 		return;
@@ -219,16 +249,21 @@ fw_domains_get(struct drm_i915_private *i915, enum forcewake_domains fw_domains)
 {
 	struct intel_uncore_forcewake_domain *d;
 	unsigned int tmp;
+	ktime_t now;
 
 	GEM_BUG_ON(fw_domains & ~i915->uncore.fw_domains);
 
+	now = ktime_get();
 	for_each_fw_domain_masked(d, fw_domains, i915, tmp) {
+		fw_domain_adapt_hold(d, now);
 		fw_domain_wait_ack_clear(i915, d);
 		fw_domain_get(i915, d);
 	}
 
-	for_each_fw_domain_masked(d, fw_domains, i915, tmp)
+	for_each_fw_domain_masked(d, fw_domains, i915, tmp) {
 		fw_domain_wait_ack_set(i915, d);
+		fw_domain_account_ack(d, now);
+	}
 
 	i915->uncore.fw_domains_active |= fw_domains;
 }
@@ -239,16 +274,21 @@ fw_domains_get_with_fallback(struct drm_i915_private *i915,
 {
 	struct intel_uncore_forcewake_domain *d;
 	unsigned int tmp;
+	ktime_t now;
 
 	GEM_BUG_ON(fw_domains & ~i915->uncore.fw_domains);
 
+	now = ktime_get();
 	for_each_fw_domain_masked(d, fw_domains, i915, tmp) {
+		fw_domain_adapt_hold(d, now);
 		fw_domain_wait_ack_clear_fallback(i915, d);
 		fw_domain_get(i915, d);
 	}
 
-	for_each_fw_domain_masked(d, fw_domains, i915, tmp)
+	for_each_fw_domain_masked(d, fw_domains, i915, tmp) {
 		fw_domain_wait_ack_set_fallback(i915, d);
+		fw_domain_account_ack(d, now);
+	}
 
 	i915->uncore.fw_domains_active |= fw_domains;
 }
@@ -353,15 +393,19 @@ intel_uncore_fw_release_timer(struct hrtimer *timer)
 
 	assert_rpm_device_not_suspended(dev_priv);
 
-	if (xchg(&domain->active, false))
+	if (xchg(&domain->active, false)) {
+		hrtimer_forward_now(timer, ns_to_ktime(domain->hold_ns));
 		return HRTIMER_RESTART;
+	}
 
 	spin_lock_irqsave(&dev_priv->uncore.lock, irqflags);
 	if (WARN_ON(domain->wake_count == 0))
 		domain->wake_count++;
 
-	if (--domain->wake_count == 0)
+	if (--domain->wake_count == 0) {
 		dev_priv->uncore.funcs.force_wake_put(dev_priv, domain->mask);
+		domain->released = ktime_get();
+	}
 
 	spin_unlock_irqrestore(&dev_priv->uncore.lock, irqflags);
 
@@ -1253,14 +1297,20 @@ __gen2_write(32)
 #undef GEN2_WRITE_FOOTER
 #undef GEN2_WRITE_HEADER
 
-#define GEN6_WRITE_HEADER \
+#define GEN6_WRITE_PROLOGUE \
 	u32 offset = i915_mmio_reg_offset(reg); \
 	unsigned long irqflags; \
 	trace_i915_reg_rw(true, reg, val, sizeof(val), trace); \
-	assert_rpm_wakelock_held(dev_priv); \
+	assert_rpm_wakelock_held(dev_priv)
+
+#define GEN6_WRITE_LOCK \
 	spin_lock_irqsave(&dev_priv->uncore.lock, irqflags); \
 	unclaimed_reg_debug(dev_priv, reg, false, true)
 
+#define GEN6_WRITE_HEADER \
+	GEN6_WRITE_PROLOGUE; \
+	GEN6_WRITE_LOCK
+
 #define GEN6_WRITE_FOOTER \
 	unclaimed_reg_debug(dev_priv, reg, false, false); \
 	spin_unlock_irqrestore(&dev_priv->uncore.lock, irqflags)
@@ -1275,12 +1325,24 @@ gen6_write##x(struct drm_i915_private *dev_priv, i915_reg_t reg, u##x val, bool
 	GEN6_WRITE_FOOTER; \
 }
 
+/*
+ * Shadowed registers (such as the ELSP and RING_TAIL) and those outside of
+ * any forcewake range are written without taking the uncore.lock, as there
+ * is no forcewake state to serialise against. We only fall back to the
+ * locked path for them when the unclaimed mmio detection is enabled, as
+ * that has to pair up the check around the write.
+ */
 #define __gen_write(func, x) \
 static void \
 func##_write##x(struct drm_i915_private *dev_priv, i915_reg_t reg, u##x val, bool trace) { \
 	enum forcewake_domains fw_engine; \
-	GEN6_WRITE_HEADER; \
+	GEN6_WRITE_PROLOGUE; \
 	fw_engine = __##func##_reg_write_fw_domains(offset); \
+	if (likely(!fw_engine && !i915_modparams.mmio_debug)) { \
+		__raw_i915_write##x(dev_priv, reg, val); \
+		return; \
+	} \
+	GEN6_WRITE_LOCK; \
 	if (fw_engine) \
 		__force_wake_auto(dev_priv, fw_engine); \
 	__raw_i915_write##x(dev_priv, reg, val); \
@@ -1309,6 +1371,8 @@ __gen6_write(32)
 #undef __gen6_write
 #undef GEN6_WRITE_FOOTER
 #undef GEN6_WRITE_HEADER
+#undef GEN6_WRITE_LOCK
+#undef GEN6_WRITE_PROLOGUE
 
 #define ASSIGN_WRITE_MMIO_VFUNCS(i915, x) \
 do { \
@@ -1361,6 +1425,7 @@ static void fw_domain_init(struct drm_i915_private *dev_priv,
 
 
 	d->mask = BIT(domain_id);
+	d->hold_ns = FW_HOLD_MIN_NS;
 
 	hrtimer_init(&d->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	d->timer.function = intel_uncore_fw_release_timer;
@@ -2160,8 +2225,11 @@ int intel_gpu_reset(struct drm_i915_private *dev_priv, unsigned engine_mask)
 	 * for a reset helps in various cases, so for a full-device reset
 	 * we apply the opposite rule and wait if we want to. As we should
 	 * always follow up a failed per-engine reset with a full device reset,
-	 * being a little faster, stricter and more error prone for the
-	 * atomic case seems an acceptable compromise.
+	 * being a little faster and stricter for the atomic case seems an
+	 * acceptable compromise. However, as the full device reset stalls
+	 * every other engine, a per-engine reset is still retried a few times
+	 * with a short busy-wait, as the engine is often just slow to ack the
+	 * reset request whilst it drains its current command.
 	 *
 	 * Unfortunately this leads to a bimodal routine, when the goal was
 	 * to have a single reset function that worked for resetting any
@@ -2197,10 +2265,17 @@ int intel_gpu_reset(struct drm_i915_private *dev_priv, unsigned engine_mask)
 			GEM_TRACE("engine_mask=%x\n", engine_mask);
 			ret = reset(dev_priv, engine_mask);
 		}
-		if (ret != -ETIMEDOUT || engine_mask != ALL_ENGINES)
-			break;
+		if (engine_mask == ALL_ENGINES) {
+			if (ret != -ETIMEDOUT)
+				break;
 
-		cond_resched();
+			cond_resched();
+		} else {
+			if (ret != -ETIMEDOUT && ret != -EIO)
+				break;
+
+			udelay(50);
+		}
 	}
 	intel_uncore_forcewake_put(dev_priv, FORCEWAKE_ALL);
 
@@ -2339,6 +2414,75 @@ intel_uncore_forcewake_for_reg(struct drm_i915_private *dev_priv,
 	return fw_domains;
 }
 
+/**
+ * intel_uncore_forcewake_for_regs - forcewake domains needed for a set of
+ *				     registers
+ * @dev_priv: pointer to struct drm_i915_private
+ * @regs: array of registers in question
+ * @count: number of registers in @regs
+ * @op: operation bitmask of FW_REG_READ and/or FW_REG_WRITE
+ *
+ * Returns the union of the forcewake domains reported by
+ * intel_uncore_forcewake_for_reg() for each of the @regs.
+ */
+enum forcewake_domains
+intel_uncore_forcewake_for_regs(struct drm_i915_private *dev_priv,
+				const i915_reg_t *regs, unsigned int count,
+				unsigned int op)
+{
+	enum forcewake_domains fw_domains = 0;
+
+	while (count--)
+		fw_domains |= intel_uncore_forcewake_for_reg(dev_priv,
+							     *regs++, op);
+
+	return fw_domains;
+}
+
+/**
+ * intel_uncore_fw_batch_begin - prepare for raw access to a set of registers
+ * @dev_priv: pointer to struct drm_i915_private
+ * @batch: the batch to track the acquired forcewake domains
+ * @regs: array of registers that will be accessed
+ * @count: number of registers in @regs
+ * @op: operation bitmask of FW_REG_READ and/or FW_REG_WRITE
+ *
+ * Looks up the forcewake domains for all of @regs once and takes them under
+ * a single acquisition of the uncore.lock, so that the following accesses
+ * can use I915_READ_FW() and friends instead of paying for the domain lookup,
+ * locking and forcewake bookkeeping on every register. The uncore.lock is
+ * held with interrupts disabled until intel_uncore_fw_batch_end(), so the
+ * batch must be kept short and must not sleep.
+ *
+ * NOTE: As with intel_uncore_forcewake_for_reg(), on Gen6 and Gen7 writes
+ * are left to the caller to manage the FIFO.
+ */
+void intel_uncore_fw_batch_begin(struct drm_i915_private *dev_priv,
+				 struct intel_uncore_fw_batch *batch,
+				 const i915_reg_t *regs, unsigned int count,
+				 unsigned int op)
+{
+	batch->domains = intel_uncore_forcewake_for_regs(dev_priv,
+							 regs, count, op);
+
+	spin_lock_irqsave(&dev_priv->uncore.lock, batch->flags);
+	if (batch->domains)
+		intel_uncore_forcewake_get__locked(dev_priv, batch->domains);
+}
+
+/**
+ * intel_uncore_fw_batch_end - finish a batch of raw register accesses
+ * @dev_priv: pointer to struct drm_i915_private
+ * @batch: the batch started by intel_uncore_fw_batch_begin()
+ */
+void intel_uncore_fw_batch_end(struct drm_i915_private *dev_priv,
+			       struct intel_uncore_fw_batch *batch)
+{
+	if (batch->domains)
+		intel_uncore_forcewake_put__locked(dev_priv, batch->domains);
+	spin_unlock_irqrestore(&dev_priv->uncore.lock, batch->flags);
+}
+
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
 #include "selftests/mock_uncore.c"
 #include "selftests/intel_uncore.c"
@@ -117,6 +117,21 @@ struct intel_uncore {
 		struct hrtimer timer;
 		i915_reg_t reg_set;
 		i915_reg_t reg_ack;
+
+		/*
+		 * How long to keep the domain awake after its last use. It
+		 * adapts to the access pattern, growing each time the domain
+		 * is woken up again soon after being released and decaying
+		 * back when the domain is left asleep for long.
+		 */
+		u32 hold_ns;
+		ktime_t released;
+
+		struct {
+			unsigned long acquisitions;
+			unsigned long fallbacks;
+			u64 ack_wait_ns;
+		} stats;
 	} fw_domain[FW_DOMAIN_ID_COUNT];
 
 	struct {
@@ -159,6 +174,22 @@ intel_uncore_forcewake_for_reg(struct drm_i915_private *dev_priv,
 			       i915_reg_t reg, unsigned int op);
 #define FW_REG_READ  (1)
 #define FW_REG_WRITE (2)
+enum forcewake_domains
+intel_uncore_forcewake_for_regs(struct drm_i915_private *dev_priv,
+				const i915_reg_t *regs, unsigned int count,
+				unsigned int op);
+
+struct intel_uncore_fw_batch {
+	enum forcewake_domains domains;
+	unsigned long flags;
+};
+
+void intel_uncore_fw_batch_begin(struct drm_i915_private *dev_priv,
+				 struct intel_uncore_fw_batch *batch,
+				 const i915_reg_t *regs, unsigned int count,
+				 unsigned int op);
+void intel_uncore_fw_batch_end(struct drm_i915_private *dev_priv,
+			       struct intel_uncore_fw_batch *batch);
 
 void intel_uncore_forcewake_get(struct drm_i915_private *dev_priv,
 				enum forcewake_domains domains);
@@ -0,0 +1,159 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright © 2018 Intel Corporation
+ */
+
+#include "../i915_selftest.h"
+
+#include "igt_perf.h"
+
+static const struct {
+	const char *name;
+	const struct drm_i915_cmd_table *tables;
+	int count;
+} cmd_parser_tables[] = {
+#define T(x) { #x, x, ARRAY_SIZE(x) }
+	T(gen7_render_cmds),
+	T(hsw_render_ring_cmds),
+	T(gen7_video_cmds),
+	T(hsw_vebox_cmds),
+	T(gen7_blt_cmds),
+	T(hsw_blt_ring_cmds),
+#undef T
+};
+
+static const struct drm_i915_cmd_descriptor *
+linear_find_cmd(const struct drm_i915_cmd_table *tables, int count, u32 header)
+{
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < tables[i].count; j++) {
+			const struct drm_i915_cmd_descriptor *desc =
+				&tables[i].table[j];
+
+			if (((header ^ desc->cmd.value) & desc->cmd.mask) == 0)
+				return desc;
+		}
+	}
+
+	return NULL;
+}
+
+struct cmd_lookup_pass {
+	struct intel_engine_cs *engine;
+	const struct drm_i915_cmd_table *tables;
+	int count;
+};
+
+static long hashed_lookup(void *data)
+{
+	const struct cmd_lookup_pass *arg = data;
+	struct intel_engine_cs *engine = arg->engine;
+	unsigned int i;
+
+	for (i = 0; i < engine->cmd_lookup.count; i++)
+		find_cmd_in_table(engine, engine->cmd_lookup.desc[i]->cmd.value);
+
+	return engine->cmd_lookup.count;
+}
+
+static long linear_lookup(void *data)
+{
+	const struct cmd_lookup_pass *arg = data;
+	struct intel_engine_cs *engine = arg->engine;
+	unsigned int i;
+
+	for (i = 0; i < engine->cmd_lookup.count; i++)
+		linear_find_cmd(arg->tables, arg->count,
+				engine->cmd_lookup.desc[i]->cmd.value);
+
+	return engine->cmd_lookup.count;
+}
+
+static int igt_cmd_lookup(void *ignored)
+{
+	const unsigned long duration = msecs_to_jiffies(10);
+	struct intel_engine_cs *engine;
+	int err = 0;
+	int t;
+
+	engine = kzalloc(sizeof(*engine), GFP_KERNEL);
+	if (!engine)
+		return -ENOMEM;
+
+	for (t = 0; t < ARRAY_SIZE(cmd_parser_tables); t++) {
+		const struct drm_i915_cmd_table *tables =
+			cmd_parser_tables[t].tables;
+		const int count = cmd_parser_tables[t].count;
+		struct cmd_lookup_pass arg = {
+			.engine = engine,
+			.tables = tables,
+			.count = count,
+		};
+		long hashed, linear;
+		u64 dt_hashed, dt_linear;
+		unsigned int i;
+
+		snprintf(engine->name, sizeof(engine->name), "%s",
+			 cmd_parser_tables[t].name);
+
+		err = init_cmd_lookup(engine, tables, count);
+		if (err) {
+			pr_err("%s: failed to build the command lookup, err=%d\n",
+			       engine->name, err);
+			break;
+		}
+
+		/* Every command must be found, by a descriptor matching it */
+		for (i = 0; i < engine->cmd_lookup.count; i++) {
+			const u32 header = engine->cmd_lookup.desc[i]->cmd.value;
+			const struct drm_i915_cmd_descriptor *desc;
+
+			desc = find_cmd_in_table(engine, header);
+			if (!desc ||
+			    ((header ^ desc->cmd.value) & desc->cmd.mask)) {
+				pr_err("%s: lookup of command %08x failed, found %08x\n",
+				       engine->name, header,
+				       desc ? desc->cmd.value : 0);
+				err = -EINVAL;
+				break;
+			}
+		}
+
+		if (!err) {
+			hashed = igt_perf_repeat(duration, hashed_lookup,
+						 &arg, &dt_hashed);
+			linear = igt_perf_repeat(duration, linear_lookup,
+						 &arg, &dt_linear);
+
+			pr_info("%s: %u commands in %u slots\n",
+				engine->name,
+				engine->cmd_lookup.count,
+				1u << engine->cmd_lookup.order);
+			igt_perf_rate("cmd-lookup-hashed", engine->name,
+				      hashed, dt_hashed);
+			igt_perf_rate("cmd-lookup-linear", engine->name,
+				      linear, dt_linear);
+		}
+
+		fini_cmd_lookup(engine);
+		if (err)
+			break;
+
+		cond_resched();
+	}
+
+	kfree(engine);
+	return err;
+}
+
+int i915_cmd_parser_mock_selftests(void)
+{
+	static const struct i915_subtest tests[] = {
+		SUBTEST(igt_cmd_lookup),
+	};
+
+	return i915_subtests(tests, NULL);
+}
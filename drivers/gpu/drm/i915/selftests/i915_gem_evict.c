@@ -24,6 +24,7 @@
 
 #include "../i915_selftest.h"
 
+#include "igt_perf.h"
 #include "lib_sw_fence.h"
 #include "mock_context.h"
 #include "mock_drm.h"
@@ -131,6 +132,67 @@ static int igt_evict_something(void *arg)
 	return err;
 }
 
+static int igt_evict_something_bench(void *arg)
+{
+	const unsigned int count = 1024;
+	struct drm_i915_private *i915 = arg;
+	struct i915_ggtt *ggtt = &i915->ggtt;
+	unsigned int n;
+	u64 elapsed;
+	int err;
+
+	/*
+	 * Time i915_gem_evict_something() against a full GGTT of unpinned
+	 * objects. After each eviction we bind a fresh object into the hole,
+	 * so that every pass scans the same number of nodes.
+	 */
+
+	err = populate_ggtt(i915);
+	if (err)
+		goto cleanup;
+
+	unpin_ggtt(i915);
+
+	elapsed = 0;
+	for (n = 0; n < count; n++) {
+		struct drm_i915_gem_object *obj;
+		struct i915_vma *vma;
+		ktime_t dt;
+
+		dt = ktime_get_raw();
+		err = i915_gem_evict_something(&ggtt->vm,
+					       I915_GTT_PAGE_SIZE, 0, 0,
+					       0, U64_MAX,
+					       0);
+		elapsed += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+		if (err) {
+			pr_err("i915_gem_evict_something failed on a full GGTT with err=%d\n",
+			       err);
+			goto cleanup;
+		}
+
+		obj = i915_gem_object_create_internal(i915, I915_GTT_PAGE_SIZE);
+		if (IS_ERR(obj)) {
+			err = PTR_ERR(obj);
+			goto cleanup;
+		}
+
+		vma = i915_gem_object_ggtt_pin(obj, NULL, 0, 0, 0);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			goto cleanup;
+		}
+
+		i915_vma_unpin(vma);
+	}
+
+	igt_perf_rate("evict-something", "mock", count, elapsed);
+
+cleanup:
+	cleanup_objects(i915);
+	return err;
+}
+
 static int igt_overcommit(void *arg)
 {
 	struct drm_i915_private *i915 = arg;
@@ -478,6 +540,7 @@ int i915_gem_evict_mock_selftests(void)
 		SUBTEST(igt_evict_for_cache_color),
 		SUBTEST(igt_evict_vm),
 		SUBTEST(igt_overcommit),
+		SUBTEST(igt_evict_something_bench),
 	};
 	struct drm_i915_private *i915;
 	int err;
@@ -27,6 +27,7 @@
 
 #include "../i915_selftest.h"
 #include "i915_random.h"
+#include "igt_perf.h"
 
 #include "mock_context.h"
 #include "mock_drm.h"
@@ -1653,6 +1654,142 @@ static int igt_gtt_insert(void *arg)
 	return err;
 }
 
+static int igt_gtt_insert_bench(void *arg)
+{
+	const unsigned int passes = 16;
+	struct drm_i915_private *i915 = arg;
+	struct i915_ggtt *ggtt = &i915->ggtt;
+	void (*saved)(const struct drm_mm_node *node,
+		      unsigned long color, u64 *start, u64 *end);
+	struct drm_mm_node *nodes;
+	unsigned long count, n;
+	unsigned int pass;
+	u64 elapsed;
+	int err = 0;
+
+	/*
+	 * Time i915_gem_gtt_insert() into the GGTT with the same cache
+	 * coloring as used on !llc platforms, alternating the color of each
+	 * node so that every insertion has to apply a guard page. A quarter
+	 * of the GGTT is filled each pass, so that we never need to evict.
+	 */
+
+	count = div64_u64(ggtt->vm.total, 4 * I915_GTT_PAGE_SIZE);
+	nodes = kvmalloc_array(count, sizeof(*nodes), GFP_KERNEL);
+	if (!nodes)
+		return -ENOMEM;
+
+	saved = ggtt->vm.mm.color_adjust;
+	ggtt->vm.mm.color_adjust = i915_gtt_color_adjust;
+
+	elapsed = 0;
+	for (pass = 0; pass < passes; pass++) {
+		ktime_t dt;
+
+		memset(nodes, 0, count * sizeof(*nodes));
+
+		dt = ktime_get_raw();
+		for (n = 0; n < count; n++) {
+			err = i915_gem_gtt_insert(&ggtt->vm, &nodes[n],
+						  I915_GTT_PAGE_SIZE, 0, n & 1,
+						  0, ggtt->vm.total,
+						  0);
+			if (err) {
+				pr_err("i915_gem_gtt_insert failed at node %lu/%lu, err=%d\n",
+				       n, count, err);
+				break;
+			}
+		}
+		elapsed += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+		while (n--)
+			drm_mm_remove_node(&nodes[n]);
+
+		if (err)
+			break;
+
+		cond_resched();
+	}
+
+	if (!err)
+		igt_perf_rate("gtt-insert-color", "mock",
+			      passes * count, elapsed);
+
+	ggtt->vm.mm.color_adjust = saved;
+	kvfree(nodes);
+	return err;
+}
+
+static int igt_mock_fill_ptes(void *arg)
+{
+	const struct fill_ptes_path {
+		const char *name;
+		void (*fill)(gen8_pte_t *pte, gen8_pte_t encode,
+			     unsigned int count);
+	} paths[] = {
+		{ "scalar", gen8_fill_ptes_scalar },
+#ifdef CONFIG_X86_64
+		{ "sse2", gen8_fill_ptes_sse2 },
+#endif
+		{ "auto", gen8_fill_ptes },
+		{}
+	}, *p;
+	const gen8_pte_t encode = gen8_pte_encode(0, I915_CACHE_LLC, 0);
+	const unsigned int count = GEN8_PTES;
+	gen8_pte_t *ptes;
+	int err = 0;
+
+	ptes = kmalloc_array(count, sizeof(*ptes), GFP_KERNEL);
+	if (!ptes)
+		return -ENOMEM;
+
+	for (p = paths; p->name; p++) {
+		unsigned int n, len;
+		ktime_t dt, end;
+		u64 passes;
+
+		/* Check each path encodes every length of run identically */
+		for (len = 1; len <= count; len++) {
+			memset(ptes, 0, count * sizeof(*ptes));
+			p->fill(ptes, encode | 0xdead000, len);
+
+			for (n = 0; n < count; n++) {
+				gen8_pte_t expected =
+					n < len ? (encode | 0xdead000) +
+						  n * PAGE_SIZE : 0;
+
+				if (ptes[n] != expected) {
+					pr_err("%s: pte[%u] of %u was %llx, expected %llx\n",
+					       p->name, n, len,
+					       ptes[n], expected);
+					err = -EINVAL;
+					goto out;
+				}
+			}
+		}
+
+		/* Then see how fast we can fill a page table */
+		passes = 0;
+		dt = ktime_get_raw();
+		end = ktime_add_ms(dt, 100);
+		do {
+			p->fill(ptes, encode | (passes << 21), count);
+			passes++;
+		} while (ktime_before(ktime_get_raw(), end));
+		dt = ktime_sub(ktime_get_raw(), dt);
+
+		pr_info("%s: filled %llu ptes in %lldns, binding %llu MiB/s\n",
+			p->name, passes * count, ktime_to_ns(dt),
+			div64_u64(((passes * count * PAGE_SIZE) >> 20) *
+				  NSEC_PER_SEC,
+				  max_t(u64, ktime_to_ns(dt), 1)));
+	}
+
+out:
+	kfree(ptes);
+	return err;
+}
+
 int i915_gem_gtt_mock_selftests(void)
 {
 	static const struct i915_subtest tests[] = {
@@ -1662,6 +1799,8 @@ int i915_gem_gtt_mock_selftests(void)
 		SUBTEST(igt_mock_fill),
 		SUBTEST(igt_gtt_reserve),
 		SUBTEST(igt_gtt_insert),
+		SUBTEST(igt_gtt_insert_bench),
+		SUBTEST(igt_mock_fill_ptes),
 	};
 	struct drm_i915_private *i915;
 	int err;
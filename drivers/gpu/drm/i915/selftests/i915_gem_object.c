@@ -630,12 +630,122 @@ int i915_gem_object_mock_selftests(void)
 	return err;
 }
 
+static int igt_pread_wc_stream(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	const unsigned int size = SZ_8M;
+	static const struct {
+		const char *name;
+		int (*pread)(struct drm_i915_gem_object *obj,
+			     const struct drm_i915_gem_pread *args);
+	} paths[] = {
+		{ "shmem", i915_gem_shmem_pread },
+		{ "wc-stream", i915_gem_gtt_pread },
+		{}
+	}, *p;
+	struct drm_i915_gem_pread args = {};
+	struct drm_i915_gem_object *obj;
+	unsigned long addr;
+	u32 *map;
+	int err;
+
+	/* Compare reading back an uncached object via shmem and the GTT */
+
+	if (!i915_has_memcpy_from_wc()) {
+		pr_info("%s: no support for streaming loads, skipping\n",
+			__func__);
+		return 0;
+	}
+
+	obj = i915_gem_object_create(i915, size);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	mutex_lock(&i915->drm.struct_mutex);
+	err = i915_gem_object_set_cache_level(obj, I915_CACHE_NONE);
+	if (err == 0)
+		err = i915_gem_object_set_to_cpu_domain(obj, true);
+	mutex_unlock(&i915->drm.struct_mutex);
+	if (err)
+		goto out_put;
+
+	map = i915_gem_object_pin_map(obj, I915_MAP_WB);
+	if (IS_ERR(map)) {
+		err = PTR_ERR(map);
+		goto out_put;
+	}
+	memset32(map, 0xc0ffee, size / sizeof(*map));
+	map[size / sizeof(*map) - 1] = 0xdeadbeef;
+	i915_gem_object_unpin_map(obj);
+
+	addr = vm_mmap(NULL, 0, size, PROT_READ | PROT_WRITE,
+		       MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (IS_ERR_VALUE(addr)) {
+		err = addr;
+		goto out_put;
+	}
+
+	err = i915_gem_object_pin_pages(obj);
+	if (err)
+		goto out_unmap;
+
+	args.size = size;
+	args.data_ptr = addr;
+	for (p = paths; p->name; p++) {
+		ktime_t dt = 0;
+		u32 first, last;
+		int pass;
+
+		for (pass = 0; pass < 4; pass++) {
+			ktime_t t0;
+
+			if (clear_user(u64_to_user_ptr(addr), size)) {
+				err = -EFAULT;
+				goto out_unpin;
+			}
+
+			t0 = ktime_get();
+			err = p->pread(obj, &args);
+			dt = ktime_add(dt, ktime_sub(ktime_get(), t0));
+			if (err) {
+				pr_err("%s pread failed, err=%d\n", p->name, err);
+				goto out_unpin;
+			}
+		}
+
+		if (get_user(first, (u32 __user *)addr) ||
+		    get_user(last, (u32 __user *)(addr + size) - 1)) {
+			err = -EFAULT;
+			goto out_unpin;
+		}
+		if (first != 0xc0ffee || last != 0xdeadbeef) {
+			pr_err("%s pread returned [%08x, .., %08x], expected [%08x, .., %08x]\n",
+			       p->name, first, last, 0xc0ffee, 0xdeadbeef);
+			err = -EINVAL;
+			goto out_unpin;
+		}
+
+		pr_info("%s: %s pread %lluMiB/s\n", __func__, p->name,
+			div64_u64(mul_u32_u32(4 * size, NSEC_PER_SEC),
+				  max_t(u64, ktime_to_ns(dt), 1)) >> 20);
+	}
+
+out_unpin:
+	i915_gem_object_unpin_pages(obj);
+out_unmap:
+	vm_munmap(addr, size);
+out_put:
+	i915_gem_object_put(obj);
+	return err;
+}
+
 int i915_gem_object_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
 		SUBTEST(igt_gem_huge),
 		SUBTEST(igt_partial_tiling),
 		SUBTEST(igt_mmap_offset_exhaustion),
+		SUBTEST(igt_pread_wc_stream),
 	};
 
 	return i915_subtests(tests, i915);
@@ -25,6 +25,7 @@
 #include <linux/prime_numbers.h>
 
 #include "../i915_selftest.h"
+#include "igt_perf.h"
 
 #include "mock_context.h"
 #include "mock_gem_device.h"
@@ -857,6 +858,213 @@ static int live_sequential_engines(void *arg)
 	return err;
 }
 
+#define PERF_SAMPLES 31
+
+static int live_perf_nop_throughput(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct intel_engine_cs *engine;
+	struct live_test t;
+	unsigned int id;
+	int err = -ENODEV;
+
+	/*
+	 * Keep each engine saturated with empty requests for the duration
+	 * of the timeout, and report how many we managed to push through.
+	 */
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	for_each_engine(engine, i915, id) {
+		struct i915_request *request = NULL;
+		unsigned long count = 0;
+		IGT_TIMEOUT(end_time);
+		ktime_t dt;
+		int n;
+
+		err = begin_live_test(&t, i915, __func__, engine->name);
+		if (err)
+			goto out_unlock;
+
+		dt = ktime_get_raw();
+		do {
+			for (n = 0; n < 64; n++) {
+				request = i915_request_alloc(engine,
+							     i915->kernel_context);
+				if (IS_ERR(request)) {
+					err = PTR_ERR(request);
+					goto out_unlock;
+				}
+
+				i915_request_add(request);
+			}
+			count += n;
+		} while (!__igt_timeout(end_time, NULL));
+		i915_request_wait(request,
+				  I915_WAIT_LOCKED,
+				  MAX_SCHEDULE_TIMEOUT);
+		dt = ktime_sub(ktime_get_raw(), dt);
+
+		err = end_live_test(&t);
+		if (err)
+			goto out_unlock;
+
+		igt_perf_rate("nop-throughput", engine->name,
+			      count, ktime_to_ns(dt));
+	}
+
+out_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
+static int live_perf_request_latency(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct intel_engine_cs *engine;
+	u64 samples[PERF_SAMPLES];
+	struct live_test t;
+	unsigned int id;
+	int err = -ENODEV;
+
+	/*
+	 * Measure the round trip of a single empty request on an idle
+	 * engine: from construction, through submission to the hardware
+	 * (the ELSP write on execlists), to the breadcrumb interrupt waking
+	 * us up again.
+	 */
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	for_each_engine(engine, i915, id) {
+		int n;
+
+		err = begin_live_test(&t, i915, __func__, engine->name);
+		if (err)
+			goto out_unlock;
+
+		for (n = 0; n < PERF_SAMPLES; n++) {
+			struct i915_request *request;
+			ktime_t dt;
+
+			dt = ktime_get_raw();
+
+			request = i915_request_alloc(engine,
+						     i915->kernel_context);
+			if (IS_ERR(request)) {
+				err = PTR_ERR(request);
+				goto out_unlock;
+			}
+
+			i915_request_add(request);
+			if (i915_request_wait(request,
+					      I915_WAIT_LOCKED,
+					      HZ / 5) < 0) {
+				pr_err("%s: request timed out\n", engine->name);
+				err = -ETIME;
+				goto out_unlock;
+			}
+
+			samples[n] = ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+		}
+
+		err = end_live_test(&t);
+		if (err)
+			goto out_unlock;
+
+		igt_perf_latency("request-latency", engine->name,
+				 samples, PERF_SAMPLES);
+	}
+
+out_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
+static int live_perf_engine_handoff(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct intel_engine_cs *from, *to;
+	enum intel_engine_id fid, tid;
+	u64 samples[PERF_SAMPLES];
+	struct live_test t;
+	int err = 0;
+
+	/*
+	 * Measure how long it takes for an empty request on one engine to
+	 * be signaled and release a request waiting for it on another.
+	 */
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	for_each_engine(from, i915, fid) {
+		for_each_engine(to, i915, tid) {
+			char name[2 * sizeof(from->name) + 2];
+			int n;
+
+			if (from == to)
+				continue;
+
+			snprintf(name, sizeof(name), "%s->%s",
+				 from->name, to->name);
+
+			err = begin_live_test(&t, i915, __func__, name);
+			if (err)
+				goto out_unlock;
+
+			for (n = 0; n < PERF_SAMPLES; n++) {
+				struct i915_request *first, *second;
+				ktime_t dt;
+
+				dt = ktime_get_raw();
+
+				first = i915_request_alloc(from,
+							   i915->kernel_context);
+				if (IS_ERR(first)) {
+					err = PTR_ERR(first);
+					goto out_unlock;
+				}
+				i915_request_add(first);
+
+				second = i915_request_alloc(to,
+							    i915->kernel_context);
+				if (IS_ERR(second)) {
+					err = PTR_ERR(second);
+					goto out_unlock;
+				}
+
+				err = i915_request_await_dma_fence(second,
+								   &first->fence);
+				i915_request_add(second);
+				if (err)
+					goto out_unlock;
+
+				if (i915_request_wait(second,
+						      I915_WAIT_LOCKED,
+						      HZ / 5) < 0) {
+					pr_err("%s: request timed out\n", name);
+					err = -ETIME;
+					goto out_unlock;
+				}
+
+				samples[n] = ktime_to_ns(ktime_sub(ktime_get_raw(),
+								   dt));
+			}
+
+			err = end_live_test(&t);
+			if (err)
+				goto out_unlock;
+
+			igt_perf_latency("engine-handoff", name,
+					 samples, PERF_SAMPLES);
+		}
+	}
+
+out_unlock:
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
 int i915_request_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
@@ -864,6 +1072,9 @@ int i915_request_live_selftests(struct drm_i915_private *i915)
 		SUBTEST(live_all_engines),
 		SUBTEST(live_sequential_engines),
 		SUBTEST(live_empty_request),
+		SUBTEST(live_perf_nop_throughput),
+		SUBTEST(live_perf_request_latency),
+		SUBTEST(live_perf_engine_handoff),
 	};
 
 	if (i915_terminally_wedged(&i915->gpu_error))
@@ -27,6 +27,7 @@
 #include <linux/prime_numbers.h>
 
 #include "../i915_selftest.h"
+#include "igt_perf.h"
 
 static int __i915_sw_fence_call
 fence_notify(struct i915_sw_fence *fence, enum i915_sw_fence_notify state)
@@ -502,6 +503,80 @@ static int test_chain(void *arg)
 	return ret;
 }
 
+static int test_chain_bench(void *arg)
+{
+	const int nfences = 4096;
+	const unsigned int passes = 16;
+	struct i915_sw_fence **fences;
+	u64 await_ns, signal_ns;
+	unsigned int pass;
+	int ret = 0, i;
+
+	/*
+	 * Time building a long chain of fences, and then how long it takes
+	 * for the signal to propagate down the chain once the first fence
+	 * is committed.
+	 */
+	fences = kmalloc_array(nfences, sizeof(*fences), GFP_KERNEL);
+	if (!fences)
+		return -ENOMEM;
+
+	await_ns = 0;
+	signal_ns = 0;
+	for (pass = 0; pass < passes; pass++) {
+		int count;
+		ktime_t dt;
+
+		for (count = 0; count < nfences; count++) {
+			fences[count] = alloc_fence();
+			if (!fences[count]) {
+				ret = -ENOMEM;
+				goto err;
+			}
+		}
+
+		dt = ktime_get_raw();
+		for (i = 1; i < nfences; i++) {
+			ret = i915_sw_fence_await_sw_fence_gfp(fences[i],
+							       fences[i - 1],
+							       GFP_KERNEL);
+			if (ret < 0)
+				break;
+
+			i915_sw_fence_commit(fences[i]);
+		}
+		await_ns += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+		dt = ktime_get_raw();
+		i915_sw_fence_commit(fences[0]);
+		signal_ns += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+		if (ret >= 0 && !i915_sw_fence_done(fences[nfences - 1])) {
+			pr_err("Fence[%d] is not done\n", nfences - 1);
+			ret = -EINVAL;
+		}
+
+err:
+		for (i = 0; i < count; i++)
+			free_fence(fences[i]);
+		if (ret < 0)
+			break;
+
+		cond_resched();
+	}
+
+	if (ret >= 0) {
+		igt_perf_rate("sw-fence-await", "mock",
+			      passes * (nfences - 1), await_ns);
+		igt_perf_rate("sw-fence-signal", "mock",
+			      passes * nfences, signal_ns);
+		ret = 0;
+	}
+
+	kfree(fences);
+	return ret;
+}
+
 struct task_ipc {
 	struct work_struct work;
 	struct completion started;
@@ -749,6 +824,7 @@ int i915_sw_fence_mock_selftests(void)
 		SUBTEST(test_AB_C),
 		SUBTEST(test_C_AB),
 		SUBTEST(test_chain),
+		SUBTEST(test_chain_bench),
 		SUBTEST(test_ipc),
 		SUBTEST(test_timer),
 		SUBTEST(test_dma_fence),
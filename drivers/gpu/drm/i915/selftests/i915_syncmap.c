@@ -24,6 +24,7 @@
 
 #include "../i915_selftest.h"
 #include "i915_random.h"
+#include "igt_perf.h"
 
 static char *
 __sync_print(struct i915_syncmap *p,
@@ -59,7 +60,7 @@ __sync_print(struct i915_syncmap *p,
 	scnprintf(buf - X, *sz + X, "%*s", X, "XXXXXXXXXXXXXXXXX");
 
 	if (!p->height) {
-		for_each_set_bit(i, (unsigned long *)&p->bitmap, KSYNCMAP) {
+		for_each_set_bit(i, &p->bitmap, KSYNCMAP) {
 			len = scnprintf(buf, *sz, " %x:%x,",
 					i, __sync_seqno(p)[i]);
 			buf += len;
@@ -74,10 +75,10 @@ __sync_print(struct i915_syncmap *p,
 	*sz -= len;
 
 	if (p->height) {
-		for_each_set_bit(i, (unsigned long *)&p->bitmap, KSYNCMAP) {
+		for_each_set_bit(i, &p->bitmap, KSYNCMAP) {
 			buf = __sync_print(__sync_child(p)[i], buf, sz,
 					   depth + 1,
-					   last << 1 | !!(p->bitmap >> (i + 1)),
+					   last << 1 | !!(p->bitmap >> i >> 1),
 					   i);
 		}
 	}
@@ -180,9 +181,9 @@ static int check_one(struct i915_syncmap **sync, u64 context, u32 seqno)
 		return -EINVAL;
 	}
 
-	if (hweight32((*sync)->bitmap) != 1) {
-		pr_err("First bitmap does not contain a single entry, found %x (count=%d)!\n",
-		       (*sync)->bitmap, hweight32((*sync)->bitmap));
+	if (hweight_long((*sync)->bitmap) != 1) {
+		pr_err("First bitmap does not contain a single entry, found %lx (count=%d)!\n",
+		       (*sync)->bitmap, hweight_long((*sync)->bitmap));
 		return -EINVAL;
 	}
 
@@ -249,9 +250,9 @@ static int check_leaf(struct i915_syncmap **sync, u64 context, u32 seqno)
 		return -EINVAL;
 	}
 
-	if (hweight32((*sync)->bitmap) != 1) {
-		pr_err("First entry into leaf (context=%llx) does not contain a single entry, found %x (count=%d)!\n",
-		       context, (*sync)->bitmap, hweight32((*sync)->bitmap));
+	if (hweight_long((*sync)->bitmap) != 1) {
+		pr_err("First entry into leaf (context=%llx) does not contain a single entry, found %lx (count=%d)!\n",
+		       context, (*sync)->bitmap, hweight_long((*sync)->bitmap));
 		return -EINVAL;
 	}
 
@@ -311,9 +312,9 @@ static int igt_syncmap_join_above(void *arg)
 				goto out;
 			}
 
-			if (hweight32(join->bitmap) != 2) {
-				pr_err("Join does not have 2 children: %x (%d)\n",
-				       join->bitmap, hweight32(join->bitmap));
+			if (hweight_long(join->bitmap) != 2) {
+				pr_err("Join does not have 2 children: %lx (%d)\n",
+				       join->bitmap, hweight_long(join->bitmap));
 				err = -EINVAL;
 				goto out;
 			}
@@ -342,7 +343,9 @@ static int igt_syncmap_join_below(void *arg)
 	 * a join.
 	 */
 	for (step = 0; step < KSYNCMAP; step++) {
-		for (order = 64 - SHIFT; order > 0; order -= SHIFT) {
+		for (order = rounddown(64 - SHIFT, SHIFT);
+		     order > 0;
+		     order -= SHIFT) {
 			u64 context = step * BIT_ULL(order);
 
 			err = i915_syncmap_set(&sync, context, 0);
@@ -359,7 +362,7 @@ static int igt_syncmap_join_below(void *arg)
 	}
 
 	for (step = 0; step < KSYNCMAP; step++) {
-		for (order = SHIFT; order < 64; order += SHIFT) {
+		for (order = SHIFT; order <= 64 - SHIFT; order += SHIFT) {
 			u64 context = step * BIT_ULL(order);
 
 			if (!i915_syncmap_is_later(&sync, context, 0)) {
@@ -380,7 +383,7 @@ static int igt_syncmap_join_below(void *arg)
 		}
 	}
 
-	for (order = SHIFT; order < 64; order += SHIFT) {
+	for (order = SHIFT; order <= 64 - SHIFT; order += SHIFT) {
 		for (step = 0; step < KSYNCMAP; step++) {
 			u64 context = step * BIT_ULL(order);
 
@@ -429,11 +432,11 @@ static int igt_syncmap_neighbours(void *arg)
 				goto out;
 			}
 
-			if (sync->bitmap != BIT(idx + 1) - 1) {
-				pr_err("Inserting neighbouring context=0x%llx+%d, did not fit into the same leaf bitmap=%x (%d), expected %lx (%d)\n",
+			if (sync->bitmap != GENMASK(idx, 0)) {
+				pr_err("Inserting neighbouring context=0x%llx+%d, did not fit into the same leaf bitmap=%lx (%d), expected %lx (%d)\n",
 				       context, idx,
-				       sync->bitmap, hweight32(sync->bitmap),
-				       BIT(idx + 1) - 1, idx + 1);
+				       sync->bitmap, hweight_long(sync->bitmap),
+				       GENMASK(idx, 0), idx + 1);
 				err = -EINVAL;
 				goto out;
 			}
@@ -459,7 +462,7 @@ static int igt_syncmap_compact(void *arg)
 	 * height, we form a join but each child of that join is directly a
 	 * leaf holding the single id.
 	 */
-	for (order = SHIFT; order < 64; order += SHIFT) {
+	for (order = SHIFT; order <= 64 - SHIFT; order += SHIFT) {
 		err = check_syncmap_free(&sync);
 		if (err)
 			goto out;
@@ -495,10 +498,10 @@ static int igt_syncmap_compact(void *arg)
 			goto out;
 		}
 
-		if (sync->bitmap != BIT(KSYNCMAP) - 1) {
-			pr_err("Join is not full!, found %x (%d) expected %lx (%d)\n",
-			       sync->bitmap, hweight32(sync->bitmap),
-			       BIT(KSYNCMAP) - 1, KSYNCMAP);
+		if (sync->bitmap != GENMASK(KSYNCMAP - 1, 0)) {
+			pr_err("Join is not full!, found %lx (%d) expected %lx (%d)\n",
+			       sync->bitmap, hweight_long(sync->bitmap),
+			       GENMASK(KSYNCMAP - 1, 0), KSYNCMAP);
 			err = -EINVAL;
 			goto out;
 		}
@@ -521,8 +524,8 @@ static int igt_syncmap_compact(void *arg)
 			}
 
 			if (!is_power_of_2(leaf->bitmap)) {
-				pr_err("Child %d holds more than one id, found %x (%d)\n",
-				       idx, leaf->bitmap, hweight32(leaf->bitmap));
+				pr_err("Child %d holds more than one id, found %lx (%d)\n",
+				       idx, leaf->bitmap, hweight_long(leaf->bitmap));
 				err = -EINVAL;
 				goto out;
 			}
@@ -600,6 +603,63 @@ static int igt_syncmap_random(void *arg)
 	return dump_syncmap(sync, err);
 }
 
+static int igt_syncmap_bench(void *arg)
+{
+	const unsigned long count = 4096;
+	const unsigned int passes = 64;
+	struct i915_syncmap *sync;
+	unsigned long i;
+	unsigned int pass;
+	u64 set_ns, later_ns;
+	ktime_t dt;
+	int err = 0;
+
+	i915_syncmap_init(&sync);
+
+	/*
+	 * Time i915_syncmap_set() and i915_syncmap_is_later() over a fixed
+	 * set of random contexts. The prng is seeded with a constant (rather
+	 * than the selftest seed) so that every run walks the same tree.
+	 */
+
+	set_ns = 0;
+	later_ns = 0;
+	for (pass = 0; pass < passes; pass++) {
+		struct rnd_state prng = I915_RND_STATE_INITIALIZER(0);
+
+		dt = ktime_get_raw();
+		for (i = 0; i < count; i++) {
+			err = i915_syncmap_set(&sync,
+					       i915_prandom_u64_state(&prng),
+					       pass);
+			if (err)
+				goto out;
+		}
+		set_ns += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+		prng = I915_RND_STATE_INITIALIZER(0);
+		dt = ktime_get_raw();
+		for (i = 0; i < count; i++) {
+			if (!i915_syncmap_is_later(&sync,
+						   i915_prandom_u64_state(&prng),
+						   pass)) {
+				pr_err("context %lu lost its seqno %u\n",
+				       i, pass);
+				err = -EINVAL;
+				goto out;
+			}
+		}
+		later_ns += ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+		cond_resched();
+	}
+
+	igt_perf_rate("syncmap-set", "mock", passes * count, set_ns);
+	igt_perf_rate("syncmap-is-later", "mock", passes * count, later_ns);
+out:
+	return dump_syncmap(sync, err);
+}
+
 int i915_syncmap_mock_selftests(void)
 {
 	static const struct i915_subtest tests[] = {
@@ -610,6 +670,7 @@ int i915_syncmap_mock_selftests(void)
 		SUBTEST(igt_syncmap_neighbours),
 		SUBTEST(igt_syncmap_compact),
 		SUBTEST(igt_syncmap_random),
+		SUBTEST(igt_syncmap_bench),
 	};
 
 	return i915_subtests(tests, NULL);
@@ -107,7 +107,9 @@ static int bench_sync(void *arg)
 	unsigned long end_time, count;
 	u64 prng32_1M;
 	ktime_t kt;
+	u64 ids[I915_TIMELINE_SYNC_CACHE];
 	int order, last_order;
+	unsigned int n;
 
 	mock_timeline_init(&tl, 0);
 
@@ -223,6 +225,48 @@ static int bench_sync(void *arg)
 	mock_timeline_fini(&tl);
 	cond_resched();
 
+	mock_timeline_init(&tl, 0);
+
+	/*
+	 * Benchmark alternating between a few timelines scattered across the
+	 * tree (e.g. the same context on each engine), which should be served
+	 * from the inline cache in front of the syncmap.
+	 */
+	prandom_seed_state(&prng, i915_selftest.random_seed);
+	for (n = 0; n < ARRAY_SIZE(ids); n++) {
+		ids[n] = i915_prandom_u64_state(&prng);
+		__i915_timeline_sync_set(&tl, ids[n], 0);
+	}
+
+	/* Push a few more leaves into the tree behind the cache */
+	for (n = 0; n < 1024; n++)
+		__i915_timeline_sync_set(&tl,
+					 i915_prandom_u64_state(&prng),
+					 0);
+	for (n = 0; n < ARRAY_SIZE(ids); n++)
+		__i915_timeline_sync_set(&tl, ids[n], 0);
+
+	count = 0;
+	kt = ktime_get();
+	end_time = jiffies + HZ/10;
+	do {
+		u64 id = ids[count % ARRAY_SIZE(ids)];
+
+		if (!__i915_timeline_sync_is_later(&tl, id, 0)) {
+			pr_err("Lookup of cached %llu failed\n", id);
+			mock_timeline_fini(&tl);
+			return -EINVAL;
+		}
+
+		count++;
+	} while (!time_after(jiffies, end_time));
+	kt = ktime_sub(ktime_get(), kt);
+	pr_info("%s: %lu scattered/%d lookups, %lluns/lookup\n",
+		__func__, count, I915_TIMELINE_SYNC_CACHE,
+		(long long)div64_ul(ktime_to_ns(kt), count));
+	mock_timeline_fini(&tl);
+	cond_resched();
+
 	/* Benchmark searching for a known context id and changing the seqno */
 	for (last_order = 1, order = 1; order < 32;
 	     ({ int tmp = last_order; last_order = order; order += tmp; })) {
@@ -26,6 +26,7 @@
 
 #include "../i915_selftest.h"
 
+#include "igt_perf.h"
 #include "mock_gem_device.h"
 #include "mock_context.h"
 
@@ -205,6 +206,70 @@ static int igt_vma_create(void *arg)
 	return err;
 }
 
+static int igt_vma_lookup_bench(void *arg)
+{
+	const unsigned int num_ctx = 64, passes = 1024;
+	struct drm_i915_private *i915 = arg;
+	struct drm_i915_gem_object *obj;
+	struct i915_gem_context *ctx, *cn;
+	struct i915_vma *vma;
+	LIST_HEAD(contexts);
+	unsigned int n;
+	ktime_t dt;
+	int err;
+
+	/*
+	 * Time the lookup of an existing vma, with the object already bound
+	 * into many address spaces so that each lookup goes through a
+	 * populated obj->vma_hash. Fixed counts keep the results comparable between
+	 * runs.
+	 */
+
+	obj = i915_gem_object_create_internal(i915, PAGE_SIZE);
+	if (IS_ERR(obj))
+		return PTR_ERR(obj);
+
+	for (n = 0; n < num_ctx; n++) {
+		ctx = mock_context(i915, "mock");
+		if (!ctx) {
+			err = -ENOMEM;
+			goto out;
+		}
+
+		list_move(&ctx->link, &contexts);
+
+		vma = i915_vma_instance(obj, &ctx->ppgtt->vm, NULL);
+		if (IS_ERR(vma)) {
+			err = PTR_ERR(vma);
+			goto out;
+		}
+	}
+
+	dt = ktime_get_raw();
+	for (n = 0; n < passes; n++) {
+		list_for_each_entry(ctx, &contexts, link) {
+			vma = i915_vma_instance(obj, &ctx->ppgtt->vm, NULL);
+			if (IS_ERR(vma)) {
+				err = PTR_ERR(vma);
+				goto out;
+			}
+		}
+	}
+	dt = ktime_sub(ktime_get_raw(), dt);
+
+	igt_perf_rate("vma-lookup", "mock", passes * num_ctx, ktime_to_ns(dt));
+	err = 0;
+
+out:
+	list_for_each_entry_safe(ctx, cn, &contexts, link) {
+		list_del_init(&ctx->link);
+		mock_context_close(ctx);
+	}
+
+	i915_gem_object_put(obj);
+	return err;
+}
+
 struct pin_mode {
 	u64 size;
 	u64 flags;
@@ -721,6 +786,7 @@ int i915_vma_mock_selftests(void)
 		SUBTEST(igt_vma_pin1),
 		SUBTEST(igt_vma_rotate),
 		SUBTEST(igt_vma_partial),
+		SUBTEST(igt_vma_lookup_bench),
 	};
 	struct drm_i915_private *i915;
 	int err;
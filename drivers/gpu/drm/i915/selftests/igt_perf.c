@@ -0,0 +1,100 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright © 2018 Intel Corporation
+ */
+
+#include <linux/sort.h>
+
+#include "../i915_drv.h"
+
+#include "igt_perf.h"
+
+/*
+ * The benchmark results are emitted as single lines of key=value pairs,
+ * prefixed with "i915-perf:", so that they can be scraped out of dmesg and
+ * compared between kernels.
+ */
+
+static int cmp_u64(const void *A, const void *B)
+{
+	const u64 *a = A, *b = B;
+
+	if (*a < *b)
+		return -1;
+	else if (*a > *b)
+		return 1;
+	else
+		return 0;
+}
+
+/**
+ * igt_perf_latency - report a set of latency samples
+ * @test: name of the benchmark
+ * @engine: name of the engine(s) measured
+ * @samples: latencies in nanoseconds, sorted in place
+ * @count: number of samples
+ */
+void igt_perf_latency(const char *test, const char *engine,
+		      u64 *samples, unsigned int count)
+{
+	if (!count)
+		return;
+
+	sort(samples, count, sizeof(*samples), cmp_u64, NULL);
+
+	pr_info("i915-perf: test=%s engine=%s samples=%u min_ns=%llu median_ns=%llu max_ns=%llu\n",
+		test, engine, count,
+		samples[0], samples[count / 2], samples[count - 1]);
+}
+
+/**
+ * igt_perf_rate - report a throughput measurement
+ * @test: name of the benchmark
+ * @engine: name of the engine(s) measured
+ * @count: number of operations completed
+ * @elapsed_ns: time taken for all @count operations
+ */
+void igt_perf_rate(const char *test, const char *engine,
+		   unsigned long count, u64 elapsed_ns)
+{
+	pr_info("i915-perf: test=%s engine=%s count=%lu elapsed_ns=%llu rate_per_s=%llu\n",
+		test, engine, count, elapsed_ns,
+		div64_u64((u64)count * NSEC_PER_SEC,
+			  max_t(u64, elapsed_ns, 1)));
+}
+
+/**
+ * igt_perf_repeat - time an operation repeated for a fixed duration
+ * @duration: how long to keep calling @fn, in jiffies
+ * @fn: one pass of the operation, returning the number of operations it
+ *      completed or a negative error code to stop
+ * @data: passed to @fn
+ * @elapsed_ns: returns the time taken by all the passes
+ *
+ * @fn is called at least once, and for as long as @duration has not expired.
+ *
+ * Returns the total number of operations completed, or the error from @fn.
+ */
+long igt_perf_repeat(unsigned long duration,
+		     long (*fn)(void *data), void *data,
+		     u64 *elapsed_ns)
+{
+	unsigned long end_time = jiffies + duration;
+	ktime_t t0 = ktime_get();
+	long count = 0;
+
+	do {
+		long ret;
+
+		ret = fn(data);
+		if (ret < 0)
+			return ret;
+
+		count += ret;
+		cond_resched();
+	} while (time_before(jiffies, end_time));
+
+	*elapsed_ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+	return count;
+}
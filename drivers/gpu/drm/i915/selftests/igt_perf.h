@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: MIT
+ *
+ * Copyright © 2018 Intel Corporation
+ */
+
+#ifndef IGT_PERF_H
+#define IGT_PERF_H
+
+#include <linux/types.h>
+
+void igt_perf_latency(const char *test, const char *engine,
+		      u64 *samples, unsigned int count);
+void igt_perf_rate(const char *test, const char *engine,
+		   unsigned long count, u64 elapsed_ns);
+
+long igt_perf_repeat(unsigned long duration,
+		     long (*fn)(void *data), void *data,
+		     u64 *elapsed_ns);
+
+#endif /* IGT_PERF_H */
@@ -6,6 +6,7 @@
 
 #include "../i915_selftest.h"
 #include "igt_flush_test.h"
+#include "igt_perf.h"
 
 #include "mock_context.h"
 
@@ -565,6 +566,108 @@ static int live_preempt_hang(void *arg)
 	return err;
 }
 
+#define PERF_SAMPLES 15
+
+static int live_perf_preempt_latency(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct i915_gem_context *ctx_hi, *ctx_lo;
+	struct intel_engine_cs *engine;
+	u64 samples[PERF_SAMPLES];
+	enum intel_engine_id id;
+	struct spinner spin_lo;
+	int err = -ENOMEM;
+
+	/*
+	 * With a low priority spinner occupying the engine, measure how long
+	 * it takes from submitting an empty high priority request until it
+	 * has preempted the spinner and completed.
+	 */
+
+	if (!HAS_LOGICAL_RING_PREEMPTION(i915))
+		return 0;
+
+	mutex_lock(&i915->drm.struct_mutex);
+
+	if (spinner_init(&spin_lo, i915))
+		goto err_unlock;
+
+	ctx_hi = kernel_context(i915);
+	if (!ctx_hi)
+		goto err_spin_lo;
+	ctx_hi->sched.priority = I915_CONTEXT_MAX_USER_PRIORITY;
+
+	ctx_lo = kernel_context(i915);
+	if (!ctx_lo)
+		goto err_ctx_hi;
+	ctx_lo->sched.priority = I915_CONTEXT_MIN_USER_PRIORITY;
+
+	for_each_engine(engine, i915, id) {
+		int n;
+
+		for (n = 0; n < PERF_SAMPLES; n++) {
+			struct i915_request *rq;
+			ktime_t dt;
+
+			rq = spinner_create_request(&spin_lo, ctx_lo, engine,
+						    MI_ARB_CHECK);
+			if (IS_ERR(rq)) {
+				err = PTR_ERR(rq);
+				goto err_ctx_lo;
+			}
+
+			i915_request_add(rq);
+			if (!wait_for_spinner(&spin_lo, rq)) {
+				GEM_TRACE("lo spinner failed to start\n");
+				GEM_TRACE_DUMP();
+				i915_gem_set_wedged(i915);
+				err = -EIO;
+				goto err_ctx_lo;
+			}
+
+			rq = i915_request_alloc(engine, ctx_hi);
+			if (IS_ERR(rq)) {
+				spinner_end(&spin_lo);
+				err = PTR_ERR(rq);
+				goto err_ctx_lo;
+			}
+
+			dt = ktime_get_raw();
+			i915_request_add(rq);
+			if (i915_request_wait(rq, I915_WAIT_LOCKED, HZ / 5) < 0) {
+				GEM_TRACE("hi request failed to preempt\n");
+				GEM_TRACE_DUMP();
+				spinner_end(&spin_lo);
+				i915_gem_set_wedged(i915);
+				err = -EIO;
+				goto err_ctx_lo;
+			}
+			samples[n] = ktime_to_ns(ktime_sub(ktime_get_raw(), dt));
+
+			spinner_end(&spin_lo);
+			if (igt_flush_test(i915, I915_WAIT_LOCKED)) {
+				err = -EIO;
+				goto err_ctx_lo;
+			}
+		}
+
+		igt_perf_latency("preempt-latency", engine->name,
+				 samples, PERF_SAMPLES);
+	}
+
+	err = 0;
+err_ctx_lo:
+	kernel_context_close(ctx_lo);
+err_ctx_hi:
+	kernel_context_close(ctx_hi);
+err_spin_lo:
+	spinner_fini(&spin_lo);
+err_unlock:
+	igt_flush_test(i915, I915_WAIT_LOCKED);
+	mutex_unlock(&i915->drm.struct_mutex);
+	return err;
+}
+
 int intel_execlists_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
@@ -572,6 +675,7 @@ int intel_execlists_live_selftests(struct drm_i915_private *i915)
 		SUBTEST(live_preempt),
 		SUBTEST(live_late_preempt),
 		SUBTEST(live_preempt_hang),
+		SUBTEST(live_perf_preempt_latency),
 	};
 
 	if (!HAS_EXECLISTS(i915))
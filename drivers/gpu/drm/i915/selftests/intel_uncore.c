@@ -24,6 +24,8 @@
 
 #include "../i915_selftest.h"
 
+#include "igt_perf.h"
+
 static int intel_fw_table_check(const struct intel_forcewake_range *ranges,
 				unsigned int num_ranges,
 				bool is_watertight)
@@ -177,6 +179,82 @@ static int intel_uncore_check_forcewake_domains(struct drm_i915_private *dev_pri
 	return err;
 }
 
+struct fw_batch_regs {
+	struct drm_i915_private *i915;
+	const i915_reg_t *regs;
+	unsigned int count;
+};
+
+static long fw_read_auto(void *data)
+{
+	const struct fw_batch_regs *arg = data;
+	struct drm_i915_private *dev_priv = arg->i915;
+	unsigned int i;
+
+	for (i = 0; i < arg->count; i++)
+		(void)I915_READ(arg->regs[i]);
+
+	return arg->count;
+}
+
+static long fw_read_batch(void *data)
+{
+	const struct fw_batch_regs *arg = data;
+	struct drm_i915_private *dev_priv = arg->i915;
+	struct intel_uncore_fw_batch batch;
+	unsigned int i;
+	long err = 0;
+
+	intel_uncore_fw_batch_begin(dev_priv, &batch,
+				    arg->regs, arg->count, FW_REG_READ);
+	if ((dev_priv->uncore.fw_domains_active & batch.domains) !=
+	    batch.domains) {
+		pr_err("Batch did not wake forcewake domains %x (active %x)\n",
+		       batch.domains, dev_priv->uncore.fw_domains_active);
+		err = -EINVAL;
+	}
+	for (i = 0; i < arg->count; i++)
+		(void)I915_READ_FW(arg->regs[i]);
+	intel_uncore_fw_batch_end(dev_priv, &batch);
+
+	return err ?: arg->count;
+}
+
+static int intel_uncore_check_fw_batch(struct drm_i915_private *i915)
+{
+#define REGS_PER_ENGINE 3
+	const unsigned long duration = msecs_to_jiffies(100);
+	i915_reg_t regs[I915_NUM_ENGINES * REGS_PER_ENGINE];
+	struct fw_batch_regs arg = { .i915 = i915, .regs = regs };
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	u64 elapsed;
+	long count;
+
+	for_each_engine(engine, i915, id) {
+		regs[arg.count++] = RING_START(engine->mmio_base);
+		regs[arg.count++] = RING_CTL(engine->mmio_base);
+		regs[arg.count++] = RING_MI_MODE(engine->mmio_base);
+	}
+
+	intel_runtime_pm_get(i915);
+
+	count = igt_perf_repeat(duration, fw_read_auto, &arg, &elapsed);
+	if (count < 0)
+		goto out;
+	igt_perf_rate("uncore-read-auto", "all", count, elapsed);
+
+	count = igt_perf_repeat(duration, fw_read_batch, &arg, &elapsed);
+	if (count < 0)
+		goto out;
+	igt_perf_rate("uncore-read-batch", "all", count, elapsed);
+
+out:
+	intel_runtime_pm_put(i915);
+	return count < 0 ? count : 0;
+#undef REGS_PER_ENGINE
+}
+
 int intel_uncore_live_selftests(struct drm_i915_private *i915)
 {
 	int err;
@@ -192,5 +270,9 @@ int intel_uncore_live_selftests(struct drm_i915_private *i915)
 	if (err)
 		return err;
 
+	err = intel_uncore_check_fw_batch(i915);
+	if (err)
+		return err;
+
 	return 0;
 }
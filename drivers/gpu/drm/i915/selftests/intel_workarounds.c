@@ -281,10 +281,183 @@ static int live_reset_whitelist(void *arg)
 	return err;
 }
 
+static struct drm_i915_gem_object *
+read_ctx_workarounds(struct i915_gem_context *ctx,
+		     struct intel_engine_cs *engine)
+{
+	const struct i915_workarounds *w = &ctx->i915->workarounds;
+	struct drm_i915_gem_object *result;
+	struct i915_request *rq;
+	struct i915_vma *vma;
+	u32 srm, *cs;
+	int err;
+	int i;
+
+	result = i915_gem_object_create_internal(engine->i915, PAGE_SIZE);
+	if (IS_ERR(result))
+		return result;
+
+	i915_gem_object_set_cache_level(result, I915_CACHE_LLC);
+
+	vma = i915_vma_instance(result, &engine->i915->ggtt.vm, NULL);
+	if (IS_ERR(vma)) {
+		err = PTR_ERR(vma);
+		goto err_obj;
+	}
+
+	err = i915_vma_pin(vma, 0, 0, PIN_GLOBAL);
+	if (err)
+		goto err_obj;
+
+	rq = i915_request_alloc(engine, ctx);
+	if (IS_ERR(rq)) {
+		err = PTR_ERR(rq);
+		goto err_pin;
+	}
+
+	err = i915_vma_move_to_active(vma, rq, EXEC_OBJECT_WRITE);
+	if (err)
+		goto err_req;
+
+	srm = MI_STORE_REGISTER_MEM | MI_SRM_LRM_GLOBAL_GTT;
+	if (INTEL_GEN(ctx->i915) >= 8)
+		srm++;
+
+	cs = intel_ring_begin(rq, 4 * w->count);
+	if (IS_ERR(cs)) {
+		err = PTR_ERR(cs);
+		goto err_req;
+	}
+
+	for (i = 0; i < w->count; i++) {
+		*cs++ = srm;
+		*cs++ = w->reg[i].addr;
+		*cs++ = i915_ggtt_offset(vma) + sizeof(u32) * i;
+		*cs++ = 0;
+	}
+	intel_ring_advance(rq, cs);
+
+	i915_gem_object_get(result);
+	i915_gem_object_set_active_reference(result);
+
+	i915_request_add(rq);
+	i915_vma_unpin(vma);
+
+	return result;
+
+err_req:
+	i915_request_add(rq);
+err_pin:
+	i915_vma_unpin(vma);
+err_obj:
+	i915_gem_object_put(result);
+	return ERR_PTR(err);
+}
+
+static int check_ctx_workarounds(struct i915_gem_context *ctx,
+				 struct intel_engine_cs *engine)
+{
+	const struct i915_workarounds *w = &ctx->i915->workarounds;
+	struct drm_i915_gem_object *results;
+	struct igt_wedge_me wedge;
+	u32 *vaddr;
+	int err;
+	int i;
+
+	results = read_ctx_workarounds(ctx, engine);
+	if (IS_ERR(results))
+		return PTR_ERR(results);
+
+	err = 0;
+	igt_wedge_on_timeout(&wedge, ctx->i915, HZ / 5) /* a safety net! */
+		err = i915_gem_object_set_to_cpu_domain(results, false);
+	if (i915_terminally_wedged(&ctx->i915->gpu_error))
+		err = -EIO;
+	if (err)
+		goto out_put;
+
+	vaddr = i915_gem_object_pin_map(results, I915_MAP_WB);
+	if (IS_ERR(vaddr)) {
+		err = PTR_ERR(vaddr);
+		goto out_put;
+	}
+
+	for (i = 0; i < w->count; i++) {
+		const struct i915_wa_reg *wa = &w->reg[i];
+
+		if ((vaddr[i] ^ wa->value) & wa->mask) {
+			pr_err("Context workaround lost on reg %04x: expected %08x, found %08x (mask %08x)\n",
+			       wa->addr, wa->value & wa->mask,
+			       vaddr[i] & wa->mask, wa->mask);
+			err = -EINVAL;
+		}
+	}
+
+	i915_gem_object_unpin_map(results);
+out_put:
+	i915_gem_object_put(results);
+	return err;
+}
+
+static int live_ctx_workarounds(void *arg)
+{
+	struct drm_i915_private *i915 = arg;
+	struct intel_engine_cs *engine = i915->engine[RCS];
+	struct i915_gpu_error *error = &i915->gpu_error;
+	struct i915_gem_context *ctx;
+	int err;
+
+	/*
+	 * The context workarounds are emitted only once, when recording
+	 * the default context image from which every new context is
+	 * created. Check that a fresh context starts with each of them
+	 * applied, and that they are not lost by a reset either.
+	 */
+
+	if (!engine || !i915->workarounds.count)
+		return 0;
+
+	pr_info("Checking %d context workarounds\n", i915->workarounds.count);
+
+	ctx = kernel_context(i915);
+	if (IS_ERR(ctx))
+		return PTR_ERR(ctx);
+
+	err = check_ctx_workarounds(ctx, engine);
+	kernel_context_close(ctx);
+	if (err) {
+		pr_err("Context workarounds missing from a fresh context!\n");
+		return err;
+	}
+
+	if (!intel_has_gpu_reset(i915))
+		return 0;
+
+	set_bit(I915_RESET_BACKOFF, &error->flags);
+	err = switch_to_scratch_context(engine);
+	if (!err)
+		err = do_device_reset(engine);
+	clear_bit(I915_RESET_BACKOFF, &error->flags);
+	if (err)
+		return err;
+
+	ctx = kernel_context(i915);
+	if (IS_ERR(ctx))
+		return PTR_ERR(ctx);
+
+	err = check_ctx_workarounds(ctx, engine);
+	kernel_context_close(ctx);
+	if (err)
+		pr_err("Context workarounds missing from a fresh context after reset!\n");
+
+	return err;
+}
+
 int intel_workarounds_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
 		SUBTEST(live_reset_whitelist),
+		SUBTEST(live_ctx_workarounds),
 	};
 	int err;
 
@@ -43,11 +43,14 @@ mock_context(struct drm_i915_private *i915,
 
 	INIT_RADIX_TREE(&ctx->handles_vma, GFP_KERNEL);
 	INIT_LIST_HEAD(&ctx->handles_list);
+	idr_init(&ctx->resident_sets);
 
 	for (n = 0; n < ARRAY_SIZE(ctx->__engine); n++) {
 		struct intel_context *ce = &ctx->__engine[n];
 
 		ce->gem_context = ctx;
+		INIT_LIST_HEAD(&ce->pin_link);
+		seqlock_init(&ce->stats.lock);
 	}
 
 	ret = ida_simple_get(&i915->contexts.hw_ida,
@@ -55,6 +58,7 @@ mock_context(struct drm_i915_private *i915,
 	if (ret < 0)
 		goto err_handles;
 	ctx->hw_id = ret;
+	list_add_tail(&ctx->hw_id_link, &i915->contexts.hw_id_list);
 
 	if (name) {
 		ctx->name = kstrdup(name, GFP_KERNEL);
@@ -86,6 +90,8 @@ void mock_context_close(struct i915_gem_context *ctx)
 void mock_init_contexts(struct drm_i915_private *i915)
 {
 	INIT_LIST_HEAD(&i915->contexts.list);
+	INIT_LIST_HEAD(&i915->contexts.hw_id_list);
+	INIT_LIST_HEAD(&i915->contexts.pin_lru);
 	ida_init(&i915->contexts.hw_ida);
 
 	INIT_WORK(&i915->contexts.free_work, contexts_free_worker);
@@ -76,14 +76,18 @@ static void mock_device_release(struct drm_device *dev)
 	mutex_unlock(&i915->drm.struct_mutex);
 	WARN_ON(!list_empty(&i915->gt.timelines));
 
+	destroy_workqueue(i915->clflush_wq);
 	destroy_workqueue(i915->wq);
 
+	i915_request_caches_drain(i915);
+
 	kmem_cache_destroy(i915->priorities);
 	kmem_cache_destroy(i915->dependencies);
 	kmem_cache_destroy(i915->requests);
 	kmem_cache_destroy(i915->vmas);
 	kmem_cache_destroy(i915->objects);
 
+	i915_gem_fini__mm(i915);
 	i915_gemfs_fini(i915);
 
 	drm_mode_config_cleanup(&i915->drm);
@@ -182,14 +186,19 @@ struct drm_i915_private *mock_gem_device(void)
 		I915_GTT_PAGE_SIZE_2M;
 
 	mock_uncore_init(i915);
-	i915_gem_init__mm(i915);
+	if (i915_gem_init__mm(i915))
+		goto err_drv;
 
 	init_waitqueue_head(&i915->gpu_error.wait_queue);
 	init_waitqueue_head(&i915->gpu_error.reset_queue);
 
 	i915->wq = alloc_ordered_workqueue("mock", 0);
 	if (!i915->wq)
-		goto err_drv;
+		goto err_mm;
+
+	i915->clflush_wq = alloc_workqueue("mock-clflush", WQ_UNBOUND, 0);
+	if (!i915->clflush_wq)
+		goto err_wq;
 
 	mock_init_contexts(i915);
 
@@ -200,7 +209,7 @@ struct drm_i915_private *mock_gem_device(void)
 
 	i915->objects = KMEM_CACHE(mock_object, SLAB_HWCACHE_ALIGN);
 	if (!i915->objects)
-		goto err_wq;
+		goto err_clflush_wq;
 
 	i915->vmas = KMEM_CACHE(i915_vma, SLAB_HWCACHE_ALIGN);
 	if (!i915->vmas)
@@ -223,7 +232,10 @@ struct drm_i915_private *mock_gem_device(void)
 	if (!i915->priorities)
 		goto err_dependencies;
 
+	i915_request_caches_init(i915);
+
 	INIT_LIST_HEAD(&i915->gt.timelines);
+	INIT_LIST_HEAD(&i915->gt.hwsp_free_list);
 	INIT_LIST_HEAD(&i915->gt.active_rings);
 	INIT_LIST_HEAD(&i915->gt.closed_vma);
 
@@ -259,8 +271,12 @@ struct drm_i915_private *mock_gem_device(void)
 	kmem_cache_destroy(i915->vmas);
 err_objects:
 	kmem_cache_destroy(i915->objects);
+err_clflush_wq:
+	destroy_workqueue(i915->clflush_wq);
 err_wq:
 	destroy_workqueue(i915->wq);
+err_mm:
+	i915_gem_fini__mm(i915);
 err_drv:
 	drm_mode_config_cleanup(&i915->drm);
 	drm_dev_fini(&i915->drm);
@@ -18,6 +18,10 @@ void mock_timeline_init(struct i915_timeline *timeline, u64 context)
 	INIT_LIST_HEAD(&timeline->requests);
 
 	i915_syncmap_init(&timeline->sync);
+	timeline->sync_cache_valid = 0;
+
+	timeline->hwsp = NULL;
+	timeline->hwsp_seqno = NULL;
 
 	INIT_LIST_HEAD(&timeline->link);
 }
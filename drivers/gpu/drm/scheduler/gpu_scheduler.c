@@ -55,6 +55,9 @@
 #define CREATE_TRACE_POINTS
 #include "gpu_scheduler_trace.h"
 
+/* Maximum number of jobs submitted per scheduler thread wakeup */
+#define DRM_SCHED_BATCH 8
+
 #define to_drm_sched_job(sched_job)		\
 		container_of((sched_job), struct drm_sched_job, queue_node)
 
@@ -471,10 +474,22 @@ static bool drm_sched_entity_add_dependency_cb(struct drm_sched_entity *entity)
 
 	s_fence = to_drm_sched_fence(fence);
 	if (s_fence && s_fence->sched == sched) {
+		/*
+		 * The job has already been pushed to our ring ahead of us,
+		 * ring order is all we need, so don't bother with the fence
+		 * lock or a callback.
+		 */
+		if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT,
+			     &s_fence->scheduled.flags)) {
+			dma_fence_put(entity->dependency);
+			return false;
+		}
 
 		/*
 		 * Fence is from the same scheduler, only need to wait for
-		 * it to be scheduled
+		 * it to be scheduled. That happens on our own thread, and
+		 * drm_sched_main() reselects entities within the same batch,
+		 * so the dependent job follows without another wakeup.
 		 */
 		fence = dma_fence_get(&s_fence->scheduled);
 		dma_fence_put(entity->dependency);
@@ -852,62 +867,92 @@ static bool drm_sched_blocked(struct drm_gpu_scheduler *sched)
 	return false;
 }
 
+/**
+ * drm_sched_run_job - hand one job of @entity to the hardware
+ *
+ * @sched: scheduler instance
+ * @entity: entity selected by drm_sched_select_entity()
+ *
+ * Returns true if a job was submitted, false if the entity had nothing ready.
+ */
+static bool drm_sched_run_job(struct drm_gpu_scheduler *sched,
+			      struct drm_sched_entity *entity)
+{
+	struct drm_sched_fence *s_fence;
+	struct drm_sched_job *sched_job;
+	struct dma_fence *fence;
+	int r;
+
+	sched_job = drm_sched_entity_pop_job(entity);
+	if (!sched_job)
+		return false;
+
+	s_fence = sched_job->s_fence;
+
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	fence = sched->ops->run_job(sched_job);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (fence) {
+		s_fence->parent = dma_fence_get(fence);
+		r = dma_fence_add_callback(fence, &s_fence->cb,
+					   drm_sched_process_job);
+		if (r == -ENOENT)
+			drm_sched_process_job(fence, &s_fence->cb);
+		else if (r)
+			DRM_ERROR("fence add callback failed (%d)\n",
+				  r);
+		dma_fence_put(fence);
+	} else {
+		drm_sched_process_job(NULL, &s_fence->cb);
+	}
+
+	return true;
+}
+
 /**
  * drm_sched_main - main scheduler thread
  *
  * @param: scheduler instance
  *
+ * Each wakeup submits up to DRM_SCHED_BATCH ready jobs before going back
+ * to sleep, so a busy scheduler does not pay a waitqueue round trip (and
+ * a job_scheduled wakeup) for every single job.
+ *
  * Returns 0.
  */
 static int drm_sched_main(void *param)
 {
 	struct sched_param sparam = {.sched_priority = 1};
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_setscheduler(current, SCHED_FIFO, &sparam);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
-		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
+		unsigned int count = 0;
+		bool submitted = false;
 
 		wait_event_interruptible(sched->wake_up_worker,
 					 (!drm_sched_blocked(sched) &&
 					  (entity = drm_sched_select_entity(sched))) ||
 					 kthread_should_stop());
 
-		if (!entity)
-			continue;
+		while (entity) {
+			submitted |= drm_sched_run_job(sched, entity);
 
-		sched_job = drm_sched_entity_pop_job(entity);
-		if (!sched_job)
-			continue;
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
-
-		fence = sched->ops->run_job(sched_job);
-		drm_sched_fence_scheduled(s_fence);
+			if (++count >= DRM_SCHED_BATCH ||
+			    kthread_should_stop() ||
+			    drm_sched_blocked(sched))
+				break;
 
-		if (fence) {
-			s_fence->parent = dma_fence_get(fence);
-			r = dma_fence_add_callback(fence, &s_fence->cb,
-						   drm_sched_process_job);
-			if (r == -ENOENT)
-				drm_sched_process_job(fence, &s_fence->cb);
-			else if (r)
-				DRM_ERROR("fence add callback failed (%d)\n",
-					  r);
-			dma_fence_put(fence);
-		} else {
-			drm_sched_process_job(NULL, &s_fence->cb);
+			entity = drm_sched_select_entity(sched);
 		}
 
-		wake_up(&sched->job_scheduled);
+		if (submitted)
+			wake_up(&sched->job_scheduled);
 	}
 	return 0;
 }
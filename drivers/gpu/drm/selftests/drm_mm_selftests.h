@@ -18,10 +18,12 @@ selftest(align32, igt_align32)
 selftest(align64, igt_align64)
 selftest(evict, igt_evict)
 selftest(evict_range, igt_evict_range)
+selftest(evict_cost, igt_evict_cost)
 selftest(bottomup, igt_bottomup)
 selftest(lowest, igt_lowest)
 selftest(topdown, igt_topdown)
 selftest(highest, igt_highest)
+selftest(frag, igt_frag)
 selftest(color, igt_color)
 selftest(color_evict, igt_color_evict)
 selftest(color_evict_range, igt_color_evict_range)
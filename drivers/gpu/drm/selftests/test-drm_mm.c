@@ -4,6 +4,7 @@
 
 #define pr_fmt(fmt) "drm_mm: " fmt
 
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/prime_numbers.h>
 #include <linux/slab.h>
@@ -1609,6 +1610,86 @@ static unsigned int node_index(const struct drm_mm_node *node)
 	return div64_u64(node->start, node->size);
 }
 
+static u64 color_as_cost(const struct drm_mm_node *node)
+{
+	return node->color;
+}
+
+static int igt_evict_cost(void *ignored)
+{
+	static const unsigned int scan_order[] = { 0, 1, 4, 5 };
+	const unsigned int count = 8;
+	struct drm_mm_node *nodes, *node, *next;
+	struct drm_mm_scan scan;
+	struct drm_mm mm;
+	unsigned int n;
+	int ret, err;
+
+	/*
+	 * Nodes 0 and 1 are expensive to evict, 4 and 5 are cheap. Scanning
+	 * them in that order the first hole found is [0, 2), but with a cost
+	 * function and enough budget the scan must settle on [4, 6).
+	 */
+
+	ret = -ENOMEM;
+	nodes = kcalloc(count, sizeof(*nodes), GFP_KERNEL);
+	if (!nodes)
+		goto err;
+
+	ret = -EINVAL;
+	drm_mm_init(&mm, 0, count);
+	for (n = 0; n < count; n++) {
+		nodes[n].start = n;
+		nodes[n].size = 1;
+		nodes[n].color = n < 2 ? 10 : 1;
+		err = drm_mm_reserve_node(&mm, &nodes[n]);
+		if (err) {
+			pr_err("reserve failed, step %d, start %d\n", n, n);
+			ret = err;
+			goto out;
+		}
+	}
+
+	drm_mm_scan_init(&scan, &mm, 2, 0, 0, DRM_MM_INSERT_LOW);
+	drm_mm_scan_set_cost(&scan, color_as_cost, count);
+	for (n = 0; n < ARRAY_SIZE(scan_order); n++) {
+		if (drm_mm_scan_add_block(&scan, &nodes[scan_order[n]])) {
+			pr_err("cost scan stopped early at block %d\n",
+			       scan_order[n]);
+			n++;
+			goto out_unwind;
+		}
+	}
+	if (!drm_mm_scan_found(&scan)) {
+		pr_err("cost scan found no hole\n");
+		goto out_unwind;
+	}
+
+	ret = 0;
+	while (n--) {
+		bool evict = drm_mm_scan_remove_block(&scan,
+						      &nodes[scan_order[n]]);
+
+		if (evict != (scan_order[n] >= 4)) {
+			pr_err("cost scan %s block %d\n",
+			       evict ? "evicted" : "kept", scan_order[n]);
+			ret = -EINVAL;
+		}
+	}
+	goto out;
+
+out_unwind:
+	while (n--)
+		drm_mm_scan_remove_block(&scan, &nodes[scan_order[n]]);
+out:
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+	kfree(nodes);
+err:
+	return ret;
+}
+
 static int igt_topdown(void *ignored)
 {
 	const struct insert_mode *topdown = &insert_modes[TOPDOWN];
@@ -1896,6 +1977,102 @@ static int igt_highest(void *ignored)
 	return __igt_once(DRM_MM_INSERT_HIGH);
 }
 
+static int prepare_frag(struct drm_mm *mm, struct drm_mm_node *nodes,
+			unsigned int count, const struct insert_mode *mode)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (!expect_insert(mm, &nodes[i], 4096, 0, 0, mode))
+			return -EINVAL;
+	}
+
+	/* Leave many small holes for the search to step over */
+	for (i = 0; i < count; i += 2)
+		drm_mm_remove_node(&nodes[i]);
+
+	return 0;
+}
+
+static s64 get_insert_time(struct drm_mm *mm, struct drm_mm_node *nodes,
+			   unsigned int count, u64 size, u64 alignment,
+			   const struct insert_mode *mode)
+{
+	ktime_t start;
+	unsigned int i;
+
+	start = ktime_get();
+	for (i = 0; i < count; i++) {
+		if (!expect_insert(mm, &nodes[i], size, alignment, 0, mode))
+			return -EINVAL;
+	}
+
+	return ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+static int igt_frag(void *ignored)
+{
+	const unsigned int count = min(8192u, max_iterations);
+	const struct insert_mode *mode;
+	struct drm_mm_node *nodes, *node, *next;
+	struct drm_mm mm;
+	int ret = -ENOMEM;
+
+	/*
+	 * Benchmark inserting into a fragmented address space, where none
+	 * of the holes left behind are large enough. The bottom-up and
+	 * top-down searches should skip those holes rather than visit each
+	 * one, so a second batch of insertions of the same size should take
+	 * about as long as the first, even though more nodes now precede it.
+	 */
+
+	nodes = vzalloc(array_size(count * 4, sizeof(*nodes)));
+	if (!nodes)
+		goto err;
+
+	ret = -EINVAL;
+	drm_mm_init(&mm, 1, U64_MAX - 2);
+	for (mode = insert_modes; mode->name; mode++) {
+		s64 t1, t2, t3;
+
+		if (mode->mode == DRM_MM_INSERT_EVICT)
+			continue;
+
+		ret = prepare_frag(&mm, nodes, count, mode);
+		if (ret)
+			goto out;
+
+		t1 = get_insert_time(&mm, nodes + count, count,
+				     8192, 0, mode);
+		t2 = get_insert_time(&mm, nodes + 2 * count, count,
+				     8192, 0, mode);
+		t3 = get_insert_time(&mm, nodes + 3 * count, count,
+				     8192, 65536, mode);
+		if (t1 < 0 || t2 < 0 || t3 < 0) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		pr_info("%s fragmented insert of %u+%u nodes took %lld+%lld ns, %u aligned nodes took %lld ns\n",
+			mode->name, count, count, t1, t2, count, t3);
+
+		drm_mm_for_each_node_safe(node, next, &mm)
+			drm_mm_remove_node(node);
+		DRM_MM_BUG_ON(!drm_mm_clean(&mm));
+
+		cond_resched();
+	}
+
+	ret = 0;
+out:
+	drm_mm_for_each_node_safe(node, next, &mm)
+		drm_mm_remove_node(node);
+	drm_mm_takedown(&mm);
+	vfree(nodes);
+err:
+	return ret;
+}
+
 static void separate_adjacent_colors(const struct drm_mm_node *node,
 				     unsigned long color,
 				     u64 *start,
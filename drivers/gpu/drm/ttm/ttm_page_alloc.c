@@ -71,6 +71,7 @@
  * @list: Pool of free uc/wc pages for fast reuse.
  * @gfp_flags: Flags to pass for alloc_page.
  * @npages: Number of pages in pool.
+ * @nid: NUMA node new pages for the pool are allocated from.
  */
 struct ttm_page_pool {
 	spinlock_t		lock;
@@ -82,6 +83,7 @@ struct ttm_page_pool {
 	unsigned long		nfrees;
 	unsigned long		nrefills;
 	unsigned int		order;
+	int			nid;
 };
 
 /**
@@ -98,6 +100,29 @@ struct ttm_pool_opts {
 
 #define NUM_POOLS 6
 
+/**
+ * struct ttm_pool_node - The set of pools backing one NUMA node
+ *
+ * Pages are returned to the pools of the node they live on and handed
+ * out to allocations running on that node, so a multi-socket machine
+ * neither contends on one set of pool locks nor maps remote pages into
+ * local BOs. There is no per-node DMA32 zone to speak of, so the DMA32
+ * pools of node 0 are shared by everybody.
+ */
+struct ttm_pool_node {
+	union {
+		struct ttm_page_pool	pools[NUM_POOLS];
+		struct {
+			struct ttm_page_pool	wc_pool;
+			struct ttm_page_pool	uc_pool;
+			struct ttm_page_pool	wc_pool_dma32;
+			struct ttm_page_pool	uc_pool_dma32;
+			struct ttm_page_pool	wc_pool_huge;
+			struct ttm_page_pool	uc_pool_huge;
+		} ;
+	};
+};
+
 /**
  * struct ttm_pool_manager - Holds memory pools for fst allocation
  *
@@ -109,24 +134,14 @@ struct ttm_pool_opts {
  * some pages to free.
  * @small_allocation: Limit in number of pages what is small allocation.
  *
- * @pools: All pool objects in use.
+ * @nodes: Pool objects in use, one set per NUMA node (nr_node_ids entries).
  **/
 struct ttm_pool_manager {
 	struct kobject		kobj;
 	struct shrinker		mm_shrink;
 	struct ttm_pool_opts	options;
 
-	union {
-		struct ttm_page_pool	pools[NUM_POOLS];
-		struct {
-			struct ttm_page_pool	wc_pool;
-			struct ttm_page_pool	uc_pool;
-			struct ttm_page_pool	wc_pool_dma32;
-			struct ttm_page_pool	uc_pool_dma32;
-			struct ttm_page_pool	wc_pool_huge;
-			struct ttm_page_pool	uc_pool_huge;
-		} ;
-	};
+	struct ttm_pool_node	*nodes;
 };
 
 static struct attribute ttm_page_pool_max = {
@@ -153,6 +168,7 @@ static void ttm_pool_kobj_release(struct kobject *kobj)
 {
 	struct ttm_pool_manager *m =
 		container_of(kobj, struct ttm_pool_manager, kobj);
+	kfree(m->nodes);
 	kfree(m);
 }
 
@@ -269,9 +285,10 @@ static int set_pages_array_uc(struct page **pages, int addrinarray)
 #endif
 
 /**
- * Select the right pool or requested caching state and ttm flags. */
+ * Select the right pool or requested caching state, ttm flags and node. */
 static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
-					  enum ttm_caching_state cstate)
+					  enum ttm_caching_state cstate,
+					  int nid)
 {
 	int pool_index;
 
@@ -287,12 +304,13 @@ static struct ttm_page_pool *ttm_get_pool(int flags, bool huge,
 		if (huge)
 			return NULL;
 		pool_index |= 0x2;
+		nid = 0;
 
 	} else if (huge) {
 		pool_index |= 0x4;
 	}
 
-	return &_manager->pools[pool_index];
+	return &_manager->nodes[nid].pools[pool_index];
 }
 
 /* set memory back to wb and free the pages. */
@@ -430,6 +448,7 @@ ttm_pool_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 {
 	static DEFINE_MUTEX(lock);
 	static unsigned start_pool;
+	struct ttm_pool_node *node = &_manager->nodes[sc->nid];
 	unsigned i;
 	unsigned pool_offset;
 	struct ttm_page_pool *pool;
@@ -448,7 +467,7 @@ ttm_pool_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 		if (shrink_pages == 0)
 			break;
 
-		pool = &_manager->pools[(i + pool_offset)%NUM_POOLS];
+		pool = &node->pools[(i + pool_offset)%NUM_POOLS];
 		page_nr = (1 << pool->order);
 		/* OK to use static buffer since global mutex is held. */
 		nr_free_pool = roundup(nr_free, page_nr) >> pool->order;
@@ -466,12 +485,13 @@ ttm_pool_shrink_scan(struct shrinker *shrink, struct shrink_control *sc)
 static unsigned long
 ttm_pool_shrink_count(struct shrinker *shrink, struct shrink_control *sc)
 {
+	struct ttm_pool_node *node = &_manager->nodes[sc->nid];
 	unsigned i;
 	unsigned long count = 0;
 	struct ttm_page_pool *pool;
 
 	for (i = 0; i < NUM_POOLS; ++i) {
-		pool = &_manager->pools[i];
+		pool = &node->pools[i];
 		count += (pool->npages << pool->order);
 	}
 
@@ -483,6 +503,8 @@ static int ttm_pool_mm_shrink_init(struct ttm_pool_manager *manager)
 	manager->mm_shrink.count_objects = ttm_pool_shrink_count;
 	manager->mm_shrink.scan_objects = ttm_pool_shrink_scan;
 	manager->mm_shrink.seeks = 1;
+	/* Let reclaim drain the pools of the node that is short on memory */
+	manager->mm_shrink.flags = SHRINKER_NUMA_AWARE;
 	return register_shrinker(&manager->mm_shrink);
 }
 
@@ -538,7 +560,7 @@ static void ttm_handle_caching_state_failure(struct list_head *pages,
  */
 static int ttm_alloc_new_pages(struct list_head *pages, gfp_t gfp_flags,
 			       int ttm_flags, enum ttm_caching_state cstate,
-			       unsigned count, unsigned order)
+			       unsigned count, unsigned order, int nid)
 {
 	struct page **caching_array;
 	struct page *p;
@@ -557,7 +579,7 @@ static int ttm_alloc_new_pages(struct list_head *pages, gfp_t gfp_flags,
 	}
 
 	for (i = 0, cpages = 0; i < count; ++i) {
-		p = alloc_pages(gfp_flags, order);
+		p = alloc_pages_node(nid, gfp_flags, order);
 
 		if (!p) {
 			pr_debug("Unable to get page %u\n", i);
@@ -652,7 +674,7 @@ static void ttm_page_pool_fill_locked(struct ttm_page_pool *pool, int ttm_flags,
 
 		INIT_LIST_HEAD(&new_pages);
 		r = ttm_alloc_new_pages(&new_pages, pool->gfp_flags, ttm_flags,
-					cstate, alloc_size, 0);
+					cstate, alloc_size, 0, pool->nid);
 		spin_lock_irqsave(&pool->lock, *irq_flags);
 
 		if (!r) {
@@ -750,7 +772,7 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 		 * multiple requests in parallel.
 		 **/
 		r = ttm_alloc_new_pages(pages, gfp_flags, ttm_flags, cstate,
-					count, order);
+					count, order, pool->nid);
 	}
 
 	return r;
@@ -760,14 +782,11 @@ static int ttm_page_pool_get_pages(struct ttm_page_pool *pool,
 static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			  enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
-#endif
+	struct ttm_page_pool *pool;
 	unsigned long irq_flags;
-	unsigned i;
+	unsigned i, n2free;
 
-	if (pool == NULL) {
+	if (cstate == tt_cached) {
 		/* No pool for this memory type so free the pages */
 		i = 0;
 		while (i < npages) {
@@ -807,10 +826,9 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 
 	i = 0;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	if (huge) {
-		unsigned max_size, n2free;
+	if (!(flags & TTM_PAGE_FLAG_DMA32)) {
+		unsigned max_size = _manager->options.max_size / HPAGE_PMD_NR;
 
-		spin_lock_irqsave(&huge->lock, irq_flags);
 		while (i < npages) {
 			struct page *p = pages[i];
 			unsigned j;
@@ -825,49 +843,65 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 			if (j != HPAGE_PMD_NR)
 				break;
 
-			list_add_tail(&pages[i]->lru, &huge->list);
+			pool = ttm_get_pool(flags, true, cstate,
+					    page_to_nid(pages[i]));
+
+			spin_lock_irqsave(&pool->lock, irq_flags);
+			list_add_tail(&pages[i]->lru, &pool->list);
+			pool->npages++;
+
+			/* Check that we don't go over the pool limit */
+			if (pool->npages > max_size)
+				n2free = pool->npages - max_size;
+			else
+				n2free = 0;
+			spin_unlock_irqrestore(&pool->lock, irq_flags);
 
 			for (j = 0; j < HPAGE_PMD_NR; ++j)
 				pages[i++] = NULL;
-			huge->npages++;
-		}
 
-		/* Check that we don't go over the pool limit */
-		max_size = _manager->options.max_size;
-		max_size /= HPAGE_PMD_NR;
-		if (huge->npages > max_size)
-			n2free = huge->npages - max_size;
-		else
-			n2free = 0;
-		spin_unlock_irqrestore(&huge->lock, irq_flags);
-		if (n2free)
-			ttm_page_pool_free(huge, n2free, false);
+			if (n2free)
+				ttm_page_pool_free(pool, n2free, false);
+		}
 	}
 #endif
 
-	spin_lock_irqsave(&pool->lock, irq_flags);
 	while (i < npages) {
-		if (pages[i]) {
-			if (page_count(pages[i]) != 1)
-				pr_err("Erroneous page count. Leaking pages.\n");
-			list_add_tail(&pages[i]->lru, &pool->list);
-			pages[i] = NULL;
-			pool->npages++;
+		if (!pages[i]) {
+			++i;
+			continue;
 		}
-		++i;
-	}
-	/* Check that we don't go over the pool limit */
-	npages = 0;
-	if (pool->npages > _manager->options.max_size) {
-		npages = pool->npages - _manager->options.max_size;
-		/* free at least NUM_PAGES_TO_ALLOC number of pages
-		 * to reduce calls to set_memory_wb */
-		if (npages < NUM_PAGES_TO_ALLOC)
-			npages = NUM_PAGES_TO_ALLOC;
+
+		/* Hand back each run of pages from one node under one lock */
+		pool = ttm_get_pool(flags, false, cstate, page_to_nid(pages[i]));
+		spin_lock_irqsave(&pool->lock, irq_flags);
+		do {
+			if (pages[i]) {
+				if (page_count(pages[i]) != 1)
+					pr_err("Erroneous page count. Leaking pages.\n");
+				list_add_tail(&pages[i]->lru, &pool->list);
+				pages[i] = NULL;
+				pool->npages++;
+			}
+			++i;
+		} while (i < npages &&
+			 (!pages[i] ||
+			  ttm_get_pool(flags, false, cstate,
+				       page_to_nid(pages[i])) == pool));
+
+		/* Check that we don't go over the pool limit */
+		n2free = 0;
+		if (pool->npages > _manager->options.max_size) {
+			n2free = pool->npages - _manager->options.max_size;
+			/* free at least NUM_PAGES_TO_ALLOC number of pages
+			 * to reduce calls to set_memory_wb */
+			if (n2free < NUM_PAGES_TO_ALLOC)
+				n2free = NUM_PAGES_TO_ALLOC;
+		}
+		spin_unlock_irqrestore(&pool->lock, irq_flags);
+		if (n2free)
+			ttm_page_pool_free(pool, n2free, false);
 	}
-	spin_unlock_irqrestore(&pool->lock, irq_flags);
-	if (npages)
-		ttm_page_pool_free(pool, npages, false);
 }
 
 /*
@@ -877,9 +911,10 @@ static void ttm_put_pages(struct page **pages, unsigned npages, int flags,
 static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 			 enum ttm_caching_state cstate)
 {
-	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate);
+	int nid = numa_node_id();
+	struct ttm_page_pool *pool = ttm_get_pool(flags, false, cstate, nid);
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
-	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate);
+	struct ttm_page_pool *huge = ttm_get_pool(flags, true, cstate, nid);
 #endif
 	struct list_head plist;
 	struct page *p = NULL;
@@ -991,7 +1026,7 @@ static int ttm_get_pages(struct page **pages, unsigned npages, int flags,
 }
 
 static void ttm_page_pool_init_locked(struct ttm_page_pool *pool, gfp_t flags,
-		char *name, unsigned int order)
+		char *name, unsigned int order, int nid)
 {
 	spin_lock_init(&pool->lock);
 	pool->fill_lock = false;
@@ -1000,46 +1035,64 @@ static void ttm_page_pool_init_locked(struct ttm_page_pool *pool, gfp_t flags,
 	pool->gfp_flags = flags;
 	pool->name = name;
 	pool->order = order;
+	pool->nid = nid;
 }
 
-int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
+static void ttm_pool_node_init(struct ttm_pool_node *node, int nid)
 {
-	int ret;
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	unsigned order = HPAGE_PMD_ORDER;
 #else
 	unsigned order = 0;
 #endif
 
-	WARN_ON(_manager);
-
-	pr_info("Initializing pool allocator\n");
-
-	_manager = kzalloc(sizeof(*_manager), GFP_KERNEL);
-	if (!_manager)
-		return -ENOMEM;
-
-	ttm_page_pool_init_locked(&_manager->wc_pool, GFP_HIGHUSER, "wc", 0);
+	ttm_page_pool_init_locked(&node->wc_pool, GFP_HIGHUSER, "wc", 0, nid);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool, GFP_HIGHUSER, "uc", 0);
+	ttm_page_pool_init_locked(&node->uc_pool, GFP_HIGHUSER, "uc", 0, nid);
 
-	ttm_page_pool_init_locked(&_manager->wc_pool_dma32,
-				  GFP_USER | GFP_DMA32, "wc dma", 0);
+	ttm_page_pool_init_locked(&node->wc_pool_dma32,
+				  GFP_USER | GFP_DMA32, "wc dma", 0,
+				  NUMA_NO_NODE);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool_dma32,
-				  GFP_USER | GFP_DMA32, "uc dma", 0);
+	ttm_page_pool_init_locked(&node->uc_pool_dma32,
+				  GFP_USER | GFP_DMA32, "uc dma", 0,
+				  NUMA_NO_NODE);
 
-	ttm_page_pool_init_locked(&_manager->wc_pool_huge,
+	ttm_page_pool_init_locked(&node->wc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP),
-				  "wc huge", order);
+				  "wc huge", order, nid);
 
-	ttm_page_pool_init_locked(&_manager->uc_pool_huge,
+	ttm_page_pool_init_locked(&node->uc_pool_huge,
 				  (GFP_TRANSHUGE_LIGHT | __GFP_NORETRY |
 				   __GFP_KSWAPD_RECLAIM) &
 				  ~(__GFP_MOVABLE | __GFP_COMP)
-				  , "uc huge", order);
+				  , "uc huge", order, nid);
+}
+
+int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
+{
+	int ret, nid;
+
+	WARN_ON(_manager);
+
+	pr_info("Initializing pool allocator\n");
+
+	_manager = kzalloc(sizeof(*_manager), GFP_KERNEL);
+	if (!_manager)
+		return -ENOMEM;
+
+	_manager->nodes = kcalloc(nr_node_ids, sizeof(*_manager->nodes),
+				  GFP_KERNEL);
+	if (!_manager->nodes) {
+		kfree(_manager);
+		_manager = NULL;
+		return -ENOMEM;
+	}
+
+	for (nid = 0; nid < nr_node_ids; nid++)
+		ttm_pool_node_init(&_manager->nodes[nid], nid);
 
 	_manager->options.max_size = max_pages;
 	_manager->options.small = SMALL_ALLOCATION;
@@ -1063,14 +1116,16 @@ int ttm_page_alloc_init(struct ttm_mem_global *glob, unsigned max_pages)
 
 void ttm_page_alloc_fini(void)
 {
-	int i;
+	int i, nid;
 
 	pr_info("Finalizing pool allocator\n");
 	ttm_pool_mm_shrink_fini(_manager);
 
 	/* OK to use static buffer since global mutex is no longer used. */
-	for (i = 0; i < NUM_POOLS; ++i)
-		ttm_page_pool_free(&_manager->pools[i], FREE_ALL_PAGES, true);
+	for (nid = 0; nid < nr_node_ids; nid++)
+		for (i = 0; i < NUM_POOLS; ++i)
+			ttm_page_pool_free(&_manager->nodes[nid].pools[i],
+					   FREE_ALL_PAGES, true);
 
 	kobject_put(&_manager->kobj);
 	_manager = NULL;
@@ -1221,19 +1276,26 @@ int ttm_page_alloc_debugfs(struct seq_file *m, void *data)
 {
 	struct ttm_page_pool *p;
 	unsigned i;
-	char *h[] = {"pool", "refills", "pages freed", "size"};
+	int nid;
+	char *h[] = {"pool", "node", "refills", "pages freed", "size"};
 	if (!_manager) {
 		seq_printf(m, "No pool allocator running.\n");
 		return 0;
 	}
-	seq_printf(m, "%7s %12s %13s %8s\n",
-			h[0], h[1], h[2], h[3]);
-	for (i = 0; i < NUM_POOLS; ++i) {
-		p = &_manager->pools[i];
+	seq_printf(m, "%7s %4s %12s %13s %8s\n",
+			h[0], h[1], h[2], h[3], h[4]);
+	for (nid = 0; nid < nr_node_ids; nid++) {
+		for (i = 0; i < NUM_POOLS; ++i) {
+			p = &_manager->nodes[nid].pools[i];
+
+			/* DMA32 pools only exist on node 0 */
+			if (nid && p->nid == NUMA_NO_NODE)
+				continue;
 
-		seq_printf(m, "%7s %12ld %13ld %8d\n",
-				p->name, p->nrefills,
-				p->nfrees, p->npages);
+			seq_printf(m, "%7s %4d %12ld %13ld %8d\n",
+					p->name, nid, p->nrefills,
+					p->nfrees, p->npages);
+		}
 	}
 	return 0;
 }
@@ -337,7 +337,6 @@ v3d_cl_lookup_bos(struct drm_device *dev,
 {
 	u32 *handles;
 	int ret = 0;
-	int i;
 
 	exec->bo_count = args->bo_handle_count;
 
@@ -372,21 +371,10 @@ v3d_cl_lookup_bos(struct drm_device *dev,
 		goto fail;
 	}
 
-	spin_lock(&file_priv->table_lock);
-	for (i = 0; i < exec->bo_count; i++) {
-		struct drm_gem_object *bo = idr_find(&file_priv->object_idr,
-						     handles[i]);
-		if (!bo) {
-			DRM_DEBUG("Failed to look up GEM BO %d: %d\n",
-				  i, handles[i]);
-			ret = -ENOENT;
-			spin_unlock(&file_priv->table_lock);
-			goto fail;
-		}
-		drm_gem_object_get(bo);
-		exec->bo[i] = to_v3d_bo(bo);
-	}
-	spin_unlock(&file_priv->table_lock);
+	/* exec->bo doubles as the array of GEM objects, see to_v3d_bo() */
+	BUILD_BUG_ON(offsetof(struct v3d_bo, base));
+	ret = drm_gem_objects_lookup(file_priv, handles, exec->bo_count,
+				     (struct drm_gem_object **)exec->bo);
 
 fail:
 	kvfree(handles);
@@ -305,6 +305,7 @@ struct drm_atomic_state {
 	struct work_struct commit_work;
 };
 
+struct drm_crtc_commit *drm_crtc_commit_alloc(void);
 void __drm_crtc_commit_free(struct kref *kref);
 
 /**
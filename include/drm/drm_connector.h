@@ -1014,6 +1014,15 @@ struct drm_connector {
 	 */
 	bool edid_corrupt;
 
+	/**
+	 * @edid_reusable: Whether drm_do_get_edid() may take the extension
+	 * blocks from @edid_blob_ptr when the sink's base block is unchanged.
+	 * Set whenever the EDID property is updated, and cleared on each
+	 * hotplug interrupt, as a different sink of the same model may have
+	 * been plugged in with a matching base block but other extensions.
+	 */
+	bool edid_reusable;
+
 	/** @debugfs_entry: debugfs directory for this connector */
 	struct dentry *debugfs_entry;
 
@@ -38,6 +38,48 @@ struct drm_crtc_crc_entry {
 
 #define DRM_CRC_ENTRIES_NR	128
 
+/**
+ * struct drm_crtc_crc_ring_entry - a frame's CRC in the mmap-able ring
+ * @flags: %DRM_CRC_RING_HAS_FRAME if @frame is valid
+ * @frame: number of the frame this CRC is about
+ * @crcs: array of values that characterize the frame, of which
+ *	&drm_crtc_crc_ring.values_cnt are valid
+ */
+struct drm_crtc_crc_ring_entry {
+	__u32 flags;
+#define DRM_CRC_RING_HAS_FRAME	(1 << 0)
+	__u32 frame;
+	__u32 crcs[DRM_MAX_CRC_NR];
+};
+
+#define DRM_CRC_RING_ENTRIES_NR	1024
+
+/**
+ * struct drm_crtc_crc_ring - layout of the crc/ring file's mapping
+ * @head: number of entries produced, written by the kernel only
+ * @tail: number of entries consumed, written by userspace only, so the
+ *	file is to be opened and mapped read-write
+ * @entries_nr: size of @entries, a power of two
+ * @values_cnt: number of CRC values per entry
+ * @overflows: number of entries dropped because the ring was full
+ * @entries: the ring, entry N is at @entries[N & (@entries_nr - 1)]
+ *
+ * @head and @tail are free-running counters. Entries from @tail up to
+ * @head are valid, @head is only advanced once its entry is written.
+ *
+ * Apart from @tail, the header is a copy of the kernel's own state which
+ * is never read back, so writes from userspace to it are ignored.
+ */
+struct drm_crtc_crc_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 entries_nr;
+	__u32 values_cnt;
+	__u32 overflows;
+	__u32 pad[3];
+	struct drm_crtc_crc_ring_entry entries[];
+};
+
 /**
  * struct drm_crtc_crc - data supporting CRC capture on a given CRTC
  * @lock: protects the fields in this struct
@@ -45,8 +87,11 @@ struct drm_crtc_crc_entry {
  * @opened: whether userspace has opened the data file for reading
  * @overflow: whether an overflow occured.
  * @entries: array of entries, with size of %DRM_CRC_ENTRIES_NR
+ * @ring: shared ring replacing @entries when the ring file is open
  * @head: head of circular queue
  * @tail: tail of circular queue
+ * @ring_head: entries produced into @ring, published as &drm_crtc_crc_ring.head
+ * @ring_overflows: entries dropped from @ring
  * @values_cnt: number of CRC values per entry, up to %DRM_MAX_CRC_NR
  * @wq: workqueue used to synchronize reading and writing
  */
@@ -55,7 +100,9 @@ struct drm_crtc_crc {
 	const char *source;
 	bool opened, overflow;
 	struct drm_crtc_crc_entry *entries;
+	struct drm_crtc_crc_ring *ring;
 	int head, tail;
+	u32 ring_head, ring_overflows;
 	size_t values_cnt;
 	wait_queue_head_t wq;
 };
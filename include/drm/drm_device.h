@@ -158,7 +158,6 @@ struct drm_device {
 	 */
 	struct drm_vblank_crtc *vblank;
 
-	spinlock_t vblank_time_lock;    /**< Protects vblank count and time updates during vblank enable/disable */
 	spinlock_t vbl_lock;
 
 	/**
@@ -179,9 +178,8 @@ struct drm_device {
 	u32 max_vblank_count;           /**< size of vblank counter register */
 
 	/**
-	 * List of events
+	 * Protects the pending vblank events, see &drm_vblank_crtc.event_list
 	 */
-	struct list_head vblank_event_list;
 	spinlock_t event_lock;
 
 	/*@} */
@@ -22,6 +22,7 @@
 #ifndef _DRM_DP_MST_HELPER_H_
 #define _DRM_DP_MST_HELPER_H_
 
+#include <linux/ktime.h>
 #include <linux/types.h>
 #include <drm/drm_dp_helper.h>
 #include <drm/drm_atomic.h>
@@ -376,6 +377,7 @@ struct drm_dp_sideband_msg_tx {
 	int seqno;
 	int state;
 	bool path_msg;
+	ktime_t queued;
 	struct drm_dp_sideband_msg_reply_body reply;
 };
 
@@ -541,6 +543,21 @@ struct drm_dp_mst_topology_mgr {
 	 */
 	unsigned long vcpi_mask;
 
+	/**
+	 * @stats: Time spent walking the topology in the probe work, and
+	 * sideband request round trips. The request counters are protected
+	 * by @qlock, the probe ones are only updated from the serialised
+	 * probe work.
+	 */
+	struct {
+		unsigned int probes;
+		u64 last_probe_us;
+		u64 max_probe_us;
+		unsigned int requests;
+		unsigned int timeouts;
+		u64 max_reply_us;
+	} stats;
+
 	/**
 	 * @tx_waitq: Wait to queue stall for the tx worker.
 	 */
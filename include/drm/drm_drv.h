@@ -57,6 +57,11 @@ struct drm_printer;
 #define DRIVER_KMS_LEGACY_CONTEXT	0x20000
 #define DRIVER_SYNCOBJ                  0x40000
 #define DRIVER_PREFER_XBGR_30BPP        0x80000
+/*
+ * GEM objects are only freed after an RCU grace period, so handles can be
+ * looked up under rcu_read_lock() instead of &drm_file.table_lock.
+ */
+#define DRIVER_GEM_RCU			0x100000
 
 /**
  * struct drm_driver - DRM driver structure
@@ -228,6 +228,16 @@ struct drm_file {
 	/** @magic: Authentication magic, see @authenticated. */
 	drm_magic_t magic;
 
+	/**
+	 * @ioctl_permitted:
+	 *
+	 * Ioctl numbers that already passed drm_ioctl_permit() on this file
+	 * and whose permission cannot be revoked later on, i.e. which require
+	 * neither &DRM_MASTER nor &DRM_ROOT_ONLY. Lets drm_ioctl() skip the
+	 * permission checks for the hot ioctls of a client.
+	 */
+	DECLARE_BITMAP(ioctl_permitted, _IOC_NRMASK + 1);
+
 	/**
 	 * @lhead:
 	 *
@@ -243,7 +253,8 @@ struct drm_file {
 	 * @object_idr:
 	 *
 	 * Mapping of mm object handles to object pointers. Used by the GEM
-	 * subsystem. Protected by @table_lock.
+	 * subsystem. Protected by @table_lock, except for lookups on drivers
+	 * setting DRIVER_GEM_RCU which only need the RCU read lock.
 	 */
 	struct idr object_idr;
 
@@ -168,6 +168,7 @@ struct drm_mm_node {
 	struct rb_node rb_hole_addr;
 	u64 __subtree_last;
 	u64 hole_size;
+	u64 subtree_max_hole;
 	bool allocated : 1;
 	bool scanned_block : 1;
 #ifdef CONFIG_DRM_DEBUG_MM
@@ -233,6 +234,10 @@ struct drm_mm_scan {
 
 	u64 hit_start;
 	u64 hit_end;
+	u64 hit_cost;
+
+	u64 (*cost)(const struct drm_mm_node *node);
+	unsigned int budget;
 
 	unsigned long color;
 	enum drm_mm_insert_mode mode;
@@ -538,8 +543,29 @@ static inline void drm_mm_scan_init(struct drm_mm_scan *scan,
 				    0, U64_MAX, mode);
 }
 
+void drm_mm_scan_set_cost(struct drm_mm_scan *scan,
+			  u64 (*cost)(const struct drm_mm_node *node),
+			  unsigned int budget);
 bool drm_mm_scan_add_block(struct drm_mm_scan *scan,
 			   struct drm_mm_node *node);
+
+/**
+ * drm_mm_scan_found - check whether the scan has found a hole
+ * @scan: the active drm_mm scanner
+ *
+ * With a cost function set, drm_mm_scan_add_block() keeps looking for a
+ * cheaper hole after the first one is found. If the caller then runs out of
+ * candidates before the search budget is spent, this reports whether there is
+ * still a hole to evict for.
+ *
+ * Returns:
+ * True if a hole has been found, false otherwise.
+ */
+static inline bool drm_mm_scan_found(const struct drm_mm_scan *scan)
+{
+	return scan->hit_end;
+}
+
 bool drm_mm_scan_remove_block(struct drm_mm_scan *scan,
 			      struct drm_mm_node *node);
 struct drm_mm_node *drm_mm_scan_color_evict(struct drm_mm_scan *scan);
@@ -40,14 +40,31 @@
  * struct drm_prime_file_private - per-file tracking for PRIME
  *
  * This just contains the internal &struct dma_buf and handle caches for each
- * &struct drm_file used by the PRIME core code.
+ * &struct drm_file used by the PRIME core code, along with the most recently
+ * closed imports and a few counters exposed in the "prime" debugfs file.
  */
 
+#define DRM_PRIME_IMPORT_CACHE_SIZE 8
+
 struct drm_prime_file_private {
 /* private: */
 	struct mutex lock;
 	struct rb_root dmabufs;
 	struct rb_root handles;
+
+	/*
+	 * Imported objects whose last handle in this file was closed, kept
+	 * alive (with their attachment) so that importing the same dma-buf
+	 * again is only a handle allocation. Emptied by drm_gem_release().
+	 */
+	struct drm_gem_object *import_cache[DRM_PRIME_IMPORT_CACHE_SIZE];
+	unsigned int import_cache_next;
+
+	unsigned int count;
+	u64 imports;
+	u64 import_hits;
+	u64 import_cache_hits;
+	u64 exports;
 };
 
 struct device;
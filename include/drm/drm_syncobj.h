@@ -28,6 +28,7 @@
 
 #include "linux/dma-fence.h"
 
+struct dma_fence_chain;
 struct drm_syncobj_cb;
 
 /**
@@ -73,8 +74,8 @@ typedef void (*drm_syncobj_func_t)(struct drm_syncobj *syncobj,
  *
  * This struct will be initialized by drm_syncobj_add_callback, additional
  * data can be passed along by embedding drm_syncobj_cb in another struct.
- * The callback will get called the next time drm_syncobj_replace_fence is
- * called.
+ * The callback will get called the next time drm_syncobj_replace_fence or
+ * drm_syncobj_add_point is called.
  */
 struct drm_syncobj_cb {
 	struct list_head node;
@@ -131,11 +132,18 @@ drm_syncobj_fence_get(struct drm_syncobj *syncobj)
 
 struct drm_syncobj *drm_syncobj_find(struct drm_file *file_private,
 				     u32 handle);
+int drm_syncobj_find_array(struct drm_file *file_private,
+			   const u32 *handles, unsigned int count,
+			   struct drm_syncobj **syncobjs);
 void drm_syncobj_add_callback(struct drm_syncobj *syncobj,
 			      struct drm_syncobj_cb *cb,
 			      drm_syncobj_func_t func);
 void drm_syncobj_remove_callback(struct drm_syncobj *syncobj,
 				 struct drm_syncobj_cb *cb);
+void drm_syncobj_add_point(struct drm_syncobj *syncobj,
+			   struct dma_fence_chain *chain,
+			   struct dma_fence *fence,
+			   uint64_t point);
 void drm_syncobj_replace_fence(struct drm_syncobj *syncobj,
 			       struct dma_fence *fence);
 int drm_syncobj_find_fence(struct drm_file *file_private,
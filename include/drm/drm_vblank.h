@@ -108,6 +108,17 @@ struct drm_vblank_crtc {
 	 * @seqlock: Protect vblank count and time.
 	 */
 	seqlock_t seqlock;		/* protects vblank count and time */
+	/**
+	 * @time_lock: Serialises updates of @count and @time against vblank
+	 * enable/disable of this CRTC. Per CRTC so that vblank interrupts of
+	 * different pipes never contend with each other.
+	 */
+	spinlock_t time_lock;
+	/**
+	 * @event_list: Pending vblank events of this CRTC, protected by
+	 * &drm_device.event_lock.
+	 */
+	struct list_head event_list;
 
 	/**
 	 * @count: Current software vblank counter.
@@ -129,6 +129,7 @@ struct shared_policy {
 
 int vma_dup_policy(struct vm_area_struct *src, struct vm_area_struct *dst);
 void mpol_shared_policy_init(struct shared_policy *sp, struct mempolicy *mpol);
+int mpol_shared_policy_set_preferred(struct shared_policy *sp, int nid);
 int mpol_set_shared_policy(struct shared_policy *info,
 				struct vm_area_struct *vma,
 				struct mempolicy *new);
@@ -233,6 +234,12 @@ static inline void mpol_shared_policy_init(struct shared_policy *sp,
 {
 }
 
+static inline int mpol_shared_policy_set_preferred(struct shared_policy *sp,
+						   int nid)
+{
+	return 0;
+}
+
 static inline void mpol_free_shared_policy(struct shared_policy *p)
 {
 }
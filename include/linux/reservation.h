@@ -265,6 +265,35 @@ reservation_object_get_excl_rcu(struct reservation_object *obj)
 	return fence;
 }
 
+/**
+ * reservation_object_has_shared_rcu - check for shared fences without lock
+ * @obj: the reservation object
+ *
+ * Most objects only ever carry a single exclusive fence. For those this
+ * returns false after a single RCU dereference, telling the caller that the
+ * exclusive fence alone describes the state of the object and that the
+ * seqcount protected snapshot of the shared fences can be skipped.
+ *
+ * RETURNS
+ * True if the object currently has shared fences
+ */
+static inline bool
+reservation_object_has_shared_rcu(struct reservation_object *obj)
+{
+	struct reservation_object_list *fobj;
+	bool ret;
+
+	if (!rcu_access_pointer(obj->fence))
+		return false;
+
+	rcu_read_lock();
+	fobj = rcu_dereference(obj->fence);
+	ret = fobj && READ_ONCE(fobj->shared_count);
+	rcu_read_unlock();
+
+	return ret;
+}
+
 int reservation_object_reserve_shared(struct reservation_object *obj);
 void reservation_object_add_shared_fence(struct reservation_object *obj,
 					 struct dma_fence *fence);
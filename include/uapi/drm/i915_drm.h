@@ -110,7 +110,13 @@ enum drm_i915_gem_engine_class {
 enum drm_i915_pmu_engine_sample {
 	I915_SAMPLE_BUSY = 0,
 	I915_SAMPLE_WAIT = 1,
-	I915_SAMPLE_SEMA = 2
+	I915_SAMPLE_SEMA = 2,
+	I915_SAMPLE_ELSP = 3,
+	I915_SAMPLE_COALESCED = 4,
+	I915_SAMPLE_LITE_RESTORE = 5,
+	I915_SAMPLE_PORT_IDLE = 6,
+	I915_SAMPLE_WATCHDOG = 7,
+	I915_SAMPLE_WATCHDOG_NEAR = 8
 };
 
 #define I915_PMU_SAMPLE_BITS (4)
@@ -133,14 +139,63 @@ enum drm_i915_pmu_engine_sample {
 #define I915_PMU_ENGINE_SEMA(class, instance) \
 	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_SEMA)
 
+#define I915_PMU_ENGINE_ELSP(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_ELSP)
+
+#define I915_PMU_ENGINE_COALESCED(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_COALESCED)
+
+#define I915_PMU_ENGINE_LITE_RESTORE(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_LITE_RESTORE)
+
+#define I915_PMU_ENGINE_PORT_IDLE(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_PORT_IDLE)
+
+/* Batches that overran their watchdog threshold */
+#define I915_PMU_ENGINE_WATCHDOG(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_WATCHDOG)
+
+/* Batches that completed within their last quarter of the watchdog threshold */
+#define I915_PMU_ENGINE_WATCHDOG_NEAR(class, instance) \
+	__I915_PMU_ENGINE(class, instance, I915_SAMPLE_WATCHDOG_NEAR)
+
 #define __I915_PMU_OTHER(x) (__I915_PMU_ENGINE(0xff, 0xff, 0xf) + 1 + (x))
 
 #define I915_PMU_ACTUAL_FREQUENCY	__I915_PMU_OTHER(0)
 #define I915_PMU_REQUESTED_FREQUENCY	__I915_PMU_OTHER(1)
 #define I915_PMU_INTERRUPTS		__I915_PMU_OTHER(2)
 #define I915_PMU_RC6_RESIDENCY		__I915_PMU_OTHER(3)
+#define I915_PMU_TLB_INVALIDATIONS_SAVED	__I915_PMU_OTHER(4)
+
+#define I915_PMU_LAST I915_PMU_TLB_INVALIDATIONS_SAVED
+
+/*
+ * GVT-g counters, one instance per vGPU id. They live above the engine and
+ * other counters and are only available on a GVT-g host.
+ */
+enum drm_i915_pmu_vgpu_sample {
+	I915_VGPU_SAMPLE_BUSY = 0,
+	I915_VGPU_SAMPLE_WORKLOADS = 1,
+	I915_VGPU_SAMPLE_SHADOW = 2,
+	I915_VGPU_SAMPLE_SCHED_DELAY = 3
+};
+
+#define __I915_PMU_VGPU_BASE (1ULL << 32)
+
+#define __I915_PMU_VGPU(id, sample) \
+	(__I915_PMU_VGPU_BASE | (id) << I915_PMU_SAMPLE_BITS | (sample))
+
+#define I915_PMU_VGPU_BUSY(id) \
+	__I915_PMU_VGPU(id, I915_VGPU_SAMPLE_BUSY)
 
-#define I915_PMU_LAST I915_PMU_RC6_RESIDENCY
+#define I915_PMU_VGPU_WORKLOADS(id) \
+	__I915_PMU_VGPU(id, I915_VGPU_SAMPLE_WORKLOADS)
+
+#define I915_PMU_VGPU_SHADOW(id) \
+	__I915_PMU_VGPU(id, I915_VGPU_SAMPLE_SHADOW)
+
+#define I915_PMU_VGPU_SCHED_DELAY(id) \
+	__I915_PMU_VGPU(id, I915_VGPU_SAMPLE_SCHED_DELAY)
 
 /* Each region is a minimum of 16k, and there are at most 255 of them.
  */
@@ -319,6 +374,11 @@ typedef struct _drm_i915_sarea {
 #define DRM_I915_PERF_ADD_CONFIG	0x37
 #define DRM_I915_PERF_REMOVE_CONFIG	0x38
 #define DRM_I915_QUERY			0x39
+#define DRM_I915_GEM_EXECBUFFER2_VEC	0x3a
+#define DRM_I915_GEM_CREATE_BATCH	0x3b
+#define DRM_I915_GEM_BUSY_BATCH		0x3c
+#define DRM_I915_GEM_WAIT_MULTI		0x3d
+#define DRM_I915_GEM_CONTEXT_TRTT_BIND	0x3e
 
 #define DRM_IOCTL_I915_INIT		DRM_IOW( DRM_COMMAND_BASE + DRM_I915_INIT, drm_i915_init_t)
 #define DRM_IOCTL_I915_FLUSH		DRM_IO ( DRM_COMMAND_BASE + DRM_I915_FLUSH)
@@ -377,6 +437,11 @@ typedef struct _drm_i915_sarea {
 #define DRM_IOCTL_I915_PERF_ADD_CONFIG	DRM_IOW(DRM_COMMAND_BASE + DRM_I915_PERF_ADD_CONFIG, struct drm_i915_perf_oa_config)
 #define DRM_IOCTL_I915_PERF_REMOVE_CONFIG	DRM_IOW(DRM_COMMAND_BASE + DRM_I915_PERF_REMOVE_CONFIG, __u64)
 #define DRM_IOCTL_I915_QUERY			DRM_IOWR(DRM_COMMAND_BASE + DRM_I915_QUERY, struct drm_i915_query)
+#define DRM_IOCTL_I915_GEM_EXECBUFFER2_VEC	DRM_IOWR(DRM_COMMAND_BASE + DRM_I915_GEM_EXECBUFFER2_VEC, struct drm_i915_gem_execbuffer2_vec)
+#define DRM_IOCTL_I915_GEM_CREATE_BATCH	DRM_IOW(DRM_COMMAND_BASE + DRM_I915_GEM_CREATE_BATCH, struct drm_i915_gem_create_batch)
+#define DRM_IOCTL_I915_GEM_BUSY_BATCH	DRM_IOWR(DRM_COMMAND_BASE + DRM_I915_GEM_BUSY_BATCH, struct drm_i915_gem_busy_batch)
+#define DRM_IOCTL_I915_GEM_WAIT_MULTI	DRM_IOWR(DRM_COMMAND_BASE + DRM_I915_GEM_WAIT_MULTI, struct drm_i915_gem_wait_multi)
+#define DRM_IOCTL_I915_GEM_CONTEXT_TRTT_BIND	DRM_IOWR(DRM_COMMAND_BASE + DRM_I915_GEM_CONTEXT_TRTT_BIND, struct drm_i915_gem_context_trtt_bind)
 
 /* Allow drivers to submit batchbuffers directly to hardware, relying
  * on the security mechanisms provided by hardware.
@@ -468,6 +533,7 @@ typedef struct drm_i915_irq_wait {
 #define   I915_SCHEDULER_CAP_ENABLED	(1ul << 0)
 #define   I915_SCHEDULER_CAP_PRIORITY	(1ul << 1)
 #define   I915_SCHEDULER_CAP_PREEMPTION	(1ul << 2)
+#define   I915_SCHEDULER_CAP_DEADLINE	(1ul << 3)
 
 #define I915_PARAM_HUC_STATUS		 42
 
@@ -551,6 +617,60 @@ typedef struct drm_i915_irq_wait {
  */
 #define I915_PARAM_MMAP_GTT_COHERENT	52
 
+/*
+ * Query whether DRM_I915_GEM_EXECBUFFER2 supports the use of resident sets
+ * via I915_EXEC_RESIDENT_SET. See I915_EXEC_RESIDENT_SET.
+ */
+#define I915_PARAM_HAS_EXEC_RESIDENT_SET 53
+
+/* Query whether DRM_I915_GEM_EXECBUFFER2_VEC is available. */
+#define I915_PARAM_HAS_EXEC_VEC		 54
+
+/*
+ * Query whether I915_EXEC_SEQNO_OUT and I915_CONTEXT_PARAM_SEQNO_PAGE are
+ * available to poll for the completion of requests without a syscall.
+ */
+#define I915_PARAM_HAS_EXEC_SEQNO	 55
+
+/*
+ * Query the size in MiB of the pool of 2M pages reserved for objects
+ * created with I915_GEM_CREATE_HUGE_POOL, see i915.huge_pool_mb.
+ */
+#define I915_PARAM_HUGE_POOL_MB		 56
+
+/*
+ * Query whether EXEC_OBJECT_SPARSE is supported, i.e. whether objects can
+ * be bound into the ppgtt with their page tables populated on demand.
+ */
+#define I915_PARAM_HAS_EXEC_SPARSE	 57
+
+/* Query whether I915_PREAD_WC_STREAM (drm_i915_gem_pread.flags) is honoured */
+#define I915_PARAM_HAS_PREAD_WC_STREAM	 58
+
+/* Query whether DRM_I915_GEM_CREATE_BATCH is available. */
+#define I915_PARAM_HAS_GEM_CREATE_BATCH	 59
+
+/*
+ * Query whether I915_GEM_CREATE_STOLEN, passed in drm_i915_gem_create.flags,
+ * can allocate from stolen memory.
+ */
+#define I915_PARAM_HAS_GEM_CREATE_STOLEN 60
+
+/* Query whether I915_EXEC_BSD_BALANCE is supported by execbuf. */
+#define I915_PARAM_HAS_EXEC_BSD_BALANCE	61
+
+/* Query whether EXEC_OBJECT_TIMESTAMP is supported by execbuf. */
+#define I915_PARAM_HAS_EXEC_TIMESTAMP	62
+
+/* Query whether I915_GEM_CREATE_RECYCLE is accepted by GEM_CREATE. */
+#define I915_PARAM_HAS_GEM_CREATE_RECYCLE 63
+
+/*
+ * Query whether I915_PREAD_DETILE and I915_PWRITE_DETILE, in the flags of
+ * drm_i915_gem_pread and drm_i915_gem_pwrite, are honoured for tiled objects.
+ */
+#define I915_PARAM_HAS_GEM_DETILE	 64
+
 typedef struct drm_i915_getparam {
 	__s32 param;
 	/*
@@ -649,6 +769,58 @@ struct drm_i915_gem_create {
 	 */
 	__u32 handle;
 	__u32 pad;
+
+	/**
+	 * Creation flags, unknown flags are rejected.
+	 *
+	 * I915_GEM_CREATE_HUGE_POOL: back the object by the device's pool of
+	 * 2M pages (see I915_PARAM_HUGE_POOL_MB), falling back to the
+	 * largest pages available. Such objects are not swappable and can
+	 * only be mmapped through the GTT. Creation fails with -ENOSPC once
+	 * the client would own more than i915.huge_pool_client_mb of them.
+	 *
+	 * I915_GEM_CREATE_STOLEN: back the object by the stolen memory
+	 * reserved for the GPU by the BIOS. The object is cleared, rounded
+	 * up to a power-of-two size, has no CPU mmap other than through the
+	 * GTT, and its contents are lost over hibernation. Intended for
+	 * scratch buffers that need no CPU access. Creation fails with
+	 * -ENOSPC once the client would own more than half of the stolen
+	 * memory available to userspace.
+	 *
+	 * I915_GEM_CREATE_RECYCLE: the object may be one of the same size
+	 * previously closed by this client while marked I915_MADV_DONTNEED,
+	 * so its contents are undefined rather than cleared, but its pages
+	 * and bindings may already be in place. The object is returned as
+	 * I915_MADV_WILLNEED. Ignored when combined with other flags.
+	 *
+	 * Added in version 2.
+	 */
+	__u64 flags;
+#define I915_GEM_CREATE_HUGE_POOL	(1 << 0)
+#define I915_GEM_CREATE_STOLEN		(1 << 1)
+#define I915_GEM_CREATE_RECYCLE		(1 << 2)
+};
+
+/*
+ * DRM_IOCTL_I915_GEM_CREATE_BATCH creates count objects, each of the same
+ * size and with the same creation flags as for DRM_IOCTL_I915_GEM_CREATE,
+ * in a single call. The new handles are written to the array of __u32 at
+ * handles_ptr. Either all the objects are created, or none are.
+ */
+struct drm_i915_gem_create_batch {
+	/** Requested size of each object, rounded up to a page. */
+	__u64 size;
+
+	/** Pointer to an array of count __u32 to receive the handles */
+	__u64 handles_ptr;
+
+	/** Number of objects to create */
+	__u32 count;
+#define I915_GEM_CREATE_BATCH_MAX	4096
+
+	/** Creation flags, as drm_i915_gem_create.flags */
+	__u32 flags;
+#define __I915_GEM_CREATE_UNKNOWN_FLAGS	(-(I915_GEM_CREATE_RECYCLE << 1))
 };
 
 struct drm_i915_gem_pread {
@@ -665,6 +837,28 @@ struct drm_i915_gem_pread {
 	 * This is a fixed-size type for 32/64 compatibility.
 	 */
 	__u64 data_ptr;
+
+	/**
+	 * Read flags, unknown flags are rejected.
+	 *
+	 * I915_PREAD_WC_STREAM: read through the GTT with streaming
+	 * (non-temporal) loads, bypassing the CPU cache, instead of through
+	 * the object's backing storage. Useful for reading back objects the
+	 * GPU has written and that are not coherent with the CPU cache.
+	 * Ignored if the CPU does not support such loads, see
+	 * I915_PARAM_HAS_PREAD_WC_STREAM.
+	 *
+	 * I915_PREAD_DETILE: for an X or Y tiled object, treat offset and
+	 * size as a range of the linear surface of the same stride, and
+	 * detile (and deswizzle) the data on the CPU, without the use of a
+	 * fence or of the mappable aperture. See I915_PARAM_HAS_GEM_DETILE.
+	 *
+	 * Added in version 2.
+	 */
+	__u64 flags;
+#define I915_PREAD_WC_STREAM	(1 << 0)
+#define I915_PREAD_DETILE	(1 << 1)
+#define __I915_PREAD_UNKNOWN_FLAGS	(-(I915_PREAD_DETILE << 1))
 };
 
 struct drm_i915_gem_pwrite {
@@ -681,6 +875,19 @@ struct drm_i915_gem_pwrite {
 	 * This is a fixed-size type for 32/64 compatibility.
 	 */
 	__u64 data_ptr;
+
+	/**
+	 * Write flags, unknown flags are rejected.
+	 *
+	 * I915_PWRITE_DETILE: for an X or Y tiled object, treat offset and
+	 * size as a range of the linear surface of the same stride, and
+	 * tile (and swizzle) the data on the CPU, see I915_PREAD_DETILE.
+	 *
+	 * Added in version 2.
+	 */
+	__u64 flags;
+#define I915_PWRITE_DETILE	(1 << 0)
+#define __I915_PWRITE_UNKNOWN_FLAGS	(-(I915_PWRITE_DETILE << 1))
 };
 
 struct drm_i915_gem_mmap {
@@ -921,8 +1128,33 @@ struct drm_i915_gem_exec_object2 {
  * if the kernel supports this flag.
  */
 #define EXEC_OBJECT_CAPTURE		(1<<7)
+/* Bind the object sparsely into the ppgtt: only its address range is
+ * reserved up front, and the page tables are populated on demand for the
+ * range of pages named in rsvd2 (first page in the lower 32 bits, number
+ * of pages in the upper 32 bits) by each execbuf using it. Accesses to any
+ * range not yet populated read from the scratch page. Sparse objects
+ * cannot have relocations. Query I915_PARAM_HAS_EXEC_SPARSE to see if the
+ * kernel supports this flag.
+ */
+#define EXEC_OBJECT_SPARSE		(1<<8)
+#define EXEC_OBJECT_SPARSE_RANGE(first, count) \
+	((__u64)(__u32)(first) | (__u64)(count) << 32)
+/* Have the engine store its CS timestamp (RING_TIMESTAMP, see
+ * DRM_I915_QUERY_CS_TIMESTAMP) into this object just before the batch
+ * starts and again after it completes, as two __u64 at the byte offset
+ * given in rsvd2 (which must be 8 byte aligned). Only one object per
+ * execbuf may be so flagged, it is implicitly written, and it may not
+ * also be sparse. Query I915_PARAM_HAS_EXEC_TIMESTAMP to see if the
+ * kernel supports this flag.
+ */
+#define EXEC_OBJECT_TIMESTAMP		(1<<9)
+/* Flush the CPU cache for this object before the GPU reads it, as the CPU
+ * may have written to it without the kernel knowing, e.g. from a context
+ * with I915_CONTEXT_PARAM_EXPLICIT_COHERENCY.
+ */
+#define EXEC_OBJECT_CLFLUSH		(1<<10)
 /* All remaining bits are MBZ and RESERVED FOR FUTURE USE */
-#define __EXEC_OBJECT_UNKNOWN_FLAGS -(EXEC_OBJECT_CAPTURE<<1)
+#define __EXEC_OBJECT_UNKNOWN_FLAGS -(EXEC_OBJECT_CLFLUSH<<1)
 	__u64 flags;
 
 	union {
@@ -1022,6 +1254,11 @@ struct drm_i915_gem_execbuffer2 {
 #define I915_EXEC_BSD_DEFAULT	 (0 << I915_EXEC_BSD_SHIFT)
 #define I915_EXEC_BSD_RING1	 (1 << I915_EXEC_BSD_SHIFT)
 #define I915_EXEC_BSD_RING2	 (2 << I915_EXEC_BSD_SHIFT)
+/*
+ * Pick whichever BSD ring has the least work outstanding for each
+ * execbuf, see I915_PARAM_HAS_EXEC_BSD_BALANCE.
+ */
+#define I915_EXEC_BSD_BALANCE	 (3 << I915_EXEC_BSD_SHIFT)
 
 /** Tell the kernel that the batchbuffer is processed by
  *  the resource streamer.
@@ -1070,7 +1307,43 @@ struct drm_i915_gem_execbuffer2 {
  */
 #define I915_EXEC_FENCE_ARRAY   (1<<19)
 
-#define __I915_EXEC_UNKNOWN_FLAGS (-(I915_EXEC_FENCE_ARRAY<<1))
+/*
+ * Setting I915_EXEC_RESIDENT_SET repurposes DR1 as the identifier of a
+ * per-context resident set. A resident set remembers the vma looked up for
+ * each execobject[] handle, allowing later execbufs using the same object
+ * list to skip the per-handle lookup.
+ *
+ * If DR1 is 0, a new resident set is created from this execobject[] list
+ * and its identifier is returned in DR1 upon success (this requires the use
+ * of DRM_IOCTL_I915_GEM_EXECBUFFER2_WR). Subsequent execbufs pass that
+ * identifier in DR1; entries whose handle no longer matches the registered
+ * list are simply looked up as usual. A set invalidated by the closing of
+ * any handle is rebuilt from the next execbuf using it. A resident set is
+ * released with I915_CONTEXT_PARAM_RESIDENT_SET or when the context is
+ * destroyed.
+ */
+#define I915_EXEC_RESIDENT_SET	(1<<20)
+
+/*
+ * Setting I915_EXEC_DEADLINE repurposes DR4 as a deadline for the batch, in
+ * microseconds from the time of submission. Requests of the same priority
+ * are executed in order of earliest deadline, and a request passes its
+ * deadline on to the requests it depends upon. It overrides the default
+ * deadline of the context, see I915_CONTEXT_PARAM_DEADLINE. Only available
+ * with I915_SCHEDULER_CAP_DEADLINE.
+ */
+#define I915_EXEC_DEADLINE	(1<<21)
+
+/*
+ * Setting I915_EXEC_SEQNO_OUT returns, in the upper 32 bits of rsvd1, the
+ * seqno that the batch will write into the context's seqno page upon
+ * completion (see I915_CONTEXT_PARAM_SEQNO_PAGE). Seqnos increase
+ * monotonically per context and engine, and so the batch is complete once
+ * the engine's slot in the page has passed it (allowing for wraparound).
+ */
+#define I915_EXEC_SEQNO_OUT	(1<<22)
+
+#define __I915_EXEC_UNKNOWN_FLAGS (-(I915_EXEC_SEQNO_OUT<<1))
 
 #define I915_EXEC_CONTEXT_ID_MASK	(0xffffffff)
 #define i915_execbuffer2_set_context_id(eb2, context) \
@@ -1078,6 +1351,40 @@ struct drm_i915_gem_execbuffer2 {
 #define i915_execbuffer2_get_context_id(eb2) \
 	((eb2).rsvd1 & I915_EXEC_CONTEXT_ID_MASK)
 
+/*
+ * DRM_IOCTL_I915_GEM_EXECBUFFER2_VEC submits an array of execbuf, each
+ * described exactly as for DRM_IOCTL_I915_GEM_EXECBUFFER2, in order and
+ * within a single critical section. Dependencies between the execbufs may
+ * be expressed with syncobj using I915_EXEC_FENCE_ARRAY (a syncobj signaled
+ * by an earlier execbuf is visible to the later ones), or by setting
+ * I915_EXEC_VEC_CHAIN to make each execbuf wait upon the previous one.
+ *
+ * With I915_EXEC_VEC_GANG, each execbuf must be on a different engine and
+ * the batches are then only started together, once the dependencies of
+ * all of them are met. (It makes no sense to combine with
+ * I915_EXEC_VEC_CHAIN.)
+ *
+ * Each drm_i915_gem_execbuffer2 is written back to userspace (e.g. to
+ * report I915_EXEC_FENCE_OUT). Upon return, count is updated to the number
+ * of execbufs that were submitted; submission stops at the first error.
+ */
+struct drm_i915_gem_execbuffer2_vec {
+	/** Pointer to an array of struct drm_i915_gem_execbuffer2 */
+	__u64 execbuf_ptr;
+
+	/** Number of elements in the execbuf_ptr array */
+	__u32 count;
+#define I915_EXEC_VEC_MAX	64
+
+	__u32 flags;
+#define I915_EXEC_VEC_CHAIN	(1<<0)
+#define I915_EXEC_VEC_GANG	(1<<1)
+#define __I915_EXEC_VEC_UNKNOWN_FLAGS (-(I915_EXEC_VEC_GANG << 1))
+
+	/** Must be zero */
+	__u64 rsvd;
+};
+
 struct drm_i915_gem_pin {
 	/** Handle of the buffer to be pinned. */
 	__u32 handle;
@@ -1147,6 +1454,43 @@ struct drm_i915_gem_busy {
 	__u32 busy;
 };
 
+/*
+ * DRM_IOCTL_I915_GEM_BUSY_BATCH queries the busyness of count objects in a
+ * single call. The handles are read from the array of __u32 at handles_ptr,
+ * and for each one the value that DRM_IOCTL_I915_GEM_BUSY would report is
+ * written to the array of __u32 at busy_ptr.
+ *
+ * With I915_GEM_BUSY_BATCH_IDLE, the handles of the idle objects are
+ * written to busy_ptr instead, in the order they were given, stopping once
+ * idle_count have been found (or all the handles checked, if idle_count is
+ * 0). The number of idle handles written is returned in idle_count.
+ *
+ * If any handle is invalid, -ENOENT is returned and nothing is written.
+ */
+struct drm_i915_gem_busy_batch {
+	/** Pointer to an array of count __u32 handles to query */
+	__u64 handles_ptr;
+
+	/** Pointer to an array of count __u32 to receive the results */
+	__u64 busy_ptr;
+
+	/** Number of handles to query */
+	__u32 count;
+#define I915_GEM_BUSY_BATCH_MAX		4096
+
+	__u32 flags;
+#define I915_GEM_BUSY_BATCH_IDLE	(1u << 0)
+
+	/**
+	 * With I915_GEM_BUSY_BATCH_IDLE, the maximum number of idle handles
+	 * to return (0 for no limit), and on return the number found. Must
+	 * be 0 otherwise.
+	 */
+	__u32 idle_count;
+
+	__u32 pad;
+};
+
 /**
  * I915_CACHING_NONE
  *
@@ -1403,6 +1747,33 @@ struct drm_i915_gem_wait {
 	__s64 timeout_ns;
 };
 
+/*
+ * DRM_IOCTL_I915_GEM_WAIT_MULTI waits, as DRM_IOCTL_I915_GEM_WAIT does for
+ * a single object, until all of the count objects whose handles are in the
+ * array of __u32 at handles_ptr are idle. With I915_GEM_WAIT_MULTI_ANY, it
+ * instead waits until any one of them is idle, and returns its index in
+ * the array in first_idle.
+ */
+struct drm_i915_gem_wait_multi {
+	/** Pointer to an array of count __u32 handles to wait on */
+	__u64 handles_ptr;
+
+	/** Number of handles */
+	__u32 count;
+#define I915_GEM_WAIT_MULTI_MAX		4096
+
+	__u32 flags;
+#define I915_GEM_WAIT_MULTI_ANY		(1u << 0)
+
+	/** Number of nanoseconds to wait, Returns time remaining. */
+	__s64 timeout_ns;
+
+	/** With I915_GEM_WAIT_MULTI_ANY, returns the index of an idle object */
+	__u32 first_idle;
+
+	__u32 pad;
+};
+
 struct drm_i915_gem_context_create {
 	/*  output: id of new context*/
 	__u32 ctx_id;
@@ -1460,6 +1831,11 @@ struct drm_i915_gem_userptr {
 	__u64 user_size;
 	__u32 flags;
 #define I915_USERPTR_READ_ONLY 0x1
+/*
+ * Start acquiring the user pages in the background as soon as the object
+ * is created, rather than upon its first use.
+ */
+#define I915_USERPTR_PREFAULT 0x2
 #define I915_USERPTR_UNSYNCHRONIZED 0x80000000
 	/**
 	 * Returned handle for the object.
@@ -1484,9 +1860,110 @@ struct drm_i915_gem_context_param {
 #define   I915_CONTEXT_MIN_USER_PRIORITY	-1023 /* inclusive */
 #define I915_CONTEXT_PARAM_WATCHDOG	0x7
 #define I915_CONTEXT_PARAM_TRTT		0x8
+/*
+ * Set only: release the resident set (see I915_EXEC_RESIDENT_SET) whose
+ * identifier is given in value.
+ */
+#define I915_CONTEXT_PARAM_RESIDENT_SET	0x9
+/*
+ * Default deadline, in nanoseconds from the time of submission, given to
+ * each request of the context. 0 (the default) means no deadline.
+ * See I915_EXEC_DEADLINE.
+ */
+#define I915_CONTEXT_PARAM_DEADLINE	0xa
+/*
+ * Busywait policy used before sleeping when waiting upon the context's
+ * requests: 0 (the default) spins for a short fixed time, 1 adapts the
+ * spin to the recent completion times of the context's requests.
+ */
+#define I915_CONTEXT_PARAM_SPIN		0xb
+#define   I915_CONTEXT_SPIN_FIXED	0
+#define   I915_CONTEXT_SPIN_ADAPTIVE	1
+/*
+ * Get only: returns a new GEM handle to a page, read-only for userspace,
+ * into which the engines write the seqno (see I915_EXEC_SEQNO_OUT) of each
+ * request of the context as it completes. The seqno of the engine of class
+ * C and instance I is the dword at index C * 16 + I. Requests cancelled by
+ * a GPU reset are not written, so their fence must be used instead.
+ * Query I915_PARAM_HAS_EXEC_SEQNO to see if available.
+ */
+#define I915_CONTEXT_PARAM_SEQNO_PAGE	0xc
+/*
+ * Set only: replace the context's address space with that of the context
+ * whose id is given in value, so that both share their bindings and page
+ * tables (e.g. one context per submitting thread of a client). Only
+ * allowed before the context is first used and when using full-ppgtt.
+ */
+#define I915_CONTEXT_PARAM_SHARE_VM	0xd
+/*
+ * Declare that the context keeps no engine state from one batch to the
+ * next (e.g. a GPGPU queue that programs all of its state in each batch),
+ * so the engine state need not be initialised from the golden context nor
+ * restored on each switch. Only allowed before the context is first used,
+ * and only with execlists.
+ */
+#define I915_CONTEXT_PARAM_STATELESS	0xe
+/*
+ * Get only: the total time in nanoseconds the context has been submitted
+ * to the GPU, across all engines. Only tracked with execlists.
+ */
+#define I915_CONTEXT_PARAM_BUSY_TIME	0xf
+/*
+ * Frequency hints for while the context is executing, in MHz: the low 32
+ * bits of value give the minimum and the upper 32 bits the maximum, 0
+ * leaving that bound to the driver. While hinted contexts are running, the
+ * GPU is kept at or above the highest of their minimums and, unless an
+ * unrestricted context is also running, at or below the highest of their
+ * maximums, always within the limits set through sysfs (to which the
+ * hints are clamped). Setting a minimum requires CAP_SYS_NICE. Waitboosts
+ * still take precedence. Only available with execlists.
+ */
+#define I915_CONTEXT_PARAM_FREQUENCY	0x10
+/*
+ * Size in bytes of the ring buffer allocated for the context on each
+ * engine, which bounds how many requests may be queued before the
+ * submitter has to wait for the GPU to catch up. Must be a power of two
+ * between 4KiB and 2MiB. Only allowed before the context is first used,
+ * and only with execlists.
+ */
+#define I915_CONTEXT_PARAM_RINGSIZE	0x11
+/*
+ * Take over responsibility for CPU cache coherency of the objects used by
+ * the context: execbuf no longer clflushes objects written through the CPU
+ * cache before the GPU reads them, except those flagged with
+ * EXEC_OBJECT_CLFLUSH, nor does the client need GEM_SET_DOMAIN around its
+ * own accesses. Only matters on platforms without a shared LLC. Pages are
+ * still always flushed once after they are first acquired by the kernel.
+ */
+#define I915_CONTEXT_PARAM_EXPLICIT_COHERENCY	0x12
+/*
+ * Program the spare entries of the render engine MOCS table (those past
+ * enum i915_mocs_table_index), as seen by the context only: value points
+ * to an array of struct drm_i915_gem_context_mocs_entry, size being its
+ * size in bytes. Only the (e)LLC cacheability, target cache and LRU age
+ * of the control value may be set; the L3 control is shared by all
+ * contexts, so l3cc_value must be 0. A size of 0 restores the default
+ * table. Getting returns the current table in full.
+ */
+#define I915_CONTEXT_PARAM_MOCS		0x13
+/*
+ * Derive the watchdog threshold of each batch from the runtimes of the
+ * context's recent batches on the engine: value is the percentile (1 to
+ * 100) of those runtimes, twice which becomes the threshold, or 0 to only
+ * use the fixed thresholds of I915_CONTEXT_PARAM_WATCHDOG. Until enough
+ * batches have completed, the fixed threshold applies.
+ */
+#define I915_CONTEXT_PARAM_WATCHDOG_ADAPTIVE	0x14
 	__u64 value;
 };
 
+struct drm_i915_gem_context_mocs_entry {
+	__u32 index;
+	__u32 control_value;
+	__u32 l3cc_value;
+	__u32 rsvd;
+};
+
 struct drm_i915_gem_context_trtt_param {
 	__u64 segment_base_addr;
 	__u64 l3_table_address;
@@ -1495,6 +1972,54 @@ struct drm_i915_gem_context_trtt_param {
 	__u64 rsvd1;
 };
 
+struct drm_i915_gem_trtt_tile {
+	/** Address of the 64KiB tile, inside the TR-TT segment */
+	__u64 tile_addr;
+
+	/** PPGTT address of the 64KiB of memory backing the tile */
+	__u64 backing_addr;
+
+	__u32 flags;
+/* Make the tile invalid again, ignoring backing_addr */
+#define I915_TRTT_TILE_UNBIND	(1u << 0)
+/* Make the tile a null tile, ignoring backing_addr */
+#define I915_TRTT_TILE_NULL	(1u << 1)
+
+	__u32 pad;
+};
+
+/*
+ * DRM_IOCTL_I915_GEM_CONTEXT_TRTT_BIND maps (or unmaps) count tiles of the
+ * TR-TT segment of a context set up with I915_CONTEXT_PARAM_TRTT, from the
+ * array of struct drm_i915_gem_trtt_tile at tiles_ptr. The L2 and L1
+ * tables are allocated and managed by the kernel, which fills in the
+ * entries of the L3 table given to I915_CONTEXT_PARAM_TRTT that point to
+ * them (the others must still be invalid or null tiles).
+ *
+ * The tables are updated asynchronously by the render engine, in order
+ * with the requests of the context, after the optional
+ * I915_TRTT_BIND_FENCE_IN whose sync_file is given in fence. With
+ * I915_TRTT_BIND_FENCE_OUT, fence returns a sync_file signaled once the
+ * update is complete.
+ */
+struct drm_i915_gem_context_trtt_bind {
+	__u32 ctx_id;
+
+	__u32 flags;
+#define I915_TRTT_BIND_FENCE_IN		(1u << 0)
+#define I915_TRTT_BIND_FENCE_OUT	(1u << 1)
+
+	/** Number of tiles */
+	__u32 count;
+#define I915_TRTT_BIND_MAX		128
+
+	/** In and out sync_file, see I915_TRTT_BIND_FENCE_IN/OUT */
+	__s32 fence;
+
+	/** Pointer to an array of count struct drm_i915_gem_trtt_tile */
+	__u64 tiles_ptr;
+};
+
 enum drm_i915_oa_format {
 	I915_OA_FORMAT_A13 = 1,	    /* HSW only */
 	I915_OA_FORMAT_A29,	    /* HSW only */
@@ -1546,6 +2071,28 @@ enum drm_i915_perf_property_id {
 	 */
 	DRM_I915_PERF_PROP_OA_EXPONENT,
 
+	/**
+	 * A value of 1, for a stream opened for a specific context on gen8+,
+	 * restricts the reports read() back to the pair bookending each
+	 * period the context was running on the GPU: the first report
+	 * tagged with the context after a switch to it, and the first report
+	 * after it was switched away. The difference between each pair is
+	 * then the progress of the counters for that context alone, and
+	 * all the other reports (periodic or not) are dropped by the kernel.
+	 */
+	DRM_I915_PERF_PROP_OA_CTX_SWITCH_ONLY,
+
+	/**
+	 * The period, in nanoseconds, at which the kernel checks the OA buffer
+	 * for new reports to wake up a poll() or blocking read(). The default
+	 * is 5ms and the lowest accepted 100us.
+	 *
+	 * A value of 0 instead selects an adaptive period, derived from the
+	 * rate at which reports are being produced, so that each wakeup finds
+	 * a sizeable batch of reports without letting the buffer overflow.
+	 */
+	DRM_I915_PERF_PROP_POLL_OA_PERIOD,
+
 	DRM_I915_PERF_PROP_MAX /* non-ABI */
 };
 
@@ -1584,6 +2131,32 @@ struct drm_i915_perf_open_param {
  */
 #define I915_PERF_IOCTL_DISABLE	_IO('i', 0x1)
 
+/**
+ * struct drm_i915_perf_oa_buffer_info - describes the mmapped OA buffer
+ *
+ * The OA buffer of an OA stream may be mapped read-only with mmap() on the
+ * stream fd (at offset 0, for @size bytes), as an alternative to read().
+ * The two should not be mixed on the same stream.
+ *
+ * I915_PERF_IOCTL_OA_BUFFER_INFO reports the current @head and the
+ * @tail up to which the reports are known to have landed, both as byte
+ * offsets into the mapping. Reports in [@head, @tail) (which may wrap)
+ * are then valid and, once consumed, userspace advances the head with
+ * I915_PERF_IOCTL_OA_BUFFER_HEAD to let the OA unit reuse the space.
+ * The new head must lie between the current head and tail and be
+ * aligned to @report_size.
+ */
+struct drm_i915_perf_oa_buffer_info {
+	__u32 size;
+	__u32 report_size;
+	__u32 head;
+	__u32 tail;
+};
+
+#define I915_PERF_IOCTL_OA_BUFFER_INFO \
+	_IOR('i', 0x2, struct drm_i915_perf_oa_buffer_info)
+#define I915_PERF_IOCTL_OA_BUFFER_HEAD	_IOW('i', 0x3, __u32)
+
 /**
  * Common to all i915 perf records
  */
@@ -1656,6 +2229,8 @@ struct drm_i915_perf_oa_config {
 struct drm_i915_query_item {
 	__u64 query_id;
 #define DRM_I915_QUERY_TOPOLOGY_INFO    1
+#define DRM_I915_QUERY_CS_TIMESTAMP     2
+#define DRM_I915_QUERY_TELEMETRY        3
 
 	/*
 	 * When set to zero by userspace, this is filled with the size of the
@@ -1692,6 +2267,88 @@ struct drm_i915_query {
 	__u64 items_ptr;
 };
 
+/*
+ * Data exchanged with query DRM_I915_QUERY_CS_TIMESTAMP, to correlate the
+ * CS timestamps of an engine (e.g. as written by EXEC_OBJECT_TIMESTAMP)
+ * with CLOCK_MONOTONIC.
+ *
+ * Userspace fills in @engine_class and @engine_instance (see
+ * enum drm_i915_gem_engine_class), and the kernel returns the engine's
+ * @cs_timestamp as read between @cpu_timestamp and @cpu_timestamp +
+ * @cpu_delta (in ns), along with the @frequency (in Hz) at which the CS
+ * timestamp ticks.
+ */
+struct drm_i915_query_cs_timestamp {
+	__u16 engine_class;
+	__u16 engine_instance;
+
+	/* MBZ */
+	__u32 flags;
+
+	__u64 cs_timestamp;
+	__u64 cpu_timestamp;
+	__u64 cpu_delta;
+
+	__u32 frequency;
+
+	/* MBZ */
+	__u32 rsvd;
+};
+
+struct drm_i915_query_telemetry_engine {
+	__u16 engine_class;
+	__u16 engine_instance;
+
+	__u32 flags;
+#define I915_TELEMETRY_ENGINE_BUSY	(1 << 0) /* busy_ns is valid */
+	/*
+	 * Accumulated time the engine has spent executing, in ns. Only the
+	 * difference between two snapshots is meaningful. As it reveals the
+	 * activity of all clients, it is only reported to CAP_SYS_ADMIN.
+	 */
+	__u64 busy_ns;
+};
+
+/*
+ * Data written by the kernel with query DRM_I915_QUERY_TELEMETRY, a single
+ * snapshot of the device activity for system monitors that would otherwise
+ * have to gather it piecemeal from sysfs and debugfs.
+ *
+ * The item length must cover the header and one
+ * struct drm_i915_query_telemetry_engine per engine; query with a zero
+ * length to learn the size. @flags must be zero on input.
+ *
+ * @timestamp is CLOCK_MONOTONIC (in ns) at the time of the snapshot. The
+ * frequencies are in MHz. @act_freq can only be read from the hardware
+ * whilst it is awake (I915_TELEMETRY_AWAKE), otherwise it is reported as
+ * zero. Whilst asleep @rc6_residency_ns is estimated as for the PMU, by
+ * adding the time spent runtime suspended to the last value read (and is
+ * zero if the kernel has no PMU support).
+ * @object_count and @object_memory (in bytes) cover all GEM objects.
+ */
+struct drm_i915_query_telemetry {
+	__u64 timestamp;
+
+	__u32 flags;
+#define I915_TELEMETRY_AWAKE		(1 << 0)
+
+	__u32 num_engines;
+
+	__u32 act_freq;
+	__u32 req_freq;
+	__u32 min_freq;
+	__u32 max_freq;
+
+	__u64 rc6_residency_ns;
+
+	__u64 object_count;
+	__u64 object_memory;
+
+	__u64 rsvd[4];
+
+	struct drm_i915_query_telemetry_engine engines[];
+};
+
 /*
  * Data written by the kernel with query DRM_I915_QUERY_TOPOLOGY_INFO :
  *
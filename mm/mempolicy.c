@@ -2518,6 +2518,58 @@ void mpol_shared_policy_init(struct shared_policy *sp, struct mempolicy *mpol)
 	}
 }
 
+/**
+ * mpol_shared_policy_set_preferred - prefer a node for an inode's pages
+ * @sp: pointer to inode shared policy
+ * @nid: node to prefer
+ *
+ * Install a MPOL_PREFERRED policy for @nid covering the entire file, for
+ * kernel users that know where the pages of a file will be accessed from.
+ * The pages are still allocated by, and charged to, the faulting task, and
+ * fall back to other nodes when @nid is short of memory. An inode that
+ * already has a policy, e.g. from its tmpfs mount, is left untouched.
+ */
+int mpol_shared_policy_set_preferred(struct shared_policy *sp, int nid)
+{
+	struct vm_area_struct pvma;
+	struct mempolicy *new;
+	nodemask_t nodes;
+	int ret;
+	NODEMASK_SCRATCH(scratch);
+
+	if (!RB_EMPTY_ROOT(&sp->root))
+		return 0;
+
+	if (!scratch)
+		return -ENOMEM;
+
+	nodes = nodemask_of_node(nid);
+	new = mpol_new(MPOL_PREFERRED, 0, &nodes);
+	if (IS_ERR(new)) {
+		ret = PTR_ERR(new);
+		goto free_scratch;
+	}
+
+	task_lock(current);
+	ret = mpol_set_nodemask(new, &nodes, scratch);
+	task_unlock(current);
+	if (ret)
+		goto put_new;
+
+	/* Create pseudo-vma that contains just the policy */
+	memset(&pvma, 0, sizeof(struct vm_area_struct));
+	vma_init(&pvma, NULL);
+	pvma.vm_end = TASK_SIZE;	/* policy covers entire file */
+	ret = mpol_set_shared_policy(sp, &pvma, new); /* adds ref */
+
+put_new:
+	mpol_put(new);			/* drop initial ref */
+free_scratch:
+	NODEMASK_SCRATCH_FREE(scratch);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(mpol_shared_policy_set_preferred);
+
 int mpol_set_shared_policy(struct shared_policy *info,
 			struct vm_area_struct *vma, struct mempolicy *npol)
 {